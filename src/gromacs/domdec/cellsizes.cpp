@@ -47,6 +47,11 @@
 
 #include "config.h"
 
+#include <cmath>
+
+#include <algorithm>
+#include <vector>
+
 #include "gromacs/gmxlib/network.h"
 #include "gromacs/math/vec.h"
 #include "gromacs/mdtypes/commrec.h"
@@ -556,6 +561,81 @@ static void dd_cell_sizes_dlb_root_enforce_limits(gmx_domdec_t*      dd,
 }
 
 
+bool setCellSizesFromCostProfile(gmx::ArrayRef<const float> costProfile,
+                                 gmx::ArrayRef<const real>  cellFrac,
+                                 int                        ncd,
+                                 real                       relax,
+                                 real                       changeLimit,
+                                 gmx::ArrayRef<real>        cellSize)
+{
+    const int numBins = c_dlbCostProfileNumBins;
+
+    if (costProfile.size() != static_cast<size_t>(ncd * numBins))
+    {
+        return false;
+    }
+
+    /* Set up the cumulative cost at the bin edges */
+    std::vector<real> edgeFrac(ncd * numBins + 1);
+    std::vector<real> edgeCost(ncd * numBins + 1);
+    edgeFrac[0] = cellFrac[0];
+    edgeCost[0] = 0;
+    for (int i = 0; i < ncd; i++)
+    {
+        const real binSize = (cellFrac[i + 1] - cellFrac[i]) / numBins;
+        for (int b = 0; b < numBins; b++)
+        {
+            const int e     = i * numBins + b;
+            edgeFrac[e + 1] = cellFrac[i] + (b + 1) * binSize;
+            edgeCost[e + 1] = edgeCost[e] + std::max(costProfile[e], 0.0F);
+        }
+    }
+    const real costTotal = edgeCost[ncd * numBins];
+    if (!(costTotal > 0))
+    {
+        return false;
+    }
+
+    /* Determine the boundaries that give equal cost per cell */
+    std::vector<real> targetFrac(ncd + 1);
+    targetFrac[0]   = cellFrac[0];
+    targetFrac[ncd] = cellFrac[ncd];
+    int e           = 0;
+    for (int i = 1; i < ncd; i++)
+    {
+        const real cost = costTotal * i / ncd;
+        while (e + 1 < ncd * numBins && edgeCost[e + 1] < cost)
+        {
+            e++;
+        }
+        const real binCost = edgeCost[e + 1] - edgeCost[e];
+        const real s       = (binCost > 0 ? (cost - edgeCost[e]) / binCost : 0);
+        targetFrac[i]      = edgeFrac[e] + s * (edgeFrac[e + 1] - edgeFrac[e]);
+    }
+
+    /* Limit the amount of scaling, using the same scaling for all cells */
+    real changeMax = 0;
+    for (int i = 0; i < ncd; i++)
+    {
+        const real size   = cellFrac[i + 1] - cellFrac[i];
+        const real change = (targetFrac[i + 1] - targetFrac[i]) / size - 1;
+        changeMax         = std::max(changeMax, std::abs(change));
+    }
+    real sc = relax;
+    if (sc * changeMax > changeLimit)
+    {
+        sc = changeLimit / changeMax;
+    }
+    for (int i = 0; i < ncd; i++)
+    {
+        const real size   = cellFrac[i + 1] - cellFrac[i];
+        const real change = (targetFrac[i + 1] - targetFrac[i]) / size - 1;
+        cellSize[i]       = size * (1 + sc * change);
+    }
+
+    return true;
+}
+
 static void set_dd_cell_sizes_dlb_root(gmx_domdec_t*      dd,
                                        int                d,
                                        int                dim,
@@ -587,9 +667,17 @@ static void set_dd_cell_sizes_dlb_root(gmx_domdec_t*      dd,
     {
         for (int i = 0; i < ncd; i++)
         {
-            cell_size[i] = 1.0 / ncd;
+            /* Start from the static cell sizes, when present */
+            cell_size[i] = (comm->slb_frac[dim] ? comm->slb_frac[dim][i] : 1.0 / ncd);
         }
     }
+    else if (dd_load_count(comm) > 0 && comm->ddSettings.useCostProfileDlb
+             && setCellSizesFromCostProfile(comm->load[d].costProfile, rowMaster->cellFrac, ncd,
+                                            c_relax, change_limit, cell_size))
+    {
+        /* The profiles are only valid for the current cell boundaries */
+        comm->load[d].costProfile.clear();
+    }
     else if (dd_load_count(comm) > 0)
     {
         real load_aver  = comm->load[d].sum_m / ncd;
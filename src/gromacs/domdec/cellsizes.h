@@ -73,6 +73,32 @@ real grid_jump_limit(const gmx_domdec_comm_t* comm, real cutoff, int dim_ind);
 gmx::ArrayRef<const std::vector<real>>
 set_dd_cell_sizes_slb(gmx_domdec_t* dd, const gmx_ddbox_t* ddbox, int setmode, ivec numPulses);
 
+/*! \brief Sets the cell sizes along a row using the measured cost profiles
+ *
+ * The cost is assumed to be uniform within each of the c_dlbCostProfileNumBins
+ * profile bins of each cell. The cell boundaries that divide the total cost
+ * equally over the cells are determined by inverting the cumulative cost.
+ * The cell sizes are moved towards these targets with underrelaxation factor
+ * \p relax, limited by \p changeLimit as for balancing based on the cell loads.
+ * Negative bin costs, which can occur when the flop counters have been reset,
+ * are treated as zero.
+ *
+ * \param[in]  costProfile  The cost profiles of the \p ncd cells in the row
+ * \param[in]  cellFrac     The \p ncd + 1 cell boundaries, box relative
+ * \param[in]  ncd          The number of cells in the row
+ * \param[in]  relax        The underrelaxation factor
+ * \param[in]  changeLimit  The maximum relative change of a cell size
+ * \param[out] cellSize     The \p ncd new cell sizes, box relative
+ * \returns false when the profiles have the wrong size or contain no cost,
+ *          \p cellSize is then unchanged
+ */
+bool setCellSizesFromCostProfile(gmx::ArrayRef<const float> costProfile,
+                                 gmx::ArrayRef<const real>  cellFrac,
+                                 int                        ncd,
+                                 real                       relax,
+                                 real                       changeLimit,
+                                 gmx::ArrayRef<real>        cellSize);
+
 /*! \brief General cell size adjustment, possibly applying dynamic load balancing */
 void set_dd_cell_sizes(gmx_domdec_t*      dd,
                        const gmx_ddbox_t* ddbox,
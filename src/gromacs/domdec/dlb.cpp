@@ -45,8 +45,15 @@
 
 #include "dlb.h"
 
+#include <algorithm>
+#include <array>
+#include <vector>
+
 #include "gromacs/domdec/domdec_struct.h"
 #include "gromacs/gmxlib/nrnb.h"
+#include "gromacs/mdtypes/forcerec.h"
+#include "gromacs/topology/ifunc.h"
+#include "gromacs/topology/topology.h"
 #include "gromacs/utility/gmxassert.h"
 
 #include "domdec_internal.h"
@@ -135,6 +142,187 @@ gmx_bool dd_dlb_get_should_check_whether_to_turn_dlb_on(gmx_domdec_t* dd)
     return dd->comm->n_load_have % c_checkTurnDlbOnInterval == c_checkTurnDlbOnInterval - 1;
 }
 
+namespace
+{
+
+//! The interaction types we measure the cost of for the DLB cost profiles
+enum class CostType : int
+{
+    NonBonded,
+    FreeEnergy,
+    Listed,
+    VirtualSite,
+    Count
+};
+
+//! Returns the cost type of flop counter \p enr, CostType::Count when not used for the profiles
+CostType costTypeOfFlopCounter(int enr)
+{
+    if (enr >= eNR_NBNXN_DIST2 && enr <= eNR_NBNXN_ADD_LJ_EWALD_E)
+    {
+        return CostType::NonBonded;
+    }
+    else if (enr == eNR_NBKERNEL_FREE_ENERGY)
+    {
+        return CostType::FreeEnergy;
+    }
+    else if (enr == eNR_NB14 || (enr >= eNR_BONDS && enr <= eNR_THOLE && enr != eNR_WALLS)
+             || (enr >= eNR_CMAP && enr <= eNR_CROSS_BOND_ANGLE))
+    {
+        return CostType::Listed;
+    }
+    else if (enr >= eNR_VSITE2 && enr <= eNR_VSITEN)
+    {
+        return CostType::VirtualSite;
+    }
+    else
+    {
+        return CostType::Count;
+    }
+}
+
+} // namespace
+
+void dd_compute_local_cost_profile(gmx_domdec_t*                  dd,
+                                   const gmx_localtop_t&          top,
+                                   gmx::ArrayRef<const int>       cginfo,
+                                   gmx::ArrayRef<const gmx::RVec> x,
+                                   const matrix                   box,
+                                   const t_nrnb&                  nrnb)
+{
+    gmx_domdec_comm_t* comm    = dd->comm;
+    constexpr int      numBins = c_dlbCostProfileNumBins;
+    constexpr int      nType   = static_cast<int>(CostType::Count);
+
+    /* Determine the work per interaction type since the previous call */
+    std::array<double, nType> work = {};
+    for (int enr = 0; enr < eNRNB; enr++)
+    {
+        const CostType type = costTypeOfFlopCounter(enr);
+        if (type != CostType::Count)
+        {
+            double delta = nrnb.n[enr] - comm->nrnbAtPreviousCostProfile.n[enr];
+            if (delta < 0)
+            {
+                /* The counters have been reset, e.g. with -resetstep */
+                delta = nrnb.n[enr];
+            }
+            work[static_cast<int>(type)] += delta * cost_nrnb(enr);
+        }
+    }
+    comm->nrnbAtPreviousCostProfile = nrnb;
+
+    /* Count the interactions of each type in our domain */
+    const int              numHomeAtoms = comm->atomRanges.numHomeAtoms();
+    std::array<int, nType> count        = {};
+    count[static_cast<int>(CostType::NonBonded)] = numHomeAtoms;
+    for (int a = 0; a < numHomeAtoms; a++)
+    {
+        if (GET_CGINFO_FEP(cginfo[a]))
+        {
+            count[static_cast<int>(CostType::FreeEnergy)]++;
+        }
+    }
+    for (int ftype = 0; ftype < F_NRE; ftype++)
+    {
+        const int numInteractions = top.idef.il[ftype].size() / (1 + NRAL(ftype));
+        if (interaction_function[ftype].flags & IF_VSITE)
+        {
+            count[static_cast<int>(CostType::VirtualSite)] += numInteractions;
+        }
+        else if ((interaction_function[ftype].flags & IF_BOND) && ftype != F_CONNBONDS)
+        {
+            count[static_cast<int>(CostType::Listed)] += numInteractions;
+        }
+    }
+
+    /* The cost per interaction of each type */
+    std::array<float, nType> weight = {};
+    double                   workTotal = 0;
+    for (int t = 0; t < nType; t++)
+    {
+        if (count[t] > 0)
+        {
+            weight[t] = work[t] / count[t];
+            workTotal += work[t];
+        }
+    }
+    if (workTotal <= 0)
+    {
+        /* Nothing has been counted, e.g. with non-bondeds on a GPU
+         * and no listed interactions, we balance the home atoms.
+         */
+        weight[static_cast<int>(CostType::NonBonded)] = 1;
+    }
+
+    matrix tcm;
+    make_tric_corr_matrix(dd->unitCellInfo.npbcdim, box, tcm);
+
+    std::vector<float>& profile = comm->costProfileLocal;
+    profile.assign(dd->ndim * numBins, 0);
+
+    /* Adds cost c at the location of local atom a to the profile */
+    auto addCost = [&](int a, float c) {
+        for (int d = 0; d < dd->ndim; d++)
+        {
+            const int dim   = dd->dim[d];
+            /* Determine the location in lattice coordinates */
+            real pos_d = x[a][dim];
+            for (int d2 = dim + 1; d2 < DIM; d2++)
+            {
+                pos_d += x[a][d2] * tcm[d2][dim];
+            }
+            const real cellSize = comm->cell_x1[dim] - comm->cell_x0[dim];
+            int        bin = static_cast<int>((pos_d - comm->cell_x0[dim]) * numBins / cellSize);
+            bin            = std::min(std::max(bin, 0), numBins - 1);
+            profile[d * numBins + bin] += c;
+        }
+    };
+
+    for (int a = 0; a < numHomeAtoms; a++)
+    {
+        float c = weight[static_cast<int>(CostType::NonBonded)];
+        if (GET_CGINFO_FEP(cginfo[a]))
+        {
+            c += weight[static_cast<int>(CostType::FreeEnergy)];
+        }
+        addCost(a, c);
+    }
+    for (int ftype = 0; ftype < F_NRE; ftype++)
+    {
+        float c;
+        if (interaction_function[ftype].flags & IF_VSITE)
+        {
+            c = weight[static_cast<int>(CostType::VirtualSite)];
+        }
+        else if ((interaction_function[ftype].flags & IF_BOND) && ftype != F_CONNBONDS)
+        {
+            c = weight[static_cast<int>(CostType::Listed)];
+        }
+        else
+        {
+            continue;
+        }
+        const t_ilist& il = top.idef.il[ftype];
+        for (int i = 0; i < il.size(); i += 1 + NRAL(ftype))
+        {
+            /* For virtual sites the first atom is the constructed site */
+            addCost(il.iatoms[i + 1], c);
+        }
+    }
+
+    /* Normalize, the total is equal for all dimensions */
+    float sum = 0;
+    for (int b = 0; b < numBins; b++)
+    {
+        sum += profile[b];
+    }
+    for (float& c : profile)
+    {
+        c = (sum > 0 ? c / sum : 1.0F / numBins);
+    }
+}
+
 gmx_bool dd_dlb_is_on(const gmx_domdec_t* dd)
 {
     return isDlbOn(dd->comm);
@@ -45,10 +45,14 @@
 #ifndef GMX_DOMDEC_DLB_H
 #define GMX_DOMDEC_DLB_H
 
+#include "gromacs/math/vectypes.h"
+#include "gromacs/utility/arrayref.h"
 #include "gromacs/utility/real.h"
 
 struct gmx_domdec_t;
+struct gmx_localtop_t;
 struct t_commrec;
+struct t_nrnb;
 
 
 /*! \brief We check if to turn on DLB at the first and every 100 DD partitionings.
@@ -100,6 +104,32 @@ void dd_dlb_set_should_check_whether_to_turn_dlb_on(gmx_domdec_t* dd, bool bValu
  */
 bool dd_dlb_get_should_check_whether_to_turn_dlb_on(gmx_domdec_t* dd);
 
+/*! \brief Computes the cost profile of our domain along each DD dimension
+ *
+ * The work per interaction type, i.e. non-bonded, free-energy, listed
+ * and virtual-site, is taken from the flop counts since the previous call
+ * and is divided equally over the interactions of that type in our domain.
+ * Non-bonded and free-energy work is assigned to home atoms and perturbed
+ * home atoms, respectively, listed work to the first atom of each listed
+ * interaction and virtual-site work to the virtual sites.
+ * The work is binned along each DD dimension with c_dlbCostProfileNumBins
+ * bins over our cell. The profile along each dimension is normalized to 1,
+ * it is scaled with the measured load when the loads are communicated.
+ *
+ * \param[in,out] dd      The domain decomposition struct, the profile is stored here
+ * \param[in]     top     The local topology
+ * \param[in]     cginfo  The atom information flags of the local atoms
+ * \param[in]     x       The local coordinates
+ * \param[in]     box     The unit cell
+ * \param[in]     nrnb    The flop counters
+ */
+void dd_compute_local_cost_profile(gmx_domdec_t*                  dd,
+                                   const gmx_localtop_t&          top,
+                                   gmx::ArrayRef<const int>       cginfo,
+                                   gmx::ArrayRef<const gmx::RVec> x,
+                                   const matrix                   box,
+                                   const t_nrnb&                  nrnb);
+
 /*! \brief Return if we are currently using dynamic load balancing */
 bool dd_dlb_is_on(const gmx_domdec_t* dd);
 
@@ -129,23 +129,6 @@ static const char* edlbs_names[int(DlbState::nr)] = { "off", "off", "auto", "loc
 #define DD_FLAG_FW(d) (1 << (16 + (d)*2))
 #define DD_FLAG_BW(d) (1 << (16 + (d)*2 + 1))
 
-/* The DD zone order */
-static const ivec dd_zo[DD_MAXZONE] = { { 0, 0, 0 }, { 1, 0, 0 }, { 1, 1, 0 }, { 0, 1, 0 },
-                                        { 0, 1, 1 }, { 0, 0, 1 }, { 1, 0, 1 }, { 1, 1, 1 } };
-
-/* The non-bonded zone-pair setup for domain decomposition
- * The first number is the i-zone, the second number the first j-zone seen by
- * this i-zone, the third number the last+1 j-zone seen by this i-zone.
- * As is, this is for 3D decomposition, where there are 4 i-zones.
- * With 2D decomposition use only the first 2 i-zones and a last+1 j-zone of 4.
- * With 1D decomposition use only the first i-zone and a last+1 j-zone of 2.
- */
-static const int ddNonbondedZonePairRanges[DD_MAXIZONE][3] = { { 0, 0, 8 },
-                                                               { 1, 3, 6 },
-                                                               { 2, 5, 6 },
-                                                               { 3, 5, 7 } };
-
-
 /*
    #define dd_index(n,i) ((((i)[ZZ]*(n)[YY] + (i)[YY])*(n)[XX]) + (i)[XX])
 
@@ -269,6 +252,93 @@ void dd_get_constraint_range(const gmx_domdec_t* dd, int* at_start, int* at_end)
     *at_end   = dd->comm->atomRanges.end(DDAtomRanges::Type::Constraints);
 }
 
+/*! \brief Copies the coordinates to send in pulse \p ind along DD dimension index \p d
+ * to \p sendBuffer, applying the periodic shift when needed
+ *
+ * The eighth-shell pulses send in direction \p dddirBackward, only the lower
+ * tower zone with the neutral-territory scheme is sent in \p dddirForward.
+ */
+static void packHaloCoordinates(const gmx_domdec_t&            dd,
+                                int                            d,
+                                int                            direction,
+                                const matrix                   box,
+                                const gmx_domdec_ind_t&        ind,
+                                gmx::ArrayRef<const gmx::RVec> x,
+                                gmx::ArrayRef<gmx::RVec>       sendBuffer)
+{
+    const int  dim    = dd.dim[d];
+    const bool bPBC   = (direction == dddirBackward ? dd.ci[dim] == 0 : dd.ci[dim] == dd.nc[dim] - 1);
+    const bool bScrew = (bPBC && dd.unitCellInfo.haveScrewPBC && dim == XX);
+    rvec       shift  = { 0, 0, 0 };
+    if (bPBC)
+    {
+        if (direction == dddirBackward)
+        {
+            copy_rvec(box[dim], shift);
+        }
+        else
+        {
+            GMX_ASSERT(!bScrew, "Screw pbc is only supported for backward communication");
+            svmul(-1, box[dim], shift);
+        }
+    }
+
+    int n = 0;
+    if (!bPBC)
+    {
+        for (int j : ind.index)
+        {
+            sendBuffer[n] = x[j];
+            n++;
+        }
+    }
+    else if (!bScrew)
+    {
+        for (int j : ind.index)
+        {
+            /* We need to shift the coordinates */
+            for (int d = 0; d < DIM; d++)
+            {
+                sendBuffer[n][d] = x[j][d] + shift[d];
+            }
+            n++;
+        }
+    }
+    else
+    {
+        for (int j : ind.index)
+        {
+            /* Shift x */
+            sendBuffer[n][XX] = x[j][XX] + shift[XX];
+            /* Rotate y and z.
+             * This operation requires a special shift force
+             * treatment, which is performed in calc_vir.
+             */
+            sendBuffer[n][YY] = box[YY][YY] - x[j][YY];
+            sendBuffer[n][ZZ] = box[ZZ][ZZ] - x[j][ZZ];
+            n++;
+        }
+    }
+}
+
+/*! \brief Copies the coordinates received in pulse \p ind from \p receiveBuffer to
+ * the zones of the \p nzone sending zones in \p x, for the not in-place case
+ */
+static void unpackHaloCoordinates(const gmx_domdec_ind_t&        ind,
+                                  int                            nzone,
+                                  gmx::ArrayRef<const gmx::RVec> receiveBuffer,
+                                  gmx::ArrayRef<gmx::RVec>       x)
+{
+    int j = 0;
+    for (int zone = 0; zone < nzone; zone++)
+    {
+        for (int i = ind.cell2at0[zone]; i < ind.cell2at1[zone]; i++)
+        {
+            x[i] = receiveBuffer[j++];
+        }
+    }
+}
+
 void dd_move_x(gmx_domdec_t* dd, const matrix box, gmx::ArrayRef<gmx::RVec> x, gmx_wallcycle* wcycle)
 {
     wallcycle_start(wcycle, ewcMOVEX);
@@ -276,8 +346,6 @@ void dd_move_x(gmx_domdec_t* dd, const matrix box, gmx::ArrayRef<gmx::RVec> x, g
     int                    nzone, nat_tot;
     gmx_domdec_comm_t*     comm;
     gmx_domdec_comm_dim_t* cd;
-    rvec                   shift = { 0, 0, 0 };
-    gmx_bool               bPBC, bScrew;
 
     comm = dd->comm;
 
@@ -285,53 +353,12 @@ void dd_move_x(gmx_domdec_t* dd, const matrix box, gmx::ArrayRef<gmx::RVec> x, g
     nat_tot = comm->atomRanges.numHomeAtoms();
     for (int d = 0; d < dd->ndim; d++)
     {
-        bPBC   = (dd->ci[dd->dim[d]] == 0);
-        bScrew = (bPBC && dd->unitCellInfo.haveScrewPBC && dd->dim[d] == XX);
-        if (bPBC)
-        {
-            copy_rvec(box[dd->dim[d]], shift);
-        }
         cd = &comm->cd[d];
         for (const gmx_domdec_ind_t& ind : cd->ind)
         {
             DDBufferAccess<gmx::RVec> sendBufferAccess(comm->rvecBuffer, ind.nsend[nzone + 1]);
             gmx::ArrayRef<gmx::RVec>& sendBuffer = sendBufferAccess.buffer;
-            int                       n          = 0;
-            if (!bPBC)
-            {
-                for (int j : ind.index)
-                {
-                    sendBuffer[n] = x[j];
-                    n++;
-                }
-            }
-            else if (!bScrew)
-            {
-                for (int j : ind.index)
-                {
-                    /* We need to shift the coordinates */
-                    for (int d = 0; d < DIM; d++)
-                    {
-                        sendBuffer[n][d] = x[j][d] + shift[d];
-                    }
-                    n++;
-                }
-            }
-            else
-            {
-                for (int j : ind.index)
-                {
-                    /* Shift x */
-                    sendBuffer[n][XX] = x[j][XX] + shift[XX];
-                    /* Rotate y and z.
-                     * This operation requires a special shift force
-                     * treatment, which is performed in calc_vir.
-                     */
-                    sendBuffer[n][YY] = box[YY][YY] - x[j][YY];
-                    sendBuffer[n][ZZ] = box[ZZ][ZZ] - x[j][ZZ];
-                    n++;
-                }
-            }
+            packHaloCoordinates(*dd, d, dddirBackward, box, ind, x, sendBuffer);
 
             DDBufferAccess<gmx::RVec> receiveBufferAccess(
                     comm->rvecBuffer2, cd->receiveInPlace ? 0 : ind.nrecv[nzone + 1]);
@@ -350,20 +377,181 @@ void dd_move_x(gmx_domdec_t* dd, const matrix box, gmx::ArrayRef<gmx::RVec> x, g
 
             if (!cd->receiveInPlace)
             {
-                int j = 0;
-                for (int zone = 0; zone < nzone; zone++)
-                {
-                    for (int i = ind.cell2at0[zone]; i < ind.cell2at1[zone]; i++)
-                    {
-                        x[i] = receiveBuffer[j++];
-                    }
-                }
+                unpackHaloCoordinates(ind, nzone, receiveBuffer, x);
             }
             nat_tot += ind.nrecv[nzone + 1];
         }
         nzone += nzone;
     }
 
+    if (comm->useNeutralTerritory)
+    {
+        /* Import the lower tower zone, this only involves the home zone
+         * and atoms received in earlier pulses, always in place.
+         */
+        for (const gmx_domdec_ind_t& ind : comm->cdLowerTower.ind)
+        {
+            DDBufferAccess<gmx::RVec> sendBufferAccess(comm->rvecBuffer, ind.nsend[2]);
+            gmx::ArrayRef<gmx::RVec>& sendBuffer = sendBufferAccess.buffer;
+            packHaloCoordinates(*dd, 1, dddirForward, box, ind, x, sendBuffer);
+
+            ddSendrecv(dd, 1, dddirForward, sendBuffer,
+                       gmx::arrayRefFromArray(x.data() + nat_tot, ind.nrecv[2]));
+            nat_tot += ind.nrecv[2];
+        }
+    }
+
+    wallcycle_stop(wcycle, ewcMOVEX);
+}
+
+/*! \brief Packs and starts sending the coordinates of \p pulse */
+static void startHaloXSend(gmx_domdec_t*                  dd,
+                           const matrix                   box,
+                           gmx::ArrayRef<const gmx::RVec> x,
+                           DDHaloXExchange::Pulse*        pulse)
+{
+    DDHaloXExchange&         exchange   = dd->comm->haloXExchange;
+    const gmx_domdec_ind_t&  ind        = dd->comm->cd[pulse->dimIndex].ind[pulse->pulseIndex];
+    gmx::ArrayRef<gmx::RVec> sendBuffer = gmx::arrayRefFromArray(
+            exchange.sendBuffer.data() + pulse->sendOffset, pulse->numAtomsToSend);
+
+    packHaloCoordinates(*dd, pulse->dimIndex, dddirBackward, box, ind, x, sendBuffer);
+    if (pulse->numAtomsToSend > 0)
+    {
+        const int tag = pulse - exchange.pulses.data();
+        ddIsend(dd, pulse->dimIndex, dddirBackward, sendBuffer, tag, &pulse->sendRequest);
+    }
+}
+
+void dd_move_x_start(gmx_domdec_t* dd, const matrix box, gmx::ArrayRef<gmx::RVec> x, gmx_wallcycle* wcycle)
+{
+    if (dd->comm->ddSettings.useSendRecv2 || dd->comm->useNeutralTerritory)
+    {
+        /* The user requested MPI_Sendrecv or we need to import the lower tower zone,
+         * we communicate in dd_move_x_finish()
+         */
+        return;
+    }
+
+    wallcycle_start(wcycle, ewcMOVEX);
+
+    gmx_domdec_comm_t& comm     = *dd->comm;
+    DDHaloXExchange&   exchange = comm.haloXExchange;
+
+    GMX_RELEASE_ASSERT(!exchange.isInProgress, "Can only have one halo exchange in flight");
+
+    /* Set up the buffer offsets for all pulses */
+    exchange.pulses.clear();
+    int nzone         = 1;
+    int nat_tot       = comm.atomRanges.numHomeAtoms();
+    int sendOffset    = 0;
+    int receiveOffset = 0;
+    for (int d = 0; d < dd->ndim; d++)
+    {
+        const gmx_domdec_comm_dim_t& cd = comm.cd[d];
+        for (int p = 0; p < cd.numPulses(); p++)
+        {
+            const gmx_domdec_ind_t& ind = cd.ind[p];
+
+            DDHaloXExchange::Pulse pulse;
+            pulse.dimIndex          = d;
+            pulse.pulseIndex        = p;
+            pulse.numZones          = nzone;
+            pulse.numAtomsToSend    = ind.nsend[nzone + 1];
+            pulse.numAtomsToReceive = ind.nrecv[nzone + 1];
+            pulse.atomOffset        = nat_tot;
+            pulse.sendOffset        = sendOffset;
+            pulse.receiveOffset     = receiveOffset;
+            exchange.pulses.push_back(pulse);
+
+            sendOffset += pulse.numAtomsToSend;
+            if (!cd.receiveInPlace)
+            {
+                receiveOffset += pulse.numAtomsToReceive;
+            }
+            nat_tot += pulse.numAtomsToReceive;
+        }
+        nzone += nzone;
+    }
+    exchange.sendBuffer.resize(sendOffset);
+    exchange.receiveBuffer.resize(receiveOffset);
+
+    /* Post all receives, so no data needs to be buffered by MPI */
+    for (size_t p = 0; p < exchange.pulses.size(); p++)
+    {
+        DDHaloXExchange::Pulse& pulse = exchange.pulses[p];
+        if (pulse.numAtomsToReceive > 0)
+        {
+            gmx::RVec* receiveBuffer =
+                    (comm.cd[pulse.dimIndex].receiveInPlace
+                             ? x.data() + pulse.atomOffset
+                             : exchange.receiveBuffer.data() + pulse.receiveOffset);
+            ddIrecv(dd, pulse.dimIndex, dddirBackward,
+                    gmx::arrayRefFromArray(receiveBuffer, pulse.numAtomsToReceive), p,
+                    &pulse.receiveRequest);
+        }
+    }
+
+    /* The first pulse only sends home atoms, so we can send it now */
+    if (!exchange.pulses.empty())
+    {
+        startHaloXSend(dd, box, x, &exchange.pulses[0]);
+    }
+
+    exchange.isInProgress = true;
+
+    wallcycle_stop(wcycle, ewcMOVEX);
+}
+
+void dd_move_x_finish(gmx_domdec_t* dd, const matrix box, gmx::ArrayRef<gmx::RVec> x, gmx_wallcycle* wcycle)
+{
+    gmx_domdec_comm_t& comm     = *dd->comm;
+    DDHaloXExchange&   exchange = comm.haloXExchange;
+
+    if (comm.ddSettings.useSendRecv2 || comm.useNeutralTerritory)
+    {
+        dd_move_x(dd, box, x, wcycle);
+        return;
+    }
+
+    GMX_RELEASE_ASSERT(exchange.isInProgress, "dd_move_x_start() should be called first");
+
+    wallcycle_start_nocount(wcycle, ewcMOVEX);
+
+    for (size_t p = 0; p < exchange.pulses.size(); p++)
+    {
+        DDHaloXExchange::Pulse&      pulse = exchange.pulses[p];
+        const gmx_domdec_comm_dim_t& cd    = comm.cd[pulse.dimIndex];
+
+        if (pulse.numAtomsToReceive > 0)
+        {
+            ddWait(&pulse.receiveRequest);
+        }
+        if (!cd.receiveInPlace)
+        {
+            const gmx::RVec* receiveBuffer = exchange.receiveBuffer.data() + pulse.receiveOffset;
+            unpackHaloCoordinates(cd.ind[pulse.pulseIndex], pulse.numZones,
+                                  gmx::constArrayRefFromArray(receiveBuffer, pulse.numAtomsToReceive),
+                                  x);
+        }
+
+        /* Now all coordinates the next pulse depends on are present */
+        if (p + 1 < exchange.pulses.size())
+        {
+            startHaloXSend(dd, box, x, &exchange.pulses[p + 1]);
+        }
+    }
+
+    for (DDHaloXExchange::Pulse& pulse : exchange.pulses)
+    {
+        if (pulse.numAtomsToSend > 0)
+        {
+            ddWait(&pulse.sendRequest);
+        }
+    }
+
+    exchange.isInProgress = false;
+
     wallcycle_stop(wcycle, ewcMOVEX);
 }
 
@@ -375,8 +563,42 @@ void dd_move_f(gmx_domdec_t* dd, gmx::ForceWithShiftForces* forceWithShiftForces
     gmx::ArrayRef<gmx::RVec> fshift = forceWithShiftForces->shiftForces();
 
     gmx_domdec_comm_t& comm    = *dd->comm;
-    int                nzone   = comm.zones.n / 2;
+    int                nzone   = (1 << dd->ndim) / 2;
     int                nat_tot = comm.atomRanges.end(DDAtomRanges::Type::Zones);
+
+    if (comm.useNeutralTerritory)
+    {
+        /* Return the forces on the lower tower zone, which was imported last */
+        const int  dim                = dd->dim[1];
+        const bool shiftForcesNeedPbc = (forceWithShiftForces->computeVirial()
+                                         && dd->ci[dim] == dd->nc[dim] - 1);
+        ivec       vis                = { 0, 0, 0 };
+        vis[dim]                      = -1;
+        const int is                  = IVEC2IS(vis);
+
+        const gmx_domdec_comm_dim_t& cd = comm.cdLowerTower;
+        for (int p = cd.numPulses() - 1; p >= 0; p--)
+        {
+            const gmx_domdec_ind_t&   ind = cd.ind[p];
+            DDBufferAccess<gmx::RVec> receiveBufferAccess(comm.rvecBuffer, ind.nsend[2]);
+            gmx::ArrayRef<gmx::RVec>& receiveBuffer = receiveBufferAccess.buffer;
+
+            nat_tot -= ind.nrecv[2];
+            ddSendrecv(dd, 1, dddirBackward, gmx::arrayRefFromArray(f.data() + nat_tot, ind.nrecv[2]),
+                       receiveBuffer);
+            int n = 0;
+            for (int j : ind.index)
+            {
+                rvec_inc(f[j], receiveBuffer[n]);
+                if (shiftForcesNeedPbc)
+                {
+                    rvec_inc(fshift[is], receiveBuffer[n]);
+                }
+                n++;
+            }
+        }
+    }
+
     for (int d = dd->ndim - 1; d >= 0; d--)
     {
         /* Only forces in domains near the PBC boundaries need to
@@ -544,6 +766,23 @@ void dd_atom_spread_real(gmx_domdec_t* dd, real v[])
         }
         nzone += nzone;
     }
+
+    if (comm->useNeutralTerritory)
+    {
+        for (const gmx_domdec_ind_t& ind : comm->cdLowerTower.ind)
+        {
+            DDBufferAccess<gmx::RVec> sendBufferAccess(comm->rvecBuffer, ind.nsend[2]);
+            gmx::ArrayRef<real> sendBuffer = realArrayRefFromRvecArrayRef(sendBufferAccess.buffer);
+            int                 n          = 0;
+            for (int j : ind.index)
+            {
+                sendBuffer[n++] = v[j];
+            }
+            ddSendrecv(dd, 1, dddirForward, sendBuffer,
+                       gmx::arrayRefFromArray(v + nat_tot, ind.nrecv[2]));
+            nat_tot += ind.nrecv[2];
+        }
+    }
 }
 
 void dd_atom_sum_real(gmx_domdec_t* dd, real v[])
@@ -554,8 +793,27 @@ void dd_atom_sum_real(gmx_domdec_t* dd, real v[])
 
     comm = dd->comm;
 
-    nzone   = comm->zones.n / 2;
+    nzone   = (1 << dd->ndim) / 2;
     nat_tot = comm->atomRanges.end(DDAtomRanges::Type::Zones);
+    if (comm->useNeutralTerritory)
+    {
+        for (int p = comm->cdLowerTower.numPulses() - 1; p >= 0; p--)
+        {
+            const gmx_domdec_ind_t& ind = comm->cdLowerTower.ind[p];
+
+            DDBufferAccess<gmx::RVec> receiveBufferAccess(comm->rvecBuffer, ind.nsend[2]);
+            gmx::ArrayRef<real> receiveBuffer = realArrayRefFromRvecArrayRef(receiveBufferAccess.buffer);
+            nat_tot -= ind.nrecv[2];
+            ddSendrecv(dd, 1, dddirBackward, gmx::arrayRefFromArray(v + nat_tot, ind.nrecv[2]),
+                       receiveBuffer);
+            int n = 0;
+            for (int j : ind.index)
+            {
+                v[j] += receiveBuffer[n];
+                n++;
+            }
+        }
+    }
     for (int d = dd->ndim - 1; d >= 0; d--)
     {
         cd = &comm->cd[d];
@@ -1245,8 +1503,16 @@ static void setup_neighbor_relations(gmx_domdec_t* dd)
         }
     }
 
+    const bool useNeutralTerritory = dd->comm->useNeutralTerritory;
+
     int nzone  = (1 << dd->ndim);
     int nizone = (1 << std::max(dd->ndim - 1, 0));
+    if (useNeutralTerritory)
+    {
+        GMX_RELEASE_ASSERT(dd->ndim == 2, "Neutral territory is only supported with 2D DD");
+        nzone  = c_lowerTowerZone + 1;
+        nizone = DD_MAXIZONE;
+    }
     assert(nizone >= 1 && nizone <= DD_MAXIZONE);
 
     zones = &dd->comm->zones;
@@ -1257,7 +1523,14 @@ static void setup_neighbor_relations(gmx_domdec_t* dd)
         clear_ivec(zones->shift[i]);
         for (d = 0; d < dd->ndim; d++)
         {
-            zones->shift[i][dd->dim[d]] = dd_zo[i][m++];
+            if (useNeutralTerritory)
+            {
+                zones->shift[i][dd->dim[d]] = ddNeutralTerritoryZoneShifts[i][m++];
+            }
+            else
+            {
+                zones->shift[i][dd->dim[d]] = dd_zo[i][m++];
+            }
         }
     }
 
@@ -1277,10 +1550,12 @@ static void setup_neighbor_relations(gmx_domdec_t* dd)
             }
         }
     }
+    const int(*zonePairRanges)[3] =
+            (useNeutralTerritory ? ddNeutralTerritoryZonePairRanges : ddNonbondedZonePairRanges);
     for (int iZoneIndex = 0; iZoneIndex < nizone; iZoneIndex++)
     {
         GMX_RELEASE_ASSERT(
-                ddNonbondedZonePairRanges[iZoneIndex][0] == iZoneIndex,
+                zonePairRanges[iZoneIndex][0] == iZoneIndex,
                 "The first element for each ddNonbondedZonePairRanges should match its index");
 
         DDPairInteractionRanges iZone;
@@ -1288,8 +1563,8 @@ static void setup_neighbor_relations(gmx_domdec_t* dd)
         /* dd_zp3 is for 3D decomposition, for fewer dimensions use only
          * j-zones up to nzone.
          */
-        iZone.jZoneRange = gmx::Range<int>(std::min(ddNonbondedZonePairRanges[iZoneIndex][1], nzone),
-                                           std::min(ddNonbondedZonePairRanges[iZoneIndex][2], nzone));
+        iZone.jZoneRange = gmx::Range<int>(std::min(zonePairRanges[iZoneIndex][1], nzone),
+                                           std::min(zonePairRanges[iZoneIndex][2], nzone));
         for (dim = 0; dim < DIM; dim++)
         {
             if (dd->nc[dim] == 1)
@@ -2449,6 +2724,54 @@ static void set_dd_limits(const gmx::MDLogger& mdlog,
 
     dd->nnodes = dd->nc[XX] * dd->nc[YY] * dd->nc[ZZ];
 
+    comm->useNeutralTerritory = false;
+    if (ddSettings.requestNeutralTerritory)
+    {
+        std::string reasonNotUsed;
+        if (dd->ndim != 2)
+        {
+            reasonNotUsed = "it requires domain decomposition along exactly two dimensions";
+        }
+        else if (ddbox.tric_dir[dd->dim[0]] || ddbox.tric_dir[dd->dim[1]])
+        {
+            reasonNotUsed = "it does not support triclinic decomposition dimensions";
+        }
+        else if (dd->nc[dd->dim[1]] < 3)
+        {
+            reasonNotUsed = "it requires at least 3 domains along the tower dimension";
+        }
+        else if (systemInfo.filterBondedCommunication)
+        {
+            reasonNotUsed = "bonded interactions are longer than the non-bonded cut-off";
+        }
+
+        if (reasonNotUsed.empty())
+        {
+            comm->useNeutralTerritory = true;
+            GMX_LOG(mdlog.info)
+                    .appendTextFormatted(
+                            "Using the neutral-territory zone scheme with the tower along %c "
+                            "and the plate along %c",
+                            dim2char(dd->dim[1]), dim2char(dd->dim[0]));
+            GMX_LOG(mdlog.warning)
+                    .appendText(
+                            "NOTE: With the neutral-territory zone scheme the coordinate halo "
+                            "exchange is blocking and is not overlapped with the local "
+                            "non-bonded work");
+        }
+        else
+        {
+            GMX_LOG(mdlog.warning)
+                    .appendTextFormatted(
+                            "NOTE: Not using the neutral-territory zone scheme, as %s, "
+                            "using the eighth-shell zone scheme%s",
+                            reasonNotUsed.c_str(),
+                            comm->dlbState == DlbState::offForever
+                                    ? ", dynamic load balancing remains disabled"
+                                    : "");
+        }
+    }
+
     snew(comm->slb_frac, DIM);
     if (isDlbDisabled(comm))
     {
@@ -2456,6 +2779,18 @@ static void set_dd_limits(const gmx::MDLogger& mdlog,
         comm->slb_frac[YY] = get_slb_frac(mdlog, "y", dd->nc[YY], options.cellSizeY);
         comm->slb_frac[ZZ] = get_slb_frac(mdlog, "z", dd->nc[ZZ], options.cellSizeZ);
     }
+    for (int dim = 0; dim < DIM; dim++)
+    {
+        /* Use the cell sizes from the atom quantiles when no sizes were given by the user.
+         * With DLB these are also used as the starting point.
+         */
+        const std::vector<real>& relativeCellSizes = ddGridSetup.relativeCellSizes[dim];
+        if (comm->slb_frac[dim] == nullptr && !relativeCellSizes.empty())
+        {
+            snew(comm->slb_frac[dim], dd->nc[dim]);
+            std::copy(relativeCellSizes.begin(), relativeCellSizes.end(), comm->slb_frac[dim]);
+        }
+    }
 
     /* Set the multi-body cut-off and cellsize limit for DLB */
     comm->cutoff_mbody   = systemInfo.minCutoffForMultiBody;
@@ -2652,7 +2987,8 @@ static void writeSettings(gmx::TextWriter*   log,
                                     std::max(comm->systemInfo.cutoff, comm->cutoff_mbody));
             log->writeLineFormatted("%40s  %-7s %6.3f nm", "multi-body bonded interactions",
                                     "(-rdd)",
-                                    (comm->systemInfo.filterBondedCommunication || isDlbOn(dd->comm))
+                                    (comm->systemInfo.filterBondedCommunication || isDlbOn(dd->comm)
+                                     || comm->useNeutralTerritory)
                                             ? comm->cutoff_mbody
                                             : std::min(comm->systemInfo.cutoff, limit));
         }
@@ -2888,8 +3224,11 @@ static DDSettings getDDSettings(const gmx::MDLogger&     mdlog,
     ddSettings.dlb_scale_lim       = dd_getenv(mdlog, "GMX_DLB_MAX_BOX_SCALING", 10);
     ddSettings.request1DAnd1Pulse  = bool(dd_getenv(mdlog, "GMX_DD_1D_1PULSE", 0));
     ddSettings.useDDOrderZYX       = bool(dd_getenv(mdlog, "GMX_DD_ORDER_ZYX", 0));
+    ddSettings.requestNeutralTerritory = bool(dd_getenv(mdlog, "GMX_DD_NEUTRAL_TERRITORY", 0));
+    ddSettings.useAtomQuantileCellSizes = bool(dd_getenv(mdlog, "GMX_DD_BISECTION", 0));
     ddSettings.useCartesianReorder = bool(dd_getenv(mdlog, "GMX_NO_CART_REORDER", 1));
     ddSettings.eFlop               = dd_getenv(mdlog, "GMX_DLB_BASED_ON_FLOPS", 0);
+    ddSettings.useCostProfileDlb   = bool(dd_getenv(mdlog, "GMX_DLB_COST_PROFILE", 0));
     const int recload              = dd_getenv(mdlog, "GMX_DD_RECORD_LOAD", 1);
     ddSettings.nstDDDump           = dd_getenv(mdlog, "GMX_DD_NST_DUMP", 0);
     ddSettings.nstDDDumpGrid       = dd_getenv(mdlog, "GMX_DD_NST_DUMP_GRID", 0);
@@ -2901,7 +3240,7 @@ static DDSettings getDDSettings(const gmx::MDLogger&     mdlog,
                 .appendText(
                         "Will use two sequential MPI_Sendrecv calls instead of two simultaneous "
                         "non-blocking MPI_Irecv and MPI_Isend pairs for constraint and vsite "
-                        "communication");
+                        "communication, and a blocking coordinate halo exchange");
     }
 
     if (ddSettings.eFlop)
@@ -2916,9 +3255,23 @@ static DDSettings getDDSettings(const gmx::MDLogger&     mdlog,
 
     ddSettings.initialDlbState = determineInitialDlbState(mdlog, options.dlbOption,
                                                           ddSettings.recordLoad, mdrunOptions, &ir);
+    if (ddSettings.requestNeutralTerritory && !isDlbDisabled(ddSettings.initialDlbState))
+    {
+        /* The lower tower zone would need staggered cell boundaries */
+        ddSettings.initialDlbState = forceDlbOffOrBail(
+                ddSettings.initialDlbState,
+                "it is not supported with the neutral-territory zone scheme.", mdlog);
+    }
     GMX_LOG(mdlog.info)
             .appendTextFormatted("Dynamic load balancing: %s",
                                  edlbs_names[static_cast<int>(ddSettings.initialDlbState)]);
+    if (ddSettings.useCostProfileDlb && !isDlbDisabled(ddSettings.initialDlbState))
+    {
+        GMX_LOG(mdlog.info)
+                .appendText(
+                        "Dynamic load balancing will set the cell boundaries using measured "
+                        "cost profiles");
+    }
 
     return ddSettings;
 }
@@ -210,6 +210,18 @@ void dd_cycles_add(const gmx_domdec_t* dd, float cycles, int ddCycl);
 /*! \brief Communicate the coordinates to the neighboring cells and do pbc. */
 void dd_move_x(struct gmx_domdec_t* dd, const matrix box, gmx::ArrayRef<gmx::RVec> x, gmx_wallcycle* wcycle);
 
+/*! \brief Start communicating the coordinates to the neighboring cells, non-blocking
+ *
+ * Work on the home atoms can be done before calling dd_move_x_finish(),
+ * but the coordinates in \p x should not be changed. The non-local
+ * coordinates are only available after the call to dd_move_x_finish().
+ * Note that all PP ranks need to call both functions.
+ */
+void dd_move_x_start(struct gmx_domdec_t* dd, const matrix box, gmx::ArrayRef<gmx::RVec> x, gmx_wallcycle* wcycle);
+
+//! Complete the coordinate communication started with dd_move_x_start()
+void dd_move_x_finish(struct gmx_domdec_t* dd, const matrix box, gmx::ArrayRef<gmx::RVec> x, gmx_wallcycle* wcycle);
+
 /*! \brief Sum the forces over the neighboring cells.
  *
  * When fshift!=NULL the shift forces are updated to obtain
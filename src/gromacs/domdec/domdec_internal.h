@@ -47,9 +47,11 @@
 
 #include "gromacs/domdec/domdec.h"
 #include "gromacs/domdec/domdec_struct.h"
+#include "gromacs/gmxlib/nrnb.h"
 #include "gromacs/mdlib/updategroupscog.h"
 #include "gromacs/timing/cyclecounter.h"
 #include "gromacs/topology/block.h"
+#include "gromacs/utility/gmxmpi.h"
 
 struct t_commrec;
 
@@ -57,6 +59,9 @@ struct t_commrec;
 
 #define DD_NLOAD_MAX 9
 
+/*! \brief The number of bins per domain along each DD dimension for the DLB cost profiles */
+constexpr int c_dlbCostProfileNumBins = 8;
+
 struct BalanceRegion;
 
 //! Indices to communicate in a dimension
@@ -79,6 +84,50 @@ struct gmx_domdec_ind_t
     //! @}
 };
 
+/*! \brief Data for a non-blocking coordinate halo exchange
+ *
+ * All receives are posted at the start, as well as the send of the first
+ * pulse, which only involves home atoms. The sends of the later pulses
+ * depend on earlier received coordinates and are posted while completing
+ * the receives in order.
+ */
+struct DDHaloXExchange
+{
+    //! Communication data for one pulse in one dimension
+    struct Pulse
+    {
+        //! The DD dimension index
+        int dimIndex;
+        //! The pulse index within the dimension
+        int pulseIndex;
+        //! The number of zones sending data in this pulse
+        int numZones;
+        //! The number of atoms to send
+        int numAtomsToSend;
+        //! The number of atoms to receive
+        int numAtomsToReceive;
+        //! The index of the first atom received
+        int atomOffset;
+        //! The offset in the send buffer
+        int sendOffset;
+        //! The offset in the receive buffer, not used with in-place receiving
+        int receiveOffset;
+        //! The send request
+        MPI_Request sendRequest;
+        //! The receive request
+        MPI_Request receiveRequest;
+    };
+
+    //! Whether an exchange has been started and not completed yet
+    bool isInProgress = false;
+    //! The pulses over all dimensions in communication order
+    std::vector<Pulse> pulses;
+    //! The send buffer for all pulses
+    std::vector<gmx::RVec> sendBuffer;
+    //! The receive buffer for all pulses that do not receive in place
+    std::vector<gmx::RVec> receiveBuffer;
+};
+
 //! Things relating to index communication
 struct gmx_domdec_comm_dim_t
 {
@@ -164,6 +213,10 @@ typedef struct
     float pme = 0;
     /**< Bit flags that tell if DLB was limited, per dimension */
     int flags = 0;
+    /**< The cost profiles of the cells of the row along our dimension, only on the row master */
+    std::vector<float> costProfile;
+    /**< The cost profiles along the lower dimensions, summed over the row */
+    std::vector<float> costProfileSum;
 } domdec_load_t;
 
 /*! \brief Data needed to sort an atom to the desired location in the local state */
@@ -478,12 +531,21 @@ struct DDSettings
     //! Whether to order the DD dimensions from z to x
     bool useDDOrderZYX = false;
 
+    //! Request the neutral-territory zone scheme instead of the eighth-shell scheme
+    bool requestNeutralTerritory = false;
+
+    //! Whether to set the initial cell sizes per dimension to give equal atom counts per cell
+    bool useAtomQuantileCellSizes = false;
+
     //! Whether to use MPI Cartesian reordering of communicators, when supported (almost never)
     bool useCartesianReorder = true;
 
     //! Whether we should record the load
     bool recordLoad = false;
 
+    //! Whether DLB sets the cell boundaries using measured cost profiles
+    bool useCostProfileDlb = false;
+
     /* Debugging */
     //! Step interval for dumping the local+non-local atoms to pdb
     int nstDDDump = 0;
@@ -629,6 +691,10 @@ struct gmx_domdec_comm_t // NOLINT (clang-analyzer-optin.performance.Padding)
 
     /** The coordinate/force communication setup and indices */
     gmx_domdec_comm_dim_t cd[DIM];
+    /** Whether we use the neutral-territory zone scheme, only with 2D DD */
+    bool useNeutralTerritory = false;
+    /** With neutral territory, the communication setup for the lower tower zone along DD dim 1 */
+    gmx_domdec_comm_dim_t cdLowerTower;
     /** Restricts the maximum number of cells to communicate with in one dimension
      *
      * Dynamic load balancing is not permitted to change sizes if it
@@ -663,6 +729,9 @@ struct gmx_domdec_comm_t // NOLINT (clang-analyzer-optin.performance.Padding)
     /**< Another rvec comm. buffer */
     DDBuffer<gmx::RVec> rvecBuffer2;
 
+    /** Data for the non-blocking halo coordinate communication */
+    DDHaloXExchange haloXExchange;
+
     /* Communication buffers for local redistribution */
     /**< Charge group flag comm. buffers */
     std::array<std::vector<int>, DIM * 2> cggl_flag;
@@ -703,6 +772,12 @@ struct gmx_domdec_comm_t // NOLINT (clang-analyzer-optin.performance.Padding)
     /** How many times have we collected the load measurements */
     int n_load_collect = 0;
 
+    /* Cost profiles for DLB */
+    /**< The measured cost profile of our domain, c_dlbCostProfileNumBins per DD dimension */
+    std::vector<float> costProfileLocal;
+    /**< The flop counts at the previous cost profile computation */
+    t_nrnb nrnbAtPreviousCostProfile;
+
     /* Cycle count history for DLB checks */
     /**< The averaged cycles per step over the last nstlist step before turning on DLB */
     float cyclesPerStepBeforeDLB = 0;
@@ -747,6 +822,15 @@ struct gmx_domdec_comm_t // NOLINT (clang-analyzer-optin.performance.Padding)
  */
 static const int zone_perm[3][4] = { { 0, 0, 0, 0 }, { 1, 0, 0, 0 }, { 3, 0, 1, 2 } };
 
+/*! \brief The zone index of the lower tower zone with the neutral-territory scheme
+ *
+ * With the neutral-territory scheme for 2D decomposition the first four
+ * zones are the eighth-shell zones, the corner zone 2 is only used for
+ * multi-body bonded interactions. The extra zone, shifted by -1 along
+ * DD dimension 1, follows these.
+ */
+static constexpr int c_lowerTowerZone = 4;
+
 /*! \brief DD zone reordering to Cartesian order
  *
  * Index to reorder the zone such that the end up in Cartesian order
@@ -754,6 +838,49 @@ static const int zone_perm[3][4] = { { 0, 0, 0, 0 }, { 1, 0, 0, 0 }, { 3, 0, 1,
  */
 static const int zone_reorder_cartesian[DD_MAXZONE] = { 0, 1, 3, 2, 5, 4, 6, 7 };
 
+//! The DD zone order
+static const ivec dd_zo[DD_MAXZONE] = { { 0, 0, 0 }, { 1, 0, 0 }, { 1, 1, 0 }, { 0, 1, 0 },
+                                        { 0, 1, 1 }, { 0, 0, 1 }, { 1, 0, 1 }, { 1, 1, 1 } };
+
+/*! \brief The non-bonded zone-pair setup for domain decomposition
+ *
+ * The first number is the i-zone, the second number the first j-zone seen by
+ * this i-zone, the third number the last+1 j-zone seen by this i-zone.
+ * As is, this is for 3D decomposition, where there are 4 i-zones.
+ * With 2D decomposition use only the first 2 i-zones and a last+1 j-zone of 4.
+ * With 1D decomposition use only the first i-zone and a last+1 j-zone of 2.
+ */
+static const int ddNonbondedZonePairRanges[DD_MAXIZONE][3] = { { 0, 0, 8 },
+                                                               { 1, 3, 6 },
+                                                               { 2, 5, 6 },
+                                                               { 3, 5, 7 } };
+
+/*! \brief The DD zone shifts along DD dimensions 0 and 1 with the neutral-territory
+ * scheme
+ *
+ * The home zone with the lower and upper tower zones along dim 1
+ * form the tower, the home zone with zone 1 forms the plate along dim 0.
+ * Zone 2 is only used for multi-body bonded interactions.
+ */
+static const int ddNeutralTerritoryZoneShifts[c_lowerTowerZone + 1][2] = { { 0, 0 },
+                                                                           { 1, 0 },
+                                                                           { 1, 1 },
+                                                                           { 0, 1 },
+                                                                           { 0, -1 } };
+
+/*! \brief The non-bonded zone-pair setup with the neutral-territory scheme
+ *
+ * Same format as ddNonbondedZonePairRanges.
+ * We compute pairs of tower atoms with plate atoms only: the home zone
+ * with itself and with zone 1, the upper tower zone 3 with the home zone
+ * and zone 1 with the upper and lower tower zones 3 and 4.
+ * Zone 2 is an i-zone without j-zones.
+ */
+static const int ddNeutralTerritoryZonePairRanges[DD_MAXIZONE][3] = { { 0, 0, 2 },
+                                                                      { 1, 3, 5 },
+                                                                      { 2, 2, 2 },
+                                                                      { 3, 0, 1 } };
+
 /* dd_zo and dd_zp3 is set up such that i zones with non-zero
  * components see only j zones with that component 0.
  */
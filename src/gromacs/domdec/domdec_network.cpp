@@ -132,6 +132,44 @@ template void ddSendrecv(const gmx_domdec_t*, int, int, gmx::ArrayRef<real>, gmx
 //! Specialization of extern template for gmx::RVec
 template void ddSendrecv(const gmx_domdec_t*, int, int, gmx::ArrayRef<gmx::RVec>, gmx::ArrayRef<gmx::RVec>);
 
+void ddIsend(const gmx_domdec_t gmx_unused* dd,
+             int gmx_unused                 ddDimensionIndex,
+             int gmx_unused                 direction,
+             gmx::ArrayRef<const gmx::RVec> gmx_unused sendBuffer,
+             int gmx_unused                            tag,
+             MPI_Request gmx_unused* request)
+{
+#if GMX_MPI
+    int sendRank = dd->neighbor[ddDimensionIndex][direction == dddirForward ? 0 : 1];
+
+    /* Some MPI implementions don't specify const */
+    MPI_Isend(const_cast<gmx::RVec*>(sendBuffer.data()), sendBuffer.size() * sizeof(gmx::RVec),
+              MPI_BYTE, sendRank, tag, dd->mpi_comm_all, request);
+#endif
+}
+
+void ddIrecv(const gmx_domdec_t gmx_unused* dd,
+             int gmx_unused           ddDimensionIndex,
+             int gmx_unused           direction,
+             gmx::ArrayRef<gmx::RVec> gmx_unused receiveBuffer,
+             int gmx_unused                      tag,
+             MPI_Request gmx_unused* request)
+{
+#if GMX_MPI
+    int receiveRank = dd->neighbor[ddDimensionIndex][direction == dddirForward ? 1 : 0];
+
+    MPI_Irecv(receiveBuffer.data(), receiveBuffer.size() * sizeof(gmx::RVec), MPI_BYTE,
+              receiveRank, tag, dd->mpi_comm_all, request);
+#endif
+}
+
+void ddWait(MPI_Request gmx_unused* request)
+{
+#if GMX_MPI
+    MPI_Wait(request, MPI_STATUS_IGNORE); //NOLINT(clang-analyzer-optin.mpi.MPI-Checker)
+#endif
+}
+
 void dd_sendrecv2_rvec(const struct gmx_domdec_t gmx_unused* dd,
                        int gmx_unused ddimind,
                        rvec gmx_unused* buf_s_fw,
@@ -51,6 +51,7 @@
 
 #include "gromacs/math/vectypes.h"
 #include "gromacs/utility/arrayref.h"
+#include "gromacs/utility/gmxmpi.h"
 
 struct gmx_domdec_t;
 
@@ -141,6 +142,37 @@ extern template void ddSendrecv<gmx::RVec>(const gmx_domdec_t*      dd,
                                            gmx::ArrayRef<gmx::RVec> sendBuffer,
                                            gmx::ArrayRef<gmx::RVec> receiveBuffer);
 
+/*! \brief Starts a non-blocking send of rvec's one cell along the domain decomposition
+ *
+ * Sends in the dimension indexed by ddDimensionIndex, either forward
+ * (direction=dddirFoward) or backward (direction=dddirBackward).
+ * \p sendBuffer should not be modified until ddWait() has been called
+ * on \p request. Messages between the same pair of ranks which are
+ * in flight at the same time should use different values for \p tag.
+ */
+void ddIsend(const gmx_domdec_t*            dd,
+             int                            ddDimensionIndex,
+             int                            direction,
+             gmx::ArrayRef<const gmx::RVec> sendBuffer,
+             int                            tag,
+             MPI_Request*                   request);
+
+/*! \brief Starts a non-blocking receive of rvec's sent with ddIsend()
+ *
+ * \p direction and \p tag should be the same as the ones passed to ddIsend()
+ * by the sending rank. The contents of \p receiveBuffer are only valid
+ * after ddWait() has been called on \p request.
+ */
+void ddIrecv(const gmx_domdec_t*      dd,
+             int                      ddDimensionIndex,
+             int                      direction,
+             gmx::ArrayRef<gmx::RVec> receiveBuffer,
+             int                      tag,
+             MPI_Request*             request);
+
+//! Waits for completion of the send or receive started with ddIsend() or ddIrecv()
+void ddWait(MPI_Request* request);
+
 /*! \brief Move revc's in the comm. region one cell along the domain decomposition
  *
  * Moves in dimension indexed by ddimind, simultaneously in the forward
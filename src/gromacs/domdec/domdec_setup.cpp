@@ -53,6 +53,9 @@
 #include <cmath>
 #include <cstdio>
 
+#include <algorithm>
+#include <vector>
+
 #include "gromacs/domdec/domdec.h"
 #include "gromacs/domdec/domdec_struct.h"
 #include "gromacs/domdec/options.h"
@@ -80,6 +83,9 @@ using gmx::DomdecOptions;
 /*! \brief Margin for setting up the DD grid */
 #define DD_GRID_MARGIN_PRES_SCALE 1.05
 
+/*! \brief Margin on the minimum cell size with cell sizes from the atom distribution */
+static constexpr real c_atomQuantileCellSizeMargin = 1.1;
+
 /*! \brief Factorize \p n.
  *
  * \param[in]    n     Value to factorize
@@ -314,7 +320,7 @@ real comm_box_frac(const gmx::IVec& dd_nc, real cutoff, const gmx_ddbox_t& ddbox
 /*! \brief Return whether the DD inhomogeneous in the z direction */
 static gmx_bool inhomogeneous_z(const t_inputrec& ir)
 {
-    return ((EEL_PME(ir.coulombtype) || ir.coulombtype == eelEWALD) && ir.ePBC == epbcXYZ
+    return (EEL_PME_EWALD(ir.coulombtype) && ir.ePBC == epbcXYZ
             && ir.ewald_geometry == eewg3DC);
 }
 
@@ -903,6 +909,149 @@ static int set_dd_dim(const gmx::IVec& numDDCells, const DDSettings& ddSettings,
     return ndim;
 }
 
+std::vector<real> atomQuantileCellBoundaries(gmx::ArrayRef<const real> sortedPositions,
+                                             int                       numCells)
+{
+    const int         numAtoms = sortedPositions.ssize();
+    std::vector<real> boundaries(numCells + 1);
+    boundaries[0]        = 0;
+    boundaries[numCells] = 1;
+    for (int i = 1; i < numCells; i++)
+    {
+        if (numAtoms < numCells)
+        {
+            /* Not every cell can get atoms, use uniform cells */
+            boundaries[i] = i / static_cast<real>(numCells);
+        }
+        else
+        {
+            /* With at least one atom per cell, 0 < atomSplit < numAtoms */
+            const int atomSplit = static_cast<int>((static_cast<int64_t>(numAtoms) * i) / numCells);
+            boundaries[i]       = 0.5 * (sortedPositions[atomSplit - 1] + sortedPositions[atomSplit]);
+        }
+    }
+
+    return boundaries;
+}
+
+std::vector<real> atomQuantileRelativeCellSizes(const gmx_ddbox_t&             ddbox,
+                                                const matrix                   box,
+                                                gmx::ArrayRef<const gmx::RVec> xGlobal,
+                                                int                            dim,
+                                                int                            numCells,
+                                                real                           minCellSize)
+{
+    const real minFraction = minCellSize / (ddbox.box_size[dim] * ddbox.skew_fac[dim]);
+    if (numCells * minFraction > 1)
+    {
+        return {};
+    }
+
+    matrix tcm;
+    make_tric_corr_matrix(ddbox.npbcdim, box, tcm);
+
+    /* Determine the fractional positions along dim in lattice coordinates */
+    std::vector<real> position(xGlobal.size());
+    for (size_t i = 0; i < xGlobal.size(); i++)
+    {
+        real pos_d = xGlobal[i][dim];
+        for (int d2 = dim + 1; d2 < DIM; d2++)
+        {
+            pos_d += xGlobal[i][d2] * tcm[d2][dim];
+        }
+        real f = (pos_d - ddbox.box0[dim]) / ddbox.box_size[dim];
+        if (dim < ddbox.npbcdim)
+        {
+            f -= std::floor(f);
+        }
+        position[i] = std::min(std::max(f, real(0)), real(1));
+    }
+    std::sort(position.begin(), position.end());
+
+    std::vector<real> boundaries = atomQuantileCellBoundaries(position, numCells);
+
+    /* Enforce the minimum cell size, this is possible because of the check above */
+    for (int i = 1; i < numCells; i++)
+    {
+        boundaries[i] = std::max(boundaries[i], boundaries[i - 1] + minFraction);
+    }
+    for (int i = numCells - 1; i > 0; i--)
+    {
+        boundaries[i] = std::min(boundaries[i], boundaries[i + 1] - minFraction);
+    }
+
+    std::vector<real> relativeCellSizes(numCells);
+    for (int i = 0; i < numCells; i++)
+    {
+        relativeCellSizes[i] = boundaries[i + 1] - boundaries[i];
+    }
+
+    return relativeCellSizes;
+}
+
+/*! \brief Sets the relative cell sizes in \p ddGridSetup from the quantiles of the atom distribution
+ *
+ * Each DD dimension is treated independently, the cell sizes end up
+ * as static load balancing cell fractions. The cells need to be large enough for the bonded interactions
+ * and we need fewer communication pulses than cells.
+ */
+static void setAtomQuantileCellSizes(const gmx::MDLogger&           mdlog,
+                                  const t_commrec*               cr,
+                                  const DDSystemInfo&            systemInfo,
+                                  const gmx_ddbox_t&             ddbox,
+                                  const matrix                   box,
+                                  gmx::ArrayRef<const gmx::RVec> xGlobal,
+                                  DDGridSetup*                   ddGridSetup)
+{
+    for (int dim = 0; dim < DIM; dim++)
+    {
+        const int numCells = ddGridSetup->numDomains[dim];
+        if (numCells == 1)
+        {
+            continue;
+        }
+
+        real minCellSize = systemInfo.cellsizeLimit;
+        if (dim < ddbox.npbcdim)
+        {
+            minCellSize = std::max(minCellSize, systemInfo.cutoff / (numCells - 1));
+        }
+        /* Use a margin to allow for atom motion and DLB */
+        minCellSize *= c_atomQuantileCellSizeMargin;
+
+        std::vector<real>& relativeCellSizes = ddGridSetup->relativeCellSizes[dim];
+        int                numSizes          = 0;
+        if (MASTER(cr))
+        {
+            relativeCellSizes =
+                    atomQuantileRelativeCellSizes(ddbox, box, xGlobal, dim, numCells, minCellSize);
+            numSizes = relativeCellSizes.size();
+        }
+        gmx_bcast(sizeof(numSizes), &numSizes, cr);
+        if (numSizes == 0)
+        {
+            relativeCellSizes.clear();
+            GMX_LOG(mdlog.info)
+                    .appendTextFormatted(
+                            "NOTE: Using uniform cells along %c, as the box is too small for "
+                            "cells with equal atom counts",
+                            dim2char(dim));
+            continue;
+        }
+        relativeCellSizes.resize(numSizes);
+        gmx_bcast(numSizes * sizeof(real), relativeCellSizes.data(), cr);
+
+        std::string text = gmx::formatString(
+                "Relative cell sizes along %c from equal atom counts per cell:",
+                dim2char(dim));
+        for (real size : relativeCellSizes)
+        {
+            text += gmx::formatString(" %5.3f", size);
+        }
+        GMX_LOG(mdlog.info).appendText(text);
+    }
+}
+
 DDGridSetup getDDGridSetup(const gmx::MDLogger&           mdlog,
                            const t_commrec*               cr,
                            const int                      numRanksRequested,
@@ -958,5 +1107,10 @@ DDGridSetup getDDGridSetup(const gmx::MDLogger&           mdlog,
     ddGridSetup.numDomains[ZZ]  = numDomains[ZZ];
     ddGridSetup.numDDDimensions = set_dd_dim(numDomains, ddSettings, &ddGridSetup.ddDimensions);
 
+    if (ddSettings.useAtomQuantileCellSizes)
+    {
+        setAtomQuantileCellSizes(mdlog, cr, systemInfo, *ddbox, box, xGlobal, &ddGridSetup);
+    }
+
     return ddGridSetup;
 }
@@ -42,6 +42,9 @@
 #ifndef GMX_DOMDEC_DOMDEC_SETUP_H
 #define GMX_DOMDEC_DOMDEC_SETUP_H
 
+#include <array>
+#include <vector>
+
 #include "gromacs/math/vec.h"
 
 struct DDSettings;
@@ -78,8 +81,40 @@ struct DDGridSetup
     int numDDDimensions = 0;
     //! The domain decomposition dimensions, the first numDDDimensions entries are used
     ivec ddDimensions = { -1, -1, -1 };
+    //! Relative cell sizes along each dimension from the atom quantiles, empty when uniform
+    std::array<std::vector<real>, DIM> relativeCellSizes;
 };
 
+/*! \brief Returns the cell boundaries that split sorted positions into cells with equal atom counts
+ *
+ * This is a 1D quantile split: boundary i is placed halfway between
+ * the two atoms around quantile i/\p numCells of the positions.
+ * With fewer atoms than cells, uniform boundaries are returned.
+ *
+ * \param[in] sortedPositions  Sorted fractional positions in [0,1]
+ * \param[in] numCells         The number of cells
+ * \returns The \p numCells + 1 fractional cell boundaries, the first is 0, the last 1
+ */
+std::vector<real> atomQuantileCellBoundaries(gmx::ArrayRef<const real> sortedPositions,
+                                             int                       numCells);
+
+/*! \brief Returns the relative cell sizes along \p dim that give equal atom counts per cell
+ *
+ * The atoms are projected on \p dim in lattice coordinates and the cell
+ * boundaries are set at the quantiles of this 1D distribution, see
+ * atomQuantileCellBoundaries(). The other dimensions are not considered.
+ * Cells are then made at least \p minCellSize in size.
+ *
+ * \returns The \p numCells relative cell sizes, or an empty vector when
+ *          the minimum size can not be satisfied
+ */
+std::vector<real> atomQuantileRelativeCellSizes(const gmx_ddbox_t&             ddbox,
+                                                const matrix                   box,
+                                                gmx::ArrayRef<const gmx::RVec> xGlobal,
+                                                int                            dim,
+                                                int                            numCells,
+                                                real                           minCellSize);
+
 /*! \brief Checks that requests for PP and PME ranks honor basic expectations
  *
  * Issues a fatal error if there are more PME ranks than PP, or if the
@@ -57,6 +57,7 @@
 #include "gromacs/domdec/domdec.h"
 #include "gromacs/domdec/domdec_network.h"
 #include "gromacs/domdec/ga2la.h"
+#include "gromacs/domdec/hashedmap.h"
 #include "gromacs/gmxlib/network.h"
 #include "gromacs/math/vec.h"
 #include "gromacs/mdlib/forcerec.h"
@@ -105,6 +106,36 @@ struct MolblockIndices
     int type;
 };
 
+/*! \brief The home-zone bonded interactions assigned to a home atom, stored in a cache */
+struct CachedHomeAtom
+{
+    int atomGlobal; /**< The global atom index */
+    int start;      /**< The start of the interactions in the cache */
+    int end;        /**< The end of the interactions in the cache */
+};
+
+/*! \brief Cache of the bonded interactions of home atoms that only involve home atoms
+ *
+ * When, after repartitioning, an atom and all atoms in its interactions
+ * are still home atoms, its interactions are unchanged and can be added
+ * to the local topology by only converting the atom indices.
+ * The interactions of atoms that left are thereby removed. The interactions
+ * of atoms that arrived, or of which a partner arrived or left, are
+ * generated from the reverse topology.
+ */
+struct HomeInteractionsCache
+{
+    std::vector<CachedHomeAtom> atoms;        /**< The atoms with only home interactions */
+    std::vector<int>            interactions; /**< ftype|type|a0_global|...|an_global|ftype|... */
+};
+
+/*! \brief Index of an atom in the home interaction caches of the threads */
+struct HomeInteractionsCacheIndex
+{
+    int thread; /**< The thread the cache entry belongs to */
+    int entry;  /**< The index in the atoms of the cache of this thread */
+};
+
 /*! \brief Struct for thread local work data for local topology generation */
 struct thread_work_t
 {
@@ -113,6 +144,9 @@ struct thread_work_t
     int                       nbonded;    /**< The number of bondeds in this struct */
     t_blocka                  excl;       /**< List of exclusions */
     int                       excl_count; /**< The total exclusion count for \p excl */
+    HomeInteractionsCache     cache;      /**< Home interactions of the last partitioning */
+    HomeInteractionsCache     cacheNext;  /**< Home interactions of the current partitioning */
+    std::vector<int>          localAtoms; /**< Local atom indices of cached interactions */
 };
 
 /*! \brief Struct for the reverse topology: links bonded interactions to atomsx */
@@ -143,6 +177,11 @@ struct gmx_reverse_top_t
     //! \brief Intermolecular reverse ilist
     reverse_ilist_t ril_intermol;
 
+    //! \brief Whether we update the home zone interactions incrementally using a cache
+    bool useHomeInteractionsCache = false;
+    //! \brief Global atom index to entry in the home interactions caches in th_work
+    gmx::HashedMap<HomeInteractionsCacheIndex> homeInteractionsCacheIndex = { 0 };
+
     /* Work data structures for multi-threading */
     //! \brief Thread work array for local topology generation
     std::vector<thread_work_t> th_work;
@@ -692,6 +731,9 @@ static gmx_reverse_top_t make_reverse_top(const gmx_mtop_t* mtop,
         rt.mbi.push_back(mbi);
     }
 
+    /* With only single atom molecules there is nothing to gain with a cache */
+    rt.useHomeInteractionsCache = rt.bInterAtomicInteractions;
+
     rt.th_work.resize(gmx_omp_nthreads_get(emntDomdec));
 
     return rt;
@@ -1108,7 +1150,32 @@ static void combine_idef(t_idef* dest, gmx::ArrayRef<const thread_work_t> src)
     }
 }
 
+/*! \brief Appends an interaction with global atom indices \p atomsGlobal to \p cacheInteractions */
+static inline void addToHomeInteractionsCache(std::vector<int>* cacheInteractions,
+                                              int               ftype,
+                                              int               type,
+                                              const int*        atomsGlobal)
+{
+    cacheInteractions->push_back(ftype);
+    cacheInteractions->push_back(type);
+    cacheInteractions->insert(cacheInteractions->end(), atomsGlobal, atomsGlobal + NRAL(ftype));
+}
+
+/*! \brief Returns whether \p zone is shifted down along a dimension
+ *
+ * This only happens for the lower tower zone of the neutral-territory scheme.
+ */
+static inline bool zoneIsShiftedDown(const gmx_domdec_zones_t& zones, int zone)
+{
+    return (zones.shift[zone][XX] < 0 || zones.shift[zone][YY] < 0 || zones.shift[zone][ZZ] < 0);
+}
+
 /*! \brief Check and when available assign bonded interactions for local atom i
+ *
+ * When \p cacheInteractions is not nullptr, which is only allowed for
+ * the home zone, the interactions are also appended to \p cacheInteractions
+ * with global atom indices and \p canCacheAtom is set to false when
+ * an interaction involves non-home atoms or is a virtual site construction.
  */
 static inline void check_assign_interactions_atom(int                       i,
                                                   int                       i_gl,
@@ -1133,7 +1200,9 @@ static inline void check_assign_interactions_atom(int                       i,
                                                   t_idef*                   idef,
                                                   int                       iz,
                                                   gmx_bool                  bBCheck,
-                                                  int*                      nbonded_local)
+                                                  int*                      nbonded_local,
+                                                  std::vector<int>*         cacheInteractions,
+                                                  bool*                     canCacheAtom)
 {
     gmx::ArrayRef<const DDPairInteractionRanges> iZones = zones->iZones;
 
@@ -1153,6 +1222,11 @@ static inline void check_assign_interactions_atom(int                       i,
             {
                 add_vsite(*dd->ga2la, index, rtil, ftype, nral, TRUE, i, i_gl, i_mol, iatoms.data(), idef);
             }
+            if (cacheInteractions)
+            {
+                /* The vsite assignment also depends on the constructing atoms */
+                *canCacheAtom = false;
+            }
         }
         else
         {
@@ -1177,6 +1251,10 @@ static inline void check_assign_interactions_atom(int                       i,
                     {
                         add_fbposres(mol, i_mol, numAtomsInMolecule, molb, tiatoms, ip_in, idef);
                     }
+                    if (cacheInteractions)
+                    {
+                        addToHomeInteractionsCache(cacheInteractions, ftype, iatoms[0], &i_gl);
+                    }
                 }
                 else
                 {
@@ -1199,7 +1277,21 @@ static inline void check_assign_interactions_atom(int                       i,
                 {
                     k_gl = iatoms[2];
                 }
-                if (const auto* entry = dd->ga2la->find(k_gl))
+                const auto* entry = dd->ga2la->find(k_gl);
+                if (cacheInteractions)
+                {
+                    if (entry != nullptr && entry->cell == 0)
+                    {
+                        const int atomsGlobal[2] = { i_gl, k_gl };
+                        addToHomeInteractionsCache(cacheInteractions, ftype, iatoms[0],
+                                                   atomsGlobal);
+                    }
+                    else
+                    {
+                        *canCacheAtom = false;
+                    }
+                }
+                if (entry)
                 {
                     int kz = entry->cell;
                     if (kz >= zones->n)
@@ -1207,8 +1299,8 @@ static inline void check_assign_interactions_atom(int                       i,
                         kz -= zones->n;
                     }
                     /* Check zone interaction assignments */
-                    bUse = ((iz < iZones.ssize() && iz <= kz && iZones[iz].jZoneRange.isInRange(kz))
-                            || (kz < iZones.ssize() && iz > kz && iZones[kz].jZoneRange.isInRange(iz)));
+                    bUse = ((iz < iZones.ssize() && iZones[iz].jZoneRange.isInRange(kz))
+                            || (kz < iZones.ssize() && iZones[kz].jZoneRange.isInRange(iz)));
                     if (bUse)
                     {
                         GMX_ASSERT(ftype != F_CONSTR || (iz == 0 && kz == 0),
@@ -1238,6 +1330,8 @@ static inline void check_assign_interactions_atom(int                       i,
                  */
                 ivec k_zero, k_plus;
                 int  k;
+                int  atomsGlobal[MAXATOMLIST];
+                bool allAtomsAreHome = true;
 
                 bUse = TRUE;
                 clear_ivec(k_zero);
@@ -1254,12 +1348,19 @@ static inline void check_assign_interactions_atom(int                       i,
                     {
                         k_gl = iatoms[k];
                     }
-                    const auto* entry = dd->ga2la->find(k_gl);
-                    if (entry == nullptr || entry->cell >= zones->n)
+                    atomsGlobal[k - 1] = k_gl;
+                    const auto* entry  = dd->ga2la->find(k_gl);
+                    if (entry == nullptr || entry->cell != 0)
+                    {
+                        allAtomsAreHome = false;
+                    }
+                    if (entry == nullptr || entry->cell >= zones->n
+                        || zoneIsShiftedDown(*zones, entry->cell))
                     {
                         /* We do not have this atom of this interaction
                          * locally, or it comes from more than one cell
-                         * away.
+                         * away, or it is in the lower tower zone
+                         * of the neutral-territory scheme.
                          */
                         bUse = FALSE;
                     }
@@ -1281,6 +1382,18 @@ static inline void check_assign_interactions_atom(int                       i,
                         }
                     }
                 }
+                if (cacheInteractions)
+                {
+                    if (allAtomsAreHome)
+                    {
+                        addToHomeInteractionsCache(cacheInteractions, ftype, iatoms[0],
+                                                   atomsGlobal);
+                    }
+                    else
+                    {
+                        *canCacheAtom = false;
+                    }
+                }
                 bUse = (bUse && (k_zero[XX] != 0) && (k_zero[YY] != 0) && (k_zero[ZZ] != 0));
                 if (bRCheckMB)
                 {
@@ -1317,10 +1430,99 @@ static inline void check_assign_interactions_atom(int                       i,
     }
 }
 
+/*! \brief Adds the cached home interactions \p interactions of home atom \p i to \p idef
+ *
+ * \returns false, without adding any interactions, when one of the atoms
+ * involved is not a home atom.
+ */
+static bool addCachedHomeInteractions(int gmx_used_in_debug              i,
+                                      int                                i_gl,
+                                      const gmx_domdec_t*                dd,
+                                      gmx::ArrayRef<const int>           interactions,
+                                      const std::vector<gmx_molblock_t>& molb,
+                                      gmx_bool                           bRCheck2B,
+                                      real                               rc2,
+                                      t_pbc*                             pbc_null,
+                                      rvec*                              cg_cm,
+                                      const t_iparams*                   ip_in,
+                                      t_idef*                            idef,
+                                      gmx_bool                           bBCheck,
+                                      std::vector<int>*                  localAtoms,
+                                      int*                               nbonded_local)
+{
+    /* First check that all atoms are still home atoms */
+    localAtoms->clear();
+    for (gmx::index j = 0; j < interactions.ssize(); j += 2 + NRAL(interactions[j]))
+    {
+        const int nral = NRAL(interactions[j]);
+        for (int k = 0; k < nral; k++)
+        {
+            const auto* entry = dd->ga2la->find(interactions[j + 2 + k]);
+            if (entry == nullptr || entry->cell != 0)
+            {
+                return false;
+            }
+            localAtoms->push_back(entry->la);
+        }
+    }
+
+    const int* localAtom = localAtoms->data();
+    for (gmx::index j = 0; j < interactions.ssize(); j += 2 + NRAL(interactions[j]))
+    {
+        const int ftype = interactions[j];
+        const int nral  = NRAL(ftype);
+        t_iatom   tiatoms[1 + MAXATOMLIST];
+
+        tiatoms[0] = interactions[j + 1];
+        for (int k = 1; k <= nral; k++)
+        {
+            tiatoms[k] = *localAtom++;
+        }
+
+        bool bUse = true;
+        if (ftype == F_POSRES || ftype == F_FBPOSRES)
+        {
+            int mb, mt, mol, i_mol;
+            global_atomnr_to_moltype_ind(dd->reverse_top, i_gl, &mb, &mt, &mol, &i_mol);
+            const int numAtomsInMolecule = dd->reverse_top->ril_mt[mt].numAtomsInMolecule;
+            if (ftype == F_POSRES)
+            {
+                add_posres(mol, i_mol, numAtomsInMolecule, &molb[mb], tiatoms, ip_in, idef);
+            }
+            else
+            {
+                add_fbposres(mol, i_mol, numAtomsInMolecule, &molb[mb], tiatoms, ip_in, idef);
+            }
+        }
+        else if (nral == 2)
+        {
+            GMX_ASSERT(tiatoms[1] == i, "The first atom should be the atom we assign to");
+            /* Apply the same distance check as check_assign_interactions_atom */
+            bUse = !(bRCheck2B && dd_dist2(pbc_null, cg_cm, tiatoms[1], tiatoms[2]) >= rc2);
+        }
+        if (bUse)
+        {
+            add_ifunc(nral, tiatoms, &idef->il[ftype]);
+            if (bBCheck || !(interaction_function[ftype].flags & IF_LIMZERO))
+            {
+                (*nbonded_local)++;
+            }
+        }
+    }
+
+    return true;
+}
+
 /*! \brief This function looks up and assigns bonded interactions for zone iz.
  *
  * With thread parallelizing each thread acts on a different atom range:
  * at_start to at_end.
+ *
+ * For the home zone, when the cache is in use, the interactions of atoms
+ * which, together with all their interaction partners, were home atoms
+ * at the previous partitioning are taken from the cache. The home
+ * interactions of all atoms are stored in the cache of \p thread
+ * for the next partitioning.
  */
 static int make_bondeds_zone(gmx_domdec_t*                      dd,
                              const gmx_domdec_zones_t*          zones,
@@ -1334,7 +1536,8 @@ static int make_bondeds_zone(gmx_domdec_t*                      dd,
                              const t_iparams*                   ip_in,
                              t_idef*                            idef,
                              int                                izone,
-                             const gmx::Range<int>&             atomRange)
+                             const gmx::Range<int>&             atomRange,
+                             int                                thread)
 {
     int                mb, mt, mol, i_mol;
     gmx_bool           bBCheck;
@@ -1347,19 +1550,50 @@ static int make_bondeds_zone(gmx_domdec_t*                      dd,
 
     nbonded_local = 0;
 
+    const bool             useCache  = (izone == 0 && rt->useHomeInteractionsCache);
+    HomeInteractionsCache* cacheNext = &rt->th_work[thread].cacheNext;
+
     for (int i : atomRange)
     {
         /* Get the global atom number */
         const int i_gl = dd->globalAtomIndices[i];
+
+        if (useCache)
+        {
+            if (const auto* cacheIndex = rt->homeInteractionsCacheIndex.find(i_gl))
+            {
+                const HomeInteractionsCache& cache = rt->th_work[cacheIndex->thread].cache;
+                const CachedHomeAtom&        atom  = cache.atoms[cacheIndex->entry];
+                auto interactions = gmx::constArrayRefFromArray(
+                        cache.interactions.data() + atom.start, atom.end - atom.start);
+                if (addCachedHomeInteractions(i, i_gl, dd, interactions, molb, bRCheck2B, rc2,
+                                              pbc_null, cg_cm, ip_in, idef, bBCheck,
+                                              &rt->th_work[thread].localAtoms, &nbonded_local))
+                {
+                    const int start = cacheNext->interactions.size();
+                    cacheNext->interactions.insert(cacheNext->interactions.end(),
+                                                   interactions.begin(), interactions.end());
+                    const int end = cacheNext->interactions.size();
+                    cacheNext->atoms.push_back({ i_gl, start, end });
+                    continue;
+                }
+            }
+        }
+
         global_atomnr_to_moltype_ind(rt, i_gl, &mb, &mt, &mol, &i_mol);
         /* Check all intramolecular interactions assigned to this atom */
         gmx::ArrayRef<const int>     index = rt->ril_mt[mt].index;
         gmx::ArrayRef<const t_iatom> rtil  = rt->ril_mt[mt].il;
 
+        std::vector<int>* cacheInteractions = (useCache ? &cacheNext->interactions : nullptr);
+        const int         cacheStart        = cacheNext->interactions.size();
+        bool              canCacheAtom      = true;
+
         check_assign_interactions_atom(i, i_gl, mol, i_mol, rt->ril_mt[mt].numAtomsInMolecule,
                                        index, rtil, FALSE, index[i_mol], index[i_mol + 1], dd,
                                        zones, &molb[mb], bRCheckMB, rcheck, bRCheck2B, rc2,
-                                       pbc_null, cg_cm, ip_in, idef, izone, bBCheck, &nbonded_local);
+                                       pbc_null, cg_cm, ip_in, idef, izone, bBCheck, &nbonded_local,
+                                       cacheInteractions, &canCacheAtom);
 
 
         if (rt->bIntermolecularInteractions)
@@ -1371,13 +1605,54 @@ static int make_bondeds_zone(gmx_domdec_t*                      dd,
             check_assign_interactions_atom(i, i_gl, mol, i_mol, rt->ril_mt[mt].numAtomsInMolecule,
                                            index, rtil, TRUE, index[i_gl], index[i_gl + 1], dd, zones,
                                            &molb[mb], bRCheckMB, rcheck, bRCheck2B, rc2, pbc_null,
-                                           cg_cm, ip_in, idef, izone, bBCheck, &nbonded_local);
+                                           cg_cm, ip_in, idef, izone, bBCheck, &nbonded_local,
+                                           cacheInteractions, &canCacheAtom);
+        }
+
+        if (useCache)
+        {
+            if (canCacheAtom)
+            {
+                const int cacheEnd = cacheNext->interactions.size();
+                cacheNext->atoms.push_back({ i_gl, cacheStart, cacheEnd });
+            }
+            else
+            {
+                cacheNext->interactions.resize(cacheStart);
+            }
         }
     }
 
     return nbonded_local;
 }
 
+/*! \brief Makes the home interactions generated in this partitioning the cache for the next */
+static void updateHomeInteractionsCache(gmx_reverse_top_t* rt)
+{
+    rt->homeInteractionsCacheIndex.clear();
+    int numCachedAtoms = 0;
+    for (size_t thread = 0; thread < rt->th_work.size(); thread++)
+    {
+        thread_work_t& th_work = rt->th_work[thread];
+
+        std::swap(th_work.cache, th_work.cacheNext);
+        th_work.cacheNext.atoms.clear();
+        th_work.cacheNext.interactions.clear();
+
+        for (size_t entry = 0; entry < th_work.cache.atoms.size(); entry++)
+        {
+            rt->homeInteractionsCacheIndex.insert(th_work.cache.atoms[entry].atomGlobal,
+                                                  { int(thread), int(entry) });
+        }
+        numCachedAtoms += th_work.cache.atoms.size();
+    }
+
+    if (debug)
+    {
+        fprintf(debug, "Cached the home bonded interactions of %d home atoms\n", numCachedAtoms);
+    }
+}
+
 /*! \brief Set the exclusion data for i-zone \p iz for the case of no exclusions */
 static void set_no_exclusions_zone(const gmx_domdec_zones_t* zones, int iz, t_blocka* lexcls)
 {
@@ -1634,7 +1909,7 @@ static int make_local_bondeds_excls(gmx_domdec_t*       dd,
 
                 rt->th_work[thread].nbonded = make_bondeds_zone(
                         dd, zones, mtop->molblock, bRCheckMB, rcheck, bRCheck2B, rc2, pbc_null,
-                        cg_cm, idef->iparams, idef_t, izone, gmx::Range<int>(cg0t, cg1t));
+                        cg_cm, idef->iparams, idef_t, izone, gmx::Range<int>(cg0t, cg1t), thread);
 
                 if (izone < nzone_excl)
                 {
@@ -1662,6 +1937,11 @@ static int make_local_bondeds_excls(gmx_domdec_t*       dd,
             combine_idef(idef, rt->th_work);
         }
 
+        if (izone == 0 && rt->useHomeInteractionsCache)
+        {
+            updateHomeInteractionsCache(rt);
+        }
+
         for (const thread_work_t& th_work : rt->th_work)
         {
             nbonded_local += th_work.nbonded;
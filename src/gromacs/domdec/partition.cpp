@@ -777,6 +777,8 @@ static void get_load_distribution(gmx_domdec_t* dd, gmx_wallcycle_t wcycle)
 
     bSepPME = (dd->pme_nodeid >= 0);
 
+    const bool useCostProfile = (comm->ddSettings.useCostProfileDlb && isDlbOn(comm));
+
     if (dd->ndim == 0 && bSepPME)
     {
         /* Without decomposition, but with PME nodes, we need the load */
@@ -846,6 +848,56 @@ static void get_load_distribution(gmx_domdec_t* dd, gmx_wallcycle_t wcycle)
             MPI_Gather(sbuf, load->nload * sizeof(float), MPI_BYTE, load->load,
                        load->nload * sizeof(float), MPI_BYTE, 0, comm->mpi_comm_load[d]);
 #endif
+            if (useCostProfile)
+            {
+                /* Communicate the cost profiles along dimensions 0 to d.
+                 * All cells in our row share the cell boundaries along
+                 * the lower dimensions, so we can sum those profiles.
+                 */
+                const int          numBins     = c_dlbCostProfileNumBins;
+                const int          profileSize = (d + 1) * numBins;
+                std::vector<float> sendProfile;
+                if (d == dd->ndim - 1)
+                {
+                    /* Scale our normalized profile with our measured load */
+                    sendProfile.resize(profileSize);
+                    for (int i = 0; i < profileSize; i++)
+                    {
+                        sendProfile[i] = comm->costProfileLocal[i] * sbuf[0];
+                    }
+                }
+                else
+                {
+                    sendProfile = comm->load[d + 1].costProfileSum;
+                }
+                std::vector<float> rowProfiles;
+                if (dd->ci[dim] == dd->master_ci[dim])
+                {
+                    rowProfiles.resize(dd->nc[dim] * profileSize);
+                }
+#if GMX_MPI
+                MPI_Gather(sendProfile.data(), profileSize * sizeof(float), MPI_BYTE,
+                           rowProfiles.data(), profileSize * sizeof(float), MPI_BYTE, 0,
+                           comm->mpi_comm_load[d]);
+#endif
+                if (dd->ci[dim] == dd->master_ci[dim])
+                {
+                    load->costProfile.resize(dd->nc[dim] * numBins);
+                    load->costProfileSum.assign(d * numBins, 0);
+                    for (int i = 0; i < dd->nc[dim]; i++)
+                    {
+                        const float* cellProfile = rowProfiles.data() + i * profileSize;
+                        for (int j = 0; j < d * numBins; j++)
+                        {
+                            load->costProfileSum[j] += cellProfile[j];
+                        }
+                        for (int b = 0; b < numBins; b++)
+                        {
+                            load->costProfile[i * numBins + b] = cellProfile[d * numBins + b];
+                        }
+                    }
+                }
+            }
             if (dd->ci[dim] == dd->master_ci[dim])
             {
                 /* We are the master along this row, process this row */
@@ -1248,7 +1300,8 @@ static void turn_on_dlb(const gmx::MDLogger& mdlog, gmx_domdec_t* dd, int64_t st
 
     /* We can set the required cell size info here,
      * so we do not need to communicate this.
-     * The grid is completely uniform.
+     * The grid is not staggered, the cells are uniform or have
+     * the static cell sizes along each dimension.
      */
     for (int d = 0; d < dd->ndim; d++)
     {
@@ -1258,17 +1311,24 @@ static void turn_on_dlb(const gmx::MDLogger& mdlog, gmx_domdec_t* dd, int64_t st
         {
             comm->load[d].sum_m = comm->load[d].sum;
 
-            int nc = dd->nc[dd->dim[d]];
+            const int   dim     = dd->dim[d];
+            const int   nc      = dd->nc[dim];
+            const real* slbFrac = comm->slb_frac[dim];
+            rowMaster->cellFrac[0] = 0;
             for (int i = 0; i < nc; i++)
             {
-                rowMaster->cellFrac[i] = i / static_cast<real>(nc);
-                if (d > 0)
+                rowMaster->cellFrac[i + 1] =
+                        rowMaster->cellFrac[i] + (slbFrac ? slbFrac[i] : 1 / static_cast<real>(nc));
+            }
+            rowMaster->cellFrac[nc] = 1.0;
+            if (d > 0)
+            {
+                for (int i = 0; i < nc; i++)
                 {
-                    rowMaster->bounds[i].cellFracLowerMax = i / static_cast<real>(nc);
-                    rowMaster->bounds[i].cellFracUpperMin = (i + 1) / static_cast<real>(nc);
+                    rowMaster->bounds[i].cellFracLowerMax = rowMaster->cellFrac[i];
+                    rowMaster->bounds[i].cellFracUpperMin = rowMaster->cellFrac[i + 1];
                 }
             }
-            rowMaster->cellFrac[nc] = 1.0;
         }
     }
 }
@@ -1535,7 +1595,12 @@ static void set_dd_corners(const gmx_domdec_t* dd, int dim0, int dim1, int dim2,
 }
 
 /*! \brief Add the atom groups we need to send in this pulse from this
- * zone to \p localAtomGroups and \p work. */
+ * zone to \p localAtomGroups and \p work.
+ *
+ * With \p useMaxNorm the distance to an edge of the cell is the maximum
+ * of the distances to the two cell planes instead of the Euclidean distance,
+ * this is only supported with a rectangular unit cell.
+ */
 static void get_zone_pulse_cgs(gmx_domdec_t*            dd,
                                int                      zonei,
                                int                      zone,
@@ -1548,6 +1613,7 @@ static void get_zone_pulse_cgs(gmx_domdec_t*            dd,
                                int                      dim1,
                                int                      dim2,
                                real                     r_comm2,
+                               bool                     useMaxNorm,
                                real                     r_bcomm2,
                                matrix                   box,
                                bool                     distanceIsTriclinic,
@@ -1616,7 +1682,14 @@ static void get_zone_pulse_cgs(gmx_domdec_t*            dd,
             {
                 r = cg_cm[cg][dim0] - c->cr0;
                 /* This is the first dimension, so always r >= 0 */
-                r2 += r * r;
+                if (useMaxNorm)
+                {
+                    r2 = std::max(r2, r * r);
+                }
+                else
+                {
+                    r2 += r * r;
+                }
                 if (bDistMB_pulse)
                 {
                     rb2 += r * r;
@@ -1805,6 +1878,122 @@ static void clearCommSetupData(dd_comm_setup_work_t* work)
     work->nsend_zone = 0;
 }
 
+/*! \brief Sets up the communication for importing the lower tower zone
+ * with the neutral-territory scheme and communicates the coordinates
+ *
+ * The lower tower zone is imported from the rank below along DD dimension
+ * index 1, so we send in the opposite direction of the eighth-shell pulses.
+ * The zone is placed after all other zones. As only the home zone and
+ * the lower tower zone itself are forwarded, we always receive in place.
+ */
+static void setup_lower_tower_communication(gmx_domdec_t*                dd,
+                                            const matrix                 box,
+                                            t_forcerec*                  fr,
+                                            t_state*                     state,
+                                            PaddedHostVector<gmx::RVec>* f,
+                                            int*                         pos_cg,
+                                            int*                         nat_tot)
+{
+    gmx_domdec_comm_t*     comm  = dd->comm;
+    gmx_domdec_zones_t*    zones = &comm->zones;
+    gmx_domdec_comm_dim_t* cd    = &comm->cdLowerTower;
+    const int              dim   = dd->dim[1];
+
+    /* We need the same number of pulses as in the upward direction */
+    const int numPulses = comm->cd[1].numPulses();
+    if (2 * numPulses >= dd->nc[dim])
+    {
+        gmx_fatal(FARGS,
+                  "With the neutral-territory zone scheme the halo along %c covers %d cells "
+                  "in both directions, this requires more than %d domains along %c, but there "
+                  "are %d",
+                  dim2char(dim), numPulses, 2 * numPulses, dim2char(dim), dd->nc[dim]);
+    }
+    cd->ind.resize(numPulses);
+    cd->receiveInPlace = true;
+
+    const real r_comm2 =
+            gmx::square(domainToDomainIntoAtomToDomainCutoff(comm->systemInfo, comm->systemInfo.cutoff));
+
+    /* The last rank along a dimension without pbc should not send */
+    const bool sendOverPbc = (dd->ci[dim] == dd->nc[dim] - 1);
+    const bool doSend      = !(sendOverPbc && dim >= dd->unitCellInfo.npbcdim);
+
+    const rvec* x = state->x.rvec_array();
+
+    zones->cg_range[c_lowerTowerZone] = *pos_cg;
+    for (int p = 0; p < numPulses; p++)
+    {
+        gmx_domdec_ind_t*     ind  = &cd->ind[p];
+        dd_comm_setup_work_t& work = comm->dth[0];
+
+        ind->index.clear();
+        clearCommSetupData(&work);
+
+        int cg0, cg1;
+        if (p == 0)
+        {
+            cg0 = 0;
+            cg1 = dd->ncg_home;
+        }
+        else
+        {
+            /* Look only at the atom groups received in the previous pulse */
+            cg1 = *pos_cg;
+            cg0 = cg1 - cd->ind[p - 1].nrecv[0];
+        }
+        if (doSend)
+        {
+            for (int cg = cg0; cg < cg1; cg++)
+            {
+                /* The distance to the upper cell plane */
+                const real r  = comm->cell_x1[dim] - x[cg][dim];
+                const real r2 = (r > 0 ? r * r : 0);
+                if (r2 < r_comm2)
+                {
+                    ind->index.push_back(cg);
+                    work.atomGroupBuffer.push_back(dd->globalAtomGroupIndices[cg]);
+                    gmx::RVec posPbc = x[cg];
+                    if (sendOverPbc)
+                    {
+                        posPbc -= box[dim];
+                    }
+                    work.positionBuffer.push_back(posPbc);
+                    work.nat++;
+                }
+            }
+        }
+        ind->nsend[0] = ind->index.size();
+        ind->nsend[1] = ind->index.size();
+        ind->nsend[2] = work.nat;
+        ddSendrecv(dd, 1, dddirForward, ind->nsend, 3, ind->nrecv, 3);
+
+        const int numAtomGroupsNew = *pos_cg + ind->nrecv[1];
+        dd->globalAtomGroupIndices.resize(numAtomGroupsNew);
+        ddSendrecv<int>(dd, 1, dddirForward, work.atomGroupBuffer,
+                        gmx::arrayRefFromArray(dd->globalAtomGroupIndices.data() + *pos_cg,
+                                               ind->nrecv[1]));
+
+        dd_check_alloc_ncg(fr, state, f, numAtomGroupsNew);
+        ddSendrecv<gmx::RVec>(dd, 1, dddirForward, work.positionBuffer,
+                              gmx::makeArrayRef(state->x).subArray(*pos_cg, ind->nrecv[1]));
+        /* The state might have been reallocated */
+        x = state->x.rvec_array();
+
+        for (int cg = *pos_cg; cg < numAtomGroupsNew; cg++)
+        {
+            fr->cginfo[cg] = ddcginfo(fr->cginfo_mb, dd->globalAtomGroupIndices[cg]);
+        }
+        if (p == 0)
+        {
+            comm->zone_ncg1[c_lowerTowerZone] = ind->nrecv[0];
+        }
+        *pos_cg = numAtomGroupsNew;
+        *nat_tot += ind->nrecv[2];
+    }
+    zones->cg_range[c_lowerTowerZone + 1] = *pos_cg;
+}
+
 //! Prepare DD communication.
 static void setup_dd_communication(gmx_domdec_t*                dd,
                                    matrix                       box,
@@ -1856,6 +2045,16 @@ static void setup_dd_communication(gmx_domdec_t*                dd,
             gmx::square(domainToDomainIntoAtomToDomainCutoff(comm->systemInfo, comm->systemInfo.cutoff));
     const real r_bcomm2 =
             gmx::square(domainToDomainIntoAtomToDomainCutoff(comm->systemInfo, comm->cutoff_mbody));
+    /* With neutral territory we use max-norm distances for the corner zone,
+     * all atoms of multi-body interactions are within this distance
+     * of the cell planes of the atoms with zero zone shift.
+     */
+    real r_ntcorner2 = 0;
+    if (comm->useNeutralTerritory && dd_cutoff_multibody(dd) > 0)
+    {
+        r_ntcorner2 = gmx::square(domainToDomainIntoAtomToDomainCutoff(comm->systemInfo,
+                                                                       dd_cutoff_multibody(dd)));
+    }
 
     if (debug)
     {
@@ -1918,6 +2117,13 @@ static void setup_dd_communication(gmx_domdec_t*                dd,
                 distanceIsTriclinic = true;
             }
         }
+        if (comm->useNeutralTerritory && distanceIsTriclinic)
+        {
+            gmx_fatal(FARGS,
+                      "The neutral-territory zone scheme does not support triclinic "
+                      "decomposition dimensions, but the box became triclinic along %c",
+                      dim2char(dim));
+        }
 
         if (dim >= ddbox->npbcdim && dd->ci[dim] == 0)
         {
@@ -1977,6 +2183,19 @@ static void setup_dd_communication(gmx_domdec_t*                dd,
                 }
 
                 zonei = zone_perm[dim_ind][zone];
+
+                /* With neutral territory the corner zone is only used for
+                 * multi-body bonded interactions, which only use atoms
+                 * communicated in the first pulse.
+                 */
+                const bool useNeutralTerritoryCorner =
+                        (comm->useNeutralTerritory && dim_ind == 1 && zonei == 1);
+                real r_comm2_zone = r_comm2;
+                if (useNeutralTerritoryCorner)
+                {
+                    r_comm2_zone = (p == 0 ? r_ntcorner2 : 0);
+                }
+
                 if (p == 0)
                 {
                     /* Here we permutate the zones to obtain a convenient order
@@ -2012,7 +2231,8 @@ static void setup_dd_communication(gmx_domdec_t*                dd,
 
                         /* Get the cg's for this pulse in this zone */
                         get_zone_pulse_cgs(dd, zonei, zone, cg0_th, cg1_th, dd->globalAtomGroupIndices,
-                                           dim, dim_ind, dim0, dim1, dim2, r_comm2, r_bcomm2, box,
+                                           dim, dim_ind, dim0, dim1, dim2, r_comm2_zone,
+                                           useNeutralTerritoryCorner, r_bcomm2, box,
                                            distanceIsTriclinic, normal, skew_fac2_d, skew_fac_01,
                                            v_d, v_0, v_1, &corners, sf2_round, bDistBonded, bBondComm,
                                            bDist2B, bDistMB, state->x.rvec_array(), fr->cginfo,
@@ -2141,6 +2361,11 @@ static void setup_dd_communication(gmx_domdec_t*                dd,
         nzone += nzone;
     }
 
+    if (comm->useNeutralTerritory)
+    {
+        setup_lower_tower_communication(dd, box, fr, state, f, &pos_cg, &nat_tot);
+    }
+
     comm->atomRanges.setEnd(DDAtomRanges::Type::Zones, nat_tot);
 
     if (!bBondComm)
@@ -2309,6 +2534,14 @@ static void set_zones_size(gmx_domdec_t*      dd,
                     }
                 }
             }
+            else if (zones->shift[z][dim] < 0)
+            {
+                /* The lower tower zone of the neutral-territory scheme,
+                 * which is only used without DLB.
+                 */
+                zones->size[z].x0[dim] = comm->cell_x0[dim] - rcs;
+                zones->size[z].x1[dim] = comm->cell_x0[dim];
+            }
         }
 
         /* Loop over the i-zones to set the upper limit of each
@@ -2607,7 +2840,7 @@ void print_dd_statistics(const t_commrec* cr, const t_inputrec* ir, FILE* fplog)
                 if (cr->dd->vsite_comm)
                 {
                     fprintf(fplog, " av. #atoms communicated per step for vsites: %d x %.1f\n",
-                            (EEL_PME(ir->coulombtype) || ir->coulombtype == eelEWALD) ? 3 : 2, av);
+                            EEL_PME_EWALD(ir->coulombtype) ? 3 : 2, av);
                 }
                 break;
             case DDAtomRanges::Type::Constraints:
@@ -2734,6 +2967,11 @@ void dd_partition_system(FILE*                        fplog,
         if (bDoDLB || bLogLoad || bCheckWhetherToTurnDlbOn
             || (bVerbose && (ir->nstlist == 0 || nstglobalcomm <= ir->nstlist)))
         {
+            if (comm->ddSettings.useCostProfileDlb && isDlbOn(comm))
+            {
+                dd_compute_local_cost_profile(dd, *top_local, fr->cginfo, state_local->x,
+                                              state_local->box, *nrnb);
+            }
             get_load_distribution(dd, wcycle);
             if (DDMASTER(dd))
             {
@@ -3077,6 +3315,11 @@ void dd_partition_system(FILE*                        fplog,
     {
         np[dd->dim[i]] = comm->cd[i].numPulses();
     }
+    if (comm->useNeutralTerritory)
+    {
+        /* The halo extends in both directions along the tower dimension */
+        np[dd->dim[1]] += comm->cdLowerTower.numPulses();
+    }
     dd_make_local_top(dd, &comm->zones, dd->unitCellInfo.npbcdim, state_local->box,
                       comm->cellsize_min, np, fr, state_local->x.rvec_array(), top_global, top_local);
 
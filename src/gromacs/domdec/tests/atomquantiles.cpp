@@ -0,0 +1,210 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2020, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests for the DD cell sizes that give equal atom counts per cell.
+ *
+ * \ingroup module_domdec
+ */
+#include "gmxpre.h"
+
+#include <numeric>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/domdec/domdec_setup.h"
+#include "gromacs/domdec/domdec_struct.h"
+#include "gromacs/math/vec.h"
+#include "gromacs/utility/arrayref.h"
+
+#include "testutils/testasserts.h"
+
+namespace gmx
+{
+namespace test
+{
+namespace
+{
+
+//! Checks that \p values matches \p reference
+void checkValues(const std::vector<real>& reference, const std::vector<real>& values)
+{
+    ASSERT_EQ(reference.size(), values.size());
+    for (size_t i = 0; i < reference.size(); i++)
+    {
+        EXPECT_REAL_EQ_TOL(reference[i], values[i], absoluteTolerance(1e-5)) << "entry " << i;
+    }
+}
+
+//! Returns \p numAtoms positions evenly spread over [\p begin, \p end)
+std::vector<real> evenPositions(int numAtoms, real begin, real end)
+{
+    std::vector<real> positions;
+    for (int i = 0; i < numAtoms; i++)
+    {
+        positions.push_back(begin + (end - begin) * (i + 0.5) / numAtoms);
+    }
+    return positions;
+}
+
+TEST(AtomQuantileCellBoundariesTest, EvenDistributionGivesUniformCells)
+{
+    checkValues({ 0, 0.25, 0.5, 0.75, 1 }, atomQuantileCellBoundaries(evenPositions(12, 0, 1), 4));
+}
+
+TEST(AtomQuantileCellBoundariesTest, SkewedDistributionGivesEqualAtomCounts)
+{
+    /* 6 atoms at low positions and 2 at high, the 4th and 5th atom are split */
+    const std::vector<real> positions = { 0.01, 0.02, 0.03, 0.04, 0.05, 0.06, 0.9, 0.95 };
+    checkValues({ 0, 0.045, 1 }, atomQuantileCellBoundaries(positions, 2));
+    checkValues({ 0, 0.025, 0.045, 0.48, 1 }, atomQuantileCellBoundaries(positions, 4));
+}
+
+TEST(AtomQuantileCellBoundariesTest, HandlesNonDivisibleCounts)
+{
+    /* 10 atoms over 3 cells split after atoms 3 and 6 */
+    const std::vector<real> positions = evenPositions(10, 0, 1);
+    checkValues({ 0, 0.3, 0.6, 1 }, atomQuantileCellBoundaries(positions, 3));
+}
+
+TEST(AtomQuantileCellBoundariesTest, SingleCellCoversEverything)
+{
+    checkValues({ 0, 1 }, atomQuantileCellBoundaries(evenPositions(5, 0.2, 0.4), 1));
+}
+
+TEST(AtomQuantileCellBoundariesTest, FewerAtomsThanCellsGivesUniformCells)
+{
+    checkValues({ 0, 0.25, 0.5, 0.75, 1 }, atomQuantileCellBoundaries(evenPositions(3, 0, 0.1), 4));
+    checkValues({ 0, 0.5, 1 }, atomQuantileCellBoundaries({}, 2));
+}
+
+TEST(AtomQuantileCellBoundariesTest, CoincidingAtomsGiveCoincidingBoundaries)
+{
+    /* The minimum cell size is enforced by atomQuantileRelativeCellSizes() */
+    const std::vector<real> positions(6, 0.3);
+    checkValues({ 0, 0.3, 0.3, 1 }, atomQuantileCellBoundaries(positions, 3));
+}
+
+//! Test fixture for the relative cell sizes in a cubic box
+class AtomQuantileRelativeCellSizesTest : public ::testing::Test
+{
+public:
+    AtomQuantileRelativeCellSizesTest()
+    {
+        clear_mat(box_);
+        ddbox_ = {};
+        for (int d = 0; d < DIM; d++)
+        {
+            box_[d][d]         = c_boxLength;
+            ddbox_.box_size[d] = c_boxLength;
+            ddbox_.skew_fac[d] = 1;
+            ddbox_.box0[d]     = 0;
+        }
+        ddbox_.npbcdim     = DIM;
+        ddbox_.nboundeddim = DIM;
+    }
+
+    //! Adds atoms evenly spread along z in [\p begin, \p end), at x=y=1
+    void addSlab(int numAtoms, real begin, real end)
+    {
+        for (real z : evenPositions(numAtoms, begin, end))
+        {
+            x_.push_back({ 1, 1, z });
+        }
+    }
+
+    //! Returns the relative cell sizes along z
+    std::vector<real> cellSizes(int numCells, real minCellSize)
+    {
+        return atomQuantileRelativeCellSizes(ddbox_, box_, x_, ZZ, numCells, minCellSize);
+    }
+
+    //! The box length
+    static constexpr real c_boxLength = 10;
+    //! The unit cell
+    matrix box_;
+    //! The DD box
+    gmx_ddbox_t ddbox_;
+    //! The coordinates
+    std::vector<RVec> x_;
+};
+
+TEST_F(AtomQuantileRelativeCellSizesTest, SlabGivesSmallCellsInsideTheSlab)
+{
+    /* A slab between 4 and 6 nm with vacuum above and below */
+    addSlab(40, 4, 6);
+    checkValues({ 0.45, 0.05, 0.05, 0.45 }, cellSizes(4, 0.5));
+}
+
+TEST_F(AtomQuantileRelativeCellSizesTest, MinimumCellSizeIsEnforced)
+{
+    addSlab(40, 4, 6);
+    const std::vector<real> sizes = cellSizes(4, 1);
+
+    checkValues({ 0.45, 0.1, 0.1, 0.35 }, sizes);
+    EXPECT_REAL_EQ_TOL(1, std::accumulate(sizes.begin(), sizes.end(), real(0)),
+                       absoluteTolerance(1e-5));
+}
+
+TEST_F(AtomQuantileRelativeCellSizesTest, CoincidingAtomsGetMinimumCellSize)
+{
+    x_.assign(8, { 1, 1, 3 });
+    const std::vector<real> sizes = cellSizes(3, 1);
+
+    checkValues({ 0.3, 0.1, 0.6 }, sizes);
+}
+
+TEST_F(AtomQuantileRelativeCellSizesTest, TooLargeMinimumCellSizeGivesEmptyResult)
+{
+    addSlab(40, 4, 6);
+    EXPECT_TRUE(cellSizes(4, 2.6).empty());
+}
+
+TEST_F(AtomQuantileRelativeCellSizesTest, PeriodicImagesGiveTheSameCellSizes)
+{
+    addSlab(40, 4, 6);
+    const std::vector<real> reference = cellSizes(4, 0.5);
+
+    for (RVec& x : x_)
+    {
+        x[ZZ] -= c_boxLength;
+    }
+    checkValues(reference, cellSizes(4, 0.5));
+}
+
+} // namespace
+} // namespace test
+} // namespace gmx
@@ -0,0 +1,237 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2020, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests for setting the DLB cell sizes from measured cost profiles.
+ *
+ * \ingroup module_domdec
+ */
+#include "gmxpre.h"
+
+#include <cmath>
+
+#include <algorithm>
+#include <numeric>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/domdec/cellsizes.h"
+#include "gromacs/domdec/domdec_internal.h"
+
+#include "testutils/testasserts.h"
+
+namespace gmx
+{
+namespace test
+{
+namespace
+{
+
+//! The number of profile bins per cell
+constexpr int c_numBins = c_dlbCostProfileNumBins;
+
+//! Returns a profile with uniform cost density over cells with boundaries \p cellFrac
+std::vector<float> uniformDensityProfile(const std::vector<real>& cellFrac)
+{
+    std::vector<float> profile;
+    for (size_t i = 0; i + 1 < cellFrac.size(); i++)
+    {
+        for (int b = 0; b < c_numBins; b++)
+        {
+            profile.push_back((cellFrac[i + 1] - cellFrac[i]) / c_numBins);
+        }
+    }
+    return profile;
+}
+
+//! Returns a profile with cost \p costPerBin[i] in every bin of cell i
+std::vector<float> cellwiseProfile(const std::vector<float>& costPerBin)
+{
+    std::vector<float> profile;
+    for (float cost : costPerBin)
+    {
+        profile.insert(profile.end(), c_numBins, cost);
+    }
+    return profile;
+}
+
+//! Checks that \p cellSize matches \p reference
+void checkCellSizes(const std::vector<real>& reference, const std::vector<real>& cellSize)
+{
+    ASSERT_EQ(reference.size(), cellSize.size());
+    for (size_t i = 0; i < reference.size(); i++)
+    {
+        EXPECT_REAL_EQ_TOL(reference[i], cellSize[i], absoluteTolerance(1e-5)) << "cell " << i;
+    }
+}
+
+TEST(CostProfileCellSizesTest, UniformProfileKeepsEqualCells)
+{
+    const std::vector<real> cellFrac = { 0, 0.25, 0.5, 0.75, 1 };
+    std::vector<real>       cellSize(4, 0);
+
+    EXPECT_TRUE(setCellSizesFromCostProfile(cellwiseProfile({ 2, 2, 2, 2 }), cellFrac, 4, 0.5,
+                                            0.1, cellSize));
+    checkCellSizes({ 0.25, 0.25, 0.25, 0.25 }, cellSize);
+}
+
+TEST(CostProfileCellSizesTest, UniformDensityEqualizesUnequalCells)
+{
+    const std::vector<real> cellFrac = { 0, 0.2, 0.5, 1 };
+    std::vector<real>       cellSize(3, 0);
+
+    EXPECT_TRUE(setCellSizesFromCostProfile(uniformDensityProfile(cellFrac), cellFrac, 3, 1, 10,
+                                            cellSize));
+    checkCellSizes({ 1.0 / 3, 1.0 / 3, 1.0 / 3 }, cellSize);
+}
+
+TEST(CostProfileCellSizesTest, SkewedProfileMovesBoundaryToEqualCost)
+{
+    /* Cell 0 holds 3/4 of the cost, half the total is at 2/3 of cell 0 */
+    const std::vector<real>  cellFrac = { 0, 0.5, 1 };
+    const std::vector<float> profile  = cellwiseProfile({ 3, 1 });
+    std::vector<real>        cellSize(2, 0);
+
+    EXPECT_TRUE(setCellSizesFromCostProfile(profile, cellFrac, 2, 1, 10, cellSize));
+    checkCellSizes({ 1.0 / 3, 2.0 / 3 }, cellSize);
+}
+
+TEST(CostProfileCellSizesTest, SkewedProfileIsUnderrelaxed)
+{
+    const std::vector<real>  cellFrac = { 0, 0.5, 1 };
+    const std::vector<float> profile  = cellwiseProfile({ 3, 1 });
+    std::vector<real>        cellSize(2, 0);
+
+    /* The relative changes towards the target are -1/3 and 1/3 */
+    EXPECT_TRUE(setCellSizesFromCostProfile(profile, cellFrac, 2, 0.5, 10, cellSize));
+    checkCellSizes({ 5.0 / 12, 7.0 / 12 }, cellSize);
+}
+
+TEST(CostProfileCellSizesTest, SkewedProfileChangeIsLimited)
+{
+    const std::vector<real>  cellFrac = { 0, 0.5, 1 };
+    const std::vector<float> profile  = cellwiseProfile({ 3, 1 });
+    std::vector<real>        cellSize(2, 0);
+
+    EXPECT_TRUE(setCellSizesFromCostProfile(profile, cellFrac, 2, 1, 0.1, cellSize));
+    checkCellSizes({ 0.45, 0.55 }, cellSize);
+}
+
+TEST(CostProfileCellSizesTest, CostInOneCellIsSpreadOverAllCells)
+{
+    /* Only the last cell has cost, the other boundaries move into it */
+    const std::vector<real> cellFrac = { 0, 0.25, 0.5, 1 };
+    std::vector<float>      profile(3 * c_numBins, 0);
+    for (int b = 0; b < c_numBins; b++)
+    {
+        profile[2 * c_numBins + b] = 1;
+    }
+    std::vector<real> cellSize(3, 0);
+
+    EXPECT_TRUE(setCellSizesFromCostProfile(profile, cellFrac, 3, 1, 10, cellSize));
+    checkCellSizes({ 0.5 + 0.5 / 3, 0.5 / 3, 0.5 / 3 }, cellSize);
+}
+
+TEST(CostProfileCellSizesTest, AllCostInOneBinIsLimited)
+{
+    const std::vector<real> cellFrac = { 0, 1.0 / 3, 2.0 / 3, 1 };
+    std::vector<float>      profile(3 * c_numBins, 0);
+    profile[0] = 1;
+    std::vector<real> cellSize(3, 0);
+
+    const real changeLimit = 0.1;
+    EXPECT_TRUE(setCellSizesFromCostProfile(profile, cellFrac, 3, 0.5, changeLimit, cellSize));
+
+    /* The cell sizes still fill the row and the largest change is at the limit */
+    EXPECT_REAL_EQ_TOL(1, std::accumulate(cellSize.begin(), cellSize.end(), real(0)),
+                       absoluteTolerance(1e-5));
+    real changeMax = 0;
+    for (int i = 0; i < 3; i++)
+    {
+        EXPECT_GT(cellSize[i], 0);
+        changeMax = std::max(changeMax, std::abs(cellSize[i] * 3 - 1));
+    }
+    EXPECT_REAL_EQ_TOL(changeLimit, changeMax, absoluteTolerance(1e-5));
+    EXPECT_LT(cellSize[0], cellSize[2]);
+    EXPECT_LT(cellSize[1], cellSize[2]);
+}
+
+TEST(CostProfileCellSizesTest, ZeroProfileLeavesCellSizesUnchanged)
+{
+    const std::vector<real> cellFrac = { 0, 0.4, 1 };
+    std::vector<real>       cellSize = { 0.4, 0.6 };
+
+    EXPECT_FALSE(setCellSizesFromCostProfile(cellwiseProfile({ 0, 0 }), cellFrac, 2, 0.5, 0.1,
+                                             cellSize));
+    checkCellSizes({ 0.4, 0.6 }, cellSize);
+}
+
+TEST(CostProfileCellSizesTest, ProfileOfWrongSizeIsIgnored)
+{
+    /* E.g. when the profiles have not been communicated yet */
+    const std::vector<real> cellFrac = { 0, 0.4, 1 };
+    std::vector<real>       cellSize = { 0.4, 0.6 };
+
+    EXPECT_FALSE(setCellSizesFromCostProfile({}, cellFrac, 2, 0.5, 0.1, cellSize));
+    EXPECT_FALSE(setCellSizesFromCostProfile(cellwiseProfile({ 1 }), cellFrac, 2, 0.5, 0.1,
+                                             cellSize));
+    checkCellSizes({ 0.4, 0.6 }, cellSize);
+}
+
+TEST(CostProfileCellSizesTest, NegativeCostsAfterCounterResetAreIgnored)
+{
+    /* Negative flop count differences after a counter reset with -resetstep
+     * lead to negative bin costs, these should act as zero cost.
+     */
+    const std::vector<real> cellFrac = { 0, 0.5, 1 };
+    std::vector<real>       cellSizeNegative(2, 0);
+    std::vector<real>       cellSizeZero(2, 0);
+
+    EXPECT_TRUE(setCellSizesFromCostProfile(cellwiseProfile({ 3, -5 }), cellFrac, 2, 0.5, 10,
+                                            cellSizeNegative));
+    EXPECT_TRUE(setCellSizesFromCostProfile(cellwiseProfile({ 3, 0 }), cellFrac, 2, 0.5, 10,
+                                            cellSizeZero));
+    checkCellSizes(cellSizeZero, cellSizeNegative);
+
+    std::vector<real> cellSize = { 0.4, 0.6 };
+    EXPECT_FALSE(setCellSizesFromCostProfile(cellwiseProfile({ -1, -2 }), cellFrac, 2, 0.5, 0.1,
+                                             cellSize));
+    checkCellSizes({ 0.4, 0.6 }, cellSize);
+}
+
+} // namespace
+} // namespace test
+} // namespace gmx
@@ -0,0 +1,242 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2020, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests that the non-blocking coordinate halo exchange gives the same
+ * coordinates as the blocking one.
+ *
+ * \ingroup module_domdec
+ */
+#include "gmxpre.h"
+
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/domdec/atomdistribution.h"
+#include "gromacs/domdec/domdec.h"
+#include "gromacs/domdec/domdec_internal.h"
+#include "gromacs/domdec/domdec_struct.h"
+#include "gromacs/domdec/gpuhaloexchange.h"
+#include "gromacs/math/vec.h"
+#include "gromacs/mdtypes/inputrec.h"
+#include "gromacs/utility/gmxmpi.h"
+
+#include "testutils/mpitest.h"
+#include "testutils/testasserts.h"
+
+namespace gmx
+{
+namespace test
+{
+namespace
+{
+
+//! The number of home atoms of rank \p rank
+int numHomeAtoms(int rank)
+{
+    return 5 + rank;
+}
+
+//! The number of atoms rank \p rank sends from zone \p zone in pulse \p pulse along dimension index \p d
+int numAtomsToSend(int rank, int d, int pulse, int zone)
+{
+    return 1 + (rank + d + 2 * pulse + zone) % 3;
+}
+
+/*! \brief Sets up the halo communication for the Cartesian rank grid \p numCells
+ *
+ * Every dimension with more than one cell uses \p numPulses pulses.
+ * The atom indices to send are chosen such that later pulses forward
+ * coordinates received in earlier pulses. When \p receiveInPlace is
+ * false, the zones are unpacked in reverse order, so the unpacking
+ * differs from receiving in place.
+ */
+void setUpHalo(gmx_domdec_t* dd, const ivec numCells, int numPulses, bool receiveInPlace)
+{
+    MPI_Comm_rank(MPI_COMM_WORLD, &dd->rank);
+    dd->mpi_comm_all = MPI_COMM_WORLD;
+
+    copy_ivec(numCells, dd->nc);
+    dd->ci[XX] = dd->rank / (numCells[YY] * numCells[ZZ]);
+    dd->ci[YY] = (dd->rank / numCells[ZZ]) % numCells[YY];
+    dd->ci[ZZ] = dd->rank % numCells[ZZ];
+
+    dd->ndim = 0;
+    for (int dim = 0; dim < DIM; dim++)
+    {
+        if (numCells[dim] > 1)
+        {
+            dd->dim[dd->ndim++] = dim;
+        }
+    }
+
+    /* Returns the rank of the cell shifted by one along dim in direction dir */
+    auto neighborRank = [dd](int dim, int dir) {
+        ivec ci;
+        copy_ivec(dd->ci, ci);
+        ci[dim] = (ci[dim] + dir + dd->nc[dim]) % dd->nc[dim];
+        return (ci[XX] * dd->nc[YY] + ci[YY]) * dd->nc[ZZ] + ci[ZZ];
+    };
+
+    gmx_domdec_comm_t* comm = dd->comm;
+    comm->atomRanges.setEnd(DDAtomRanges::Type::Home, numHomeAtoms(dd->rank));
+
+    int numZones = 1;
+    int numAtoms = numHomeAtoms(dd->rank);
+    for (int d = 0; d < dd->ndim; d++)
+    {
+        const int dim       = dd->dim[d];
+        dd->neighbor[d][0]  = neighborRank(dim, 1);
+        dd->neighbor[d][1]  = neighborRank(dim, -1);
+        const int fromRank = dd->neighbor[d][0];
+
+        gmx_domdec_comm_dim_t& cd = comm->cd[d];
+        cd.receiveInPlace         = receiveInPlace;
+        cd.ind.resize(numPulses);
+        for (int p = 0; p < numPulses; p++)
+        {
+            gmx_domdec_ind_t& ind = cd.ind[p];
+
+            ind.index.clear();
+            int numSendTotal = 0;
+            int numRecvTotal = 0;
+            for (int zone = 0; zone < numZones; zone++)
+            {
+                ind.nsend[zone] = numAtomsToSend(dd->rank, d, p, zone);
+                ind.nrecv[zone] = numAtomsToSend(fromRank, d, p, zone);
+                for (int k = 0; k < ind.nsend[zone]; k++)
+                {
+                    /* Count down from the last atom, which was received in the previous pulse */
+                    ind.index.push_back(numAtoms - 1 - (2 * (numSendTotal + k)) % numAtoms);
+                }
+                numSendTotal += ind.nsend[zone];
+                numRecvTotal += ind.nrecv[zone];
+            }
+            ind.nsend[numZones + 1] = numSendTotal;
+            ind.nrecv[numZones + 1] = numRecvTotal;
+
+            int atomIndex = numAtoms;
+            for (int zone = numZones - 1; zone >= 0; zone--)
+            {
+                ind.cell2at0[zone] = atomIndex;
+                atomIndex += ind.nrecv[zone];
+                ind.cell2at1[zone] = atomIndex;
+            }
+            numAtoms += numRecvTotal;
+        }
+        numZones += numZones;
+    }
+    comm->atomRanges.setEnd(DDAtomRanges::Type::Zones, numAtoms);
+}
+
+//! Returns coordinates with unique home atom values and the halo set to -1
+std::vector<RVec> initialCoordinates(const gmx_domdec_t& dd)
+{
+    std::vector<RVec> x(dd.comm->atomRanges.end(DDAtomRanges::Type::Zones), { -1, -1, -1 });
+    for (int a = 0; a < dd.comm->atomRanges.numHomeAtoms(); a++)
+    {
+        x[a] = { real(dd.rank), real(a), real(0.5 * a) };
+    }
+    return x;
+}
+
+/*! \brief Checks that the non-blocking halo exchange gives the same coordinates as dd_move_x */
+void checkHaloExchange(const ivec numCells, int numPulses, bool receiveInPlace)
+{
+    t_inputrec        ir;
+    gmx_domdec_comm_t comm;
+    gmx_domdec_t      dd(ir);
+    dd.comm = &comm;
+    setUpHalo(&dd, numCells, numPulses, receiveInPlace);
+
+    const matrix box = { { 4, 0, 0 }, { 0, 5, 0 }, { 0, 0, 6 } };
+
+    std::vector<RVec> xBlocking = initialCoordinates(dd);
+    dd_move_x(&dd, box, xBlocking, nullptr);
+    for (int a = comm.atomRanges.numHomeAtoms(); a < gmx::ssize(xBlocking); a++)
+    {
+        EXPECT_NE(xBlocking[a][XX], -1) << "Halo atom " << a << " should have been received";
+    }
+
+    std::vector<RVec> xNonBlocking = initialCoordinates(dd);
+    dd_move_x_start(&dd, box, xNonBlocking, nullptr);
+    dd_move_x_finish(&dd, box, xNonBlocking, nullptr);
+
+    ASSERT_EQ(xNonBlocking.size(), xBlocking.size());
+    for (size_t a = 0; a < xBlocking.size(); a++)
+    {
+        for (int d = 0; d < DIM; d++)
+        {
+            EXPECT_EQ(xNonBlocking[a][d], xBlocking[a][d]) << "Atom " << a << " dimension " << d;
+        }
+    }
+}
+
+TEST(HaloExchangeTest, NonBlockingMatchesBlockingOneDimension)
+{
+    GMX_MPI_TEST(4);
+
+    const ivec numCells = { 4, 1, 1 };
+    checkHaloExchange(numCells, 2, true);
+}
+
+TEST(HaloExchangeTest, NonBlockingMatchesBlockingOneDimensionNotInPlace)
+{
+    GMX_MPI_TEST(4);
+
+    const ivec numCells = { 4, 1, 1 };
+    checkHaloExchange(numCells, 3, false);
+}
+
+TEST(HaloExchangeTest, NonBlockingMatchesBlockingTwoDimensions)
+{
+    GMX_MPI_TEST(4);
+
+    const ivec numCells = { 2, 2, 1 };
+    checkHaloExchange(numCells, 1, false);
+}
+
+TEST(HaloExchangeTest, NonBlockingMatchesBlockingTwoDimensionsTwoPulses)
+{
+    GMX_MPI_TEST(4);
+
+    const ivec numCells = { 1, 2, 2 };
+    checkHaloExchange(numCells, 2, true);
+}
+
+} // namespace
+} // namespace test
+} // namespace gmx
@@ -0,0 +1,292 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2020, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests for the generation of the local topology with domain decomposition.
+ *
+ * \ingroup module_domdec
+ */
+#include "gmxpre.h"
+
+#include <memory>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/domdec/atomdistribution.h"
+#include "gromacs/domdec/domdec.h"
+#include "gromacs/domdec/domdec_internal.h"
+#include "gromacs/domdec/domdec_struct.h"
+#include "gromacs/domdec/ga2la.h"
+#include "gromacs/domdec/gpuhaloexchange.h"
+#include "gromacs/math/vec.h"
+#include "gromacs/mdlib/gmx_omp_nthreads.h"
+#include "gromacs/mdtypes/forcerec.h"
+#include "gromacs/mdtypes/inputrec.h"
+#include "gromacs/topology/ifunc.h"
+#include "gromacs/topology/mtop_util.h"
+#include "gromacs/topology/topology.h"
+
+#include "testutils/testasserts.h"
+
+namespace gmx
+{
+namespace test
+{
+namespace
+{
+
+//! The number of atoms in the chain molecule
+constexpr int c_numAtomsPerMolecule = 6;
+//! The number of chain molecules
+constexpr int c_numMolecules = 4;
+
+/*! \brief Fills \p mtop with linear chains with bonds, angles and dihedrals
+ *
+ * Every interaction uses its own parameter type, so the types in the
+ * local topology identify the interactions.
+ */
+void fillChainSystem(gmx_mtop_t* mtop)
+{
+    mtop->moltype.resize(1);
+    gmx_moltype_t& moltype = mtop->moltype[0];
+    moltype.atoms.nr       = c_numAtomsPerMolecule;
+    for (int a = 0; a < c_numAtomsPerMolecule; a++)
+    {
+        const int ftypes[] = { F_BONDS, F_ANGLES, F_PDIHS };
+        for (int ftype : ftypes)
+        {
+            const int nral = NRAL(ftype);
+            if (a + nral <= c_numAtomsPerMolecule)
+            {
+                moltype.ilist[ftype].iatoms.push_back(mtop->ffparams.numTypes());
+                for (int k = 0; k < nral; k++)
+                {
+                    moltype.ilist[ftype].iatoms.push_back(a + k);
+                }
+                mtop->ffparams.functype.push_back(ftype);
+                mtop->ffparams.iparams.push_back({});
+            }
+        }
+    }
+
+    gmx_molblock_t molblock;
+    molblock.type = 0;
+    molblock.nmol = c_numMolecules;
+    mtop->molblock.push_back(molblock);
+    mtop->natoms = c_numMolecules * c_numAtomsPerMolecule;
+    gmx_mtop_finalize(mtop);
+}
+
+/*! \brief Generates local topologies for a single domain decomposition cell
+ *
+ * With a single cell all local atoms are home atoms, so the home zone
+ * interactions, which are the only ones that are cached, cover all
+ * interactions.
+ */
+class LocalTopologyBuilder
+{
+public:
+    //! Constructor
+    LocalTopologyBuilder(const gmx_mtop_t& mtop) : mtop_(mtop), dd_(ir_)
+    {
+        dd_.comm   = &comm_;
+        dd_.nc[XX] = 1;
+        dd_.nc[YY] = 1;
+        dd_.nc[ZZ] = 1;
+        dd_make_reverse_top(nullptr, &dd_, &mtop_, nullptr, &ir_, TRUE);
+        ga2la_    = std::make_unique<gmx_ga2la_t>(mtop_.natoms, mtop_.natoms);
+        dd_.ga2la = ga2la_.get();
+        dd_init_local_top(mtop_, &ltop_);
+    }
+
+    //! Generates the local topology with home atoms \p homeAtoms, in this order
+    const t_idef& makeLocalTopology(const std::vector<int>& homeAtoms)
+    {
+        const int numHomeAtoms = homeAtoms.size();
+
+        dd_.globalAtomIndices = homeAtoms;
+        ga2la_->clear();
+        for (int a = 0; a < numHomeAtoms; a++)
+        {
+            ga2la_->insert(homeAtoms[a], { a, 0 });
+        }
+        dd_.ncg_home = numHomeAtoms;
+
+        zones_.n           = 1;
+        zones_.cg_range[0] = 0;
+        zones_.cg_range[1] = numHomeAtoms;
+        zones_.iZones.resize(1);
+        zones_.iZones[0].iZoneIndex = 0;
+        zones_.iZones[0].jZoneRange = gmx::Range<int>(0, 1);
+        zones_.iZones[0].iAtomRange = gmx::Range<int>(0, numHomeAtoms);
+        zones_.iZones[0].jAtomRange = gmx::Range<int>(0, numHomeAtoms);
+
+        fr_.cginfo.assign(numHomeAtoms, 0);
+        x_.assign(numHomeAtoms, { 0, 0, 0 });
+
+        matrix box         = { { 10, 0, 0 }, { 0, 10, 0 }, { 0, 0, 10 } };
+        rvec   cellsizeMin = { 10, 10, 10 };
+        ivec   npulse      = { 1, 1, 1 };
+        dd_make_local_top(&dd_, &zones_, DIM, box, cellsizeMin, npulse, &fr_,
+                          as_rvec_array(x_.data()), mtop_, &ltop_);
+
+        return ltop_.idef;
+    }
+
+    //! Returns the number of local bonded interactions
+    int numBondedLocal() const { return dd_.nbonded_local; }
+
+private:
+    //! The global topology
+    const gmx_mtop_t& mtop_;
+    //! The input record, only used for setting up the domain decomposition
+    t_inputrec ir_;
+    //! The domain decomposition communication data
+    gmx_domdec_comm_t comm_;
+    //! The domain decomposition data
+    gmx_domdec_t dd_;
+    //! The global to local atom lookup
+    std::unique_ptr<gmx_ga2la_t> ga2la_;
+    //! The zone setup
+    gmx_domdec_zones_t zones_;
+    //! The force record, only the cginfo is used
+    t_forcerec fr_;
+    //! The local coordinates, not used with a single cell
+    std::vector<RVec> x_;
+    //! The local topology
+    gmx_localtop_t ltop_;
+};
+
+//! Returns all atoms of molecule \p molecule, in reverse order when \p reverse is true
+std::vector<int> moleculeAtoms(int molecule, bool reverse)
+{
+    std::vector<int> atoms;
+    for (int a = 0; a < c_numAtomsPerMolecule; a++)
+    {
+        atoms.push_back(molecule * c_numAtomsPerMolecule
+                        + (reverse ? c_numAtomsPerMolecule - 1 - a : a));
+    }
+    return atoms;
+}
+
+//! Appends \p atoms to \p homeAtoms
+void append(std::vector<int>* homeAtoms, const std::vector<int>& atoms)
+{
+    homeAtoms->insert(homeAtoms->end(), atoms.begin(), atoms.end());
+}
+
+/*! \brief Returns a sequence of home atom lists
+ *
+ * Atoms change order between partitionings and molecules are
+ * partially home, so the cache is used for some atoms and rejected
+ * for others because their interaction partners moved out.
+ */
+std::vector<std::vector<int>> partitionings()
+{
+    std::vector<std::vector<int>> homeAtomLists;
+
+    std::vector<int> homeAtoms;
+    append(&homeAtoms, moleculeAtoms(0, false));
+    append(&homeAtoms, moleculeAtoms(1, false));
+    append(&homeAtoms, moleculeAtoms(2, false));
+    append(&homeAtoms, { 18, 19, 20 });
+    homeAtomLists.push_back(homeAtoms);
+
+    homeAtoms.clear();
+    append(&homeAtoms, moleculeAtoms(3, false));
+    append(&homeAtoms, moleculeAtoms(1, true));
+    append(&homeAtoms, { 12, 13, 15 });
+    append(&homeAtoms, moleculeAtoms(0, true));
+    homeAtomLists.push_back(homeAtoms);
+
+    homeAtoms.clear();
+    append(&homeAtoms, { 2, 3, 4, 5 });
+    append(&homeAtoms, moleculeAtoms(2, false));
+    append(&homeAtoms, moleculeAtoms(3, true));
+    append(&homeAtoms, moleculeAtoms(1, false));
+    homeAtomLists.push_back(homeAtoms);
+
+    homeAtomLists.push_back(homeAtomLists[0]);
+
+    return homeAtomLists;
+}
+
+//! Test fixture, the parameter is the number of OpenMP threads for domain decomposition
+class LocalTopologyTest : public ::testing::TestWithParam<int>
+{
+};
+
+TEST_P(LocalTopologyTest, IncrementalUpdateMatchesFullRebuild)
+{
+    gmx_omp_nthreads_set(emntDomdec, GetParam());
+
+    gmx_mtop_t mtop;
+    fillChainSystem(&mtop);
+
+    /* This builder keeps its cache of home interactions between partitionings */
+    LocalTopologyBuilder incrementalBuilder(mtop);
+
+    for (const std::vector<int>& homeAtoms : partitionings())
+    {
+        SCOPED_TRACE(::testing::Message() << "With " << homeAtoms.size() << " home atoms");
+
+        const t_idef& incrementalIdef = incrementalBuilder.makeLocalTopology(homeAtoms);
+
+        LocalTopologyBuilder fullBuilder(mtop);
+        const t_idef&        fullIdef = fullBuilder.makeLocalTopology(homeAtoms);
+
+        EXPECT_EQ(incrementalBuilder.numBondedLocal(), fullBuilder.numBondedLocal());
+        for (int ftype = 0; ftype < F_NRE; ftype++)
+        {
+            SCOPED_TRACE(::testing::Message()
+                         << "Interaction type " << interaction_function[ftype].name);
+
+            const t_ilist& incrementalList = incrementalIdef.il[ftype];
+            const t_ilist& fullList        = fullIdef.il[ftype];
+            ASSERT_EQ(incrementalList.nr, fullList.nr);
+            for (int i = 0; i < fullList.nr; i++)
+            {
+                EXPECT_EQ(incrementalList.iatoms[i], fullList.iatoms[i]);
+            }
+        }
+    }
+}
+
+INSTANTIATE_TEST_CASE_P(WithThreads, LocalTopologyTest, ::testing::Values(1, 2));
+
+} // namespace
+} // namespace test
+} // namespace gmx
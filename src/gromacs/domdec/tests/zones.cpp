@@ -0,0 +1,178 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2020, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests for the domain decomposition zone and zone-pair setup.
+ *
+ * \ingroup module_domdec
+ */
+#include "gmxpre.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <map>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/domdec/domdec_internal.h"
+
+#include "testutils/testasserts.h"
+
+namespace gmx
+{
+namespace test
+{
+namespace
+{
+
+//! The shift of a zone along the DD dimensions
+using ZoneShift = std::vector<int>;
+
+//! Returns the shift that is minus \p shift
+ZoneShift negated(const ZoneShift& shift)
+{
+    ZoneShift result;
+    for (int s : shift)
+    {
+        result.push_back(-s);
+    }
+    return result;
+}
+
+/*! \brief Returns how often each pair of cells is computed, indexed by the cell offset
+ *
+ * Offsets with opposite signs describe the same cell pair, so they are
+ * counted together under the largest of the two.
+ */
+std::map<ZoneShift, int> countCellPairs(const std::vector<ZoneShift>& zoneShifts,
+                                        const int (*zonePairRanges)[3],
+                                        int numIZones)
+{
+    const int numZones = zoneShifts.size();
+
+    std::map<ZoneShift, int> count;
+    for (int iZone = 0; iZone < numIZones; iZone++)
+    {
+        EXPECT_EQ(zonePairRanges[iZone][0], iZone);
+        for (int jZone = zonePairRanges[iZone][1];
+             jZone < std::min(zonePairRanges[iZone][2], numZones); jZone++)
+        {
+            ZoneShift offset;
+            for (size_t d = 0; d < zoneShifts[iZone].size(); d++)
+            {
+                offset.push_back(zoneShifts[jZone][d] - zoneShifts[iZone][d]);
+            }
+            count[std::max(offset, negated(offset))]++;
+        }
+    }
+    return count;
+}
+
+//! Checks that all pairs of cells that are at most one cell apart are computed exactly once
+void checkAllCellPairsComputedOnce(const std::map<ZoneShift, int>& count, int numDims)
+{
+    int numOffsets = 1;
+    for (int d = 0; d < numDims; d++)
+    {
+        numOffsets *= 3;
+    }
+    /* The zero offset plus half of the non-zero offsets */
+    EXPECT_EQ(count.size(), (numOffsets + 1) / 2);
+    for (const auto& entry : count)
+    {
+        for (int s : entry.first)
+        {
+            EXPECT_LE(std::abs(s), 1);
+        }
+        EXPECT_EQ(entry.second, 1) << "Cell pairs should be computed exactly once";
+    }
+}
+
+TEST(DomainDecompositionZonesTest, EighthShellComputesAllCellPairsOnce)
+{
+    for (int numDims = 1; numDims <= DIM; numDims++)
+    {
+        SCOPED_TRACE(::testing::Message() << "With " << numDims << " DD dimensions");
+
+        std::vector<ZoneShift> zoneShifts;
+        for (int zone = 0; zone < (1 << numDims); zone++)
+        {
+            zoneShifts.emplace_back(dd_zo[zone], dd_zo[zone] + numDims);
+        }
+        const int numIZones = (1 << std::max(numDims - 1, 0));
+
+        checkAllCellPairsComputedOnce(
+                countCellPairs(zoneShifts, ddNonbondedZonePairRanges, numIZones), numDims);
+    }
+}
+
+TEST(DomainDecompositionZonesTest, NeutralTerritoryComputesAllCellPairsOnce)
+{
+    std::vector<ZoneShift> zoneShifts;
+    for (const auto& shift : ddNeutralTerritoryZoneShifts)
+    {
+        zoneShifts.emplace_back(shift, shift + 2);
+    }
+
+    checkAllCellPairsComputedOnce(
+            countCellPairs(zoneShifts, ddNeutralTerritoryZonePairRanges, DD_MAXIZONE), 2);
+}
+
+TEST(DomainDecompositionZonesTest, NeutralTerritoryDoesNotUseCornerForNonbondeds)
+{
+    const int cornerZone = 2;
+    EXPECT_EQ(ddNeutralTerritoryZoneShifts[cornerZone][0], 1);
+    EXPECT_EQ(ddNeutralTerritoryZoneShifts[cornerZone][1], 1);
+    EXPECT_EQ(ddNeutralTerritoryZoneShifts[c_lowerTowerZone][0], 0);
+    EXPECT_EQ(ddNeutralTerritoryZoneShifts[c_lowerTowerZone][1], -1);
+
+    for (const auto& range : ddNeutralTerritoryZonePairRanges)
+    {
+        if (range[0] == cornerZone)
+        {
+            EXPECT_EQ(range[1], range[2]) << "The corner zone should not have j-zones";
+        }
+        else
+        {
+            EXPECT_FALSE(range[1] <= cornerZone && cornerZone < range[2])
+                    << "The corner zone should not be a j-zone";
+        }
+    }
+}
+
+} // namespace
+} // namespace test
+} // namespace gmx
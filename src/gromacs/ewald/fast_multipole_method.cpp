@@ -0,0 +1,1615 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2020, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ *
+ * \brief This file defines the fast multipole method (FMM) for
+ * long-ranged electrostatics.
+ *
+ * The expansions are Cartesian Taylor expansions up to a total degree
+ * given by the order. With multipole moments m_k = sum_j q_j (y_j - z)^k
+ * around center z, the potential at x is sum_k m_k a_k(x - z), with
+ * a_k the Taylor coefficients of 1/|x - y| with respect to y, which
+ * are computed with the recurrence of Z.-H. Duan and R. Krasny,
+ * J. Comput. Chem. 22, 184 (2001).
+ * Periodic images beyond the tree are summed with the hierarchical
+ * scheme of C. G. Lambert, T. A. Darden and J. A. Board,
+ * J. Comput. Phys. 126, 274 (1996), where supercells of images are
+ * built up level by level from the root multipole.
+ *
+ * \ingroup module_ewald
+ */
+#include "gmxpre.h"
+
+#include "fast_multipole_method.h"
+
+#include "config.h"
+
+#include <cmath>
+
+#include <algorithm>
+
+#include "gromacs/math/functions.h"
+#include "gromacs/math/units.h"
+#include "gromacs/math/vec.h"
+#include "gromacs/mdtypes/commrec.h"
+#include "gromacs/mdtypes/inputrec.h"
+#include "gromacs/mdtypes/md_enums.h"
+#include "gromacs/pbcutil/pbc.h"
+#include "gromacs/utility/exceptions.h"
+#include "gromacs/utility/fatalerror.h"
+#include "gromacs/utility/gmxassert.h"
+#include "gromacs/utility/gmxmpi.h"
+
+//! The number of levels of supercells of periodic images summed beyond the tree
+static constexpr int c_numLatticeLevels = 5;
+//! The minimum leaf cell size relative to the cut-off distance
+static constexpr double c_minLeafSizeOverCutoff = 0.5;
+//! We limit the number of leaf cells to the number of atoms divided by this value
+static constexpr int c_minAverageAtomsPerLeaf = 4;
+/*! \brief Levels with at most this number of cells have their multipoles summed over all ranks
+ *
+ * At these levels the interaction range of a cell covers most of the box.
+ */
+static constexpr int c_maxNumGloballyReducedCells = 64;
+
+//! MPI tags for the halo communication
+enum
+{
+    c_fmmCountTag = 1000,
+    c_fmmAtomTag,
+    c_fmmCellTag,
+    c_fmmMultipoleTag
+};
+
+//! Returns the binomial coefficient n over k
+static double binomial(int n, int k)
+{
+    double result = 1;
+    for (int i = 1; i <= k; i++)
+    {
+        result = result * (n - k + i) / i;
+    }
+    return result;
+}
+
+/*! \brief Returns the near range, in cells, along each dimension for cells of size \p cellSize
+ *
+ * Cells that are not near are separated by at least \p rCoulomb along some
+ * dimension and their centers are at least twice the largest cell size
+ * apart, which gives the same convergence of the expansions as for cubic cells.
+ * Along non-periodic dimensions with only one cell, the range is irrelevant.
+ */
+static std::array<int, DIM> nearRange(const std::array<double, DIM>& cellSize, double rCoulomb)
+{
+    const double maxCellSize = std::max({ cellSize[XX], cellSize[YY], cellSize[ZZ] });
+
+    std::array<int, DIM> range;
+    for (int d = 0; d < DIM; d++)
+    {
+        /* Use a tolerance on the size ratio, which only affects the accuracy,
+         * but not on the cut-off, which affects the correctness.
+         */
+        range[d] = std::max(static_cast<int>(std::ceil(2 * maxCellSize / cellSize[d] - 1e-6)) - 1,
+                            static_cast<int>(std::ceil(rCoulomb / cellSize[d])));
+    }
+    return range;
+}
+
+//! Returns the cell index along a dimension with \p numCells cells of an unwrapped index
+static inline int wrapIndex(int index, int numCells)
+{
+    return ((index % numCells) + numCells) % numCells;
+}
+
+//! Returns the periodic image shift along a dimension with \p numCells cells of an unwrapped index
+static inline int imageShift(int index, int numCells)
+{
+    return (index - wrapIndex(index, numCells)) / numCells;
+}
+
+//! Returns the total number of cells for a grid with \p numCells cells along each dimension
+static inline int totalNumCells(const std::array<int, DIM>& numCells)
+{
+    return numCells[XX] * numCells[YY] * numCells[ZZ];
+}
+
+//! Returns the cell number of the cell with grid index \p index
+static inline int cellNumber(const std::array<int, DIM>& numCells,
+                             const std::array<int, DIM>& index)
+{
+    return (index[XX] * numCells[YY] + index[YY]) * numCells[ZZ] + index[ZZ];
+}
+
+//! Returns the grid index of cell number \p cell
+static inline std::array<int, DIM> cellIndex(const std::array<int, DIM>& numCells, int cell)
+{
+    return { cell / (numCells[YY] * numCells[ZZ]), (cell / numCells[ZZ]) % numCells[YY],
+             cell % numCells[ZZ] };
+}
+
+//! A periodic range of cell indices along one dimension
+struct CellRange
+{
+    //! The first index, between 0 and the number of cells
+    int start;
+    //! The number of indices, 0 for an empty range
+    int length;
+};
+
+//! A box of cells given by a range along each dimension
+using CellBox = std::array<CellRange, DIM>;
+
+//! Returns the shortest periodic range that covers the indices that have \p isOccupied set
+static CellRange coveringRange(const std::vector<bool>& isOccupied)
+{
+    const int numCells = isOccupied.size();
+    const int first    = std::find(isOccupied.begin(), isOccupied.end(), true) - isOccupied.begin();
+    if (first == numCells)
+    {
+        return { 0, 0 };
+    }
+
+    /* Find the longest periodic gap, the walk ends at the occupied index we start from */
+    int gapStart  = 0;
+    int gapLength = 0;
+    int runLength = 0;
+    for (int k = 1; k <= numCells; k++)
+    {
+        if (!isOccupied[(first + k) % numCells])
+        {
+            runLength++;
+        }
+        else
+        {
+            if (runLength > gapLength)
+            {
+                gapStart  = first + k - runLength;
+                gapLength = runLength;
+            }
+            runLength = 0;
+        }
+    }
+
+    return { wrapIndex(gapStart + gapLength, numCells), numCells - gapLength };
+}
+
+//! Returns whether \p index is in the periodic range \p range with \p numCells cells
+static inline bool rangeContains(const CellRange& range, int index, int numCells)
+{
+    return wrapIndex(index - range.start, numCells) < range.length;
+}
+
+//! Returns whether boxes \p a and \p b of a grid with \p numCells cells have cells in common
+static bool boxesOverlap(const CellBox& a, const CellBox& b, const std::array<int, DIM>& numCells)
+{
+    for (int d = 0; d < DIM; d++)
+    {
+        if (a[d].length == 0 || b[d].length == 0
+            || !(rangeContains(a[d], b[d].start, numCells[d])
+                 || rangeContains(b[d], a[d].start, numCells[d])))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+//! Returns whether the cell with grid index \p index is in \p box
+static bool boxContains(const CellBox&              box,
+                        const std::array<int, DIM>& index,
+                        const std::array<int, DIM>& numCells)
+{
+    for (int d = 0; d < DIM; d++)
+    {
+        if (!rangeContains(box[d], index[d], numCells[d]))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+FastMultipoleMethod::FastMultipoleMethod(const t_inputrec& ir,
+                                         const int         numAtomsGlobal,
+                                         const real        rCoulomb,
+                                         const int         numThreads,
+                                         FILE*             fplog) :
+    order_(ir.fmm_order),
+    numAtomsGlobal_(numAtomsGlobal),
+    rCoulomb_(rCoulomb),
+    numThreads_(numThreads),
+    boxDiag_({ 0, 0, 0 }),
+    shapeCorrection_({ 0, 0, 0 }),
+    numGloballyReducedLevels_(0),
+    numHomeAtoms_(0)
+{
+    GMX_RELEASE_ASSERT(order_ >= 1, "The FMM order should be positive");
+    GMX_RELEASE_ASSERT(ir.ePBC == epbcXYZ || ir.ePBC == epbcXY,
+                       "The FMM only supports pbc=xyz and pbc=xy");
+
+    for (int d = 0; d < DIM; d++)
+    {
+        isPeriodic_[d] = (d < ZZ || ir.ePBC == epbcXYZ);
+    }
+
+    /* Enumerate the multi-indices ordered by total degree,
+     * as required by the recurrence for the Taylor coefficients.
+     */
+    const int n = order_ + 1;
+    termIndex_.assign(n * n * n, -1);
+    for (int degree = 0; degree <= order_; degree++)
+    {
+        for (int kx = degree; kx >= 0; kx--)
+        {
+            for (int ky = degree - kx; ky >= 0; ky--)
+            {
+                const int kz = degree - kx - ky;
+
+                termIndex_[(kx * n + ky) * n + kz] = terms_.size();
+                terms_.push_back({ kx, ky, kz });
+            }
+        }
+    }
+    numTerms_ = terms_.size();
+
+    auto indexOf = [this, n](const std::array<int, DIM>& k) {
+        return termIndex_[(k[XX] * n + k[YY]) * n + k[ZZ]];
+    };
+
+    lowerIndex_.resize(numTerms_);
+    for (int t = 0; t < numTerms_; t++)
+    {
+        for (int d = 0; d < DIM; d++)
+        {
+            std::array<int, DIM> k = terms_[t];
+            if (k[d] > 0)
+            {
+                k[d]--;
+                lowerIndex_[t][d] = indexOf(k);
+            }
+            else
+            {
+                lowerIndex_[t][d] = -1;
+            }
+        }
+    }
+
+    for (int a = 0; a < numTerms_; a++)
+    {
+        const std::array<int, DIM>& alpha = terms_[a];
+        for (int b = 0; b < numTerms_; b++)
+        {
+            const std::array<int, DIM>& beta = terms_[b];
+            if (beta[XX] <= alpha[XX] && beta[YY] <= alpha[YY] && beta[ZZ] <= alpha[ZZ])
+            {
+                TermPair pair;
+                pair.first    = a;
+                pair.second   = b;
+                pair.combined = indexOf(
+                        { alpha[XX] - beta[XX], alpha[YY] - beta[YY], alpha[ZZ] - beta[ZZ] });
+                pair.factor   = 1;
+                for (int d = 0; d < DIM; d++)
+                {
+                    pair.factor *= binomial(alpha[d], beta[d]);
+                }
+                shiftPairs_.push_back(pair);
+            }
+        }
+    }
+
+    for (int a = 0; a < numTerms_; a++)
+    {
+        const std::array<int, DIM>& k = terms_[a];
+        for (int b = 0; b < numTerms_; b++)
+        {
+            const std::array<int, DIM>& beta = terms_[b];
+            if (k[XX] + k[YY] + k[ZZ] + beta[XX] + beta[YY] + beta[ZZ] <= order_)
+            {
+                TermPair pair;
+                pair.first    = a;
+                pair.second   = b;
+                pair.combined = indexOf({ k[XX] + beta[XX], k[YY] + beta[YY], k[ZZ] + beta[ZZ] });
+                pair.factor   = ((beta[XX] + beta[YY] + beta[ZZ]) % 2 == 0 ? 1 : -1);
+                for (int d = 0; d < DIM; d++)
+                {
+                    pair.factor *= binomial(k[d] + beta[d], beta[d]);
+                }
+                m2lPairs_.push_back(pair);
+            }
+        }
+    }
+
+    if (fplog)
+    {
+        fprintf(fplog,
+                "Will do fast multipole electrostatics beyond %g nm with expansions of order %d "
+                "(%d terms).\n",
+                rCoulomb, order_, numTerms_);
+    }
+}
+
+gmx::DVec FastMultipoleMethod::cellCenter(const Level&                level,
+                                          const std::array<int, DIM>& index) const
+{
+    return { (index[XX] + 0.5) * level.cellSize[XX], (index[YY] + 0.5) * level.cellSize[YY],
+             (index[ZZ] + 0.5) * level.cellSize[ZZ] };
+}
+
+void FastMultipoleMethod::computeMonomials(const gmx::DVec& d, double* monomials) const
+{
+    std::array<std::vector<double>, DIM> powers;
+    for (int dim = 0; dim < DIM; dim++)
+    {
+        powers[dim].resize(order_ + 1);
+        powers[dim][0] = 1;
+        for (int i = 1; i <= order_; i++)
+        {
+            powers[dim][i] = powers[dim][i - 1] * d[dim];
+        }
+    }
+    for (int t = 0; t < numTerms_; t++)
+    {
+        monomials[t] = powers[XX][terms_[t][XX]] * powers[YY][terms_[t][YY]]
+                       * powers[ZZ][terms_[t][ZZ]];
+    }
+}
+
+void FastMultipoleMethod::computeTaylorCoefficients(const gmx::DVec& r, double* coefficients) const
+{
+    const double r2 = norm2(r);
+
+    coefficients[0] = 1 / std::sqrt(r2);
+    for (int t = 1; t < numTerms_; t++)
+    {
+        const std::array<int, DIM>& k      = terms_[t];
+        const int                   degree = k[XX] + k[YY] + k[ZZ];
+
+        double sumFirst  = 0;
+        double sumSecond = 0;
+        for (int d = 0; d < DIM; d++)
+        {
+            const int lower = lowerIndex_[t][d];
+            if (lower >= 0)
+            {
+                sumFirst += r[d] * coefficients[lower];
+                if (k[d] >= 2)
+                {
+                    sumSecond += coefficients[lowerIndex_[lower][d]];
+                }
+            }
+        }
+        coefficients[t] = ((2 * degree - 1) * sumFirst - (degree - 1) * sumSecond) / (degree * r2);
+    }
+}
+
+void FastMultipoleMethod::multipoleToMultipole(const double*    source,
+                                               const gmx::DVec& d,
+                                               double*          dest,
+                                               double*          monomials) const
+{
+    computeMonomials(d, monomials);
+
+    for (const TermPair& pair : shiftPairs_)
+    {
+        dest[pair.first] += pair.factor * monomials[pair.combined] * source[pair.second];
+    }
+}
+
+void FastMultipoleMethod::multipoleToLocal(const double*    source,
+                                           const gmx::DVec& r,
+                                           double*          dest,
+                                           double*          coefficients) const
+{
+    computeTaylorCoefficients(r, coefficients);
+
+    for (const TermPair& pair : m2lPairs_)
+    {
+        dest[pair.second] += pair.factor * source[pair.first] * coefficients[pair.combined];
+    }
+}
+
+void FastMultipoleMethod::localToLocal(const double*    source,
+                                       const gmx::DVec& d,
+                                       double*          dest,
+                                       double*          monomials) const
+{
+    computeMonomials(d, monomials);
+
+    for (const TermPair& pair : shiftPairs_)
+    {
+        dest[pair.second] += pair.factor * monomials[pair.combined] * source[pair.first];
+    }
+}
+
+void FastMultipoleMethod::setupGeometry(const rvec boxDiag)
+{
+    if (!levels_.empty() && boxDiag[XX] == boxDiag_[XX] && boxDiag[YY] == boxDiag_[YY]
+        && boxDiag[ZZ] == boxDiag_[ZZ])
+    {
+        return;
+    }
+    for (int d = 0; d < DIM; d++)
+    {
+        boxDiag_[d] = boxDiag[d];
+    }
+
+    /* Choose the number of refinements per dimension such that the leaf
+     * cells are at least half the cut-off and not too sparsely populated.
+     */
+    std::array<int, DIM> numRefinements;
+    for (int d = 0; d < DIM; d++)
+    {
+        const double minLeafSize = c_minLeafSizeOverCutoff * rCoulomb_;
+        numRefinements[d] =
+                std::max(0, static_cast<int>(std::floor(std::log2(boxDiag_[d] / minLeafSize))));
+    }
+    const int maxNumLeaves = std::max(1, numAtomsGlobal_ / c_minAverageAtomsPerLeaf);
+    while ((1 << (numRefinements[XX] + numRefinements[YY] + numRefinements[ZZ])) > maxNumLeaves)
+    {
+        int dimToCoarsen = XX;
+        for (int d = 1; d < DIM; d++)
+        {
+            if (boxDiag_[d] / (1 << numRefinements[d])
+                < boxDiag_[dimToCoarsen] / (1 << numRefinements[dimToCoarsen]))
+            {
+                dimToCoarsen = d;
+            }
+        }
+        numRefinements[dimToCoarsen]--;
+    }
+
+    /* Dimensions with fewer refinements are refined at the finest levels only,
+     * which keeps the cells close to cubic at all levels.
+     */
+    const int numLevels = 1 + *std::max_element(numRefinements.begin(), numRefinements.end());
+    levels_.resize(numLevels);
+    for (int l = 0; l < numLevels; l++)
+    {
+        Level& level = levels_[l];
+        for (int d = 0; d < DIM; d++)
+        {
+            const int numRefined = std::max(0, l - (numLevels - 1 - numRefinements[d]));
+            level.numCells[d]    = (1 << numRefined);
+            level.cellSize[d]    = boxDiag_[d] / level.numCells[d];
+            level.isRefined[d]   = (l > 0 && level.numCells[d] > levels_[l - 1].numCells[d]);
+        }
+
+        const std::array<int, DIM> range = nearRange(level.cellSize, rCoulomb_);
+        for (int d = 0; d < DIM; d++)
+        {
+            level.candidates[d].assign(level.numCells[d], {});
+            level.nearBegin[d].resize(level.numCells[d]);
+            level.nearEnd[d].resize(level.numCells[d]);
+            for (int i = 0; i < level.numCells[d]; i++)
+            {
+                std::vector<int>& candidates = level.candidates[d][i];
+                if (l == 0)
+                {
+                    /* The root cell and its near periodic images */
+                    const int rootRange = (isPeriodic_[d] ? range[d] : 0);
+                    for (int j = -rootRange; j <= rootRange; j++)
+                    {
+                        candidates.push_back(j);
+                    }
+                }
+                else
+                {
+                    const Level& parent      = levels_[l - 1];
+                    const int    parentIndex = (level.isRefined[d] ? i / 2 : i);
+                    for (int c = parent.nearBegin[d][parentIndex];
+                         c < parent.nearEnd[d][parentIndex]; c++)
+                    {
+                        const int parentNear = parent.candidates[d][parentIndex][c];
+                        if (level.isRefined[d])
+                        {
+                            candidates.push_back(2 * parentNear);
+                            candidates.push_back(2 * parentNear + 1);
+                        }
+                        else
+                        {
+                            candidates.push_back(parentNear);
+                        }
+                    }
+                }
+                level.nearBegin[d][i] = candidates.size();
+                level.nearEnd[d][i]   = 0;
+                for (size_t c = 0; c < candidates.size(); c++)
+                {
+                    if (std::abs(candidates[c] - i) <= range[d] || l == 0)
+                    {
+                        level.nearBegin[d][i] =
+                                std::min(level.nearBegin[d][i], static_cast<int>(c));
+                        level.nearEnd[d][i]   = c + 1;
+                    }
+                }
+            }
+        }
+
+        const int numCells = level.numCells[XX] * level.numCells[YY] * level.numCells[ZZ];
+        level.multipoles.resize(numCells * numTerms_);
+        level.locals.resize(numCells * numTerms_);
+        level.numAtoms.resize(numCells);
+        level.numSourceAtoms.resize(numCells);
+        level.isNeeded.resize(numCells);
+    }
+
+    numGloballyReducedLevels_ = 1;
+    while (numGloballyReducedLevels_ < numLevels
+           && totalNumCells(levels_[numGloballyReducedLevels_].numCells)
+                      <= c_maxNumGloballyReducedCells)
+    {
+        numGloballyReducedLevels_++;
+    }
+
+    /* Set up the supercells of periodic images, which grow by an odd factor
+     * each level so they remain centered on the box. At lattice level k the
+     * supercells that are children of the near supercells at level k+1, but not
+     * near themselves, contribute to the local expansion of the root cell.
+     */
+    latticeM2MShifts_.assign(c_numLatticeLevels, {});
+    latticeM2LVectors_.assign(c_numLatticeLevels, {});
+    std::array<double, DIM> supercellSize = { boxDiag_[XX], boxDiag_[YY], boxDiag_[ZZ] };
+    for (int k = 0; k < c_numLatticeLevels; k++)
+    {
+        std::array<int, DIM>    range = nearRange(supercellSize, rCoulomb_);
+        std::array<int, DIM>    growthFactor;
+        std::array<double, DIM> nextSupercellSize;
+        for (int d = 0; d < DIM; d++)
+        {
+            if (!isPeriodic_[d])
+            {
+                range[d] = 0;
+            }
+            growthFactor[d]      = 2 * range[d] + 1;
+            nextSupercellSize[d] = growthFactor[d] * supercellSize[d];
+        }
+        const std::array<int, DIM> nextRange = nearRange(nextSupercellSize, rCoulomb_);
+        std::array<int, DIM>       outerRange;
+        for (int d = 0; d < DIM; d++)
+        {
+            outerRange[d] = (isPeriodic_[d] ? nextRange[d] * growthFactor[d] + range[d] : 0);
+        }
+
+        for (int mx = -outerRange[XX]; mx <= outerRange[XX]; mx++)
+        {
+            for (int my = -outerRange[YY]; my <= outerRange[YY]; my++)
+            {
+                for (int mz = -outerRange[ZZ]; mz <= outerRange[ZZ]; mz++)
+                {
+                    const gmx::DVec shift = { mx * supercellSize[XX], my * supercellSize[YY],
+                                              mz * supercellSize[ZZ] };
+                    if (std::abs(mx) <= range[XX] && std::abs(my) <= range[YY]
+                        && std::abs(mz) <= range[ZZ])
+                    {
+                        latticeM2MShifts_[k].push_back(shift);
+                    }
+                    else
+                    {
+                        latticeM2LVectors_[k].push_back(shift * -1.0);
+                    }
+                }
+            }
+        }
+
+        supercellSize = nextSupercellSize;
+    }
+
+    /* The summation covers a rectangular block of images, its central
+     * depolarization tensor gives the dipole term that differs from the
+     * infinite periodic system with tin-foil boundary conditions, or
+     * from an infinite slab for pbc=xy.
+     */
+    std::array<int, DIM>    finalRange = nearRange(supercellSize, rCoulomb_);
+    std::array<double, DIM> halfSide;
+    for (int d = 0; d < DIM; d++)
+    {
+        halfSide[d] = (isPeriodic_[d] ? finalRange[d] + 0.5 : 0.5) * supercellSize[d];
+    }
+    const double halfDiagonal = std::sqrt(gmx::square(halfSide[XX]) + gmx::square(halfSide[YY])
+                                          + gmx::square(halfSide[ZZ]));
+    for (int d = 0; d < DIM; d++)
+    {
+        const int    d1 = (d + 1) % DIM;
+        const int    d2 = (d + 2) % DIM;
+        const double depolarization =
+                2 / M_PI * std::atan(halfSide[d1] * halfSide[d2] / (halfSide[d] * halfDiagonal));
+        const double infiniteSystemDepolarization = (isPeriodic_[d] ? 0 : 1);
+
+        shapeCorrection_[d] = depolarization - infiniteSystemDepolarization;
+    }
+}
+
+void FastMultipoleMethod::binAtoms()
+{
+    const Level& leafLevel = levels_.back();
+    const int numLeaves = leafLevel.numCells[XX] * leafLevel.numCells[YY] * leafLevel.numCells[ZZ];
+    const int numAtoms  = xWrapped_.size();
+
+    leafOfAtom_.resize(numAtoms);
+    leafAtomStart_.assign(numLeaves + 1, 0);
+    for (int a = 0; a < numAtoms; a++)
+    {
+        std::array<int, DIM> index;
+        for (int d = 0; d < DIM; d++)
+        {
+            index[d] = static_cast<int>(std::floor(xWrapped_[a][d] / leafLevel.cellSize[d]));
+            index[d] = std::min(std::max(index[d], 0), leafLevel.numCells[d] - 1);
+        }
+        leafOfAtom_[a] = cellNumber(leafLevel.numCells, index);
+        leafAtomStart_[leafOfAtom_[a] + 1]++;
+    }
+    for (int c = 0; c < numLeaves; c++)
+    {
+        leafAtomStart_[c + 1] += leafAtomStart_[c];
+    }
+    leafAtoms_.resize(numAtoms);
+    std::vector<int> fill(leafAtomStart_.begin(), leafAtomStart_.end() - 1);
+    for (int a = 0; a < numAtoms; a++)
+    {
+        leafAtoms_[fill[leafOfAtom_[a]]++] = a;
+    }
+
+    leafTargetStart_.assign(numLeaves + 1, 0);
+    for (int a = 0; a < numHomeAtoms_; a++)
+    {
+        leafTargetStart_[leafOfAtom_[a] + 1]++;
+    }
+    targetLeaves_.clear();
+    for (int c = 0; c < numLeaves; c++)
+    {
+        if (leafTargetStart_[c + 1] > 0)
+        {
+            targetLeaves_.push_back(c);
+        }
+        leafTargetStart_[c + 1] += leafTargetStart_[c];
+    }
+    leafTargets_.resize(numHomeAtoms_);
+    fill.assign(leafTargetStart_.begin(), leafTargetStart_.end() - 1);
+    for (int a = 0; a < numHomeAtoms_; a++)
+    {
+        leafTargets_[fill[leafOfAtom_[a]]++] = a;
+    }
+
+    /* Count the home atoms and mark the cells we need local expansions for,
+     * from the leaves up to the root.
+     */
+    for (int l = levels_.size() - 1; l >= 0; l--)
+    {
+        Level& level = levels_[l];
+        std::fill(level.numAtoms.begin(), level.numAtoms.end(), 0);
+        std::fill(level.isNeeded.begin(), level.isNeeded.end(), false);
+        if (l == static_cast<int>(levels_.size()) - 1)
+        {
+            for (int c = 0; c < numLeaves; c++)
+            {
+                level.numAtoms[c] = leafTargetStart_[c + 1] - leafTargetStart_[c];
+                level.isNeeded[c] = (level.numAtoms[c] > 0);
+            }
+            continue;
+        }
+
+        const Level& child = levels_[l + 1];
+        for (int cx = 0; cx < child.numCells[XX]; cx++)
+        {
+            for (int cy = 0; cy < child.numCells[YY]; cy++)
+            {
+                for (int cz = 0; cz < child.numCells[ZZ]; cz++)
+                {
+                    const int childCell = (cx * child.numCells[YY] + cy) * child.numCells[ZZ] + cz;
+                    const int px        = (child.isRefined[XX] ? cx / 2 : cx);
+                    const int py        = (child.isRefined[YY] ? cy / 2 : cy);
+                    const int pz        = (child.isRefined[ZZ] ? cz / 2 : cz);
+                    const int cell      = (px * level.numCells[YY] + py) * level.numCells[ZZ] + pz;
+                    level.numAtoms[cell] += child.numAtoms[childCell];
+                    if (child.isNeeded[childCell])
+                    {
+                        level.isNeeded[cell] = true;
+                    }
+                }
+            }
+        }
+    }
+
+    /* Without other ranks all sources are home atoms */
+    for (Level& level : levels_)
+    {
+        level.numSourceAtoms = level.numAtoms;
+    }
+}
+
+void FastMultipoleMethod::setupHalo(const t_commrec&                    cr,
+                                    const int                           numStates,
+                                    std::array<std::vector<double>, 2>* q)
+{
+#if GMX_MPI
+    MPI_Comm comm = cr.mpi_comm_mygroup;
+    int      numRanks;
+    int      rank;
+    MPI_Comm_size(comm, &numRanks);
+    MPI_Comm_rank(comm, &rank);
+
+    const int    numLevels = levels_.size();
+    const Level& leafLevel = levels_.back();
+
+    /* Returns the periodic range covering the candidates, or only the near
+     * candidates, of the cells in range cells along dimension d.
+     */
+    auto candidateRange = [](const Level& level, int d, const CellRange& cells, bool nearOnly) {
+        const int numCells = level.numCells[d];
+        if (cells.length == 0)
+        {
+            return CellRange{ 0, 0 };
+        }
+        const int               first           = cells.start;
+        const int               lastUnwrapped   = cells.start + cells.length - 1;
+        const int               last            = wrapIndex(lastUnwrapped, numCells);
+        const std::vector<int>& firstCandidates = level.candidates[d][first];
+        const std::vector<int>& lastCandidates  = level.candidates[d][last];
+        const int begin = firstCandidates[nearOnly ? level.nearBegin[d][first] : 0];
+        const int end = lastCandidates[nearOnly ? level.nearEnd[d][last] - 1 : lastCandidates.size() - 1]
+                        + lastUnwrapped - last + 1;
+        if (end - begin >= numCells)
+        {
+            return CellRange{ 0, numCells };
+        }
+        return CellRange{ wrapIndex(begin, numCells), end - begin };
+    };
+
+    /* For each level the box of cells with home atoms and the box of the source
+     * cells we need for our local expansions, followed by the box of leaves
+     * near our leaves. These are gathered from all ranks, which is a few
+     * integers per level and rank.
+     */
+    const int        numBoxes         = 2 * numLevels + 1;
+    const int        numValuesPerRank = numBoxes * DIM * 2;
+    std::vector<int> boxValues(numRanks * numValuesPerRank, 0);
+    for (int l = 0; l < numLevels; l++)
+    {
+        const Level&                       level = levels_[l];
+        std::array<std::vector<bool>, DIM> hasAtoms;
+        std::array<std::vector<bool>, DIM> isNeeded;
+        for (int d = 0; d < DIM; d++)
+        {
+            hasAtoms[d].assign(level.numCells[d], false);
+            isNeeded[d].assign(level.numCells[d], false);
+        }
+        for (int c = 0; c < totalNumCells(level.numCells); c++)
+        {
+            const std::array<int, DIM> index = cellIndex(level.numCells, c);
+            for (int d = 0; d < DIM; d++)
+            {
+                if (level.numAtoms[c] > 0)
+                {
+                    hasAtoms[d][index[d]] = true;
+                }
+                if (level.isNeeded[c])
+                {
+                    isNeeded[d][index[d]] = true;
+                }
+            }
+        }
+        for (int d = 0; d < DIM; d++)
+        {
+            const CellRange          neededCells = coveringRange(isNeeded[d]);
+            std::array<CellRange, 3> ranges      = { coveringRange(hasAtoms[d]),
+                                                candidateRange(level, d, neededCells, false),
+                                                candidateRange(level, d, neededCells, true) };
+            const int                numRanges   = (l == numLevels - 1 ? 3 : 2);
+            int* myValues = boxValues.data() + rank * numValuesPerRank;
+            for (int i = 0; i < numRanges; i++)
+            {
+                int* value = myValues + ((2 * l + i) * DIM + d) * 2;
+                value[0]   = ranges[i].start;
+                value[1]   = ranges[i].length;
+            }
+        }
+    }
+    MPI_Allreduce(MPI_IN_PLACE, boxValues.data(), boxValues.size(), MPI_INT, MPI_SUM, comm);
+
+    auto boxOf = [&boxValues, numValuesPerRank](int r, int b) {
+        CellBox box;
+        for (int d = 0; d < DIM; d++)
+        {
+            const int* value = boxValues.data() + r * numValuesPerRank + (b * DIM + d) * 2;
+            box[d]           = { value[0], value[1] };
+        }
+        return box;
+    };
+    const int nearLeavesBox = 2 * numLevels;
+
+    /* Returns whether receiver needs atoms or multipoles from sender */
+    auto needsDataFrom = [&](int receiver, int sender) {
+        if (boxesOverlap(boxOf(sender, 2 * (numLevels - 1)), boxOf(receiver, nearLeavesBox),
+                         leafLevel.numCells))
+        {
+            return true;
+        }
+        for (int l = numGloballyReducedLevels_; l < numLevels; l++)
+        {
+            if (boxesOverlap(boxOf(sender, 2 * l), boxOf(receiver, 2 * l + 1), levels_[l].numCells))
+            {
+                return true;
+            }
+        }
+        return false;
+    };
+
+    /* We communicate in both directions with every rank we need data from or
+     * have data for, the messages with counts tell what follows.
+     */
+    haloPartners_.clear();
+    for (int r = 0; r < numRanks; r++)
+    {
+        if (r == rank || !(needsDataFrom(r, rank) || needsDataFrom(rank, r)))
+        {
+            continue;
+        }
+        HaloPartner partner;
+        partner.rank            = r;
+        partner.numReceiveAtoms = 0;
+
+        const CellBox nearLeaves = boxOf(r, nearLeavesBox);
+        for (int a = 0; a < numHomeAtoms_; a++)
+        {
+            if (boxContains(nearLeaves, cellIndex(leafLevel.numCells, leafOfAtom_[a]),
+                            leafLevel.numCells))
+            {
+                partner.sendAtoms.push_back(a);
+            }
+        }
+        for (int l = numGloballyReducedLevels_; l < numLevels; l++)
+        {
+            const Level&  level   = levels_[l];
+            const CellBox sources = boxOf(r, 2 * l + 1);
+            for (int c = 0; c < totalNumCells(level.numCells); c++)
+            {
+                if (level.numAtoms[c] > 0
+                    && boxContains(sources, cellIndex(level.numCells, c), level.numCells))
+                {
+                    partner.sendCells.push_back({ l, c });
+                }
+            }
+        }
+        haloPartners_.push_back(partner);
+    }
+
+    const int                       numPartners = haloPartners_.size();
+    std::vector<std::array<int, 2>> sendCounts(numPartners);
+    std::vector<std::array<int, 2>> receiveCounts(numPartners);
+    std::vector<MPI_Request>        requests;
+    for (int p = 0; p < numPartners; p++)
+    {
+        const HaloPartner& partner = haloPartners_[p];
+        sendCounts[p] = { static_cast<int>(partner.sendAtoms.size()),
+                          static_cast<int>(partner.sendCells.size()) };
+        requests.emplace_back();
+        MPI_Irecv(receiveCounts[p].data(), 2, MPI_INT, partner.rank, c_fmmCountTag, comm,
+                  &requests.back());
+        requests.emplace_back();
+        MPI_Isend(sendCounts[p].data(), 2, MPI_INT, partner.rank, c_fmmCountTag, comm,
+                  &requests.back());
+    }
+    MPI_Waitall(requests.size(), requests.data(), MPI_STATUSES_IGNORE);
+    requests.clear();
+
+    /* Send the coordinates and charges of the atoms and the home atom counts of the cells */
+    const int                        atomStride = DIM + numStates;
+    const int                        cellStride = 3;
+    std::vector<std::vector<double>> sendAtomBuffers(numPartners);
+    std::vector<std::vector<double>> receiveAtomBuffers(numPartners);
+    std::vector<std::vector<int>>    sendCellBuffers(numPartners);
+    std::vector<std::vector<int>>    receiveCellBuffers(numPartners);
+    for (int p = 0; p < numPartners; p++)
+    {
+        const HaloPartner& partner = haloPartners_[p];
+        receiveAtomBuffers[p].resize(receiveCounts[p][0] * atomStride);
+        receiveCellBuffers[p].resize(receiveCounts[p][1] * cellStride);
+        if (!receiveAtomBuffers[p].empty())
+        {
+            requests.emplace_back();
+            MPI_Irecv(receiveAtomBuffers[p].data(), receiveAtomBuffers[p].size(), MPI_DOUBLE,
+                      partner.rank, c_fmmAtomTag, comm, &requests.back());
+        }
+        if (!receiveCellBuffers[p].empty())
+        {
+            requests.emplace_back();
+            MPI_Irecv(receiveCellBuffers[p].data(), receiveCellBuffers[p].size(), MPI_INT,
+                      partner.rank, c_fmmCellTag, comm, &requests.back());
+        }
+
+        for (int a : partner.sendAtoms)
+        {
+            for (int d = 0; d < DIM; d++)
+            {
+                sendAtomBuffers[p].push_back(xWrapped_[a][d]);
+            }
+            for (int state = 0; state < numStates; state++)
+            {
+                sendAtomBuffers[p].push_back((*q)[state][a]);
+            }
+        }
+        for (const auto& cell : partner.sendCells)
+        {
+            sendCellBuffers[p].push_back(cell[0]);
+            sendCellBuffers[p].push_back(cell[1]);
+            sendCellBuffers[p].push_back(levels_[cell[0]].numAtoms[cell[1]]);
+        }
+        if (!sendAtomBuffers[p].empty())
+        {
+            requests.emplace_back();
+            MPI_Isend(sendAtomBuffers[p].data(), sendAtomBuffers[p].size(), MPI_DOUBLE,
+                      partner.rank, c_fmmAtomTag, comm, &requests.back());
+        }
+        if (!sendCellBuffers[p].empty())
+        {
+            requests.emplace_back();
+            MPI_Isend(sendCellBuffers[p].data(), sendCellBuffers[p].size(), MPI_INT, partner.rank,
+                      c_fmmCellTag, comm, &requests.back());
+        }
+    }
+    MPI_Waitall(requests.size(), requests.data(), MPI_STATUSES_IGNORE);
+
+    /* Append the received atoms and bin them together with the home atoms */
+    for (int p = 0; p < numPartners; p++)
+    {
+        haloPartners_[p].numReceiveAtoms = receiveCounts[p][0];
+        for (int i = 0; i < receiveCounts[p][0]; i++)
+        {
+            const double* buffer = receiveAtomBuffers[p].data() + i * atomStride;
+            xWrapped_.push_back({ buffer[XX], buffer[YY], buffer[ZZ] });
+            for (int state = 0; state < numStates; state++)
+            {
+                (*q)[state].push_back(buffer[DIM + state]);
+            }
+        }
+    }
+    binAtoms();
+
+    /* The atom counts of the coarsest levels are summed over all ranks,
+     * at the other levels we add the counts of the cells we receive.
+     */
+    std::vector<int> counts;
+    for (int l = 0; l < numGloballyReducedLevels_; l++)
+    {
+        counts.insert(counts.end(), levels_[l].numSourceAtoms.begin(),
+                      levels_[l].numSourceAtoms.end());
+    }
+    MPI_Allreduce(MPI_IN_PLACE, counts.data(), counts.size(), MPI_INT, MPI_SUM, comm);
+    for (int l = 0, i = 0; l < numGloballyReducedLevels_; l++)
+    {
+        for (int& count : levels_[l].numSourceAtoms)
+        {
+            count = counts[i++];
+        }
+    }
+    for (int p = 0; p < numPartners; p++)
+    {
+        HaloPartner& partner = haloPartners_[p];
+        partner.receiveCells.clear();
+        for (int i = 0; i < receiveCounts[p][1]; i++)
+        {
+            const int* buffer = receiveCellBuffers[p].data() + i * cellStride;
+            partner.receiveCells.push_back({ buffer[0], buffer[1] });
+            levels_[buffer[0]].numSourceAtoms[buffer[1]] += buffer[2];
+        }
+    }
+#else
+    GMX_UNUSED_VALUE(cr);
+    GMX_UNUSED_VALUE(numStates);
+    GMX_UNUSED_VALUE(q);
+    GMX_RELEASE_ASSERT(false, "The FMM halo can only be set up with MPI");
+#endif
+}
+
+void FastMultipoleMethod::computeLatticeLocal(const double* rootMultipole, double* rootLocal)
+{
+    /* We leave out the net charge, which corresponds to a neutralizing background */
+    std::vector<double> multipole(rootMultipole, rootMultipole + numTerms_);
+    multipole[0] = 0;
+
+    std::vector<double> nextMultipole(numTerms_);
+    std::vector<double> work(numTerms_);
+    for (int k = 0; k < c_numLatticeLevels; k++)
+    {
+        for (const gmx::DVec& r : latticeM2LVectors_[k])
+        {
+            multipoleToLocal(multipole.data(), r, rootLocal, work.data());
+        }
+        std::fill(nextMultipole.begin(), nextMultipole.end(), 0);
+        for (const gmx::DVec& d : latticeM2MShifts_[k])
+        {
+            multipoleToMultipole(multipole.data(), d, nextMultipole.data(), work.data());
+        }
+        std::swap(multipole, nextMultipole);
+    }
+}
+
+void FastMultipoleMethod::computeMultipoles(const std::vector<double>& q)
+{
+    /* Compute the multipole moments of the leaves */
+    Level&    leafLevel = levels_.back();
+    const int numLeaves = totalNumCells(leafLevel.numCells);
+#pragma omp parallel for num_threads(numThreads_) schedule(static)
+    for (int thread = 0; thread < numThreads_; thread++)
+    {
+        try
+        {
+            std::vector<double> monomials(numTerms_);
+            const int cellBegin = numLeaves * thread / numThreads_;
+            const int cellEnd   = numLeaves * (thread + 1) / numThreads_;
+            for (int c = cellBegin; c < cellEnd; c++)
+            {
+                double* multipole = leafLevel.multipoles.data() + c * numTerms_;
+                std::fill(multipole, multipole + numTerms_, 0);
+
+                const gmx::DVec center = cellCenter(leafLevel, cellIndex(leafLevel.numCells, c));
+                for (int i = leafTargetStart_[c]; i < leafTargetStart_[c + 1]; i++)
+                {
+                    const int a = leafTargets_[i];
+                    computeMonomials(xWrapped_[a] - center, monomials.data());
+                    for (int t = 0; t < numTerms_; t++)
+                    {
+                        multipole[t] += q[a] * monomials[t];
+                    }
+                }
+            }
+        }
+        GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
+    }
+
+    /* Translate the multipoles up to the root */
+    for (int l = levels_.size() - 2; l >= 0; l--)
+    {
+        Level&       level    = levels_[l];
+        const Level& child    = levels_[l + 1];
+        const int    numCells = totalNumCells(level.numCells);
+#pragma omp parallel for num_threads(numThreads_) schedule(static)
+        for (int thread = 0; thread < numThreads_; thread++)
+        {
+            try
+            {
+                std::vector<double> work(numTerms_);
+                const int cellBegin = numCells * thread / numThreads_;
+                const int cellEnd   = numCells * (thread + 1) / numThreads_;
+                for (int c = cellBegin; c < cellEnd; c++)
+                {
+                    double* multipole = level.multipoles.data() + c * numTerms_;
+                    std::fill(multipole, multipole + numTerms_, 0);
+                    if (level.numAtoms[c] == 0)
+                    {
+                        continue;
+                    }
+
+                    const std::array<int, DIM> index  = cellIndex(level.numCells, c);
+                    const gmx::DVec            center = cellCenter(level, index);
+                    std::array<int, DIM>       childBegin;
+                    std::array<int, DIM>       childEnd;
+                    for (int d = 0; d < DIM; d++)
+                    {
+                        childBegin[d] = (child.isRefined[d] ? 2 * index[d] : index[d]);
+                        childEnd[d]   = (child.isRefined[d] ? 2 * index[d] + 2 : index[d] + 1);
+                    }
+                    std::array<int, DIM> ci;
+                    for (ci[XX] = childBegin[XX]; ci[XX] < childEnd[XX]; ci[XX]++)
+                    {
+                        for (ci[YY] = childBegin[YY]; ci[YY] < childEnd[YY]; ci[YY]++)
+                        {
+                            for (ci[ZZ] = childBegin[ZZ]; ci[ZZ] < childEnd[ZZ]; ci[ZZ]++)
+                            {
+                                const int childCell = cellNumber(child.numCells, ci);
+                                if (child.numAtoms[childCell] > 0)
+                                {
+                                    multipoleToMultipole(
+                                            child.multipoles.data() + childCell * numTerms_,
+                                            cellCenter(child, ci) - center, multipole, work.data());
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+            GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
+        }
+    }
+}
+
+void FastMultipoleMethod::reduceMultipoles(const t_commrec& cr, gmx::DVec* dipole)
+{
+#if GMX_MPI
+    MPI_Comm                         comm        = cr.mpi_comm_mygroup;
+    const int                        numPartners = haloPartners_.size();
+    std::vector<std::vector<double>> sendBuffers(numPartners);
+    std::vector<std::vector<double>> receiveBuffers(numPartners);
+    std::vector<MPI_Request>         requests;
+    for (int p = 0; p < numPartners; p++)
+    {
+        const HaloPartner& partner = haloPartners_[p];
+        receiveBuffers[p].resize(partner.receiveCells.size() * numTerms_);
+        if (!receiveBuffers[p].empty())
+        {
+            requests.emplace_back();
+            MPI_Irecv(receiveBuffers[p].data(), receiveBuffers[p].size(), MPI_DOUBLE, partner.rank,
+                      c_fmmMultipoleTag, comm, &requests.back());
+        }
+        for (const auto& cell : partner.sendCells)
+        {
+            const double* multipole = levels_[cell[0]].multipoles.data() + cell[1] * numTerms_;
+            sendBuffers[p].insert(sendBuffers[p].end(), multipole, multipole + numTerms_);
+        }
+        if (!sendBuffers[p].empty())
+        {
+            requests.emplace_back();
+            MPI_Isend(sendBuffers[p].data(), sendBuffers[p].size(), MPI_DOUBLE, partner.rank,
+                      c_fmmMultipoleTag, comm, &requests.back());
+        }
+    }
+
+    /* Sum the coarsest levels and the dipole over all ranks, the number of
+     * steps in this reduction grows logarithmically with the number of ranks.
+     */
+    std::vector<double> sum;
+    for (int l = 0; l < numGloballyReducedLevels_; l++)
+    {
+        sum.insert(sum.end(), levels_[l].multipoles.begin(), levels_[l].multipoles.end());
+    }
+    for (int d = 0; d < DIM; d++)
+    {
+        sum.push_back((*dipole)[d]);
+    }
+    MPI_Allreduce(MPI_IN_PLACE, sum.data(), sum.size(), MPI_DOUBLE, MPI_SUM, comm);
+    size_t i = 0;
+    for (int l = 0; l < numGloballyReducedLevels_; l++)
+    {
+        for (double& value : levels_[l].multipoles)
+        {
+            value = sum[i++];
+        }
+    }
+    for (int d = 0; d < DIM; d++)
+    {
+        (*dipole)[d] = sum[i++];
+    }
+
+    MPI_Waitall(requests.size(), requests.data(), MPI_STATUSES_IGNORE);
+    for (int p = 0; p < numPartners; p++)
+    {
+        const HaloPartner& partner = haloPartners_[p];
+        for (size_t c = 0; c < partner.receiveCells.size(); c++)
+        {
+            const auto&   cell      = partner.receiveCells[c];
+            double*       multipole = levels_[cell[0]].multipoles.data() + cell[1] * numTerms_;
+            const double* received  = receiveBuffers[p].data() + c * numTerms_;
+            for (int t = 0; t < numTerms_; t++)
+            {
+                multipole[t] += received[t];
+            }
+        }
+    }
+#else
+    GMX_UNUSED_VALUE(cr);
+    GMX_UNUSED_VALUE(dipole);
+    GMX_RELEASE_ASSERT(false, "The FMM multipoles can only be reduced with MPI");
+#endif
+}
+
+void FastMultipoleMethod::computeLocals()
+{
+    /* The periodic images beyond the near images of the box */
+    std::fill(levels_[0].locals.begin(), levels_[0].locals.end(), 0);
+    computeLatticeLocal(levels_[0].multipoles.data(), levels_[0].locals.data());
+
+    /* Compute the local expansions from the root down to the leaves */
+    for (size_t l = 1; l < levels_.size(); l++)
+    {
+        Level&       level    = levels_[l];
+        const Level& parent   = levels_[l - 1];
+        const int    numCells = totalNumCells(level.numCells);
+#pragma omp parallel for num_threads(numThreads_) schedule(static)
+        for (int thread = 0; thread < numThreads_; thread++)
+        {
+            try
+            {
+                std::vector<double> work(numTerms_);
+                const int cellBegin = numCells * thread / numThreads_;
+                const int cellEnd   = numCells * (thread + 1) / numThreads_;
+                for (int c = cellBegin; c < cellEnd; c++)
+                {
+                    if (!level.isNeeded[c])
+                    {
+                        continue;
+                    }
+                    double* local = level.locals.data() + c * numTerms_;
+                    std::fill(local, local + numTerms_, 0);
+
+                    const std::array<int, DIM> index  = cellIndex(level.numCells, c);
+                    const gmx::DVec            center = cellCenter(level, index);
+
+                    std::array<int, DIM> parentIndex;
+                    for (int d = 0; d < DIM; d++)
+                    {
+                        parentIndex[d] = (level.isRefined[d] ? index[d] / 2 : index[d]);
+                    }
+                    const int parentCell = cellNumber(parent.numCells, parentIndex);
+                    localToLocal(parent.locals.data() + parentCell * numTerms_,
+                                 center - cellCenter(parent, parentIndex), local, work.data());
+
+                    /* Add the candidates that are not near, the center of the
+                     * unwrapped cell is the center of the periodic image.
+                     */
+                    std::array<const std::vector<int>*, DIM> candidates;
+                    std::array<int, DIM>                     nearBegin;
+                    std::array<int, DIM>                     nearEnd;
+                    for (int d = 0; d < DIM; d++)
+                    {
+                        candidates[d] = &level.candidates[d][index[d]];
+                        nearBegin[d]  = level.nearBegin[d][index[d]];
+                        nearEnd[d]    = level.nearEnd[d][index[d]];
+                    }
+                    std::array<int, DIM> k;
+                    for (k[XX] = 0; k[XX] < static_cast<int>(candidates[XX]->size()); k[XX]++)
+                    {
+                        for (k[YY] = 0; k[YY] < static_cast<int>(candidates[YY]->size()); k[YY]++)
+                        {
+                            for (k[ZZ] = 0; k[ZZ] < static_cast<int>(candidates[ZZ]->size());
+                                 k[ZZ]++)
+                            {
+                                std::array<int, DIM> unwrapped;
+                                std::array<int, DIM> source;
+                                bool                 isNear = true;
+                                for (int d = 0; d < DIM; d++)
+                                {
+                                    unwrapped[d] = (*candidates[d])[k[d]];
+                                    source[d]    = wrapIndex(unwrapped[d], level.numCells[d]);
+                                    isNear = isNear && k[d] >= nearBegin[d] && k[d] < nearEnd[d];
+                                }
+                                const int sourceCell = cellNumber(level.numCells, source);
+                                if (!isNear && level.numSourceAtoms[sourceCell] > 0)
+                                {
+                                    multipoleToLocal(
+                                            level.multipoles.data() + sourceCell * numTerms_,
+                                            center - cellCenter(level, unwrapped), local,
+                                            work.data());
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+            GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
+        }
+    }
+}
+
+void FastMultipoleMethod::evaluate(const std::vector<double>& q,
+                                   const gmx::DVec&           dipole,
+                                   std::vector<gmx::DVec>*    gradient,
+                                   double*                    nearEnergy,
+                                   double*                    farEnergy,
+                                   double                     nearVirial[DIM][DIM])
+{
+    /* The dipole correction for the shape of the summed block of images */
+    const double volume = boxDiag_[XX] * boxDiag_[YY] * boxDiag_[ZZ];
+    gmx::DVec    shapeField;
+    for (int d = 0; d < DIM; d++)
+    {
+        shapeField[d] = 4 * M_PI / volume * shapeCorrection_[d] * dipole[d];
+    }
+
+    /* Evaluate the local expansions and the interactions in near leaves */
+    const Level&           leafLevel = levels_.back();
+    std::vector<double>    threadNearEnergy(numThreads_, 0);
+    std::vector<double>    threadFarEnergy(numThreads_, 0);
+    std::vector<gmx::DVec> threadVirial(numThreads_ * DIM, { 0, 0, 0 });
+    const int              numTargetLeaves = targetLeaves_.size();
+    const double           rCoulomb2       = gmx::square(rCoulomb_);
+#pragma omp parallel for num_threads(numThreads_) schedule(static)
+    for (int thread = 0; thread < numThreads_; thread++)
+    {
+        try
+        {
+            std::vector<double> monomials(numTerms_);
+            for (int tl = numTargetLeaves * thread / numThreads_;
+                 tl < numTargetLeaves * (thread + 1) / numThreads_; tl++)
+            {
+                const int                  c      = targetLeaves_[tl];
+                const std::array<int, DIM> index  = cellIndex(leafLevel.numCells, c);
+                const gmx::DVec            center = cellCenter(leafLevel, index);
+                const double*              local  = leafLevel.locals.data() + c * numTerms_;
+
+                /* Collect the near leaves with their periodic shifts */
+                std::vector<int>       nearCells;
+                std::vector<gmx::DVec> nearShifts;
+                std::array<int, DIM>   k;
+                for (k[XX] = leafLevel.nearBegin[XX][index[XX]];
+                     k[XX] < leafLevel.nearEnd[XX][index[XX]]; k[XX]++)
+                {
+                    for (k[YY] = leafLevel.nearBegin[YY][index[YY]];
+                         k[YY] < leafLevel.nearEnd[YY][index[YY]]; k[YY]++)
+                    {
+                        for (k[ZZ] = leafLevel.nearBegin[ZZ][index[ZZ]];
+                             k[ZZ] < leafLevel.nearEnd[ZZ][index[ZZ]]; k[ZZ]++)
+                        {
+                            std::array<int, DIM> source;
+                            gmx::DVec            shift;
+                            for (int d = 0; d < DIM; d++)
+                            {
+                                const int unwrapped = leafLevel.candidates[d][index[d]][k[d]];
+                                source[d] = wrapIndex(unwrapped, leafLevel.numCells[d]);
+                                shift[d] = imageShift(unwrapped, leafLevel.numCells[d])
+                                           * boxDiag_[d];
+                            }
+                            nearCells.push_back(cellNumber(leafLevel.numCells, source));
+                            nearShifts.push_back(shift);
+                        }
+                    }
+                }
+
+                for (int i = leafTargetStart_[c]; i < leafTargetStart_[c + 1]; i++)
+                {
+                    const int        a  = leafTargets_[i];
+                    const gmx::DVec& xa = xWrapped_[a];
+
+                    /* The far field from the local expansion */
+                    computeMonomials(xa - center, monomials.data());
+                    double    farPotential = 0;
+                    gmx::DVec grad         = { 0, 0, 0 };
+                    for (int t = 0; t < numTerms_; t++)
+                    {
+                        farPotential += local[t] * monomials[t];
+                        for (int d = 0; d < DIM; d++)
+                        {
+                            if (lowerIndex_[t][d] >= 0)
+                            {
+                                grad[d] += local[t] * terms_[t][d] * monomials[lowerIndex_[t][d]];
+                            }
+                        }
+                    }
+                    farPotential -= dot(shapeField, xa);
+                    grad -= shapeField;
+
+                    /* The direct sum over the near leaves */
+                    double nearPotential = 0;
+                    for (size_t n = 0; n < nearCells.size(); n++)
+                    {
+                        const int       sourceCell = nearCells[n];
+                        const gmx::DVec xShifted   = xa - nearShifts[n];
+                        for (int j = leafAtomStart_[sourceCell];
+                             j < leafAtomStart_[sourceCell + 1]; j++)
+                        {
+                            const int       b  = leafAtoms_[j];
+                            const gmx::DVec dx = xShifted - xWrapped_[b];
+                            const double    r2 = norm2(dx);
+                            if (r2 < rCoulomb2)
+                            {
+                                /* Only the constant 1/rc, the rest is computed by the kernels */
+                                nearPotential += q[b] / rCoulomb_;
+                            }
+                            else
+                            {
+                                const double rInv  = 1 / std::sqrt(r2);
+                                const double rInv3 = rInv * rInv * rInv;
+                                nearPotential += q[b] * rInv;
+                                grad -= (q[b] * rInv3) * dx;
+                                for (int d1 = 0; d1 < DIM; d1++)
+                                {
+                                    /* -1/4 r_ij f_ij for each ordered pair */
+                                    threadVirial[thread * DIM + d1] -=
+                                            (0.25 * q[a] * q[b] * rInv3 * dx[d1]) * dx;
+                                }
+                            }
+                        }
+                    }
+
+                    threadNearEnergy[thread] += 0.5 * q[a] * nearPotential;
+                    threadFarEnergy[thread] += 0.5 * q[a] * farPotential;
+                    (*gradient)[a] = grad;
+                }
+            }
+        }
+        GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
+    }
+
+    *nearEnergy = 0;
+    *farEnergy  = 0;
+    for (int d1 = 0; d1 < DIM; d1++)
+    {
+        for (int d2 = 0; d2 < DIM; d2++)
+        {
+            nearVirial[d1][d2] = 0;
+        }
+    }
+    for (int thread = 0; thread < numThreads_; thread++)
+    {
+        *nearEnergy += threadNearEnergy[thread];
+        *farEnergy += threadFarEnergy[thread];
+        for (int d1 = 0; d1 < DIM; d1++)
+        {
+            for (int d2 = 0; d2 < DIM; d2++)
+            {
+                nearVirial[d1][d2] += threadVirial[thread * DIM + d1][d2];
+            }
+        }
+    }
+}
+
+real FastMultipoleMethod::calculate(const t_inputrec& ir,
+                                    const rvec        x[],
+                                    rvec              f[],
+                                    const real        chargeA[],
+                                    const real        chargeB[],
+                                    const bool        chargesArePerturbed,
+                                    const matrix      box,
+                                    const t_commrec*  cr,
+                                    const int         natoms,
+                                    matrix            lrvir,
+                                    const real        lambda,
+                                    real*             dvdlambda)
+{
+    if (TRICLINIC(box))
+    {
+        gmx_fatal(FARGS, "The fast multipole method is only implemented for rectangular boxes");
+    }
+
+    const bool haveDD = (cr != nullptr && havePPDomainDecomposition(cr));
+
+    rvec boxDiag;
+    for (int d = 0; d < DIM; d++)
+    {
+        boxDiag[d] = box[d][d];
+    }
+
+    const int   numStates  = (chargesArePerturbed ? 2 : 1);
+    const real* charges[2] = { chargeA, chargeB };
+
+    numHomeAtoms_ = natoms;
+    xWrapped_.resize(numHomeAtoms_);
+    std::array<std::vector<double>, 2> q;
+    for (int state = 0; state < numStates; state++)
+    {
+        q[state].assign(charges[state], charges[state] + numHomeAtoms_);
+    }
+    for (int a = 0; a < numHomeAtoms_; a++)
+    {
+        for (int d = 0; d < DIM; d++)
+        {
+            double xd = x[a][d];
+            if (isPeriodic_[d])
+            {
+                xd -= std::floor(xd / boxDiag[d]) * boxDiag[d];
+            }
+            xWrapped_[a][d] = xd;
+        }
+    }
+
+    /* Along a non-periodic dimension the tree should cover all atoms,
+     * so the separation of non-near cells holds for all pairs.
+     */
+    for (int d = 0; d < DIM; d++)
+    {
+        if (!isPeriodic_[d])
+        {
+            double bounds[2] = { 0, boxDiag[d] };
+            for (int a = 0; a < numHomeAtoms_; a++)
+            {
+                bounds[0] = std::min(bounds[0], xWrapped_[a][d]);
+                bounds[1] = std::max(bounds[1], xWrapped_[a][d]);
+            }
+#if GMX_MPI
+            if (haveDD)
+            {
+                /* All ranks should use the same tree */
+                bounds[0] = -bounds[0];
+                MPI_Allreduce(MPI_IN_PLACE, bounds, 2, MPI_DOUBLE, MPI_MAX, cr->mpi_comm_mygroup);
+                bounds[0] = -bounds[0];
+            }
+#endif
+            for (int a = 0; a < numHomeAtoms_; a++)
+            {
+                xWrapped_[a][d] -= bounds[0];
+            }
+            /* Avoid zero cell sizes when all atoms are in a plane */
+            boxDiag[d] = std::max(bounds[1] - bounds[0], rCoulomb_);
+        }
+    }
+
+    setupGeometry(boxDiag);
+    binAtoms();
+    if (haveDD)
+    {
+        setupHalo(*cr, numStates, &q);
+    }
+
+    const double epsilonFactor = ONE_4PI_EPS0 / ir.epsilon_r;
+
+    double                 energyAB[2] = { 0, 0 };
+    std::vector<gmx::DVec> gradient(numHomeAtoms_);
+    clear_mat(lrvir);
+    for (int state = 0; state < numStates; state++)
+    {
+        const real scale = (chargesArePerturbed ? (state == 0 ? 1 - lambda : lambda) : 1);
+
+        computeMultipoles(q[state]);
+        gmx::DVec dipole = { 0, 0, 0 };
+        for (int a = 0; a < numHomeAtoms_; a++)
+        {
+            dipole += q[state][a] * xWrapped_[a];
+        }
+        if (haveDD)
+        {
+            reduceMultipoles(*cr, &dipole);
+        }
+        computeLocals();
+
+        double nearEnergy, farEnergy;
+        double nearVirial[DIM][DIM];
+        evaluate(q[state], dipole, &gradient, &nearEnergy, &farEnergy, nearVirial);
+
+        for (int i = 0; i < numHomeAtoms_; i++)
+        {
+            const double forceFactor = -scale * epsilonFactor * charges[state][i];
+            for (int d = 0; d < DIM; d++)
+            {
+                f[i][d] += forceFactor * gradient[i][d];
+            }
+        }
+
+        energyAB[state] = epsilonFactor * (nearEnergy + farEnergy);
+
+        /* The far field energy is homogeneous of degree -1,
+         * so the trace of its virial is -1/2 times its energy.
+         */
+        for (int d1 = 0; d1 < DIM; d1++)
+        {
+            for (int d2 = 0; d2 < DIM; d2++)
+            {
+                lrvir[d1][d2] += scale * epsilonFactor
+                                 * (nearVirial[d1][d2] - (d1 == d2 ? farEnergy / 6 : 0));
+            }
+        }
+    }
+
+    real energy;
+    if (!chargesArePerturbed)
+    {
+        energy = energyAB[0];
+    }
+    else
+    {
+        energy = (1.0 - lambda) * energyAB[0] + lambda * energyAB[1];
+        *dvdlambda += energyAB[1] - energyAB[0];
+    }
+
+    return energy;
+}
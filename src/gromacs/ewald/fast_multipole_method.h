@@ -0,0 +1,312 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2020, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \libinternal \file
+ *
+ * \brief This file declares the fast multipole method (FMM) for
+ * long-ranged electrostatics.
+ *
+ * The Coulomb interaction is split at the cut-off distance rc.
+ * The non-bonded kernels compute q_i q_j (1/r - 1/rc) for r < rc,
+ * exactly as with plain cut-off electrostatics with a potential shift,
+ * including the -q_i q_j/rc term for excluded pairs and the self term.
+ * The FMM computes the complement, q_i q_j / max(r, rc), over all pairs,
+ * including periodic images and the self term. Beyond rc this is
+ * the plain Coulomb interaction, which is handled with Cartesian Taylor
+ * expansions in an octree, pairs in neighboring leaf cells are summed
+ * directly. Periodic images beyond the tree are summed hierarchically
+ * with the root expansion and a shape correction gives tin-foil
+ * boundary conditions with pbc=xyz and an infinite slab with pbc=xy.
+ *
+ * With domain decomposition each rank evaluates the expansions and
+ * the direct sum for its home atoms. The multipole moments of the
+ * coarsest levels, which all ranks need, are summed over all ranks.
+ * At the finer levels, ranks exchange the partial multipole moments
+ * of the cells within the interaction range of the other rank's cells,
+ * and the home atoms of the leaves near the other rank's leaves.
+ *
+ * \inlibraryapi
+ * \ingroup module_ewald
+ */
+
+#ifndef GMX_EWALD_FAST_MULTIPOLE_METHOD_H
+#define GMX_EWALD_FAST_MULTIPOLE_METHOD_H
+
+#include <cstdio>
+
+#include <array>
+#include <vector>
+
+#include "gromacs/math/vectypes.h"
+#include "gromacs/utility/real.h"
+
+struct t_commrec;
+struct t_inputrec;
+
+/*! \libinternal
+ * \brief Computes the Coulomb interactions beyond the cut-off with the fast multipole method
+ */
+class FastMultipoleMethod
+{
+public:
+    /*! \brief Constructor
+     *
+     * \param[in] ir              The input record, the expansion order and pbc are taken from here
+     * \param[in] numAtomsGlobal  The total number of atoms in the system
+     * \param[in] rCoulomb        The Coulomb cut-off distance
+     * \param[in] numThreads      The number of OpenMP threads to use
+     * \param[in] fplog           File to print setup information to, can be nullptr
+     */
+    FastMultipoleMethod(const t_inputrec& ir,
+                        int               numAtomsGlobal,
+                        real              rCoulomb,
+                        int               numThreads,
+                        FILE*             fplog);
+
+    /*! \brief Computes the long-range Coulomb energy, forces and virial
+     *
+     * The first \p natoms atoms in \p x are the home atoms, the forces on
+     * these atoms are added to \p f. With domain decomposition the energy
+     * and virial are the contributions of the home atoms, which should be
+     * summed over the ranks.
+     *
+     * The virial of the pairs in neighboring leaf cells is computed exactly.
+     * The rest of the energy is homogeneous of degree -1 in the coordinates,
+     * so its virial trace is known exactly, and only this isotropic part
+     * is returned.
+     *
+     * \returns the long-range Coulomb energy
+     */
+    real calculate(const t_inputrec& ir,
+                   const rvec        x[],
+                   rvec              f[],
+                   const real        chargeA[],
+                   const real        chargeB[],
+                   bool              chargesArePerturbed,
+                   const matrix      box,
+                   const t_commrec*  cr,
+                   int               natoms,
+                   matrix            lrvir,
+                   real              lambda,
+                   real*             dvdlambda);
+
+private:
+    //! A level of the cell tree
+    struct Level
+    {
+        //! The number of cells along each dimension
+        std::array<int, DIM> numCells;
+        //! The cell size along each dimension
+        std::array<double, DIM> cellSize;
+        //! Whether the cells along each dimension are halved with respect to the previous level
+        std::array<bool, DIM> isRefined;
+        /*! \brief Per dimension and cell index, the unwrapped indices of the children of the
+         * near cells of the parent
+         *
+         * The indices are sorted, so the near cells of the cell itself
+         * form the range given by nearBegin and nearEnd. A cell is near
+         * when its index distance is within the near range along all
+         * dimensions at this level and at all coarser levels, so the near
+         * relation is the product of these one-dimensional relations.
+         */
+        std::array<std::vector<std::vector<int>>, DIM> candidates;
+        //! Per dimension and cell index, the start of the near cells in candidates
+        std::array<std::vector<int>, DIM> nearBegin;
+        //! Per dimension and cell index, the end of the near cells in candidates
+        std::array<std::vector<int>, DIM> nearEnd;
+        //! The multipole moments, numTerms_ per cell
+        std::vector<double> multipoles;
+        //! The local expansion coefficients, numTerms_ per cell
+        std::vector<double> locals;
+        //! The number of home atoms per cell
+        std::vector<int> numAtoms;
+        //! The number of atoms per cell on all ranks, only set for the cells we need as sources
+        std::vector<int> numSourceAtoms;
+        //! Whether we need the local expansion of the cell
+        std::vector<bool> isNeeded;
+    };
+
+    //! Communication setup with another rank
+    struct HaloPartner
+    {
+        //! The rank in the particle-particle communicator
+        int rank;
+        //! The home atoms we send
+        std::vector<int> sendAtoms;
+        //! The level and cell number of the cells we send our partial multipoles of
+        std::vector<std::array<int, 2>> sendCells;
+        //! The number of atoms we receive
+        int numReceiveAtoms;
+        //! The level and cell number of the cells we receive partial multipoles of
+        std::vector<std::array<int, 2>> receiveCells;
+    };
+
+    //! Sets up the tree and periodic lattice for \p boxDiag, when changed
+    void setupGeometry(const rvec boxDiag);
+
+    /*! \brief Bins all atoms into the leaf cells, counts the home atoms per cell
+     * and marks the cells we need local expansions for
+     */
+    void binAtoms();
+
+    /*! \brief Exchanges the atoms in near leaves with the other ranks and sets up
+     * the exchange of the partial multipole moments
+     *
+     * The received atoms and their charges for \p numStates states are appended
+     * to xWrapped_ and \p q.
+     */
+    void setupHalo(const t_commrec& cr, int numStates, std::array<std::vector<double>, 2>* q);
+
+    //! Computes the multipole moments of the home atoms of all cells for charges \p q
+    void computeMultipoles(const std::vector<double>& q);
+
+    /*! \brief Sums the multipole moments over the ranks
+     *
+     * The coarsest levels and \p dipole are summed over all ranks,
+     * at the other levels we add the moments from the halo partners.
+     */
+    void reduceMultipoles(const t_commrec& cr, gmx::DVec* dipole);
+
+    //! Computes the local expansions of the cells we need them for
+    void computeLocals();
+
+    //! Computes the potential and its gradient at the home atoms for charges \p q
+    void evaluate(const std::vector<double>& q,
+                  const gmx::DVec&           dipole,
+                  std::vector<gmx::DVec>*    gradient,
+                  double*                    nearEnergy,
+                  double*                    farEnergy,
+                  double                     nearVirial[DIM][DIM]);
+
+    //! Computes the local expansion at the root due to periodic images beyond the near images
+    void computeLatticeLocal(const double* rootMultipole, double* rootLocal);
+
+    //! Returns the center of cell \p index at \p level
+    gmx::DVec cellCenter(const Level& level, const std::array<int, DIM>& index) const;
+
+    /*! \brief Adds the translated multipole \p source, shifted over \p d, to \p dest
+     *
+     * \p work should have space for numTerms_ values, as for the next two methods.
+     */
+    void multipoleToMultipole(const double*    source,
+                              const gmx::DVec& d,
+                              double*          dest,
+                              double*          work) const;
+
+    //! Adds the local expansion due to multipole \p source at vector \p r to \p dest
+    void multipoleToLocal(const double*    source,
+                          const gmx::DVec& r,
+                          double*          dest,
+                          double*          work) const;
+
+    //! Adds the local expansion \p source, shifted over \p d, to \p dest
+    void localToLocal(const double* source, const gmx::DVec& d, double* dest, double* work) const;
+
+    //! Computes the Taylor coefficients of 1/|r - y| with respect to y at y=0
+    void computeTaylorCoefficients(const gmx::DVec& r, double* coefficients) const;
+
+    //! Computes the monomials d^k for all terms
+    void computeMonomials(const gmx::DVec& d, double* monomials) const;
+
+    //! The expansion order
+    int order_;
+    //! The total number of atoms in the system
+    int numAtomsGlobal_;
+    //! The cut-off distance, below which pair interactions are constant
+    double rCoulomb_;
+    //! The number of OpenMP threads
+    int numThreads_;
+    //! Whether each dimension is periodic
+    std::array<bool, DIM> isPeriodic_;
+
+    //! The number of expansion terms
+    int numTerms_;
+    //! The multi-index of each term, ordered by total degree
+    std::vector<std::array<int, DIM>> terms_;
+    //! Term index lookup, size (order+1)^3, -1 for degrees above the order
+    std::vector<int> termIndex_;
+    //! For each term and dimension, the index of the term with that power lowered by 1, or -1
+    std::vector<std::array<int, DIM>> lowerIndex_;
+    //! A term pair for the translation operators
+    struct TermPair
+    {
+        //! The index of the first term
+        int first;
+        //! The index of the second term
+        int second;
+        //! The index of the sum or difference of the multi-indices
+        int combined;
+        //! The numerical factor
+        double factor;
+    };
+    //! Pairs (alpha, beta <= alpha) with the binomial coefficient, for M2M and L2L
+    std::vector<TermPair> shiftPairs_;
+    //! Pairs (k, beta) with |k|+|beta| <= order, with (-1)^|beta| binom(k+beta, beta), for M2L
+    std::vector<TermPair> m2lPairs_;
+
+    //! The box diagonal the geometry was set up for
+    gmx::DVec boxDiag_;
+    //! The tree levels, level 0 is the whole box
+    std::vector<Level> levels_;
+    //! The translation vectors for summing the supercell multipoles, per lattice level
+    std::vector<std::vector<gmx::DVec>> latticeM2MShifts_;
+    //! The vectors from the source supercells to the box center, per lattice level
+    std::vector<std::vector<gmx::DVec>> latticeM2LVectors_;
+    //! The depolarization tensor difference for the shape correction, diagonal
+    gmx::DVec shapeCorrection_;
+
+    //! The number of levels, starting from the root, with multipoles summed over all ranks
+    int numGloballyReducedLevels_;
+    //! The ranks we exchange atoms or multipoles with
+    std::vector<HaloPartner> haloPartners_;
+
+    //! The number of home atoms
+    int numHomeAtoms_;
+    //! The wrapped coordinates of the home atoms followed by the received atoms
+    std::vector<gmx::DVec> xWrapped_;
+    //! The leaf cell index of each atom
+    std::vector<int> leafOfAtom_;
+    //! The start of each leaf in leafAtoms_, size numLeaves+1
+    std::vector<int> leafAtomStart_;
+    //! The atom indices sorted by leaf
+    std::vector<int> leafAtoms_;
+    //! The start of each leaf in leafTargets_, size numLeaves+1
+    std::vector<int> leafTargetStart_;
+    //! The home atom indices sorted by leaf
+    std::vector<int> leafTargets_;
+    //! The indices of the leaves that contain home atoms
+    std::vector<int> targetLeaves_;
+};
+
+#endif
@@ -85,6 +85,7 @@
 
 #include "gromacs/domdec/domdec.h"
 #include "gromacs/ewald/ewald_utils.h"
+#include "gromacs/fft/calcgrid.h"
 #include "gromacs/fft/parallel_3dfft.h"
 #include "gromacs/fileio/pdbio.h"
 #include "gromacs/gmxlib/network.h"
@@ -105,6 +106,7 @@
 #include "gromacs/timing/walltime_accounting.h"
 #include "gromacs/topology/topology.h"
 #include "gromacs/utility/basedefinitions.h"
+#include "gromacs/utility/basenetwork.h"
 #include "gromacs/utility/cstringutil.h"
 #include "gromacs/utility/exceptions.h"
 #include "gromacs/utility/fatalerror.h"
@@ -351,6 +353,11 @@ PmeAtomComm::PmeAtomComm(MPI_Comm   PmeMpiCommunicator,
         slabCommSetup.resize(nslab);
         setup_coordinate_communication(this);
 
+        if (getenv("GMX_PME_NODE_AGGREGATION") != nullptr)
+        {
+            nodeAggregation = makePmeNodeAggregation(mpi_comm, gmx_physicalnode_id_hash());
+        }
+
         count_thread.resize(nthread);
         for (auto& countThread : count_thread)
         {
@@ -561,6 +568,73 @@ static int div_round_up(int enumerator, int denominator)
     return (enumerator + denominator - 1) / denominator;
 }
 
+/*! \brief Determine whether, and with which grid and order, LJ-PME runs on its own grid
+ *
+ * The dispersion mesh contribution is much smaller than the Coulomb one
+ * and decays faster in reciprocal space, so it can often use a coarser
+ * grid and/or a lower interpolation order than electrostatics.
+ * The grid spacing scaling factor is read from GMX_PME_LJ_GRID_SCALING
+ * and the order from GMX_PME_LJ_ORDER.
+ *
+ * \returns true when a separate LJ grid should be used, false when LJ-PME
+ * should share the Coulomb grid.
+ */
+static bool getSeparateLJPmeGrid(const t_inputrec* ir, int numPmeDomainsAlongX, bool useThreads,
+                                 ivec ljGridSize, int* ljPmeOrder)
+{
+    const char* envScaling = getenv("GMX_PME_LJ_GRID_SCALING");
+    const char* envOrder   = getenv("GMX_PME_LJ_ORDER");
+    if (envScaling == nullptr && envOrder == nullptr)
+    {
+        return false;
+    }
+
+    real scaling = 1;
+    if (envScaling != nullptr)
+    {
+        double value;
+        if (sscanf(envScaling, "%20lf", &value) != 1 || value < 1)
+        {
+            gmx_fatal(FARGS, "GMX_PME_LJ_GRID_SCALING should be a number >= 1, not '%s'", envScaling);
+        }
+        scaling = value;
+    }
+    *ljPmeOrder = ir->pme_order;
+    if (envOrder != nullptr)
+    {
+        if (sscanf(envOrder, "%20d", ljPmeOrder) != 1 || *ljPmeOrder < 3 || *ljPmeOrder > PME_ORDER_MAX)
+        {
+            gmx_fatal(FARGS, "GMX_PME_LJ_ORDER should be an integer in the range 3-%d, not '%s'",
+                      PME_ORDER_MAX, envOrder);
+        }
+    }
+
+    ljGridSize[XX] = ir->nkx;
+    ljGridSize[YY] = ir->nky;
+    ljGridSize[ZZ] = ir->nkz;
+    if (scaling > 1)
+    {
+        /* Use the Coulomb grid as a box with spacing 1 and let calcFftGrid pick sizes */
+        matrix gridBox = { { 0 } };
+        for (int d = 0; d < DIM; d++)
+        {
+            gridBox[d][d] = ljGridSize[d];
+            ljGridSize[d] = 0;
+        }
+        calcFftGrid(nullptr, gridBox, scaling, minimalPmeGridSize(*ljPmeOrder), &ljGridSize[XX],
+                    &ljGridSize[YY], &ljGridSize[ZZ]);
+    }
+
+    if (*ljPmeOrder == ir->pme_order && ljGridSize[XX] == ir->nkx && ljGridSize[YY] == ir->nky
+        && ljGridSize[ZZ] == ir->nkz)
+    {
+        return false;
+    }
+
+    return gmx_pme_check_restrictions(*ljPmeOrder, ljGridSize[XX], ljGridSize[YY], ljGridSize[ZZ],
+                                      numPmeDomainsAlongX, useThreads, false);
+}
+
 gmx_pme_t* gmx_pme_init(const t_commrec*         cr,
                         const NumPmeDomains&     numPmeDomains,
                         const t_inputrec*        ir,
@@ -684,6 +758,8 @@ gmx_pme_t* gmx_pme_init(const t_commrec*         cr,
     }
     pme->bUseThreads = (sum_use_threads > 0);
 
+    pme->sortAtomsOnBricks = (getenv("GMX_PME_NO_SPREAD_SORT") == nullptr);
+
     if (ir->ePBC == epbcSCREW)
     {
         gmx_fatal(FARGS, "pme does not (yet) work with pbc = screw");
@@ -702,6 +778,19 @@ gmx_pme_t* gmx_pme_init(const t_commrec*         cr,
     pme->bFEP_q        = ((ir->efep != efepNO) && bFreeEnergy_q);
     pme->bFEP_lj       = ((ir->efep != efepNO) && bFreeEnergy_lj);
     pme->bFEP          = (pme->bFEP_q || pme->bFEP_lj);
+
+    /* With both Coulomb and LJ-PME we can run LJ on a separate grid */
+    ivec ljGridSize;
+    int  ljPmeOrder;
+    const bool useSeparateLJGrid =
+            (pme->doCoulomb && pme->doLJ && runMode == PmeRunMode::CPU
+             && getSeparateLJPmeGrid(ir, pme->nnodes_major, pme->bUseThreads, ljGridSize, &ljPmeOrder));
+    if (useSeparateLJGrid)
+    {
+        pme->doLJ    = false;
+        pme->bFEP_lj = FALSE;
+        pme->bFEP    = pme->bFEP_q;
+    }
     pme->nkx           = ir->nkx;
     pme->nky           = ir->nky;
     pme->nkz           = ir->nkz;
@@ -833,6 +922,9 @@ gmx_pme_t* gmx_pme_init(const t_commrec*         cr,
     snew(pme->cfftgrid, pme->ngrids);
     snew(pme->pfft_setup, pme->ngrids);
 
+    /* Overlapping the FFT transpose communication with FFT work can help with many PME ranks */
+    const bool pipelineFftTransposes = (getenv("GMX_PME_PIPELINE_FFT") != nullptr);
+
     for (i = 0; i < pme->ngrids; ++i)
     {
         if ((i < DO_Q && pme->doCoulomb && (i == 0 || bFreeEnergy_q))
@@ -850,7 +942,8 @@ gmx_pme_t* gmx_pme_init(const t_commrec*         cr,
                                                         ? gmx::PinningPolicy::PinnedIfSupported
                                                         : gmx::PinningPolicy::CannotBePinned;
             gmx_parallel_3dfft_init(&pme->pfft_setup[i], ndata, &pme->fftgrid[i], &pme->cfftgrid[i],
-                                    pme->mpi_comm_d, bReproducible, pme->nthread, allocateRealGridForGpu);
+                                    pme->mpi_comm_d, bReproducible, pme->nthread,
+                                    allocateRealGridForGpu, pipelineFftTransposes);
         }
     }
 
@@ -895,6 +988,33 @@ gmx_pme_t* gmx_pme_init(const t_commrec*         cr,
 
     pme_init_all_work(&pme->solve_work, pme->nthread, pme->nkx);
 
+    if (useSeparateLJGrid)
+    {
+        t_inputrec irc;
+        irc.ePBC                   = ir->ePBC;
+        irc.coulombtype            = eelCUT;
+        irc.vdwtype                = ir->vdwtype;
+        irc.efep                   = ir->efep;
+        irc.pme_order              = ljPmeOrder;
+        irc.epsilon_r              = ir->epsilon_r;
+        irc.ljpme_combination_rule = ir->ljpme_combination_rule;
+        irc.nkx                    = ljGridSize[XX];
+        irc.nky                    = ljGridSize[YY];
+        irc.nkz                    = ljGridSize[ZZ];
+
+        pme->pmeLJ = gmx_pme_init(cr, numPmeDomains, &irc, FALSE, bFreeEnergy_lj, bReproducible,
+                                  ewaldcoeff_q, ewaldcoeff_lj, nthread, runMode, nullptr, gpuInfo,
+                                  pmeGpuProgram, mdlog);
+        /* The LJ forces are added to the Coulomb ones gathered by this setup */
+        pme->pmeLJ->addToForces = true;
+        /* The LJ grid covers the same box, including the scaling with walls */
+        *pme->pmeLJ->boxScaler = *pme->boxScaler;
+
+        GMX_LOG(mdlog.info)
+                .appendTextFormatted("Using a separate LJ-PME grid of %d x %d x %d with order %d",
+                                     ljGridSize[XX], ljGridSize[YY], ljGridSize[ZZ], ljPmeOrder);
+    }
+
     // no exception was thrown during the init, so we hand over the PME structure handle
     return pme.release();
 }
@@ -930,7 +1050,10 @@ void gmx_pme_reinit(struct gmx_pme_t** pmedata,
         const gmx::MDLogger dummyLogger;
         GMX_ASSERT(pmedata, "Invalid PME pointer");
         NumPmeDomains numPmeDomains = { pme_src->nnodes_major, pme_src->nnodes_minor };
-        *pmedata = gmx_pme_init(cr, numPmeDomains, &irc, pme_src->bFEP_q, pme_src->bFEP_lj, FALSE,
+        /* With a separate LJ grid, only the LJ setup has bFEP_lj set */
+        const bool doFepLJ =
+                pme_src->bFEP_lj || (pme_src->pmeLJ != nullptr && pme_src->pmeLJ->bFEP_lj);
+        *pmedata = gmx_pme_init(cr, numPmeDomains, &irc, pme_src->bFEP_q, doFepLJ, FALSE,
                                 ewaldcoeff_q, ewaldcoeff_lj, pme_src->nthread, pme_src->runMode,
                                 pme_src->gpu, nullptr, nullptr, dummyLogger);
         /* When running PME on the CPU not using domain decomposition,
@@ -1053,7 +1176,7 @@ int gmx_pme_do(struct gmx_pme_t*              pme,
     {
         lambda_q = 0;
     }
-    if (!pme->bFEP_lj)
+    if (!pme->bFEP_lj && !pme->pmeLJ)
     {
         lambda_lj = 0;
     }
@@ -1300,7 +1423,7 @@ int gmx_pme_do(struct gmx_pme_t*              pme,
              * therefore we should not clear it.
              */
             lambda  = grid_index < DO_Q ? lambda_q : lambda_lj;
-            bClearF = (bFirst && PAR(cr));
+            bClearF = (bFirst && PAR(cr) && !(pme->addToForces && pme->nnodes == 1));
 #pragma omp parallel for num_threads(pme->nthread) schedule(static)
             for (thread = 0; thread < pme->nthread; thread++)
             {
@@ -1552,7 +1675,8 @@ int gmx_pme_do(struct gmx_pme_t*              pme,
                     if (bCalcF)
                     {
                         /* interpolate forces for our local atoms */
-                        bClearF = (bFirst && PAR(cr));
+                        bClearF = (bFirst && PAR(cr)
+                                   && !(pme->addToForces && pme->nnodes == 1));
                         scale   = pme->bFEP ? (fep_state < 1 ? 1.0 - lambda_lj : lambda_lj) : 1.0;
                         scale *= lb_scale_factor[grid_index - 2];
 
@@ -1597,7 +1721,8 @@ int gmx_pme_do(struct gmx_pme_t*              pme,
             }
             if (DOMAINDECOMP(cr))
             {
-                dd_pmeredist_f(pme, &pme->atc[d], forcesRef, d == pme->ndecompdim - 1 && pme->bPPnode);
+                dd_pmeredist_f(pme, &pme->atc[d], forcesRef,
+                               d == pme->ndecompdim - 1 && (pme->bPPnode || pme->addToForces));
             }
         }
 
@@ -1667,6 +1792,18 @@ int gmx_pme_do(struct gmx_pme_t*              pme,
             *energy_lj = 0;
         }
     }
+
+    if (pme->pmeLJ)
+    {
+        /* Compute LJ-PME on its own grid, this only sets the LJ outputs */
+        matrix virialDummy    = { { 0 } };
+        real   energyDummy    = 0;
+        real   dvdlambdaDummy = 0;
+        gmx_pme_do(pme->pmeLJ, coordinates, forces, chargeA, chargeB, c6A, c6B, sigmaA, sigmaB, box,
+                   cr, maxshift_x, maxshift_y, nrnb, wcycle, virialDummy, vir_lj, &energyDummy,
+                   energy_lj, lambda_q, lambda_lj, &dvdlambdaDummy, dvdlambda_lj, flags);
+    }
+
     return 0;
 }
 
@@ -1724,6 +1861,8 @@ void gmx_pme_destroy(gmx_pme_t* pme)
         pme_gpu_destroy(pme->gpu);
     }
 
+    gmx_pme_destroy(pme->pmeLJ);
+
     delete pme;
 }
 
@@ -1738,4 +1877,8 @@ void gmx_pme_reinit_atoms(gmx_pme_t* pme, const int numAtoms, const real* charge
         pme->atc[0].setNumAtoms(numAtoms);
         // TODO: set the charges here as well
     }
+    if (pme->pmeLJ)
+    {
+        gmx_pme_reinit_atoms(pme->pmeLJ, numAtoms, nullptr);
+    }
 }
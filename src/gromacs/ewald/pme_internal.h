@@ -55,10 +55,14 @@
 
 #include "config.h"
 
+#include <memory>
+#include <vector>
+
 #include "gromacs/math/gmxcomplex.h"
 #include "gromacs/utility/basedefinitions.h"
 #include "gromacs/utility/defaultinitializationallocator.h"
 #include "gromacs/utility/gmxmpi.h"
+#include "gromacs/utility/physicalnodecommunicator.h"
 #include "gromacs/utility/smalloc.h"
 
 #include "pme_gpu_types_host.h"
@@ -189,6 +193,8 @@ struct splinedata_t
     SplineCoefficients theta;
     SplineCoefficients dtheta;
     int                nalloc = 0;
+    FastVector<int>    indBuffer;  /* Buffer for sorting ind on grid bricks */
+    std::vector<int>   brickCount; /* Cumulative atom counts per grid brick */
 };
 
 /*! \brief PME slab MPI communication setup */
@@ -204,6 +210,48 @@ struct SlabCommSetup
     int rcount;
 };
 
+/*! \internal
+ * \brief Setup for aggregating PME atom redistribution over physical nodes
+ *
+ * Data for ranks on other physical nodes is gathered on the leader rank
+ * of each node, using MPI_Gather for the counts and MPI_Gatherv for the
+ * data. The leaders exchange the counts and the data with two
+ * MPI_Alltoallv calls, so there is one data message per pair of nodes,
+ * and scatter the received data over the ranks of their node with
+ * MPI_Scatterv. Note that a redistribution of coordinates and
+ * coefficients does three such exchanges: for the atom counts, for the
+ * coordinates and for the coefficients.
+ */
+struct PmeNodeAggregation
+{
+    //! Communicator for the ranks of this dimension on our physical node
+    std::unique_ptr<gmx::PhysicalNodeCommunicator> physicalNodeComm;
+    //! Communicator between the node leaders, MPI_COMM_NULL on other ranks
+    MPI_Comm leaderComm = MPI_COMM_NULL;
+    //! Frees \p leaderComm
+    gmx::MPI_Comm_ptr leaderCommGuard;
+    //! The index of our physical node
+    int node = 0;
+    //! The node index of each slab, nodes are ordered on their lowest slab index
+    std::vector<int> nodeOfSlab;
+    //! The slab indices on each node, in increasing order
+    std::vector<std::vector<int>> nodeSlabs;
+    //! Buffers for packing and unpacking
+    std::vector<char> sendBuffer, recvBuffer, nodeSendBuffer, nodeRecvBuffer;
+    //! Atom count buffers for the node leader
+    std::vector<int> countMatrix, headerSend, headerRecv;
+    //! Counts and displacements per slab
+    std::vector<int> sendCountSlab, sendDisplSlab, recvCountSlab, recvDisplSlab, offNodeCount;
+    //! Counts and displacements per rank on our node, only used on the leader
+    std::vector<int> rankCount, rankDispl, scatterCount, scatterDispl;
+    //! Counts and displacements per node, only used on the leader
+    std::vector<int> headerSendCount, headerSendDispl, headerRecvCount, headerRecvDispl;
+    //! Byte counts and displacements per node, only used on the leader
+    std::vector<int> byteSendCount, byteSendDispl, byteRecvCount, byteRecvDispl;
+    //! Positions of the blocks in the gathered and in the received data, only used on the leader
+    std::vector<int> blockStart, recvPos;
+};
+
 /*! \internal
  * \brief Data structure for coordinating transfers between PME ranks along one dimension
  *
@@ -241,6 +289,8 @@ public:
     std::vector<SlabCommSetup> slabCommSetup;
     //! The maximum communication distance counted in MPI ranks
     int maxshift = 0;
+    //! Aggregation of the communication over physical nodes, nullptr when not used
+    std::unique_ptr<PmeNodeAggregation> nodeAggregation;
 
     //! The target slab index for each particle
     FastVector<int> pd;
@@ -327,8 +377,9 @@ struct gmx_pme_t
     MPI_Datatype rvec_mpi; /* the pme vector's MPI type */
 #endif
 
-    gmx_bool bUseThreads; /* Does any of the PME ranks have nthread>1 ?  */
-    int      nthread;     /* The number of threads doing PME on our rank */
+    gmx_bool bUseThreads;       /* Does any of the PME ranks have nthread>1 ?  */
+    int      nthread;           /* The number of threads doing PME on our rank */
+    bool     sortAtomsOnBricks; /* With threads, sort the atoms of each thread on grid bricks */
 
     gmx_bool bPPnode;   /* Node also does particle-particle forces */
     bool     doCoulomb; /* Apply PME to electrostatics */
@@ -431,6 +482,11 @@ struct gmx_pme_t
     /* Work data for sum_qgrid */
     real* sum_qgrid_tmp;
     real* sum_qgrid_dd_tmp;
+
+    /* Setup for LJ-PME on a separate, usually coarser, grid; nullptr when LJ uses our grid */
+    gmx_pme_t* pmeLJ = nullptr;
+    /* Add the gathered forces to the output force buffer instead of overwriting it */
+    bool addToForces = false;
 };
 
 //! @endcond
@@ -48,6 +48,7 @@
 
 #include <cassert>
 #include <cmath>
+#include <cstdlib>
 
 #include <algorithm>
 
@@ -80,6 +81,7 @@
 #include "gromacs/utility/strconvert.h"
 
 #include "pme_internal.h"
+#include "pme_load_balancing_internal.h"
 
 /*! \brief Parameters and settings for one PP-PME setup */
 struct pme_setup_t
@@ -136,6 +138,11 @@ const int c_numFirstTuningIntervalSkipWithSepPme = 3;
 const int c_numPostSwitchTuningIntervalSkip = 1;
 //! \brief Number of seconds to delay the tuning at startup to allow processors clocks to ramp up.
 const double c_startupTimeDelay = 5.0;
+//! \brief Number of nstlist long intervals to average over when monitoring the load after tuning
+//         with the cost model.
+const int c_numMonitorIntervals = 10;
+//! \brief Restart tuning with the cost model when the performance changes by more than 10%.
+const double c_loadChangeRetriggerFactor = 1.1;
 
 /*! \brief Enumeration whose values describe the effect limiting the load balancing */
 enum epmelb
@@ -182,6 +189,12 @@ struct pme_load_balancing_t
 
     int stage; /**< the current stage */
 
+    bool   useCostModel;           /**< select setups with a PP/PME cost model instead of scanning */
+    bool   monitorLoad;            /**< with the cost model, monitoring the load after tuning */
+    int    monitorCount;           /**< number of intervals accumulated for monitoring */
+    double monitorCycles;          /**< cycles accumulated for monitoring */
+    double monitorReferenceCycles; /**< average cycles of the first monitoring period, 0 when unset */
+
     int    cycles_n;  /**< step cycle counter cumulative count */
     double cycles_c;  /**< step cycle counter cumulative cycles */
     double startTime; /**< time stamp when the balancing was started on the master rank (relative to the UNIX epoch start).*/
@@ -191,7 +204,7 @@ struct pme_load_balancing_t
  * read bActive anywhere */
 bool pme_loadbal_is_active(const pme_load_balancing_t* pme_lb)
 {
-    return pme_lb != nullptr && pme_lb->bActive;
+    return pme_lb != nullptr && pme_lb->bActive && !pme_lb->monitorLoad;
 }
 
 // TODO Return a unique_ptr to pme_load_balancing_t
@@ -225,8 +238,11 @@ void pme_loadbal_init(pme_load_balancing_t**     pme_lb_p,
     /* Initially we turn on balancing directly on based on PP/PME imbalance */
     pme_lb->bTriggerOnDLB = FALSE;
 
-    /* Any number of stages >= 2 is supported */
-    pme_lb->nstage = 2;
+    /* Instead of scanning setups, we can predict the optimum with a cost model */
+    pme_lb->useCostModel = (getenv("GMX_PME_LB_COST_MODEL") != nullptr);
+
+    /* Any number of stages >= 2 is supported, the cost model uses a single stage */
+    pme_lb->nstage = pme_lb->useCostModel ? 1 : 2;
 
     pme_lb->cutoff_scheme = ir.cutoff_scheme;
 
@@ -291,6 +307,11 @@ void pme_loadbal_init(pme_load_balancing_t**     pme_lb_p,
     pme_lb->end         = 0;
     pme_lb->elimited    = epmelblimNO;
 
+    pme_lb->monitorLoad            = false;
+    pme_lb->monitorCount           = 0;
+    pme_lb->monitorCycles          = 0;
+    pme_lb->monitorReferenceCycles = 0;
+
     pme_lb->cycles_n = 0;
     pme_lb->cycles_c = 0;
     // only master ranks do timing
@@ -299,6 +320,13 @@ void pme_loadbal_init(pme_load_balancing_t**     pme_lb_p,
         pme_lb->startTime = gmx_gettime();
     }
 
+    if (pme_lb->useCostModel)
+    {
+        GMX_LOG(mdlog.info)
+                .asParagraph()
+                .appendText("PME tuning will select setups using a PP/PME cost model");
+    }
+
     if (!wallcycle_have_counter())
     {
         GMX_LOG(mdlog.warning)
@@ -536,6 +564,280 @@ static void switch_to_stage1(pme_load_balancing_t* pme_lb)
     pme_lb->cur = pme_lb->end;
 }
 
+/*! \brief Start a new round of tuning with the cost model from the current setup
+ *
+ * All measurements are discarded, as the conditions changed.
+ */
+static void restart_pme_loadbal_model(pme_load_balancing_t* pme_lb)
+{
+    for (pme_setup_t& set : pme_lb->setup)
+    {
+        set.count  = 0;
+        set.cycles = 0;
+    }
+    pme_lb->fastest     = pme_lb->cur;
+    pme_lb->stage       = 0;
+    pme_lb->nstage      = 1;
+    pme_lb->monitorLoad = false;
+}
+
+/*! \brief Generate all setups allowed by the PME grid, the maximum grid scaling and the box
+ *
+ * The DD limits are only checked when switching to a setup.
+ */
+static void pme_loadbal_generate_setups(pme_load_balancing_t* pme_lb,
+                                        const t_inputrec&     ir,
+                                        const matrix          box,
+                                        const gmx_domdec_t*   dd)
+{
+    int  cur = pme_lb->cur;
+    bool OK  = true;
+
+    while (OK)
+    {
+        /* pme_loadbal_increase_cutoff() adds the setup following cur */
+        pme_lb->cur = pme_lb->setup.size() - 1;
+        OK          = pme_loadbal_increase_cutoff(pme_lb, ir.pme_order, dd);
+        if (!OK)
+        {
+            pme_lb->elimited = epmelblimPMEGRID;
+            break;
+        }
+
+        const pme_setup_t& set = pme_lb->setup.back();
+        if (set.spacing > c_maxSpacingScaling * pme_lb->setup[0].spacing)
+        {
+            OK               = false;
+            pme_lb->elimited = epmelblimMAXSCALING;
+        }
+        else if (ir.ePBC != epbcNONE && gmx::square(set.rlistOuter) > max_cutoff2(ir.ePBC, box))
+        {
+            OK               = false;
+            pme_lb->elimited = epmelblimBOX;
+        }
+        if (!OK)
+        {
+            pme_lb->setup.pop_back();
+        }
+    }
+
+    pme_lb->cur = cur;
+    pme_lb->end = pme_lb->setup.size();
+}
+
+/*! \brief Return whether a setup has been timed in the current tuning round */
+static bool pme_loadbal_is_timed(const pme_setup_t& set)
+{
+    return set.count > c_numPostSwitchTuningIntervalSkip;
+}
+
+//! Returns the number of grid points of \p grid
+static double numGridPoints(const ivec grid)
+{
+    return static_cast<double>(grid[XX]) * grid[YY] * grid[ZZ];
+}
+
+/*! \brief Returns the index of the setup to probe, or -1 when the probes have been timed
+ *
+ * The cost model needs timings on both sides of the fastest setup. We probe
+ * a setup with a longer cut-off and, when shorter cut-offs are allowed, one
+ * with a shorter cut-off, both with a substantially different number of
+ * grid points.
+ */
+static int pmeLoadBalancingModelProbe(gmx::ArrayRef<const PmeLoadBalancingModelSetup> setups,
+                                      int                                             lowerLimit,
+                                      int                                             fastest)
+{
+    const int    end             = setups.ssize();
+    const double startGridPoints = numGridPoints(setups[fastest].grid);
+
+    int probeUp = -1;
+    for (int i = fastest + 1; i < end && probeUp < 0; i++)
+    {
+        if (numGridPoints(setups[i].grid) < gridpointsScaleFactor * startGridPoints || i == end - 1)
+        {
+            probeUp = i;
+        }
+    }
+    if (probeUp >= 0 && !setups[probeUp].isTimed)
+    {
+        return probeUp;
+    }
+
+    int probeDown = -1;
+    for (int i = fastest - 1; i >= lowerLimit && probeDown < 0; i--)
+    {
+        if (numGridPoints(setups[i].grid) * gridpointsScaleFactor > startGridPoints || i == lowerLimit)
+        {
+            probeDown = i;
+        }
+    }
+    if (probeDown >= 0 && !setups[probeDown].isTimed)
+    {
+        return probeDown;
+    }
+
+    return -1;
+}
+
+/* Each timed setup gives an upper bound for a and b in max(a*ppCost, b*pmeCost);
+ * the bounds are tight for the setups that are PP and PME bound, respectively.
+ * A timed setup with a longer cut-off that is slower than the fastest setup
+ * is PP bound, since its PME cost is lower. Similarly, a slower setup with
+ * a shorter cut-off is PME bound. So once the fastest setup is bracketed by
+ * slower timed setups, both bounds are tight and the prediction is accurate
+ * in between. We jump to the setup with the lowest predicted time, which then
+ * verifies the prediction. We are done when the fastest prediction is for
+ * a timed setup or gains less than the fluctuations.
+ */
+int pmeLoadBalancingModelSelect(gmx::ArrayRef<const PmeLoadBalancingModelSetup> setups,
+                                int                                             lowerLimit,
+                                int*                                            fastest)
+{
+    const int                         end           = setups.ssize();
+    const PmeLoadBalancingModelSetup& ref           = setups[0];
+    const double                      refGridPoints = numGridPoints(ref.grid);
+
+    std::vector<double> ppCost(end);
+    std::vector<double> pmeCost(end);
+    double              ppScale  = GMX_DOUBLE_MAX;
+    double              pmeScale = GMX_DOUBLE_MAX;
+    *fastest                     = -1;
+    for (int i = lowerLimit; i < end; i++)
+    {
+        const PmeLoadBalancingModelSetup& set = setups[i];
+
+        ppCost[i]  = gmx::power3(set.rlistInner / ref.rlistInner);
+        pmeCost[i] = numGridPoints(set.grid) / refGridPoints;
+        if (set.isTimed)
+        {
+            ppScale  = std::min(ppScale, set.cycles / ppCost[i]);
+            pmeScale = std::min(pmeScale, set.cycles / pmeCost[i]);
+            if (*fastest < 0 || set.cycles < setups[*fastest].cycles)
+            {
+                *fastest = i;
+            }
+        }
+    }
+    GMX_RELEASE_ASSERT(*fastest >= 0, "We should have timed at least one setup");
+
+    int probe = pmeLoadBalancingModelProbe(setups, lowerLimit, *fastest);
+    if (probe >= 0)
+    {
+        return probe;
+    }
+
+    int    best       = -1;
+    double bestCycles = 0;
+    for (int i = lowerLimit; i < end; i++)
+    {
+        const PmeLoadBalancingModelSetup& set = setups[i];
+
+        double cycles = set.isTimed ? set.cycles : std::max(ppScale * ppCost[i], pmeScale * pmeCost[i]);
+        if (best < 0 || cycles < bestCycles)
+        {
+            best       = i;
+            bestCycles = cycles;
+        }
+    }
+
+    if (debug)
+    {
+        fprintf(debug, "PME loadbal model: PP %.1f PME %.1f M-cycles, predicted optimum setup %d\n",
+                ppScale * 1e-6, pmeScale * 1e-6, best);
+    }
+
+    if (setups[best].isTimed || bestCycles * maxFluctuationAccepted >= setups[*fastest].cycles)
+    {
+        return -1;
+    }
+
+    return best;
+}
+
+/*! \brief Select the next setup to time using the cost model, returns -1 when done
+ *
+ * Also sets pme_lb->fastest.
+ */
+static int pme_loadbal_model_next(pme_load_balancing_t* pme_lb)
+{
+    std::vector<PmeLoadBalancingModelSetup> setups(pme_lb->end);
+    for (int i = 0; i < pme_lb->end; i++)
+    {
+        const pme_setup_t& set = pme_lb->setup[i];
+
+        setups[i].rlistInner = set.rlistInner;
+        copy_ivec(set.grid, setups[i].grid);
+        setups[i].isTimed = pme_loadbal_is_timed(set);
+        setups[i].cycles  = set.cycles;
+    }
+
+    return pmeLoadBalancingModelSelect(setups, pme_lb->lower_limit, &pme_lb->fastest);
+}
+
+/*! \brief Choose the next setup with the cost model and check that DD supports it
+ *
+ * When tuning is done, switches to the fastest setup and sets stage to nstage.
+ */
+static void pme_loadbal_select_with_model(pme_load_balancing_t*          pme_lb,
+                                          t_commrec*                     cr,
+                                          FILE*                          fp_err,
+                                          FILE*                          fp_log,
+                                          const t_inputrec&              ir,
+                                          const matrix                   box,
+                                          gmx::ArrayRef<const gmx::RVec> x,
+                                          int64_t                        step)
+{
+    if (pme_lb->end == 0)
+    {
+        pme_loadbal_generate_setups(pme_lb, ir, box, cr->dd);
+        if (pme_lb->elimited != epmelblimNO)
+        {
+            print_loadbal_limited(fp_err, fp_log, step, pme_lb);
+        }
+    }
+
+    bool OK;
+    do
+    {
+        int next = pme_loadbal_model_next(pme_lb);
+        if (next < 0)
+        {
+            /* We are done optimizing, use the fastest setup we found */
+            next          = pme_lb->fastest;
+            pme_lb->stage = pme_lb->nstage;
+        }
+
+        /* Always set the DD cut-off, it might be longer than needed for this setup */
+        OK = !DOMAINDECOMP(cr) || change_dd_cutoff(cr, box, x, pme_lb->setup[next].rlistOuter);
+        if (!OK && next <= pme_lb->lower_limit)
+        {
+            /* This should not happen, as we set limits on the DLB bounds.
+             * DD kept its current cut-off, which is longer and thus also
+             * supports this setup.
+             */
+            OK = true;
+        }
+        if (OK)
+        {
+            pme_lb->cur = next;
+        }
+        else
+        {
+            /* The cut-off is incompatible with DD, so are all longer ones */
+            pme_lb->end      = next;
+            pme_lb->stage    = 0;
+            pme_lb->elimited = epmelblimDD;
+            print_loadbal_limited(fp_err, fp_log, step, pme_lb);
+        }
+    } while (!OK);
+
+    if (DOMAINDECOMP(cr))
+    {
+        set_dd_dlb_max_cutoff(cr, pme_lb->setup[pme_lb->fastest].rlistOuter);
+    }
+}
+
 /*! \brief Process the timings and try to adjust the PME grid and Coulomb cut-off
  *
  * The adjustment is done to generate a different non-bonded PP and PME load.
@@ -638,10 +940,16 @@ static void pme_load_balance(pme_load_balancing_t*          pme_lb,
     }
     cycles_fast = pme_lb->setup[pme_lb->fastest].cycles;
 
+    if (pme_lb->useCostModel)
+    {
+        /* The model selects the setup, the staged scan below is skipped */
+        pme_loadbal_select_with_model(pme_lb, cr, fp_err, fp_log, ir, box, x, step);
+    }
+
     /* Check in stage 0 if we should stop scanning grids.
      * Stop when the time is more than maxRelativeSlowDownAccepted longer than the fastest.
      */
-    if (pme_lb->stage == 0 && pme_lb->cur > 0
+    if (!pme_lb->useCostModel && pme_lb->stage == 0 && pme_lb->cur > 0
         && cycles > pme_lb->setup[pme_lb->fastest].cycles * maxRelativeSlowdownAccepted)
     {
         pme_lb->setup.resize(pme_lb->cur + 1);
@@ -649,7 +957,7 @@ static void pme_load_balance(pme_load_balancing_t*          pme_lb,
         switch_to_stage1(pme_lb);
     }
 
-    if (pme_lb->stage == 0)
+    if (!pme_lb->useCostModel && pme_lb->stage == 0)
     {
         int gridsize_start;
 
@@ -722,7 +1030,11 @@ static void pme_load_balance(pme_load_balancing_t*          pme_lb,
                                  < pme_lb->setup[pme_lb->cur - 1].grid_efficiency * relativeEfficiencyFactor));
     }
 
-    if (pme_lb->stage > 0 && pme_lb->end == 1)
+    if (pme_lb->useCostModel)
+    {
+        /* Nothing to do here, the model has selected the setup */
+    }
+    else if (pme_lb->stage > 0 && pme_lb->end == 1)
     {
         pme_lb->cur   = pme_lb->lower_limit;
         pme_lb->stage = pme_lb->nstage;
@@ -760,7 +1072,7 @@ static void pme_load_balance(pme_load_balancing_t*          pme_lb,
         }
     }
 
-    if (DOMAINDECOMP(cr) && pme_lb->stage > 0)
+    if (!pme_lb->useCostModel && DOMAINDECOMP(cr) && pme_lb->stage > 0)
     {
         OK = change_dd_cutoff(cr, box, x, pme_lb->setup[pme_lb->cur].rlistOuter);
         if (!OK)
@@ -891,6 +1203,72 @@ static void continue_pme_loadbal(pme_load_balancing_t* pme_lb, gmx_bool bDlbUnlo
         pme_lb->lower_limit = pme_lb->cur;
     }
     pme_lb->start = pme_lb->lower_limit;
+
+    if (pme_lb->useCostModel)
+    {
+        restart_pme_loadbal_model(pme_lb);
+    }
+}
+
+/*! \brief Monitor the performance after tuning with the cost model
+ *
+ * The optimal setup can drift during long runs, e.g. due to DD load
+ * balancing or changes in the system. The average time over the first
+ * c_numMonitorIntervals intervals after tuning is the reference. When
+ * the average time over a later period of c_numMonitorIntervals intervals
+ * differs too much from the reference, a new round of tuning is started.
+ * We do not compare with the tuning timings, as those are minima over
+ * few intervals, whereas the reference is an average, as the monitored time.
+ */
+static void pme_loadbal_monitor(pme_load_balancing_t* pme_lb,
+                                t_commrec*            cr,
+                                FILE*                 fp_err,
+                                FILE*                 fp_log,
+                                int64_t               step,
+                                double                cycles)
+{
+    pme_lb->monitorCycles += cycles;
+    pme_lb->monitorCount++;
+    if (pme_lb->monitorCount < c_numMonitorIntervals)
+    {
+        return;
+    }
+
+    double cyclesAverage = pme_lb->monitorCycles / pme_lb->monitorCount;
+    if (PAR(cr))
+    {
+        gmx_sumd(1, &cyclesAverage, cr);
+        cyclesAverage /= cr->nnodes;
+    }
+    pme_lb->monitorCount  = 0;
+    pme_lb->monitorCycles = 0;
+
+    if (pme_lb->monitorReferenceCycles == 0)
+    {
+        pme_lb->monitorReferenceCycles = cyclesAverage;
+        return;
+    }
+
+    const double cyclesReference = pme_lb->monitorReferenceCycles;
+    if (cyclesAverage > cyclesReference * c_loadChangeRetriggerFactor
+        || cyclesAverage * c_loadChangeRetriggerFactor < cyclesReference)
+    {
+        auto buf = gmx::formatString(
+                "step %4s: performance changed from %.1f to %.1f M-cycles, restarting PME tuning",
+                gmx::int64ToString(step).c_str(), cyclesReference * 1e-6, cyclesAverage * 1e-6);
+        if (fp_err != nullptr)
+        {
+            fprintf(fp_err, "\r%s\n", buf.c_str());
+            fflush(fp_err);
+        }
+        if (fp_log != nullptr)
+        {
+            fprintf(fp_log, "%s\n", buf.c_str());
+        }
+
+        restart_pme_loadbal_model(pme_lb);
+        pme_lb->bBalance = TRUE;
+    }
 }
 
 void pme_loadbal_do(pme_load_balancing_t*          pme_lb,
@@ -942,6 +1320,20 @@ void pme_loadbal_do(pme_load_balancing_t*          pme_lb,
         *bPrinting = FALSE;
         return;
     }
+
+    if (pme_lb->monitorLoad)
+    {
+        /* Only monitor complete intervals, cycle counters can be reset during the run */
+        if (pme_lb->cycles_n - n_prev == ir.nstlist)
+        {
+            pme_loadbal_monitor(pme_lb, cr, fp_err, fp_log, step, pme_lb->cycles_c - cycles_prev);
+        }
+        if (pme_lb->monitorLoad)
+        {
+            *bPrinting = FALSE;
+            return;
+        }
+    }
     /* Sanity check, we expect nstlist cycle counts */
     if (pme_lb->cycles_n - n_prev != ir.nstlist)
     {
@@ -1009,6 +1401,14 @@ void pme_loadbal_do(pme_load_balancing_t*          pme_lb,
             pme_lb->bTriggerOnDLB = TRUE;
             pme_lb->step_rel_stop = step_rel + PMETunePeriod * ir.nstlist;
         }
+        else if (pme_lb->useCostModel)
+        {
+            /* Keep watching the load, the optimum can drift during the run */
+            pme_lb->monitorLoad            = true;
+            pme_lb->monitorCount           = 0;
+            pme_lb->monitorCycles          = 0;
+            pme_lb->monitorReferenceCycles = 0;
+        }
         else
         {
             /* We're completely done with PME tuning */
@@ -1044,7 +1444,8 @@ void pme_loadbal_do(pme_load_balancing_t*          pme_lb,
         }
     }
 
-    if (!pme_lb->bBalance && (!pme_lb->bSepPMERanks || step_rel > pme_lb->step_rel_stop))
+    if (!pme_lb->bBalance && !pme_lb->monitorLoad
+        && (!pme_lb->bSepPMERanks || step_rel > pme_lb->step_rel_stop))
     {
         /* We have just deactivated the balancing and we're not measuring PP/PME
          * imbalance during the first steps of the run: deactivate the tuning.
@@ -1052,7 +1453,7 @@ void pme_loadbal_do(pme_load_balancing_t*          pme_lb,
         pme_lb->bActive = FALSE;
     }
 
-    if (!(pme_lb->bActive) && DOMAINDECOMP(cr) && dd_dlb_is_locked(cr->dd))
+    if ((!pme_lb->bActive || pme_lb->monitorLoad) && DOMAINDECOMP(cr) && dd_dlb_is_locked(cr->dd))
     {
         /* Make sure DLB is allowed when we deactivate PME tuning */
         dd_dlb_unlock(cr->dd);
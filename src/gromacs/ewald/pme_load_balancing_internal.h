@@ -0,0 +1,81 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2020, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ *
+ * \brief Declares the cost model used for selecting PME tuning setups
+ *
+ * \ingroup module_ewald
+ */
+
+#ifndef GMX_EWALD_PME_LOAD_BALANCING_INTERNAL_H
+#define GMX_EWALD_PME_LOAD_BALANCING_INTERNAL_H
+
+#include "gromacs/math/vectypes.h"
+#include "gromacs/utility/arrayref.h"
+#include "gromacs/utility/real.h"
+
+/*! \internal
+ * \brief The parameters and timing of a PP-PME setup that the cost model uses
+ */
+struct PmeLoadBalancingModelSetup
+{
+    //! Cut-off for the inner pair-list
+    real rlistInner;
+    //! The PME grid dimensions
+    ivec grid;
+    //! Whether this setup has been timed in the current tuning round
+    bool isTimed;
+    //! The fastest time for this setup in cycles, only valid when timed
+    double cycles;
+};
+
+/*! \brief Returns the setup to time next using the PP/PME cost model, -1 when tuning is done
+ *
+ * The time per step is modeled as max(a*ppCost, b*pmeCost), with the PP
+ * cost proportional to the volume of the inner pair-list sphere and the
+ * PME cost proportional to the number of grid points. First the fastest
+ * timed setup is bracketed by timed setups with substantially different
+ * numbers of grid points, then the setup with the lowest predicted time
+ * is returned.
+ *
+ * \param[in]  setups      The setups, ordered by increasing cut-off, at least one is timed
+ * \param[in]  lowerLimit  Index of the setup with the shortest cut-off that can be used
+ * \param[out] fastest     Index of the fastest timed setup
+ */
+int pmeLoadBalancingModelSelect(gmx::ArrayRef<const PmeLoadBalancingModelSetup> setups,
+                                int                                             lowerLimit,
+                                int*                                            fastest);
+
+#endif
@@ -55,6 +55,7 @@
 
 #include "gromacs/math/vec.h"
 #include "gromacs/mdtypes/commrec.h"
+#include "gromacs/utility/basenetwork.h"
 #include "gromacs/utility/exceptions.h"
 #include "gromacs/utility/fatalerror.h"
 #include "gromacs/utility/gmxmpi.h"
@@ -278,6 +279,377 @@ static void pme_dd_sendrecv(PmeAtomComm gmx_unused* atc,
 #endif
 }
 
+#if GMX_MPI
+//! Resizes \p buffer to \p size, but keeps at least one element to avoid passing NULL to MPI
+template<typename T>
+static void resizeMpiBuffer(std::vector<T>* buffer, int size)
+{
+    buffer->resize(std::max(size, 1));
+}
+
+/*! \brief Exchanges data with ranks on other physical nodes through the node leaders
+ *
+ * Counts and displacements are in elements of \p elementSize bytes and
+ * indexed by slab. Entries for slabs on our own node are not used.
+ * Has to be called on all ranks of the communicator of the aggregation.
+ */
+static void pme_node_aggregated_exchange(PmeNodeAggregation*      agg,
+                                         int                      nslab,
+                                         gmx::ArrayRef<const int> sendCount,
+                                         gmx::ArrayRef<const int> sendDispl,
+                                         const char*              buf_s,
+                                         gmx::ArrayRef<const int> recvCount,
+                                         gmx::ArrayRef<const int> recvDispl,
+                                         char*                    buf_r,
+                                         int                      elementSize)
+{
+    const gmx::PhysicalNodeCommunicator& nodeComm = *agg->physicalNodeComm;
+
+    const int  numNodes = agg->nodeSlabs.size();
+    const int  nodeSize = agg->nodeSlabs[agg->node].size();
+    const bool isLeader = (nodeComm.rank_ == 0);
+
+    /* Pack our data for the other nodes, ordered on node and slab */
+    std::vector<int>& offNodeCount = agg->offNodeCount;
+    offNodeCount.assign(nslab, 0);
+    int numBytesSend = 0;
+    int numBytesRecv = 0;
+    for (int node = 0; node < numNodes; node++)
+    {
+        if (node != agg->node)
+        {
+            for (int slab : agg->nodeSlabs[node])
+            {
+                offNodeCount[slab] = sendCount[slab];
+                numBytesSend += sendCount[slab] * elementSize;
+                numBytesRecv += recvCount[slab] * elementSize;
+            }
+        }
+    }
+    resizeMpiBuffer(&agg->sendBuffer, numBytesSend);
+    char* sendPtr = agg->sendBuffer.data();
+    for (int node = 0; node < numNodes; node++)
+    {
+        if (node != agg->node)
+        {
+            for (int slab : agg->nodeSlabs[node])
+            {
+                const char* slabPtr = buf_s + sendDispl[slab] * elementSize;
+                sendPtr = std::copy(slabPtr, slabPtr + sendCount[slab] * elementSize, sendPtr);
+            }
+        }
+    }
+
+    /* Gather the counts and the data of all ranks on our node on the leader */
+    std::vector<int>& rankCount = agg->rankCount;
+    std::vector<int>& rankDispl = agg->rankDispl;
+    if (isLeader)
+    {
+        agg->countMatrix.resize(nodeSize * nslab);
+    }
+    MPI_Gather(offNodeCount.data(), nslab, MPI_INT, agg->countMatrix.data(), nslab, MPI_INT, 0,
+               nodeComm.comm_);
+    if (isLeader)
+    {
+        rankCount.resize(nodeSize);
+        rankDispl.resize(nodeSize);
+        int numBytes = 0;
+        for (int r = 0; r < nodeSize; r++)
+        {
+            rankDispl[r] = numBytes;
+            for (int slab = 0; slab < nslab; slab++)
+            {
+                numBytes += agg->countMatrix[r * nslab + slab] * elementSize;
+            }
+            rankCount[r] = numBytes - rankDispl[r];
+        }
+        resizeMpiBuffer(&agg->nodeRecvBuffer, numBytes);
+    }
+    MPI_Gatherv(agg->sendBuffer.data(), numBytesSend, MPI_BYTE, agg->nodeRecvBuffer.data(),
+                rankCount.data(), rankDispl.data(), MPI_BYTE, 0, nodeComm.comm_);
+
+    std::vector<int>& scatterCount = agg->scatterCount;
+    std::vector<int>& scatterDispl = agg->scatterDispl;
+    if (isLeader)
+    {
+        /* Exchange the counts between node leaders, for each node pair
+         * ordered on the source rank and the destination slab.
+         */
+        std::vector<int>& headerSendCount = agg->headerSendCount;
+        std::vector<int>& headerSendDispl = agg->headerSendDispl;
+        std::vector<int>& headerRecvCount = agg->headerRecvCount;
+        std::vector<int>& headerRecvDispl = agg->headerRecvDispl;
+        std::vector<int>& byteSendCount   = agg->byteSendCount;
+        std::vector<int>& byteSendDispl   = agg->byteSendDispl;
+        std::vector<int>& byteRecvCount   = agg->byteRecvCount;
+        std::vector<int>& byteRecvDispl   = agg->byteRecvDispl;
+        headerSendCount.assign(numNodes, 0);
+        headerSendDispl.assign(numNodes, 0);
+        headerRecvCount.assign(numNodes, 0);
+        headerRecvDispl.assign(numNodes, 0);
+        byteSendCount.assign(numNodes, 0);
+        byteSendDispl.assign(numNodes, 0);
+        byteRecvCount.assign(numNodes, 0);
+        byteRecvDispl.assign(numNodes, 0);
+        /* Start of the data for each node in the gathered data of each rank */
+        std::vector<int>& blockStart = agg->blockStart;
+        blockStart.resize(nodeSize * numNodes);
+        for (int r = 0; r < nodeSize; r++)
+        {
+            int pos = rankDispl[r];
+            for (int node = 0; node < numNodes; node++)
+            {
+                blockStart[r * numNodes + node] = pos;
+                if (node != agg->node)
+                {
+                    for (int slab : agg->nodeSlabs[node])
+                    {
+                        pos += agg->countMatrix[r * nslab + slab] * elementSize;
+                    }
+                }
+            }
+        }
+        agg->headerSend.clear();
+        int numHeaderRecv = 0;
+        int numBytes      = 0;
+        for (int node = 0; node < numNodes; node++)
+        {
+            headerSendDispl[node] = agg->headerSend.size();
+            byteSendDispl[node]   = numBytes;
+            headerRecvDispl[node] = numHeaderRecv;
+            if (node != agg->node)
+            {
+                for (int r = 0; r < nodeSize; r++)
+                {
+                    for (int slab : agg->nodeSlabs[node])
+                    {
+                        agg->headerSend.push_back(agg->countMatrix[r * nslab + slab]);
+                        numBytes += agg->countMatrix[r * nslab + slab] * elementSize;
+                    }
+                }
+                headerRecvCount[node] = agg->nodeSlabs[node].size() * nodeSize;
+            }
+            headerSendCount[node] = agg->headerSend.size() - headerSendDispl[node];
+            byteSendCount[node]   = numBytes - byteSendDispl[node];
+            numHeaderRecv += headerRecvCount[node];
+        }
+        resizeMpiBuffer(&agg->headerSend, agg->headerSend.size());
+        resizeMpiBuffer(&agg->headerRecv, numHeaderRecv);
+        MPI_Alltoallv(agg->headerSend.data(), headerSendCount.data(), headerSendDispl.data(),
+                      MPI_INT, agg->headerRecv.data(), headerRecvCount.data(),
+                      headerRecvDispl.data(), MPI_INT, agg->leaderComm);
+
+        /* Pack and exchange the data between node leaders, in the order of the counts */
+        resizeMpiBuffer(&agg->nodeSendBuffer, numBytes);
+        char* nodeSendPtr = agg->nodeSendBuffer.data();
+        for (int node = 0; node < numNodes; node++)
+        {
+            if (node != agg->node)
+            {
+                for (int r = 0; r < nodeSize; r++)
+                {
+                    const char* blockPtr =
+                            agg->nodeRecvBuffer.data() + blockStart[r * numNodes + node];
+                    int blockSize = 0;
+                    for (int slab : agg->nodeSlabs[node])
+                    {
+                        blockSize += agg->countMatrix[r * nslab + slab] * elementSize;
+                    }
+                    nodeSendPtr = std::copy(blockPtr, blockPtr + blockSize, nodeSendPtr);
+                }
+            }
+        }
+        /* Position of each received (source slab, destination rank) block */
+        std::vector<int>& recvPos = agg->recvPos;
+        recvPos.resize(numHeaderRecv);
+        numBytes = 0;
+        for (int node = 0; node < numNodes; node++)
+        {
+            byteRecvDispl[node] = numBytes;
+            const int headerEnd = headerRecvDispl[node] + headerRecvCount[node];
+            for (int h = headerRecvDispl[node]; h < headerEnd; h++)
+            {
+                recvPos[h] = numBytes;
+                numBytes += agg->headerRecv[h] * elementSize;
+            }
+            byteRecvCount[node] = numBytes - byteRecvDispl[node];
+        }
+        resizeMpiBuffer(&agg->nodeRecvBuffer, numBytes);
+        MPI_Alltoallv(agg->nodeSendBuffer.data(), byteSendCount.data(), byteSendDispl.data(),
+                      MPI_BYTE, agg->nodeRecvBuffer.data(), byteRecvCount.data(),
+                      byteRecvDispl.data(), MPI_BYTE, agg->leaderComm);
+
+        /* Reorder the received data on destination rank, source node and source slab */
+        scatterCount.resize(nodeSize);
+        scatterDispl.resize(nodeSize);
+        resizeMpiBuffer(&agg->nodeSendBuffer, numBytes);
+        nodeSendPtr = agg->nodeSendBuffer.data();
+        for (int r = 0; r < nodeSize; r++)
+        {
+            scatterDispl[r] = nodeSendPtr - agg->nodeSendBuffer.data();
+            for (int node = 0; node < numNodes; node++)
+            {
+                if (node != agg->node)
+                {
+                    const int numSrc = agg->nodeSlabs[node].size();
+                    for (int src = 0; src < numSrc; src++)
+                    {
+                        const int   h       = headerRecvDispl[node] + src * nodeSize + r;
+                        const char* recvPtr  = agg->nodeRecvBuffer.data() + recvPos[h];
+                        const int   numBytes = agg->headerRecv[h] * elementSize;
+                        nodeSendPtr = std::copy(recvPtr, recvPtr + numBytes, nodeSendPtr);
+                    }
+                }
+            }
+            scatterCount[r] = nodeSendPtr - agg->nodeSendBuffer.data() - scatterDispl[r];
+        }
+    }
+
+    /* Scatter the data over the ranks on our node and unpack */
+    resizeMpiBuffer(&agg->recvBuffer, numBytesRecv);
+    MPI_Scatterv(agg->nodeSendBuffer.data(), scatterCount.data(), scatterDispl.data(), MPI_BYTE,
+                 agg->recvBuffer.data(), numBytesRecv, MPI_BYTE, 0, nodeComm.comm_);
+    const char* recvPtr = agg->recvBuffer.data();
+    for (int node = 0; node < numNodes; node++)
+    {
+        if (node != agg->node)
+        {
+            for (int slab : agg->nodeSlabs[node])
+            {
+                const int numBytes = recvCount[slab] * elementSize;
+                std::copy(recvPtr, recvPtr + numBytes, buf_r + recvDispl[slab] * elementSize);
+                recvPtr += numBytes;
+            }
+        }
+    }
+}
+#endif
+
+std::unique_ptr<PmeNodeAggregation> makePmeNodeAggregation(MPI_Comm gmx_unused comm,
+                                                           int gmx_unused physicalNodeIdHash)
+{
+#if GMX_MPI
+    int numRanks, rank;
+    MPI_Comm_size(comm, &numRanks);
+    MPI_Comm_rank(comm, &rank);
+
+    auto aggregation              = std::make_unique<PmeNodeAggregation>();
+    aggregation->physicalNodeComm =
+            std::make_unique<gmx::PhysicalNodeCommunicator>(comm, physicalNodeIdHash);
+    const gmx::PhysicalNodeCommunicator& nodeComm = *aggregation->physicalNodeComm;
+
+    /* The leader of each node is its rank with the lowest index in comm */
+    int leader = rank;
+    MPI_Bcast(&leader, 1, MPI_INT, 0, nodeComm.comm_);
+    std::vector<int> leaderOfSlab(numRanks, 0);
+    leaderOfSlab[rank] = leader;
+    MPI_Allreduce(MPI_IN_PLACE, leaderOfSlab.data(), numRanks, MPI_INT, MPI_SUM, comm);
+
+    aggregation->nodeOfSlab.resize(numRanks);
+    for (int slab = 0; slab < numRanks; slab++)
+    {
+        if (leaderOfSlab[slab] == slab)
+        {
+            aggregation->nodeSlabs.emplace_back();
+        }
+        const int node = (leaderOfSlab[slab] == slab) ? aggregation->nodeSlabs.size() - 1
+                                                      : aggregation->nodeOfSlab[leaderOfSlab[slab]];
+        aggregation->nodeOfSlab[slab] = node;
+        aggregation->nodeSlabs[node].push_back(slab);
+    }
+
+    const int numNodes = aggregation->nodeSlabs.size();
+    if (debug)
+    {
+        fprintf(debug, "PME atom communication over %d ranks on %d physical nodes\n", numRanks,
+                numNodes);
+    }
+    if (numNodes == 1 || numNodes == numRanks)
+    {
+        return nullptr;
+    }
+    aggregation->node = aggregation->nodeOfSlab[rank];
+
+    MPI_Comm_split(comm, nodeComm.rank_ == 0 ? 0 : MPI_UNDEFINED, rank, &aggregation->leaderComm);
+    if (aggregation->leaderComm != MPI_COMM_NULL)
+    {
+        gmx::MPI_Comm_ptr guard(&aggregation->leaderComm);
+        aggregation->leaderCommGuard.swap(guard);
+    }
+
+    return aggregation;
+#else
+    return nullptr;
+#endif
+}
+
+void pme_dd_sendrecv_shifts(PmeAtomComm*             atc,
+                            gmx_bool                 bBackward,
+                            gmx::ArrayRef<const int> sendCount,
+                            void*                    buf_s,
+                            gmx::ArrayRef<const int> recvCount,
+                            void*                    buf_r,
+                            int                      elementSize)
+{
+    PmeNodeAggregation* agg     = atc->nodeAggregation.get();
+    char*               sendPtr = static_cast<char*>(buf_s);
+    char*               recvPtr = static_cast<char*>(buf_r);
+    for (gmx::index i = 0; i < sendCount.ssize(); i++)
+    {
+        int nbyte_s = sendCount[i] * elementSize;
+        int nbyte_r = recvCount[i] * elementSize;
+        if (agg)
+        {
+            const SlabCommSetup& setup = atc->slabCommSetup[i];
+            if (agg->nodeOfSlab[bBackward ? setup.node_src : setup.node_dest] != agg->node)
+            {
+                nbyte_s = 0;
+            }
+            if (agg->nodeOfSlab[bBackward ? setup.node_dest : setup.node_src] != agg->node)
+            {
+                nbyte_r = 0;
+            }
+        }
+        if (nbyte_s > 0 || nbyte_r > 0)
+        {
+            pme_dd_sendrecv(atc, bBackward, i, sendPtr, nbyte_s, recvPtr, nbyte_r);
+        }
+        sendPtr += sendCount[i] * elementSize;
+        recvPtr += recvCount[i] * elementSize;
+    }
+
+#if GMX_MPI
+    if (agg)
+    {
+        std::vector<int>& sendCountSlab = agg->sendCountSlab;
+        std::vector<int>& sendDisplSlab = agg->sendDisplSlab;
+        std::vector<int>& recvCountSlab = agg->recvCountSlab;
+        std::vector<int>& recvDisplSlab = agg->recvDisplSlab;
+        sendCountSlab.assign(atc->nslab, 0);
+        sendDisplSlab.assign(atc->nslab, 0);
+        recvCountSlab.assign(atc->nslab, 0);
+        recvDisplSlab.assign(atc->nslab, 0);
+        int sendPos = 0;
+        int recvPos = 0;
+        for (gmx::index i = 0; i < sendCount.ssize(); i++)
+        {
+            const SlabCommSetup& setup = atc->slabCommSetup[i];
+            const int            dest  = bBackward ? setup.node_src : setup.node_dest;
+            const int            src   = bBackward ? setup.node_dest : setup.node_src;
+            sendCountSlab[dest]        = sendCount[i];
+            sendDisplSlab[dest]        = sendPos;
+            recvCountSlab[src]         = recvCount[i];
+            recvDisplSlab[src]         = recvPos;
+            sendPos += sendCount[i];
+            recvPos += recvCount[i];
+        }
+        pme_node_aggregated_exchange(agg, atc->nslab, sendCountSlab, sendDisplSlab,
+                                     static_cast<const char*>(buf_s), recvCountSlab, recvDisplSlab,
+                                     static_cast<char*>(buf_r), elementSize);
+    }
+#endif
+}
+
 //! Redistristributes \p data and optionally coordinates between MPI ranks
 static void dd_pmeredist_pos_coeffs(gmx_pme_t*                     pme,
                                     const gmx_bool                 bX,
@@ -285,7 +657,7 @@ static void dd_pmeredist_pos_coeffs(gmx_pme_t*                     pme,
                                     const real*                    data,
                                     PmeAtomComm*                   atc)
 {
-    int nnodes_comm, i, local_pos, buf_pos, node;
+    int nnodes_comm, i, local_pos, node;
 
     nnodes_comm = std::min(2 * atc->maxshift, atc->nslab - 1);
 
@@ -316,19 +688,26 @@ static void dd_pmeredist_pos_coeffs(gmx_pme_t*                     pme,
             srenew(pme->bufr, pme->buf_nalloc);
         }
 
-        int numAtoms = sendCount[atc->nodeid];
+        std::vector<int> scount(nnodes_comm);
+        std::vector<int> rcount(nnodes_comm);
         for (i = 0; i < nnodes_comm; i++)
         {
             const int commnode = atc->slabCommSetup[i].node_dest;
-            int       scount   = sendCount[commnode];
-            /* Communicate the count */
+            scount[i]          = sendCount[commnode];
             if (debug)
             {
                 fprintf(debug, "dimind %d PME rank %d send to rank %d: %d\n", atc->dimind,
-                        atc->nodeid, commnode, scount);
+                        atc->nodeid, commnode, scount[i]);
             }
-            pme_dd_sendrecv(atc, FALSE, i, &scount, sizeof(int), &atc->slabCommSetup[i].rcount,
-                            sizeof(int));
+        }
+        /* Communicate the counts */
+        const std::vector<int> ones(nnodes_comm, 1);
+        pme_dd_sendrecv_shifts(atc, FALSE, ones, scount.data(), ones, rcount.data(), sizeof(int));
+
+        int numAtoms = sendCount[atc->nodeid];
+        for (i = 0; i < nnodes_comm; i++)
+        {
+            atc->slabCommSetup[i].rcount = rcount[i];
             numAtoms += atc->slabCommSetup[i].rcount;
         }
 
@@ -362,26 +741,25 @@ static void dd_pmeredist_pos_coeffs(gmx_pme_t*                     pme,
         }
     }
 
-    buf_pos = 0;
+    std::vector<int> scount(nnodes_comm);
+    std::vector<int> rcount(nnodes_comm);
+    int              numRecv = 0;
     for (i = 0; i < nnodes_comm; i++)
     {
-        const int scount = atc->sendCount()[atc->slabCommSetup[i].node_dest];
-        const int rcount = atc->slabCommSetup[i].rcount;
-        if (scount > 0 || rcount > 0)
-        {
-            if (bX)
-            {
-                /* Communicate the coordinates */
-                pme_dd_sendrecv(atc, FALSE, i, pme->bufv + buf_pos, scount * sizeof(rvec),
-                                atc->xBuffer.data() + local_pos, rcount * sizeof(rvec));
-            }
-            /* Communicate the coefficients */
-            pme_dd_sendrecv(atc, FALSE, i, pme->bufr + buf_pos, scount * sizeof(real),
-                            atc->coefficientBuffer.data() + local_pos, rcount * sizeof(real));
-            buf_pos += scount;
-            local_pos += atc->slabCommSetup[i].rcount;
-        }
+        scount[i] = atc->sendCount()[atc->slabCommSetup[i].node_dest];
+        rcount[i] = atc->slabCommSetup[i].rcount;
+        numRecv += rcount[i];
     }
+    if (bX)
+    {
+        /* Communicate the coordinates */
+        pme_dd_sendrecv_shifts(atc, FALSE, scount, pme->bufv, rcount,
+                               atc->xBuffer.data() + local_pos, sizeof(rvec));
+    }
+    /* Communicate the coefficients */
+    pme_dd_sendrecv_shifts(atc, FALSE, scount, pme->bufr, rcount,
+                           atc->coefficientBuffer.data() + local_pos, sizeof(real));
+    local_pos += numRecv;
     GMX_ASSERT(local_pos == atc->numAtoms(), "After receiving we should have numAtoms coordinates");
 }
 
@@ -391,24 +769,22 @@ void dd_pmeredist_f(struct gmx_pme_t* pme, PmeAtomComm* atc, gmx::ArrayRef<gmx::
 
     nnodes_comm = std::min(2 * atc->maxshift, atc->nslab - 1);
 
-    local_pos = atc->sendCount()[atc->nodeid];
-    buf_pos   = 0;
+    std::vector<int> scount(nnodes_comm);
+    std::vector<int> rcount(nnodes_comm);
+    buf_pos = 0;
     for (i = 0; i < nnodes_comm; i++)
     {
-        const int commnode = atc->slabCommSetup[i].node_dest;
-        const int scount   = atc->slabCommSetup[i].rcount;
-        const int rcount   = atc->sendCount()[commnode];
-        if (scount > 0 || rcount > 0)
-        {
-            /* Communicate the forces */
-            pme_dd_sendrecv(atc, TRUE, i, atc->f.data() + local_pos, scount * sizeof(rvec),
-                            pme->bufv + buf_pos, rcount * sizeof(rvec));
-            local_pos += scount;
-        }
+        const int commnode                     = atc->slabCommSetup[i].node_dest;
+        scount[i]                              = atc->slabCommSetup[i].rcount;
+        rcount[i]                              = atc->sendCount()[commnode];
         atc->slabCommSetup[commnode].buf_index = buf_pos;
-        buf_pos += rcount;
+        buf_pos += rcount[i];
     }
 
+    /* Communicate the forces */
+    pme_dd_sendrecv_shifts(atc, TRUE, scount, atc->f.data() + atc->sendCount()[atc->nodeid],
+                           rcount, pme->bufv, sizeof(rvec));
+
     local_pos = 0;
     if (bAddF)
     {
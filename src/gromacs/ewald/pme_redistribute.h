@@ -46,6 +46,29 @@
 
 #include "pme_internal.h"
 
+/*! \brief Returns the setup for aggregating the atom redistribution over \p comm on physical nodes
+ *
+ * Has to be called on all ranks in \p comm. Ranks with the same
+ * \p physicalNodeIdHash are considered to share a physical node.
+ * Returns nullptr when aggregation can not reduce the number of messages,
+ * i.e. when all ranks share a node or when every node has only one rank.
+ */
+std::unique_ptr<PmeNodeAggregation> makePmeNodeAggregation(MPI_Comm comm, int physicalNodeIdHash);
+
+/*! \brief Communicates buffers with all ranks in the communication range of \p atc
+ *
+ * The send and receive buffers are ordered on shift index and the counts
+ * per shift are in elements of \p elementSize bytes. With node aggregation,
+ * only ranks on the same physical node communicate directly.
+ */
+void pme_dd_sendrecv_shifts(PmeAtomComm*             atc,
+                            gmx_bool                 bBackward,
+                            gmx::ArrayRef<const int> sendCount,
+                            void*                    buf_s,
+                            gmx::ArrayRef<const int> recvCount,
+                            void*                    buf_r,
+                            int                      elementSize);
+
 //! Redistributes forces along the dimension gives by \p atc
 void dd_pmeredist_f(struct gmx_pme_t* pme, PmeAtomComm* atc, gmx::ArrayRef<gmx::RVec> f, gmx_bool bAddF);
 
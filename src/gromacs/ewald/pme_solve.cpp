@@ -40,6 +40,9 @@
 #include "pme_solve.h"
 
 #include <cmath>
+#include <cstdlib>
+
+#include <algorithm>
 
 #include "gromacs/fft/parallel_3dfft.h"
 #include "gromacs/math/units.h"
@@ -75,6 +78,15 @@ struct pme_solve_work_t
     real* eterm;
     real* m2inv;
 
+    /* Cache of the Coulomb influence function for the grid columns of this thread */
+    bool   useEtermCache;    /* whether to use the cache */
+    real*  etermCache;       /* the cached influence function */
+    int    etermCacheNalloc; /* allocation size of etermCache */
+    bool   etermCacheValid;  /* whether the cache matches the keys below */
+    matrix etermCacheRecipbox;
+    real   etermCacheVol;
+    real   etermCacheEwaldcoeff;
+
     real   energy_q;
     matrix vir_q;
     real   energy_lj;
@@ -142,6 +154,11 @@ void pme_init_all_work(struct pme_solve_work_t** work, int nthread, int nkx)
     /* Use fft5d, order after FFT is y major, z, x minor */
 
     snew(*work, nthread);
+    /* The influence function cache costs half a real grid of memory and is
+     * refilled at every change of the box, so with pressure coupling it only
+     * adds work. Therefore it is only used on request.
+     */
+    const bool useEtermCache = (getenv("GMX_PME_SOLVE_CACHE") != nullptr);
     /* Allocate the work arrays thread local to optimize memory access */
 #pragma omp parallel for num_threads(nthread) schedule(static)
     for (int thread = 0; thread < nthread; thread++)
@@ -149,6 +166,7 @@ void pme_init_all_work(struct pme_solve_work_t** work, int nthread, int nkx)
         try
         {
             realloc_work(&((*work)[thread]), nkx);
+            (*work)[thread].useEtermCache = useEtermCache;
         }
         GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
     }
@@ -167,6 +185,7 @@ static void free_work(struct pme_solve_work_t* work)
         sfree_aligned(work->tmp2);
         sfree_aligned(work->eterm);
         sfree(work->m2inv);
+        sfree(work->etermCache);
     }
 }
 
@@ -385,11 +404,64 @@ int solve_pme_yzx(const gmx_pme_t* pme, t_complex* grid, real vol, gmx_bool bEne
     iyz0 = local_ndata[YY] * local_ndata[ZZ] * thread / nthread;
     iyz1 = local_ndata[YY] * local_ndata[ZZ] * (thread + 1) / nthread;
 
+    /* The influence function only depends on the box and the Ewald coefficient,
+     * so with a constant box we can reuse the values of the previous call.
+     */
+    bool etermCacheValid = false;
+    if (work->useEtermCache)
+    {
+        etermCacheValid = (work->etermCacheValid && work->etermCacheVol == vol
+                           && work->etermCacheEwaldcoeff == ewaldcoeff);
+        for (int d = 0; d < DIM; d++)
+        {
+            for (int e = 0; e < DIM; e++)
+            {
+                etermCacheValid = etermCacheValid
+                                  && work->etermCacheRecipbox[d][e] == pme->recipbox[d][e];
+            }
+        }
+        if (!etermCacheValid)
+        {
+            int cacheSize = (iyz1 - iyz0) * local_ndata[XX];
+            if (cacheSize > work->etermCacheNalloc)
+            {
+                work->etermCacheNalloc = cacheSize;
+                srenew(work->etermCache, work->etermCacheNalloc);
+            }
+            copy_mat(pme->recipbox, work->etermCacheRecipbox);
+            work->etermCacheVol        = vol;
+            work->etermCacheEwaldcoeff = ewaldcoeff;
+        }
+    }
+
     for (iyz = iyz0; iyz < iyz1; iyz++)
     {
         iy = iyz / local_ndata[ZZ];
         iz = iyz - iy * local_ndata[ZZ];
 
+        /* The cached influence function of this column, indexed with kx */
+        real* etermColumn = work->useEtermCache ? work->etermCache + (iyz - iyz0) * local_ndata[XX]
+                                                          - local_offset[XX]
+                                                : nullptr;
+
+        if (etermCacheValid && !bEnerVir)
+        {
+            /* We only need to multiply the structure factors with the influence function,
+             * skipping the k-space point (0,0,0), which is not in the cache.
+             */
+            t_complex* p = grid + iy * local_size[ZZ] * local_size[XX] + iz * local_size[XX];
+            int        kxFirst =
+                    (local_offset[XX] > 0 || iy + local_offset[YY] > 0 || iz + local_offset[ZZ] > 0)
+                            ? local_offset[XX]
+                            : local_offset[XX] + 1;
+            for (kx = kxFirst; kx < local_offset[XX] + local_ndata[XX]; kx++)
+            {
+                p[kx - local_offset[XX]].re *= etermColumn[kx];
+                p[kx - local_offset[XX]].im *= etermColumn[kx];
+            }
+            continue;
+        }
+
         ky = iy + local_offset[YY];
 
         if (ky < maxky)
@@ -483,6 +555,11 @@ int solve_pme_yzx(const gmx_pme_t* pme, t_complex* grid, real vol, gmx_bool bEne
                     ArrayRef<PME_T>(tmp1, tmp1 + roundUpToMultipleOfFactor<c_simdWidth>(kxend)),
                     ArrayRef<PME_T>(eterm, eterm + roundUpToMultipleOfFactor<c_simdWidth>(kxend)));
 
+            if (work->useEtermCache && !etermCacheValid)
+            {
+                std::copy(eterm + kxstart, eterm + kxend, etermColumn + kxstart);
+            }
+
             for (kx = kxstart; kx < kxend; kx++, p0++)
             {
                 d1 = p0->re;
@@ -550,6 +627,11 @@ int solve_pme_yzx(const gmx_pme_t* pme, t_complex* grid, real vol, gmx_bool bEne
                     ArrayRef<PME_T>(eterm, eterm + roundUpToMultipleOfFactor<c_simdWidth>(kxend)));
 
 
+            if (work->useEtermCache && !etermCacheValid)
+            {
+                std::copy(eterm + kxstart, eterm + kxend, etermColumn + kxstart);
+            }
+
             for (kx = kxstart; kx < kxend; kx++, p0++)
             {
                 d1 = p0->re;
@@ -580,6 +662,8 @@ int solve_pme_yzx(const gmx_pme_t* pme, t_complex* grid, real vol, gmx_bool bEne
         work->energy_q = 0.5 * energy;
     }
 
+    work->etermCacheValid = work->useEtermCache;
+
     /* Return the loop count */
     return local_ndata[YY] * local_ndata[XX];
 }
@@ -179,6 +179,58 @@ static void calc_interpolation_idx(const gmx_pme_t* pme, PmeAtomComm* atc, int s
     }
 }
 
+/* The size along each dimension of the grid bricks we sort atoms on for spreading */
+static constexpr int c_pmeSpreadBrickSize = 4;
+
+/* Sorts the atom indices of a thread on bricks of its local grid.
+ *
+ * Atoms in the same brick spread to mostly the same grid lines, so processing
+ * them consecutively reduces cache misses for spreading and gathering,
+ * compared to the order of the atoms coming from the PP ranks.
+ * The sort only depends on the grid indices, so it is the same for all
+ * grids with the same thread decomposition, as required when reusing splines.
+ */
+static void sort_thread_local_ind_on_bricks(const PmeAtomComm* atc, const pmegrid_t* grid, splinedata_t* spline)
+{
+    ivec numBricks;
+    for (int d = 0; d < DIM; d++)
+    {
+        numBricks[d] = (grid->n[d] + c_pmeSpreadBrickSize - 1) / c_pmeSpreadBrickSize;
+    }
+
+    auto brickIndex = [&](int atom) {
+        const int* idxptr = atc->idx[atom];
+        const int  bx     = (idxptr[XX] - grid->offset[XX]) / c_pmeSpreadBrickSize;
+        const int  by     = (idxptr[YY] - grid->offset[YY]) / c_pmeSpreadBrickSize;
+        const int  bz     = (idxptr[ZZ] - grid->offset[ZZ]) / c_pmeSpreadBrickSize;
+#ifdef DEBUG
+        range_check(bx, 0, numBricks[XX]);
+        range_check(by, 0, numBricks[YY]);
+        range_check(bz, 0, numBricks[ZZ]);
+#endif
+        return (bx * numBricks[YY] + by) * numBricks[ZZ] + bz;
+    };
+
+    /* Counting sort, stable so the order within a brick is kept */
+    std::vector<int>& brickCount = spline->brickCount;
+    brickCount.assign(numBricks[XX] * numBricks[YY] * numBricks[ZZ] + 1, 0);
+    spline->indBuffer.resize(spline->n);
+    for (int i = 0; i < spline->n; i++)
+    {
+        spline->indBuffer[i] = spline->ind[i];
+        brickCount[brickIndex(spline->ind[i]) + 1]++;
+    }
+    for (size_t b = 1; b < brickCount.size(); b++)
+    {
+        brickCount[b] += brickCount[b - 1];
+    }
+    for (int i = 0; i < spline->n; i++)
+    {
+        const int atom                              = spline->indBuffer[i];
+        spline->ind[brickCount[brickIndex(atom)]++] = atom;
+    }
+}
+
 static void make_thread_local_ind(const PmeAtomComm* atc, int thread, splinedata_t* spline)
 {
     int n, t, i, start, end;
@@ -918,6 +970,12 @@ void spread_on_grid(const gmx_pme_t*  pme,
                 {
                     /* Get the indices our thread should operate on */
                     make_thread_local_ind(atc, thread, spline);
+
+                    if (pme->sortAtomsOnBricks)
+                    {
+                        /* Order them spatially within our part of the grid */
+                        sort_thread_local_ind_on_bricks(atc, &grids->grid_th[thread], spline);
+                    }
                 }
             }
 
@@ -0,0 +1,288 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2020, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ *
+ * \brief This file defines the random-batch Ewald (RBE) method for
+ * the long-ranged part of the electrostatics.
+ *
+ * The method is described in S. Jin, Z. Xu, L. Li and Y. Zhao,
+ * SIAM J. Sci. Comput. 43, B937 (2021).
+ *
+ * \ingroup module_ewald
+ */
+#include "gmxpre.h"
+
+#include "random_batch_ewald.h"
+
+#include <cmath>
+
+#include <algorithm>
+
+#include "gromacs/ewald/ewald_utils.h"
+#include "gromacs/gmxlib/network.h"
+#include "gromacs/math/functions.h"
+#include "gromacs/math/units.h"
+#include "gromacs/math/vec.h"
+#include "gromacs/mdtypes/commrec.h"
+#include "gromacs/mdtypes/inputrec.h"
+#include "gromacs/mdtypes/md_enums.h"
+#include "gromacs/pbcutil/pbc.h"
+#include "gromacs/random/threefry.h"
+#include "gromacs/random/uniformrealdistribution.h"
+#include "gromacs/utility/fatalerror.h"
+#include "gromacs/utility/gmxassert.h"
+
+//! The exponent of the Ewald weight beyond which wave vectors are not sampled, exp(-36) < 1e-15
+static constexpr double c_maxWeightExponent = 36;
+
+RandomBatchEwald::RandomBatchEwald(const t_inputrec& ir, FILE* fplog) :
+    batchSize_(ir.rbe_batch_size),
+    seed_(ir.ld_seed),
+    waveVectors_(ir.rbe_batch_size)
+{
+    GMX_RELEASE_ASSERT(batchSize_ > 0, "The RBE batch size should be positive");
+
+    if (fplog)
+    {
+        fprintf(fplog, "Will do random-batch Ewald with %d wave vectors per step.\n", batchSize_);
+    }
+}
+
+double RandomBatchEwald::setSamplingTables(const rvec boxDiag, const real ewaldcoeff)
+{
+    double sumOfWeights = 1;
+    for (int d = 0; d < DIM; d++)
+    {
+        /* The weight of component m is exp(-(2 pi m/L)^2/(4 beta^2)) */
+        const double scale = M_PI / (boxDiag[d] * ewaldcoeff);
+        const int    mMax  = static_cast<int>(std::ceil(std::sqrt(c_maxWeightExponent) / scale));
+
+        std::vector<double>& cumulativeWeights = cumulativeWeights_[d];
+        cumulativeWeights.resize(2 * mMax + 1);
+        double sum = 0;
+        for (int m = -mMax; m <= mMax; m++)
+        {
+            sum += std::exp(-gmx::square(scale * m));
+            cumulativeWeights[m + mMax] = sum;
+        }
+        sumOfWeights *= sum;
+    }
+
+    /* Exclude k=0, which has weight 1 */
+    return sumOfWeights - 1;
+}
+
+void RandomBatchEwald::sampleWaveVectors(const int64_t step, const rvec boxDiag)
+{
+    /* All ranks use the same stream, so they sample the same wave vectors */
+    gmx::ThreeFry2x64<64>                rng(seed_, gmx::RandomDomain::RandomBatchEwald);
+    gmx::UniformRealDistribution<double> uniformDist;
+
+    rng.restart(step, 0);
+
+    for (gmx::RVec& k : waveVectors_)
+    {
+        ivec m;
+        do
+        {
+            for (int d = 0; d < DIM; d++)
+            {
+                const std::vector<double>& cumulativeWeights = cumulativeWeights_[d];
+                const int                  mMax = (cumulativeWeights.size() - 1) / 2;
+
+                const double u     = uniformDist(rng) * cumulativeWeights.back();
+                const int    index = std::upper_bound(cumulativeWeights.begin(),
+                                                   cumulativeWeights.end(), u)
+                                  - cumulativeWeights.begin();
+                m[d] = std::min(index, 2 * mMax) - mMax;
+            }
+        } while (m[XX] == 0 && m[YY] == 0 && m[ZZ] == 0);
+
+        for (int d = 0; d < DIM; d++)
+        {
+            k[d] = 2 * M_PI * m[d] / boxDiag[d];
+        }
+    }
+}
+
+real RandomBatchEwald::calculate(const t_inputrec& ir,
+                                 const int64_t     step,
+                                 const rvec        x[],
+                                 rvec              f[],
+                                 const real        chargeA[],
+                                 const real        chargeB[],
+                                 const matrix      box,
+                                 const t_commrec*  cr,
+                                 const int         natoms,
+                                 matrix            lrvir,
+                                 const real        ewaldcoeff,
+                                 const real        lambda,
+                                 real*             dvdlambda)
+{
+    if (TRICLINIC(box))
+    {
+        gmx_fatal(FARGS, "Random-batch Ewald is only implemented for rectangular boxes");
+    }
+
+    /* Scale box with Ewald wall factor */
+    matrix          scaledBox;
+    EwaldBoxZScaler boxScaler(ir);
+    boxScaler.scaleBox(box, scaledBox);
+
+    rvec boxDiag;
+    for (int d = 0; d < DIM; d++)
+    {
+        boxDiag[d] = scaledBox[d][d];
+    }
+    const double volume = boxDiag[XX] * boxDiag[YY] * boxDiag[ZZ];
+
+    const double sumOfWeights = setSamplingTables(boxDiag, ewaldcoeff);
+    sampleWaveVectors(step, boxDiag);
+
+    const bool  haveFep   = (ir.efep != efepNO);
+    const int   numStates = (haveFep ? 2 : 1);
+    const real* charges[2] = { chargeA, chargeB };
+
+    /* Compute the cos and sin structure factors of our local atoms */
+    structureFactors_.assign(numStates * 2 * batchSize_, 0.0);
+    for (int n = 0; n < natoms; n++)
+    {
+        for (int b = 0; b < batchSize_; b++)
+        {
+            const real phase = iprod(waveVectors_[b], x[n]);
+            const real c     = std::cos(phase);
+            const real s     = std::sin(phase);
+            for (int state = 0; state < numStates; state++)
+            {
+                const real q = charges[state][n];
+                structureFactors_[(state * batchSize_ + b) * 2] += q * c;
+                structureFactors_[(state * batchSize_ + b) * 2 + 1] += q * s;
+            }
+        }
+    }
+
+    /* This is the only communication required */
+    if (cr != nullptr && PAR(cr))
+    {
+        gmx_sumd(structureFactors_.size(), structureFactors_.data(), cr);
+    }
+
+    /* The Ewald reciprocal sum over all k!=0 is estimated as sumOfWeights
+     * times the average over the batch of the terms divided by their weight.
+     */
+    const double prefactor =
+            2 * M_PI * ONE_4PI_EPS0 / (ir.epsilon_r * volume) * sumOfWeights / batchSize_;
+    const double inverseFourBetaSquared = 1.0 / (4 * ewaldcoeff * ewaldcoeff);
+
+    double energyAB[2] = { 0, 0 };
+    tensor virialSum;
+    clear_mat(virialSum);
+    for (int state = 0; state < numStates; state++)
+    {
+        const real scale = (haveFep ? (state == 0 ? 1 - lambda : lambda) : 1);
+        for (int b = 0; b < batchSize_; b++)
+        {
+            const gmx::RVec& k  = waveVectors_[b];
+            const double     k2 = norm2(k);
+            const double     cs = structureFactors_[(state * batchSize_ + b) * 2];
+            const double     ss = structureFactors_[(state * batchSize_ + b) * 2 + 1];
+
+            const double energyTerm = prefactor * (cs * cs + ss * ss) / k2;
+            energyAB[state] += energyTerm;
+
+            const double virialFactor = scale * energyTerm * 2 * (1 / k2 + inverseFourBetaSquared);
+            for (int d1 = 0; d1 < DIM; d1++)
+            {
+                for (int d2 = 0; d2 < DIM; d2++)
+                {
+                    virialSum[d1][d2] += virialFactor * k[d1] * k[d2];
+                }
+            }
+        }
+    }
+
+    for (int n = 0; n < natoms; n++)
+    {
+        for (int b = 0; b < batchSize_; b++)
+        {
+            const gmx::RVec& k     = waveVectors_[b];
+            const real       phase = iprod(k, x[n]);
+            const real       c     = std::cos(phase);
+            const real       s     = std::sin(phase);
+            real             fscal = 0;
+            for (int state = 0; state < numStates; state++)
+            {
+                const real scale = (haveFep ? (state == 0 ? 1 - lambda : lambda) : 1);
+                const real cs    = structureFactors_[(state * batchSize_ + b) * 2];
+                const real ss    = structureFactors_[(state * batchSize_ + b) * 2 + 1];
+                fscal += scale * charges[state][n] * (cs * s - ss * c);
+            }
+            fscal *= 2 * prefactor / norm2(k);
+            f[n][XX] += fscal * k[XX];
+            f[n][YY] += fscal * k[YY];
+            f[n][ZZ] += fscal * k[ZZ];
+        }
+    }
+
+    /* All ranks have the same estimates of the global energy and virial,
+     * so only the master rank returns them.
+     */
+    clear_mat(lrvir);
+    if (cr != nullptr && !MASTER(cr))
+    {
+        return 0;
+    }
+
+    real energy;
+    if (!haveFep)
+    {
+        energy = energyAB[0];
+    }
+    else
+    {
+        energy = (1.0 - lambda) * energyAB[0] + lambda * energyAB[1];
+        *dvdlambda += energyAB[1] - energyAB[0];
+    }
+
+    for (int d1 = 0; d1 < DIM; d1++)
+    {
+        for (int d2 = 0; d2 < DIM; d2++)
+        {
+            lrvir[d1][d2] = -0.5 * ((d1 == d2 ? energy : 0) - virialSum[d1][d2]);
+        }
+    }
+
+    return energy;
+}
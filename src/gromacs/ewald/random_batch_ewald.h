@@ -0,0 +1,127 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2020, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \libinternal \file
+ *
+ * \brief This file declares the random-batch Ewald (RBE) method for
+ * the long-ranged part of the electrostatics.
+ *
+ * RBE computes an unbiased stochastic estimate of the plain Ewald
+ * reciprocal-space sum by importance sampling a small batch of wave
+ * vectors each step from the Gaussian Ewald weight exp(-k^2/(4 beta^2)).
+ * This avoids the FFTs of PME and, with domain decomposition, only
+ * requires a single global summation of the structure factors of the
+ * batch. The noise in the forces acts as a small random heat source,
+ * so RBE should be used with a thermostat.
+ *
+ * \inlibraryapi
+ * \ingroup module_ewald
+ */
+
+#ifndef GMX_EWALD_RANDOM_BATCH_EWALD_H
+#define GMX_EWALD_RANDOM_BATCH_EWALD_H
+
+#include <cstdint>
+#include <cstdio>
+
+#include <array>
+#include <vector>
+
+#include "gromacs/math/vectypes.h"
+#include "gromacs/utility/real.h"
+
+struct t_commrec;
+struct t_inputrec;
+
+/*! \libinternal
+ * \brief Computes the reciprocal-space part of Ewald electrostatics with random batches of wave vectors
+ */
+class RandomBatchEwald
+{
+public:
+    /*! \brief Constructor
+     *
+     * \param[in] ir     The input record, the batch size and seed are taken from here
+     * \param[in] fplog  File to print setup information to, can be nullptr
+     */
+    RandomBatchEwald(const t_inputrec& ir, FILE* fplog);
+
+    /*! \brief Computes an estimate of the reciprocal-space energy, forces and virial
+     *
+     * All ranks should call this function with the same \p step,
+     * as they all need to sample the same wave vectors. The forces on
+     * the \p natoms local atoms are added to \p f. The energy, virial
+     * and \p dvdlambda are only returned on the master rank, as these
+     * are summed over ranks later.
+     *
+     * \returns the reciprocal-space energy
+     */
+    real calculate(const t_inputrec& ir,
+                   int64_t           step,
+                   const rvec        x[],
+                   rvec              f[],
+                   const real        chargeA[],
+                   const real        chargeB[],
+                   const matrix      box,
+                   const t_commrec*  cr,
+                   int               natoms,
+                   matrix            lrvir,
+                   real              ewaldcoeff,
+                   real              lambda,
+                   real*             dvdlambda);
+
+private:
+    /*! \brief Sets the sampling tables and returns the sum of the Ewald weights over all k != 0
+     *
+     * Since the Ewald weight factorizes over the dimensions for a rectangular
+     * box, each integer wave vector component can be sampled independently.
+     */
+    double setSamplingTables(const rvec boxDiag, real ewaldcoeff);
+
+    //! Samples the batch of wave vectors for \p step
+    void sampleWaveVectors(int64_t step, const rvec boxDiag);
+
+    //! The number of wave vectors sampled per step
+    int batchSize_;
+    //! The random seed
+    int64_t seed_;
+    //! The cumulative Ewald weights of the integer wave vector components, per dimension
+    std::array<std::vector<double>, DIM> cumulativeWeights_;
+    //! The wave vectors of the current batch
+    std::vector<gmx::RVec> waveVectors_;
+    //! The cos and sin structure factors of the batch for the A and B charges
+    std::vector<double> structureFactors_;
+};
+
+#endif
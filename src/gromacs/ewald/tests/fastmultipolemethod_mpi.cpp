@@ -0,0 +1,232 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2020, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests that the fast multipole method with domain decomposition
+ * gives the same result as on a single rank.
+ *
+ * \ingroup module_ewald
+ */
+#include "gmxpre.h"
+
+#include <cmath>
+
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/domdec/atomdistribution.h"
+#include "gromacs/domdec/domdec_struct.h"
+#include "gromacs/domdec/gpuhaloexchange.h"
+#include "gromacs/ewald/fast_multipole_method.h"
+#include "gromacs/math/functions.h"
+#include "gromacs/math/vec.h"
+#include "gromacs/mdtypes/commrec.h"
+#include "gromacs/mdtypes/inputrec.h"
+#include "gromacs/mdtypes/md_enums.h"
+#include "gromacs/pbcutil/pbc.h"
+#include "gromacs/utility/gmxmpi.h"
+
+#include "testutils/mpitest.h"
+#include "testutils/testasserts.h"
+
+#include "randomchargesystem.h"
+
+namespace gmx
+{
+namespace test
+{
+namespace
+{
+
+//! The number of atoms
+constexpr int c_numAtoms = 1200;
+//! The Coulomb cut-off
+constexpr real c_rCoulomb = 0.9;
+
+//! The results of an FMM calculation
+struct FmmResult
+{
+    //! The forces
+    std::vector<RVec> f;
+    //! The energy
+    double energy;
+    //! The virial
+    matrix virial;
+    //! The derivative of the energy with respect to lambda
+    real dvdlambda;
+};
+
+/*! \brief Checks that the FMM on slabs along x on all ranks matches the FMM on a single rank
+ *
+ * The box is elongated along x, so the leaves of a slab only interact
+ * directly with the leaves of part of the other slabs. With \p numSlabs
+ * less than the number of ranks, some ranks have no atoms.
+ */
+void checkDistributedMatchesSingleRank(int ePBC, int numSlabs, bool chargesArePerturbed)
+{
+    int rank, numRanks;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &numRanks);
+
+    t_inputrec ir;
+    ir.coulombtype = eelFMM;
+    ir.ePBC        = ePBC;
+    ir.epsilon_r   = 1;
+    ir.fmm_order   = 8;
+
+    /* All ranks generate the same system, with pbc=xy some atoms are
+     * outside the box along z.
+     */
+    const RandomChargeSystem system(c_numAtoms, { 10.8, 3.0, 3.0 }, 0.1);
+    const matrix&            box     = system.box;
+    const std::vector<RVec>& x       = system.x;
+    const std::vector<real>& chargeA = system.charges;
+    std::vector<real>        chargeB;
+    for (int i = 0; i < c_numAtoms; i++)
+    {
+        chargeB.push_back(i % 4 < 2 ? 0.5 : -0.5);
+    }
+    const real lambda = 0.3;
+
+    auto calculate = [&](const std::vector<int>& atoms, const t_commrec* cr) {
+        std::vector<RVec> xHome;
+        std::vector<real> qA, qB;
+        for (int i : atoms)
+        {
+            xHome.push_back(x[i]);
+            qA.push_back(chargeA[i]);
+            qB.push_back(chargeB[i]);
+        }
+        FastMultipoleMethod fmm(ir, c_numAtoms, c_rCoulomb, 1, nullptr);
+        FmmResult           result;
+        result.f.assign(atoms.size(), { 0, 0, 0 });
+        result.dvdlambda = 0;
+        result.energy    = fmm.calculate(ir, as_rvec_array(xHome.data()),
+                                      as_rvec_array(result.f.data()), qA.data(), qB.data(),
+                                      chargesArePerturbed, box, cr, atoms.size(), result.virial,
+                                      lambda, &result.dvdlambda);
+        return result;
+    };
+
+    std::vector<int> allAtoms, homeAtoms;
+    for (int i = 0; i < c_numAtoms; i++)
+    {
+        allAtoms.push_back(i);
+        const int slab = static_cast<int>(x[i][XX] * numSlabs / box[XX][XX]);
+        if (slab == rank)
+        {
+            homeAtoms.push_back(i);
+        }
+    }
+    const FmmResult reference = calculate(allAtoms, nullptr);
+
+    gmx_domdec_t dd(ir);
+    t_commrec    cr        = {};
+    cr.nnodes              = numRanks;
+    cr.npmenodes           = 0;
+    cr.nodeid              = rank;
+    cr.mpi_comm_mysim      = MPI_COMM_WORLD;
+    cr.mpi_comm_mygroup    = MPI_COMM_WORLD;
+    cr.dd                  = &dd;
+    FmmResult distributed  = calculate(homeAtoms, &cr);
+
+    double sumOfSquaredForces = 0;
+    for (const RVec& f : reference.f)
+    {
+        sumOfSquaredForces += norm2(f);
+    }
+    const double forceTolerance = 1e-5 * std::sqrt(sumOfSquaredForces / c_numAtoms);
+    for (size_t h = 0; h < homeAtoms.size(); h++)
+    {
+        for (int d = 0; d < DIM; d++)
+        {
+            EXPECT_NEAR(distributed.f[h][d], reference.f[homeAtoms[h]][d], forceTolerance)
+                    << "atom " << homeAtoms[h] << " dimension " << d;
+        }
+    }
+
+    /* The energy, virial and dV/dlambda of the home atoms sum up to the totals */
+    std::vector<double> sum = { distributed.energy, distributed.dvdlambda };
+    for (int d1 = 0; d1 < DIM; d1++)
+    {
+        for (int d2 = 0; d2 < DIM; d2++)
+        {
+            sum.push_back(distributed.virial[d1][d2]);
+        }
+    }
+    MPI_Allreduce(MPI_IN_PLACE, sum.data(), sum.size(), MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+    EXPECT_NEAR(sum[0], reference.energy, 1e-5 * std::abs(reference.energy));
+    if (chargesArePerturbed)
+    {
+        EXPECT_NEAR(sum[1], reference.dvdlambda, 1e-5 * std::abs(reference.energy));
+    }
+    for (int d1 = 0; d1 < DIM; d1++)
+    {
+        for (int d2 = 0; d2 < DIM; d2++)
+        {
+            EXPECT_NEAR(sum[2 + d1 * DIM + d2], reference.virial[d1][d2],
+                        1e-5 * std::abs(reference.energy));
+        }
+    }
+}
+
+TEST(FastMultipoleMethodMultiRankTest, MatchesSingleRank)
+{
+    GMX_MPI_TEST(4);
+    checkDistributedMatchesSingleRank(epbcXYZ, 4, false);
+}
+
+TEST(FastMultipoleMethodMultiRankTest, MatchesSingleRankWithEmptyRank)
+{
+    GMX_MPI_TEST(4);
+    checkDistributedMatchesSingleRank(epbcXYZ, 3, false);
+}
+
+TEST(FastMultipoleMethodMultiRankTest, MatchesSingleRankWithPbcXY)
+{
+    GMX_MPI_TEST(4);
+    checkDistributedMatchesSingleRank(epbcXY, 4, false);
+}
+
+TEST(FastMultipoleMethodMultiRankTest, MatchesSingleRankWithPerturbedCharges)
+{
+    GMX_MPI_TEST(4);
+    checkDistributedMatchesSingleRank(epbcXYZ, 4, true);
+}
+
+} // namespace
+} // namespace test
+} // namespace gmx
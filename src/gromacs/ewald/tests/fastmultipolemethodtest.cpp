@@ -0,0 +1,320 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2020, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests for the fast multipole method.
+ *
+ * \ingroup module_ewald
+ */
+
+#include "gmxpre.h"
+
+#include "gromacs/ewald/fast_multipole_method.h"
+
+#include <cmath>
+
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/math/functions.h"
+#include "gromacs/math/units.h"
+#include "gromacs/math/vec.h"
+#include "gromacs/mdtypes/inputrec.h"
+#include "gromacs/mdtypes/md_enums.h"
+#include "gromacs/pbcutil/pbc.h"
+#include "gromacs/utility/stringutil.h"
+
+#include "testutils/testasserts.h"
+
+#include "randomchargesystem.h"
+
+namespace gmx
+{
+namespace test
+{
+namespace
+{
+
+//! Test fixture with a neutral system of random charges
+class FastMultipoleMethodTest : public ::testing::Test
+{
+public:
+    FastMultipoleMethodTest() : system_(c_numAtoms, { 3.0, 3.2, 2.8 })
+    {
+        ir_.coulombtype = eelFMM;
+        ir_.ePBC        = epbcXYZ;
+        ir_.efep        = efepNO;
+        ir_.epsilon_r   = 1;
+        ir_.fmm_order   = 12;
+    }
+
+    /*! \brief Computes the full periodic Coulomb interactions with Ewald summation in double
+     *
+     * With these parameters the sum is converged to double precision,
+     * so the result only has the rounding errors of the coordinates.
+     * Returns the energy, the forces are stored in \p f.
+     */
+    double computeEwald(std::vector<DVec>* f) const
+    {
+        /* With this cut-off only the minimum image contributes to the real space sum */
+        const double ewaldCutoff  = 1.35;
+        const double ewaldCoeff   = 3.5;
+        const int    maxWaveIndex = 16;
+
+        f->assign(c_numAtoms, { 0, 0, 0 });
+        double energy = 0;
+        for (int i = 0; i < c_numAtoms; i++)
+        {
+            energy -= ONE_4PI_EPS0 * ewaldCoeff * M_2_SQRTPI * 0.5 * square(system_.charges[i]);
+            for (int j = i + 1; j < c_numAtoms; j++)
+            {
+                const DVec   dx = minimumImage(i, j);
+                const double r  = std::sqrt(norm2(dx));
+                if (r < ewaldCutoff)
+                {
+                    const double qq = ONE_4PI_EPS0 * system_.charges[i] * system_.charges[j];
+                    energy += qq * std::erfc(ewaldCoeff * r) / r;
+                    const double fscal =
+                            qq
+                            * (std::erfc(ewaldCoeff * r) / r
+                               + ewaldCoeff * M_2_SQRTPI * std::exp(-square(ewaldCoeff * r)))
+                            / square(r);
+                    (*f)[i] += fscal * dx;
+                    (*f)[j] -= fscal * dx;
+                }
+            }
+        }
+
+        /* Sum over half of the wave vectors, each contribution counts twice */
+        const matrix&       box       = system_.box;
+        const double        volume    = box[XX][XX] * box[YY][YY] * box[ZZ][ZZ];
+        const double        prefactor = ONE_4PI_EPS0 / (M_PI * volume);
+        std::vector<double> phase(c_numAtoms);
+        for (int mx = 0; mx <= maxWaveIndex; mx++)
+        {
+            for (int my = (mx == 0 ? 0 : -maxWaveIndex); my <= maxWaveIndex; my++)
+            {
+                for (int mz = (mx == 0 && my == 0 ? 1 : -maxWaveIndex); mz <= maxWaveIndex; mz++)
+                {
+                    const DVec   m  = { mx / box[XX][XX], my / box[YY][YY], mz / box[ZZ][ZZ] };
+                    const double m2 = norm2(m);
+                    const double factor =
+                            prefactor * std::exp(-square(M_PI / ewaldCoeff) * m2) / m2;
+                    double sumCos = 0;
+                    double sumSin = 0;
+                    for (int i = 0; i < c_numAtoms; i++)
+                    {
+                        const RVec& x = system_.x[i];
+                        phase[i]      = 2 * M_PI * dot(m, DVec(x[XX], x[YY], x[ZZ]));
+                        sumCos += system_.charges[i] * std::cos(phase[i]);
+                        sumSin += system_.charges[i] * std::sin(phase[i]);
+                    }
+                    energy += factor * (square(sumCos) + square(sumSin));
+                    for (int i = 0; i < c_numAtoms; i++)
+                    {
+                        const double fscal =
+                                factor * 4 * M_PI * system_.charges[i]
+                                * (std::sin(phase[i]) * sumCos - std::cos(phase[i]) * sumSin);
+                        (*f)[i] += fscal * m;
+                    }
+                }
+            }
+        }
+
+        return energy;
+    }
+
+    /*! \brief Computes the interactions the non-bonded kernels add to the FMM part
+     *
+     * These are q_i q_j (1/r - 1/rc) for pairs within the cut-off
+     * and the self term -q_i^2/(2 rc). Returns the energy of the constant
+     * terms in \p constantEnergy.
+     */
+    double computeShortRange(std::vector<DVec>* f, double* constantEnergy) const
+    {
+        double energy   = 0;
+        *constantEnergy = 0;
+        f->assign(c_numAtoms, { 0, 0, 0 });
+        for (int i = 0; i < c_numAtoms; i++)
+        {
+            *constantEnergy -= ONE_4PI_EPS0 * 0.5 * square(system_.charges[i]) / c_rCoulomb;
+            for (int j = i + 1; j < c_numAtoms; j++)
+            {
+                const DVec   dx = minimumImage(i, j);
+                const double r  = std::sqrt(norm2(dx));
+                if (r < c_rCoulomb)
+                {
+                    const double qq = ONE_4PI_EPS0 * system_.charges[i] * system_.charges[j];
+                    energy += qq / r;
+                    *constantEnergy -= qq / c_rCoulomb;
+                    (*f)[i] += (qq / (r * r * r)) * dx;
+                    (*f)[j] -= (qq / (r * r * r)) * dx;
+                }
+            }
+        }
+
+        return energy + *constantEnergy;
+    }
+
+    //! Computes the FMM forces and returns the energy
+    real computeFastMultipoleMethod(FastMultipoleMethod* fmm, std::vector<RVec>* f, matrix virial)
+    {
+        f->assign(c_numAtoms, { 0, 0, 0 });
+        real dvdlambda = 0;
+
+        return fmm->calculate(ir_, as_rvec_array(system_.x.data()), as_rvec_array(f->data()),
+                              system_.charges.data(), system_.charges.data(), false, system_.box,
+                              nullptr, c_numAtoms, virial, 0, &dvdlambda);
+    }
+
+    /*! \brief Returns the deviations of the FMM plus short-range part from the Ewald sum
+     *
+     * Returns the deviation of the energy relative to the Ewald energy and
+     * sets \p forceDeviation to the relative RMS force deviation.
+     * Checks that the virial trace matches the energy.
+     */
+    double deviationFromEwald(double* forceDeviation)
+    {
+        std::vector<DVec> fEwald;
+        const double      energyEwald = computeEwald(&fEwald);
+
+        std::vector<DVec> fShortRange;
+        double            constantEnergy;
+        const double      energyShortRange = computeShortRange(&fShortRange, &constantEnergy);
+
+        FastMultipoleMethod fmm(ir_, c_numAtoms, c_rCoulomb, 1, nullptr);
+        std::vector<RVec>   f;
+        matrix              virial;
+        const double        energy = computeFastMultipoleMethod(&fmm, &f, virial);
+
+        std::vector<DVec> fTotal(c_numAtoms);
+        for (int i = 0; i < c_numAtoms; i++)
+        {
+            fTotal[i] = DVec(f[i][XX], f[i][YY], f[i][ZZ]) + fShortRange[i];
+        }
+        *forceDeviation = relativeRmsDeviation(fTotal, fEwald);
+
+        // Apart from the constant terms, the energy is homogeneous of degree -1
+        EXPECT_NEAR(trace(virial), -0.5 * (energy + constantEnergy), 1e-5 * std::abs(energy));
+
+        return (energy + energyShortRange - energyEwald) / std::abs(energyEwald);
+    }
+
+    //! Returns the minimum image vector from atom \p j to atom \p i
+    DVec minimumImage(int i, int j) const
+    {
+        DVec dx;
+        for (int d = 0; d < DIM; d++)
+        {
+            dx[d] = system_.x[i][d] - system_.x[j][d];
+            dx[d] -= std::round(dx[d] / system_.box[d][d]) * system_.box[d][d];
+        }
+        return dx;
+    }
+
+    //! The number of atoms
+    static constexpr int c_numAtoms = 300;
+    //! The Coulomb cut-off
+    static constexpr real c_rCoulomb = 0.9;
+    //! The input record
+    t_inputrec ir_;
+    //! The test system
+    RandomChargeSystem system_;
+};
+
+/* The reference is exact, so the deviations are the truncation errors of
+ * the expansions. These depend on how the atoms are distributed over the
+ * cells, so we check several translations. At order 12 the largest
+ * relative deviation we observe is 1.1e-5 for the energy and 1e-5 for
+ * the forces.
+ */
+TEST_F(FastMultipoleMethodTest, AddsUpToEwaldWithShortRangePart)
+{
+    const std::vector<RVec> translations = {
+        { 0, 0, 0 }, { 0.37, -1.21, 0.59 }, RVec(0, 0, 0.5 * system_.box[ZZ][ZZ])
+    };
+    RVec totalTranslation = { 0, 0, 0 };
+    for (const RVec& translation : translations)
+    {
+        SCOPED_TRACE(formatString("Translated over %g %g %g", translation[XX], translation[YY],
+                                  translation[ZZ]));
+        system_.translate(translation - totalTranslation);
+        totalTranslation = translation;
+
+        double       forceDeviation;
+        const double energyDeviation = deviationFromEwald(&forceDeviation);
+        EXPECT_LT(std::abs(energyDeviation), 2e-5);
+        EXPECT_LT(forceDeviation, 2e-5);
+    }
+}
+
+TEST_F(FastMultipoleMethodTest, ConvergesWithOrder)
+{
+    // This is the translation with the largest deviation at order 12
+    system_.translate(RVec(0, 0, 0.5 * system_.box[ZZ][ZZ]));
+
+    double       forceDeviation12;
+    const double energyDeviation12 = deviationFromEwald(&forceDeviation12);
+
+    ir_.fmm_order = 16;
+    double       forceDeviation16;
+    const double energyDeviation16 = deviationFromEwald(&forceDeviation16);
+
+    // The deviations decrease by at least a factor 0.7 per order
+    EXPECT_LT(std::abs(energyDeviation16), 0.25 * std::abs(energyDeviation12));
+    EXPECT_LT(forceDeviation16, 0.25 * forceDeviation12);
+}
+
+TEST_F(FastMultipoleMethodTest, IsInvariantUnderTranslationOverBoxVectors)
+{
+    FastMultipoleMethod fmm(ir_, c_numAtoms, c_rCoulomb, 1, nullptr);
+    std::vector<RVec>   f1, f2;
+    matrix              virial;
+    const real          energy1 = computeFastMultipoleMethod(&fmm, &f1, virial);
+
+    /* The atoms end up at the same place in the tree, so only the effect
+     * of rounding the translated coordinates, about 1e-7 nm, remains.
+     */
+    system_.translate({ system_.box[XX][XX], -2 * system_.box[YY][YY], system_.box[ZZ][ZZ] });
+    const real energy2 = computeFastMultipoleMethod(&fmm, &f2, virial);
+
+    EXPECT_NEAR(energy1, energy2, 5e-6 * std::abs(energy1));
+    EXPECT_LT(relativeRmsDeviation(f2, f1), 5e-6);
+}
+
+} // namespace
+} // namespace test
+} // namespace gmx
@@ -0,0 +1,208 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2020, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests for running LJ-PME on a separate grid.
+ *
+ * \ingroup module_ewald
+ */
+
+#include "gmxpre.h"
+
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/domdec/domdec.h"
+#include "gromacs/ewald/pme.h"
+#include "gromacs/ewald/pme_internal.h"
+#include "gromacs/gmxlib/nrnb.h"
+#include "gromacs/math/vec.h"
+#include "gromacs/mdtypes/commrec.h"
+#include "gromacs/mdtypes/inputrec.h"
+#include "gromacs/mdtypes/md_enums.h"
+#include "gromacs/pbcutil/pbc.h"
+#include "gromacs/utility/logger.h"
+
+#include "testutils/setenv.h"
+#include "testutils/testasserts.h"
+
+namespace gmx
+{
+namespace test
+{
+namespace
+{
+
+//! The LJ mesh results of a PME calculation
+struct LJPmeOutput
+{
+    //! The LJ mesh energy
+    real energy = 0;
+    //! The derivative of the LJ mesh energy with respect to lambda
+    real dvdlambda = 0;
+    //! The forces
+    std::vector<RVec> forces;
+};
+
+//! Test fixture with a few atoms with perturbed LJ-PME parameters
+class PmeSeparateLJGridTest : public ::testing::Test
+{
+public:
+    PmeSeparateLJGridTest()
+    {
+        gmxSetenv("GMX_PME_LJ_GRID_SCALING", "1.5", 1);
+
+        ir_.ePBC                   = epbcXYZ;
+        ir_.coulombtype            = eelPME;
+        ir_.vdwtype                = evdwPME;
+        ir_.efep                   = efepYES;
+        ir_.pme_order              = 4;
+        ir_.epsilon_r              = 1;
+        ir_.ljpme_combination_rule = eljpmeGEOM;
+        ir_.nkx                    = 16;
+        ir_.nky                    = 16;
+        ir_.nkz                    = 16;
+
+        clear_mat(box_);
+        box_[XX][XX] = 2.0;
+        box_[YY][YY] = 2.1;
+        box_[ZZ][ZZ] = 2.2;
+
+        x_      = { { 0.1, 0.2, 0.3 }, { 1.5, 0.4, 0.2 }, { 0.7, 1.8, 1.1 },
+               { 1.2, 1.1, 2.0 }, { 0.3, 1.4, 1.6 }, { 1.9, 2.0, 0.8 } };
+        charge_ = { 0.5, -0.5, 0.3, -0.3, 0.4, -0.4 };
+        c6A_    = { 0.01, 0.02, 0.015, 0.01, 0.03, 0.02 };
+        c6B_    = { 0.02, 0.01, 0.015, 0.005, 0.01, 0.04 };
+        sigma_  = { 0.3, 0.3, 0.3, 0.3, 0.3, 0.3 };
+    }
+
+    ~PmeSeparateLJGridTest() override { gmxUnsetenv("GMX_PME_LJ_GRID_SCALING"); }
+
+    //! Returns a PME setup with \p gridSize along all dimensions
+    gmx_pme_t* initPme(int gridSize)
+    {
+        ir_.nkx                     = gridSize;
+        ir_.nky                     = gridSize;
+        ir_.nkz                     = gridSize;
+        const NumPmeDomains numPmeDomains = { 1, 1 };
+        gmx_pme_t* pme = gmx_pme_init(&cr_, numPmeDomains, &ir_, true, true, false, ewaldCoeffQ_,
+                                      ewaldCoeffLJ_, 1, PmeRunMode::CPU, nullptr, nullptr,
+                                      nullptr, logger_);
+        gmx_pme_reinit_atoms(pme, x_.size(), nullptr);
+        return pme;
+    }
+
+    //! Returns the LJ mesh results for \p pme at \p lambda
+    LJPmeOutput computeLJ(gmx_pme_t* pme, real lambda)
+    {
+        LJPmeOutput output;
+        output.forces.resize(x_.size(), { 0, 0, 0 });
+        matrix virialQ, virialLJ;
+        clear_mat(virialQ);
+        clear_mat(virialLJ);
+        real   energyQ    = 0;
+        real   dvdlambdaQ = 0;
+        t_nrnb nrnb;
+        gmx_pme_do(pme, x_, output.forces, charge_.data(), charge_.data(), c6A_.data(), c6B_.data(),
+                   sigma_.data(), sigma_.data(), box_, &cr_, 0, 0, &nrnb, nullptr, virialQ,
+                   virialLJ, &energyQ, &output.energy, lambda, lambda, &dvdlambdaQ,
+                   &output.dvdlambda, GMX_PME_DO_ALL_F | GMX_PME_CALC_ENER_VIR);
+        return output;
+    }
+
+    //! The input record
+    t_inputrec ir_;
+    //! Dummy communication record for a single rank
+    t_commrec cr_ = { 0 };
+    //! Dummy logger
+    MDLogger logger_;
+    //! The box
+    matrix box_;
+    //! The Coulomb Ewald coefficient
+    real ewaldCoeffQ_ = 3.12;
+    //! The LJ Ewald coefficient
+    real ewaldCoeffLJ_ = 2.5;
+    //! The coordinates
+    std::vector<RVec> x_;
+    //! The charges
+    std::vector<real> charge_;
+    //! The C6 parameters in state A
+    std::vector<real> c6A_;
+    //! The C6 parameters in state B
+    std::vector<real> c6B_;
+    //! The LJ sigma, unused with the geometric combination rule
+    std::vector<real> sigma_;
+};
+
+TEST_F(PmeSeparateLJGridTest, ReinitKeepsPerturbedLJ)
+{
+    gmx_pme_t* pme = initPme(16);
+    ASSERT_NE(pme->pmeLJ, nullptr) << "LJ-PME should use a separate grid";
+    EXPECT_TRUE(pme->pmeLJ->bFEP_lj);
+
+    /* Use a finer grid, so the reinitialized setup does not share grids with pme */
+    const ivec reinitGridSize = { 20, 20, 20 };
+    gmx_pme_t* pmeReinit      = nullptr;
+    gmx_pme_reinit(&pmeReinit, &cr_, pme, &ir_, reinitGridSize, ewaldCoeffQ_, ewaldCoeffLJ_);
+    ASSERT_NE(pmeReinit->pmeLJ, nullptr) << "LJ-PME should still use a separate grid";
+    EXPECT_TRUE(pmeReinit->pmeLJ->bFEP_lj) << "Reinit should keep the LJ perturbation";
+
+    gmx_pme_t* pmeReference = initPme(20);
+
+    const real        lambda    = 0.3;
+    const LJPmeOutput reference = computeLJ(pmeReference, lambda);
+    const LJPmeOutput reinit    = computeLJ(pmeReinit, lambda);
+    EXPECT_NE(reference.dvdlambda, 0);
+
+    const FloatingPointTolerance tolerance = relativeToleranceAsFloatingPoint(1, 1e-5);
+    EXPECT_REAL_EQ_TOL(reference.energy, reinit.energy, tolerance);
+    EXPECT_REAL_EQ_TOL(reference.dvdlambda, reinit.dvdlambda, tolerance);
+    for (size_t i = 0; i < x_.size(); i++)
+    {
+        for (int d = 0; d < DIM; d++)
+        {
+            EXPECT_REAL_EQ_TOL(reference.forces[i][d], reinit.forces[i][d], tolerance);
+        }
+    }
+
+    gmx_pme_destroy(pmeReference);
+    gmx_pme_destroy(pmeReinit);
+    gmx_pme_destroy(pme);
+}
+
+} // namespace
+} // namespace test
+} // namespace gmx
@@ -0,0 +1,166 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2020, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests for the cost model of the PME load balancing.
+ *
+ * \ingroup module_ewald
+ */
+
+#include "gmxpre.h"
+
+#include <cmath>
+
+#include <algorithm>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/ewald/pme_load_balancing_internal.h"
+#include "gromacs/math/functions.h"
+
+#include "testutils/testasserts.h"
+
+namespace gmx
+{
+namespace test
+{
+namespace
+{
+
+//! The relative gain below which the model stops tuning, as in pme_load_balancing.cpp
+const double c_maxFluctuationAccepted = 1.02;
+
+//! Returns setups with increasing cut-off and coarser grids, none timed
+std::vector<PmeLoadBalancingModelSetup> makeSetups(int numSetups)
+{
+    std::vector<PmeLoadBalancingModelSetup> setups(numSetups);
+    for (int i = 0; i < numSetups; i++)
+    {
+        /* As in PME tuning, the grid spacing scales with the cut-off */
+        setups[i].rlistInner = 1.0 + 0.05 * i;
+        for (int d = 0; d < DIM; d++)
+        {
+            setups[i].grid[d] = static_cast<int>(std::round(48 / setups[i].rlistInner));
+        }
+        setups[i].isTimed = false;
+        setups[i].cycles  = 0;
+    }
+    return setups;
+}
+
+//! Returns the time for \p setup when PP and PME run in parallel with cost factors \p a and \p b
+double trueCycles(const PmeLoadBalancingModelSetup& setup, double a, double b)
+{
+    return std::max(a * power3(setup.rlistInner),
+                    b * setup.grid[XX] * setup.grid[YY] * setup.grid[ZZ]);
+}
+
+/*! \brief Runs the tuning loop with the model and checks that it finds the fastest setup
+ *
+ * Timings follow the model exactly, so the model should find the optimum
+ * within the fluctuation margin and time fewer setups than a full scan.
+ */
+void runTuning(double a, double b, int lowerLimit, int roundStart)
+{
+    std::vector<PmeLoadBalancingModelSetup> setups = makeSetups(12);
+
+    int optimum = lowerLimit;
+    for (int i = lowerLimit; i < gmx::ssize(setups); i++)
+    {
+        if (trueCycles(setups[i], a, b) < trueCycles(setups[optimum], a, b))
+        {
+            optimum = i;
+        }
+    }
+
+    int next     = roundStart;
+    int fastest  = -1;
+    int numTimed = 0;
+    while (next >= 0)
+    {
+        ASSERT_GE(next, lowerLimit) << "The model should not select setups below the lower limit";
+        ASSERT_FALSE(setups[next].isTimed) << "The model should not select a timed setup";
+        setups[next].isTimed = true;
+        setups[next].cycles  = trueCycles(setups[next], a, b);
+        numTimed++;
+
+        next = pmeLoadBalancingModelSelect(setups, lowerLimit, &fastest);
+    }
+
+    ASSERT_GE(fastest, lowerLimit);
+    EXPECT_TRUE(setups[fastest].isTimed);
+    EXPECT_LE(setups[fastest].cycles, trueCycles(setups[optimum], a, b) * c_maxFluctuationAccepted);
+    EXPECT_LT(numTimed, gmx::ssize(setups) - lowerLimit);
+}
+
+TEST(PmeLoadBalancingModelTest, FindsOptimumWhenPmeBound)
+{
+    // The PME cost dominates up to a cut-off in the middle of the range
+    runTuning(1.0, 2e-5, 0, 0);
+}
+
+TEST(PmeLoadBalancingModelTest, FindsOptimumWhenPpBound)
+{
+    // The PP cost dominates everywhere, so the shortest cut-off is optimal
+    runTuning(1.0, 1e-6, 0, 0);
+}
+
+TEST(PmeLoadBalancingModelTest, FindsOptimumWhenPmeBoundEverywhere)
+{
+    // The PME cost dominates everywhere, so the longest cut-off is optimal
+    runTuning(1.0, 1e-3, 0, 0);
+}
+
+TEST(PmeLoadBalancingModelTest, FindsOptimumBelowRoundStart)
+{
+    // Start in the middle with a PP bound setup, the optimum has a shorter cut-off
+    runTuning(1.0, 1e-5, 2, 8);
+}
+
+TEST(PmeLoadBalancingModelTest, StopsWithOnlyOneSetup)
+{
+    std::vector<PmeLoadBalancingModelSetup> setups = makeSetups(1);
+    setups[0].isTimed                              = true;
+    setups[0].cycles                               = 1e6;
+
+    int fastest = -1;
+    EXPECT_EQ(pmeLoadBalancingModelSelect(setups, 0, &fastest), -1);
+    EXPECT_EQ(fastest, 0);
+}
+
+} // namespace
+} // namespace test
+} // namespace gmx
@@ -0,0 +1,168 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2020, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests the node aggregated PME atom redistribution against pairwise communication.
+ *
+ * \ingroup module_ewald
+ */
+#include "gmxpre.h"
+
+#include <algorithm>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/ewald/pme_internal.h"
+#include "gromacs/ewald/pme_redistribute.h"
+#include "gromacs/utility/gmxmpi.h"
+
+#include "testutils/mpitest.h"
+#include "testutils/testasserts.h"
+
+namespace gmx
+{
+namespace test
+{
+namespace
+{
+
+//! Returns the number of elements slab \p src sends to slab \p dest
+int numElements(int src, int dest)
+{
+    return 1 + src + 2 * dest;
+}
+
+//! Returns the value of element \p k that slab \p src sends to slab \p dest
+int elementValue(int src, int dest, int k)
+{
+    return (src * 16 + dest) * 256 + k;
+}
+
+/*! \brief Exchanges data with all ranks in the communication range of \p atc
+ *
+ * Returns the received data and sets \p expected to the data we should receive.
+ */
+std::vector<int> exchangeData(PmeAtomComm* atc, bool backward, std::vector<int>* expected)
+{
+    const int numShifts = std::min(2 * atc->maxshift, atc->nslab - 1);
+
+    std::vector<int> sendCount(numShifts);
+    std::vector<int> recvCount(numShifts);
+    std::vector<int> sendBuffer;
+    expected->clear();
+    for (int i = 0; i < numShifts; i++)
+    {
+        const SlabCommSetup& setup = atc->slabCommSetup[i];
+        const int            dest  = backward ? setup.node_src : setup.node_dest;
+        const int            src   = backward ? setup.node_dest : setup.node_src;
+        sendCount[i]               = numElements(atc->nodeid, dest);
+        for (int k = 0; k < sendCount[i]; k++)
+        {
+            sendBuffer.push_back(elementValue(atc->nodeid, dest, k));
+        }
+        recvCount[i] = numElements(src, atc->nodeid);
+        for (int k = 0; k < recvCount[i]; k++)
+        {
+            expected->push_back(elementValue(src, atc->nodeid, k));
+        }
+    }
+
+    std::vector<int> recvBuffer(expected->size(), -1);
+    pme_dd_sendrecv_shifts(atc, backward, sendCount, sendBuffer.data(), recvCount,
+                           recvBuffer.data(), sizeof(int));
+
+    return recvBuffer;
+}
+
+/*! \brief Checks that node aggregation with nodes given by \p fakeNodeIndex gives the same data
+ * as pairwise communication, forward and backward with communication range \p maxShift
+ */
+void checkAggregatedExchange(int fakeNodeIndex, int maxShift)
+{
+    PmeAtomComm atc(MPI_COMM_WORLD, 1, 4, 0, true);
+    atc.maxshift = maxShift;
+
+    for (bool backward : { false, true })
+    {
+        SCOPED_TRACE(backward ? "Backward" : "Forward");
+
+        atc.nodeAggregation.reset();
+        std::vector<int>       expected;
+        const std::vector<int> pairwise = exchangeData(&atc, backward, &expected);
+        EXPECT_EQ(pairwise, expected);
+
+        atc.nodeAggregation = makePmeNodeAggregation(MPI_COMM_WORLD, fakeNodeIndex);
+        ASSERT_NE(atc.nodeAggregation, nullptr) << "The fake nodes should allow aggregation";
+        const std::vector<int> aggregated = exchangeData(&atc, backward, &expected);
+        EXPECT_EQ(aggregated, pairwise);
+    }
+}
+
+//! Returns our rank in MPI_COMM_WORLD
+int worldRank()
+{
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    return rank;
+}
+
+TEST(PmeRedistributeMultiRankTest, NodeAggregationMatchesPairwiseWithConsecutiveNodes)
+{
+    GMX_MPI_TEST(4);
+    checkAggregatedExchange(worldRank() / 2, 2);
+}
+
+TEST(PmeRedistributeMultiRankTest, NodeAggregationMatchesPairwiseWithInterleavedNodes)
+{
+    GMX_MPI_TEST(4);
+    checkAggregatedExchange(worldRank() % 2, 2);
+}
+
+TEST(PmeRedistributeMultiRankTest, NodeAggregationMatchesPairwiseWithUnevenNodes)
+{
+    GMX_MPI_TEST(4);
+    checkAggregatedExchange(worldRank() < 3 ? 0 : 1, 2);
+}
+
+TEST(PmeRedistributeMultiRankTest, NodeAggregationMatchesPairwiseWithLimitedRange)
+{
+    GMX_MPI_TEST(4);
+    checkAggregatedExchange(worldRank() % 2, 1);
+}
+
+} // namespace
+} // namespace test
+} // namespace gmx
@@ -46,10 +46,13 @@
 
 #include <gmock/gmock.h>
 
+#include "gromacs/ewald/pme_internal.h"
+#include "gromacs/math/invertmatrix.h"
 #include "gromacs/mdtypes/inputrec.h"
 #include "gromacs/utility/stringutil.h"
 
 #include "testutils/refdata.h"
+#include "testutils/setenv.h"
 #include "testutils/testasserts.h"
 
 #include "pmetestcommon.h"
@@ -140,12 +143,27 @@ public:
                             gridSize[XX], gridSize[YY], gridSize[ZZ], ewaldCoeff_q, ewaldCoeff_lj));
 
                     /* Running the test */
+                    const bool useSolveCache =
+                            (codePath == CodePath::CPU && method == PmeSolveAlgorithm::Coulomb);
+                    if (useSolveCache)
+                    {
+                        gmxSetenv("GMX_PME_SOLVE_CACHE", "1", 1);
+                    }
                     PmeSafePointer pmeSafe =
                             pmeInitEmpty(&inputRec, codePath, context->getDeviceInfo(),
                                          context->getPmeGpuProgram(), box, ewaldCoeff_q, ewaldCoeff_lj);
+                    gmxUnsetenv("GMX_PME_SOLVE_CACHE");
                     pmeSetComplexGrid(pmeSafe.get(), codePath, gridOrdering.first, nonZeroGridValues);
                     const real cellVolume = box[0] * box[4] * box[8];
                     // FIXME - this is box[XX][XX] * box[YY][YY] * box[ZZ][ZZ], should be stored in the PME structure
+                    if (useSolveCache)
+                    {
+                        // Solve once more beforehand, so the checked solve with the same box
+                        // uses the cached influence function
+                        pmePerformSolve(pmeSafe.get(), codePath, method, cellVolume,
+                                        gridOrdering.first, computeEnergyAndVirial);
+                        pmeSetComplexGrid(pmeSafe.get(), codePath, gridOrdering.first, nonZeroGridValues);
+                    }
                     pmePerformSolve(pmeSafe.get(), codePath, method, cellVolume, gridOrdering.first,
                                     computeEnergyAndVirial);
                     pmeFinalizeTest(pmeSafe.get(), codePath);
@@ -343,6 +361,83 @@ INSTANTIATE_TEST_CASE_P(DifferentEpsilonR,
                                            c_inputEwaldCoeff_lj,
                                            c_inputMethods));
 
+//! Returns the complex grid after a Coulomb solve of \p gridValues with \p pme and \p box
+SparseComplexGridValuesOutput solveCoulomb(gmx_pme_t*                          pme,
+                                           const Matrix3x3&                    box,
+                                           const SparseComplexGridValuesInput& gridValues)
+{
+    matrix boxTemp;
+    for (int i = 0; i < DIM; i++)
+    {
+        for (int j = 0; j < DIM; j++)
+        {
+            boxTemp[i][j] = box[i * DIM + j];
+        }
+    }
+    invertBoxMatrix(boxTemp, pme->recipbox);
+    pmeSetComplexGrid(pme, CodePath::CPU, GridOrdering::YZX, gridValues);
+    const real cellVolume = box[0] * box[4] * box[8];
+    pmePerformSolve(pme, CodePath::CPU, PmeSolveAlgorithm::Coulomb, cellVolume, GridOrdering::YZX, false);
+    pmeFinalizeTest(pme, CodePath::CPU);
+
+    return pmeGetComplexGrid(pme, CodePath::CPU, GridOrdering::YZX);
+}
+
+//! Checks that \p grid matches \p refGrid
+void compareGrids(const SparseComplexGridValuesOutput& refGrid, const SparseComplexGridValuesOutput& grid)
+{
+    ASSERT_EQ(refGrid.size(), grid.size());
+    const FloatingPointTolerance tolerance = defaultRealTolerance();
+    for (const auto& point : refGrid)
+    {
+        const auto it = grid.find(point.first);
+        ASSERT_NE(it, grid.end()) << point.first;
+        EXPECT_REAL_EQ_TOL(point.second.re, it->second.re, tolerance) << point.first;
+        EXPECT_REAL_EQ_TOL(point.second.im, it->second.im, tolerance) << point.first;
+    }
+}
+
+/*! \brief Test that the cached Coulomb influence function is recomputed after a box change
+ *
+ * Solves with the cache enabled for one box, then twice for another box
+ * with the same volume, so only the reciprocal box changes. Both solves
+ * for the second box should match a solve without cache.
+ */
+TEST(PmeSolveCacheTest, IsRecomputedAfterBoxChange)
+{
+    t_inputrec inputRec;
+    inputRec.nkx         = 16;
+    inputRec.nky         = 12;
+    inputRec.nkz         = 28;
+    inputRec.pme_order   = 4;
+    inputRec.coulombtype = eelPME;
+    inputRec.epsilon_r   = 1.2;
+
+    const real      ewaldCoeff_q  = 2.0;
+    const real      ewaldCoeff_lj = 0.7;
+    const Matrix3x3 box1{ { 7.0F, 0.0F, 0.0F, 0.0F, 4.1F, 0.0F, 3.5F, 2.0F, 12.2F } };
+    const Matrix3x3 box2{ { 7.0F, 0.0F, 0.0F, 1.5F, 4.1F, 0.0F, 0.5F, -1.0F, 12.2F } };
+    const SparseComplexGridValuesInput gridValues = c_sampleGrids[0];
+
+    gmxSetenv("GMX_PME_SOLVE_CACHE", "1", 1);
+    PmeSafePointer pmeCached = pmeInitEmpty(&inputRec, CodePath::CPU, nullptr, nullptr, box1,
+                                            ewaldCoeff_q, ewaldCoeff_lj);
+    gmxUnsetenv("GMX_PME_SOLVE_CACHE");
+    PmeSafePointer pmeUncached = pmeInitEmpty(&inputRec, CodePath::CPU, nullptr, nullptr, box2,
+                                              ewaldCoeff_q, ewaldCoeff_lj);
+
+    solveCoulomb(pmeCached.get(), box1, gridValues);
+    const auto refGrid = solveCoulomb(pmeUncached.get(), box2, gridValues);
+    {
+        SCOPED_TRACE("First solve after the box change");
+        compareGrids(refGrid, solveCoulomb(pmeCached.get(), box2, gridValues));
+    }
+    {
+        SCOPED_TRACE("Second solve after the box change");
+        compareGrids(refGrid, solveCoulomb(pmeCached.get(), box2, gridValues));
+    }
+}
+
 } // namespace
 } // namespace test
 } // namespace gmx
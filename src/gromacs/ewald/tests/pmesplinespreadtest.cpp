@@ -42,14 +42,23 @@
 
 #include "gmxpre.h"
 
+#include <cmath>
+
+#include <algorithm>
+#include <array>
 #include <string>
+#include <vector>
 
 #include <gmock/gmock.h>
 
+#include "gromacs/ewald/pme_internal.h"
 #include "gromacs/mdtypes/inputrec.h"
+#include "gromacs/random/threefry.h"
+#include "gromacs/random/uniformrealdistribution.h"
 #include "gromacs/utility/stringutil.h"
 
 #include "testutils/refdata.h"
+#include "testutils/setenv.h"
 #include "testutils/testasserts.h"
 
 #include "pmetestcommon.h"
@@ -266,6 +275,98 @@ TEST_P(PmeSplineAndSpreadTest, ReproducesOutputs)
     EXPECT_NO_THROW(runTest());
 }
 
+/*! \brief With multiple threads, sorting the atoms of each thread on grid bricks
+ * should only change the order of the summation on the grid
+ */
+TEST(PmeSplineAndSpreadThreadsTest, SortingOnBricksGivesSameGridAsUnsorted)
+{
+    t_inputrec inputRec;
+    inputRec.nkx         = 32;
+    inputRec.nky         = 28;
+    inputRec.nkz         = 36;
+    inputRec.pme_order   = 4;
+    inputRec.coulombtype = eelPME;
+    inputRec.epsilon_r   = 1.0;
+
+    const Matrix3x3 box = { { 3.2F, 0.0F, 0.0F, 0.0F, 2.9F, 0.0F, 0.0F, 0.0F, 3.5F } };
+
+    const int numAtoms   = 2000;
+    const int numThreads = 4;
+
+    DefaultRandomEngine           rng(1234);
+    UniformRealDistribution<real> dist;
+    CoordinatesVector             coordinates;
+    std::vector<real>             charges;
+    for (int i = 0; i < numAtoms; i++)
+    {
+        coordinates.emplace_back(dist(rng) * box[XX * DIM + XX], dist(rng) * box[YY * DIM + YY],
+                                 dist(rng) * box[ZZ * DIM + ZZ]);
+        charges.push_back(i % 2 == 0 ? 1 : -1);
+    }
+
+    std::array<SparseRealGridValuesOutput, 2>    grids;
+    std::array<std::vector<std::vector<int>>, 2> threadAtomOrders;
+    for (const bool sortAtomsOnBricks : { false, true })
+    {
+        SCOPED_TRACE(formatString("Spreading with%s sorting", sortAtomsOnBricks ? "" : "out"));
+
+        if (!sortAtomsOnBricks)
+        {
+            gmxSetenv("GMX_PME_NO_SPREAD_SORT", "1", 1);
+        }
+        PmeSafePointer pme = pmeInitWrapper(&inputRec, CodePath::CPU, nullptr, nullptr, box, 1.0F,
+                                            1.0F, numThreads);
+        gmxUnsetenv("GMX_PME_NO_SPREAD_SORT");
+        ASSERT_EQ(pme->sortAtomsOnBricks, sortAtomsOnBricks);
+        ASSERT_TRUE(pme->bUseThreads);
+
+        pmeInitAtoms(pme.get(), nullptr, CodePath::CPU, coordinates, charges);
+        pmePerformSplineAndSpread(pme.get(), CodePath::CPU, true, true);
+        pmeFinalizeTest(pme.get(), CodePath::CPU);
+
+        grids[sortAtomsOnBricks] = pmeGetRealGrid(pme.get(), CodePath::CPU);
+        for (const splinedata_t& spline : pme->atc[0].spline)
+        {
+            threadAtomOrders[sortAtomsOnBricks].emplace_back(spline.ind.begin(),
+                                                             spline.ind.begin() + spline.n);
+        }
+    }
+
+    /* Check that the sort was applied and that the threads got the same atoms */
+    ASSERT_EQ(threadAtomOrders[0].size(), size_t(numThreads));
+    ASSERT_EQ(threadAtomOrders[1].size(), size_t(numThreads));
+    EXPECT_NE(threadAtomOrders[0], threadAtomOrders[1]);
+    for (int thread = 0; thread < numThreads; thread++)
+    {
+        std::vector<int> unsortedAtoms = threadAtomOrders[0][thread];
+        std::vector<int> sortedAtoms   = threadAtomOrders[1][thread];
+        std::sort(unsortedAtoms.begin(), unsortedAtoms.end());
+        std::sort(sortedAtoms.begin(), sortedAtoms.end());
+        EXPECT_EQ(unsortedAtoms, sortedAtoms) << "for thread " << thread;
+    }
+
+    real maxAbsValue = 0;
+    for (const auto& point : grids[0])
+    {
+        maxAbsValue = std::max(maxAbsValue, std::abs(point.second));
+    }
+    const FloatingPointTolerance tolerance = absoluteTolerance(1e-5 * maxAbsValue);
+
+    EXPECT_EQ(grids[0].size(), grids[1].size());
+    for (const auto& point : grids[0])
+    {
+        const auto sortedPoint = grids[1].find(point.first);
+        if (sortedPoint != grids[1].end())
+        {
+            EXPECT_REAL_EQ_TOL(point.second, sortedPoint->second, tolerance) << point.first;
+        }
+        else
+        {
+            ADD_FAILURE() << point.first << " is missing with sorting";
+        }
+    }
+}
+
 /* Valid input instances */
 
 //! A couple of valid inputs for boxes.
@@ -107,7 +107,8 @@ PmeSafePointer pmeInitWrapper(const t_inputrec*        inputRec,
                               PmeGpuProgramHandle      pmeGpuProgram,
                               const Matrix3x3&         box,
                               const real               ewaldCoeff_q,
-                              const real               ewaldCoeff_lj)
+                              const real               ewaldCoeff_lj,
+                              const int                numThreads)
 {
     const MDLogger dummyLogger;
     const auto     runMode       = (mode == CodePath::CPU) ? PmeRunMode::CPU : PmeRunMode::Mixed;
@@ -115,7 +116,8 @@ PmeSafePointer pmeInitWrapper(const t_inputrec*        inputRec,
     NumPmeDomains  numPmeDomains = { 1, 1 };
     gmx_pme_t*     pmeDataRaw =
             gmx_pme_init(&dummyCommrec, numPmeDomains, inputRec, false, false, true, ewaldCoeff_q,
-                         ewaldCoeff_lj, 1, runMode, nullptr, gpuInfo, pmeGpuProgram, dummyLogger);
+                         ewaldCoeff_lj, numThreads, runMode, nullptr, gpuInfo, pmeGpuProgram,
+                         dummyLogger);
     PmeSafePointer pme(pmeDataRaw); // taking ownership
 
     // TODO get rid of this with proper matrix type
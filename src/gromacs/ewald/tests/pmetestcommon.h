@@ -118,14 +118,15 @@ uint64_t getSplineModuliDoublePrecisionUlps(int splineOrder);
 
 // PME stages
 
-//! PME initialization
+//! PME initialization, \p numThreads is the number of OpenMP threads on the CPU
 PmeSafePointer pmeInitWrapper(const t_inputrec*        inputRec,
                               CodePath                 mode,
                               const gmx_device_info_t* gpuInfo,
                               PmeGpuProgramHandle      pmeGpuProgram,
                               const Matrix3x3&         box,
                               real                     ewaldCoeff_q  = 1.0F,
-                              real                     ewaldCoeff_lj = 1.0F);
+                              real                     ewaldCoeff_lj = 1.0F,
+                              int                      numThreads    = 1);
 //! Simple PME initialization (no atom data)
 PmeSafePointer pmeInitEmpty(const t_inputrec*        inputRec,
                             CodePath                 mode          = CodePath::CPU,
@@ -0,0 +1,282 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2020, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests for random-batch Ewald.
+ *
+ * \ingroup module_ewald
+ */
+
+#include "gmxpre.h"
+
+#include "gromacs/ewald/random_batch_ewald.h"
+
+#include <cmath>
+
+#include <functional>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/ewald/ewald.h"
+#include "gromacs/ewald/ewald_utils.h"
+#include "gromacs/ewald/pme.h"
+#include "gromacs/gmxlib/nrnb.h"
+#include "gromacs/math/functions.h"
+#include "gromacs/math/vec.h"
+#include "gromacs/mdtypes/commrec.h"
+#include "gromacs/mdtypes/inputrec.h"
+#include "gromacs/mdtypes/md_enums.h"
+
+#include "testutils/testasserts.h"
+
+#include "pmetestcommon.h"
+#include "randomchargesystem.h"
+
+namespace gmx
+{
+namespace test
+{
+namespace
+{
+
+//! Test fixture with a small neutral system of random charges
+class RandomBatchEwaldTest : public ::testing::Test
+{
+public:
+    RandomBatchEwaldTest() : system_(c_numAtoms, { 2.5, 2.5, 2.5 })
+    {
+        ir_.coulombtype    = eelRBE;
+        ir_.efep           = efepNO;
+        ir_.epsilon_r      = 1;
+        ir_.ewald_geometry = eewg3D;
+        ir_.nkx            = 20;
+        ir_.nky            = 20;
+        ir_.nkz            = 20;
+        ir_.rbe_batch_size = 100;
+        ir_.ld_seed        = 1993;
+        ir_.pme_order      = 4;
+
+        ewaldCoeff_ = calc_ewaldcoeff_q(0.9, 1e-5);
+    }
+
+    //! Computes the plain Ewald reciprocal forces and returns the energy
+    real computeEwald(std::vector<RVec>* f, matrix virial)
+    {
+        gmx_ewald_tab_t* ewaldTable;
+        init_ewald_tab(&ewaldTable, &ir_, nullptr);
+
+        f->assign(c_numAtoms, { 0, 0, 0 });
+        real dvdlambda = 0;
+
+        return do_ewald(&ir_, as_rvec_array(system_.x.data()), as_rvec_array(f->data()),
+                        system_.charges.data(), system_.charges.data(), system_.box, nullptr,
+                        c_numAtoms, virial, ewaldCoeff_, 0, &dvdlambda, ewaldTable);
+    }
+
+    //! Computes the random-batch Ewald forces for \p step and returns the energy
+    real computeRandomBatchEwald(RandomBatchEwald* rbe, int64_t step, std::vector<RVec>* f, matrix virial)
+    {
+        f->assign(c_numAtoms, { 0, 0, 0 });
+        real dvdlambda = 0;
+
+        return rbe->calculate(ir_, step, as_rvec_array(system_.x.data()), as_rvec_array(f->data()),
+                              system_.charges.data(), system_.charges.data(), system_.box, nullptr,
+                              c_numAtoms, virial, ewaldCoeff_, 0, &dvdlambda);
+    }
+
+    /*! \brief Runs NVE dynamics with only the reciprocal-space forces from \p computeForces
+     *
+     * The total energy is measured with the plain Ewald reciprocal energy,
+     * which is the exact potential for these forces. Returns the change in
+     * the total energy after \p numSteps steps, relative to the initial
+     * reciprocal energy.
+     */
+    double runDynamics(const std::function<void(int64_t, std::vector<RVec>*)>& computeForces,
+                       int                                                       numSteps)
+    {
+        const real mass             = 40;
+        const real timeStep         = 0.002;
+        const real halfStepOverMass = 0.5 * timeStep / mass;
+
+        std::vector<RVec> f, fEwald;
+        std::vector<RVec> v(c_numAtoms, { 0, 0, 0 });
+        matrix            virial;
+        const double      initialEnergy = computeEwald(&fEwald, virial);
+
+        computeForces(0, &f);
+        for (int step = 0; step < numSteps; step++)
+        {
+            for (int i = 0; i < c_numAtoms; i++)
+            {
+                v[i] += halfStepOverMass * f[i];
+                system_.x[i] += timeStep * v[i];
+                // Put the atom back in the box, as PME requires
+                for (int d = 0; d < DIM; d++)
+                {
+                    const real boxLength = system_.box[d][d];
+                    system_.x[i][d] -= std::floor(system_.x[i][d] / boxLength) * boxLength;
+                }
+            }
+            computeForces(step + 1, &f);
+            for (int i = 0; i < c_numAtoms; i++)
+            {
+                v[i] += halfStepOverMass * f[i];
+            }
+        }
+
+        double kineticEnergy = 0;
+        for (const RVec& vi : v)
+        {
+            kineticEnergy += 0.5 * mass * norm2(vi);
+        }
+        const double finalEnergy = computeEwald(&fEwald, virial) + kineticEnergy;
+
+        return (finalEnergy - initialEnergy) / std::abs(initialEnergy);
+    }
+
+    //! The number of atoms
+    static constexpr int c_numAtoms = 40;
+    //! The input record
+    t_inputrec ir_;
+    //! The test system
+    RandomChargeSystem system_;
+    //! The Ewald splitting coefficient
+    real ewaldCoeff_;
+};
+
+TEST_F(RandomBatchEwaldTest, IsReproducibleForTheSameStep)
+{
+    RandomBatchEwald rbe(ir_, nullptr);
+
+    std::vector<RVec> f1, f2;
+    matrix            virial;
+    const real        energy1 = computeRandomBatchEwald(&rbe, 12, &f1, virial);
+    const real        energy2 = computeRandomBatchEwald(&rbe, 12, &f2, virial);
+
+    EXPECT_EQ(energy1, energy2);
+    for (int i = 0; i < c_numAtoms; i++)
+    {
+        for (int d = 0; d < DIM; d++)
+        {
+            EXPECT_EQ(f1[i][d], f2[i][d]);
+        }
+    }
+}
+
+TEST_F(RandomBatchEwaldTest, AverageConvergesToEwald)
+{
+    std::vector<RVec> fEwald;
+    matrix            virialEwald;
+    const real        energyEwald = computeEwald(&fEwald, virialEwald);
+
+    RandomBatchEwald rbe(ir_, nullptr);
+
+    const int           numSteps = 2000;
+    double              energyAverage = 0;
+    std::vector<DVec>   fAverage(c_numAtoms, { 0, 0, 0 });
+    double              virialTraceAverage = 0;
+    for (int step = 0; step < numSteps; step++)
+    {
+        std::vector<RVec> f;
+        matrix            virial;
+        energyAverage += computeRandomBatchEwald(&rbe, step, &f, virial) / numSteps;
+        virialTraceAverage += trace(virial) / numSteps;
+        for (int i = 0; i < c_numAtoms; i++)
+        {
+            fAverage[i] += DVec(f[i][XX], f[i][YY], f[i][ZZ]) / numSteps;
+        }
+    }
+
+
+    // The relative statistical error of the averages is around 1% with these settings,
+    // whereas the error of the estimate for a single step is around 100%
+    EXPECT_NEAR(energyAverage, energyEwald, 0.01 * std::abs(energyEwald));
+    EXPECT_NEAR(virialTraceAverage, trace(virialEwald), 0.02 * std::abs(trace(virialEwald)));
+    EXPECT_LT(relativeRmsDeviation(fAverage, fEwald), 0.05);
+}
+
+/* A short NVE run with only the reciprocal-space forces. These are smooth,
+ * so with PME we observe a drift of only 4e-4 relative to the reciprocal
+ * energy. The noise of RBE heats up the system, with this seed and batch
+ * size we observe 0.05, other seeds give between 0.005 and 0.06.
+ */
+TEST_F(RandomBatchEwaldTest, HasLimitedEnergyDriftComparedToPme)
+{
+    ir_.coulombtype     = eelPME;
+    const Matrix3x3 box = { { system_.box[XX][XX], 0, 0, 0, system_.box[YY][YY], 0, 0, 0,
+                              system_.box[ZZ][ZZ] } };
+    PmeSafePointer  pme = pmeInitWrapper(&ir_, CodePath::CPU, nullptr, nullptr, box, ewaldCoeff_);
+    ir_.coulombtype     = eelRBE;
+    gmx_pme_reinit_atoms(pme.get(), c_numAtoms, system_.charges.data());
+
+    t_commrec cr = {};
+    cr.nnodes    = 1;
+    t_nrnb    nrnb;
+
+    const std::vector<RVec> xInitial = system_.x;
+    const int               numSteps = 200;
+
+    const double pmeDrift = runDynamics(
+            [&](int64_t /* step */, std::vector<RVec>* f) {
+                f->assign(c_numAtoms, { 0, 0, 0 });
+                matrix virial;
+                real   energy    = 0;
+                real   dvdlambda = 0;
+                gmx_pme_do(pme.get(), system_.x, *f, system_.charges.data(), system_.charges.data(),
+                           nullptr, nullptr, nullptr, nullptr, system_.box, &cr, 0, 0, &nrnb,
+                           nullptr, virial, nullptr, &energy, nullptr, 0, 0, &dvdlambda, nullptr,
+                           GMX_PME_DO_ALL_F);
+            },
+            numSteps);
+
+    system_.x = xInitial;
+    RandomBatchEwald rbe(ir_, nullptr);
+
+    const double rbeDrift = runDynamics(
+            [&](int64_t step, std::vector<RVec>* f) {
+                matrix virial;
+                computeRandomBatchEwald(&rbe, step, f, virial);
+            },
+            numSteps);
+
+    // PME forces deviate slightly from the exact Ewald forces, so the energy is nearly conserved
+    EXPECT_LT(std::abs(pmeDrift), 1e-3);
+    EXPECT_LT(std::abs(rbeDrift), 0.1);
+}
+
+} // namespace
+} // namespace test
+} // namespace gmx
@@ -0,0 +1,83 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2020, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Implements the random neutral test system shared by the long-range electrostatics tests.
+ *
+ * \ingroup module_ewald
+ */
+#include "gmxpre.h"
+
+#include "randomchargesystem.h"
+
+#include "gromacs/math/vec.h"
+#include "gromacs/random/threefry.h"
+#include "gromacs/random/uniformrealdistribution.h"
+
+namespace gmx
+{
+namespace test
+{
+
+RandomChargeSystem::RandomChargeSystem(int numAtoms, const RVec& boxDiag, real zMargin)
+{
+    clear_mat(box);
+    for (int d = 0; d < DIM; d++)
+    {
+        box[d][d] = boxDiag[d];
+    }
+
+    DefaultRandomEngine           rng(1234);
+    UniformRealDistribution<real> dist;
+    for (int i = 0; i < numAtoms; i++)
+    {
+        const real xx = dist(rng) * box[XX][XX];
+        const real yy = dist(rng) * box[YY][YY];
+        const real zz = ((1 + 2 * zMargin) * dist(rng) - zMargin) * box[ZZ][ZZ];
+        x.emplace_back(xx, yy, zz);
+        charges.push_back(i % 2 == 0 ? 1 : -1);
+    }
+}
+
+void RandomChargeSystem::translate(const RVec& shift)
+{
+    for (RVec& xi : x)
+    {
+        xi += shift;
+    }
+}
+
+} // namespace test
+} // namespace gmx
@@ -0,0 +1,110 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2020, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Declares a random neutral test system shared by the long-range electrostatics tests.
+ *
+ * \ingroup module_ewald
+ */
+#ifndef GMX_EWALD_TESTS_RANDOMCHARGESYSTEM_H
+#define GMX_EWALD_TESTS_RANDOMCHARGESYSTEM_H
+
+#include <cmath>
+
+#include <vector>
+
+#include "gromacs/math/functions.h"
+#include "gromacs/math/vectypes.h"
+#include "gromacs/utility/gmxassert.h"
+#include "gromacs/utility/real.h"
+
+namespace gmx
+{
+namespace test
+{
+
+/*! \internal
+ * \brief A neutral system of unit charges at random positions in a rectangular box
+ */
+struct RandomChargeSystem
+{
+    /*! \brief Puts \p numAtoms atoms at random positions in a box with diagonal \p boxDiag
+     *
+     * The positions are uniformly distributed and the charges alternate
+     * between 1 and -1. Along z the atoms are distributed over the box
+     * height extended by \p zMargin times the height on both sides,
+     * which is useful with pbc=xy.
+     */
+    RandomChargeSystem(int numAtoms, const RVec& boxDiag, real zMargin = 0);
+
+    //! Translates all atoms over \p shift
+    void translate(const RVec& shift);
+
+    //! The box
+    matrix box;
+    //! The coordinates
+    std::vector<RVec> x;
+    //! The charges
+    std::vector<real> charges;
+};
+
+/*! \brief Returns the RMS deviation of \p values from \p reference, relative to their RMS
+ *
+ * Works for any combination of real and double vectors.
+ */
+template<typename ValueType, typename ReferenceValueType>
+double relativeRmsDeviation(const std::vector<BasicVector<ValueType>>&          values,
+                            const std::vector<BasicVector<ReferenceValueType>>& reference)
+{
+    GMX_RELEASE_ASSERT(values.size() == reference.size(), "Need vectors of equal size");
+
+    double sumOfSquaredReference = 0;
+    double sumOfSquaredDeviation = 0;
+    for (size_t i = 0; i < values.size(); i++)
+    {
+        for (int d = 0; d < DIM; d++)
+        {
+            sumOfSquaredReference += square(double(reference[i][d]));
+            sumOfSquaredDeviation += square(double(values[i][d]) - double(reference[i][d]));
+        }
+    }
+
+    return std::sqrt(sumOfSquaredDeviation / sumOfSquaredReference);
+}
+
+} // namespace test
+} // namespace gmx
+
+#endif
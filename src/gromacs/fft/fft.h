@@ -361,4 +361,24 @@ int gmx_fft_transpose_2d(t_complex* in_data, t_complex* out_data, int nx, int ny
  */
 void gmx_fft_cleanup();
 
+/*! \brief Import FFT planning wisdom from file
+ *
+ *  Only FFTW accumulates wisdom; with the other FFT libraries planning is cheap
+ *  and this function does nothing. Plans created after importing wisdom that
+ *  covers their size skip the costly measurements.
+ *
+ *  \param filename  File previously written by gmx_fft_export_wisdom().
+ *  \return true if wisdom was imported, false if not supported or the file
+ *          could not be read.
+ */
+bool gmx_fft_import_wisdom(const char* filename);
+
+/*! \brief Export the FFT planning wisdom accumulated in this process to file
+ *
+ *  \param filename  File to write, an existing file is overwritten.
+ *  \return true if wisdom was written, false if not supported or the file
+ *          could not be written.
+ */
+bool gmx_fft_export_wisdom(const char* filename);
+
 #endif
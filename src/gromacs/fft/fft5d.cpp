@@ -149,6 +149,49 @@ static int vmax(const int* a, int s)
 }
 
 
+/* Maximum number of chunks a pipelined transpose is split in */
+static const int c_numPipelineChunks = 4;
+
+/* Whether lout2 and lout3 need to be separate from lin and lout,
+   which is the case with threads and when overlapping communication with FFTs */
+static bool useSeparateTransposeBuffers(int flags, int nthreads)
+{
+    return nthreads > 1 || (flags & FFT5D_PIPELINE);
+}
+
+/* Number of planes along the major axis (z) in each block sent in transpose s */
+static int transposePlanes(int flags, int s, const int* K, const int* pK)
+{
+    if ((s == 0 && !(flags & FFT5D_ORDER_YZ)) || (s == 1 && (flags & FFT5D_ORDER_YZ)))
+    {
+        return K[s];
+    }
+    else
+    {
+        return pK[s];
+    }
+}
+
+/* Range of local FFT lines [lineStart,lineEnd) of a thread for one chunk of a pipelined transpose.
+   Chunks are made of complete planes along z; planes beyond the local size pK are not computed */
+static void pipelineChunkLines(int  numPlanes,
+                               int  numChunks,
+                               int  chunk,
+                               int  pM,
+                               int  pK,
+                               int  nthreads,
+                               int  thread,
+                               int* lineStart,
+                               int* lineEnd)
+{
+    int chunkStart = std::min(chunk * numPlanes / numChunks, pK) * pM;
+    int chunkEnd   = std::min((chunk + 1) * numPlanes / numChunks, pK) * pM;
+    int numLines   = chunkEnd - chunkStart;
+
+    *lineStart = chunkStart + thread * numLines / nthreads;
+    *lineEnd   = chunkStart + (thread + 1) * numLines / nthreads;
+}
+
 /* NxMxK the size of the data
  * comm communicator to use for fft5d
  * P0 number of processor in 1st axes (can be null for automatic)
@@ -442,7 +485,7 @@ fft5d_plan fft5d_plan_3d(int                NG,
             snew_aligned(lin, lsize, 32);
         }
         snew_aligned(lout, lsize, 32);
-        if (nthreads > 1)
+        if (useSeparateTransposeBuffers(flags, nthreads))
         {
             /* We need extra transpose buffers to avoid OpenMP barriers */
             snew_aligned(lout2, lsize, 32);
@@ -459,7 +502,7 @@ fft5d_plan fft5d_plan_3d(int                NG,
     {
         lin  = *rlin;
         lout = *rlout;
-        if (nthreads > 1)
+        if (useSeparateTransposeBuffers(flags, nthreads))
         {
             lout2 = *rlout2;
             lout3 = *rlout3;
@@ -654,6 +697,53 @@ fft5d_plan fft5d_plan_3d(int                NG,
             }
         }
 
+        /* Plans for the chunks of pipelined transposes, only the parallel dimensions need these */
+        for (s = 0; (flags & FFT5D_PIPELINE) && s < 2; s++)
+        {
+            if (nP[s] <= 1)
+            {
+                continue;
+            }
+            int numPlanes = transposePlanes(flags, s, K, pK);
+            int numChunks = std::max(1, std::min(c_numPipelineChunks, numPlanes));
+
+            plan->numPipelineChunks[s] = numChunks;
+            plan->p1dChunk[s] = static_cast<gmx_fft_t*>(malloc(sizeof(gmx_fft_t) * numChunks * nthreads));
+            plan->pipelineRequests[s] =
+                    static_cast<MPI_Request*>(malloc(sizeof(MPI_Request) * 2 * numChunks * nP[s]));
+            for (int c = 0; c < numChunks; c++)
+            {
+#pragma omp parallel for num_threads(nthreads) schedule(static) ordered
+                for (int t = 0; t < nthreads; t++)
+                {
+#pragma omp ordered
+                    {
+                        try
+                        {
+                            int lineStart, lineEnd;
+                            pipelineChunkLines(numPlanes, numChunks, c, pM[s], pK[s], nthreads, t,
+                                               &lineStart, &lineEnd);
+                            int        tsize = lineEnd - lineStart;
+                            gmx_fft_t* fft   = &plan->p1dChunk[s][c * nthreads + t];
+
+                            if ((flags & FFT5D_REALCOMPLEX) && !(flags & FFT5D_BACKWARD) && s == 0)
+                            {
+                                gmx_fft_init_many_1d_real(
+                                        fft, rC[s], tsize,
+                                        (flags & FFT5D_NOMEASURE) ? GMX_FFT_FLAG_CONSERVATIVE : 0);
+                            }
+                            else
+                            {
+                                gmx_fft_init_many_1d(fft, C[s], tsize,
+                                                     (flags & FFT5D_NOMEASURE) ? GMX_FFT_FLAG_CONSERVATIVE : 0);
+                            }
+                        }
+                        GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
+                    }
+                }
+            }
+        }
+
 #if GMX_FFT_FFTW3
     }
 #endif
@@ -1096,6 +1186,96 @@ static void print_localdata(const t_complex* lin, const char* txt, int s, fft5d_
     }
 }
 
+/* Does the 1D FFTs of step s and the following transpose in chunks of planes along z.
+   As soon as all threads have computed and split a chunk, the master thread posts
+   non-blocking sends and receives for it, so the communication of that chunk overlaps
+   with the FFTs of the next chunk. On return of the master thread, all data has been
+   received in lout3; the barrier following this call makes it visible to all threads. */
+static void fft5d_execute_pipelined(fft5d_plan plan, int s, int thread, fft5d_time times)
+{
+#if GMX_MPI
+    t_complex* lin   = plan->lin;
+    t_complex* lout  = plan->lout;
+    t_complex* lout2 = plan->lout2;
+    t_complex* lout3 = plan->lout3;
+    int *N = plan->N, *M = plan->M, *K = plan->K, *pM = plan->pM, *pK = plan->pK, *C = plan->C,
+        *P = plan->P;
+
+    int          numPlanes = transposePlanes(plan->flags, s, K, pK);
+    int          numChunks = plan->numPipelineChunks[s];
+    MPI_Request* requests  = plan->pipelineRequests[s];
+
+    /* The input lines are written by the join of the previous step, or by the caller,
+       with a division over the threads that differs from the chunks, so we need a barrier */
+#    pragma omp barrier
+
+    for (int c = 0; c < numChunks; c++)
+    {
+        int lineStart, lineEnd;
+        pipelineChunkLines(numPlanes, numChunks, c, pM[s], pK[s], plan->nthreads, thread,
+                           &lineStart, &lineEnd);
+
+        gmx_fft_t fft = plan->p1dChunk[s][c * plan->nthreads + thread];
+        if ((plan->flags & FFT5D_REALCOMPLEX) && !(plan->flags & FFT5D_BACKWARD) && s == 0)
+        {
+            gmx_fft_many_1d_real(fft, GMX_FFT_REAL_TO_COMPLEX, lin + lineStart * C[s],
+                                 lout + lineStart * C[s]);
+        }
+        else
+        {
+            gmx_fft_many_1d(fft, (plan->flags & FFT5D_BACKWARD) ? GMX_FFT_BACKWARD : GMX_FFT_FORWARD,
+                            lin + lineStart * C[s], lout + lineStart * C[s]);
+        }
+        if (pM[s] > 0)
+        {
+            splitaxes(lout2, lout, N[s], M[s], K[s], pM[s], P[s], C[s], plan->iNout[s],
+                      plan->oNout[s], lineStart % pM[s], lineStart / pM[s], lineEnd % pM[s],
+                      lineEnd / pM[s]);
+        }
+#    pragma omp barrier /*all threads have to finish this chunk before it is sent*/
+
+        if (thread == 0)
+        {
+#    ifndef NOGMX
+            wallcycle_start(times, ewcPME_FFTCOMM);
+#    endif
+            /* Each block i (for rank i) has the same layout as for MPI_Alltoall */
+            int planeStart = c * numPlanes / numChunks;
+            int planeEnd   = (c + 1) * numPlanes / numChunks;
+            int count = (planeEnd - planeStart) * N[s] * M[s] * sizeof(t_complex) / sizeof(real);
+            for (int i = 0; i < P[s]; i++)
+            {
+                int offset = i * N[s] * M[s] * K[s] + planeStart * N[s] * M[s];
+                MPI_Irecv(reinterpret_cast<real*>(lout3 + offset), count, GMX_MPI_REAL, i, c,
+                          plan->cart[s], &requests[2 * (c * P[s] + i)]);
+                MPI_Isend(reinterpret_cast<real*>(lout2 + offset), count, GMX_MPI_REAL, i, c,
+                          plan->cart[s], &requests[2 * (c * P[s] + i) + 1]);
+            }
+#    ifndef NOGMX
+            wallcycle_stop(times, ewcPME_FFTCOMM);
+#    endif
+        }
+    }
+
+    if (thread == 0)
+    {
+#    ifndef NOGMX
+        wallcycle_start(times, ewcPME_FFTCOMM);
+#    endif
+        MPI_Waitall(2 * numChunks * P[s], requests, MPI_STATUSES_IGNORE);
+#    ifndef NOGMX
+        wallcycle_stop(times, ewcPME_FFTCOMM);
+#    endif
+    }
+#else
+    GMX_UNUSED_VALUE(plan);
+    GMX_UNUSED_VALUE(s);
+    GMX_UNUSED_VALUE(thread);
+    GMX_UNUSED_VALUE(times);
+    GMX_RELEASE_ASSERT(false, "Invalid call to fft5d_execute_pipelined");
+#endif /*GMX_MPI*/
+}
+
 void fft5d_execute(fft5d_plan plan, int thread, fft5d_time times)
 {
     t_complex* lin   = plan->lin;
@@ -1118,6 +1298,7 @@ void fft5d_execute(fft5d_plan plan, int thread, fft5d_time times)
         *C = plan->C, *P = plan->P, **iNin = plan->iNin, **oNin = plan->oNin, **iNout = plan->iNout,
         **oNout = plan->oNout;
     int s       = 0, tstart, tend, bParallelDim;
+    bool bPipelined;
 
 
 #if GMX_FFT_FFTW3
@@ -1164,6 +1345,7 @@ void fft5d_execute(fft5d_plan plan, int thread, fft5d_time times)
         {
             bParallelDim = 0;
         }
+        bPipelined = bParallelDim && plan->p1dChunk[s] != nullptr;
 
         /* ---------- START FFT ------------ */
 #ifdef NOGMX
@@ -1190,7 +1372,11 @@ void fft5d_execute(fft5d_plan plan, int thread, fft5d_time times)
         }
 
         tstart = (thread * pM[s] * pK[s] / plan->nthreads) * C[s];
-        if ((plan->flags & FFT5D_REALCOMPLEX) && !(plan->flags & FFT5D_BACKWARD) && s == 0)
+        if (bPipelined)
+        {
+            /* The FFTs are done in chunks together with the transpose below */
+        }
+        else if ((plan->flags & FFT5D_REALCOMPLEX) && !(plan->flags & FFT5D_BACKWARD) && s == 0)
         {
             gmx_fft_many_1d_real(p1d[s][thread],
                                  (plan->flags & FFT5D_BACKWARD) ? GMX_FFT_COMPLEX_TO_REAL
@@ -1217,7 +1403,11 @@ void fft5d_execute(fft5d_plan plan, int thread, fft5d_time times)
         /* ---------- END FFT ------------ */
 
         /* ---------- START SPLIT + TRANSPOSE------------ (if parallel in in this dimension)*/
-        if (bParallelDim)
+        if (bPipelined)
+        {
+            fft5d_execute_pipelined(plan, s, thread, times);
+        }
+        else if (bParallelDim)
         {
 #ifdef NOGMX
             if (times != NULL && thread == 0)
@@ -1409,6 +1599,15 @@ void fft5d_destroy(fft5d_plan plan)
             }
             free(plan->p1d[s]);
         }
+        if (s < 2 && plan->p1dChunk[s])
+        {
+            for (t = 0; t < plan->numPipelineChunks[s] * plan->nthreads; t++)
+            {
+                gmx_many_fft_destroy(plan->p1dChunk[s][t]);
+            }
+            free(plan->p1dChunk[s]);
+            free(plan->pipelineRequests[s]);
+        }
         if (plan->iNin[s])
         {
             free(plan->iNin[s]);
@@ -1454,7 +1653,7 @@ void fft5d_destroy(fft5d_plan plan)
         }
         sfree_aligned(plan->lin);
         sfree_aligned(plan->lout);
-        if (plan->nthreads > 1)
+        if (useSeparateTransposeBuffers(plan->flags, plan->nthreads))
         {
             sfree_aligned(plan->lout2);
             sfree_aligned(plan->lout3);
@@ -89,7 +89,8 @@ typedef enum fft5d_flags_t
     FFT5D_DEBUG       = 8,
     FFT5D_NOMEASURE   = 16,
     FFT5D_INPLACE     = 32,
-    FFT5D_NOMALLOC    = 64
+    FFT5D_NOMALLOC    = 64,
+    FFT5D_PIPELINE    = 128 /*overlap transpose communication with FFTs of the next chunk*/
 } fft5d_flags;
 
 struct fft5d_plan_t
@@ -97,6 +98,10 @@ struct fft5d_plan_t
     t_complex* lin;
     t_complex *lout, *lout2, *lout3;
     gmx_fft_t* p1d[3]; /*1D plans*/
+    /*1D plans for the chunks of pipelined transposes (index chunk*nthreads+thread)*/
+    gmx_fft_t*   p1dChunk[2];
+    int          numPipelineChunks[2]; /*number of chunks each transpose is split in*/
+    MPI_Request* pipelineRequests[2];  /*send and receive requests of all chunks*/
 #if GMX_FFT_FFTW3
     FFTW(plan) p2d; /*2D plan: used for 1D decomposition if FFT supports transposed output*/
     FFTW(plan) p3d; /*3D plan: used for 0D decomposition if FFT supports transposed output*/
@@ -463,3 +463,13 @@ void gmx_fft_destroy(gmx_fft_t fft)
 }
 
 void gmx_fft_cleanup() {}
+
+bool gmx_fft_import_wisdom(const char gmx_unused* filename)
+{
+    return false;
+}
+
+bool gmx_fft_export_wisdom(const char gmx_unused* filename)
+{
+    return false;
+}
@@ -43,6 +43,7 @@
 #include <fftw3.h>
 
 #include "gromacs/fft/fft.h"
+#include "gromacs/utility/basedefinitions.h"
 #include "gromacs/utility/exceptions.h"
 #include "gromacs/utility/fatalerror.h"
 #include "gromacs/utility/mutex.h"
@@ -591,3 +592,31 @@ void gmx_fft_cleanup()
 {
     FFTWPREFIX(cleanup)();
 }
+
+bool gmx_fft_import_wisdom(const char* filename)
+{
+#if GMX_FFT_ARMPL_FFTW3
+    GMX_UNUSED_VALUE(filename);
+    return false;
+#else
+    FFTW_LOCK
+    int success = FFTWPREFIX(import_wisdom_from_filename)(filename);
+    FFTW_UNLOCK
+
+    return success != 0;
+#endif
+}
+
+bool gmx_fft_export_wisdom(const char* filename)
+{
+#if GMX_FFT_ARMPL_FFTW3
+    GMX_UNUSED_VALUE(filename);
+    return false;
+#else
+    FFTW_LOCK
+    int success = FFTWPREFIX(export_wisdom_to_filename)(filename);
+    FFTW_UNLOCK
+
+    return success != 0;
+#endif
+}
@@ -71,6 +71,9 @@ typedef struct gmx_parallel_3dfft* gmx_parallel_3dfft_t;
  *  \param nthreads       Run in parallel using n threads
  *  \param realGridAllocation  Whether to make real grid use allocation pinned for GPU transfers.
  *                             Only used in PME mixed CPU+GPU mode.
+ *  \param pipelineTransposes  Split the transposes over parallel dimensions in chunks
+ *                             and overlap the communication of each chunk with the
+ *                             FFTs of the next one.
  *
  *  \return 0 or a standard error code.
  */
@@ -81,7 +84,8 @@ int gmx_parallel_3dfft_init(gmx_parallel_3dfft_t* pfft_setup,
                             MPI_Comm              comm[2],
                             gmx_bool              bReproducible,
                             int                   nthreads,
-                            gmx::PinningPolicy realGridAllocation = gmx::PinningPolicy::CannotBePinned);
+                            gmx::PinningPolicy realGridAllocation = gmx::PinningPolicy::CannotBePinned,
+                            bool               pipelineTransposes = false);
 
 
 /*! \brief Get direct space grid index limits
@@ -0,0 +1,247 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2020, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests the parallel 3D FFT with pipelined transposes against blocking transposes.
+ *
+ * \ingroup module_fft
+ */
+#include "gmxpre.h"
+
+#include <cmath>
+
+#include <array>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/fft/parallel_3dfft.h"
+#include "gromacs/utility/basenetwork.h"
+#include "gromacs/utility/exceptions.h"
+#include "gromacs/utility/gmxomp.h"
+#include "gromacs/utility/gmxmpi.h"
+#include "gromacs/utility/stringutil.h"
+
+#include "testutils/mpitest.h"
+#include "testutils/testasserts.h"
+
+namespace gmx
+{
+namespace test
+{
+namespace
+{
+
+//! The results of a forward and backward FFT on the local part of the grid
+struct FftResults
+{
+    //! The local complex grid after the forward transform, only the used elements
+    std::vector<real> forward;
+    //! The local real grid after the backward transform, only the used elements
+    std::vector<real> backward;
+};
+
+/*! \brief Runs a forward and backward real 3D FFT over \p comm with \p numThreads OpenMP
+ * threads per rank and returns the local results
+ *
+ * The input depends only on the global grid indices, so the results can
+ * be compared between setups with the same decomposition.
+ */
+FftResults runParallelFft(const ivec ndata,
+                          MPI_Comm   comm[2],
+                          const int  numThreads,
+                          const bool pipelineTransposes)
+{
+    gmx_parallel_3dfft_t fft;
+    real*                rdata;
+    t_complex*           cdata;
+    gmx_parallel_3dfft_init(&fft, ndata, &rdata, &cdata, comm, TRUE, numThreads,
+                            gmx::PinningPolicy::CannotBePinned, pipelineTransposes);
+
+    ivec localNData, localOffset, localSize;
+    gmx_parallel_3dfft_real_limits(fft, localNData, localOffset, localSize);
+    for (int x = 0; x < localNData[XX]; x++)
+    {
+        for (int y = 0; y < localNData[YY]; y++)
+        {
+            for (int z = 0; z < localNData[ZZ]; z++)
+            {
+                const int gx = localOffset[XX] + x;
+                const int gy = localOffset[YY] + y;
+                const int gz = localOffset[ZZ] + z;
+
+                rdata[(x * localSize[YY] + y) * localSize[ZZ] + z] =
+                        std::sin(0.7 * gx + 0.3 * gy * gy + 1.1 * gz) + 0.01 * (gx + 2 * gy - gz);
+            }
+        }
+    }
+
+    FftResults results;
+
+    // As in PME, all threads take part in the transform
+#pragma omp parallel num_threads(numThreads)
+    {
+        try
+        {
+            gmx_parallel_3dfft_execute(fft, GMX_FFT_REAL_TO_COMPLEX, gmx_omp_get_thread_num(),
+                                       nullptr);
+        }
+        GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
+    }
+
+    ivec complexOrder, complexNData, complexOffset, complexSize;
+    gmx_parallel_3dfft_complex_limits(fft, complexOrder, complexNData, complexOffset, complexSize);
+    const int d0 = complexOrder[0];
+    const int d1 = complexOrder[1];
+    const int d2 = complexOrder[2];
+    for (int i0 = 0; i0 < complexNData[d0]; i0++)
+    {
+        for (int i1 = 0; i1 < complexNData[d1]; i1++)
+        {
+            for (int i2 = 0; i2 < complexNData[d2]; i2++)
+            {
+                const t_complex& c = cdata[(i0 * complexSize[d1] + i1) * complexSize[d2] + i2];
+                results.forward.push_back(c.re);
+                results.forward.push_back(c.im);
+            }
+        }
+    }
+
+#pragma omp parallel num_threads(numThreads)
+    {
+        try
+        {
+            gmx_parallel_3dfft_execute(fft, GMX_FFT_COMPLEX_TO_REAL, gmx_omp_get_thread_num(),
+                                       nullptr);
+        }
+        GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
+    }
+
+    for (int x = 0; x < localNData[XX]; x++)
+    {
+        for (int y = 0; y < localNData[YY]; y++)
+        {
+            for (int z = 0; z < localNData[ZZ]; z++)
+            {
+                results.backward.push_back(rdata[(x * localSize[YY] + y) * localSize[ZZ] + z]);
+            }
+        }
+    }
+
+    gmx_parallel_3dfft_destroy(fft);
+
+    return results;
+}
+
+/*! \brief Runs the FFT with and without pipelined transposes over \p comm with \p numThreads
+ * OpenMP threads per rank and compares the results
+ */
+void comparePipelinedToBlockingTransposes(MPI_Comm comm[2], const int numThreads)
+{
+    // Sizes that are not multiples of the number of ranks, to get uneven chunks
+    const ivec ndata = { 14, 10, 9 };
+
+    const FftResults blocking  = runParallelFft(ndata, comm, numThreads, false);
+    const FftResults pipelined = runParallelFft(ndata, comm, numThreads, true);
+
+    ASSERT_EQ(blocking.forward.size(), pipelined.forward.size());
+    ASSERT_EQ(blocking.backward.size(), pipelined.backward.size());
+    ASSERT_GT(blocking.forward.size(), 0);
+
+    // The same 1D transforms are computed, only the communication differs
+    const FloatingPointTolerance tolerance = ulpTolerance(4);
+    for (size_t i = 0; i < blocking.forward.size(); i++)
+    {
+        EXPECT_REAL_EQ_TOL(blocking.forward[i], pipelined.forward[i], tolerance)
+                << "rank " << gmx_node_rank() << " complex element " << i / 2;
+    }
+    for (size_t i = 0; i < blocking.backward.size(); i++)
+    {
+        EXPECT_REAL_EQ_TOL(blocking.backward[i], pipelined.backward[i], tolerance)
+                << "rank " << gmx_node_rank() << " real element " << i;
+    }
+}
+
+TEST(ParallelFftMultiRankTest, PipelinedTransposesMatchBlockingWith1DDecomposition)
+{
+    GMX_MPI_TEST(4);
+
+    MPI_Comm comm[] = { MPI_COMM_WORLD, MPI_COMM_NULL };
+    comparePipelinedToBlockingTransposes(comm, 1);
+}
+
+TEST(ParallelFftMultiRankTest, PipelinedTransposesMatchBlockingWith1DDecompositionAndThreads)
+{
+    GMX_MPI_TEST(4);
+
+    // With multiple threads, the chunks are sent after a barrier over the threads
+    MPI_Comm comm[] = { MPI_COMM_WORLD, MPI_COMM_NULL };
+    comparePipelinedToBlockingTransposes(comm, 3);
+}
+
+TEST(ParallelFftMultiRankTest, PipelinedTransposesMatchBlockingWith2DDecomposition)
+{
+    GMX_MPI_TEST(4);
+
+    // Set up a 2x2 rank grid, comm[0] for the major and comm[1] for the minor dimension
+    const int rank = gmx_node_rank();
+    MPI_Comm  comm[2];
+    MPI_Comm_split(MPI_COMM_WORLD, rank % 2, rank, &comm[0]);
+    MPI_Comm_split(MPI_COMM_WORLD, rank / 2, rank, &comm[1]);
+
+    comparePipelinedToBlockingTransposes(comm, 1);
+
+    MPI_Comm_free(&comm[0]);
+    MPI_Comm_free(&comm[1]);
+}
+
+TEST(ParallelFftMultiRankTest, PipelinedTransposesMatchBlockingWith2DDecompositionAndThreads)
+{
+    GMX_MPI_TEST(4);
+
+    const int rank = gmx_node_rank();
+    MPI_Comm  comm[2];
+    MPI_Comm_split(MPI_COMM_WORLD, rank % 2, rank, &comm[0]);
+    MPI_Comm_split(MPI_COMM_WORLD, rank / 2, rank, &comm[1]);
+
+    comparePipelinedToBlockingTransposes(comm, 2);
+
+    MPI_Comm_free(&comm[0]);
+    MPI_Comm_free(&comm[1]);
+}
+
+} // namespace
+} // namespace test
+} // namespace gmx
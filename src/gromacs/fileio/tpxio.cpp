@@ -130,6 +130,8 @@ enum tpxv
     tpxv_GenericInternalParameters, /**< Added internal parameters for mdrun modules*/
     tpxv_VSite2FD,                  /**< Added 2FD type virtual site */
     tpxv_AddSizeField, /**< Added field with information about the size of the serialized tpr file in bytes, excluding the header */
+    tpxv_RandomBatchEwald, /**< Added random-batch Ewald electrostatics */
+    tpxv_FastMultipoleMethod, /**< Added fast multipole method electrostatics */
     tpxv_Count         /**< the total number of tpxv versions */
 };
 
@@ -1251,6 +1253,22 @@ static void do_inputrec(gmx::ISerializer* serializer, t_inputrec* ir, int file_v
     serializer->doInt(&ir->nky);
     serializer->doInt(&ir->nkz);
     serializer->doInt(&ir->pme_order);
+    if (file_version >= tpxv_RandomBatchEwald)
+    {
+        serializer->doInt(&ir->rbe_batch_size);
+    }
+    else
+    {
+        ir->rbe_batch_size = 100;
+    }
+    if (file_version >= tpxv_FastMultipoleMethod)
+    {
+        serializer->doInt(&ir->fmm_order);
+    }
+    else
+    {
+        ir->fmm_order = 8;
+    }
     serializer->doReal(&ir->ewald_rtol);
 
     if (file_version >= 93)
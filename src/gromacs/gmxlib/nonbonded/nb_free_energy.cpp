@@ -39,8 +39,10 @@
 #include "nb_free_energy.h"
 
 #include <cmath>
+#include <cstdint>
 
 #include <algorithm>
+#include <vector>
 
 #include "gromacs/gmxlib/nrnb.h"
 #include "gromacs/gmxlib/nonbonded/nb_kernel.h"
@@ -49,9 +51,89 @@
 #include "gromacs/math/vec.h"
 #include "gromacs/mdtypes/forceoutput.h"
 #include "gromacs/mdtypes/forcerec.h"
+#include "gromacs/mdtypes/group.h"
 #include "gromacs/mdtypes/md_enums.h"
+#include "gromacs/nbnxm/pairlist.h"
+#include "gromacs/simd/simd.h"
+#include "gromacs/simd/simd_math.h"
+#include "gromacs/simd/vector_operations.h"
 #include "gromacs/utility/fatalerror.h"
 
+using namespace gmx; // TODO: Remove when this file is moved into gmx namespace
+
+
+void FepIEntryAtomPairs::unpack(const NbnxnPairlistFep&  nlist,
+                                const nbnxn_fep_ci_t&    ciEntry,
+                                gmx::ArrayRef<const int> atomIndices,
+                                const t_mdatoms&         mdatoms)
+{
+    /* Each list contains at least one pair */
+    const int maxNumLists = ciEntry.numPairs;
+    if (gmx::ssize(jjnr) < maxNumLists)
+    {
+        iinr.resize(maxNumLists);
+        gid.resize(maxNumLists);
+        jindex.resize(maxNumLists + 1);
+        jjnr.resize(maxNumLists);
+        excl_fep.resize(maxNumLists);
+    }
+
+    const int                           ngid      = mdatoms.nenergrp;
+    const unsigned short*               cENER     = mdatoms.cENER;
+    const unsigned int                  jAtomMask = (1U << nlist.na_cj) - 1;
+    gmx::ArrayRef<const nbnxn_fep_cj_t> cjList    = nlist.cj;
+
+    nri       = 0;
+    int nrj   = 0;
+    jindex[0] = 0;
+    for (int i = 0; i < nlist.na_ci; i++)
+    {
+        const int ii = atomIndices[ciEntry.ci * nlist.na_ci + i];
+        if (ii < 0)
+        {
+            continue;
+        }
+
+        for (int cjIndex = ciEntry.cj_ind_start; cjIndex < ciEntry.cj_ind_end; cjIndex++)
+        {
+            const nbnxn_fep_cj_t& cjEntry   = cjList[cjIndex];
+            const unsigned int    pairMaskI = (cjEntry.pairMask >> (i * nlist.na_cj)) & jAtomMask;
+            for (int j = 0; j < nlist.na_cj; j++)
+            {
+                if ((pairMaskI & (1U << j)) == 0)
+                {
+                    continue;
+                }
+
+                const int jnr     = atomIndices[cjEntry.cj * nlist.na_cj + j];
+                const int gidPair = (ngid > 1 ? GID(cENER[ii], cENER[jnr], ngid) : 0);
+
+                if (nrj > jindex[nri] && gid[nri] != gidPair)
+                {
+                    /* Energy group pair changed: new list */
+                    nri++;
+                    jindex[nri] = nrj;
+                }
+                if (nrj == jindex[nri])
+                {
+                    iinr[nri] = ii;
+                    gid[nri]  = gidPair;
+                }
+
+                jjnr[nrj]     = jnr;
+                excl_fep[nrj] = (cjEntry.excl >> (i * nlist.na_cj + j)) & 1;
+                nrj++;
+            }
+        }
+
+        if (nrj > jindex[nri])
+        {
+            /* Close the list of this i-atom */
+            nri++;
+            jindex[nri] = nrj;
+        }
+    }
+}
 
 //! Enum for templating the soft-core treatment in the kernel
 enum class SoftCoreTreatment
@@ -223,7 +305,8 @@ potSwitchPotentialMod(const real potentialInp, const real sw, const SCReal r, co
 
 //! Templated free-energy non-bonded kernel
 template<SoftCoreTreatment softCoreTreatment, bool scLambdasOrAlphasDiffer, bool vdwInteractionTypeIsEwald, bool elecInteractionTypeIsEwald, bool vdwModifierIsPotSwitch>
-static void nb_free_energy_kernel(const t_nblist* gmx_restrict nlist,
+static void nb_free_energy_kernel(const NbnxnPairlistFep&    nlist,
+                                  gmx::ArrayRef<const int>   atomIndices,
                                   rvec* gmx_restrict         xx,
                                   gmx::ForceWithShiftForces* forceWithShiftForces,
                                   const t_forcerec* gmx_restrict fr,
@@ -250,14 +333,6 @@ static void nb_free_energy_kernel(const t_nblist* gmx_restrict nlist,
     /* Extract pointer to non-bonded interaction constants */
     const interaction_const_t* ic = fr->ic;
 
-    // Extract pair list data
-    const int  nri    = nlist->nri;
-    const int* iinr   = nlist->iinr;
-    const int* jindex = nlist->jindex;
-    const int* jjnr   = nlist->jjnr;
-    const int* shift  = nlist->shift;
-    const int* gid    = nlist->gid;
-
     const real* shiftvec      = fr->shift_vec[0];
     const real* chargeA       = mdatoms->chargeA;
     const real* chargeB       = mdatoms->chargeB;
@@ -312,7 +387,7 @@ static void nb_free_energy_kernel(const t_nblist* gmx_restrict nlist,
     }
 
     int icoul;
-    if (ic->eeltype == eelCUT || EEL_RF(ic->eeltype))
+    if (ic->eeltype == eelCUT || EEL_RF(ic->eeltype) || ic->eeltype == eelFMM)
     {
         icoul = GMX_NBKERNEL_ELEC_REACTIONFIELD;
     }
@@ -399,477 +474,1232 @@ static void nb_free_energy_kernel(const t_nblist* gmx_restrict nlist,
     real* gmx_restrict f      = &(forceWithShiftForces->force()[0][0]);
     real* gmx_restrict fshift = &(forceWithShiftForces->shiftForces()[0][0]);
 
-    for (int n = 0; n < nri; n++)
-    {
-        int npair_within_cutoff = 0;
-
-        const int  is3   = 3 * shift[n];
-        const real shX   = shiftvec[is3];
-        const real shY   = shiftvec[is3 + 1];
-        const real shZ   = shiftvec[is3 + 2];
-        const int  nj0   = jindex[n];
-        const int  nj1   = jindex[n + 1];
-        const int  ii    = iinr[n];
-        const int  ii3   = 3 * ii;
-        const real ix    = shX + x[ii3 + 0];
-        const real iy    = shY + x[ii3 + 1];
-        const real iz    = shZ + x[ii3 + 2];
-        const real iqA   = facel * chargeA[ii];
-        const real iqB   = facel * chargeB[ii];
-        const int  ntiA  = 2 * ntype * typeA[ii];
-        const int  ntiB  = 2 * ntype * typeB[ii];
-        real       vctot = 0;
-        real       vvtot = 0;
-        real       fix   = 0;
-        real       fiy   = 0;
-        real       fiz   = 0;
-
-        for (int k = nj0; k < nj1; k++)
-        {
-            int        tj[NSTATES];
-            const int  jnr = jjnr[k];
-            const int  j3  = 3 * jnr;
-            real       c6[NSTATES], c12[NSTATES], qq[NSTATES], Vcoul[NSTATES], Vvdw[NSTATES];
-            real       r, rinv, rp, rpm2;
-            real       alpha_vdw_eff, alpha_coul_eff, sigma_pow[NSTATES];
-            const real dx  = ix - x[j3];
-            const real dy  = iy - x[j3 + 1];
-            const real dz  = iz - x[j3 + 2];
-            const real rsq = dx * dx + dy * dy + dz * dz;
-            SCReal     FscalC[NSTATES], FscalV[NSTATES]; /* Needs double for sc_power==48 */
-
-            if (rsq >= rcutoff_max2)
-            {
-                /* We save significant time by skipping all code below.
-                 * Note that with soft-core interactions, the actual cut-off
-                 * check might be different. But since the soft-core distance
-                 * is always larger than r, checking on r here is safe.
-                 */
-                continue;
-            }
-            npair_within_cutoff++;
+    GMX_ASSERT(kernel_data->atomPairs, "Need a buffer for the atom-pair lists");
+    FepIEntryAtomPairs& atomPairs = *kernel_data->atomPairs;
+    int                numIAtomLists = 0;
 
-            if (rsq > 0)
-            {
-                /* Note that unlike in the nbnxn kernels, we do not need
-                 * to clamp the value of rsq before taking the invsqrt
-                 * to avoid NaN in the LJ calculation, since here we do
-                 * not calculate LJ interactions when C6 and C12 are zero.
-                 */
-
-                rinv = gmx::invsqrt(rsq);
-                r    = rsq * rinv;
-            }
-            else
-            {
-                /* The force at r=0 is zero, because of symmetry.
-                 * But note that the potential is in general non-zero,
-                 * since the soft-cored r will be non-zero.
-                 */
-                rinv = 0;
-                r    = 0;
-            }
-
-            if (softCoreTreatment == SoftCoreTreatment::None)
-            {
-                /* The soft-core power p will not affect the results
-                 * with not using soft-core, so we use power of 0 which gives
-                 * the simplest math and cheapest code.
-                 */
-                rpm2 = rinv * rinv;
-                rp   = 1;
-            }
-            if (softCoreTreatment == SoftCoreTreatment::RPower6)
-            {
-                rpm2 = rsq * rsq;  /* r4 */
-                rp   = rpm2 * rsq; /* r6 */
-            }
-            if (softCoreTreatment == SoftCoreTreatment::RPower48)
-            {
-                rp   = rsq * rsq * rsq; /* r6 */
-                rp   = rp * rp;         /* r12 */
-                rp   = rp * rp;         /* r24 */
-                rp   = rp * rp;         /* r48 */
-                rpm2 = rp / rsq;        /* r46 */
-            }
-
-            real Fscal = 0;
+    for (const nbnxn_fep_ci_t& ciEntry : nlist.ci)
+    {
+        // Unpack the pairs of this i-entry into atom-pair lists
+        atomPairs.unpack(nlist, ciEntry, atomIndices, *mdatoms);
 
-            qq[STATE_A] = iqA * chargeA[jnr];
-            qq[STATE_B] = iqB * chargeB[jnr];
+        const int   nri      = atomPairs.nri;
+        const int*  iinr     = atomPairs.iinr.data();
+        const int*  jindex   = atomPairs.jindex.data();
+        const int*  jjnr     = atomPairs.jjnr.data();
+        const int*  gid      = atomPairs.gid.data();
+        const char* excl_fep = atomPairs.excl_fep.data();
 
-            tj[STATE_A] = ntiA + 2 * typeA[jnr];
-            tj[STATE_B] = ntiB + 2 * typeB[jnr];
+        numIAtomLists += nri;
 
-            if (nlist->excl_fep == nullptr || nlist->excl_fep[k])
+        for (int n = 0; n < nri; n++)
+        {
+            int npair_within_cutoff = 0;
+
+            const int  is3   = 3 * ciEntry.shift;
+            const real shX   = shiftvec[is3];
+            const real shY   = shiftvec[is3 + 1];
+            const real shZ   = shiftvec[is3 + 2];
+            const int  nj0   = jindex[n];
+            const int  nj1   = jindex[n + 1];
+            const int  ii    = iinr[n];
+            const int  ii3   = 3 * ii;
+            const real ix    = shX + x[ii3 + 0];
+            const real iy    = shY + x[ii3 + 1];
+            const real iz    = shZ + x[ii3 + 2];
+            const real iqA   = facel * chargeA[ii];
+            const real iqB   = facel * chargeB[ii];
+            const int  ntiA  = 2 * ntype * typeA[ii];
+            const int  ntiB  = 2 * ntype * typeB[ii];
+            real       vctot = 0;
+            real       vvtot = 0;
+            real       fix   = 0;
+            real       fiy   = 0;
+            real       fiz   = 0;
+
+            for (int k = nj0; k < nj1; k++)
             {
-                c6[STATE_A] = nbfp[tj[STATE_A]];
-                c6[STATE_B] = nbfp[tj[STATE_B]];
-
-                for (int i = 0; i < NSTATES; i++)
+                int        tj[NSTATES];
+                const int  jnr = jjnr[k];
+                const int  j3  = 3 * jnr;
+                real       c6[NSTATES], c12[NSTATES], qq[NSTATES], Vcoul[NSTATES], Vvdw[NSTATES];
+                real       r, rinv, rp, rpm2;
+                real       alpha_vdw_eff, alpha_coul_eff, sigma_pow[NSTATES];
+                const real dx  = ix - x[j3];
+                const real dy  = iy - x[j3 + 1];
+                const real dz  = iz - x[j3 + 2];
+                const real rsq = dx * dx + dy * dy + dz * dz;
+                SCReal     FscalC[NSTATES], FscalV[NSTATES]; /* Needs double for sc_power==48 */
+
+                if (rsq >= rcutoff_max2)
                 {
-                    c12[i] = nbfp[tj[i] + 1];
-                    if (useSoftCore)
-                    {
-                        real sigma6[NSTATES];
-                        if ((c6[i] > 0) && (c12[i] > 0))
-                        {
-                            /* c12 is stored scaled with 12.0 and c6 is scaled with 6.0 - correct for this */
-                            sigma6[i] = half * c12[i] / c6[i];
-                            if (sigma6[i] < sigma6_min) /* for disappearing coul and vdw with soft core at the same time */
-                            {
-                                sigma6[i] = sigma6_min;
-                            }
-                        }
-                        else
-                        {
-                            sigma6[i] = sigma6_def;
-                        }
-                        sigma_pow[i] = calculateSigmaPow<softCoreTreatment>(sigma6[i]);
-                    }
+                    /* We save significant time by skipping all code below.
+                     * Note that with soft-core interactions, the actual cut-off
+                     * check might be different. But since the soft-core distance
+                     * is always larger than r, checking on r here is safe.
+                     */
+                    continue;
                 }
+                npair_within_cutoff++;
 
-                if (useSoftCore)
+                if (rsq > 0)
                 {
-                    /* only use softcore if one of the states has a zero endstate - softcore is for avoiding infinities!*/
-                    if ((c12[STATE_A] > 0) && (c12[STATE_B] > 0))
-                    {
-                        alpha_vdw_eff  = 0;
-                        alpha_coul_eff = 0;
-                    }
-                    else
-                    {
-                        alpha_vdw_eff  = alpha_vdw;
-                        alpha_coul_eff = alpha_coul;
-                    }
+                    /* Note that unlike in the nbnxn kernels, we do not need
+                     * to clamp the value of rsq before taking the invsqrt
+                     * to avoid NaN in the LJ calculation, since here we do
+                     * not calculate LJ interactions when C6 and C12 are zero.
+                     */
+
+                    rinv = gmx::invsqrt(rsq);
+                    r    = rsq * rinv;
+                }
+                else
+                {
+                    /* The force at r=0 is zero, because of symmetry.
+                     * But note that the potential is in general non-zero,
+                     * since the soft-cored r will be non-zero.
+                     */
+                    rinv = 0;
+                    r    = 0;
                 }
 
-                for (int i = 0; i < NSTATES; i++)
+                if (softCoreTreatment == SoftCoreTreatment::None)
                 {
-                    FscalC[i] = 0;
-                    FscalV[i] = 0;
-                    Vcoul[i]  = 0;
-                    Vvdw[i]   = 0;
+                    /* The soft-core power p will not affect the results
+                     * with not using soft-core, so we use power of 0 which gives
+                     * the simplest math and cheapest code.
+                     */
+                    rpm2 = rinv * rinv;
+                    rp   = 1;
+                }
+                if (softCoreTreatment == SoftCoreTreatment::RPower6)
+                {
+                    rpm2 = rsq * rsq;  /* r4 */
+                    rp   = rpm2 * rsq; /* r6 */
+                }
+                if (softCoreTreatment == SoftCoreTreatment::RPower48)
+                {
+                    rp   = rsq * rsq * rsq; /* r6 */
+                    rp   = rp * rp;         /* r12 */
+                    rp   = rp * rp;         /* r24 */
+                    rp   = rp * rp;         /* r48 */
+                    rpm2 = rp / rsq;        /* r46 */
+                }
 
-                    real   rinvC, rinvV;
-                    SCReal rC, rV, rpinvC, rpinvV; /* Needs double for sc_power==48 */
+                real Fscal = 0;
 
-                    /* Only spend time on A or B state if it is non-zero */
-                    if ((qq[i] != 0) || (c6[i] != 0) || (c12[i] != 0))
+                qq[STATE_A] = iqA * chargeA[jnr];
+                qq[STATE_B] = iqB * chargeB[jnr];
+
+                tj[STATE_A] = ntiA + 2 * typeA[jnr];
+                tj[STATE_B] = ntiB + 2 * typeB[jnr];
+
+                if (excl_fep[k])
+                {
+                    c6[STATE_A] = nbfp[tj[STATE_A]];
+                    c6[STATE_B] = nbfp[tj[STATE_B]];
+
+                    for (int i = 0; i < NSTATES; i++)
                     {
-                        /* this section has to be inside the loop because of the dependence on sigma_pow */
+                        c12[i] = nbfp[tj[i] + 1];
                         if (useSoftCore)
                         {
-                            rpinvC = one / (alpha_coul_eff * lfac_coul[i] * sigma_pow[i] + rp);
-                            pthRoot<softCoreTreatment>(rpinvC, &rinvC, &rC);
-                            if (scLambdasOrAlphasDiffer)
+                            real sigma6[NSTATES];
+                            if ((c6[i] > 0) && (c12[i] > 0))
                             {
-                                rpinvV = one / (alpha_vdw_eff * lfac_vdw[i] * sigma_pow[i] + rp);
-                                pthRoot<softCoreTreatment>(rpinvV, &rinvV, &rV);
+                                /* c12 is stored scaled with 12.0 and c6 is scaled with 6.0 - correct for this */
+                                sigma6[i] = half * c12[i] / c6[i];
+                                if (sigma6[i] < sigma6_min) /* for disappearing coul and vdw with soft core at the same time */
+                                {
+                                    sigma6[i] = sigma6_min;
+                                }
                             }
                             else
                             {
-                                /* We can avoid one expensive pow and one / operation */
-                                rpinvV = rpinvC;
-                                rinvV  = rinvC;
-                                rV     = rC;
+                                sigma6[i] = sigma6_def;
                             }
+                            sigma_pow[i] = calculateSigmaPow<softCoreTreatment>(sigma6[i]);
+                        }
+                    }
+
+                    if (useSoftCore)
+                    {
+                        /* only use softcore if one of the states has a zero endstate - softcore is for avoiding infinities!*/
+                        if ((c12[STATE_A] > 0) && (c12[STATE_B] > 0))
+                        {
+                            alpha_vdw_eff  = 0;
+                            alpha_coul_eff = 0;
                         }
                         else
                         {
-                            rpinvC = 1;
-                            rinvC  = rinv;
-                            rC     = r;
-
-                            rpinvV = 1;
-                            rinvV  = rinv;
-                            rV     = r;
+                            alpha_vdw_eff  = alpha_vdw;
+                            alpha_coul_eff = alpha_coul;
                         }
+                    }
 
-                        /* Only process the coulomb interactions if we have charges,
-                         * and if we either include all entries in the list (no cutoff
-                         * used in the kernel), or if we are within the cutoff.
-                         */
-                        bool computeElecInteraction = (elecInteractionTypeIsEwald && r < rcoulomb)
-                                                      || (!elecInteractionTypeIsEwald && rC < rcoulomb);
+                    for (int i = 0; i < NSTATES; i++)
+                    {
+                        FscalC[i] = 0;
+                        FscalV[i] = 0;
+                        Vcoul[i]  = 0;
+                        Vvdw[i]   = 0;
 
-                        if ((qq[i] != 0) && computeElecInteraction)
-                        {
-                            if (elecInteractionTypeIsEwald)
-                            {
-                                Vcoul[i]  = ewaldPotential(qq[i], rinvC, sh_ewald);
-                                FscalC[i] = ewaldScalarForce(qq[i], rinvC);
-                            }
-                            else
-                            {
-                                Vcoul[i]  = reactionFieldPotential(qq[i], rinvC, rC, krf, crf);
-                                FscalC[i] = reactionFieldScalarForce(qq[i], rinvC, rC, krf, two);
-                            }
-                        }
+                        real   rinvC, rinvV;
+                        SCReal rC, rV, rpinvC, rpinvV; /* Needs double for sc_power==48 */
 
-                        /* Only process the VDW interactions if we have
-                         * some non-zero parameters, and if we either
-                         * include all entries in the list (no cutoff used
-                         * in the kernel), or if we are within the cutoff.
-                         */
-                        bool computeVdwInteraction = (vdwInteractionTypeIsEwald && r < rvdw)
-                                                     || (!vdwInteractionTypeIsEwald && rV < rvdw);
-                        if ((c6[i] != 0 || c12[i] != 0) && computeVdwInteraction)
+                        /* Only spend time on A or B state if it is non-zero */
+                        if ((qq[i] != 0) || (c6[i] != 0) || (c12[i] != 0))
                         {
-                            real rinv6;
-                            if (softCoreTreatment == SoftCoreTreatment::RPower6)
+                            /* this section has to be inside the loop because of the dependence on sigma_pow */
+                            if (useSoftCore)
                             {
-                                rinv6 = calculateRinv6<softCoreTreatment>(rpinvV);
+                                rpinvC = one / (alpha_coul_eff * lfac_coul[i] * sigma_pow[i] + rp);
+                                pthRoot<softCoreTreatment>(rpinvC, &rinvC, &rC);
+                                if (scLambdasOrAlphasDiffer)
+                                {
+                                    rpinvV = one / (alpha_vdw_eff * lfac_vdw[i] * sigma_pow[i] + rp);
+                                    pthRoot<softCoreTreatment>(rpinvV, &rinvV, &rV);
+                                }
+                                else
+                                {
+                                    /* We can avoid one expensive pow and one / operation */
+                                    rpinvV = rpinvC;
+                                    rinvV  = rinvC;
+                                    rV     = rC;
+                                }
                             }
                             else
                             {
-                                rinv6 = calculateRinv6<softCoreTreatment>(rinvV);
+                                rpinvC = 1;
+                                rinvC  = rinv;
+                                rC     = r;
+
+                                rpinvV = 1;
+                                rinvV  = rinv;
+                                rV     = r;
                             }
-                            real Vvdw6  = calculateVdw6(c6[i], rinv6);
-                            real Vvdw12 = calculateVdw12(c12[i], rinv6);
 
-                            Vvdw[i] = lennardJonesPotential(Vvdw6, Vvdw12, c6[i], c12[i], repulsionShift,
-                                                            dispersionShift, onesixth, onetwelfth);
-                            FscalV[i] = lennardJonesScalarForce(Vvdw6, Vvdw12);
+                            /* Only process the coulomb interactions if we have charges,
+                             * and if we either include all entries in the list (no cutoff
+                             * used in the kernel), or if we are within the cutoff.
+                             */
+                            bool computeElecInteraction = (elecInteractionTypeIsEwald && r < rcoulomb)
+                                                          || (!elecInteractionTypeIsEwald && rC < rcoulomb);
 
-                            if (vdwInteractionTypeIsEwald)
+                            if ((qq[i] != 0) && computeElecInteraction)
                             {
-                                /* Subtract the grid potential at the cut-off */
-                                Vvdw[i] += ewaldLennardJonesGridSubtract(nbfp_grid[tj[i]],
-                                                                         sh_lj_ewald, onesixth);
+                                if (elecInteractionTypeIsEwald)
+                                {
+                                    Vcoul[i]  = ewaldPotential(qq[i], rinvC, sh_ewald);
+                                    FscalC[i] = ewaldScalarForce(qq[i], rinvC);
+                                }
+                                else
+                                {
+                                    Vcoul[i]  = reactionFieldPotential(qq[i], rinvC, rC, krf, crf);
+                                    FscalC[i] = reactionFieldScalarForce(qq[i], rinvC, rC, krf, two);
+                                }
                             }
 
-                            if (vdwModifierIsPotSwitch)
+                            /* Only process the VDW interactions if we have
+                             * some non-zero parameters, and if we either
+                             * include all entries in the list (no cutoff used
+                             * in the kernel), or if we are within the cutoff.
+                             */
+                            bool computeVdwInteraction = (vdwInteractionTypeIsEwald && r < rvdw)
+                                                         || (!vdwInteractionTypeIsEwald && rV < rvdw);
+                            if ((c6[i] != 0 || c12[i] != 0) && computeVdwInteraction)
                             {
-                                real d        = rV - ic->rvdw_switch;
-                                d             = (d > zero) ? d : zero;
-                                const real d2 = d * d;
-                                const real sw = one + d2 * d * (vdw_swV3 + d * (vdw_swV4 + d * vdw_swV5));
-                                const real dsw = d2 * (vdw_swF2 + d * (vdw_swF3 + d * vdw_swF4));
-
-                                FscalV[i] = potSwitchScalarForceMod(FscalV[i], Vvdw[i], sw, rV,
-                                                                    rvdw, dsw, zero);
-                                Vvdw[i]   = potSwitchPotentialMod(Vvdw[i], sw, rV, rvdw, zero);
+                                real rinv6;
+                                if (softCoreTreatment == SoftCoreTreatment::RPower6)
+                                {
+                                    rinv6 = calculateRinv6<softCoreTreatment>(rpinvV);
+                                }
+                                else
+                                {
+                                    rinv6 = calculateRinv6<softCoreTreatment>(rinvV);
+                                }
+                                real Vvdw6  = calculateVdw6(c6[i], rinv6);
+                                real Vvdw12 = calculateVdw12(c12[i], rinv6);
+
+                                Vvdw[i] = lennardJonesPotential(Vvdw6, Vvdw12, c6[i], c12[i], repulsionShift,
+                                                                dispersionShift, onesixth, onetwelfth);
+                                FscalV[i] = lennardJonesScalarForce(Vvdw6, Vvdw12);
+
+                                if (vdwInteractionTypeIsEwald)
+                                {
+                                    /* Subtract the grid potential at the cut-off */
+                                    Vvdw[i] += ewaldLennardJonesGridSubtract(nbfp_grid[tj[i]],
+                                                                             sh_lj_ewald, onesixth);
+                                }
+
+                                if (vdwModifierIsPotSwitch)
+                                {
+                                    real d        = rV - ic->rvdw_switch;
+                                    d             = (d > zero) ? d : zero;
+                                    const real d2 = d * d;
+                                    const real sw = one + d2 * d * (vdw_swV3 + d * (vdw_swV4 + d * vdw_swV5));
+                                    const real dsw = d2 * (vdw_swF2 + d * (vdw_swF3 + d * vdw_swF4));
+
+                                    FscalV[i] = potSwitchScalarForceMod(FscalV[i], Vvdw[i], sw, rV,
+                                                                        rvdw, dsw, zero);
+                                    Vvdw[i]   = potSwitchPotentialMod(Vvdw[i], sw, rV, rvdw, zero);
+                                }
                             }
+
+                            /* FscalC (and FscalV) now contain: dV/drC * rC
+                             * Now we multiply by rC^-p, so it will be: dV/drC * rC^1-p
+                             * Further down we first multiply by r^p-2 and then by
+                             * the vector r, which in total gives: dV/drC * (r/rC)^1-p
+                             */
+                            FscalC[i] *= rpinvC;
+                            FscalV[i] *= rpinvV;
                         }
+                    }
 
-                        /* FscalC (and FscalV) now contain: dV/drC * rC
-                         * Now we multiply by rC^-p, so it will be: dV/drC * rC^1-p
-                         * Further down we first multiply by r^p-2 and then by
-                         * the vector r, which in total gives: dV/drC * (r/rC)^1-p
+                    /* Assemble A and B states */
+                    for (int i = 0; i < NSTATES; i++)
+                    {
+                        vctot += LFC[i] * Vcoul[i];
+                        vvtot += LFV[i] * Vvdw[i];
+
+                        Fscal += LFC[i] * FscalC[i] * rpm2;
+                        Fscal += LFV[i] * FscalV[i] * rpm2;
+
+                        if (useSoftCore)
+                        {
+                            dvdl_coul +=
+                                    Vcoul[i] * DLF[i]
+                                    + LFC[i] * alpha_coul_eff * dlfac_coul[i] * FscalC[i] * sigma_pow[i];
+                            dvdl_vdw += Vvdw[i] * DLF[i]
+                                        + LFV[i] * alpha_vdw_eff * dlfac_vdw[i] * FscalV[i] * sigma_pow[i];
+                        }
+                        else
+                        {
+                            dvdl_coul += Vcoul[i] * DLF[i];
+                            dvdl_vdw += Vvdw[i] * DLF[i];
+                        }
+                    }
+                }
+                else if (icoul == GMX_NBKERNEL_ELEC_REACTIONFIELD)
+                {
+                    /* For excluded pairs, which are only in this pair list when
+                     * using the Verlet scheme, we don't use soft-core.
+                     * As there is no singularity, there is no need for soft-core.
+                     */
+                    const real FF = -two * krf;
+                    real       VV = krf * rsq - crf;
+
+                    if (ii == jnr)
+                    {
+                        VV *= half;
+                    }
+
+                    for (int i = 0; i < NSTATES; i++)
+                    {
+                        vctot += LFC[i] * qq[i] * VV;
+                        Fscal += LFC[i] * qq[i] * FF;
+                        dvdl_coul += DLF[i] * qq[i] * VV;
+                    }
+                }
+
+                if (elecInteractionTypeIsEwald && r < rcoulomb)
+                {
+                    /* See comment in the preamble. When using Ewald interactions
+                     * (unless we use a switch modifier) we subtract the reciprocal-space
+                     * Ewald component here which made it possible to apply the free
+                     * energy interaction to 1/r (vanilla coulomb short-range part)
+                     * above. This gets us closer to the ideal case of applying
+                     * the softcore to the entire electrostatic interaction,
+                     * including the reciprocal-space component.
+                     */
+                    real v_lr, f_lr;
+
+                    const real ewrt   = r * coulombTableScale;
+                    int        ewitab = static_cast<int>(ewrt);
+                    const real eweps  = ewrt - ewitab;
+                    ewitab            = 4 * ewitab;
+                    f_lr              = ewtab[ewitab] + eweps * ewtab[ewitab + 1];
+                    v_lr = (ewtab[ewitab + 2] - coulombTableScaleInvHalf * eweps * (ewtab[ewitab] + f_lr));
+                    f_lr *= rinv;
+
+                    /* Note that any possible Ewald shift has already been applied in
+                     * the normal interaction part above.
+                     */
+
+                    if (ii == jnr)
+                    {
+                        /* If we get here, the i particle (ii) has itself (jnr)
+                         * in its neighborlist. This can only happen with the Verlet
+                         * scheme, and corresponds to a self-interaction that will
+                         * occur twice. Scale it down by 50% to only include it once.
                          */
-                        FscalC[i] *= rpinvC;
-                        FscalV[i] *= rpinvV;
+                        v_lr *= half;
+                    }
+
+                    for (int i = 0; i < NSTATES; i++)
+                    {
+                        vctot -= LFC[i] * qq[i] * v_lr;
+                        Fscal -= LFC[i] * qq[i] * f_lr;
+                        dvdl_coul -= (DLF[i] * qq[i]) * v_lr;
                     }
                 }
 
-                /* Assemble A and B states */
-                for (int i = 0; i < NSTATES; i++)
+                if (vdwInteractionTypeIsEwald && r < rvdw)
                 {
-                    vctot += LFC[i] * Vcoul[i];
-                    vvtot += LFV[i] * Vvdw[i];
+                    /* See comment in the preamble. When using LJ-Ewald interactions
+                     * (unless we use a switch modifier) we subtract the reciprocal-space
+                     * Ewald component here which made it possible to apply the free
+                     * energy interaction to r^-6 (vanilla LJ6 short-range part)
+                     * above. This gets us closer to the ideal case of applying
+                     * the softcore to the entire VdW interaction,
+                     * including the reciprocal-space component.
+                     */
+                    /* We could also use the analytical form here
+                     * iso a table, but that can cause issues for
+                     * r close to 0 for non-interacting pairs.
+                     */
 
-                    Fscal += LFC[i] * FscalC[i] * rpm2;
-                    Fscal += LFV[i] * FscalV[i] * rpm2;
+                    const real rs   = rsq * rinv * vdwTableScale;
+                    const int  ri   = static_cast<int>(rs);
+                    const real frac = rs - ri;
+                    const real f_lr = (1 - frac) * tab_ewald_F_lj[ri] + frac * tab_ewald_F_lj[ri + 1];
+                    /* TODO: Currently the Ewald LJ table does not contain
+                     * the factor 1/6, we should add this.
+                     */
+                    const real FF = f_lr * rinv / six;
+                    real VV = (tab_ewald_V_lj[ri] - vdwTableScaleInvHalf * frac * (tab_ewald_F_lj[ri] + f_lr))
+                              / six;
 
-                    if (useSoftCore)
+                    if (ii == jnr)
                     {
-                        dvdl_coul +=
-                                Vcoul[i] * DLF[i]
-                                + LFC[i] * alpha_coul_eff * dlfac_coul[i] * FscalC[i] * sigma_pow[i];
-                        dvdl_vdw += Vvdw[i] * DLF[i]
-                                    + LFV[i] * alpha_vdw_eff * dlfac_vdw[i] * FscalV[i] * sigma_pow[i];
+                        /* If we get here, the i particle (ii) has itself (jnr)
+                         * in its neighborlist. This can only happen with the Verlet
+                         * scheme, and corresponds to a self-interaction that will
+                         * occur twice. Scale it down by 50% to only include it once.
+                         */
+                        VV *= half;
                     }
-                    else
+
+                    for (int i = 0; i < NSTATES; i++)
                     {
-                        dvdl_coul += Vcoul[i] * DLF[i];
-                        dvdl_vdw += Vvdw[i] * DLF[i];
+                        const real c6grid = nbfp_grid[tj[i]];
+                        vvtot += LFV[i] * c6grid * VV;
+                        Fscal += LFV[i] * c6grid * FF;
+                        dvdl_vdw += (DLF[i] * c6grid) * VV;
                     }
                 }
-            }
-            else if (icoul == GMX_NBKERNEL_ELEC_REACTIONFIELD)
-            {
-                /* For excluded pairs, which are only in this pair list when
-                 * using the Verlet scheme, we don't use soft-core.
-                 * As there is no singularity, there is no need for soft-core.
-                 */
-                const real FF = -two * krf;
-                real       VV = krf * rsq - crf;
 
-                if (ii == jnr)
+                if (doForces)
                 {
-                    VV *= half;
+                    const real tx = Fscal * dx;
+                    const real ty = Fscal * dy;
+                    const real tz = Fscal * dz;
+                    fix           = fix + tx;
+                    fiy           = fiy + ty;
+                    fiz           = fiz + tz;
+                    /* OpenMP atomics are expensive, but this kernels is also
+                     * expensive, so we can take this hit, instead of using
+                     * thread-local output buffers and extra reduction.
+                     *
+                     * All the OpenMP regions in this file are trivial and should
+                     * not throw, so no need for try/catch.
+                     */
+#pragma omp atomic
+                    f[j3] -= tx;
+#pragma omp atomic
+                    f[j3 + 1] -= ty;
+#pragma omp atomic
+                    f[j3 + 2] -= tz;
                 }
+            }
 
-                for (int i = 0; i < NSTATES; i++)
+            /* The atomics below are expensive with many OpenMP threads.
+             * Here unperturbed i-particles will usually only have a few
+             * (perturbed) j-particles in the list. Thus with a buffered list
+             * we can skip a significant number of i-reductions with a check.
+             */
+            if (npair_within_cutoff > 0)
+            {
+                if (doForces)
                 {
-                    vctot += LFC[i] * qq[i] * VV;
-                    Fscal += LFC[i] * qq[i] * FF;
-                    dvdl_coul += DLF[i] * qq[i] * VV;
+#pragma omp atomic
+                    f[ii3] += fix;
+#pragma omp atomic
+                    f[ii3 + 1] += fiy;
+#pragma omp atomic
+                    f[ii3 + 2] += fiz;
+                }
+                if (doShiftForces)
+                {
+#pragma omp atomic
+                    fshift[is3] += fix;
+#pragma omp atomic
+                    fshift[is3 + 1] += fiy;
+#pragma omp atomic
+                    fshift[is3 + 2] += fiz;
+                }
+                if (doPotential)
+                {
+                    int ggid = gid[n];
+#pragma omp atomic
+                    Vc[ggid] += vctot;
+#pragma omp atomic
+                    Vv[ggid] += vvtot;
                 }
             }
+        }
+    }
 
-            if (elecInteractionTypeIsEwald && r < rcoulomb)
-            {
-                /* See comment in the preamble. When using Ewald interactions
-                 * (unless we use a switch modifier) we subtract the reciprocal-space
-                 * Ewald component here which made it possible to apply the free
-                 * energy interaction to 1/r (vanilla coulomb short-range part)
-                 * above. This gets us closer to the ideal case of applying
-                 * the softcore to the entire electrostatic interaction,
-                 * including the reciprocal-space component.
-                 */
-                real v_lr, f_lr;
-
-                const real ewrt   = r * coulombTableScale;
-                int        ewitab = static_cast<int>(ewrt);
-                const real eweps  = ewrt - ewitab;
-                ewitab            = 4 * ewitab;
-                f_lr              = ewtab[ewitab] + eweps * ewtab[ewitab + 1];
-                v_lr = (ewtab[ewitab + 2] - coulombTableScaleInvHalf * eweps * (ewtab[ewitab] + f_lr));
-                f_lr *= rinv;
-
-                /* Note that any possible Ewald shift has already been applied in
-                 * the normal interaction part above.
-                 */
+#pragma omp atomic
+    dvdl[efptCOUL] += dvdl_coul;
+#pragma omp atomic
+    dvdl[efptVDW] += dvdl_vdw;
 
-                if (ii == jnr)
+    /* Estimate flops, average for free energy stuff:
+     * 12  flops per outer iteration
+     * 150 flops per inner iteration
+     */
+#pragma omp atomic
+    inc_nrnb(nrnb, eNR_NBKERNEL_FREE_ENERGY, numIAtomLists * 12 + nlist.numPairs * 150);
+}
+
+#if GMX_SIMD_HAVE_REAL && GMX_SIMD_HAVE_GATHER_LOADU_BYSIMDINT_TRANSPOSE_REAL
+
+/*! \brief Streams the j-atoms of one i-atom directly from the j-cluster entries and their masks
+ *
+ * This avoids unpacking the cluster-pair list into atom-pair lists.
+ * The j-atoms are returned in batches of at most the SIMD width,
+ * a batch ends early when the energy-group pair changes.
+ */
+class FepJAtomStream
+{
+public:
+    //! Sets up streaming the j-atoms of i-atom \p ii, with index \p i in the cluster of \p ciEntry
+    FepJAtomStream(const NbnxnPairlistFep&  nlist,
+                   const nbnxn_fep_ci_t&    ciEntry,
+                   int                      i,
+                   int                      ii,
+                   gmx::ArrayRef<const int> atomIndices,
+                   const t_mdatoms&         mdatoms) :
+        cjList_(nlist.cj),
+        atomIndices_(atomIndices),
+        naCj_(nlist.na_cj),
+        iShift_(i * nlist.na_cj),
+        jAtomMask_((1U << nlist.na_cj) - 1),
+        ngid_(mdatoms.nenergrp),
+        cENER_(mdatoms.cENER),
+        energyGroupI_(mdatoms.nenergrp > 1 ? mdatoms.cENER[ii] : 0),
+        cjIndex_(ciEntry.cj_ind_start),
+        cjIndexEnd_(ciEntry.cj_ind_end),
+        j_(0)
+    {
+    }
+
+    /*! \brief Returns the next batch of at most \p maxNumAtoms j-atoms
+     *
+     * Stores the atom indices in \p jAtoms, 1 or 0 for interacting or excluded
+     * pairs in \p interacts and the energy-group pair index of the batch in \p gid.
+     * Returns the number of atoms in the batch, 0 when all pairs have been returned.
+     */
+    int nextBatch(int maxNumAtoms, std::int32_t* jAtoms, real* interacts, int* gid)
+    {
+        int numAtoms = 0;
+        while (numAtoms < maxNumAtoms && cjIndex_ < cjIndexEnd_)
+        {
+            const nbnxn_fep_cj_t& cjEntry   = cjList_[cjIndex_];
+            const unsigned int    pairMaskI = (cjEntry.pairMask >> iShift_) & jAtomMask_;
+            if ((pairMaskI >> j_) & 1U)
+            {
+                const int jnr     = atomIndices_[cjEntry.cj * naCj_ + j_];
+                const int gidPair = (ngid_ > 1 ? GID(energyGroupI_, cENER_[jnr], ngid_) : 0);
+                if (numAtoms == 0)
                 {
-                    /* If we get here, the i particle (ii) has itself (jnr)
-                     * in its neighborlist. This can only happen with the Verlet
-                     * scheme, and corresponds to a self-interaction that will
-                     * occur twice. Scale it down by 50% to only include it once.
-                     */
-                    v_lr *= half;
+                    *gid = gidPair;
                 }
-
-                for (int i = 0; i < NSTATES; i++)
+                else if (gidPair != *gid)
                 {
-                    vctot -= LFC[i] * qq[i] * v_lr;
-                    Fscal -= LFC[i] * qq[i] * f_lr;
-                    dvdl_coul -= (DLF[i] * qq[i]) * v_lr;
+                    /* This pair starts the next batch */
+                    break;
                 }
+                jAtoms[numAtoms]    = jnr;
+                interacts[numAtoms] = ((cjEntry.excl >> (iShift_ + j_)) & 1U) ? 1 : 0;
+                numAtoms++;
             }
+            j_++;
+            if ((pairMaskI >> j_) == 0)
+            {
+                /* No more pairs with this j-cluster */
+                j_ = 0;
+                cjIndex_++;
+            }
+        }
+
+        return numAtoms;
+    }
+
+private:
+    //! The j-cluster entries of the list
+    gmx::ArrayRef<const nbnxn_fep_cj_t> cjList_;
+    //! The atom indices of the list clusters
+    gmx::ArrayRef<const int> atomIndices_;
+    //! The j-cluster size
+    int naCj_;
+    //! The shift of the mask bits of our i-atom
+    int iShift_;
+    //! Mask for the bits of one i-atom
+    unsigned int jAtomMask_;
+    //! The number of energy groups
+    int ngid_;
+    //! The energy group of each atom
+    const unsigned short* cENER_;
+    //! The energy group of our i-atom
+    int energyGroupI_;
+    //! The current j-cluster entry
+    int cjIndex_;
+    //! The end of the j-cluster entries of our i-entry
+    int cjIndexEnd_;
+    //! The next atom in the current j-cluster
+    int j_;
+};
+
+//! Templated SIMD free-energy non-bonded kernel, supports the soft-core treatments None and RPower6
+template<SoftCoreTreatment softCoreTreatment, bool scLambdasOrAlphasDiffer, bool vdwInteractionTypeIsEwald, bool elecInteractionTypeIsEwald, bool vdwModifierIsPotSwitch>
+static void nb_free_energy_kernel_simd(const NbnxnPairlistFep&    nlist,
+                                       gmx::ArrayRef<const int>   atomIndices,
+                                       rvec* gmx_restrict         xx,
+                                       gmx::ForceWithShiftForces* forceWithShiftForces,
+                                       const t_forcerec* gmx_restrict fr,
+                                       const t_mdatoms* gmx_restrict mdatoms,
+                                       nb_kernel_data_t* gmx_restrict kernel_data,
+                                       t_nrnb* gmx_restrict nrnb)
+{
+    static_assert(softCoreTreatment != SoftCoreTreatment::RPower48,
+                  "The SIMD kernel does not support soft-core with r-power 48");
+
+    constexpr bool useSoftCore = (softCoreTreatment != SoftCoreTreatment::None);
+
+    constexpr int c_numStates = 2;
+
+    constexpr real onetwelfth = 1.0 / 12.0;
+    constexpr real onesixth   = 1.0 / 6.0;
+    constexpr real half       = 0.5;
+    constexpr real one        = 1.0;
+    constexpr real two        = 2.0;
+
+    /* Extract pointer to non-bonded interaction constants */
+    const interaction_const_t* ic = fr->ic;
+
+    const real* shiftvec      = fr->shift_vec[0];
+    const real* chargeA       = mdatoms->chargeA;
+    const real* chargeB       = mdatoms->chargeB;
+    real*       Vc            = kernel_data->energygrp_elec;
+    const int*  typeA         = mdatoms->typeA;
+    const int*  typeB         = mdatoms->typeB;
+    const int   ntype         = fr->ntype;
+    const real* nbfp          = fr->nbfp;
+    const real* nbfp_grid     = fr->ljpme_c6grid;
+    real*       Vv            = kernel_data->energygrp_vdw;
+    const real  lambda_coul   = kernel_data->lambda[efptCOUL];
+    const real  lambda_vdw    = kernel_data->lambda[efptVDW];
+    real*       dvdl          = kernel_data->dvdl;
+    const real  alpha_coul    = fr->sc_alphacoul;
+    const real  alpha_vdw     = fr->sc_alphavdw;
+    const real  lam_power     = fr->sc_power;
+    const real  sigma6_def    = fr->sc_sigma6_def;
+    const real  sigma6_min    = fr->sc_sigma6_min;
+    const bool  doForces      = ((kernel_data->flags & GMX_NONBONDED_DO_FORCE) != 0);
+    const bool  doShiftForces = ((kernel_data->flags & GMX_NONBONDED_DO_SHIFTFORCE) != 0);
+    const bool  doPotential   = ((kernel_data->flags & GMX_NONBONDED_DO_POTENTIAL) != 0);
+
+    // Note that the nbnxm kernels do not support Coulomb potential switching at all
+    GMX_ASSERT(ic->coulomb_modifier != eintmodPOTSWITCH,
+               "Potential switching is not supported for Coulomb with FEP");
+    GMX_RELEASE_ASSERT(!(vdwInteractionTypeIsEwald && vdwModifierIsPotSwitch),
+                       "Can not apply soft-core to switched Ewald potentials");
+
+    // Extract data from interaction_const_t
+    const SimdReal facel_S(ic->epsfac);
+    const SimdReal rcoulomb_S(ic->rcoulomb);
+    const SimdReal krf_S(ic->k_rf);
+    const SimdReal crf_S(ic->c_rf);
+    const SimdReal rvdw_S(ic->rvdw);
+    const SimdReal dispersionShift_S(ic->dispersion_shift.cpot);
+    const SimdReal repulsionShift_S(ic->repulsion_shift.cpot);
+    const SimdReal sh_lj_ewald_S(ic->sh_lj_ewald);
+
+    SimdReal vdw_swV3_S, vdw_swV4_S, vdw_swV5_S, vdw_swF2_S, vdw_swF3_S, vdw_swF4_S;
+    SimdReal rvdw_switch_S;
+    if (vdwModifierIsPotSwitch)
+    {
+        const real d  = ic->rvdw - ic->rvdw_switch;
+        vdw_swV3_S    = SimdReal(-10.0 / (d * d * d));
+        vdw_swV4_S    = SimdReal(15.0 / (d * d * d * d));
+        vdw_swV5_S    = SimdReal(-6.0 / (d * d * d * d * d));
+        vdw_swF2_S    = SimdReal(-30.0 / (d * d * d));
+        vdw_swF3_S    = SimdReal(60.0 / (d * d * d * d));
+        vdw_swF4_S    = SimdReal(-30.0 / (d * d * d * d * d));
+        rvdw_switch_S = SimdReal(ic->rvdw_switch);
+    }
+    else
+    {
+        vdw_swV3_S = vdw_swV4_S = vdw_swV5_S = setZero();
+        vdw_swF2_S = vdw_swF3_S = vdw_swF4_S = setZero();
+        rvdw_switch_S                        = setZero();
+    }
+
+    const real     rcutoff_max = std::max(ic->rcoulomb, ic->rvdw);
+    const SimdReal rcutoff_max2_S(rcutoff_max * rcutoff_max);
+
+    /* For the Ewald corrections we use the same tables as the plain-C kernel,
+     * with the F and V tables separated, so we can use unaligned gathers.
+     */
+    const real* tab_ewald_F  = nullptr;
+    const real* tab_ewald_V  = nullptr;
+    SimdReal    coulombTableScale_S, coulombTableScaleInvHalf_S, sh_ewald_S;
+    if (elecInteractionTypeIsEwald)
+    {
+        const auto& coulombTables  = *ic->coulombEwaldTables;
+        tab_ewald_F                = coulombTables.tableF.data();
+        tab_ewald_V                = coulombTables.tableV.data();
+        coulombTableScale_S        = SimdReal(coulombTables.scale);
+        coulombTableScaleInvHalf_S = SimdReal(half / coulombTables.scale);
+        sh_ewald_S                 = SimdReal(ic->sh_ewald);
+    }
+    const real* tab_ewald_F_lj = nullptr;
+    const real* tab_ewald_V_lj = nullptr;
+    SimdReal    vdwTableScale_S, vdwTableScaleInvHalf_S;
+    if (vdwInteractionTypeIsEwald)
+    {
+        const auto& vdwTables  = *ic->vdwEwaldTables;
+        tab_ewald_F_lj         = vdwTables.tableF.data();
+        tab_ewald_V_lj         = vdwTables.tableV.data();
+        vdwTableScale_S        = SimdReal(vdwTables.scale);
+        vdwTableScaleInvHalf_S = SimdReal(half / vdwTables.scale);
+    }
+
+    /* Lambda factors for state A and B and their derivatives */
+    const real LFC[c_numStates] = { one - lambda_coul, lambda_coul };
+    const real LFV[c_numStates] = { one - lambda_vdw, lambda_vdw };
+    const real DLF[c_numStates] = { -1, 1 };
+
+    real           lfac_coul[c_numStates], dlfac_coul[c_numStates];
+    real           lfac_vdw[c_numStates], dlfac_vdw[c_numStates];
+    constexpr real sc_r_power = 6.0_real;
+    for (int i = 0; i < c_numStates; i++)
+    {
+        lfac_coul[i]  = (lam_power == 2 ? (1 - LFC[i]) * (1 - LFC[i]) : (1 - LFC[i]));
+        dlfac_coul[i] = DLF[i] * lam_power / sc_r_power * (lam_power == 2 ? (1 - LFC[i]) : 1);
+        lfac_vdw[i]   = (lam_power == 2 ? (1 - LFV[i]) * (1 - LFV[i]) : (1 - LFV[i]));
+        dlfac_vdw[i]  = DLF[i] * lam_power / sc_r_power * (lam_power == 2 ? (1 - LFV[i]) : 1);
+    }
+
+    const SimdReal zero_S = setZero();
+    const SimdReal half_S(half);
+    const SimdReal one_S(one);
 
-            if (vdwInteractionTypeIsEwald && r < rvdw)
+    alignas(GMX_SIMD_ALIGNMENT) std::int32_t jAtom[GMX_SIMD_REAL_WIDTH];
+    alignas(GMX_SIMD_ALIGNMENT) real         qj[c_numStates][GMX_SIMD_REAL_WIDTH];
+    alignas(GMX_SIMD_ALIGNMENT) real         c6[c_numStates][GMX_SIMD_REAL_WIDTH];
+    alignas(GMX_SIMD_ALIGNMENT) real         c12[c_numStates][GMX_SIMD_REAL_WIDTH];
+    alignas(GMX_SIMD_ALIGNMENT) real         c6grid[c_numStates][GMX_SIMD_REAL_WIDTH];
+    alignas(GMX_SIMD_ALIGNMENT) real         pairMask[GMX_SIMD_REAL_WIDTH];
+    alignas(GMX_SIMD_ALIGNMENT) real         interactionMask[GMX_SIMD_REAL_WIDTH];
+    alignas(GMX_SIMD_ALIGNMENT) real         selfFactor[GMX_SIMD_REAL_WIDTH];
+    alignas(GMX_SIMD_ALIGNMENT) real         fjBuffer[DIM][GMX_SIMD_REAL_WIDTH];
+
+    SimdReal dvdl_coul_S = setZero();
+    SimdReal dvdl_vdw_S  = setZero();
+
+    // TODO: We should get rid of using pointers to real
+    const real* x             = xx[0];
+    real* gmx_restrict f      = &(forceWithShiftForces->force()[0][0]);
+    real* gmx_restrict fshift = &(forceWithShiftForces->shiftForces()[0][0]);
+
+    int numIAtoms = 0;
+
+    for (const nbnxn_fep_ci_t& ciEntry : nlist.ci)
+    {
+        const int is3 = 3 * ciEntry.shift;
+
+        for (int i = 0; i < nlist.na_ci; i++)
+        {
+            const int ii = atomIndices[ciEntry.ci * nlist.na_ci + i];
+            if (ii < 0)
+            {
+                continue;
+            }
+            numIAtoms++;
+
+            bool haveInteractionWithinCutoff = false;
+
+            const int      ii3 = 3 * ii;
+            const SimdReal ix_S(shiftvec[is3] + x[ii3 + 0]);
+            const SimdReal iy_S(shiftvec[is3 + 1] + x[ii3 + 1]);
+            const SimdReal iz_S(shiftvec[is3 + 2] + x[ii3 + 2]);
+            const SimdReal iq_S[c_numStates] = { facel_S * SimdReal(chargeA[ii]),
+                                                 facel_S * SimdReal(chargeB[ii]) };
+            const int      ntiA              = 2 * ntype * typeA[ii];
+            const int      ntiB              = 2 * ntype * typeB[ii];
+
+            SimdReal vctot_S = setZero();
+            SimdReal vvtot_S = setZero();
+            SimdReal fix_S   = setZero();
+            SimdReal fiy_S   = setZero();
+            SimdReal fiz_S   = setZero();
+
+            FepJAtomStream jAtomStream(nlist, ciEntry, i, ii, atomIndices, *mdatoms);
+            int            energyGroupPair = -1;
+            int            batchGid        = 0;
+            int            numLanes;
+            while ((numLanes = jAtomStream.nextBatch(GMX_SIMD_REAL_WIDTH, jAtom, interactionMask,
+                                                     &batchGid))
+                   > 0)
             {
-                /* See comment in the preamble. When using LJ-Ewald interactions
-                 * (unless we use a switch modifier) we subtract the reciprocal-space
-                 * Ewald component here which made it possible to apply the free
-                 * energy interaction to r^-6 (vanilla LJ6 short-range part)
-                 * above. This gets us closer to the ideal case of applying
-                 * the softcore to the entire VdW interaction,
-                 * including the reciprocal-space component.
+                if (batchGid != energyGroupPair)
+                {
+                    if (doPotential && energyGroupPair >= 0)
+                    {
+                        /* The energy-group pair changed, store the energies of the previous one */
+                        const real vctot = reduce(vctot_S);
+                        const real vvtot = reduce(vvtot_S);
+#    pragma omp atomic
+                        Vc[energyGroupPair] += vctot;
+#    pragma omp atomic
+                        Vv[energyGroupPair] += vvtot;
+                        vctot_S = setZero();
+                        vvtot_S = setZero();
+                    }
+                    energyGroupPair = batchGid;
+                }
+
+                /* Collect the j-atom data, at the end we fill the arrays
+                 * with the last j-atom, but with a zero pair mask.
                  */
-                /* We could also use the analytical form here
-                 * iso a table, but that can cause issues for
-                 * r close to 0 for non-interacting pairs.
+                for (int s = 0; s < GMX_SIMD_REAL_WIDTH; s++)
+                {
+                    const int lane = std::min(s, numLanes - 1);
+                    const int jnr  = jAtom[lane];
+
+                    const int tjA = ntiA + 2 * typeA[jnr];
+                    const int tjB = ntiB + 2 * typeB[jnr];
+
+                    jAtom[s]           = jnr;
+                    interactionMask[s] = interactionMask[lane];
+                    qj[0][s]           = chargeA[jnr];
+                    qj[1][s]           = chargeB[jnr];
+                    c6[0][s]           = nbfp[tjA];
+                    c6[1][s]           = nbfp[tjB];
+                    c12[0][s]          = nbfp[tjA + 1];
+                    c12[1][s]          = nbfp[tjB + 1];
+                    if (vdwInteractionTypeIsEwald)
+                    {
+                        c6grid[0][s] = nbfp_grid[tjA];
+                        c6grid[1][s] = nbfp_grid[tjB];
+                    }
+                    pairMask[s]   = (s < numLanes ? 1 : 0);
+                    selfFactor[s] = (ii == jnr ? half : one);
+                }
+
+                SimdReal jx_S, jy_S, jz_S;
+                gatherLoadUTranspose<3>(x, jAtom, &jx_S, &jy_S, &jz_S);
+
+                const SimdReal dx_S  = ix_S - jx_S;
+                const SimdReal dy_S  = iy_S - jy_S;
+                const SimdReal dz_S  = iz_S - jz_S;
+                const SimdReal rsq_S = norm2(dx_S, dy_S, dz_S);
+
+                /* With soft-core the actual cut-off check might be different,
+                 * but since the soft-core distance is always larger than r,
+                 * checking on r here is safe.
                  */
+                const SimdBool withinCutoff_S =
+                        (load<SimdReal>(pairMask) != zero_S) && (rsq_S < rcutoff_max2_S);
+                if (!anyTrue(withinCutoff_S))
+                {
+                    continue;
+                }
+                haveInteractionWithinCutoff = true;
+
+                const SimdBool interacts_S =
+                        withinCutoff_S && (load<SimdReal>(interactionMask) != zero_S);
+                const SimdBool excluded_S =
+                        withinCutoff_S && (load<SimdReal>(interactionMask) == zero_S);
 
-                const real rs   = rsq * rinv * vdwTableScale;
-                const int  ri   = static_cast<int>(rs);
-                const real frac = rs - ri;
-                const real f_lr = (1 - frac) * tab_ewald_F_lj[ri] + frac * tab_ewald_F_lj[ri + 1];
-                /* TODO: Currently the Ewald LJ table does not contain
-                 * the factor 1/6, we should add this.
+                /* The force at r=0 is zero, because of symmetry.
+                 * But note that the potential is in general non-zero,
+                 * since the soft-cored r will be non-zero.
                  */
-                const real FF = f_lr * rinv / six;
-                real VV = (tab_ewald_V_lj[ri] - vdwTableScaleInvHalf * frac * (tab_ewald_F_lj[ri] + f_lr))
-                          / six;
+                const SimdReal rinv_S = maskzInvsqrt(rsq_S, withinCutoff_S && (zero_S < rsq_S));
+                const SimdReal r_S    = rsq_S * rinv_S;
+
+                SimdReal rpm2_S, rp_S;
+                if (softCoreTreatment == SoftCoreTreatment::None)
+                {
+                    rpm2_S = rinv_S * rinv_S;
+                    rp_S   = one_S;
+                }
+                else
+                {
+                    rpm2_S = rsq_S * rsq_S;  /* r4 */
+                    rp_S   = rpm2_S * rsq_S; /* r6 */
+                }
+
+                SimdReal qq_S[c_numStates];
+                SimdReal c6_S[c_numStates], c12_S[c_numStates];
+                SimdReal c6grid_S[c_numStates] = { setZero(), setZero() };
+                for (int i = 0; i < c_numStates; i++)
+                {
+                    qq_S[i]  = iq_S[i] * load<SimdReal>(qj[i]);
+                    c6_S[i]  = load<SimdReal>(c6[i]);
+                    c12_S[i] = load<SimdReal>(c12[i]);
+                    if (vdwInteractionTypeIsEwald)
+                    {
+                        c6grid_S[i] = load<SimdReal>(c6grid[i]);
+                    }
+                }
+
+                SimdReal sigma_pow_S[c_numStates] = { setZero(), setZero() };
+                SimdReal alpha_coul_eff_S         = setZero();
+                SimdReal alpha_vdw_eff_S          = setZero();
+                if (useSoftCore)
+                {
+                    for (int i = 0; i < c_numStates; i++)
+                    {
+                        /* c12 is stored scaled with 12.0 and c6 is scaled with 6.0 - correct for this */
+                        const SimdBool haveC6AndC12_S = (zero_S < c6_S[i]) && (zero_S < c12_S[i]);
+                        const SimdReal sigma6_S =
+                                max(half_S * c12_S[i] * maskzInv(c6_S[i], haveC6AndC12_S),
+                                    SimdReal(sigma6_min));
+                        sigma_pow_S[i] = blend(SimdReal(sigma6_def), sigma6_S, haveC6AndC12_S);
+                    }
+
+                    /* only use softcore if one of the states has a zero endstate - softcore is for avoiding infinities!*/
+                    const SimdBool noSoftCore_S = (zero_S < c12_S[0]) && (zero_S < c12_S[1]);
+                    alpha_coul_eff_S            = selectByNotMask(SimdReal(alpha_coul), noSoftCore_S);
+                    alpha_vdw_eff_S             = selectByNotMask(SimdReal(alpha_vdw), noSoftCore_S);
+                }
+
+                SimdReal fscal_S = setZero();
 
-                if (ii == jnr)
+                for (int i = 0; i < c_numStates; i++)
                 {
-                    /* If we get here, the i particle (ii) has itself (jnr)
-                     * in its neighborlist. This can only happen with the Verlet
-                     * scheme, and corresponds to a self-interaction that will
-                     * occur twice. Scale it down by 50% to only include it once.
+                    /* Only spend time on A or B state if it is non-zero */
+                    const SimdBool haveVdw_S = (c6_S[i] != zero_S) || (c12_S[i] != zero_S);
+                    const SimdBool haveElec_S = (qq_S[i] != zero_S);
+                    const SimdBool computeState_S = interacts_S && (haveElec_S || haveVdw_S);
+                    if (!anyTrue(computeState_S))
+                    {
+                        continue;
+                    }
+
+                    SimdReal rinvC_S, rC_S, rpinvC_S;
+                    SimdReal rinvV_S, rV_S, rpinvV_S;
+                    if (useSoftCore)
+                    {
+                        /* We compute r^6 = alpha*lambda*sigma^6 + r^6 and take the sixth root
+                         * of its cube root, lanes we do not compute get r^6=1 to avoid
+                         * operations on infinities.
+                         */
+                        const SimdReal rpC_S = blend(
+                                one_S, fma(alpha_coul_eff_S * SimdReal(lfac_coul[i]), sigma_pow_S[i], rp_S),
+                                computeState_S);
+                        const SimdReal cbrtC_S = cbrt(rpC_S);
+                        rpinvC_S               = inv(rpC_S);
+                        rinvC_S                = invsqrt(cbrtC_S);
+                        rC_S                   = cbrtC_S * rinvC_S;
+                        if (scLambdasOrAlphasDiffer)
+                        {
+                            const SimdReal rpV_S = blend(
+                                    one_S, fma(alpha_vdw_eff_S * SimdReal(lfac_vdw[i]), sigma_pow_S[i], rp_S),
+                                    computeState_S);
+                            const SimdReal cbrtV_S = cbrt(rpV_S);
+                            rpinvV_S               = inv(rpV_S);
+                            rinvV_S                = invsqrt(cbrtV_S);
+                            rV_S                   = cbrtV_S * rinvV_S;
+                        }
+                        else
+                        {
+                            /* We can avoid one expensive root and one inversion */
+                            rpinvV_S = rpinvC_S;
+                            rinvV_S  = rinvC_S;
+                            rV_S     = rC_S;
+                        }
+                    }
+                    else
+                    {
+                        rpinvC_S = one_S;
+                        rinvC_S  = rinv_S;
+                        rC_S     = r_S;
+
+                        rpinvV_S = one_S;
+                        rinvV_S  = rinv_S;
+                        rV_S     = r_S;
+                    }
+
+                    /* Only process the coulomb interactions if we have charges
+                     * and if we are within the cutoff.
                      */
-                    VV *= half;
+                    const SimdBool computeElec_S =
+                            computeState_S && haveElec_S
+                            && (elecInteractionTypeIsEwald ? (r_S < rcoulomb_S) : (rC_S < rcoulomb_S));
+
+                    SimdReal vCoul_S, fScalC_S;
+                    if (elecInteractionTypeIsEwald)
+                    {
+                        vCoul_S  = qq_S[i] * (rinvC_S - sh_ewald_S);
+                        fScalC_S = qq_S[i] * rinvC_S;
+                    }
+                    else
+                    {
+                        const SimdReal krfrsqC_S = krf_S * rC_S * rC_S;
+                        vCoul_S                  = qq_S[i] * (rinvC_S + krfrsqC_S - crf_S);
+                        fScalC_S                 = qq_S[i] * fnma(SimdReal(two), krfrsqC_S, rinvC_S);
+                    }
+                    vCoul_S  = selectByMask(vCoul_S, computeElec_S);
+                    fScalC_S = selectByMask(fScalC_S, computeElec_S);
+
+                    /* Only process the VDW interactions if we have
+                     * some non-zero parameters and if we are within the cutoff.
+                     */
+                    const SimdBool computeVdw_S =
+                            computeState_S && haveVdw_S
+                            && (vdwInteractionTypeIsEwald ? (r_S < rvdw_S) : (rV_S < rvdw_S));
+
+                    SimdReal rinv6_S;
+                    if (softCoreTreatment == SoftCoreTreatment::RPower6)
+                    {
+                        rinv6_S = rpinvV_S;
+                    }
+                    else
+                    {
+                        const SimdReal rinv2_S = rinvV_S * rinvV_S;
+                        rinv6_S                = rinv2_S * rinv2_S * rinv2_S;
+                    }
+                    const SimdReal vVdw6_S  = c6_S[i] * rinv6_S;
+                    const SimdReal vVdw12_S = c12_S[i] * rinv6_S * rinv6_S;
+
+                    SimdReal vVdw_S = fma(fma(c12_S[i], repulsionShift_S, vVdw12_S), SimdReal(onetwelfth),
+                                          -fma(c6_S[i], dispersionShift_S, vVdw6_S) * SimdReal(onesixth));
+                    SimdReal fScalV_S = vVdw12_S - vVdw6_S;
+
+                    if (vdwInteractionTypeIsEwald)
+                    {
+                        /* Subtract the grid potential at the cut-off */
+                        vVdw_S = fma(c6grid_S[i] * sh_lj_ewald_S, SimdReal(onesixth), vVdw_S);
+                    }
+
+                    if (vdwModifierIsPotSwitch)
+                    {
+                        const SimdReal d_S  = max(rV_S - rvdw_switch_S, zero_S);
+                        const SimdReal d2_S = d_S * d_S;
+                        const SimdReal sw_S =
+                                fma(d2_S * d_S, fma(d_S, fma(d_S, vdw_swV5_S, vdw_swV4_S), vdw_swV3_S), one_S);
+                        const SimdReal dsw_S =
+                                d2_S * fma(d_S, fma(d_S, vdw_swF4_S, vdw_swF3_S), vdw_swF2_S);
+
+                        fScalV_S = fnma(rV_S * vVdw_S, dsw_S, fScalV_S * sw_S);
+                        vVdw_S   = vVdw_S * sw_S;
+                    }
+                    vVdw_S   = selectByMask(vVdw_S, computeVdw_S);
+                    fScalV_S = selectByMask(fScalV_S, computeVdw_S);
+
+                    /* fScalC (and fScalV) now contain: dV/drC * rC
+                     * Now we multiply by rC^-p, so it will be: dV/drC * rC^1-p
+                     * Further down we first multiply by r^p-2 and then by
+                     * the vector r, which in total gives: dV/drC * (r/rC)^1-p
+                     */
+                    fScalC_S = fScalC_S * rpinvC_S;
+                    fScalV_S = fScalV_S * rpinvV_S;
+
+                    /* Assemble A and B states */
+                    const SimdReal lfc_S(LFC[i]);
+                    const SimdReal lfv_S(LFV[i]);
+                    const SimdReal dlf_S(DLF[i]);
+
+                    vctot_S = fma(lfc_S, vCoul_S, vctot_S);
+                    vvtot_S = fma(lfv_S, vVdw_S, vvtot_S);
+
+                    fscal_S = fma(fma(lfc_S, fScalC_S, lfv_S * fScalV_S), rpm2_S, fscal_S);
+
+                    dvdl_coul_S = fma(vCoul_S, dlf_S, dvdl_coul_S);
+                    dvdl_vdw_S  = fma(vVdw_S, dlf_S, dvdl_vdw_S);
+                    if (useSoftCore)
+                    {
+                        dvdl_coul_S = fma(lfc_S * alpha_coul_eff_S * SimdReal(dlfac_coul[i]),
+                                          fScalC_S * sigma_pow_S[i], dvdl_coul_S);
+                        dvdl_vdw_S  = fma(lfv_S * alpha_vdw_eff_S * SimdReal(dlfac_vdw[i]),
+                                         fScalV_S * sigma_pow_S[i], dvdl_vdw_S);
+                    }
                 }
 
-                for (int i = 0; i < NSTATES; i++)
+                const SimdReal selfFactor_S = load<SimdReal>(selfFactor);
+
+                if (!elecInteractionTypeIsEwald && anyTrue(excluded_S))
                 {
-                    const real c6grid = nbfp_grid[tj[i]];
-                    vvtot += LFV[i] * c6grid * VV;
-                    Fscal += LFV[i] * c6grid * FF;
-                    dvdl_vdw += (DLF[i] * c6grid) * VV;
+                    /* For excluded pairs, which are only in this pair list when
+                     * using the Verlet scheme, we don't use soft-core.
+                     * As there is no singularity, there is no need for soft-core.
+                     */
+                    const SimdReal FF_S = selectByMask(SimdReal(-two) * krf_S, excluded_S);
+                    const SimdReal VV_S =
+                            selectByMask(selfFactor_S * fms(krf_S, rsq_S, crf_S), excluded_S);
+
+                    for (int i = 0; i < c_numStates; i++)
+                    {
+                        const SimdReal lfcqq_S = SimdReal(LFC[i]) * qq_S[i];
+                        vctot_S                = fma(lfcqq_S, VV_S, vctot_S);
+                        fscal_S                = fma(lfcqq_S, FF_S, fscal_S);
+                        dvdl_coul_S            = fma(SimdReal(DLF[i]) * qq_S[i], VV_S, dvdl_coul_S);
+                    }
                 }
-            }
 
-            if (doForces)
-            {
-                const real tx = Fscal * dx;
-                const real ty = Fscal * dy;
-                const real tz = Fscal * dz;
-                fix           = fix + tx;
-                fiy           = fiy + ty;
-                fiz           = fiz + tz;
-                /* OpenMP atomics are expensive, but this kernels is also
-                 * expensive, so we can take this hit, instead of using
-                 * thread-local output buffers and extra reduction.
-                 *
-                 * All the OpenMP regions in this file are trivial and should
-                 * not throw, so no need for try/catch.
-                 */
-#pragma omp atomic
-                f[j3] -= tx;
-#pragma omp atomic
-                f[j3 + 1] -= ty;
-#pragma omp atomic
-                f[j3 + 2] -= tz;
-            }
-        }
+                if (elecInteractionTypeIsEwald)
+                {
+                    /* See comment in the plain-C kernel. When using Ewald interactions
+                     * we subtract the reciprocal-space Ewald component here which made
+                     * it possible to apply the free energy interaction to 1/r above.
+                     */
+                    const SimdBool computeElecCorr_S = withinCutoff_S && (r_S < rcoulomb_S);
+
+                    const SimdReal  ewrt_S   = selectByMask(r_S, computeElecCorr_S) * coulombTableScale_S;
+                    const SimdInt32 ewitab_S = cvttR2I(ewrt_S);
+                    const SimdReal  eweps_S  = ewrt_S - trunc(ewrt_S);
+                    SimdReal        tabF0_S, tabF1_S, tabV_S, dum_S;
+                    gatherLoadUBySimdIntTranspose<1>(tab_ewald_F, ewitab_S, &tabF0_S, &tabF1_S);
+                    gatherLoadUBySimdIntTranspose<1>(tab_ewald_V, ewitab_S, &tabV_S, &dum_S);
+                    SimdReal f_lr_S = fma(eweps_S, tabF1_S - tabF0_S, tabF0_S);
+                    SimdReal v_lr_S = fnma(coulombTableScaleInvHalf_S * eweps_S, tabF0_S + f_lr_S, tabV_S);
+                    f_lr_S          = selectByMask(f_lr_S * rinv_S, computeElecCorr_S);
+                    /* A self-interaction occurs twice, scale it down by 50% to only include it once */
+                    v_lr_S = selectByMask(v_lr_S * selfFactor_S, computeElecCorr_S);
+
+                    for (int i = 0; i < c_numStates; i++)
+                    {
+                        const SimdReal lfcqq_S = SimdReal(LFC[i]) * qq_S[i];
+                        vctot_S                = fnma(lfcqq_S, v_lr_S, vctot_S);
+                        fscal_S                = fnma(lfcqq_S, f_lr_S, fscal_S);
+                        dvdl_coul_S            = fnma(SimdReal(DLF[i]) * qq_S[i], v_lr_S, dvdl_coul_S);
+                    }
+                }
 
-        /* The atomics below are expensive with many OpenMP threads.
-         * Here unperturbed i-particles will usually only have a few
-         * (perturbed) j-particles in the list. Thus with a buffered list
-         * we can skip a significant number of i-reductions with a check.
-         */
-        if (npair_within_cutoff > 0)
-        {
-            if (doForces)
-            {
-#pragma omp atomic
-                f[ii3] += fix;
-#pragma omp atomic
-                f[ii3 + 1] += fiy;
-#pragma omp atomic
-                f[ii3 + 2] += fiz;
-            }
-            if (doShiftForces)
-            {
-#pragma omp atomic
-                fshift[is3] += fix;
-#pragma omp atomic
-                fshift[is3 + 1] += fiy;
-#pragma omp atomic
-                fshift[is3 + 2] += fiz;
+                if (vdwInteractionTypeIsEwald)
+                {
+                    /* See comment in the plain-C kernel. When using LJ-Ewald interactions
+                     * we subtract the reciprocal-space Ewald component here which made
+                     * it possible to apply the free energy interaction to r^-6 above.
+                     */
+                    const SimdBool computeVdwCorr_S = withinCutoff_S && (r_S < rvdw_S);
+
+                    const SimdReal  rs_S   = selectByMask(r_S, computeVdwCorr_S) * vdwTableScale_S;
+                    const SimdInt32 ri_S   = cvttR2I(rs_S);
+                    const SimdReal  frac_S = rs_S - trunc(rs_S);
+                    SimdReal        tabF0_S, tabF1_S, tabV_S, dum_S;
+                    gatherLoadUBySimdIntTranspose<1>(tab_ewald_F_lj, ri_S, &tabF0_S, &tabF1_S);
+                    gatherLoadUBySimdIntTranspose<1>(tab_ewald_V_lj, ri_S, &tabV_S, &dum_S);
+                    const SimdReal f_lr_S = fma(frac_S, tabF1_S - tabF0_S, tabF0_S);
+                    /* TODO: Currently the Ewald LJ table does not contain
+                     * the factor 1/6, we should add this.
+                     */
+                    const SimdReal FF_S = selectByMask(f_lr_S * rinv_S * SimdReal(onesixth), computeVdwCorr_S);
+                    const SimdReal VV_S = selectByMask(
+                            fnma(vdwTableScaleInvHalf_S * frac_S, tabF0_S + f_lr_S, tabV_S)
+                                    * SimdReal(onesixth) * selfFactor_S,
+                            computeVdwCorr_S);
+
+                    for (int i = 0; i < c_numStates; i++)
+                    {
+                        const SimdReal lfvc6grid_S = SimdReal(LFV[i]) * c6grid_S[i];
+                        vvtot_S                    = fma(lfvc6grid_S, VV_S, vvtot_S);
+                        fscal_S                    = fma(lfvc6grid_S, FF_S, fscal_S);
+                        dvdl_vdw_S = fma(SimdReal(DLF[i]) * c6grid_S[i], VV_S, dvdl_vdw_S);
+                    }
+                }
+
+                if (doForces)
+                {
+                    const SimdReal tx_S = fscal_S * dx_S;
+                    const SimdReal ty_S = fscal_S * dy_S;
+                    const SimdReal tz_S = fscal_S * dz_S;
+                    fix_S               = fix_S + tx_S;
+                    fiy_S               = fiy_S + ty_S;
+                    fiz_S               = fiz_S + tz_S;
+
+                    store(fjBuffer[XX], tx_S);
+                    store(fjBuffer[YY], ty_S);
+                    store(fjBuffer[ZZ], tz_S);
+                    for (int s = 0; s < numLanes; s++)
+                    {
+                        const int j3 = 3 * jAtom[s];
+                        /* See the plain-C kernel for why we use atomics here */
+#    pragma omp atomic
+                        f[j3] -= fjBuffer[XX][s];
+#    pragma omp atomic
+                        f[j3 + 1] -= fjBuffer[YY][s];
+#    pragma omp atomic
+                        f[j3 + 2] -= fjBuffer[ZZ][s];
+                    }
+                }
             }
-            if (doPotential)
+
+            /* Skip the expensive i-reductions when there are no pairs within the cut-off */
+            if (haveInteractionWithinCutoff)
             {
-                int ggid = gid[n];
-#pragma omp atomic
-                Vc[ggid] += vctot;
-#pragma omp atomic
-                Vv[ggid] += vvtot;
+                if (doForces || doShiftForces)
+                {
+                    const real fix = reduce(fix_S);
+                    const real fiy = reduce(fiy_S);
+                    const real fiz = reduce(fiz_S);
+                    if (doForces)
+                    {
+#    pragma omp atomic
+                        f[ii3] += fix;
+#    pragma omp atomic
+                        f[ii3 + 1] += fiy;
+#    pragma omp atomic
+                        f[ii3 + 2] += fiz;
+                    }
+                    if (doShiftForces)
+                    {
+#    pragma omp atomic
+                        fshift[is3] += fix;
+#    pragma omp atomic
+                        fshift[is3 + 1] += fiy;
+#    pragma omp atomic
+                        fshift[is3 + 2] += fiz;
+                    }
+                }
+                if (doPotential)
+                {
+                    const real vctot = reduce(vctot_S);
+                    const real vvtot = reduce(vvtot_S);
+#    pragma omp atomic
+                    Vc[energyGroupPair] += vctot;
+#    pragma omp atomic
+                    Vv[energyGroupPair] += vvtot;
+                }
             }
         }
     }
 
-#pragma omp atomic
+    const real dvdl_coul = reduce(dvdl_coul_S);
+    const real dvdl_vdw  = reduce(dvdl_vdw_S);
+#    pragma omp atomic
     dvdl[efptCOUL] += dvdl_coul;
-#pragma omp atomic
+#    pragma omp atomic
     dvdl[efptVDW] += dvdl_vdw;
 
     /* Estimate flops, average for free energy stuff:
      * 12  flops per outer iteration
      * 150 flops per inner iteration
      */
-#pragma omp atomic
-    inc_nrnb(nrnb, eNR_NBKERNEL_FREE_ENERGY, nlist->nri * 12 + nlist->jindex[nri] * 150);
+#    pragma omp atomic
+    inc_nrnb(nrnb, eNR_NBKERNEL_FREE_ENERGY, numIAtoms * 12 + nlist.numPairs * 150);
 }
 
-typedef void (*KernelFunction)(const t_nblist* gmx_restrict nlist,
+#endif // GMX_SIMD_HAVE_REAL && GMX_SIMD_HAVE_GATHER_LOADU_BYSIMDINT_TRANSPOSE_REAL
+
+typedef void (*KernelFunction)(const NbnxnPairlistFep&    nlist,
+                               gmx::ArrayRef<const int>   atomIndices,
                                rvec* gmx_restrict         xx,
                                gmx::ForceWithShiftForces* forceWithShiftForces,
                                const t_forcerec* gmx_restrict fr,
@@ -877,55 +1707,88 @@ typedef void (*KernelFunction)(const t_nblist* gmx_restrict nlist,
                                nb_kernel_data_t* gmx_restrict kernel_data,
                                t_nrnb* gmx_restrict nrnb);
 
-template<SoftCoreTreatment softCoreTreatment, bool scLambdasOrAlphasDiffer, bool vdwInteractionTypeIsEwald, bool elecInteractionTypeIsEwald>
+//! Whether we have a SIMD version of the kernel, note that it does not support r-power 48
+#if GMX_SIMD_HAVE_REAL && GMX_SIMD_HAVE_GATHER_LOADU_BYSIMDINT_TRANSPOSE_REAL
+static constexpr bool c_haveSimdKernel = true;
+#else
+static constexpr bool c_haveSimdKernel = false;
+#endif
+
+//! Selects the plain-C kernel, or the SIMD kernel through the specialization below
+template<bool useSimd, SoftCoreTreatment softCoreTreatment, bool scLambdasOrAlphasDiffer, bool vdwInteractionTypeIsEwald, bool elecInteractionTypeIsEwald, bool vdwModifierIsPotSwitch>
+struct KernelSelector
+{
+    //! Returns the kernel function
+    static KernelFunction kernel()
+    {
+        return (nb_free_energy_kernel<softCoreTreatment, scLambdasOrAlphasDiffer, vdwInteractionTypeIsEwald,
+                                      elecInteractionTypeIsEwald, vdwModifierIsPotSwitch>);
+    }
+};
+
+#if GMX_SIMD_HAVE_REAL && GMX_SIMD_HAVE_GATHER_LOADU_BYSIMDINT_TRANSPOSE_REAL
+//! Selects the SIMD kernel
+template<SoftCoreTreatment softCoreTreatment, bool scLambdasOrAlphasDiffer, bool vdwInteractionTypeIsEwald, bool elecInteractionTypeIsEwald, bool vdwModifierIsPotSwitch>
+struct KernelSelector<true, softCoreTreatment, scLambdasOrAlphasDiffer, vdwInteractionTypeIsEwald, elecInteractionTypeIsEwald, vdwModifierIsPotSwitch>
+{
+    //! Returns the kernel function
+    static KernelFunction kernel()
+    {
+        return (nb_free_energy_kernel_simd<softCoreTreatment, scLambdasOrAlphasDiffer, vdwInteractionTypeIsEwald,
+                                           elecInteractionTypeIsEwald, vdwModifierIsPotSwitch>);
+    }
+};
+#endif
+
+template<bool useSimd, SoftCoreTreatment softCoreTreatment, bool scLambdasOrAlphasDiffer, bool vdwInteractionTypeIsEwald, bool elecInteractionTypeIsEwald>
 static KernelFunction dispatchKernelOnVdwModifier(const bool vdwModifierIsPotSwitch)
 {
     if (vdwModifierIsPotSwitch)
     {
-        return (nb_free_energy_kernel<softCoreTreatment, scLambdasOrAlphasDiffer,
-                                      vdwInteractionTypeIsEwald, elecInteractionTypeIsEwald, true>);
+        return (KernelSelector<useSimd, softCoreTreatment, scLambdasOrAlphasDiffer, vdwInteractionTypeIsEwald,
+                               elecInteractionTypeIsEwald, true>::kernel());
     }
     else
     {
-        return (nb_free_energy_kernel<softCoreTreatment, scLambdasOrAlphasDiffer,
-                                      vdwInteractionTypeIsEwald, elecInteractionTypeIsEwald, false>);
+        return (KernelSelector<useSimd, softCoreTreatment, scLambdasOrAlphasDiffer, vdwInteractionTypeIsEwald,
+                               elecInteractionTypeIsEwald, false>::kernel());
     }
 }
 
-template<SoftCoreTreatment softCoreTreatment, bool scLambdasOrAlphasDiffer, bool vdwInteractionTypeIsEwald>
+template<bool useSimd, SoftCoreTreatment softCoreTreatment, bool scLambdasOrAlphasDiffer, bool vdwInteractionTypeIsEwald>
 static KernelFunction dispatchKernelOnElecInteractionType(const bool elecInteractionTypeIsEwald,
                                                           const bool vdwModifierIsPotSwitch)
 {
     if (elecInteractionTypeIsEwald)
     {
-        return (dispatchKernelOnVdwModifier<softCoreTreatment, scLambdasOrAlphasDiffer, vdwInteractionTypeIsEwald, true>(
+        return (dispatchKernelOnVdwModifier<useSimd, softCoreTreatment, scLambdasOrAlphasDiffer, vdwInteractionTypeIsEwald, true>(
                 vdwModifierIsPotSwitch));
     }
     else
     {
-        return (dispatchKernelOnVdwModifier<softCoreTreatment, scLambdasOrAlphasDiffer, vdwInteractionTypeIsEwald, false>(
+        return (dispatchKernelOnVdwModifier<useSimd, softCoreTreatment, scLambdasOrAlphasDiffer, vdwInteractionTypeIsEwald, false>(
                 vdwModifierIsPotSwitch));
     }
 }
 
-template<SoftCoreTreatment softCoreTreatment, bool scLambdasOrAlphasDiffer>
+template<bool useSimd, SoftCoreTreatment softCoreTreatment, bool scLambdasOrAlphasDiffer>
 static KernelFunction dispatchKernelOnVdwInteractionType(const bool vdwInteractionTypeIsEwald,
                                                          const bool elecInteractionTypeIsEwald,
                                                          const bool vdwModifierIsPotSwitch)
 {
     if (vdwInteractionTypeIsEwald)
     {
-        return (dispatchKernelOnElecInteractionType<softCoreTreatment, scLambdasOrAlphasDiffer, true>(
+        return (dispatchKernelOnElecInteractionType<useSimd, softCoreTreatment, scLambdasOrAlphasDiffer, true>(
                 elecInteractionTypeIsEwald, vdwModifierIsPotSwitch));
     }
     else
     {
-        return (dispatchKernelOnElecInteractionType<softCoreTreatment, scLambdasOrAlphasDiffer, false>(
+        return (dispatchKernelOnElecInteractionType<useSimd, softCoreTreatment, scLambdasOrAlphasDiffer, false>(
                 elecInteractionTypeIsEwald, vdwModifierIsPotSwitch));
     }
 }
 
-template<SoftCoreTreatment softCoreTreatment>
+template<bool useSimd, SoftCoreTreatment softCoreTreatment>
 static KernelFunction dispatchKernelOnScLambdasOrAlphasDifference(const bool scLambdasOrAlphasDiffer,
                                                                   const bool vdwInteractionTypeIsEwald,
                                                                   const bool elecInteractionTypeIsEwald,
@@ -933,44 +1796,67 @@ static KernelFunction dispatchKernelOnScLambdasOrAlphasDifference(const bool scL
 {
     if (scLambdasOrAlphasDiffer)
     {
-        return (dispatchKernelOnVdwInteractionType<softCoreTreatment, true>(
+        return (dispatchKernelOnVdwInteractionType<useSimd, softCoreTreatment, true>(
                 vdwInteractionTypeIsEwald, elecInteractionTypeIsEwald, vdwModifierIsPotSwitch));
     }
     else
     {
-        return (dispatchKernelOnVdwInteractionType<softCoreTreatment, false>(
+        return (dispatchKernelOnVdwInteractionType<useSimd, softCoreTreatment, false>(
                 vdwInteractionTypeIsEwald, elecInteractionTypeIsEwald, vdwModifierIsPotSwitch));
     }
 }
 
-static KernelFunction dispatchKernel(const bool        scLambdasOrAlphasDiffer,
-                                     const bool        vdwInteractionTypeIsEwald,
-                                     const bool        elecInteractionTypeIsEwald,
-                                     const bool        vdwModifierIsPotSwitch,
-                                     const t_forcerec* fr)
+template<bool useSimd>
+static KernelFunction dispatchKernelOnSoftCoreTreatment(const bool        scLambdasOrAlphasDiffer,
+                                                        const bool        vdwInteractionTypeIsEwald,
+                                                        const bool        elecInteractionTypeIsEwald,
+                                                        const bool        vdwModifierIsPotSwitch,
+                                                        const t_forcerec* fr)
 {
     if (fr->sc_alphacoul == 0 && fr->sc_alphavdw == 0)
     {
-        return (dispatchKernelOnScLambdasOrAlphasDifference<SoftCoreTreatment::None>(
+        return (dispatchKernelOnScLambdasOrAlphasDifference<useSimd, SoftCoreTreatment::None>(
                 scLambdasOrAlphasDiffer, vdwInteractionTypeIsEwald, elecInteractionTypeIsEwald,
                 vdwModifierIsPotSwitch));
     }
     else if (fr->sc_r_power == 6.0_real)
     {
-        return (dispatchKernelOnScLambdasOrAlphasDifference<SoftCoreTreatment::RPower6>(
+        return (dispatchKernelOnScLambdasOrAlphasDifference<useSimd, SoftCoreTreatment::RPower6>(
                 scLambdasOrAlphasDiffer, vdwInteractionTypeIsEwald, elecInteractionTypeIsEwald,
                 vdwModifierIsPotSwitch));
     }
     else
     {
-        return (dispatchKernelOnScLambdasOrAlphasDifference<SoftCoreTreatment::RPower48>(
+        /* The SIMD kernel does not support r-power 48, which needs double precision */
+        return (dispatchKernelOnScLambdasOrAlphasDifference<false, SoftCoreTreatment::RPower48>(
                 scLambdasOrAlphasDiffer, vdwInteractionTypeIsEwald, elecInteractionTypeIsEwald,
                 vdwModifierIsPotSwitch));
     }
 }
 
+static KernelFunction dispatchKernel(const bool        scLambdasOrAlphasDiffer,
+                                     const bool        vdwInteractionTypeIsEwald,
+                                     const bool        elecInteractionTypeIsEwald,
+                                     const bool        vdwModifierIsPotSwitch,
+                                     const t_forcerec* fr)
+{
+    if (c_haveSimdKernel && fr->use_simd_kernels)
+    {
+        return (dispatchKernelOnSoftCoreTreatment<true>(scLambdasOrAlphasDiffer, vdwInteractionTypeIsEwald,
+                                                        elecInteractionTypeIsEwald,
+                                                        vdwModifierIsPotSwitch, fr));
+    }
+    else
+    {
+        return (dispatchKernelOnSoftCoreTreatment<false>(scLambdasOrAlphasDiffer, vdwInteractionTypeIsEwald,
+                                                         elecInteractionTypeIsEwald,
+                                                         vdwModifierIsPotSwitch, fr));
+    }
+}
+
 
-void gmx_nb_free_energy_kernel(const t_nblist*            nlist,
+void gmx_nb_free_energy_kernel(const NbnxnPairlistFep&    nlist,
+                               gmx::ArrayRef<const int>   atomIndices,
                                rvec*                      xx,
                                gmx::ForceWithShiftForces* ff,
                                const t_forcerec*          fr,
@@ -978,7 +1864,8 @@ void gmx_nb_free_energy_kernel(const t_nblist*            nlist,
                                nb_kernel_data_t*          kernel_data,
                                t_nrnb*                    nrnb)
 {
-    GMX_ASSERT(EEL_PME_EWALD(fr->ic->eeltype) || fr->ic->eeltype == eelCUT || EEL_RF(fr->ic->eeltype),
+    GMX_ASSERT(EEL_PME_EWALD(fr->ic->eeltype) || fr->ic->eeltype == eelCUT || EEL_RF(fr->ic->eeltype)
+                       || fr->ic->eeltype == eelFMM,
                "Unsupported eeltype with free energy");
 
     const bool vdwInteractionTypeIsEwald  = (EVDW_PME(fr->ic->vdwtype));
@@ -1003,5 +1890,5 @@ void gmx_nb_free_energy_kernel(const t_nblist*            nlist,
     }
     KernelFunction kernelFunc = dispatchKernel(scLambdasOrAlphasDiffer, vdwInteractionTypeIsEwald,
                                                elecInteractionTypeIsEwald, vdwModifierIsPotSwitch, fr);
-    kernelFunc(nlist, xx, ff, fr, mdatoms, kernel_data, nrnb);
+    kernelFunc(nlist, atomIndices, xx, ff, fr, mdatoms, kernel_data, nrnb);
 }
@@ -38,19 +38,65 @@
 #ifndef _nb_free_energy_h_
 #define _nb_free_energy_h_
 
+#include <vector>
+
 #include "gromacs/gmxlib/nrnb.h"
 #include "gromacs/gmxlib/nonbonded/nb_kernel.h"
 #include "gromacs/math/vectypes.h"
 #include "gromacs/mdtypes/mdatom.h"
 #include "gromacs/mdtypes/nblist.h"
+#include "gromacs/utility/arrayref.h"
 
+struct nbnxn_fep_ci_t;
+struct NbnxnPairlistFep;
 struct t_forcerec;
 namespace gmx
 {
 class ForceWithShiftForces;
 }
 
-void gmx_nb_free_energy_kernel(const t_nblist* gmx_restrict nlist,
+/*! \brief Atom-pair lists for the i-atoms of one i-entry of a cluster-pair FEP list
+ *
+ * The pairlist is stored in cluster-pair format with atom-pair masks.
+ * The SIMD kernel streams the j-atoms directly from the cluster entries
+ * and their masks, but the plain-C reference kernel loops over i-atoms
+ * and their lists of j-atoms. For the latter we unpack one i-entry at
+ * a time into these small buffers, which stay in cache.
+ * As the kernels accumulate the energies per list, a new list is started
+ * when the energy-group pair changes. The buffers only grow, the caller
+ * should keep one object per thread alive over kernel calls.
+ */
+struct FepIEntryAtomPairs
+{
+    //! Unpacks i-entry \p ciEntry of \p nlist, atoms indices are taken from \p atomIndices
+    void unpack(const NbnxnPairlistFep&  nlist,
+                const nbnxn_fep_ci_t&    ciEntry,
+                gmx::ArrayRef<const int> atomIndices,
+                const t_mdatoms&         mdatoms);
+
+    //! The number of lists
+    int nri = 0;
+    //! The i-atom for each list
+    std::vector<int> iinr;
+    //! The energy-group pair index for each list
+    std::vector<int> gid;
+    //! The start of each list in jjnr, size nri + 1
+    std::vector<int> jindex;
+    //! The j-atoms
+    std::vector<int> jjnr;
+    //! Tells for each pair whether it is not excluded
+    std::vector<char> excl_fep;
+};
+
+/*! \brief Computes the perturbed non-bonded interactions in \p nlist
+ *
+ * The atom indices of the cluster-pair list entries are obtained
+ * through \p atomIndices, the grid atom indices of the pair search.
+ * The plain-C kernel unpacks the entries into kernel_data->atomPairs,
+ * which should be a different object for each thread.
+ */
+void gmx_nb_free_energy_kernel(const NbnxnPairlistFep&    nlist,
+                               gmx::ArrayRef<const int>   atomIndices,
                                rvec* gmx_restrict         xx,
                                gmx::ForceWithShiftForces* forceWithShiftForces,
                                const t_forcerec* gmx_restrict fr,
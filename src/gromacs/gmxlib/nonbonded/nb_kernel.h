@@ -44,6 +44,7 @@
 #include "gromacs/mdtypes/nblist.h"
 #include "gromacs/utility/real.h"
 
+struct FepIEntryAtomPairs;
 struct t_blocka;
 
 /* Structure to collect kernel data not available in forcerec or mdatoms structures.
@@ -56,6 +57,9 @@ typedef struct
     real*                  lambda;
     real*                  dvdl;
 
+    /* Buffer for unpacking FEP list entries, should be kept per thread */
+    struct FepIEntryAtomPairs* atomPairs;
+
     /* pointers to tables */
     t_forcetable* table_elec;
     t_forcetable* table_vdw;
@@ -0,0 +1,484 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2020, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests for the free-energy non-bonded kernels.
+ *
+ * The SIMD kernel is compared with the plain-C reference kernel
+ * on the same perturbed cluster-pair list. The unpacking of the
+ * cluster-pair list entries is compared with the atom-pair lists
+ * the pair search used to produce.
+ *
+ * \ingroup module_gmxlib
+ */
+#include "gmxpre.h"
+
+#include "gromacs/gmxlib/nonbonded/nb_free_energy.h"
+
+#include <cmath>
+
+#include <algorithm>
+#include <array>
+#include <memory>
+#include <tuple>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/ewald/ewald_utils.h"
+#include "gromacs/gmxlib/nrnb.h"
+#include "gromacs/gmxlib/nonbonded/nb_kernel.h"
+#include "gromacs/gmxlib/nonbonded/nonbonded.h"
+#include "gromacs/math/paddedvector.h"
+#include "gromacs/math/units.h"
+#include "gromacs/math/vectypes.h"
+#include "gromacs/mdlib/forcerec.h"
+#include "gromacs/mdtypes/forceoutput.h"
+#include "gromacs/mdtypes/forcerec.h"
+#include "gromacs/mdtypes/group.h"
+#include "gromacs/mdtypes/interaction_const.h"
+#include "gromacs/mdtypes/md_enums.h"
+#include "gromacs/mdtypes/mdatom.h"
+#include "gromacs/nbnxm/pairlist.h"
+#include "gromacs/pbcutil/ishift.h"
+#include "gromacs/utility/arrayref.h"
+
+#include "testutils/testasserts.h"
+
+namespace gmx
+{
+namespace test
+{
+namespace
+{
+
+//! The soft-core setups that are tested
+enum class SoftCoreSetup
+{
+    None,         //!< No soft-core
+    VdwOnly,      //!< Soft-core for VdW only, the default with sc-coul=no
+    CoulombAndVdw //!< Soft-core for both Coulomb and VdW
+};
+
+//! Test parameters: Coulomb type, soft-core setup and lambda
+using FepKernelTestParameters = std::tuple<int, SoftCoreSetup, real>;
+
+//! The number of atoms in the test system
+constexpr int c_numAtoms = 16;
+//! The number of atom types
+constexpr int c_numTypes = 3;
+//! The cut-off distance
+constexpr real c_cutoff = 1.0;
+
+/*! \brief Perturbed test system with a cluster-pair FEP list over all atom pairs
+ *
+ * The atoms are put on a distorted 4x2x2 lattice with spacing 0.35 nm,
+ * so all pairs are within, or somewhat beyond, the cut-off. Each atom is
+ * perturbed in charge and/or type, type 2 has no LJ interactions to test
+ * the soft-core default sigma. The pairs of some atoms are excluded.
+ */
+class FepTestSystem
+{
+public:
+    //! Sets up the system and the pair list
+    FepTestSystem() : fepList(PairlistType::Simple4x4)
+    {
+        x.resizeWithPadding(c_numAtoms);
+        for (int a = 0; a < c_numAtoms; a++)
+        {
+            const real spacing = 0.35;
+            x[a][XX]           = spacing * (a % 4) + 0.05 * std::sin(1.3 * a);
+            x[a][YY]           = spacing * ((a / 4) % 2) + 0.05 * std::cos(2.1 * a);
+            x[a][ZZ]           = spacing * (a / 8) + 0.04 * std::sin(0.7 * a + 1);
+
+            chargeA[a] = ((a % 2 == 0) ? 0.4 : -0.4);
+            chargeB[a] = ((a % 3 == 0) ? 0.0 : 0.6 * chargeA[a]);
+            typeA[a]   = a % 2;
+            typeB[a]   = ((a % 4 == 3) ? 2 : (a + 1) % 2);
+            energyGroup[a] = ((a % 3 == 0) ? 1 : 0);
+        }
+
+        const std::array<real, c_numTypes> sigma   = { 0.30, 0.25, 0.0 };
+        const std::array<real, c_numTypes> epsilon = { 0.6, 0.3, 0.0 };
+        for (int ti = 0; ti < c_numTypes; ti++)
+        {
+            for (int tj = 0; tj < c_numTypes; tj++)
+            {
+                const real sigmaIJ   = 0.5 * (sigma[ti] + sigma[tj]);
+                const real epsilonIJ = std::sqrt(epsilon[ti] * epsilon[tj]);
+                const real sigma6    = std::pow(sigmaIJ, 6);
+                // nbfp stores 6*C6 and 12*C12
+                C6(nbfp, c_numTypes, ti, tj)  = 6 * 4 * epsilonIJ * sigma6;
+                C12(nbfp, c_numTypes, ti, tj) = 12 * 4 * epsilonIJ * sigma6 * sigma6;
+            }
+        }
+
+        const int numClusters = c_numAtoms / fepList.na_ci;
+        for (int a = 0; a < c_numAtoms; a++)
+        {
+            atomIndices.push_back(a);
+        }
+        for (int ci = 0; ci < numClusters; ci++)
+        {
+            nbnxn_fep_ci_t ciEntry;
+            ciEntry.ci           = ci;
+            ciEntry.shift        = CENTRAL;
+            ciEntry.cj_ind_start = fepList.cj.size();
+            ciEntry.numPairs     = 0;
+            for (int cj = ci; cj < numClusters; cj++)
+            {
+                nbnxn_fep_cj_t cjEntry;
+                cjEntry.cj       = cj;
+                cjEntry.pairMask = 0;
+                cjEntry.excl     = 0;
+                for (int i = 0; i < fepList.na_ci; i++)
+                {
+                    for (int j = 0; j < fepList.na_cj; j++)
+                    {
+                        const int ai = ci * fepList.na_ci + i;
+                        const int aj = cj * fepList.na_cj + j;
+                        // Include the self-pairs, as the nbnxm search does
+                        if (aj < ai)
+                        {
+                            continue;
+                        }
+                        const unsigned int bit = 1U << (i * fepList.na_cj + j);
+                        cjEntry.pairMask |= bit;
+                        // Exclude the self-pairs and the bonded neighbors along x
+                        const bool isExcluded = (ai == aj || (aj == ai + 1 && ai % 4 != 3));
+                        if (!isExcluded)
+                        {
+                            cjEntry.excl |= bit;
+                        }
+                        ciEntry.numPairs++;
+                    }
+                }
+                fepList.cj.push_back(cjEntry);
+            }
+            ciEntry.cj_ind_end = fepList.cj.size();
+            fepList.numPairs += ciEntry.numPairs;
+            fepList.ci.push_back(ciEntry);
+        }
+
+        for (int s = 0; s < SHIFTS; s++)
+        {
+            clear_rvec(shiftVec[s]);
+        }
+    }
+
+    //! The coordinates
+    PaddedVector<RVec> x;
+    //! Charges in state A
+    std::array<real, c_numAtoms> chargeA;
+    //! Charges in state B
+    std::array<real, c_numAtoms> chargeB;
+    //! Atom types in state A
+    std::array<int, c_numAtoms> typeA;
+    //! Atom types in state B
+    std::array<int, c_numAtoms> typeB;
+    //! Energy-group indices, only used with more than one energy group
+    std::array<unsigned short, c_numAtoms> energyGroup;
+    //! The LJ parameter matrix
+    std::array<real, 2 * c_numTypes * c_numTypes> nbfp;
+    //! The shift vectors
+    rvec shiftVec[SHIFTS];
+    //! The atom indices of the list clusters
+    std::vector<int> atomIndices;
+    //! The perturbed pair list
+    NbnxnPairlistFep fepList;
+};
+
+//! The output of a free-energy kernel call
+struct FepKernelOutput
+{
+    //! The forces
+    PaddedVector<RVec> force;
+    //! The shift forces
+    std::vector<RVec> shiftForce;
+    //! The Coulomb energy per energy-group pair
+    std::vector<real> energyCoulomb;
+    //! The VdW energy per energy-group pair
+    std::vector<real> energyVdw;
+    //! The dV/dlambda components
+    std::array<real, efptNR> dvdl = {};
+};
+
+//! Test fixture for comparing the free-energy kernels
+class FepKernelTest : public ::testing::TestWithParam<FepKernelTestParameters>
+{
+protected:
+    //! Sets up the interaction parameters according to the test parameters
+    FepKernelTest()
+    {
+        int           coulombType;
+        SoftCoreSetup softCoreSetup;
+        std::tie(coulombType, softCoreSetup, lambda_) = GetParam();
+
+        ic_.eeltype          = coulombType;
+        ic_.coulomb_modifier = eintmodPOTSHIFT;
+        ic_.rcoulomb         = c_cutoff;
+        ic_.epsfac           = ONE_4PI_EPS0;
+        if (EEL_RF(coulombType))
+        {
+            ic_.epsilon_rf = 0;
+            ic_.k_rf       = 0.5 / (c_cutoff * c_cutoff * c_cutoff);
+            ic_.c_rf       = 1 / c_cutoff + ic_.k_rf * c_cutoff * c_cutoff;
+        }
+        else
+        {
+            ic_.ewaldcoeff_q       = calc_ewaldcoeff_q(c_cutoff, 1e-5);
+            ic_.sh_ewald           = std::erfc(ic_.ewaldcoeff_q * c_cutoff) / c_cutoff;
+            ic_.coulombEwaldTables = std::make_unique<EwaldCorrectionTables>();
+            init_interaction_const_tables(nullptr, &ic_);
+        }
+        ic_.vdwtype                = evdwCUT;
+        ic_.vdw_modifier           = eintmodPOTSHIFT;
+        ic_.rvdw                   = c_cutoff;
+        ic_.dispersion_shift.cpot  = -1.0 / std::pow(c_cutoff, 6);
+        ic_.repulsion_shift.cpot   = -1.0 / std::pow(c_cutoff, 12);
+
+        fr_.ic            = &ic_;
+        fr_.ntype         = c_numTypes;
+        fr_.nbfp          = system_.nbfp.data();
+        fr_.shift_vec     = system_.shiftVec;
+        fr_.sc_alphavdw   = (softCoreSetup == SoftCoreSetup::None ? 0 : 0.5);
+        fr_.sc_alphacoul  = (softCoreSetup == SoftCoreSetup::CoulombAndVdw ? 0.5 : 0);
+        fr_.sc_power      = 1;
+        fr_.sc_r_power    = 6;
+        fr_.sc_sigma6_def = std::pow(0.3, 6);
+        fr_.sc_sigma6_min = std::pow(0.3, 6);
+
+        mdatoms_          = {};
+        mdatoms_.nenergrp = 1;
+        mdatoms_.chargeA  = system_.chargeA.data();
+        mdatoms_.chargeB  = system_.chargeB.data();
+        mdatoms_.typeA    = system_.typeA.data();
+        mdatoms_.typeB    = system_.typeB.data();
+    }
+
+    //! Runs the reference or SIMD kernel, the selection is done with use_simd_kernels
+    FepKernelOutput runKernel(bool useSimdKernel)
+    {
+        FepKernelOutput output;
+        output.force.resizeWithPadding(c_numAtoms);
+        std::fill(output.force.begin(), output.force.end(), RVec{ 0, 0, 0 });
+        output.shiftForce.resize(SHIFTS, { 0, 0, 0 });
+        output.energyCoulomb.resize(mdatoms_.nenergrp * mdatoms_.nenergrp, 0);
+        output.energyVdw.resize(mdatoms_.nenergrp * mdatoms_.nenergrp, 0);
+
+        ForceWithShiftForces forceWithShiftForces(output.force.arrayRefWithPadding(), true,
+                                                  output.shiftForce);
+
+        // The vdW lambda differs from the Coulomb lambda, as with separate lambda vectors
+        std::array<real, efptNR> lambda = {};
+        lambda[efptCOUL]                = lambda_;
+        lambda[efptVDW]                 = 1 - lambda_;
+
+        nb_kernel_data_t kernelData;
+        kernelData.flags = GMX_NONBONDED_DO_FORCE | GMX_NONBONDED_DO_SHIFTFORCE | GMX_NONBONDED_DO_POTENTIAL;
+        kernelData.exclusions     = nullptr;
+        kernelData.lambda         = lambda.data();
+        kernelData.dvdl           = output.dvdl.data();
+        kernelData.atomPairs      = &atomPairs_;
+        kernelData.table_elec     = nullptr;
+        kernelData.table_vdw      = nullptr;
+        kernelData.table_elec_vdw = nullptr;
+        kernelData.energygrp_elec = output.energyCoulomb.data();
+        kernelData.energygrp_vdw  = output.energyVdw.data();
+
+        fr_.use_simd_kernels = useSimdKernel;
+
+        t_nrnb nrnb;
+
+        gmx_nb_free_energy_kernel(system_.fepList, system_.atomIndices, as_rvec_array(system_.x.data()),
+                                  &forceWithShiftForces, &fr_, &mdatoms_, &kernelData, &nrnb);
+
+        return output;
+    }
+
+    //! The test system
+    FepTestSystem system_;
+    //! The interaction constants
+    interaction_const_t ic_;
+    //! The force record
+    t_forcerec fr_;
+    //! The atom data
+    t_mdatoms mdatoms_;
+    //! The lambda value for Coulomb, VdW uses 1 - lambda
+    real lambda_;
+    //! The unpacking buffer, reused over kernel calls
+    FepIEntryAtomPairs atomPairs_;
+};
+
+//! Compares the output of the SIMD kernel to that of the reference kernel
+void compareToReference(const FepKernelOutput& reference, const FepKernelOutput& simd)
+{
+    real maxForce = 0;
+    for (const RVec& f : reference.force)
+    {
+        maxForce = std::max(maxForce, norm(f));
+    }
+    ASSERT_GT(maxForce, 0) << "The test system should have non-zero forces";
+
+    // In mixed precision the kernels differ by rounding in the order of 1e-6
+    const FloatingPointTolerance forceTolerance = relativeToleranceAsFloatingPoint(maxForce, 1e-5);
+    for (int a = 0; a < c_numAtoms; a++)
+    {
+        for (int d = 0; d < DIM; d++)
+        {
+            EXPECT_REAL_EQ_TOL(reference.force[a][d], simd.force[a][d], forceTolerance)
+                    << "atom " << a << " dim " << d;
+        }
+    }
+    for (int d = 0; d < DIM; d++)
+    {
+        EXPECT_REAL_EQ_TOL(reference.shiftForce[CENTRAL][d], simd.shiftForce[CENTRAL][d], forceTolerance);
+    }
+
+    real energyMagnitude = 1;
+    for (size_t e = 0; e < reference.energyCoulomb.size(); e++)
+    {
+        energyMagnitude += std::abs(reference.energyCoulomb[e]) + std::abs(reference.energyVdw[e]);
+    }
+    const FloatingPointTolerance energyTolerance =
+            relativeToleranceAsFloatingPoint(energyMagnitude, 1e-5);
+    for (size_t e = 0; e < reference.energyCoulomb.size(); e++)
+    {
+        EXPECT_REAL_EQ_TOL(reference.energyCoulomb[e], simd.energyCoulomb[e], energyTolerance)
+                << "energy-group pair " << e;
+        EXPECT_REAL_EQ_TOL(reference.energyVdw[e], simd.energyVdw[e], energyTolerance)
+                << "energy-group pair " << e;
+    }
+    EXPECT_REAL_EQ_TOL(reference.dvdl[efptCOUL], simd.dvdl[efptCOUL], energyTolerance);
+    EXPECT_REAL_EQ_TOL(reference.dvdl[efptVDW], simd.dvdl[efptVDW], energyTolerance);
+}
+
+TEST_P(FepKernelTest, SimdKernelMatchesReferenceKernel)
+{
+    const FepKernelOutput reference = runKernel(false);
+    const FepKernelOutput simd      = runKernel(true);
+
+    compareToReference(reference, simd);
+}
+
+TEST_P(FepKernelTest, SimdKernelMatchesReferenceKernelWithEnergyGroups)
+{
+    // The SIMD kernel splits the j-atoms of an i-atom when the energy-group pair changes
+    mdatoms_.nenergrp = 2;
+    mdatoms_.cENER    = system_.energyGroup.data();
+
+    const FepKernelOutput reference = runKernel(false);
+    const FepKernelOutput simd      = runKernel(true);
+
+    compareToReference(reference, simd);
+}
+
+INSTANTIATE_TEST_CASE_P(CoulombSoftCoreAndLambda,
+                        FepKernelTest,
+                        ::testing::Combine(::testing::Values(eelRF, eelPME),
+                                           ::testing::Values(SoftCoreSetup::None,
+                                                             SoftCoreSetup::VdwOnly,
+                                                             SoftCoreSetup::CoulombAndVdw),
+                                           ::testing::Values(0.0, 0.35, 1.0)));
+
+//! An atom pair with its energy-group pair and interaction flag
+using AtomPairEntry = std::tuple<int, int, int, bool>;
+
+TEST(FepIEntryAtomPairsTest, UnpackGivesAtomPairLists)
+{
+    const FepTestSystem system;
+    const int           numEnergyGroups = 2;
+
+    t_mdatoms mdatoms = {};
+    mdatoms.nenergrp  = numEnergyGroups;
+    mdatoms.cENER     = const_cast<unsigned short*>(system.energyGroup.data());
+
+    const NbnxnPairlistFep& nlist = system.fepList;
+
+    // A single buffer is used for all entries, which shrink in size
+    FepIEntryAtomPairs atomPairs;
+    for (const nbnxn_fep_ci_t& ciEntry : nlist.ci)
+    {
+        // The atom-pair lists as generated by the search before we stored cluster pairs:
+        // i-atom major, j-atoms in order, a new list for each energy-group pair change
+        std::vector<AtomPairEntry> expectedPairs;
+        int                        numExpectedLists = 0;
+        for (int i = 0; i < nlist.na_ci; i++)
+        {
+            const int ai         = system.atomIndices[ciEntry.ci * nlist.na_ci + i];
+            int       previousGid = -1;
+            for (int cjIndex = ciEntry.cj_ind_start; cjIndex < ciEntry.cj_ind_end; cjIndex++)
+            {
+                const nbnxn_fep_cj_t& cjEntry = nlist.cj[cjIndex];
+                for (int j = 0; j < nlist.na_cj; j++)
+                {
+                    const int bitIndex = i * nlist.na_cj + j;
+                    if (((cjEntry.pairMask >> bitIndex) & 1) == 0)
+                    {
+                        continue;
+                    }
+                    const int aj  = system.atomIndices[cjEntry.cj * nlist.na_cj + j];
+                    const int gid = GID(system.energyGroup[ai], system.energyGroup[aj], numEnergyGroups);
+                    if (gid != previousGid)
+                    {
+                        numExpectedLists++;
+                        previousGid = gid;
+                    }
+                    expectedPairs.emplace_back(ai, aj, gid, ((cjEntry.excl >> bitIndex) & 1) != 0);
+                }
+            }
+        }
+
+        atomPairs.unpack(nlist, ciEntry, system.atomIndices, mdatoms);
+
+        std::vector<AtomPairEntry> unpackedPairs;
+        for (int n = 0; n < atomPairs.nri; n++)
+        {
+            for (int k = atomPairs.jindex[n]; k < atomPairs.jindex[n + 1]; k++)
+            {
+                unpackedPairs.emplace_back(atomPairs.iinr[n], atomPairs.jjnr[k], atomPairs.gid[n],
+                                           atomPairs.excl_fep[k] != 0);
+            }
+        }
+
+        EXPECT_EQ(numExpectedLists, atomPairs.nri) << "i-cluster " << ciEntry.ci;
+        EXPECT_EQ(ciEntry.numPairs, gmx::ssize(unpackedPairs)) << "i-cluster " << ciEntry.ci;
+        EXPECT_EQ(expectedPairs, unpackedPairs) << "i-cluster " << ciEntry.ci;
+    }
+}
+
+} // namespace
+} // namespace test
+} // namespace gmx
@@ -2204,7 +2204,9 @@ int gmx_grompp(int argc, char* argv[])
         clear_rvec(state.box[ZZ]);
     }
 
-    if (EEL_FULL(ir->coulombtype) || EVDW_PME(ir->vdwtype))
+    /* FMM and RBE do not use a Fourier grid */
+    if ((EEL_FULL(ir->coulombtype) && ir->coulombtype != eelFMM && ir->coulombtype != eelRBE)
+        || EVDW_PME(ir->vdwtype))
     {
         /* Calculate the optimal grid dimensions */
         matrix          scaledBox;
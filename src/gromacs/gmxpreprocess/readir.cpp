@@ -341,11 +341,11 @@ void check_ir(const char*                   mdparin,
             warning_error(wi,
                           "With Verlet lists only cut-off and PME LJ interactions are supported");
         }
-        if (!(ir->coulombtype == eelCUT || EEL_RF(ir->coulombtype) || EEL_PME(ir->coulombtype)
-              || ir->coulombtype == eelEWALD))
+        if (!(ir->coulombtype == eelCUT || EEL_RF(ir->coulombtype)
+              || EEL_PME_EWALD(ir->coulombtype) || ir->coulombtype == eelFMM))
         {
             warning_error(wi,
-                          "With Verlet lists only cut-off, reaction-field, PME and Ewald "
+                          "With Verlet lists only cut-off, reaction-field, PME, Ewald, RBE and FMM "
                           "electrostatics are supported");
         }
         if (!(ir->coulomb_modifier == eintmodNONE || ir->coulomb_modifier == eintmodPOTSHIFT))
@@ -930,7 +930,7 @@ void check_ir(const char*                   mdparin,
             CHECK(ir->epc != epcNO);
         }
         sprintf(err_buf, "Can not have Ewald with pbc=%s", epbc_names[ir->ePBC]);
-        CHECK(EEL_FULL(ir->coulombtype));
+        CHECK(EEL_FULL(ir->coulombtype) && ir->coulombtype != eelFMM);
 
         sprintf(err_buf, "Can not have dispersion correction with pbc=%s", epbc_names[ir->ePBC]);
         CHECK(ir->eDispCorr != edispcNO);
@@ -1304,7 +1304,54 @@ void check_ir(const char*                   mdparin,
         }
     }
 
-    if (ir->nwall == 2 && EEL_FULL(ir->coulombtype))
+    if (ir->coulombtype == eelRBE)
+    {
+        sprintf(err_buf, "With coulombtype = %s, rbe-batch-size should be positive",
+                eel_names[ir->coulombtype]);
+        CHECK(ir->rbe_batch_size <= 0);
+        sprintf(err_buf, "With coulombtype = %s, pbc should be %s", eel_names[ir->coulombtype],
+                epbc_names[epbcXYZ]);
+        CHECK(ir->ePBC != epbcXYZ);
+        sprintf(err_buf, "Test particle insertion is not supported with coulombtype = %s",
+                eel_names[ir->coulombtype]);
+        CHECK(EI_TPI(ir->eI));
+        if (EI_MD(ir->eI) && ir->etc == etcNO)
+        {
+            sprintf(warn_buf,
+                    "With coulombtype = %s the forces are noisy, which heats up the system. "
+                    "You should use a thermostat.",
+                    eel_names[ir->coulombtype]);
+            warning(wi, warn_buf);
+        }
+    }
+
+    if (ir->coulombtype == eelFMM)
+    {
+        const int fmmOrderMax = 16;
+        sprintf(err_buf, "With coulombtype = %s, fmm-order should be between 1 and %d",
+                eel_names[ir->coulombtype], fmmOrderMax);
+        CHECK(ir->fmm_order < 1 || ir->fmm_order > fmmOrderMax);
+        sprintf(err_buf, "With coulombtype = %s, pbc should be %s or %s", eel_names[ir->coulombtype],
+                epbc_names[epbcXYZ], epbc_names[epbcXY]);
+        CHECK(ir->ePBC != epbcXYZ && ir->ePBC != epbcXY);
+        sprintf(err_buf, "With coulombtype = %s, epsilon-surface should be 0",
+                eel_names[ir->coulombtype]);
+        CHECK(ir->epsilon_surface != 0);
+        sprintf(err_buf, "Test particle insertion is not supported with coulombtype = %s",
+                eel_names[ir->coulombtype]);
+        CHECK(EI_TPI(ir->eI));
+        if (ir->epc != epcNO && ir->epct != epctISOTROPIC)
+        {
+            sprintf(warn_buf,
+                    "With coulombtype = %s only the contribution of pairs in neighboring cells "
+                    "to the virial is anisotropic, the rest of the long-range virial is "
+                    "approximated as isotropic. This affects %s pressure coupling.",
+                    eel_names[ir->coulombtype], epcoupltype_names[ir->epct]);
+            warning_note(wi, warn_buf);
+        }
+    }
+
+    if (ir->nwall == 2 && EEL_FULL(ir->coulombtype) && ir->coulombtype != eelFMM)
     {
         if (ir->ewald_geometry == eewg3D)
         {
@@ -1316,13 +1363,14 @@ void check_ir(const char*                   mdparin,
         sprintf(err_buf, "wall-ewald-zfac should be >= 2");
         CHECK(ir->wall_ewald_zfac < 2);
     }
-    if ((ir->ewald_geometry == eewg3DC) && (ir->ePBC != epbcXY) && EEL_FULL(ir->coulombtype))
+    if ((ir->ewald_geometry == eewg3DC) && (ir->ePBC != epbcXY) && EEL_FULL(ir->coulombtype)
+        && ir->coulombtype != eelFMM)
     {
         sprintf(warn_buf, "With %s and ewald_geometry = %s you should use pbc = %s",
                 eel_names[ir->coulombtype], eewg_names[eewg3DC], epbc_names[epbcXY]);
         warning(wi, warn_buf);
     }
-    if ((ir->epsilon_surface != 0) && EEL_FULL(ir->coulombtype))
+    if ((ir->epsilon_surface != 0) && EEL_FULL(ir->coulombtype) && ir->coulombtype != eelFMM)
     {
         sprintf(err_buf, "Cannot have periodic molecules with epsilon_surface > 0");
         CHECK(ir->bPeriodicMols);
@@ -2005,6 +2053,8 @@ void get_ir(const char*     mdparin,
     ir->nkz = get_eint(&inp, "fourier-nz", 0, wi);
     printStringNoNewline(&inp, "EWALD/PME/PPPM parameters");
     ir->pme_order              = get_eint(&inp, "pme-order", 4, wi);
+    ir->rbe_batch_size         = get_eint(&inp, "rbe-batch-size", 100, wi);
+    ir->fmm_order              = get_eint(&inp, "fmm-order", 8, wi);
     ir->ewald_rtol             = get_ereal(&inp, "ewald-rtol", 0.00001, wi);
     ir->ewald_rtol_lj          = get_ereal(&inp, "ewald-rtol-lj", 0.001, wi);
     ir->ljpme_combination_rule = get_eeenum(&inp, "lj-pme-comb-rule", eljpme_names, wi);
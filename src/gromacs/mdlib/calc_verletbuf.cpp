@@ -977,11 +977,14 @@ real calcVerletBufferSize(const gmx_mtop_t&         mtop,
     // Determine the 1st and 2nd derivative for the electostatics
     pot_derivatives_t elec = { 0, 0, 0 };
 
-    if (ir.coulombtype == eelCUT || EEL_RF(ir.coulombtype))
+    if (ir.coulombtype == eelCUT || EEL_RF(ir.coulombtype) || ir.coulombtype == eelFMM)
     {
         real eps_rf, k_rf;
 
-        if (ir.coulombtype == eelCUT)
+        /* With FMM the kernels compute a plain cut-off interaction,
+         * the FMM computes the interactions beyond the cut-off exactly.
+         */
+        if (ir.coulombtype == eelCUT || ir.coulombtype == eelFMM)
         {
             eps_rf = 1;
             k_rf   = 0;
@@ -1006,7 +1009,7 @@ real calcVerletBufferSize(const gmx_mtop_t&         mtop,
         }
         elec.d2 = elfac * (2.0 / gmx::power3(ir.rcoulomb) + 2 * k_rf);
     }
-    else if (EEL_PME(ir.coulombtype) || ir.coulombtype == eelEWALD)
+    else if (EEL_PME_EWALD(ir.coulombtype))
     {
         real b, rc, br;
 
@@ -46,8 +46,10 @@
 #include "gromacs/domdec/domdec.h"
 #include "gromacs/domdec/domdec_struct.h"
 #include "gromacs/ewald/ewald.h"
+#include "gromacs/ewald/fast_multipole_method.h"
 #include "gromacs/ewald/long_range_correction.h"
 #include "gromacs/ewald/pme.h"
+#include "gromacs/ewald/random_batch_ewald.h"
 #include "gromacs/gmxlib/network.h"
 #include "gromacs/gmxlib/nrnb.h"
 #include "gromacs/listed_forces/listed_forces.h"
@@ -103,6 +105,7 @@ void do_force_lowlevel(t_forcerec*                         fr,
                        const t_idef*                       idef,
                        const t_commrec*                    cr,
                        const gmx_multisim_t*               ms,
+                       int64_t                             step,
                        t_nrnb*                             nrnb,
                        gmx_wallcycle_t                     wcycle,
                        const t_mdatoms*                    md,
@@ -194,7 +197,8 @@ void do_force_lowlevel(t_forcerec*                         fr,
     /* Do long-range electrostatics and/or LJ-PME
      * and compute PME surface terms when necessary.
      */
-    if (computePmeOnCpu || fr->ic->eeltype == eelEWALD || haveEwaldSurfaceTerm)
+    if (computePmeOnCpu || fr->ic->eeltype == eelEWALD || fr->ic->eeltype == eelRBE
+        || fr->ic->eeltype == eelFMM || haveEwaldSurfaceTerm)
     {
         int  status = 0;
         real Vlr_q = 0, Vlr_lj = 0;
@@ -338,6 +342,26 @@ void do_force_lowlevel(t_forcerec*                         fr,
                              lambda[efptCOUL], &ewaldOutput.dvdl[efptCOUL], fr->ewald_table);
         }
 
+        if (fr->ic->eeltype == eelRBE)
+        {
+            wallcycle_start(wcycle, ewcPMEMESH);
+            Vlr_q = fr->randomBatchEwald->calculate(
+                    *ir, step, x, as_rvec_array(forceWithVirial.force_.data()), md->chargeA,
+                    md->chargeB, box, cr, md->homenr, ewaldOutput.vir_q, fr->ic->ewaldcoeff_q,
+                    lambda[efptCOUL], &ewaldOutput.dvdl[efptCOUL]);
+            wallcycle_stop(wcycle, ewcPMEMESH);
+        }
+
+        if (fr->ic->eeltype == eelFMM)
+        {
+            wallcycle_start(wcycle, ewcPMEMESH);
+            Vlr_q = fr->fastMultipoleMethod->calculate(
+                    *ir, x, as_rvec_array(forceWithVirial.force_.data()), md->chargeA, md->chargeB,
+                    md->nChargePerturbed != 0, box, cr, md->homenr, ewaldOutput.vir_q,
+                    lambda[efptCOUL], &ewaldOutput.dvdl[efptCOUL]);
+            wallcycle_stop(wcycle, ewcPMEMESH);
+        }
+
         /* Note that with separate PME nodes we get the real energies later */
         // TODO it would be simpler if we just accumulated a single
         // long-range virial contribution.
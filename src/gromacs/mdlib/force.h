@@ -119,6 +119,7 @@ void do_force_lowlevel(t_forcerec*                         fr,
                        const t_idef*                       idef,
                        const t_commrec*                    cr,
                        const gmx_multisim_t*               ms,
+                       int64_t                             step,
                        t_nrnb*                             nrnb,
                        gmx_wallcycle*                      wcycle,
                        const t_mdatoms*                    md,
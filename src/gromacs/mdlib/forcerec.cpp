@@ -53,7 +53,9 @@
 #include "gromacs/domdec/domdec_struct.h"
 #include "gromacs/ewald/ewald.h"
 #include "gromacs/ewald/ewald_utils.h"
+#include "gromacs/ewald/fast_multipole_method.h"
 #include "gromacs/ewald/pme_pp_comm_gpu.h"
+#include "gromacs/ewald/random_batch_ewald.h"
 #include "gromacs/fileio/filetypes.h"
 #include "gromacs/gmxlib/network.h"
 #include "gromacs/gmxlib/nonbonded/nonbonded.h"
@@ -897,10 +899,13 @@ static void init_interaction_const(FILE*                 fp,
     }
     else
     {
-        /* For plain cut-off we might use the reaction-field kernels */
+        /* For plain cut-off we might use the reaction-field kernels,
+         * with FMM the kernels compute the part of the interaction
+         * below the cut-off which is not computed by the FMM.
+         */
         ic->epsilon_rf = ic->epsilon_r;
         ic->k_rf       = 0;
-        if (ir->coulomb_modifier == eintmodPOTSHIFT)
+        if (ir->coulomb_modifier == eintmodPOTSHIFT || ic->eeltype == eelFMM)
         {
             ic->c_rf = 1 / ic->rcoulomb;
         }
@@ -923,7 +928,7 @@ static void init_interaction_const(FILE*                 fp,
         }
         fprintf(fp, "Potential shift: LJ r^-12: %.3e r^-6: %.3e", ic->repulsion_shift.cpot, dispersion_shift);
 
-        if (ic->eeltype == eelCUT)
+        if (ic->eeltype == eelCUT || ic->eeltype == eelFMM)
         {
             fprintf(fp, ", Coulomb %.e", -ic->c_rf);
         }
@@ -1203,6 +1208,15 @@ void init_forcerec(FILE*                            fp,
     {
         init_ewald_tab(&(fr->ewald_table), ir, fp);
     }
+    if (ir->coulombtype == eelRBE)
+    {
+        fr->randomBatchEwald = std::make_unique<RandomBatchEwald>(*ir, fp);
+    }
+    if (ir->coulombtype == eelFMM)
+    {
+        fr->fastMultipoleMethod = std::make_unique<FastMultipoleMethod>(
+                *ir, mtop->natoms, ic->rcoulomb, gmx_omp_nthreads_get(emntDefault), fp);
+    }
 
     /* Electrostatics: Translate from interaction-setting-in-mdp-file to kernel interaction format */
     switch (ic->eeltype)
@@ -1210,7 +1224,8 @@ void init_forcerec(FILE*                            fp,
         case eelCUT: fr->nbkernel_elec_interaction = GMX_NBKERNEL_ELEC_COULOMB; break;
 
         case eelRF:
-        case eelRF_ZERO: fr->nbkernel_elec_interaction = GMX_NBKERNEL_ELEC_REACTIONFIELD; break;
+        case eelRF_ZERO:
+        case eelFMM: fr->nbkernel_elec_interaction = GMX_NBKERNEL_ELEC_REACTIONFIELD; break;
 
         case eelSWITCH:
         case eelSHIFT:
@@ -1224,7 +1239,8 @@ void init_forcerec(FILE*                            fp,
 
         case eelPME:
         case eelP3M_AD:
-        case eelEWALD: fr->nbkernel_elec_interaction = GMX_NBKERNEL_ELEC_EWALD; break;
+        case eelEWALD:
+        case eelRBE: fr->nbkernel_elec_interaction = GMX_NBKERNEL_ELEC_EWALD; break;
 
         default:
             gmx_fatal(FARGS, "Unsupported electrostatic interaction: %s", eel_names[ic->eeltype]);
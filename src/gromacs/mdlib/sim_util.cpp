@@ -1093,6 +1093,11 @@ void do_force(FILE*                               fplog,
     const bool haveHostPmePpComms =
             !thisRankHasDuty(cr, DUTY_PME) && !simulationWork.useGpuPmePpCommunication;
     const bool haveHostHaloExchangeComms = havePPDomainDecomposition(cr) && !ddUsesGpuDirectCommunication;
+    // With the non-bonded work on the CPU, we overlap the halo coordinate
+    // communication with the local non-bonded work.
+    const bool overlapHostHaloExchangeComms =
+            haveHostHaloExchangeComms && !stepWork.doNeighborSearch
+            && !simulationWork.useGpuNonbonded && !fr->nbv->emulateGpu();
 
     bool gmx_used_in_debug haveCopiedXFromGpu = false;
     if (simulationWork.useGpuUpdate && !stepWork.doNeighborSearch
@@ -1326,7 +1331,15 @@ void do_force(FILE*                               fplog,
                 // a waitCoordinatesReadyOnHost() should be issued if it will be.
                 GMX_ASSERT(!simulationWork.useGpuUpdate,
                            "GPU update is not supported with CPU halo exchange");
-                dd_move_x(cr->dd, box, x.unpaddedArrayRef(), wcycle);
+                if (overlapHostHaloExchangeComms)
+                {
+                    // We complete the communication after the local non-bonded work
+                    dd_move_x_start(cr->dd, box, x.unpaddedArrayRef(), wcycle);
+                }
+                else
+                {
+                    dd_move_x(cr->dd, box, x.unpaddedArrayRef(), wcycle);
+                }
             }
 
             if (useGpuXBufOps == BufferOpsUseGpu::True)
@@ -1340,7 +1353,7 @@ void do_force(FILE*                               fplog,
                                            stateGpu->getCoordinatesReadyOnDeviceEvent(
                                                    AtomLocality::NonLocal, simulationWork, stepWork));
             }
-            else
+            else if (!overlapHostHaloExchangeComms)
             {
                 nbv->convertCoordinates(AtomLocality::NonLocal, false, x.unpaddedArrayRef());
             }
@@ -1488,14 +1501,23 @@ void do_force(FILE*                               fplog,
                                       as_rvec_array(x.unpaddedArrayRef().data()),
                                       &forceOut.forceWithShiftForces(), *mdatoms, inputrec->fepvals,
                                       lambda.data(), enerd, stepWork, nrnb);
+    }
 
-        if (havePPDomainDecomposition(cr))
-        {
-            nbv->dispatchFreeEnergyKernel(InteractionLocality::NonLocal, fr,
-                                          as_rvec_array(x.unpaddedArrayRef().data()),
-                                          &forceOut.forceWithShiftForces(), *mdatoms,
-                                          inputrec->fepvals, lambda.data(), enerd, stepWork, nrnb);
-        }
+    if (overlapHostHaloExchangeComms)
+    {
+        /* All remaining work needs the non-local coordinates */
+        wallcycle_stop(wcycle, ewcFORCE);
+        dd_move_x_finish(cr->dd, box, x.unpaddedArrayRef(), wcycle);
+        nbv->convertCoordinates(AtomLocality::NonLocal, false, x.unpaddedArrayRef());
+        wallcycle_start_nocount(wcycle, ewcFORCE);
+    }
+
+    if (fr->efep != efepNO && havePPDomainDecomposition(cr))
+    {
+        nbv->dispatchFreeEnergyKernel(InteractionLocality::NonLocal, fr,
+                                      as_rvec_array(x.unpaddedArrayRef().data()),
+                                      &forceOut.forceWithShiftForces(), *mdatoms, inputrec->fepvals,
+                                      lambda.data(), enerd, stepWork, nrnb);
     }
 
     if (!useOrEmulateGpuNb)
@@ -1540,8 +1562,9 @@ void do_force(FILE*                               fplog,
         stateGpu->waitCoordinatesReadyOnHost(AtomLocality::NonLocal);
     }
     /* Compute the bonded and non-bonded energies and optionally forces */
-    do_force_lowlevel(fr, inputrec, &(top->idef), cr, ms, nrnb, wcycle, mdatoms, x, hist, &forceOut, enerd,
-                      fcd, box, lambda.data(), graph, fr->mu_tot, stepWork, ddBalanceRegionHandler);
+    do_force_lowlevel(fr, inputrec, &(top->idef), cr, ms, step, nrnb, wcycle, mdatoms, x, hist,
+                      &forceOut, enerd, fcd, box, lambda.data(), graph, fr->mu_tot, stepWork,
+                      ddBalanceRegionHandler);
 
     wallcycle_stop(wcycle, ewcFORCE);
 
@@ -67,6 +67,7 @@
 #include "gromacs/ewald/pme.h"
 #include "gromacs/ewald/pme_gpu_program.h"
 #include "gromacs/ewald/pme_pp_comm_gpu.h"
+#include "gromacs/fft/fft.h"
 #include "gromacs/fileio/checkpoint.h"
 #include "gromacs/fileio/gmxfio.h"
 #include "gromacs/fileio/oenv.h"
@@ -150,6 +151,7 @@
 #include "gromacs/utility/logger.h"
 #include "gromacs/utility/loggerbuilder.h"
 #include "gromacs/utility/mdmodulenotification.h"
+#include "gromacs/utility/path.h"
 #include "gromacs/utility/physicalnodecommunicator.h"
 #include "gromacs/utility/pleasecite.h"
 #include "gromacs/utility/programcontext.h"
@@ -551,6 +553,38 @@ static TaskTarget findTaskTarget(const char* optionString)
     return returnValue;
 }
 
+/*! \brief Return the name of the file with FFT planning wisdom, empty when not requested
+ *
+ * The wisdom is stored next to the checkpoint, so runs continuing from
+ * the checkpoint do not need to repeat the FFT planning.
+ */
+static std::string fftWisdomFileName(ArrayRef<const t_filenm> filenames)
+{
+    if (getenv("GMX_FFT_WISDOM") == nullptr)
+    {
+        return std::string();
+    }
+    return Path::stripExtension(opt2fn("-cpo", filenames.size(), filenames.data())) + ".fftwisdom";
+}
+
+/*! \brief Return whether this rank is the first rank in the simulation that does PME
+ *
+ * With separate PME ranks, the first PME rank is not the master rank.
+ * Has to be called by all ranks in the simulation.
+ */
+static bool isFirstPmeRank(const t_commrec* cr)
+{
+    int firstPmeRank = thisRankHasDuty(cr, DUTY_PME) ? cr->sim_nodeid : cr->nnodes;
+#if GMX_MPI
+    if (PAR(cr))
+    {
+        int pmeRank = firstPmeRank;
+        MPI_Allreduce(&pmeRank, &firstPmeRank, 1, MPI_INT, MPI_MIN, cr->mpi_comm_mysim);
+    }
+#endif
+    return firstPmeRank == cr->sim_nodeid;
+}
+
 //! Finish run, aggregate data to print performance info.
 static void finish_run(FILE*                     fplog,
                        const gmx::MDLogger&      mdlog,
@@ -637,6 +671,11 @@ static void finish_run(FILE*                     fplog,
         print_dd_statistics(cr, inputrec, fplog);
     }
 
+    if (thisRankHasDuty(cr, DUTY_PP) && nbv != nullptr)
+    {
+        nbv->reportKernelCounters(fplog, cr);
+    }
+
     /* TODO Move the responsibility for any scaling by thread counts
      * to the code that handled the thread region, so that there's a
      * mechanism to keep cycle counting working during the transition
@@ -1325,6 +1364,14 @@ int Mdrunner::mdrunner()
                       nonbondedDeviceInfo, useGpuForBonded,
                       pmeRunMode == PmeRunMode::GPU && !thisRankHasDuty(cr, DUTY_PME), pforce, wcycle);
 
+        /* Tuning based on timings would make the pair lists differ between runs */
+        if (mdrunOptions.reproducible && fr->nbv && fr->nbv->disableDynamicPruningTuning())
+        {
+            GMX_LOG(mdlog.info)
+                    .asParagraph()
+                    .appendText("Not tuning the dynamic pruning interval because of -reprod");
+        }
+
         // TODO Move this to happen during domain decomposition setup,
         // once stream and event handling works well with that.
         // TODO remove need to pass local stream into GPU halo exchange - Redmine #3093
@@ -1419,6 +1466,18 @@ int Mdrunner::mdrunner()
         pmeGpuProgram = buildPmeGpuProgram(pmeDeviceInfo);
     }
 
+    /* Reuse the FFT planning of previous runs and of PME tuning stages */
+    const std::string fftWisdomFile = fftWisdomFileName(filenames);
+    if (!fftWisdomFile.empty() && thisRankHasDuty(cr, DUTY_PME))
+    {
+        if (gmx_fft_import_wisdom(fftWisdomFile.c_str()))
+        {
+            GMX_LOG(mdlog.info)
+                    .asParagraph()
+                    .appendTextFormatted("Imported FFT planning wisdom from %s", fftWisdomFile.c_str());
+        }
+    }
+
     /* Initiate PME if necessary,
      * either on all nodes or on dedicated PME nodes only. */
     if (EEL_PME(inputrec->coulombtype) || EVDW_PME(inputrec->vdwtype))
@@ -1608,6 +1667,12 @@ int Mdrunner::mdrunner()
     finish_run(fplog, mdlog, cr, inputrec, &nrnb, wcycle, walltime_accounting,
                fr ? fr->nbv.get() : nullptr, pmedata, EI_DYNAMICS(inputrec->eI) && !isMultiSim(ms));
 
+    /* The wisdom of the first rank doing PME covers all grids tried during PME tuning */
+    if (!fftWisdomFile.empty() && isFirstPmeRank(cr))
+    {
+        gmx_fft_export_wisdom(fftWisdomFile.c_str());
+    }
+
     // clean up cycle counter
     wallcycle_destroy(wcycle);
 
@@ -53,6 +53,8 @@ struct gmx_pme_t;
 struct nonbonded_verlet_t;
 struct bonded_threading_t;
 class DispersionCorrection;
+class FastMultipoleMethod;
+class RandomBatchEwald;
 struct t_forcetable;
 struct t_QMMMrec;
 
@@ -229,6 +231,10 @@ struct t_forcerec
 
     /* PME/Ewald stuff */
     struct gmx_ewald_tab_t* ewald_table = nullptr;
+    /* Random-batch Ewald, only used with coulombtype RBE */
+    std::unique_ptr<RandomBatchEwald> randomBatchEwald;
+    /* Fast multipole method, only used with coulombtype FMM */
+    std::unique_ptr<FastMultipoleMethod> fastMultipoleMethod;
 
     /* Shift force array for computing the virial, size SHIFTS */
     std::vector<gmx::RVec> shiftForces;
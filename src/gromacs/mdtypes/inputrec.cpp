@@ -891,6 +891,8 @@ void pr_inputrec(FILE* fp, int indent, const char* title, const t_inputrec* ir,
         PI("fourier-ny", ir->nky);
         PI("fourier-nz", ir->nkz);
         PI("pme-order", ir->pme_order);
+        PI("rbe-batch-size", ir->rbe_batch_size);
+        PI("fmm-order", ir->fmm_order);
         PR("ewald-rtol", ir->ewald_rtol);
         PR("ewald-rtol-lj", ir->ewald_rtol_lj);
         PS("lj-pme-comb-rule", ELJPMECOMBNAMES(ir->ljpme_combination_rule));
@@ -1314,6 +1316,8 @@ void cmp_inputrec(FILE* fp, const t_inputrec* ir1, const t_inputrec* ir2, real f
     cmp_int(fp, "inputrec->nky", -1, ir1->nky, ir2->nky);
     cmp_int(fp, "inputrec->nkz", -1, ir1->nkz, ir2->nkz);
     cmp_int(fp, "inputrec->pme_order", -1, ir1->pme_order, ir2->pme_order);
+    cmp_int(fp, "inputrec->rbe_batch_size", -1, ir1->rbe_batch_size, ir2->rbe_batch_size);
+    cmp_int(fp, "inputrec->fmm_order", -1, ir1->fmm_order, ir2->fmm_order);
     cmp_real(fp, "inputrec->ewald_rtol", -1, ir1->ewald_rtol, ir2->ewald_rtol, ftol, abstol);
     cmp_int(fp, "inputrec->ewald_geometry", -1, ir1->ewald_geometry, ir2->ewald_geometry);
     cmp_real(fp, "inputrec->epsilon_surface", -1, ir1->epsilon_surface, ir2->epsilon_surface, ftol, abstol);
@@ -1459,7 +1463,7 @@ gmx_bool inputrecPreserveShape(const t_inputrec* ir)
 
 gmx_bool inputrecNeedMutot(const t_inputrec* ir)
 {
-    return ((ir->coulombtype == eelEWALD || EEL_PME(ir->coulombtype))
+    return (EEL_PME_EWALD(ir->coulombtype)
             && (ir->ewald_geometry == eewg3DC || ir->epsilon_surface != 0));
 }
 
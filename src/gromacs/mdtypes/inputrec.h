@@ -377,6 +377,10 @@ struct t_inputrec // NOLINT (clang-analyzer-optin.performance.Padding)
     int nkz;
     //! Interpolation order for PME
     int pme_order;
+    //! Number of wave vectors sampled per step with random-batch Ewald
+    int rbe_batch_size;
+    //! Order of the multipole expansions with the fast multipole method
+    int fmm_order;
     //! Real space tolerance for Ewald, determines the real/reciprocal space relative weight
     real ewald_rtol;
     //! Real space tolerance for LJ-Ewald
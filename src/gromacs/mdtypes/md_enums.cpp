@@ -78,6 +78,8 @@ const char* eel_names[eelNR + 1] = { "Cut-off",
                                      "PME-Switch",
                                      "PME-User-Switch",
                                      "Reaction-Field-zero",
+                                     "RBE",
+                                     "FMM",
                                      nullptr };
 
 const char* eewg_names[eewgNR + 1] = { "3d", "3dc", nullptr };
@@ -243,6 +243,8 @@ enum
     eelPMESWITCH,
     eelPMEUSERSWITCH,
     eelRF_ZERO,
+    eelRBE,
+    eelFMM,
     eelNR
 };
 //! String corresponding to Coulomb treatment
@@ -267,10 +269,14 @@ extern const char* eewg_names[eewgNR + 1];
 //! Macro telling us whether we use PME
 #define EEL_PME(e) \
     ((e) == eelPME || (e) == eelPMESWITCH || (e) == eelPMEUSER || (e) == eelPMEUSERSWITCH || (e) == eelP3M_AD)
-//! Macro telling us whether we use PME or full Ewald
-#define EEL_PME_EWALD(e) (EEL_PME(e) || (e) == eelEWALD)
+/*! \brief Macro telling us whether we use PME, full Ewald or random-batch Ewald
+ *
+ * These share the Ewald real-space interactions and the exclusion, charge
+ * and surface corrections. Use EEL_PME for what concerns the PME mesh.
+ */
+#define EEL_PME_EWALD(e) (EEL_PME(e) || (e) == eelEWALD || (e) == eelRBE)
 //! Macro telling us whether we use full electrostatics of any sort
-#define EEL_FULL(e) (EEL_PME_EWALD(e) || (e) == eelPOISSON)
+#define EEL_FULL(e) (EEL_PME_EWALD(e) || (e) == eelPOISSON || (e) == eelFMM)
 //! Macro telling us whether we use user defined electrostatics
 #define EEL_USER(e) ((e) == eelUSER || (e) == eelPMEUSER || (e) == (eelPMEUSERSWITCH))
 
@@ -66,6 +66,7 @@
 
 #include "grid.h"
 #include "gridset.h"
+#include "halfprecision.h"
 #include "nbnxm_geometry.h"
 #include "pairlist.h"
 
@@ -76,6 +77,27 @@ void nbnxn_atomdata_t::resizeCoordinateBuffer(int numAtoms)
     numAtoms_ = numAtoms;
 
     x_.resize(numAtoms * xstride);
+
+    if (useHalfPrecisionX_)
+    {
+        xHalf_.resize(numAtoms * xstride);
+        xHalfOrigin_.resize((numAtoms + jClusterSize - 1) / jClusterSize * DIM);
+    }
+}
+
+bool nbnxn_atomdata_t::setUseHalfPrecisionX(bool useHalfPrecisionX)
+{
+    /* The SIMD kernels use the same index for x and xHalf,
+     * so the j-clusters need to be packed separately.
+     */
+    const bool isSupported = (!GMX_DOUBLE && (XFormat == nbatX4 || XFormat == nbatX8)
+                              && jClusterSize == (XFormat == nbatX4 ? c_packX4 : c_packX8));
+
+    useHalfPrecisionX_ = (useHalfPrecisionX && isSupported);
+
+    resizeCoordinateBuffer(numAtoms_);
+
+    return (useHalfPrecisionX_ == useHalfPrecisionX);
 }
 
 void nbnxn_atomdata_t::resizeForceBuffers()
@@ -429,7 +451,9 @@ nbnxn_atomdata_t::nbnxn_atomdata_t(gmx::PinningPolicy pinningPolicy) :
     numAtoms_(0),
     natoms_local(0),
     shift_vec({}, { pinningPolicy }),
+    jClusterSize(0),
     x_({}, { pinningPolicy }),
+    useHalfPrecisionX_(false),
     simdMasks(),
     bUseBufferFlags(FALSE),
     bUseTreeReduce(FALSE)
@@ -667,6 +691,8 @@ void nbnxn_atomdata_init(const gmx::MDLogger&    mdlog,
     nbat->xstride = (nbat->XFormat == nbatXYZQ ? STRIDE_XYZQ : DIM);
     nbat->fstride = (nbat->FFormat == nbatXYZQ ? STRIDE_XYZQ : DIM);
 
+    nbat->jClusterSize = Nbnxm::JClusterSizePerKernelType[kernelType];
+
     /* Initialize the output data structures */
     for (int i = 0; i < nout; i++)
     {
@@ -1069,6 +1095,117 @@ void nbnxn_atomdata_copy_x_to_nbat_x(const Nbnxm::GridSet&   gridSet,
     }
 }
 
+/* Converts the coordinates of atoms a0 to a1 to half-precision offsets,
+ * the first numRealAtoms atoms are normal atoms, the others are fillers.
+ * a0 and a1 should be multiples of the j-cluster size.
+ */
+template<int packSize>
+static void copy_x_to_half_precision(const real* x,
+                                     int         a0,
+                                     int         a1,
+                                     int         numRealAtoms,
+                                     int         jClusterSize,
+                                     uint16_t*   xHalf,
+                                     real*       xHalfOrigin)
+{
+    for (int aStart = a0; aStart < a1; aStart += jClusterSize)
+    {
+        const int aEnd     = aStart + jClusterSize;
+        const int aRealEnd = std::min(aEnd, a0 + numRealAtoms);
+
+        /* Use the center of the bounding box of the real atoms as origin */
+        rvec origin = { 0, 0, 0 };
+        if (aRealEnd > aStart)
+        {
+            for (int d = 0; d < DIM; d++)
+            {
+                real xMin = x[atom_to_x_index<packSize>(aStart) + d * packSize];
+                real xMax = xMin;
+                for (int a = aStart + 1; a < aRealEnd; a++)
+                {
+                    const real xa = x[atom_to_x_index<packSize>(a) + d * packSize];
+                    xMin          = std::min(xMin, xa);
+                    xMax          = std::max(xMax, xa);
+                }
+                origin[d] = 0.5_real * (xMin + xMax);
+            }
+        }
+
+        const int cluster = aStart / jClusterSize;
+        for (int d = 0; d < DIM; d++)
+        {
+            xHalfOrigin[cluster * DIM + d] = origin[d];
+        }
+
+        for (int a = aStart; a < aEnd; a++)
+        {
+            for (int d = 0; d < DIM; d++)
+            {
+                const int  index  = atom_to_x_index<packSize>(a) + d * packSize;
+                const real offset = std::min(
+                        std::max(x[index] - origin[d], -Nbnxm::c_halfPrecisionMaxOffset),
+                        Nbnxm::c_halfPrecisionMaxOffset);
+                xHalf[index] = Nbnxm::floatToHalf(offset);
+            }
+        }
+    }
+}
+
+void nbnxn_atomdata_copy_x_to_half_precision(const Nbnxm::GridSet&   gridSet,
+                                             const gmx::AtomLocality locality,
+                                             nbnxn_atomdata_t*       nbat)
+{
+    GMX_ASSERT(nbat->useHalfPrecisionX(), "Should only be called with half-precision x storage");
+
+    int gridBegin = 0;
+    int gridEnd   = 0;
+    getAtomRanges(gridSet, locality, &gridBegin, &gridEnd);
+
+    const int   jClusterSize = nbat->jClusterSize;
+    const real* x            = nbat->x().data();
+    uint16_t*   xHalf        = nbat->xHalf().data();
+    real*       xHalfOrigin  = nbat->xHalfOrigin().data();
+
+    const int nth = gmx_omp_nthreads_get(emntPairsearch);
+#pragma omp parallel for num_threads(nth) schedule(static)
+    for (int th = 0; th < nth; th++)
+    {
+        try
+        {
+            for (int g = gridBegin; g < gridEnd; g++)
+            {
+                const Nbnxm::Grid& grid       = gridSet.grids()[g];
+                const int          numCellsXY = grid.numColumns();
+
+                const int cxy0 = (numCellsXY * th + nth - 1) / nth;
+                const int cxy1 = (numCellsXY * (th + 1) + nth - 1) / nth;
+
+                for (int cxy = cxy0; cxy < cxy1; cxy++)
+                {
+                    /* Columns are padded to a multiple of the j-cluster size */
+                    const int a0 = grid.firstAtomInColumn(cxy);
+                    const int a1 = a0
+                                   + (grid.paddedNumAtomsInColumn(cxy) + jClusterSize - 1)
+                                             / jClusterSize * jClusterSize;
+                    const int numRealAtoms = grid.numAtomsInColumn(cxy);
+
+                    if (nbat->XFormat == nbatX4)
+                    {
+                        copy_x_to_half_precision<c_packX4>(x, a0, a1, numRealAtoms, jClusterSize,
+                                                           xHalf, xHalfOrigin);
+                    }
+                    else
+                    {
+                        copy_x_to_half_precision<c_packX8>(x, a0, a1, numRealAtoms, jClusterSize,
+                                                           xHalf, xHalfOrigin);
+                    }
+                }
+            }
+        }
+        GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
+    }
+}
+
 /* Copies (and reorders) the coordinates to nbnxn_atomdata_t on the GPU*/
 void nbnxn_atomdata_x_to_nbat_x_gpu(const Nbnxm::GridSet&   gridSet,
                                     const gmx::AtomLocality locality,
@@ -36,6 +36,7 @@
 #ifndef GMX_NBNXN_ATOMDATA_H
 #define GMX_NBNXN_ATOMDATA_H
 
+#include <cstdint>
 #include <cstdio>
 
 #include "gromacs/gpu_utils/devicebuffer_datatype.h"
@@ -235,6 +236,24 @@ struct nbnxn_atomdata_t
     /* Resizes the coordinate buffer and sets the number of atoms */
     void resizeCoordinateBuffer(int numAtoms);
 
+    /* Returns whether j-coordinates are also stored in half precision for the SIMD kernels */
+    bool useHalfPrecisionX() const { return useHalfPrecisionX_; }
+
+    /* Sets whether j-coordinates are stored in half precision, returns whether this is supported */
+    bool setUseHalfPrecisionX(bool useHalfPrecisionX);
+
+    /* Return the half-precision coordinate offsets, same layout as x() */
+    gmx::ArrayRef<const uint16_t> xHalf() const { return xHalf_; }
+
+    /* Return the half-precision coordinate offsets, same layout as x() */
+    gmx::ArrayRef<uint16_t> xHalf() { return xHalf_; }
+
+    /* Return the origins of the half-precision offsets, DIM reals per j-cluster */
+    gmx::ArrayRef<const real> xHalfOrigin() const { return xHalfOrigin_; }
+
+    /* Return the origins of the half-precision offsets, DIM reals per j-cluster */
+    gmx::ArrayRef<real> xHalfOrigin() { return xHalfOrigin_; }
+
     /* Resizes the force buffers for the current number of atoms */
     void resizeForceBuffers();
 
@@ -252,8 +271,15 @@ public:
     gmx::HostVector<gmx::RVec> shift_vec;   /* Shift vectors, copied from t_forcerec              */
     int                        xstride;     /* stride for a coordinate in x (usually 3 or 4)      */
     int                        fstride;     /* stride for a coordinate in f (usually 3 or 4)      */
+    int                        jClusterSize; /* The j-cluster size of the kernel in use          */
 private:
     gmx::HostVector<real> x_; /* x and possibly q, size natoms*xstride              */
+    /* Whether we store half-precision j-coordinates, see halfprecision.h */
+    bool useHalfPrecisionX_;
+    /* Half-precision coordinate offsets, size natoms*xstride when used */
+    AlignedVector<uint16_t> xHalf_;
+    /* Origins of the offsets in xHalf_, size DIM*natoms/jClusterSize when used */
+    AlignedVector<real> xHalfOrigin_;
 
 public:
     // Masks for handling exclusions in the SIMD kernels
@@ -321,6 +347,20 @@ void nbnxn_atomdata_copy_x_to_nbat_x(const Nbnxm::GridSet& gridSet,
                                      const rvec*           coordinates,
                                      nbnxn_atomdata_t*     nbat);
 
+/*! \brief Converts the j-cluster coordinates in nbat to half-precision offsets
+ *
+ * Should only be called when nbat->useHalfPrecisionX() is true.
+ * Fills the offsets and origins for all clusters of the grids in \p locality,
+ * including filler particles.
+ *
+ * \param[in]     gridSet   The grids data.
+ * \param[in]     locality  If the conversion should be applied to local or non local coordinates.
+ * \param[in,out] nbat      Data in NBNXM format, x() is read, xHalf() and xHalfOrigin() are set.
+ */
+void nbnxn_atomdata_copy_x_to_half_precision(const Nbnxm::GridSet& gridSet,
+                                             gmx::AtomLocality     locality,
+                                             nbnxn_atomdata_t*     nbat);
+
 /*! \brief Transform coordinates to xbat layout on GPU
  *
  * Creates a GPU copy of the coordinates buffer using short-range ordering.
@@ -45,6 +45,14 @@
 
 #include "bench_setup.h"
 
+#include <cstdio>
+
+#include <algorithm>
+#include <array>
+#include <memory>
+#include <string>
+#include <vector>
+
 #include "gromacs/compat/optional.h"
 #include "gromacs/gmxlib/nrnb.h"
 #include "gromacs/mdlib/dispersioncorrection.h"
@@ -57,7 +65,9 @@
 #include "gromacs/mdtypes/mdatom.h"
 #include "gromacs/mdtypes/simulation_workload.h"
 #include "gromacs/nbnxm/atomdata.h"
+#include "gromacs/nbnxm/dynamicpruningtuner.h"
 #include "gromacs/nbnxm/gridset.h"
+#include "gromacs/nbnxm/kernelcounters.h"
 #include "gromacs/nbnxm/nbnxm.h"
 #include "gromacs/nbnxm/nbnxm_simd.h"
 #include "gromacs/nbnxm/pairlistset.h"
@@ -65,17 +75,26 @@
 #include "gromacs/nbnxm/pairsearch.h"
 #include "gromacs/pbcutil/ishift.h"
 #include "gromacs/pbcutil/pbc.h"
+#include "gromacs/random/threefry.h"
+#include "gromacs/random/uniformrealdistribution.h"
 #include "gromacs/simd/simd.h"
+#include "gromacs/timing/cachemisscounters.h"
 #include "gromacs/timing/cyclecounter.h"
 #include "gromacs/utility/enumerationhelpers.h"
 #include "gromacs/utility/fatalerror.h"
+#include "gromacs/utility/futil.h"
 #include "gromacs/utility/logger.h"
+#include "gromacs/utility/stringutil.h"
+#include "gromacs/utility/textreader.h"
 
 #include "bench_system.h"
 
 namespace Nbnxm
 {
 
+//! The random seed for perturbing the coordinates in the search benchmark
+static constexpr uint64_t c_searchBenchmarkSeed = 1234;
+
 /*! \brief Checks the kernel setup
  *
  * Returns an error string when the kernel is not available.
@@ -99,6 +118,12 @@ static gmx::compat::optional<std::string> checkKernelSetup(const KernelBenchOpti
         return "the requested SIMD kernel was not set up at configuration time";
     }
 
+    if (options.useHalfPrecisionX && (options.nbnxmSimd == BenchMarkKernels::SimdNo || GMX_DOUBLE))
+    {
+        return "half-precision coordinate storage is only supported with mixed-precision SIMD "
+               "kernels";
+    }
+
     return {};
 }
 
@@ -165,9 +190,55 @@ static interaction_const_t setupInteractionConst(const KernelBenchOptions& optio
     return ic;
 }
 
-//! Sets up and returns a Nbnxm object for the given benchmark options and system
+//! Returns the atom info for \p system with the LJ setup selected by \p options
+static gmx::ArrayRef<const int> atomInfoForOptions(const gmx::BenchmarkSystem& system,
+                                                   const KernelBenchOptions&   options)
+{
+    if (options.useHalfLJOptimization)
+    {
+        return system.atomInfoOxygenVdw;
+    }
+    else
+    {
+        return system.atomInfoAllVdw;
+    }
+}
+
+//! Puts the atoms with \p coordinates in the rectangular \p box on the search grid of \p nbv
+static void putOnGrid(nonbonded_verlet_t*            nbv,
+                      const matrix                   box,
+                      gmx::ArrayRef<const gmx::RVec> coordinates,
+                      gmx::ArrayRef<const int>       atomInfo)
+{
+    GMX_RELEASE_ASSERT(!TRICLINIC(box), "Only rectangular unit-cells are supported here");
+    const rvec lowerCorner = { 0, 0, 0 };
+    const rvec upperCorner = { box[XX][XX], box[YY][YY], box[ZZ][ZZ] };
+
+    const real atomDensity = coordinates.size() / det(box);
+
+    nbnxn_put_on_grid(nbv, box, 0, lowerCorner, upperCorner, nullptr, { 0, int(coordinates.size()) },
+                      atomDensity, atomInfo, coordinates, 0, nullptr);
+}
+
+//! Puts the atoms of \p system on the search grid of \p nbv and constructs the pair list
+static void putOnGridAndSearch(nonbonded_verlet_t*         nbv,
+                               const gmx::BenchmarkSystem& system,
+                               gmx::ArrayRef<const int>    atomInfo)
+{
+    t_nrnb nrnb;
+
+    putOnGrid(nbv, system.box, system.coordinates, atomInfo);
+
+    nbv->constructPairlist(gmx::InteractionLocality::Local, &system.excls, 0, &nrnb);
+}
+
+/*! \brief Sets up and returns a Nbnxm object for the given benchmark options and system
+ *
+ * With \p useDynamicPruning the outer list uses a buffer of options.outerListBuffer.
+ */
 static std::unique_ptr<nonbonded_verlet_t> setupNbnxmForBenchInstance(const KernelBenchOptions& options,
-                                                                      const gmx::BenchmarkSystem& system)
+                                                                      const gmx::BenchmarkSystem& system,
+                                                                      const bool useDynamicPruning = false)
 {
     const auto pinPolicy  = (options.useGpu ? gmx::PinningPolicy::PinnedIfSupported
                                            : gmx::PinningPolicy::CannotBePinned);
@@ -183,14 +254,23 @@ static std::unique_ptr<nonbonded_verlet_t> setupNbnxmForBenchInstance(const Kern
     Nbnxm::KernelSetup kernelSetup = getKernelSetup(options);
 
     PairlistParams pairlistParams(kernelSetup.kernelType, false, options.pairlistCutoff, false);
+    if (useDynamicPruning)
+    {
+        pairlistParams.useDynamicPruning = true;
+        pairlistParams.rlistOuter        = options.pairlistCutoff + options.outerListBuffer;
+    }
+
+    const ColumnOrder columnOrder =
+            options.useHilbertColumnOrder ? ColumnOrder::Hilbert : ColumnOrder::Natural;
 
     GridSet gridSet(epbcXYZ, false, nullptr, nullptr, pairlistParams.pairlistType, false,
-                    numThreads, pinPolicy);
+                    columnOrder, numThreads, pinPolicy);
 
-    auto pairlistSets = std::make_unique<PairlistSets>(pairlistParams, false, 0);
+    auto pairlistSets = std::make_unique<PairlistSets>(pairlistParams, false, 0, nullptr, nullptr);
 
-    auto pairSearch = std::make_unique<PairSearch>(
-            epbcXYZ, false, nullptr, nullptr, pairlistParams.pairlistType, false, numThreads, pinPolicy);
+    auto pairSearch = std::make_unique<PairSearch>(epbcXYZ, false, nullptr, nullptr,
+                                                   pairlistParams.pairlistType, false, columnOrder,
+                                                   numThreads, pinPolicy);
 
     auto atomData = std::make_unique<nbnxn_atomdata_t>(pinPolicy);
 
@@ -201,29 +281,15 @@ static std::unique_ptr<nonbonded_verlet_t> setupNbnxmForBenchInstance(const Kern
     nbnxn_atomdata_init(gmx::MDLogger(), nbv->nbat.get(), kernelSetup.kernelType, combinationRule,
                         system.numAtomTypes, system.nonbondedParameters.data(), 1, numThreads);
 
-    t_nrnb nrnb;
-
-    GMX_RELEASE_ASSERT(!TRICLINIC(system.box), "Only rectangular unit-cells are supported here");
-    const rvec lowerCorner = { 0, 0, 0 };
-    const rvec upperCorner = { system.box[XX][XX], system.box[YY][YY], system.box[ZZ][ZZ] };
-
-    gmx::ArrayRef<const int> atomInfo;
-    if (options.useHalfLJOptimization)
-    {
-        atomInfo = system.atomInfoOxygenVdw;
-    }
-    else
+    if (options.useHalfPrecisionX)
     {
-        atomInfo = system.atomInfoAllVdw;
+        const bool haveHalfPrecisionX = nbv->nbat->setUseHalfPrecisionX(true);
+        GMX_RELEASE_ASSERT(haveHalfPrecisionX, "checkKernelSetup() should have caught this");
     }
 
-    const real atomDensity = system.coordinates.size() / det(system.box);
+    gmx::ArrayRef<const int> atomInfo = atomInfoForOptions(system, options);
 
-    nbnxn_put_on_grid(nbv.get(), system.box, 0, lowerCorner, upperCorner, nullptr,
-                      { 0, int(system.coordinates.size()) }, atomDensity, atomInfo,
-                      system.coordinates, 0, nullptr);
-
-    nbv->constructPairlist(gmx::InteractionLocality::Local, &system.excls, 0, &nrnb);
+    putOnGridAndSearch(nbv.get(), system, atomInfo);
 
     t_mdatoms mdatoms;
     // We only use (read) the atom type and charge from mdatoms
@@ -234,6 +300,74 @@ static std::unique_ptr<nonbonded_verlet_t> setupNbnxmForBenchInstance(const Kern
     return nbv;
 }
 
+//! Computes the forces for \p system with the kernel selected by \p options
+static std::vector<gmx::RVec> computeForces(const gmx::BenchmarkSystem& system,
+                                            const KernelBenchOptions&   options)
+{
+    std::unique_ptr<nonbonded_verlet_t> nbv = setupNbnxmForBenchInstance(options, system);
+
+    interaction_const_t ic = setupInteractionConst(options);
+
+    t_nrnb nrnb = { 0 };
+
+    gmx_enerdata_t enerd(1, 0);
+
+    gmx::StepWorkload stepWork;
+    stepWork.computeForces = true;
+
+    nbv->dispatchNonbondedKernel(gmx::InteractionLocality::Local, ic, stepWork, enbvClearFYes,
+                                 system.forceRec, &enerd, &nrnb);
+
+    std::vector<gmx::RVec> forces(system.coordinates.size(), { 0, 0, 0 });
+    nbv->atomdata_add_nbat_f_to_f(gmx::AtomLocality::Local, forces);
+
+    return forces;
+}
+
+/*! \brief Prints the force deviations of the kernel for \p options with
+ * full and half-precision j-coordinates with respect to the plain-C reference kernel
+ *
+ * Deviations are given relative to the RMS force of the reference kernel.
+ */
+static void reportHalfPrecisionAccuracy(const gmx::BenchmarkSystem& system,
+                                        const KernelBenchOptions&   options)
+{
+    KernelBenchOptions referenceOptions = options;
+    referenceOptions.nbnxmSimd          = BenchMarkKernels::SimdNo;
+    referenceOptions.useHalfPrecisionX  = false;
+    const std::vector<gmx::RVec> referenceForces = computeForces(system, referenceOptions);
+
+    double sumForce2 = 0;
+    for (const gmx::RVec& f : referenceForces)
+    {
+        sumForce2 += norm2(f);
+    }
+    const double rmsForce = std::sqrt(sumForce2 / referenceForces.size());
+
+    fprintf(stdout, "Force deviation relative to the RMS force of %g of the plain-C kernel:\n",
+            rmsForce);
+    for (const bool useHalfPrecisionX : { false, true })
+    {
+        KernelBenchOptions testOptions = options;
+        testOptions.useHalfPrecisionX  = useHalfPrecisionX;
+        const std::vector<gmx::RVec> forces = computeForces(system, testOptions);
+
+        double sumDeviation2 = 0;
+        double maxDeviation2 = 0;
+        for (size_t i = 0; i < forces.size(); i++)
+        {
+            gmx::RVec deviation = forces[i] - referenceForces[i];
+            sumDeviation2 += norm2(deviation);
+            maxDeviation2 = std::max(maxDeviation2, static_cast<double>(norm2(deviation)));
+        }
+        const double rmsDeviation = std::sqrt(sumDeviation2 / forces.size());
+        fprintf(stdout, "  %s j-coordinates:  RMS %10.3e  max %10.3e\n",
+                useHalfPrecisionX ? "half" : "full", rmsDeviation / rmsForce,
+                std::sqrt(maxDeviation2) / rmsForce);
+    }
+    fprintf(stdout, "\n");
+}
+
 //! Add the options instance to the list for all requested kernel SIMD types
 static void expandSimdOptionAndPushBack(const KernelBenchOptions&        options,
                                         std::vector<KernelBenchOptions>* optionsList)
@@ -263,13 +397,50 @@ static void expandSimdOptionAndPushBack(const KernelBenchOptions&        options
     }
 }
 
+//! Cache miss counters for each OpenMP thread
+using CacheMissCounterList = std::vector<std::unique_ptr<gmx::CacheMissCounters>>;
+
+/*! \brief Opens cache miss counters for each of the \p numThreads OpenMP threads
+ *
+ * Returns an empty list when the counters are not available.
+ */
+static CacheMissCounterList openCacheMissCounters(const int numThreads)
+{
+    CacheMissCounterList counters(numThreads);
+#pragma omp parallel for schedule(static) num_threads(numThreads)
+    for (int th = 0; th < numThreads; th++)
+    {
+        try
+        {
+            counters[th] = std::make_unique<gmx::CacheMissCounters>();
+        }
+        GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
+    }
+
+    fprintf(stdout, "Cache misses:         %s\n",
+            counters[0]->isAvailable() ? "L2 and L3 misses per useful pair"
+                                       : ("not available, " + counters[0]->unavailableReason()).c_str());
+    for (const auto& counter : counters)
+    {
+        if (!counter->isAvailable())
+        {
+            counters.clear();
+            break;
+        }
+    }
+
+    return counters;
+}
+
 //! Sets up and runs the requested benchmark instance and prints the results
 //
 // When \p doWarmup is true runs the warmup iterations instead
-// of the normal ones and does not print any results
+// of the normal ones and does not print any results.
+// When \p cacheMissCounters is not empty, also prints the cache misses.
 static void setupAndRunInstance(const gmx::BenchmarkSystem& system,
                                 const KernelBenchOptions&   options,
-                                const bool                  doWarmup)
+                                const bool                  doWarmup,
+                                const CacheMissCounterList& cacheMissCounters)
 {
     // Generate an, accurate, estimate of the number of non-zero pair interactions
     const real atomDensity = system.coordinates.size() / det(system.box);
@@ -318,6 +489,10 @@ static void setupAndRunInstance(const gmx::BenchmarkSystem& system,
     const int numIterations = (doWarmup ? options.numWarmupIterations : options.numIterations);
     const PairlistSet& pairlistSet = nbv->pairlistSets().pairlistSet(gmx::InteractionLocality::Local);
     const gmx::index numPairs = pairlistSet.natpair_ljq_ + pairlistSet.natpair_lj_ + pairlistSet.natpair_q_;
+    for (auto& counter : cacheMissCounters)
+    {
+        counter->start();
+    }
     gmx_cycles_t cycles = gmx_cycles_read();
     for (int iter = 0; iter < numIterations; iter++)
     {
@@ -326,21 +501,519 @@ static void setupAndRunInstance(const gmx::BenchmarkSystem& system,
                                      system.forceRec, &enerd, &nrnb);
     }
     cycles = gmx_cycles_read() - cycles;
+    int64_t numL2Misses = 0;
+    int64_t numL3Misses = 0;
+    for (auto& counter : cacheMissCounters)
+    {
+        counter->stop();
+        numL2Misses += counter->numL2Misses();
+        numL3Misses += counter->numL3Misses();
+    }
     if (!doWarmup)
     {
         const double dCycles = static_cast<double>(cycles);
         if (options.cyclesPerPair)
         {
-            fprintf(stdout, "%10.3f %10.4f %8.4f %8.4f\n", cycles * 1e-6,
+            fprintf(stdout, "%10.3f %10.4f %8.4f %8.4f", cycles * 1e-6,
                     dCycles / options.numIterations * 1e-6, dCycles / (options.numIterations * numPairs),
                     dCycles / (options.numIterations * numUsefulPairs));
         }
         else
         {
-            fprintf(stdout, "%10.3f %10.4f %8.4f %8.4f\n", dCycles * 1e-6,
+            fprintf(stdout, "%10.3f %10.4f %8.4f %8.4f", dCycles * 1e-6,
                     dCycles / options.numIterations * 1e-6, options.numIterations * numPairs / dCycles,
                     options.numIterations * numUsefulPairs / dCycles);
         }
+        if (!cacheMissCounters.empty())
+        {
+            fprintf(stdout, " %8.5f %8.5f", numL2Misses / (options.numIterations * numUsefulPairs),
+                    numL3Misses / (options.numIterations * numUsefulPairs));
+        }
+        fprintf(stdout, "\n");
+    }
+}
+
+namespace
+{
+
+//! The timings of a benchmark suite instance, in mega-cycles
+struct SuiteResult
+{
+    //! Name that identifies the setup
+    std::string name;
+    //! The number of atoms in the system
+    int numAtoms;
+    //! Cycles per non-bonded kernel call
+    double kernelMCycles;
+    //! Cycles for putting the atoms on the grid and constructing the pair list
+    double searchMCycles;
+    //! Cycles for reducing the non-bonded forces to the output force buffer
+    double reductionMCycles;
+};
+
+//! A point in the parameter space of the suite
+struct SuitePoint
+{
+    //! Multiplication factor for the system size
+    int sizeFactor;
+    //! Scaling factor for the atom density
+    real densityFactor;
+    //! The pairlist and interaction cut-off
+    real cutoff;
+    //! The LJ combination rule
+    BenchMarkCombRule combRule;
+};
+
+} // namespace
+
+//! Returns the name of the suite instance for system \p point run with \p options
+static std::string suiteInstanceName(const SuitePoint& point, const KernelBenchOptions& options)
+{
+    const gmx::EnumerationArray<BenchMarkKernels, const char*> kernelNames = { "auto", "no", "4xm",
+                                                                               "2xmm" };
+    const gmx::EnumerationArray<BenchMarkCombRule, const char*> combRuleNames = { "geom", "lb",
+                                                                                  "none" };
+
+    return gmx::formatString("size%d_density%.2f_cutoff%.3f_%s_%s%s_simd%s", point.sizeFactor,
+                             point.densityFactor, point.cutoff,
+                             options.coulombType == BenchMarkCoulomb::Pme ? "ewald" : "rf",
+                             combRuleNames[point.combRule],
+                             options.useHalfLJOptimization ? "_halflj" : "",
+                             kernelNames[options.nbnxmSimd]);
+}
+
+//! Runs the suite instance for \p system with \p options and returns the timings
+static SuiteResult runSuiteInstance(const gmx::BenchmarkSystem& system,
+                                    const SuitePoint&           point,
+                                    const KernelBenchOptions&   options)
+{
+    std::unique_ptr<nonbonded_verlet_t> nbv = setupNbnxmForBenchInstance(options, system);
+
+    interaction_const_t ic = setupInteractionConst(options);
+
+    t_nrnb nrnb = { 0 };
+
+    gmx_enerdata_t enerd(1, 0);
+
+    gmx::StepWorkload stepWork;
+    stepWork.computeForces = true;
+    if (options.computeVirialAndEnergy)
+    {
+        stepWork.computeVirial = true;
+        stepWork.computeEnergy = true;
+    }
+
+    // Keep the run time roughly independent of the system size
+    const int numIterations = std::max(1, options.numIterations / point.sizeFactor);
+    const int numSearches   = std::max(1, numIterations / 10);
+
+    SuiteResult result;
+    result.name     = suiteInstanceName(point, options);
+    result.numAtoms = system.coordinates.size();
+
+    // Run pre-iteration to avoid cache misses
+    nbv->dispatchNonbondedKernel(gmx::InteractionLocality::Local, ic, stepWork, enbvClearFYes,
+                                 system.forceRec, &enerd, &nrnb);
+
+    gmx_cycles_t cycles = gmx_cycles_read();
+    for (int iter = 0; iter < numIterations; iter++)
+    {
+        nbv->dispatchNonbondedKernel(gmx::InteractionLocality::Local, ic, stepWork, enbvClearFNo,
+                                     system.forceRec, &enerd, &nrnb);
+    }
+    result.kernelMCycles = static_cast<double>(gmx_cycles_read() - cycles) / numIterations * 1e-6;
+
+    std::vector<gmx::RVec> forces(system.coordinates.size(), { 0, 0, 0 });
+    cycles = gmx_cycles_read();
+    for (int iter = 0; iter < numIterations; iter++)
+    {
+        nbv->atomdata_add_nbat_f_to_f(gmx::AtomLocality::Local, forces);
+    }
+    result.reductionMCycles = static_cast<double>(gmx_cycles_read() - cycles) / numIterations * 1e-6;
+
+    gmx::ArrayRef<const int> atomInfo = atomInfoForOptions(system, options);
+    cycles                            = gmx_cycles_read();
+    for (int search = 0; search < numSearches; search++)
+    {
+        putOnGridAndSearch(nbv.get(), system, atomInfo);
+    }
+    result.searchMCycles = static_cast<double>(gmx_cycles_read() - cycles) / numSearches * 1e-6;
+
+    fprintf(stdout, "%-52s %7d %10.4f %10.4f %10.4f\n", result.name.c_str(), result.numAtoms,
+            result.kernelMCycles, result.searchMCycles, result.reductionMCycles);
+
+    return result;
+}
+
+//! The format of a result line in the suite JSON output, also used for reading
+static const char* c_suiteResultFormat =
+        "    { \"name\": \"%s\", \"atoms\": %d, \"kernelMCycles\": %g, \"searchMCycles\": %g, "
+        "\"reductionMCycles\": %g }";
+
+//! Writes the suite results to a JSON file with name \p fileName
+static void writeSuiteResults(const std::string&               fileName,
+                              const KernelBenchOptions&        options,
+                              gmx::ArrayRef<const SuiteResult> results)
+{
+    FILE* fp = gmx_ffopen(fileName, "w");
+    fprintf(fp, "{\n");
+    fprintf(fp, "  \"simdWidth\": %d,\n", GMX_SIMD ? GMX_SIMD_REAL_WIDTH : 1);
+    fprintf(fp, "  \"doublePrecision\": %s,\n", GMX_DOUBLE ? "true" : "false");
+    fprintf(fp, "  \"numThreads\": %d,\n", options.numThreads);
+    fprintf(fp, "  \"computeEnergies\": %s,\n", options.computeVirialAndEnergy ? "true" : "false");
+    fprintf(fp, "  \"results\": [\n");
+    for (gmx::index i = 0; i < results.ssize(); i++)
+    {
+        const SuiteResult& result = results[i];
+        fprintf(fp, c_suiteResultFormat, result.name.c_str(), result.numAtoms,
+                result.kernelMCycles, result.searchMCycles, result.reductionMCycles);
+        fprintf(fp, "%s\n", i + 1 < results.ssize() ? "," : "");
+    }
+    fprintf(fp, "  ]\n");
+    fprintf(fp, "}\n");
+    gmx_ffclose(fp);
+
+    fprintf(stdout, "\nWrote the results to %s\n", fileName.c_str());
+}
+
+/*! \brief Reads suite results from the JSON file \p fileName
+ *
+ * Only files written by writeSuiteResults() are supported, one result per line.
+ */
+static std::vector<SuiteResult> readSuiteResults(const std::string& fileName)
+{
+    std::vector<SuiteResult> results;
+
+    gmx::TextReader reader(fileName);
+    std::string     line;
+    while (reader.readLine(&line))
+    {
+        char        name[256];
+        SuiteResult result;
+        if (sscanf(line.c_str(),
+                   " { \"name\": \"%255[^\"]\", \"atoms\": %d, \"kernelMCycles\": %lf, "
+                   "\"searchMCycles\": %lf, \"reductionMCycles\": %lf",
+                   name, &result.numAtoms, &result.kernelMCycles, &result.searchMCycles,
+                   &result.reductionMCycles)
+            == 5)
+        {
+            result.name = name;
+            results.push_back(result);
+        }
+    }
+
+    if (results.empty())
+    {
+        gmx_fatal(FARGS, "No benchmark results found in baseline file '%s'", fileName.c_str());
+    }
+
+    return results;
+}
+
+/*! \brief Compares \p results to the baseline in \p baselineFileName and prints the differences
+ *
+ * \returns the number of results slower than the baseline by more than \p tolerance
+ */
+static int compareToBaseline(gmx::ArrayRef<const SuiteResult> results,
+                             const std::string&               baselineFileName,
+                             const real                       tolerance)
+{
+    const std::vector<SuiteResult> baseline = readSuiteResults(baselineFileName);
+
+    fprintf(stdout, "\nComparing to baseline %s with a tolerance of %g%%\n",
+            baselineFileName.c_str(), 100 * tolerance);
+
+    int numRegressions = 0;
+    int numMissing     = 0;
+    for (const SuiteResult& result : results)
+    {
+        const auto reference =
+                std::find_if(baseline.begin(), baseline.end(),
+                             [&result](const SuiteResult& r) { return r.name == result.name; });
+        if (reference == baseline.end())
+        {
+            numMissing++;
+            continue;
+        }
+
+        const std::array<const char*, 3> parts  = { "kernel", "search", "reduction" };
+        const std::array<double, 3>      values = { result.kernelMCycles, result.searchMCycles,
+                                               result.reductionMCycles };
+        const std::array<double, 3>      referenceValues = { reference->kernelMCycles,
+                                                        reference->searchMCycles,
+                                                        reference->reductionMCycles };
+
+        bool isSlower = false;
+        for (size_t i = 0; i < parts.size(); i++)
+        {
+            if (values[i] > (1 + tolerance) * referenceValues[i])
+            {
+                fprintf(stdout, "  Regression: %-52s %-9s %10.4f vs %10.4f Mcycles (+%.1f%%)\n",
+                        result.name.c_str(), parts[i], values[i], referenceValues[i],
+                        100 * (values[i] / referenceValues[i] - 1));
+                isSlower = true;
+            }
+        }
+        if (isSlower)
+        {
+            numRegressions++;
+        }
+    }
+
+    if (numMissing > 0)
+    {
+        fprintf(stdout, "  %d of %zu setups were not present in the baseline\n", numMissing,
+                results.size());
+    }
+    fprintf(stdout, "  %d of %zu setups are slower than the baseline\n", numRegressions,
+            results.size());
+
+    return numRegressions;
+}
+
+bool isValidSuiteMaxSizeFactor(const int sizeFactor)
+{
+    int powerOf8 = 1;
+    while (powerOf8 < sizeFactor)
+    {
+        powerOf8 *= 8;
+    }
+
+    return (sizeFactor >= 1 && powerOf8 == sizeFactor);
+}
+
+int benchSuite(const KernelBenchOptions& options)
+{
+    gmx_omp_nthreads_set(emntPairsearch, options.numThreads);
+    gmx_omp_nthreads_set(emntNonbonded, options.numThreads);
+
+    if (!isValidSuiteMaxSizeFactor(options.suiteMaxSizeFactor))
+    {
+        gmx_fatal(FARGS, "The maximum size factor for the suite has to be a power of 8");
+    }
+
+    // We sweep each parameter separately around the base setup given by the options
+    const SuitePoint        base = { 1, 1.0_real, options.pairlistCutoff, options.ljCombinationRule };
+    std::vector<SuitePoint> points;
+    // From cache resident to memory bound
+    for (int sizeFactor = 1; sizeFactor <= options.suiteMaxSizeFactor; sizeFactor *= 8)
+    {
+        points.push_back(base);
+        points.back().sizeFactor = sizeFactor;
+    }
+    for (real densityFactor : { 0.75_real, 1.25_real })
+    {
+        points.push_back(base);
+        points.back().densityFactor = densityFactor;
+    }
+    for (real cutoffFactor : { 0.9_real, 1.2_real })
+    {
+        points.push_back(base);
+        points.back().cutoff = cutoffFactor * options.pairlistCutoff;
+    }
+    gmx::EnumerationWrapper<BenchMarkCombRule> combRuleIter;
+    for (auto combRule : combRuleIter)
+    {
+        if (combRule != base.combRule)
+        {
+            points.push_back(base);
+            points.back().combRule = combRule;
+        }
+    }
+
+#if GMX_SIMD
+    fprintf(stdout, "SIMD width:           %d\n", GMX_SIMD_REAL_WIDTH);
+#endif
+    fprintf(stdout, "Number of threads:    %d\n", options.numThreads);
+    fprintf(stdout, "Number of iterations: %d, divided by the size factor\n", options.numIterations);
+    fprintf(stdout, "Compute energies:     %s\n", options.computeVirialAndEnergy ? "yes" : "no");
+    fprintf(stdout, "\n%-52s %7s %10s %10s %10s\n", "Setup", "atoms", "kernel", "search",
+            "reduction");
+    fprintf(stdout, "%-52s %7s %10s %10s %10s\n", "", "", "Mcycles/it", "Mcycles", "Mcycles/it");
+
+    std::vector<SuiteResult> results;
+    for (const SuitePoint& point : points)
+    {
+        const gmx::BenchmarkSystem system(point.sizeFactor, point.densityFactor);
+
+        real minBoxSize = norm(system.box[XX]);
+        for (int dim = YY; dim < DIM; dim++)
+        {
+            minBoxSize = std::min(minBoxSize, norm(system.box[dim]));
+        }
+        if (point.cutoff > 0.5 * minBoxSize)
+        {
+            fprintf(stdout, "Skipping cut-off %g, which is longer than half the box size\n",
+                    point.cutoff);
+            continue;
+        }
+
+        KernelBenchOptions pointOptions = options;
+        pointOptions.pairlistCutoff     = point.cutoff;
+        pointOptions.ljCombinationRule  = point.combRule;
+        // For fixed relative tolerance the Ewald coefficient is inversely proportional to the cut-off
+        pointOptions.ewaldcoeff_q = options.ewaldcoeff_q * options.pairlistCutoff / point.cutoff;
+
+        std::vector<KernelBenchOptions> optionsList;
+        expandSimdOptionAndPushBack(pointOptions, &optionsList);
+        if (options.nbnxmSimd == BenchMarkKernels::SimdAuto
+            && optionsList.back().nbnxmSimd != BenchMarkKernels::SimdNo)
+        {
+            // Also run the plain-C kernel, as this is the fallback for all setups
+            optionsList.push_back(pointOptions);
+            optionsList.back().nbnxmSimd = BenchMarkKernels::SimdNo;
+        }
+
+        for (const KernelBenchOptions& optionsInstance : optionsList)
+        {
+            if (checkKernelSetup(optionsInstance))
+            {
+                continue;
+            }
+            results.push_back(runSuiteInstance(system, point, optionsInstance));
+        }
+    }
+
+    if (!options.jsonFileName.empty())
+    {
+        writeSuiteResults(options.jsonFileName, options, results);
+    }
+
+    int numRegressions = 0;
+    if (!options.baselineFileName.empty())
+    {
+        numRegressions = compareToBaseline(results, options.baselineFileName, options.baselineTolerance);
+    }
+
+    return numRegressions;
+}
+
+/*! \brief Returns \p coordinates with each coordinate displaced by a uniform random value
+ * in [-\p maxDisplacement, \p maxDisplacement), put in the rectangular \p box
+ */
+static std::vector<gmx::RVec> perturbCoordinates(gmx::ArrayRef<const gmx::RVec> coordinates,
+                                                 const matrix                   box,
+                                                 const real                     maxDisplacement,
+                                                 gmx::DefaultRandomEngine*      rng)
+{
+    gmx::UniformRealDistribution<real> distribution(-maxDisplacement, maxDisplacement);
+
+    std::vector<gmx::RVec> perturbed(coordinates.begin(), coordinates.end());
+    for (gmx::RVec& x : perturbed)
+    {
+        for (int d = 0; d < DIM; d++)
+        {
+            x[d] += distribution(*rng);
+        }
+    }
+    put_atoms_in_box(epbcXYZ, box, perturbed);
+
+    return perturbed;
+}
+
+void benchSearch(const int sizeFactor, const KernelBenchOptions& options)
+{
+    const gmx::BenchmarkSystem system(sizeFactor);
+
+    real minBoxSize = norm(system.box[XX]);
+    for (int dim = YY; dim < DIM; dim++)
+    {
+        minBoxSize = std::min(minBoxSize, norm(system.box[dim]));
+    }
+    if (options.pairlistCutoff + options.outerListBuffer > 0.5 * minBoxSize)
+    {
+        gmx_fatal(FARGS, "The outer list cut-off should be shorter than half the box size");
+    }
+
+    // Only the cluster setup of the kernel matters, so we time a single kernel type
+    std::vector<KernelBenchOptions> optionsList;
+    expandSimdOptionAndPushBack(options, &optionsList);
+    const KernelBenchOptions& kernelOptions = optionsList[0];
+
+    auto messageWhenInvalid = checkKernelSetup(kernelOptions);
+    if (messageWhenInvalid)
+    {
+        gmx_fatal(FARGS, "Requested kernel is unavailable because %s.", messageWhenInvalid->c_str());
+    }
+
+    std::vector<int> threadCounts;
+    for (int numThreads = 1; numThreads < options.numThreads; numThreads *= 2)
+    {
+        threadCounts.push_back(numThreads);
+    }
+    threadCounts.push_back(options.numThreads);
+
+    const gmx::EnumerationArray<BenchMarkKernels, std::string> kernelNames = { "auto", "no", "4xM",
+                                                                               "2xMM" };
+
+    fprintf(stdout, "System size:          %zu atoms\n", system.coordinates.size());
+    fprintf(stdout, "Kernel cluster setup: %s\n", kernelNames[kernelOptions.nbnxmSimd].c_str());
+    fprintf(stdout, "Inner list cut-off:   %g nm\n", options.pairlistCutoff);
+    fprintf(stdout, "Outer list cut-off:   %g nm\n", options.pairlistCutoff + options.outerListBuffer);
+    fprintf(stdout, "Number of iterations: %d\n", options.numIterations);
+    fprintf(stdout, "Max. displacement:    %g nm\n", options.searchDisplacement);
+    fprintf(stdout, "Grid column order:    %s\n",
+            options.useHilbertColumnOrder ? "Hilbert curve" : "natural");
+    fprintf(stdout, "\n");
+    fprintf(stdout, "Threads     grid   pairlist      prune      total  speedup\n");
+    fprintf(stdout, "        (Mcycles per iteration)\n");
+
+    gmx::ArrayRef<const int> atomInfo = atomInfoForOptions(system, kernelOptions);
+
+    double totalMCyclesOneThread = 0;
+    for (const int numThreads : threadCounts)
+    {
+        gmx_omp_nthreads_set(emntPairsearch, numThreads);
+        gmx_omp_nthreads_set(emntNonbonded, numThreads);
+
+        KernelBenchOptions threadOptions = kernelOptions;
+        threadOptions.numThreads         = numThreads;
+
+        std::unique_ptr<nonbonded_verlet_t> nbv =
+                setupNbnxmForBenchInstance(threadOptions, system, options.outerListBuffer > 0);
+
+        // Use the same sequence of coordinates for all thread counts
+        gmx::DefaultRandomEngine rng(c_searchBenchmarkSeed);
+
+        t_nrnb nrnb;
+
+        gmx_cycles_t gridCycles     = 0;
+        gmx_cycles_t pairlistCycles = 0;
+        gmx_cycles_t pruneCycles    = 0;
+        for (int iter = 0; iter < options.numIterations; iter++)
+        {
+            const std::vector<gmx::RVec> coordinates = perturbCoordinates(
+                    system.coordinates, system.box, options.searchDisplacement, &rng);
+
+            gmx_cycles_t cycles = gmx_cycles_read();
+            putOnGrid(nbv.get(), system.box, coordinates, atomInfo);
+            gridCycles += gmx_cycles_read() - cycles;
+
+            cycles = gmx_cycles_read();
+            nbv->constructPairlist(gmx::InteractionLocality::Local, &system.excls, iter, &nrnb);
+            pairlistCycles += gmx_cycles_read() - cycles;
+
+            if (options.outerListBuffer > 0)
+            {
+                cycles = gmx_cycles_read();
+                nbv->dispatchPruneKernelCpu(gmx::InteractionLocality::Local,
+                                            system.forceRec.shift_vec);
+                pruneCycles += gmx_cycles_read() - cycles;
+            }
+        }
+
+        const double toMCyclesPerIteration = 1e-6 / options.numIterations;
+        const double gridMCycles           = gridCycles * toMCyclesPerIteration;
+        const double pairlistMCycles       = pairlistCycles * toMCyclesPerIteration;
+        const double pruneMCycles          = pruneCycles * toMCyclesPerIteration;
+        const double totalMCycles          = gridMCycles + pairlistMCycles + pruneMCycles;
+        if (numThreads == 1)
+        {
+            totalMCyclesOneThread = totalMCycles;
+        }
+
+        fprintf(stdout, "%7d %8.4f %10.4f %10.4f %10.4f %8.2f\n", numThreads, gridMCycles,
+                pairlistMCycles, pruneMCycles, totalMCycles, totalMCyclesOneThread / totalMCycles);
     }
 }
 
@@ -405,6 +1078,9 @@ void bench(const int sizeFactor, const KernelBenchOptions& options)
     fprintf(stdout, "Number of threads:    %d\n", options.numThreads);
     fprintf(stdout, "Number of iterations: %d\n", options.numIterations);
     fprintf(stdout, "Compute energies:     %s\n", options.computeVirialAndEnergy ? "yes" : "no");
+    fprintf(stdout, "Half-precision x:     %s\n", options.useHalfPrecisionX ? "yes" : "no");
+    fprintf(stdout, "Grid column order:    %s\n",
+            options.useHilbertColumnOrder ? "Hilbert curve" : "natural");
     if (options.coulombType != BenchMarkCoulomb::ReactionField)
     {
         fprintf(stdout, "Ewald excl. corr.:    %s\n",
@@ -412,20 +1088,41 @@ void bench(const int sizeFactor, const KernelBenchOptions& options)
                         ? "table"
                         : "analytical");
     }
+    CacheMissCounterList cacheMissCounters;
+    if (options.measureCacheMisses)
+    {
+        cacheMissCounters = openCacheMissCounters(options.numThreads);
+    }
     printf("\n");
 
+    if (options.useHalfPrecisionX)
+    {
+        for (const auto& optionsInstance : optionsList)
+        {
+            auto messageWhenInvalid = checkKernelSetup(optionsInstance);
+            if (messageWhenInvalid)
+            {
+                gmx_fatal(FARGS, "Requested kernel is unavailable because %s.",
+                          messageWhenInvalid->c_str());
+            }
+        }
+        reportHalfPrecisionAccuracy(system, optionsList[0]);
+    }
+
     if (options.numWarmupIterations > 0)
     {
-        setupAndRunInstance(system, optionsList[0], true);
+        setupAndRunInstance(system, optionsList[0], true, cacheMissCounters);
     }
 
-    fprintf(stdout, "Coulomb LJ   comb. SIMD    Mcycles  Mcycles/it.   %s\n",
-            options.cyclesPerPair ? "cycles/pair" : "pairs/cycle");
-    fprintf(stdout, "                                                total    useful\n");
+    fprintf(stdout, "Coulomb LJ   comb. SIMD    Mcycles  Mcycles/it.   %s%s\n",
+            options.cyclesPerPair ? "cycles/pair" : "pairs/cycle",
+            cacheMissCounters.empty() ? "" : "     misses/pair");
+    fprintf(stdout, "                                                total    useful%s\n",
+            cacheMissCounters.empty() ? "" : "       L2       L3");
 
     for (const auto& optionsInstance : optionsList)
     {
-        setupAndRunInstance(system, optionsInstance, false);
+        setupAndRunInstance(system, optionsInstance, false, cacheMissCounters);
     }
 }
 
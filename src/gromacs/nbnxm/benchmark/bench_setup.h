@@ -46,6 +46,8 @@
 #ifndef GMX_NBNXN_BENCH_SETUP_H
 #define GMX_NBNXN_BENCH_SETUP_H
 
+#include <string>
+
 #include "gromacs/utility/real.h"
 
 namespace Nbnxm
@@ -113,6 +115,24 @@ struct KernelBenchOptions
     int numWarmupIterations = 0;
     //! Print cycles/pair instead of pairs/cycle
     bool cyclesPerPair = false;
+    //! Store j-coordinates in half precision and report the force accuracy, SIMD kernels only
+    bool useHalfPrecisionX = false;
+    //! Order the columns of the search grid along a Hilbert curve
+    bool useHilbertColumnOrder = false;
+    //! Report the L2 and L3 cache misses per pair of the kernels, when hardware counters are available
+    bool measureCacheMisses = false;
+    //! The buffer added to the cut-off for the outer list with dynamic pruning in the search benchmark, no pruning when 0
+    real outerListBuffer = 0.1;
+    //! The maximum random displacement of coordinates between search benchmark iterations
+    real searchDisplacement = 0.01;
+    //! The maximum system size factor for the benchmark suite, has to be a power of 8
+    int suiteMaxSizeFactor = 64;
+    //! The name of the JSON file to write the suite results to, no output when empty
+    std::string jsonFileName;
+    //! The name of the JSON file with baseline suite results to compare to, no comparison when empty
+    std::string baselineFileName;
+    //! The relative slowdown with respect to the baseline that is reported as a regression
+    real baselineTolerance = 0.1;
 };
 
 /*! \brief
@@ -128,6 +148,41 @@ struct KernelBenchOptions
  */
 void bench(int sizeFactor, const KernelBenchOptions& options);
 
+/*! \brief
+ * Benchmarks the stages of the pair search for a range of thread counts
+ *
+ * Times putting the atoms on the grid, constructing the pair list and,
+ * when options.outerListBuffer > 0, dynamic pruning, separately for thread
+ * counts of powers of 2 up to options.numThreads. The coordinates are
+ * perturbed randomly between iterations to mimic the atom motion between
+ * search steps. Timings are printed to stdout.
+ *
+ * \param[in] sizeFactor How much should the system size be increased.
+ * \param[in] options How the benchmark will be run.
+ */
+void benchSearch(int sizeFactor, const KernelBenchOptions& options);
+
+//! Returns whether \p sizeFactor is a valid maximum size factor for the suite, i.e. a power of 8
+bool isValidSuiteMaxSizeFactor(int sizeFactor);
+
+/*! \brief
+ * Runs a suite of benchmarks for the kernels, pair search and force reduction
+ *
+ * Starting from the water box of 3000 atoms with the settings in \p options,
+ * the suite separately sweeps the system size, from 1 to
+ * options.suiteMaxSizeFactor times the base size in factors of 8,
+ * the atom density, the cut-off and the LJ combination rule.
+ * Each setup is run with all supported SIMD kernel types and the plain-C
+ * kernel. The results are printed to stdout and written to
+ * options.jsonFileName when set. When options.baselineFileName is set,
+ * the results are compared to the baseline results in that file.
+ *
+ * \param[in] options  How the benchmarks will be run.
+ * \returns the number of results that are slower than the baseline
+ *          by more than options.baselineTolerance
+ */
+int benchSuite(const KernelBenchOptions& options);
+
 } // namespace Nbnxm
 
 #endif
@@ -45,6 +45,8 @@
 
 #include "bench_system.h"
 
+#include <cmath>
+
 #include <vector>
 
 #include "gromacs/math/vec.h"
@@ -149,7 +151,31 @@ static void generateCoordinates(int multiplicationFactor, std::vector<gmx::RVec>
     }
 }
 
-BenchmarkSystem::BenchmarkSystem(const int multiplicationFactor)
+//! Scales the atom density by \p densityFactor by displacing the molecules and scaling the box
+static void scaleDensity(const real densityFactor, std::vector<gmx::RVec>* coordinates, matrix box)
+{
+    const real scalingFactor = std::cbrt(1 / densityFactor);
+
+    for (size_t firstAtom = 0; firstAtom < coordinates->size(); firstAtom += numAtomsInMolecule)
+    {
+        // We displace all atoms of the molecule with the first atom
+        const gmx::RVec displacement = (scalingFactor - 1) * (*coordinates)[firstAtom];
+        for (int a = 0; a < numAtomsInMolecule; a++)
+        {
+            (*coordinates)[firstAtom + a] += displacement;
+        }
+    }
+
+    for (int d1 = 0; d1 < DIM; d1++)
+    {
+        for (int d2 = 0; d2 < DIM; d2++)
+        {
+            box[d1][d2] *= scalingFactor;
+        }
+    }
+}
+
+BenchmarkSystem::BenchmarkSystem(const int multiplicationFactor, const real densityFactor)
 {
     numAtomTypes = 2;
     nonbondedParameters.resize(numAtomTypes * numAtomTypes * 2, 0);
@@ -157,6 +183,14 @@ BenchmarkSystem::BenchmarkSystem(const int multiplicationFactor)
     nonbondedParameters[1] = c12Oxygen;
 
     generateCoordinates(multiplicationFactor, &coordinates, box);
+    if (densityFactor <= 0)
+    {
+        gmx_fatal(FARGS, "The density factor should be positive");
+    }
+    if (densityFactor != 1)
+    {
+        scaleDensity(densityFactor, &coordinates, box);
+    }
     put_atoms_in_box(epbcXYZ, box, coordinates);
 
     int numAtoms = coordinates.size();
@@ -61,11 +61,13 @@ struct BenchmarkSystem
      *
      * Generates a benchmark system of size \p multiplicationFactor
      * times the base size by stacking cubic boxes of 1000 water molecules
-     * with 3000 atoms total.
+     * with 3000 atoms total. The molecules are then displaced to scale
+     * the atom density by \p densityFactor, keeping the molecules rigid.
      *
      * \param[in] multiplicationFactor  Should be a power of 2, is checked
+     * \param[in] densityFactor         Scaling factor for the density
      */
-    BenchmarkSystem(int multiplicationFactor);
+    BenchmarkSystem(int multiplicationFactor, real densityFactor = 1);
 
     //! Number of different atom types in test system.
     int numAtomTypes;
@@ -296,11 +296,11 @@ static void init_nbparam(cu_nbparam_t*                   nbp,
     {
         nbp->eeltype = eelCuCUT;
     }
-    else if (EEL_RF(ic->eeltype))
+    else if (EEL_RF(ic->eeltype) || ic->eeltype == eelFMM)
     {
         nbp->eeltype = eelCuRF;
     }
-    else if ((EEL_PME(ic->eeltype) || ic->eeltype == eelEWALD))
+    else if (EEL_PME_EWALD(ic->eeltype))
     {
         nbp->eeltype = pick_ewald_kernel_type(*ic);
     }
@@ -0,0 +1,187 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2020, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+
+/*! \internal \file
+ *
+ * \brief
+ * Implements the DynamicPruningTuner class
+ *
+ * \ingroup module_nbnxm
+ */
+
+#include "gmxpre.h"
+
+#include "dynamicpruningtuner.h"
+
+#include <cstdio>
+
+#include <algorithm>
+#include <utility>
+
+#include "gromacs/utility/fatalerror.h"
+#include "gromacs/utility/gmxassert.h"
+
+#include "pairlistparams.h"
+
+namespace Nbnxm
+{
+
+/*! \brief The number of outer list lifetimes to average the cost over
+ *
+ * Steps where energies are computed have a more expensive non-bonded kernel,
+ * averaging over multiple lists reduces the noise due to these.
+ */
+static constexpr int c_numListsPerMeasurement = 4;
+
+//! The number of outer lists after which we repeat the search for the optimal interval
+static constexpr int c_numListsBetweenTuning = 1000;
+
+DynamicPruningTuner::DynamicPruningTuner(const PairlistParams& listParams,
+                                         std::vector<real>     rlistInner,
+                                         const int             nstlistPruneMin) :
+    nstlist_(listParams.lifetime + 1),
+    rlistOuterReference_(listParams.rlistOuter),
+    rlistInner_(std::move(rlistInner)),
+    nstlistPruneMin_(nstlistPruneMin),
+    nstlistPruneMax_(static_cast<int>(rlistInner_.size()) - 1),
+    nstlistPrune_(listParams.nstlistPrune),
+    costPerStep_(rlistInner_.size(), -1)
+{
+    GMX_RELEASE_ASSERT(listParams.useDynamicPruning, "Can only tune with dynamic pruning");
+    GMX_RELEASE_ASSERT(nstlistPrune_ >= nstlistPruneMin_ && nstlistPrune_ <= nstlistPruneMax_,
+                       "The initial pruning interval should be within the tuning range");
+}
+
+real DynamicPruningTuner::rlistInner(const int nstlistPrune, const real rlistOuter) const
+{
+    /* We assume that the inner buffer does not depend on the cut-off,
+     * as is also done with PME load balancing.
+     */
+    return rlistOuter - (rlistOuterReference_ - rlistInner_[nstlistPrune]);
+}
+
+void DynamicPruningTuner::reset()
+{
+    std::fill(costPerStep_.begin(), costPerStep_.end(), -1);
+    haveConverged_     = false;
+    numListsMeasured_  = 0;
+    measurementCycles_ = 0;
+    measurementSteps_  = 0;
+    cycles_            = 0;
+    numSteps_          = 0;
+}
+
+bool DynamicPruningTuner::isUnmeasured(const int nstlistPrune) const
+{
+    return (nstlistPrune >= nstlistPruneMin_ && nstlistPrune <= nstlistPruneMax_
+            && cost(nstlistPrune) < 0);
+}
+
+int DynamicPruningTuner::endListLifetime()
+{
+    /* Only use lists that were used for the full lifetime, so we do not
+     * count the steps before the first search or lists ended prematurely.
+     */
+    if (numSteps_ == nstlist_)
+    {
+        measurementCycles_ += static_cast<double>(cycles_);
+        measurementSteps_ += numSteps_;
+        numListsMeasured_++;
+    }
+    cycles_   = 0;
+    numSteps_ = 0;
+
+    if (haveConverged_)
+    {
+        numListsUntilRetuning_--;
+        if (numListsUntilRetuning_ <= 0)
+        {
+            reset();
+        }
+        return nstlistPrune_;
+    }
+
+    if (numListsMeasured_ < c_numListsPerMeasurement)
+    {
+        return nstlistPrune_;
+    }
+
+    costPerStep_[nstlistPrune_] = measurementCycles_ / measurementSteps_;
+    numListsMeasured_           = 0;
+    measurementCycles_          = 0;
+    measurementSteps_           = 0;
+
+    if (debug)
+    {
+        fprintf(debug, "Dynamic pruning interval %d costs %.3f Mcycles per step\n", nstlistPrune_,
+                costPerStep_[nstlistPrune_] * 1e-6);
+    }
+
+    /* Move from the best measured interval to an unmeasured neighbor,
+     * we have converged when both neighbors are measured.
+     */
+    int best = nstlistPrune_;
+    for (int nstlistPrune = nstlistPruneMin_; nstlistPrune <= nstlistPruneMax_; nstlistPrune++)
+    {
+        if (cost(nstlistPrune) >= 0 && cost(nstlistPrune) < cost(best))
+        {
+            best = nstlistPrune;
+        }
+    }
+    if (isUnmeasured(best + 1))
+    {
+        nstlistPrune_ = best + 1;
+    }
+    else if (isUnmeasured(best - 1))
+    {
+        nstlistPrune_ = best - 1;
+    }
+    else
+    {
+        nstlistPrune_          = best;
+        haveConverged_         = true;
+        numListsUntilRetuning_ = c_numListsBetweenTuning;
+
+        if (debug)
+        {
+            fprintf(debug, "Tuned the dynamic pruning interval to %d, rlistInner %.3f nm\n",
+                    nstlistPrune_, rlistInner_[nstlistPrune_]);
+        }
+    }
+
+    return nstlistPrune_;
+}
+
+} // namespace Nbnxm
@@ -0,0 +1,153 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2020, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+
+/*! \internal \file
+ *
+ * \brief
+ * Declares the DynamicPruningTuner class
+ *
+ * \ingroup module_nbnxm
+ */
+
+#ifndef GMX_NBNXM_DYNAMICPRUNINGTUNER_H
+#define GMX_NBNXM_DYNAMICPRUNINGTUNER_H
+
+#include <vector>
+
+#include "gromacs/timing/cyclecounter.h"
+#include "gromacs/utility/real.h"
+
+struct PairlistParams;
+
+namespace Nbnxm
+{
+
+/*! \internal
+ * \brief Tunes the dynamic pruning interval of CPU pair lists at runtime
+ *
+ * With dynamic pruning the cost of the pruning kernel has to be balanced
+ * against the cost of computing zero interactions in the non-bonded
+ * kernel due to the inner list buffer. This class measures the cycles
+ * spent in both kernels over the lifetime of each outer list and
+ * searches for the pruning interval with the lowest cost per step.
+ * For each interval the inner list radius is set such that the energy
+ * drift tolerance is satisfied. Since the optimum can change during
+ * a run, the search is repeated after a fixed number of lists.
+ *
+ * With domain decomposition each rank tunes its own interval, based
+ * on the cost of its own kernels. As this can give different intervals
+ * on different ranks, which can affect load balance, tuning is only
+ * enabled on request.
+ */
+class DynamicPruningTuner
+{
+public:
+    /*! \brief Constructor
+     *
+     * \param[in] listParams  The pair list parameters with dynamic pruning set up
+     * \param[in] rlistInner  The inner list radius for each pruning interval,
+     *                        with an outer radius of listParams.rlistOuter
+     * \param[in] nstlistPruneMin  The minimum pruning interval to consider
+     */
+    DynamicPruningTuner(const PairlistParams& listParams,
+                        std::vector<real>     rlistInner,
+                        int                   nstlistPruneMin);
+
+    //! Starts timing a pruning or non-bonded kernel call
+    void startTiming() { cycleStart_ = gmx_cycles_read(); }
+
+    //! Stops timing a pruning or non-bonded kernel call
+    void stopTiming() { addCycles(gmx_cycles_read() - cycleStart_); }
+
+    //! Adds \p cycles spent in pruning or non-bonded kernels with the current list
+    void addCycles(gmx_cycles_t cycles) { cycles_ += cycles; }
+
+    //! Registers that a step was computed with the current list
+    void addStep() { numSteps_++; }
+
+    /*! \brief Ends the lifetime of the current outer list
+     *
+     * \returns the pruning interval to use for the next outer list
+     */
+    int endListLifetime();
+
+    //! Returns the inner list radius for \p nstlistPrune when the outer radius is \p rlistOuter
+    real rlistInner(int nstlistPrune, real rlistOuter) const;
+
+    //! Discards all measurements, should be called when the cost of the kernels changes
+    void reset();
+
+private:
+    //! Returns the measured cost for \p nstlistPrune, negative when not measured
+    double cost(int nstlistPrune) const { return costPerStep_[nstlistPrune]; }
+
+    //! Returns whether \p nstlistPrune is a valid pruning interval that has not been measured
+    bool isUnmeasured(int nstlistPrune) const;
+
+    //! The number of steps in the lifetime of an outer list
+    int nstlist_;
+    //! The outer list radius for which rlistInner_ was computed
+    real rlistOuterReference_;
+    //! The inner list radius for each pruning interval
+    std::vector<real> rlistInner_;
+    //! The minimum pruning interval that we consider
+    int nstlistPruneMin_;
+    //! The maximum pruning interval that we consider
+    int nstlistPruneMax_;
+    //! The pruning interval for the current outer list
+    int nstlistPrune_;
+    //! The measured cost in cycles per step for each pruning interval, negative when not measured
+    std::vector<double> costPerStep_;
+    //! Whether the search has converged
+    bool haveConverged_ = false;
+    //! The number of outer lists to go until we repeat the search
+    int numListsUntilRetuning_ = 0;
+    //! The number of complete outer list lifetimes in the current measurement
+    int numListsMeasured_ = 0;
+    //! The number of cycles accumulated over the current measurement
+    double measurementCycles_ = 0;
+    //! The number of steps accumulated over the current measurement
+    int measurementSteps_ = 0;
+    //! The cycles spent in the kernels with the current outer list
+    gmx_cycles_t cycles_ = 0;
+    //! The number of steps computed with the current outer list
+    int numSteps_ = 0;
+    //! The cycle count at the start of the current timing
+    gmx_cycles_t cycleStart_ = 0;
+};
+
+} // namespace Nbnxm
+
+#endif
@@ -50,6 +50,8 @@
 #include <cstring>
 
 #include <algorithm>
+#include <utility>
+#include <vector>
 
 #include "gromacs/math/utilities.h"
 #include "gromacs/math/vec.h"
@@ -77,12 +79,77 @@ Grid::Geometry::Geometry(const PairlistType pairlistType) :
 {
 }
 
-Grid::Grid(const PairlistType pairlistType, const bool& haveFep) :
+Grid::Grid(const PairlistType pairlistType, const bool& haveFep, const ColumnOrder columnOrder) :
     geometry_(pairlistType),
+    columnOrder_(columnOrder),
     haveFep_(haveFep)
 {
 }
 
+/*! \brief Returns the distance along a Hilbert curve filling a \p n x \p n grid of point \p x, \p y
+ *
+ * \p n should be a power of 2.
+ */
+static int64_t hilbertDistance(const int n, int x, int y)
+{
+    int64_t distance = 0;
+    for (int s = n / 2; s > 0; s /= 2)
+    {
+        const int rx = ((x & s) > 0) ? 1 : 0;
+        const int ry = ((y & s) > 0) ? 1 : 0;
+        distance += static_cast<int64_t>(s) * s * ((3 * rx) ^ ry);
+
+        /* Rotate the quadrant */
+        if (ry == 0)
+        {
+            if (rx == 1)
+            {
+                x = s - 1 - x;
+                y = s - 1 - y;
+            }
+            std::swap(x, y);
+        }
+    }
+
+    return distance;
+}
+
+void Grid::setHilbertColumnOrder()
+{
+    const int numCellsX = dimensions_.numCells[XX];
+    const int numCellsY = dimensions_.numCells[YY];
+
+    /* The Hilbert curve fills a square with a power of 2 number of cells */
+    int n = 1;
+    while (n < std::max(numCellsX, numCellsY))
+    {
+        n *= 2;
+    }
+
+    /* Sort the columns on their distance along the curve, the number of
+     * columns is small compared to the number of atoms, so this is cheap.
+     */
+    std::vector<std::pair<int64_t, int>> distanceAndXYIndex(numColumns());
+    for (int cx = 0; cx < numCellsX; cx++)
+    {
+        for (int cy = 0; cy < numCellsY; cy++)
+        {
+            const int xyIndex           = cx * numCellsY + cy;
+            distanceAndXYIndex[xyIndex] = { hilbertDistance(n, cx, cy), xyIndex };
+        }
+    }
+    std::sort(distanceAndXYIndex.begin(), distanceAndXYIndex.end());
+
+    columnFromXYIndex_.resize(numColumns());
+    xyIndexFromColumn_.resize(numColumns());
+    for (int column = 0; column < numColumns(); column++)
+    {
+        const int xyIndex           = distanceAndXYIndex[column].second;
+        xyIndexFromColumn_[column]  = xyIndex;
+        columnFromXYIndex_[xyIndex] = column;
+    }
+}
+
 /*! \brief Returns the atom density (> 0) of a rectangular grid */
 static real gridAtomDensity(int numAtoms, const rvec lowerCorner, const rvec upperCorner)
 {
@@ -197,6 +264,16 @@ void Grid::setDimensions(const int          ddZone,
         dimensions_.numCells[YY]++;
     }
 
+    if (columnOrder_ == ColumnOrder::Hilbert && geometry_.isSimple)
+    {
+        setHilbertColumnOrder();
+    }
+    else
+    {
+        columnFromXYIndex_.clear();
+        xyIndexFromColumn_.clear();
+    }
+
     /* We need one additional cell entry for particles moved by DD */
     cxy_na_.resize(numColumns() + 1);
     cxy_ind_.resize(numColumns() + 2);
@@ -984,6 +1061,43 @@ void Grid::fillCell(GridSetData*                   gridSetData,
     }
 }
 
+void Grid::fillColumnCpuGeometry(GridSetData*                   gridSetData,
+                                 const int*                     atinfo,
+                                 gmx::ArrayRef<const gmx::RVec> x,
+                                 nbnxn_atomdata_t*              nbat,
+                                 const int                      columnIndex)
+{
+    const int numAtomsPerCell = geometry_.numAtomsPerCell;
+    const int numAtoms        = numAtomsInColumn(columnIndex);
+    const int numCellsZ       = numCellsInColumn(columnIndex);
+    const int atomOffset      = firstAtomInColumn(columnIndex);
+
+    /* Fill the ncz cells in this column */
+    const int firstCell  = firstCellInColumn(columnIndex);
+    int       cellFilled = firstCell;
+    for (int cellZ = 0; cellZ < numCellsZ; cellZ++)
+    {
+        const int cell = firstCell + cellZ;
+
+        const int atomOffsetCell = atomOffset + cellZ * numAtomsPerCell;
+        const int numAtomsCell   = std::min(numAtomsPerCell, numAtoms - (atomOffsetCell - atomOffset));
+
+        fillCell(gridSetData, nbat, atomOffsetCell, atomOffsetCell + numAtomsCell, atinfo, x,
+                 nullptr);
+
+        /* This copy to bbcz is not really necessary.
+         * But it allows to use the same grid search code
+         * for the simple and supersub cell setups.
+         */
+        if (numAtomsCell > 0)
+        {
+            cellFilled = cell;
+        }
+        bbcz_[cell].lower = bb_[cellFilled].lower.z;
+        bbcz_[cell].upper = bb_[cellFilled].upper.z;
+    }
+}
+
 void Grid::sortColumnsCpuGeometry(GridSetData*                   gridSetData,
                                   int                            dd_zone,
                                   const int*                     atinfo,
@@ -1014,29 +1128,7 @@ void Grid::sortColumnsCpuGeometry(GridSetData*                   gridSetData,
                    gridSetData->atomIndices.data() + atomOffset, numAtoms, x, dimensions_.lowerCorner[ZZ],
                    1.0 / dimensions_.gridSize[ZZ], numCellsZ * numAtomsPerCell, sort_work);
 
-        /* Fill the ncz cells in this column */
-        const int firstCell  = firstCellInColumn(cxy);
-        int       cellFilled = firstCell;
-        for (int cellZ = 0; cellZ < numCellsZ; cellZ++)
-        {
-            const int cell = firstCell + cellZ;
-
-            const int atomOffsetCell = atomOffset + cellZ * numAtomsPerCell;
-            const int numAtomsCell = std::min(numAtomsPerCell, numAtoms - (atomOffsetCell - atomOffset));
-
-            fillCell(gridSetData, nbat, atomOffsetCell, atomOffsetCell + numAtomsCell, atinfo, x, nullptr);
-
-            /* This copy to bbcz is not really necessary.
-             * But it allows to use the same grid search code
-             * for the simple and supersub cell setups.
-             */
-            if (numAtomsCell > 0)
-            {
-                cellFilled = cell;
-            }
-            bbcz_[cell].lower = bb_[cellFilled].lower.z;
-            bbcz_[cell].upper = bb_[cellFilled].upper.z;
-        }
+        fillColumnCpuGeometry(gridSetData, atinfo, x, nbat, cxy);
 
         /* Set the unused atom indices to -1 */
         for (int ind = numAtoms; ind < numCellsZ * numAtomsPerCell; ind++)
@@ -1081,8 +1173,8 @@ void Grid::sortColumnsGpuGeometry(GridSetData*                   gridSetData,
      */
     for (int cxy : columnRange)
     {
-        const int gridX = cxy / dimensions_.numCells[YY];
-        const int gridY = cxy - gridX * dimensions_.numCells[YY];
+        const int gridX = columnCellX(cxy);
+        const int gridY = columnCellY(cxy);
 
         const int numAtomsInColumn = cxy_na_[cxy];
         const int numCellsInColumn = cxy_ind_[cxy + 1] - cxy_ind_[cxy];
@@ -1162,6 +1254,102 @@ void Grid::sortColumnsGpuGeometry(GridSetData*                   gridSetData,
     }
 }
 
+bool Grid::refillColumnsKeepingAtomOrder(GridSetData*                   gridSetData,
+                                         const int*                     atinfo,
+                                         gmx::ArrayRef<const gmx::RVec> x,
+                                         nbnxn_atomdata_t*              nbat,
+                                         const gmx::Range<int>          columnRange)
+{
+    gmx::ArrayRef<const int> atomIndices = gridSetData->atomIndices;
+
+    for (int cxy : columnRange)
+    {
+        const int numAtoms   = numAtomsInColumn(cxy);
+        const int atomOffset = firstAtomInColumn(cxy);
+
+        /* Check that all atoms are still in this column,
+         * this uses the same assignment as calcColumnIndices()
+         */
+        for (int i = atomOffset; i < atomOffset + numAtoms; i++)
+        {
+            const gmx::RVec& coord = x[atomIndices[i]];
+
+            int cx = static_cast<int>((coord[XX] - dimensions_.lowerCorner[XX])
+                                      * dimensions_.invCellSize[XX]);
+            int cy = static_cast<int>((coord[YY] - dimensions_.lowerCorner[YY])
+                                      * dimensions_.invCellSize[YY]);
+            cx     = std::min(cx, dimensions_.numCells[XX] - 1);
+            cy     = std::min(cy, dimensions_.numCells[YY] - 1);
+
+            if (columnIndex(cx, cy) != cxy)
+            {
+                return false;
+            }
+        }
+
+        fillColumnCpuGeometry(gridSetData, atinfo, x, nbat, cxy);
+
+        /* The search for j-cells in range along z assumes that both
+         * the lower and upper bounds increase monotonically along a column.
+         * This is guaranteed after sorting, but not after atoms moved.
+         */
+        const int firstCell = firstCellInColumn(cxy);
+        for (int cell = firstCell + 1; cell < firstCell + numCellsInColumn(cxy); cell++)
+        {
+            if (bbcz_[cell].lower < bbcz_[cell - 1].lower
+                || bbcz_[cell].upper < bbcz_[cell - 1].upper)
+            {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+bool Grid::updateKeepingAtomOrder(GridSetData*                   gridSetData,
+                                  const int*                     atinfo,
+                                  gmx::ArrayRef<const gmx::RVec> x,
+                                  nbnxn_atomdata_t*              nbat)
+{
+    GMX_RELEASE_ASSERT(geometry_.isSimple, "Only CPU grids can be updated keeping the atom order");
+
+    const int nthread = gmx_omp_nthreads_get(emntPairsearch);
+
+    int numInvalidTasks = 0;
+#pragma omp parallel for num_threads(nthread) schedule(static) reduction(+ : numInvalidTasks)
+    for (int thread = 0; thread < nthread; thread++)
+    {
+        try
+        {
+            gmx::Range<int> columnRange(((thread + 0) * numColumns()) / nthread,
+                                        ((thread + 1) * numColumns()) / nthread);
+            if (!refillColumnsKeepingAtomOrder(gridSetData, atinfo, x, nbat, columnRange))
+            {
+                numInvalidTasks++;
+            }
+        }
+        GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
+    }
+
+    if (numInvalidTasks > 0)
+    {
+        return false;
+    }
+
+    if (nbat->XFormat == nbatX8)
+    {
+        combine_bounding_box_pairs(*this, bb_, bbj_);
+    }
+
+    if (debug)
+    {
+        print_bbsizes_simple(debug, *this);
+    }
+
+    return true;
+}
+
 /*! \brief Sets the cell index in the cell array for atom \p atomIndex and increments the atom count for the grid column */
 static void setCellAndAtomCount(gmx::ArrayRef<int> cell, int cellIndex, gmx::ArrayRef<int> cxy_na, int atomIndex)
 {
@@ -1169,8 +1357,7 @@ static void setCellAndAtomCount(gmx::ArrayRef<int> cell, int cellIndex, gmx::Arr
     cxy_na[cellIndex] += 1;
 }
 
-void Grid::calcColumnIndices(const Grid::Dimensions&        gridDims,
-                             const gmx::UpdateGroupsCog*    updateGroupsCog,
+void Grid::calcColumnIndices(const gmx::UpdateGroupsCog*    updateGroupsCog,
                              const gmx::Range<int>          atomRange,
                              gmx::ArrayRef<const gmx::RVec> x,
                              const int                      dd_zone,
@@ -1178,9 +1365,10 @@ void Grid::calcColumnIndices(const Grid::Dimensions&        gridDims,
                              const int                      thread,
                              const int                      nthread,
                              gmx::ArrayRef<int>             cell,
-                             gmx::ArrayRef<int>             cxy_na)
+                             gmx::ArrayRef<int>             cxy_na) const
 {
-    const int numColumns = gridDims.numCells[XX] * gridDims.numCells[YY];
+    const Grid::Dimensions& gridDims   = dimensions_;
+    const int               numColumns = this->numColumns();
 
     /* We add one extra cell for particles which moved during DD */
     for (int i = 0; i < numColumns; i++)
@@ -1228,7 +1416,7 @@ void Grid::calcColumnIndices(const Grid::Dimensions&        gridDims,
                 /* For the moment cell will contain only the, grid local,
                  * x and y indices, not z.
                  */
-                setCellAndAtomCount(cell, cx * gridDims.numCells[YY] + cy, cxy_na, i);
+                setCellAndAtomCount(cell, columnIndex(cx, cy), cxy_na, i);
             }
             else
             {
@@ -1261,7 +1449,7 @@ void Grid::calcColumnIndices(const Grid::Dimensions&        gridDims,
             /* For the moment cell will contain only the, grid local,
              * x and y indices, not z.
              */
-            setCellAndAtomCount(cell, cx * gridDims.numCells[YY] + cy, cxy_na, i);
+            setCellAndAtomCount(cell, columnIndex(cx, cy), cxy_na, i);
         }
     }
 }
@@ -1344,13 +1532,11 @@ void Grid::setCellIndices(int                            ddZone,
                 dimensions_.numCells[YY], numCellsTotal_ / (static_cast<double>(numColumns())), ncz_max);
         if (gmx_debug_at)
         {
-            int i = 0;
             for (int cy = 0; cy < dimensions_.numCells[YY]; cy++)
             {
                 for (int cx = 0; cx < dimensions_.numCells[XX]; cx++)
                 {
-                    fprintf(debug, " %2d", cxy_ind_[i + 1] - cxy_ind_[i]);
-                    i++;
+                    fprintf(debug, " %2d", numCellsInColumn(columnIndex(cx, cy)));
                 }
                 fprintf(debug, "\n");
             }
@@ -144,6 +144,20 @@ struct BoundingBox1D
     float upper; //!< upper bound
 };
 
+/*! \brief The order in which the columns of a CPU grid are stored
+ *
+ * The atoms, and thus the coordinates in nbnxn_atomdata_t, are stored
+ * column by column. With the natural, x-major, order neighboring columns
+ * along x are far apart in memory. Ordering the columns along a Hilbert
+ * curve keeps spatially close columns closer in memory.
+ */
+enum class ColumnOrder : int
+{
+    Natural, //!< x-major, y-minor order
+    Hilbert, //!< Order along a Hilbert curve in the x/y-plane, only used with a CPU geometry
+    Count
+};
+
 } // namespace Nbnxm
 
 namespace Nbnxm
@@ -166,6 +180,10 @@ namespace Nbnxm
  * can be used to index atom arrays. All methods returning atom indices
  * return indices which index into a full atom array.
  *
+ * The grid columns can be stored in a different order than x-major,
+ * see ColumnOrder. Column indices always refer to the storage order,
+ * columnIndex() converts cell indices along x and y to a column index.
+ *
  * Note that when atom groups, instead of individual atoms, are assigned
  * to grid cells, individual atoms can be geometrically outside the cell
  * and grid that they have been assigned to (as determined by the center
@@ -210,8 +228,8 @@ public:
         int numCells[DIM - 1];
     };
 
-    //! Constructs a grid given the type of pairlist
-    Grid(PairlistType pairlistType, const bool& haveFep);
+    //! Constructs a grid given the type of pairlist and the requested column order
+    Grid(PairlistType pairlistType, const bool& haveFep, ColumnOrder columnOrder);
 
     //! Returns the geometry of the grid cells
     const Geometry& geometry() const { return geometry_; }
@@ -222,6 +240,29 @@ public:
     //! Returns the total number of grid columns
     int numColumns() const { return dimensions_.numCells[XX] * dimensions_.numCells[YY]; }
 
+    //! Returns whether the columns are stored in x-major, y-minor order
+    bool haveNaturalColumnOrder() const { return columnFromXYIndex_.empty(); }
+
+    //! Returns the index of the column with cell indices \p cx and \p cy along x and y
+    int columnIndex(int cx, int cy) const
+    {
+        const int xyIndex = cx * dimensions_.numCells[YY] + cy;
+
+        return haveNaturalColumnOrder() ? xyIndex : columnFromXYIndex_[xyIndex];
+    }
+
+    //! Returns the cell index along x of column \p columnIndex
+    int columnCellX(int columnIndex) const
+    {
+        return xyIndex(columnIndex) / dimensions_.numCells[YY];
+    }
+
+    //! Returns the cell index along y of column \p columnIndex
+    int columnCellY(int columnIndex) const
+    {
+        return xyIndex(columnIndex) % dimensions_.numCells[YY];
+    }
+
     //! Returns the total number of grid cells
     int numCells() const { return numCellsTotal_; }
 
@@ -344,18 +385,42 @@ public:
                         nbnxn_atomdata_t*              nbat);
 
     //! Determine in which grid columns atoms should go, store cells and atom counts in \p cell and \p cxy_na
-    static void calcColumnIndices(const Grid::Dimensions&        gridDims,
-                                  const gmx::UpdateGroupsCog*    updateGroupsCog,
-                                  gmx::Range<int>                atomRange,
-                                  gmx::ArrayRef<const gmx::RVec> x,
-                                  int                            dd_zone,
-                                  const int*                     move,
-                                  int                            thread,
-                                  int                            nthread,
-                                  gmx::ArrayRef<int>             cell,
-                                  gmx::ArrayRef<int>             cxy_na);
+    void calcColumnIndices(const gmx::UpdateGroupsCog*    updateGroupsCog,
+                           gmx::Range<int>                atomRange,
+                           gmx::ArrayRef<const gmx::RVec> x,
+                           int                            dd_zone,
+                           const int*                     move,
+                           int                            thread,
+                           int                            nthread,
+                           gmx::ArrayRef<int>             cell,
+                           gmx::ArrayRef<int>             cxy_na) const;
+
+    /*! \brief Updates the coordinates and bounding boxes while keeping the atom order
+     *
+     * This avoids the binning and sorting of atoms done by calcColumnIndices()
+     * and setCellIndices() and is valid when no atom left its grid column
+     * and the cells along each column are still ordered along z.
+     * Only supported with a CPU geometry. The grid dimensions and atom range
+     * should not have changed since the last call to setCellIndices().
+     *
+     * \returns whether the update succeeded, when false the grid is left
+     *          in an inconsistent state and a full update is required.
+     */
+    bool updateKeepingAtomOrder(GridSetData*                   gridSetData,
+                                const int*                     atinfo,
+                                gmx::ArrayRef<const gmx::RVec> x,
+                                nbnxn_atomdata_t*              nbat);
 
 private:
+    //! Returns the x-major index of column \p columnIndex
+    int xyIndex(int columnIndex) const
+    {
+        return haveNaturalColumnOrder() ? columnIndex : xyIndexFromColumn_[columnIndex];
+    }
+
+    //! Sets up the mapping between x-major indices and column indices for the Hilbert order
+    void setHilbertColumnOrder();
+
     /*! \brief Fill a pair search cell with atoms
      *
      * Potentially sorts atoms and sets the interaction flags.
@@ -368,6 +433,20 @@ private:
                   gmx::ArrayRef<const gmx::RVec> x,
                   BoundingBox gmx_unused* bb_work_aligned);
 
+    //! Fills the cells of column \p columnIndex with the atoms in their current order, for CPU geometry
+    void fillColumnCpuGeometry(GridSetData*                   gridSetData,
+                               const int*                     atinfo,
+                               gmx::ArrayRef<const gmx::RVec> x,
+                               nbnxn_atomdata_t*              nbat,
+                               int                            columnIndex);
+
+    //! Refills the columns in \p columnRange keeping the atom order, returns false when invalid
+    bool refillColumnsKeepingAtomOrder(GridSetData*                   gridSetData,
+                                       const int*                     atinfo,
+                                       gmx::ArrayRef<const gmx::RVec> x,
+                                       nbnxn_atomdata_t*              nbat,
+                                       gmx::Range<int>                columnRange);
+
     //! Spatially sort the atoms within the given column range, for CPU geometry
     void sortColumnsCpuGeometry(GridSetData*                   gridSetData,
                                 int                            dd_zone,
@@ -391,6 +470,12 @@ private:
     Geometry geometry_;
     //! The physical dimensions of the grid
     Dimensions dimensions_;
+    //! The requested order of the columns, only applied with a CPU geometry
+    ColumnOrder columnOrder_;
+    //! The column index for each x-major column index, empty with natural order
+    std::vector<int> columnFromXYIndex_;
+    //! The x-major column index for each column index, empty with natural order
+    std::vector<int> xyIndexFromColumn_;
 
     //! The total number of cells in this grid
     int numCellsTotal_;
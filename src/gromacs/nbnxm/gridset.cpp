@@ -46,6 +46,11 @@
 
 #include "gridset.h"
 
+#include <cmath>
+
+#include <vector>
+
+#include "gromacs/domdec/domdec_struct.h"
 #include "gromacs/mdlib/gmx_omp_nthreads.h"
 #include "gromacs/mdlib/updategroupscog.h"
 #include "gromacs/utility/fatalerror.h"
@@ -63,6 +68,11 @@ static int numGrids(const GridSet::DomainSetup& domainSetup)
     {
         numGrids = 2;
     }
+    else if (domainSetup.zones != nullptr)
+    {
+        /* We need one grid per domain decomposition zone */
+        numGrids = domainSetup.zones->n;
+    }
     else
     {
         numGrids = 1;
@@ -78,6 +88,82 @@ static int numGrids(const GridSet::DomainSetup& domainSetup)
     return numGrids;
 }
 
+/*! \brief Returns the atom density experienced by the average atom, or -1 when it can not be estimated
+ *
+ * The atoms are binned on a coarse grid with about \p c_numAtomsPerBin atoms
+ * per bin at the mean density. The returned density is the atom-number
+ * weighted average of the bin densities, sum n(n-1)/(V_bin sum n), which for
+ * a homogeneous system is an unbiased estimate of the mean density.
+ * For systems with a dense and a dilute phase it returns the density of
+ * the dense phase, which is where nearly all cluster pairs are located.
+ * Atoms with move[i] < 0 have moved to another domain and are ignored.
+ */
+static real atomWeightedDensity(const rvec                     lowerCorner,
+                             const rvec                     upperCorner,
+                             const gmx::Range<int>          atomRange,
+                             gmx::ArrayRef<const gmx::RVec> x,
+                             const int*                     move)
+{
+    constexpr int c_numAtomsPerBin = 64;
+
+    const int numAtoms = atomRange.size();
+    if (numAtoms < 2 * c_numAtomsPerBin)
+    {
+        return -1;
+    }
+
+    rvec size;
+    rvec_sub(upperCorner, lowerCorner, size);
+    const real volume = size[XX] * size[YY] * size[ZZ];
+    if (!(volume > 0))
+    {
+        return -1;
+    }
+
+    const real binLength = std::cbrt(volume * c_numAtomsPerBin / numAtoms);
+    ivec       numBins;
+    rvec       invBinSize;
+    for (int d = 0; d < DIM; d++)
+    {
+        numBins[d]    = std::max(1, static_cast<int>(size[d] / binLength));
+        invBinSize[d] = numBins[d] / size[d];
+    }
+
+    std::vector<int> binCount(numBins[XX] * numBins[YY] * numBins[ZZ], 0);
+    for (int i : atomRange)
+    {
+        if (move != nullptr && move[i] < 0)
+        {
+            continue;
+        }
+        int binIndex = 0;
+        for (int d = 0; d < DIM; d++)
+        {
+            int b = static_cast<int>((x[i][d] - lowerCorner[d]) * invBinSize[d]);
+            b     = std::min(std::max(b, 0), numBins[d] - 1);
+
+            binIndex = binIndex * numBins[d] + b;
+        }
+        binCount[binIndex]++;
+    }
+
+    double sumN  = 0;
+    double sumN2 = 0;
+    for (int n : binCount)
+    {
+        sumN += n;
+        sumN2 += n * static_cast<double>(n - 1);
+    }
+    if (sumN2 == 0)
+    {
+        return -1;
+    }
+
+    const double binVolume = volume / binCount.size();
+
+    return static_cast<real>(sumN2 / (binVolume * sumN));
+}
+
 GridSet::DomainSetup::DomainSetup(const int                 ePBC,
                                   const bool                doTestParticleInsertion,
                                   const ivec*               numDDCells,
@@ -99,14 +185,20 @@ GridSet::GridSet(const int                 ePBC,
                  const gmx_domdec_zones_t* ddZones,
                  const PairlistType        pairlistType,
                  const bool                haveFep,
+                 const ColumnOrder         columnOrder,
                  const int                 numThreads,
                  gmx::PinningPolicy        pinningPolicy) :
     domainSetup_(ePBC, doTestParticleInsertion, numDDCells, ddZones),
-    grids_(numGrids(domainSetup_), Grid(pairlistType, haveFep_)),
+    grids_(numGrids(domainSetup_), Grid(pairlistType, haveFep_, columnOrder)),
     haveFep_(haveFep),
     numRealAtomsLocal_(0),
     numRealAtomsTotal_(0),
-    gridWork_(numThreads)
+    gridWork_(numThreads),
+    allowUpdateKeepingAtomOrder_(getenv("GMX_NBNXN_INCREMENTAL_GRID") != nullptr),
+    useDensePhaseCellSize_(getenv("GMX_NBNXN_DENSE_PHASE_CELL_SIZE") != nullptr),
+    haveLocalGrid_(false),
+    numUpdatesKeepingAtomOrder_(0),
+    localAtomOrderVersion_(0)
 {
     clear_mat(box_);
     changePinningPolicy(&gridSetData_.cells, pinningPolicy);
@@ -133,6 +225,47 @@ void GridSet::setLocalAtomOrder()
     }
 }
 
+bool GridSet::canUpdateKeepingAtomOrder(const matrix                box,
+                                        const int                   gridIndex,
+                                        const rvec                  lowerCorner,
+                                        const rvec                  upperCorner,
+                                        const gmx::UpdateGroupsCog* updateGroupsCog,
+                                        const gmx::Range<int>       atomRange,
+                                        const int                   numAtomsMoved) const
+{
+    /* We only support a single, CPU, grid with atoms that are not grouped */
+    if (!allowUpdateKeepingAtomOrder_ || !haveLocalGrid_ || gridIndex != 0 || grids_.size() != 1
+        || !grids_[0].geometry().isSimple || updateGroupsCog != nullptr || numAtomsMoved != 0)
+    {
+        return false;
+    }
+
+    const Grid& grid = grids_[0];
+    if (*atomRange.begin() != grid.srcAtomBegin() || *atomRange.end() != grid.srcAtomEnd())
+    {
+        return false;
+    }
+
+    /* The grid dimensions should not change, so the box should be identical */
+    for (int d = 0; d < DIM; d++)
+    {
+        if (lowerCorner[d] != grid.dimensions().lowerCorner[d]
+            || upperCorner[d] != grid.dimensions().upperCorner[d])
+        {
+            return false;
+        }
+        for (int d2 = 0; d2 < DIM; d2++)
+        {
+            if (box[d][d2] != box_[d][d2])
+            {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
 void GridSet::putOnGrid(const matrix                   box,
                         const int                      gridIndex,
                         const rvec                     lowerCorner,
@@ -148,6 +281,23 @@ void GridSet::putOnGrid(const matrix                   box,
 {
     Nbnxm::Grid& grid = grids_[gridIndex];
 
+    /* When no atom moved out of its grid column, we can avoid binning
+     * and sorting and only need to update the coordinates and bounding boxes.
+     */
+    if (canUpdateKeepingAtomOrder(box, gridIndex, lowerCorner, upperCorner, updateGroupsCog,
+                                  atomRange, numAtomsMoved)
+        && grid.updateKeepingAtomOrder(&gridSetData_, atomInfo.data(), x, nbat))
+    {
+        numUpdatesKeepingAtomOrder_++;
+
+        if (debug)
+        {
+            fprintf(debug, "Updated the local grid keeping the atom order\n");
+        }
+
+        return;
+    }
+
     int cellOffset;
     if (gridIndex == 0)
     {
@@ -174,6 +324,22 @@ void GridSet::putOnGrid(const matrix                   box,
 
         maxAtomGroupRadius = (updateGroupsCog ? updateGroupsCog->maxUpdateGroupRadius() : 0);
 
+        /* With a strongly inhomogeneous density, the mean density leads
+         * to large cells and clusters in the dense phase. We then set
+         * the cell size using the density experienced by the atoms,
+         * so only the few atoms in sparse regions end up in sparse clusters.
+         * Note that this is a single cell size for the whole grid, we do
+         * not support different cluster sizes for different regions.
+         */
+        if (useDensePhaseCellSize_)
+        {
+            const real density = atomWeightedDensity(lowerCorner, upperCorner, atomRange, x, move);
+            if (density > 0)
+            {
+                atomDensity = density;
+            }
+        }
+
         if (debug)
         {
             fprintf(debug, "natoms_local = %5d atom_density = %5.1f\n", numRealAtomsLocal_, atomDensity);
@@ -213,8 +379,8 @@ void GridSet::putOnGrid(const matrix                   box,
     {
         try
         {
-            Grid::calcColumnIndices(grid.dimensions(), updateGroupsCog, atomRange, x, ddZone, move, thread,
-                                    nthread, gridSetData_.cells, gridWork_[thread].numAtomsPerColumn);
+            grid.calcColumnIndices(updateGroupsCog, atomRange, x, ddZone, move, thread, nthread,
+                                   gridSetData_.cells, gridWork_[thread].numAtomsPerColumn);
         }
         GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
     }
@@ -226,6 +392,9 @@ void GridSet::putOnGrid(const matrix                   box,
     if (gridIndex == 0)
     {
         nbat->natoms_local = nbat->numAtoms();
+
+        haveLocalGrid_ = true;
+        localAtomOrderVersion_++;
     }
     if (gridIndex == gmx::ssize(grids_) - 1)
     {
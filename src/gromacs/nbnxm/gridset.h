@@ -114,6 +114,7 @@ public:
             const gmx_domdec_zones_t* ddZones,
             PairlistType              pairlistType,
             bool                      haveFep,
+            ColumnOrder               columnOrder,
             int                       numThreads,
             gmx::PinningPolicy        pinningPolicy);
 
@@ -131,6 +132,18 @@ public:
                    const int*                     move,
                    nbnxn_atomdata_t*              nbat);
 
+    /*! \brief Returns the number of grid updates that kept the atom order of the previous update
+     *
+     * This optimization is only used when GMX_NBNXN_INCREMENTAL_GRID is set.
+     */
+    int numUpdatesKeepingAtomOrder() const { return numUpdatesKeepingAtomOrder_; }
+
+    /*! \brief Returns a version number for the order of the atoms on the local grid
+     *
+     * This is changed with every local grid update that does not keep the atom order.
+     */
+    int localAtomOrderVersion() const { return localAtomOrderVersion_; }
+
     //! Returns the domain setup
     DomainSetup domainSetup() const { return domainSetup_; }
 
@@ -177,6 +190,15 @@ public:
     void setNumColumnsMax(int numColumnsMax) { numColumnsMax_ = numColumnsMax; }
 
 private:
+    //! Returns whether we can try to update the local grid while keeping the atom order
+    bool canUpdateKeepingAtomOrder(const matrix                box,
+                                   int                         gridIndex,
+                                   const rvec                  lowerCorner,
+                                   const rvec                  upperCorner,
+                                   const gmx::UpdateGroupsCog* updateGroupsCog,
+                                   gmx::Range<int>             atomRange,
+                                   int                         numAtomsMoved) const;
+
     /* Data members */
     //! The domain setup
     DomainSetup domainSetup_;
@@ -196,6 +218,20 @@ private:
     std::vector<GridWork> gridWork_;
     //! Maximum number of columns across all grids
     int numColumnsMax_;
+    //! Whether we may update the local grid without re-binning and sorting atoms
+    bool allowUpdateKeepingAtomOrder_;
+    /*! \brief Whether to set the local grid cell size using the density of the dense phase
+     *
+     * The density is averaged over the atoms instead of over the volume.
+     * This only affects the cell size of the whole local grid, the cluster size is fixed.
+     */
+    bool useDensePhaseCellSize_;
+    //! Whether the local grid has been set up by a full update
+    bool haveLocalGrid_;
+    //! The number of local grid updates that kept the atom order
+    int numUpdatesKeepingAtomOrder_;
+    //! The version of the local atom order, incremented with every full local grid update
+    int localAtomOrderVersion_;
 };
 
 } // namespace Nbnxm
@@ -0,0 +1,133 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2020, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+
+/*! \internal \file
+ * \brief
+ * Declares conversion functions for IEEE 754 half-precision storage
+ * of the j-cluster coordinates used by the SIMD kernels.
+ *
+ * The j-coordinates are stored as half-precision offsets with respect to
+ * an origin per j-cluster. The offsets are bounded by the cluster size,
+ * which is well below 1 nm for all but very dilute systems. For offsets
+ * below 1 nm the absolute error is at most 2^-12 nm, i.e. below 3e-4 nm,
+ * whereas absolute coordinates in half precision would have errors up to
+ * 0.03 nm in a 30 nm box.
+ *
+ * \ingroup module_nbnxm
+ */
+
+#ifndef GMX_NBNXM_HALFPRECISION_H
+#define GMX_NBNXM_HALFPRECISION_H
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+namespace Nbnxm
+{
+
+/*! \brief The maximum absolute offset stored in half precision
+ *
+ * Offsets of filler particles, which are far away, are clamped to this value.
+ * This keeps them far outside the cut-off, while avoiding infinities.
+ */
+static constexpr float c_halfPrecisionMaxOffset = 1000;
+
+//! Converts a float to IEEE half precision, with rounding to nearest even
+static inline uint16_t floatToHalf(float value)
+{
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+
+    const uint32_t sign    = (bits >> 16) & 0x8000;
+    const uint32_t absBits = bits & 0x7fffffff;
+
+    if (absBits >= 0x47800000)
+    {
+        /* Overflow, infinity or NaN */
+        return static_cast<uint16_t>(sign | (absBits > 0x7f800000 ? 0x7e00 : 0x7c00));
+    }
+    if (absBits < 0x38800000)
+    {
+        /* Subnormal half, multiplication by 2^24 is exact */
+        float absValue;
+        std::memcpy(&absValue, &absBits, sizeof(absValue));
+        return static_cast<uint16_t>(sign | static_cast<uint32_t>(std::nearbyint(absValue * 16777216.0F)));
+    }
+
+    const uint32_t mantissa  = absBits & 0x7fffff;
+    uint32_t       half      = (((absBits >> 23) - 112) << 10) | (mantissa >> 13);
+    const uint32_t remainder = mantissa & 0x1fff;
+    /* Round to nearest even, a carry into the exponent is correct */
+    if (remainder > 0x1000 || (remainder == 0x1000 && (half & 1)))
+    {
+        half++;
+    }
+
+    return static_cast<uint16_t>(sign | half);
+}
+
+//! Converts an IEEE half precision value to float
+static inline float halfToFloat(uint16_t half)
+{
+    const uint32_t sign     = static_cast<uint32_t>(half & 0x8000) << 16;
+    const uint32_t exponent = (half >> 10) & 0x1f;
+    const uint32_t mantissa = half & 0x3ff;
+
+    uint32_t bits;
+    if (exponent == 0)
+    {
+        /* Zero or subnormal */
+        const float absValue = mantissa * (1.0F / 16777216.0F);
+        return (sign != 0 ? -absValue : absValue);
+    }
+    else if (exponent == 0x1f)
+    {
+        bits = sign | 0x7f800000 | (mantissa << 13);
+    }
+    else
+    {
+        bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+    }
+
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+
+    return value;
+}
+
+} // namespace Nbnxm
+
+#endif
@@ -0,0 +1,311 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2020, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+
+/*! \internal \file
+ *
+ * \brief
+ * Implements the IncrementalPairlist class
+ *
+ * \ingroup module_nbnxm
+ */
+
+#include "gmxpre.h"
+
+#include "incrementalpairlist.h"
+
+#include <cmath>
+
+#include <algorithm>
+
+#include "gromacs/math/vec.h"
+#include "gromacs/mdlib/gmx_omp_nthreads.h"
+#include "gromacs/pbcutil/pbc.h"
+#include "gromacs/utility/exceptions.h"
+#include "gromacs/utility/gmxassert.h"
+
+#include "atomdata.h"
+#include "gridset.h"
+
+namespace Nbnxm
+{
+
+/*! \brief The extra radius in nm for the full search when using incremental list updates
+ *
+ * A larger margin allows reusing list entries over more searches, but
+ * increases the cost of the pruning kernel. With 0.1 nm the outer list
+ * for a 1 nm radius is about 30% larger.
+ */
+static constexpr real c_incrementalPairlistMargin = 0.1;
+
+/*! \brief The minimum fraction of i-clusters that should reuse their entries
+ *
+ * Below this fraction it is cheaper to do a full search, which also
+ * resets the displacements.
+ */
+static constexpr real c_minimumReuseFraction = 0.5;
+
+IncrementalPairlist::IncrementalPairlist() :
+    margin_(c_incrementalPairlistMargin),
+    haveReference_(false),
+    atomOrderVersion_(-1),
+    rlist_(0),
+    numClustersReused_(0)
+{
+}
+
+//! Returns the coordinates of the atom with grid index \p a in \p nbat
+static gmx::RVec nbatCoordinates(const nbnxn_atomdata_t& nbat, const int a)
+{
+    const real* x = nbat.x().data();
+
+    switch (nbat.XFormat)
+    {
+        case nbatX4:
+        {
+            const int i = atom_to_x_index<c_packX4>(a);
+            return { x[i], x[i + c_packX4], x[i + 2 * c_packX4] };
+        }
+        case nbatX8:
+        {
+            const int i = atom_to_x_index<c_packX8>(a);
+            return { x[i], x[i + c_packX8], x[i + 2 * c_packX8] };
+        }
+        default:
+        {
+            const int i = a * nbat.xstride;
+            return { x[i], x[i + 1], x[i + 2] };
+        }
+    }
+}
+
+/*! \brief Sets \p result[i] to the maximum of \p values over indices i - range to i + range
+ *
+ * The values and results are accessed with \p stride.
+ * With \p isPeriodic the range wraps around, otherwise it is truncated.
+ */
+static void rangeMaximum(const real* values, const int numValues, const int stride, const int range, const bool isPeriodic, real* result)
+{
+    if (isPeriodic && 2 * range + 1 >= numValues)
+    {
+        const real maxValue = *std::max_element(values, values + numValues * stride);
+
+        for (int i = 0; i < numValues; i++)
+        {
+            result[i * stride] = maxValue;
+        }
+
+        return;
+    }
+
+    for (int i = 0; i < numValues; i++)
+    {
+        real maxValue = 0;
+        for (int j = i - range; j <= i + range; j++)
+        {
+            int index = j;
+            if (isPeriodic)
+            {
+                index = (j + numValues) % numValues;
+            }
+            else if (j < 0 || j >= numValues)
+            {
+                continue;
+            }
+            maxValue = std::max(maxValue, values[index * stride]);
+        }
+        result[i * stride] = maxValue;
+    }
+}
+
+bool IncrementalPairlist::setReusableClusters(const GridSet&          gridSet,
+                                              const nbnxn_atomdata_t& nbat,
+                                              const real              rlist,
+                                              const int               numLists)
+{
+    GMX_ASSERT(gridSet.grids().size() == 1, "Incremental updates need a single grid");
+
+    /* We can only reuse entries when the atom order did not change */
+    if (!haveReference_ || gridSet.localAtomOrderVersion() != atomOrderVersion_ || rlist != rlist_
+        || numLists != gmx::ssize(storedLists_))
+    {
+        return false;
+    }
+
+    const Grid&              grid            = gridSet.grids()[0];
+    const int                numAtomsCluster = grid.geometry().numAtomsICluster;
+    const int                numClusters     = grid.numCells();
+    gmx::ArrayRef<const int> atomIndices     = gridSet.atomIndices();
+
+    GMX_ASSERT(grid.geometry().numAtomsPerCell == numAtomsCluster,
+               "With a CPU grid each cell should contain one i-cluster");
+
+    clusterDisplacement_.resize(numClusters);
+    columnDisplacement_.resize(grid.numColumns());
+    neighborhoodDisplacement_.resize(grid.numColumns());
+    work_.resize(grid.numColumns());
+    canReuseCluster_.resize(numClusters);
+
+    const int numThreads = gmx_omp_nthreads_get(emntPairsearch);
+
+    /* Determine the maximum displacement of the clusters and columns,
+     * the latter are stored in x-major, y-minor order.
+     */
+#pragma omp parallel for num_threads(numThreads) schedule(static)
+    for (int column = 0; column < grid.numColumns(); column++)
+    {
+        try
+        {
+            real      columnDisplacement = 0;
+            const int firstCell          = grid.firstCellInColumn(column);
+            for (int cell = firstCell; cell < firstCell + grid.numCellsInColumn(column); cell++)
+            {
+                real displacement2 = 0;
+                for (int a = cell * numAtomsCluster; a < (cell + 1) * numAtomsCluster; a++)
+                {
+                    if (atomIndices[a] >= 0)
+                    {
+                        displacement2 = std::max(
+                                displacement2, gmx::norm2(nbatCoordinates(nbat, a) - xReference_[a]));
+                    }
+                }
+                clusterDisplacement_[cell] = std::sqrt(displacement2);
+                columnDisplacement         = std::max(columnDisplacement, clusterDisplacement_[cell]);
+            }
+            const int xyIndex = grid.columnCellX(column) * grid.dimensions().numCells[YY]
+                                + grid.columnCellY(column);
+            columnDisplacement_[xyIndex] = columnDisplacement;
+        }
+        GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
+    }
+
+    /* Determine the maximum displacement over the columns within range.
+     * An atom pair is in range when the distance between the columns
+     * they reside in is shorter than rlist.
+     * With a triclinic unit-cell we consider all columns.
+     */
+    matrix box;
+    gridSet.getBox(box);
+    const Grid::Dimensions& dims      = grid.dimensions();
+    const int               numPbcDim = ePBC2npbcdim(gridSet.domainSetup().ePBC);
+    int                     range[DIM - 1];
+    for (int d = 0; d < DIM - 1; d++)
+    {
+        if (TRICLINIC(box))
+        {
+            range[d] = dims.numCells[d];
+        }
+        else
+        {
+            range[d] = static_cast<int>(std::ceil(rlist * dims.invCellSize[d]));
+        }
+    }
+    const int numCellsY = dims.numCells[YY];
+    for (int cx = 0; cx < dims.numCells[XX]; cx++)
+    {
+        rangeMaximum(columnDisplacement_.data() + cx * numCellsY, numCellsY, 1, range[YY],
+                     YY < numPbcDim, work_.data() + cx * numCellsY);
+    }
+    for (int cy = 0; cy < numCellsY; cy++)
+    {
+        rangeMaximum(work_.data() + cy, dims.numCells[XX], numCellsY, range[XX], XX < numPbcDim,
+                     neighborhoodDisplacement_.data() + cy);
+    }
+
+    /* The entries of a cluster can be reused when the sum of its displacement
+     * and that of any cluster it can interact with is below the margin.
+     */
+    int numClustersReused = 0;
+    for (int column = 0; column < grid.numColumns(); column++)
+    {
+        const int xyIndex = grid.columnCellX(column) * numCellsY + grid.columnCellY(column);
+        const int firstCell = grid.firstCellInColumn(column);
+        for (int cell = firstCell; cell < firstCell + grid.numCellsInColumn(column); cell++)
+        {
+            canReuseCluster_[cell] =
+                    (clusterDisplacement_[cell] + neighborhoodDisplacement_[xyIndex] <= margin_) ? 1 : 0;
+            numClustersReused += canReuseCluster_[cell];
+        }
+    }
+
+    numClustersReused_ = numClustersReused;
+
+    return numClustersReused >= c_minimumReuseFraction * numClusters;
+}
+
+bool IncrementalPairlist::prepareSearch(const GridSet&          gridSet,
+                                        const nbnxn_atomdata_t& nbat,
+                                        const real              rlist,
+                                        const int               numLists)
+{
+    numClustersReused_ = 0;
+
+    if (setReusableClusters(gridSet, nbat, rlist, numLists))
+    {
+        return true;
+    }
+
+    /* We will do a full search, which will be stored */
+    numClustersReused_ = 0;
+    haveReference_     = false;
+    storedLists_.resize(numLists);
+
+    return false;
+}
+
+void IncrementalPairlist::storeList(const int listIndex, const NbnxnPairlistCpu& list)
+{
+    StoredList& storedList = storedLists_[listIndex];
+
+    storedList.ci.assign(list.ci.begin(), list.ci.end());
+    storedList.cj.assign(list.cj.begin(), list.cj.end());
+}
+
+void IncrementalPairlist::setReference(const GridSet& gridSet, const nbnxn_atomdata_t& nbat, const real rlist)
+{
+    const Grid& grid     = gridSet.grids()[0];
+    const int   numAtoms = grid.atomIndexEnd();
+
+    xReference_.resize(numAtoms);
+    for (int a = 0; a < numAtoms; a++)
+    {
+        xReference_[a] = nbatCoordinates(nbat, a);
+    }
+
+    atomOrderVersion_ = gridSet.localAtomOrderVersion();
+    rlist_            = rlist;
+    haveReference_    = true;
+}
+
+} // namespace Nbnxm
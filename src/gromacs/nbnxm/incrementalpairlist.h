@@ -0,0 +1,161 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2020, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+
+/*! \internal \file
+ *
+ * \brief
+ * Declares the IncrementalPairlist class
+ *
+ * \ingroup module_nbnxm
+ */
+
+#ifndef GMX_NBNXM_INCREMENTALPAIRLIST_H
+#define GMX_NBNXM_INCREMENTALPAIRLIST_H
+
+#include <vector>
+
+#include "gromacs/math/vectypes.h"
+#include "gromacs/utility/real.h"
+
+#include "pairlist.h"
+
+struct nbnxn_atomdata_t;
+
+namespace Nbnxm
+{
+
+class GridSet;
+
+/*! \internal
+ * \brief Enables updating the local CPU pair list by rebuilding only part of the i-entries
+ *
+ * When the local grid was updated keeping the atom order, see
+ * GridSet::putOnGrid(), the i- and j-clusters still contain the same atoms
+ * as at the previous search. We then store the list produced at a full
+ * search, which is built with a radius extended by a margin, together with
+ * the coordinates at that search. At the next searches, the displacement of
+ * each cluster is determined as the maximum displacement of its atoms.
+ * The stored i-entries of an i-cluster are reused when the displacement of
+ * the i-cluster plus the maximum displacement of all clusters in grid
+ * columns within range is below the margin. Such entries then contain all
+ * atom pairs within the list radius. The entries of all other i-clusters
+ * are rebuilt normally. When less than half of the i-clusters can reuse
+ * their entries, a full search with the extended radius is done instead.
+ *
+ * This is only supported for a single CPU grid without perturbed
+ * interactions and with dynamic pruning, since the pruning kernel removes
+ * the extra pairs due to the margin.
+ */
+class IncrementalPairlist
+{
+public:
+    //! The i- and j-entries of a pair list produced by a full search
+    struct StoredList
+    {
+        //! The i-entries
+        FastVector<nbnxn_ci_t> ci;
+        //! The j-entries
+        FastVector<nbnxn_cj_t> cj;
+    };
+
+    //! Constructor
+    IncrementalPairlist();
+
+    /*! \brief Determines which i-clusters can reuse the stored list entries
+     *
+     * \param[in] gridSet   The grid set, should contain a single grid
+     * \param[in] nbat      The atom data with the current coordinates
+     * \param[in] rlist     The radius for the pair list
+     * \param[in] numLists  The number of lists the search is divided over
+     * \returns whether list entries should be reused, when false a full search
+     *          should be done with searchRadius() and stored with storeList()
+     *          and setReference().
+     */
+    bool prepareSearch(const GridSet& gridSet, const nbnxn_atomdata_t& nbat, real rlist, int numLists);
+
+    //! Returns the radius for a full search for a pair list with radius \p rlist
+    real searchRadius(real rlist) const { return rlist + margin_; }
+
+    //! Stores list number \p listIndex produced by a full search
+    void storeList(int listIndex, const NbnxnPairlistCpu& list);
+
+    /*! \brief Stores the reference coordinates and setup after a full search
+     *
+     * Should be called after storeList() has been called for all lists.
+     */
+    void setReference(const GridSet& gridSet, const nbnxn_atomdata_t& nbat, real rlist);
+
+    //! Returns the stored list with index \p listIndex
+    const StoredList& storedList(int listIndex) const { return storedLists_[listIndex]; }
+
+    //! Returns whether the stored entries for the i-cluster with local index \p cluster can be reused
+    bool canReuseCluster(int cluster) const { return canReuseCluster_[cluster] != 0; }
+
+    //! Returns the number of i-clusters that reused their entries at the last search
+    int numClustersReused() const { return numClustersReused_; }
+
+private:
+    //! Sets which clusters can reuse their entries, returns whether enough clusters can
+    bool setReusableClusters(const GridSet& gridSet, const nbnxn_atomdata_t& nbat, real rlist, int numLists);
+
+    //! The extra radius for a full search
+    real margin_;
+    //! Whether we have a stored list and reference coordinates
+    bool haveReference_;
+    //! The local atom order version of the grid set at the full search
+    int atomOrderVersion_;
+    //! The pair list radius at the full search
+    real rlist_;
+    //! The lists stored at the full search
+    std::vector<StoredList> storedLists_;
+    //! The coordinates at the full search, in grid atom order
+    std::vector<gmx::RVec> xReference_;
+    //! The maximum displacement of the atoms in each cluster
+    std::vector<real> clusterDisplacement_;
+    //! The maximum cluster displacement for each grid column
+    std::vector<real> columnDisplacement_;
+    //! The maximum column displacement over the columns within range of each column
+    std::vector<real> neighborhoodDisplacement_;
+    //! Work array for the column range maximum
+    std::vector<real> work_;
+    //! Whether the stored entries of each i-cluster can be reused, char for thread safety
+    std::vector<char> canReuseCluster_;
+    //! The number of i-clusters that reused their entries at the last search
+    int numClustersReused_;
+};
+
+} // namespace Nbnxm
+
+#endif
@@ -0,0 +1,398 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2020, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+
+/*! \internal \file
+ *
+ * \brief
+ * Implements the KernelCounters class
+ *
+ * \ingroup module_nbnxm
+ */
+
+#include "gmxpre.h"
+
+#include "kernelcounters.h"
+
+#include "config.h"
+
+#include <cstdlib>
+
+#include <algorithm>
+#include <bitset>
+#include <string>
+#include <utility>
+
+#include "gromacs/gmxlib/network.h"
+#include "gromacs/mdlib/gmx_omp_nthreads.h"
+#include "gromacs/mdtypes/commrec.h"
+#include "gromacs/mdtypes/interaction_const.h"
+#include "gromacs/nbnxm/nbnxm.h"
+#include "gromacs/utility/fatalerror.h"
+#include "gromacs/utility/futil.h"
+#include "gromacs/utility/gmxassert.h"
+#include "gromacs/utility/logger.h"
+
+#include "atomdata.h"
+
+namespace Nbnxm
+{
+
+/*! \brief The interval in non-bonded kernel calls for sampling the pair distances
+ *
+ * We use an odd interval, so we sample both local and non-local kernel calls.
+ */
+static constexpr int c_distanceSamplingInterval = 11;
+
+//! The default name of the JSON output file
+static const char* c_defaultJsonFileName = "nbnxm_kernel_counters.json";
+
+KernelCounterData& KernelCounterData::operator+=(const KernelCounterData& other)
+{
+    numKernelCalls += other.numKernelCalls;
+    numClusterPairs += other.numClusterPairs;
+    numAtomPairs += other.numAtomPairs;
+    numUnmaskedAtomPairs += other.numUnmaskedAtomPairs;
+    numSampledAtomPairs += other.numSampledAtomPairs;
+    numSampledAtomPairsInRange += other.numSampledAtomPairsInRange;
+    numPruneCalls += other.numPruneCalls;
+    numClusterPairsBeforePrune += other.numClusterPairsBeforePrune;
+    numClusterPairsAfterPrune += other.numClusterPairsAfterPrune;
+
+    return *this;
+}
+
+KernelCounters::KernelCounters(const int numThreads, std::string jsonFileName) :
+    threadCounters_(numThreads),
+    jsonFileName_(std::move(jsonFileName))
+{
+}
+
+//! Returns the coordinates of atom \p a in \p nbat, shifted by \p shift
+static inline gmx::RVec atomCoordinates(const nbnxn_atomdata_t& nbat, const int a, const rvec shift)
+{
+    const real* x = nbat.x().data();
+
+    int index;
+    int stride;
+    switch (nbat.XFormat)
+    {
+        case nbatXYZ:
+            index  = a * STRIDE_XYZ;
+            stride = 1;
+            break;
+        case nbatXYZQ:
+            index  = a * STRIDE_XYZQ;
+            stride = 1;
+            break;
+        case nbatX4:
+            index  = atom_to_x_index<c_packX4>(a);
+            stride = c_packX4;
+            break;
+        case nbatX8:
+            index  = atom_to_x_index<c_packX8>(a);
+            stride = c_packX8;
+            break;
+        default: GMX_RELEASE_ASSERT(false, "Unhandled nbat coordinate format"); return { 0, 0, 0 };
+    }
+
+    return { x[index] + shift[XX], x[index + stride] + shift[YY], x[index + 2 * stride] + shift[ZZ] };
+}
+
+/*! \brief Counts the atom pairs in \p nbl, and when \p sampleDistances is true, the pairs within \p rcut2
+ *
+ * Pairs involving filler particles are never counted as within the cut-off.
+ */
+static void countPairlist(const NbnxnPairlistCpu& nbl,
+                          const nbnxn_atomdata_t& nbat,
+                          const rvec*             shiftVectors,
+                          const real              rcut2,
+                          const bool              sampleDistances,
+                          KernelCounterData*      counters)
+{
+    const int      numPairsPerClusterPair = nbl.na_ci * nbl.na_cj;
+    const uint64_t fullMask               = (uint64_t(1) << numPairsPerClusterPair) - 1;
+    const int*     type                   = nbat.params().type.data();
+    const int      fillerType             = nbat.params().numTypes - 1;
+
+    for (const nbnxn_ci_t& ciEntry : nbl.ci)
+    {
+        const int numClusterPairs = ciEntry.cj_ind_end - ciEntry.cj_ind_start;
+
+        counters->numClusterPairs += numClusterPairs;
+        counters->numAtomPairs += numClusterPairs * numPairsPerClusterPair;
+
+        const real* shift = shiftVectors[ciEntry.shift & NBNXN_CI_SHIFT];
+
+        for (int cjIndex = ciEntry.cj_ind_start; cjIndex < ciEntry.cj_ind_end; cjIndex++)
+        {
+            const nbnxn_cj_t& cjEntry = nbl.cj[cjIndex];
+            const uint64_t    mask    = cjEntry.excl & fullMask;
+
+            counters->numUnmaskedAtomPairs += std::bitset<64>(mask).count();
+
+            if (!sampleDistances)
+            {
+                continue;
+            }
+
+            for (int i = 0; i < nbl.na_ci; i++)
+            {
+                const int       ai = ciEntry.ci * nbl.na_ci + i;
+                const gmx::RVec xi = atomCoordinates(nbat, ai, shift);
+                for (int j = 0; j < nbl.na_cj; j++)
+                {
+                    if (mask & (uint64_t(1) << (i * nbl.na_cj + j)))
+                    {
+                        const int       aj        = cjEntry.cj * nbl.na_cj + j;
+                        const rvec      zeroShift = { 0, 0, 0 };
+                        const gmx::RVec xj        = atomCoordinates(nbat, aj, zeroShift);
+                        const gmx::RVec dx        = xi - xj;
+
+                        counters->numSampledAtomPairs++;
+                        if (dx.norm2() < rcut2 && type[ai] != fillerType && type[aj] != fillerType)
+                        {
+                            counters->numSampledAtomPairsInRange++;
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+void KernelCounters::accountKernel(const gmx::InteractionLocality        iLocality,
+                                   gmx::ArrayRef<const NbnxnPairlistCpu> pairlists,
+                                   const nbnxn_atomdata_t&               nbat,
+                                   const interaction_const_t&            ic,
+                                   const rvec*                           shiftVectors)
+{
+    GMX_ASSERT(pairlists.size() <= threadCounters_.size(),
+               "We need at least as many counter sets as lists");
+
+    const bool sampleDistances = (numKernelDispatches_ % c_distanceSamplingInterval == 0);
+    numKernelDispatches_++;
+
+    std::vector<ThreadCounters>& listCounts = listCounts_[iLocality];
+
+    /* The lists only change with search and pruning, so we only need
+     * a pass over the lists when they changed or we sample distances.
+     */
+    if (!haveListCounts_[iLocality] || sampleDistances)
+    {
+        const real rcut  = std::max(ic.rcoulomb, ic.rvdw);
+        const real rcut2 = rcut * rcut;
+
+        listCounts.resize(pairlists.size());
+
+        int gmx_unused nthreads = gmx_omp_nthreads_get(emntNonbonded);
+#pragma omp parallel for schedule(static) num_threads(nthreads)
+        for (gmx::index nb = 0; nb < pairlists.ssize(); nb++)
+        {
+            listCounts[nb].data = {};
+            countPairlist(pairlists[nb], nbat, shiftVectors, rcut2, sampleDistances,
+                          &listCounts[nb].data);
+        }
+
+        haveListCounts_[iLocality] = true;
+    }
+
+    for (gmx::index nb = 0; nb < pairlists.ssize(); nb++)
+    {
+        KernelCounterData& counters  = threadCounters_[nb].data;
+        KernelCounterData& listCount = listCounts[nb].data;
+
+        counters.numKernelCalls++;
+        counters += listCount;
+
+        /* The sampled counts should only be added for this call */
+        listCount.numSampledAtomPairs        = 0;
+        listCount.numSampledAtomPairsInRange = 0;
+    }
+}
+
+void KernelCounters::accountPrune(const gmx::InteractionLocality        iLocality,
+                                  gmx::ArrayRef<const NbnxnPairlistCpu> pairlists)
+{
+    KernelCounterData* counters = &threadCounters_[0].data;
+
+    counters->numPruneCalls++;
+    for (const NbnxnPairlistCpu& nbl : pairlists)
+    {
+        counters->numClusterPairsBeforePrune += nbl.cjOuter.size();
+        counters->numClusterPairsAfterPrune += nbl.ncjInUse;
+    }
+
+    setListsChanged(iLocality);
+}
+
+KernelCounterData KernelCounters::sum() const
+{
+    KernelCounterData sum;
+    for (const ThreadCounters& threadCounters : threadCounters_)
+    {
+        sum += threadCounters.data;
+    }
+
+    return sum;
+}
+
+//! Returns \p numerator / \p denominator, or 0 when \p denominator is 0
+static double ratio(const double numerator, const double denominator)
+{
+    return (denominator > 0 ? numerator / denominator : 0);
+}
+
+void KernelCounters::report(FILE* fplog, const t_commrec* cr, const KernelType kernelType) const
+{
+    const KernelCounterData localSum = sum();
+
+    /* We sum as doubles over the ranks, which is exact up to 2^53 */
+    double buffer[] = { static_cast<double>(localSum.numKernelCalls),
+                        static_cast<double>(localSum.numClusterPairs),
+                        static_cast<double>(localSum.numAtomPairs),
+                        static_cast<double>(localSum.numUnmaskedAtomPairs),
+                        static_cast<double>(localSum.numSampledAtomPairs),
+                        static_cast<double>(localSum.numSampledAtomPairsInRange),
+                        static_cast<double>(localSum.numPruneCalls),
+                        static_cast<double>(localSum.numClusterPairsBeforePrune),
+                        static_cast<double>(localSum.numClusterPairsAfterPrune) };
+    const int numValues = sizeof(buffer) / sizeof(buffer[0]);
+    if (DOMAINDECOMP(cr))
+    {
+        gmx_sumd(numValues, buffer, cr);
+    }
+
+    const double numKernelCalls             = buffer[0];
+    const double numClusterPairs            = buffer[1];
+    const double numAtomPairs               = buffer[2];
+    const double numUnmaskedAtomPairs       = buffer[3];
+    const double numSampledAtomPairs        = buffer[4];
+    const double numSampledAtomPairsInRange = buffer[5];
+    const double numPruneCalls              = buffer[6];
+    const double numClusterPairsBeforePrune = buffer[7];
+    const double numClusterPairsAfterPrune  = buffer[8];
+
+    const double laneUtilization   = ratio(numUnmaskedAtomPairs, numAtomPairs);
+    const double inRangeFraction   = ratio(numSampledAtomPairsInRange, numSampledAtomPairs);
+    const double pruneKeptFraction = ratio(numClusterPairsAfterPrune, numClusterPairsBeforePrune);
+    const char*  kernelName        = lookup_kernel_name(kernelType);
+
+    if (fplog != nullptr)
+    {
+        fprintf(fplog, "\n    N O N - B O N D E D   K E R N E L   S T A T I S T I C S\n\n");
+        fprintf(fplog, " Kernel type:                                  %s\n", kernelName);
+        fprintf(fplog, " Kernel calls (summed over threads and ranks): %.0f\n", numKernelCalls);
+        fprintf(fplog, " Cluster pairs processed:                      %.0f\n", numClusterPairs);
+        fprintf(fplog, " Atom pairs (SIMD lanes) processed:            %.0f\n", numAtomPairs);
+        fprintf(fplog, " Lanes not masked by exclusions:               %5.1f %%\n",
+                100 * laneUtilization);
+        fprintf(fplog, " Unmasked pairs within the cut-off (sampled):  %5.1f %%\n",
+                100 * inRangeFraction);
+        fprintf(fplog, " Useful lanes, i.e. pairs within the cut-off:  %5.1f %%\n",
+                100 * laneUtilization * inRangeFraction);
+        if (numPruneCalls > 0)
+        {
+            fprintf(fplog, " Pruning calls:                                %.0f\n", numPruneCalls);
+            fprintf(fplog, " Cluster pairs kept by dynamic pruning:        %5.1f %%\n",
+                    100 * pruneKeptFraction);
+        }
+        fprintf(fplog, " Written to: %s\n\n", jsonFileName_.c_str());
+    }
+
+    if (!MASTER(cr))
+    {
+        return;
+    }
+
+    FILE* fp = gmx_ffopen(jsonFileName_, "w");
+    fprintf(fp, "{\n");
+    fprintf(fp, "  \"kernelType\": \"%s\",\n", kernelName);
+    fprintf(fp, "  \"kernelCalls\": %.0f,\n", numKernelCalls);
+    fprintf(fp, "  \"clusterPairs\": %.0f,\n", numClusterPairs);
+    fprintf(fp, "  \"atomPairs\": %.0f,\n", numAtomPairs);
+    fprintf(fp, "  \"unmaskedAtomPairs\": %.0f,\n", numUnmaskedAtomPairs);
+    fprintf(fp, "  \"sampledAtomPairs\": %.0f,\n", numSampledAtomPairs);
+    fprintf(fp, "  \"sampledAtomPairsWithinCutoff\": %.0f,\n", numSampledAtomPairsInRange);
+    fprintf(fp, "  \"laneUtilization\": %.6f,\n", laneUtilization);
+    fprintf(fp, "  \"withinCutoffFraction\": %.6f,\n", inRangeFraction);
+    fprintf(fp, "  \"pruneCalls\": %.0f,\n", numPruneCalls);
+    fprintf(fp, "  \"clusterPairsBeforePrune\": %.0f,\n", numClusterPairsBeforePrune);
+    fprintf(fp, "  \"clusterPairsAfterPrune\": %.0f,\n", numClusterPairsAfterPrune);
+    fprintf(fp, "  \"pruneKeptFraction\": %.6f\n", pruneKeptFraction);
+    fprintf(fp, "}\n");
+    gmx_ffclose(fp);
+}
+
+std::unique_ptr<KernelCounters> makeKernelCounters(const gmx::MDLogger& mdlog,
+                                                   const bool           useCpuKernels,
+                                                   const int            numThreads)
+{
+    const char* env = getenv("GMX_NBNXN_KERNEL_COUNTERS");
+    if (env == nullptr)
+    {
+        return nullptr;
+    }
+
+    if (!GMX_NBNXM_KERNEL_COUNTERS)
+    {
+        GMX_LOG(mdlog.warning)
+                .asParagraph()
+                .appendText(
+                        "GMX_NBNXN_KERNEL_COUNTERS is set, but GROMACS was configured without "
+                        "GMX_NBNXM_KERNEL_COUNTERS, ignoring");
+        return nullptr;
+    }
+    if (!useCpuKernels)
+    {
+        GMX_LOG(mdlog.warning)
+                .asParagraph()
+                .appendText(
+                        "GMX_NBNXN_KERNEL_COUNTERS is set, but non-bonded kernel statistics "
+                        "are only collected for CPU kernels, ignoring");
+        return nullptr;
+    }
+
+    std::string jsonFileName = (env[0] != '\0' ? env : c_defaultJsonFileName);
+
+    GMX_LOG(mdlog.info)
+            .asParagraph()
+            .appendTextFormatted(
+                    "Collecting non-bonded kernel statistics, these will be written to %s",
+                    jsonFileName.c_str());
+
+    return std::make_unique<KernelCounters>(numThreads, std::move(jsonFileName));
+}
+
+} // namespace Nbnxm
@@ -0,0 +1,194 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2020, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+
+/*! \internal \file
+ *
+ * \brief
+ * Declares the KernelCounters class for instrumenting the CPU non-bonded kernels
+ *
+ * \ingroup module_nbnxm
+ */
+
+#ifndef GMX_NBNXM_KERNELCOUNTERS_H
+#define GMX_NBNXM_KERNELCOUNTERS_H
+
+#include <cstdint>
+#include <cstdio>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "gromacs/math/vectypes.h"
+#include "gromacs/mdtypes/locality.h"
+#include "gromacs/utility/arrayref.h"
+#include "gromacs/utility/enumerationhelpers.h"
+
+#include "pairlist.h"
+
+struct interaction_const_t;
+struct nbnxn_atomdata_t;
+struct t_commrec;
+
+namespace gmx
+{
+class MDLogger;
+}
+
+namespace Nbnxm
+{
+
+enum class KernelType;
+
+/*! \internal
+ * \brief Statistics of the work done by the CPU non-bonded and pruning kernels
+ *
+ * All counts are summed over kernel calls. Atom pairs are counted per SIMD
+ * lane, i.e. na_ci x na_cj per cluster pair. The within cut-off counts are
+ * only collected for a sample of the kernel calls, as this requires
+ * computing all pair distances.
+ */
+struct KernelCounterData
+{
+    //! Number of CPU non-bonded kernel calls, summed over threads
+    int64_t numKernelCalls = 0;
+    //! Number of cluster pairs processed by the non-bonded kernels
+    int64_t numClusterPairs = 0;
+    //! Number of atom pairs, i.e. SIMD lanes, processed by the non-bonded kernels
+    int64_t numAtomPairs = 0;
+    //! Number of atom pairs not masked by exclusions or perturbed pairs
+    int64_t numUnmaskedAtomPairs = 0;
+    //! Number of unmasked atom pairs in the sampled kernel calls
+    int64_t numSampledAtomPairs = 0;
+    //! Number of unmasked atom pairs within the cut-off in the sampled kernel calls
+    int64_t numSampledAtomPairsInRange = 0;
+    //! Number of pruning kernel calls
+    int64_t numPruneCalls = 0;
+    //! Number of cluster pairs in the outer lists passed to the pruning kernel
+    int64_t numClusterPairsBeforePrune = 0;
+    //! Number of cluster pairs in the inner lists after pruning
+    int64_t numClusterPairsAfterPrune = 0;
+
+    //! Adds the counts of \p other
+    KernelCounterData& operator+=(const KernelCounterData& other);
+};
+
+/*! \internal
+ * \brief Collects statistics of the CPU non-bonded and pruning kernels
+ *
+ * The statistics are collected from the pair lists and coordinates
+ * after each kernel call, so the kernels themselves are not changed.
+ * Counting is done per thread with one counter set per pair list.
+ * The counts of a list are only recomputed after the list changed,
+ * by search or pruning, or when the pair distances are sampled.
+ * The statistics are printed to the log file at the end of the run
+ * and written to a JSON file for further analysis.
+ */
+class KernelCounters
+{
+public:
+    /*! \brief Constructor
+     *
+     * \param[in] numThreads    The number of threads, and lists, used by the kernels
+     * \param[in] jsonFileName  The name of the file to write the statistics to
+     */
+    KernelCounters(int numThreads, std::string jsonFileName);
+
+    //! Accounts the work done by a non-bonded kernel call on \p pairlists for \p iLocality
+    void accountKernel(gmx::InteractionLocality              iLocality,
+                       gmx::ArrayRef<const NbnxnPairlistCpu> pairlists,
+                       const nbnxn_atomdata_t&               nbat,
+                       const interaction_const_t&            ic,
+                       const rvec*                           shiftVectors);
+
+    //! Accounts the work done by a pruning kernel call on \p pairlists for \p iLocality
+    void accountPrune(gmx::InteractionLocality iLocality, gmx::ArrayRef<const NbnxnPairlistCpu> pairlists);
+
+    //! Tells that the pair lists for \p iLocality have been constructed anew
+    void setListsChanged(gmx::InteractionLocality iLocality) { haveListCounts_[iLocality] = false; }
+
+    //! Returns the counts summed over all threads of this rank
+    KernelCounterData sum() const;
+
+    /*! \brief Sums the counts over the PP ranks, prints them to \p fplog and writes the JSON file
+     *
+     * Needs to be called on all PP ranks. Only the master rank writes the JSON file.
+     */
+    void report(FILE* fplog, const t_commrec* cr, KernelType kernelType) const;
+
+private:
+    /*! \internal
+     * \brief Counters of one thread, padded to avoid false sharing
+     */
+    struct ThreadCounters
+    {
+        //! Cache line padding
+        gmx_cache_protect_t cp0;
+        //! The counters
+        KernelCounterData data;
+        //! Cache line padding
+        gmx_cache_protect_t cp1;
+    };
+
+    //! The counters for each thread
+    std::vector<ThreadCounters> threadCounters_;
+    //! The counts for each list of the last kernel call, sampled counts are not stored
+    gmx::EnumerationArray<gmx::InteractionLocality, std::vector<ThreadCounters>> listCounts_;
+    //! Whether listCounts_ is valid for the current lists
+    gmx::EnumerationArray<gmx::InteractionLocality, bool> haveListCounts_ = { { false, false } };
+    //! The number of non-bonded kernel dispatches, used for sampling
+    int64_t numKernelDispatches_ = 0;
+    //! The name of the JSON output file
+    std::string jsonFileName_;
+};
+
+/*! \brief Returns kernel counters when enabled, otherwise nullptr
+ *
+ * Counters are off by default. They are enabled when configured with
+ * GMX_NBNXM_KERNEL_COUNTERS=ON and the environment variable
+ * GMX_NBNXN_KERNEL_COUNTERS is set. Without the configuration option
+ * the calls in the kernel dispatch are compiled out.
+ *
+ * \param[in] mdlog          Logger
+ * \param[in] useCpuKernels  Whether the CPU SIMD or plain-C cluster kernels are used
+ * \param[in] numThreads     The number of non-bonded threads
+ */
+std::unique_ptr<KernelCounters> makeKernelCounters(const gmx::MDLogger& mdlog,
+                                                   bool                 useCpuKernels,
+                                                   int                  numThreads);
+
+} // namespace Nbnxm
+
+#endif
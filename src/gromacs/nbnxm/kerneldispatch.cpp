@@ -35,6 +35,8 @@
 
 #include "gmxpre.h"
 
+#include "config.h"
+
 #include "gromacs/gmxlib/nrnb.h"
 #include "gromacs/gmxlib/nonbonded/nb_free_energy.h"
 #include "gromacs/gmxlib/nonbonded/nb_kernel.h"
@@ -57,10 +59,13 @@
 #include "gromacs/utility/gmxassert.h"
 #include "gromacs/utility/real.h"
 
+#include "dynamicpruningtuner.h"
 #include "kernel_common.h"
+#include "kernelcounters.h"
 #include "nbnxm_simd.h"
 #include "pairlistset.h"
 #include "pairlistsets.h"
+#include "pairsearch.h"
 #include "kernels_reference/kernel_gpu_ref.h"
 #define INCLUDE_KERNELFUNCTION_TABLES
 #include "kernels_reference/kernel_ref.h"
@@ -160,7 +165,7 @@ static void nbnxn_kernel_cpu(const PairlistSet&         pairlistSet,
 {
 
     int coulkt;
-    if (EEL_RF(ic.eeltype) || ic.eeltype == eelCUT)
+    if (EEL_RF(ic.eeltype) || ic.eeltype == eelCUT || ic.eeltype == eelFMM)
     {
         coulkt = coulktRF;
     }
@@ -367,7 +372,7 @@ static void accountFlops(t_nrnb*                    nrnb,
     const bool usingGpuKernels = nbv.useGpu();
 
     int enr_nbnxn_kernel_ljc;
-    if (EEL_RF(ic.eeltype) || ic.eeltype == eelCUT)
+    if (EEL_RF(ic.eeltype) || ic.eeltype == eelCUT || ic.eeltype == eelFMM)
     {
         enr_nbnxn_kernel_ljc = eNR_NBNXN_LJ_RF;
     }
@@ -428,10 +433,30 @@ void nonbonded_verlet_t::dispatchNonbondedKernel(gmx::InteractionLocality   iLoc
         case Nbnxm::KernelType::Cpu4x4_PlainC:
         case Nbnxm::KernelType::Cpu4xN_Simd_4xN:
         case Nbnxm::KernelType::Cpu4xN_Simd_2xNN:
+            if (Nbnxm::DynamicPruningTuner* tuner = pairlistSets_->dynamicPruningTuner())
+            {
+                if (iLocality == gmx::InteractionLocality::Local)
+                {
+                    tuner->addStep();
+                }
+                tuner->startTiming();
+            }
             nbnxn_kernel_cpu(pairlistSet, kernelSetup(), nbat.get(), ic, fr.shift_vec, stepWork,
                              clearF, enerd->grpp.ener[egCOULSR].data(),
                              fr.bBHAM ? enerd->grpp.ener[egBHAMSR].data() : enerd->grpp.ener[egLJSR].data(),
                              wcycle_);
+            if (Nbnxm::DynamicPruningTuner* tuner = pairlistSets_->dynamicPruningTuner())
+            {
+                tuner->stopTiming();
+            }
+            if (GMX_NBNXM_KERNEL_COUNTERS)
+            {
+                if (Nbnxm::KernelCounters* kernelCounters = pairlistSets_->kernelCounters())
+                {
+                    kernelCounters->accountKernel(iLocality, pairlistSet.cpuLists(), *nbat, ic,
+                                                  fr.shift_vec);
+                }
+            }
             break;
 
         case Nbnxm::KernelType::Gpu8x8x8:
@@ -465,7 +490,7 @@ void nonbonded_verlet_t::dispatchFreeEnergyKernel(gmx::InteractionLocality   iLo
     const auto nbl_fep = pairlistSets().pairlistSet(iLocality).fepLists();
 
     /* When the first list is empty, all are empty and there is nothing to do */
-    if (!pairlistSets().params().haveFep || nbl_fep[0]->nrj == 0)
+    if (!pairlistSets().params().haveFep || nbl_fep[0]->numPairs == 0)
     {
         return;
     }
@@ -489,6 +514,7 @@ void nonbonded_verlet_t::dispatchFreeEnergyKernel(gmx::InteractionLocality   iLo
 
     nb_kernel_data_t kernel_data;
     real             dvdl_nb[efptNR] = { 0 };
+    kernel_data.atomPairs            = nullptr;
     kernel_data.flags                = donb_flags;
     kernel_data.lambda               = lambda;
     kernel_data.dvdl                 = dvdl_nb;
@@ -499,14 +525,25 @@ void nonbonded_verlet_t::dispatchFreeEnergyKernel(gmx::InteractionLocality   iLo
     GMX_ASSERT(gmx_omp_nthreads_get(emntNonbonded) == nbl_fep.ssize(),
                "Number of lists should be same as number of NB threads");
 
+    gmx::ArrayRef<const int> atomIndices = pairSearch_->gridSet().atomIndices();
+
+    fepAtomPairs_.resize(nbl_fep.size());
+
     wallcycle_sub_start(wcycle_, ewcsNONBONDED_FEP);
 #pragma omp parallel for schedule(static) num_threads(nbl_fep.ssize())
     for (gmx::index th = 0; th < nbl_fep.ssize(); th++)
     {
         try
         {
-            gmx_nb_free_energy_kernel(nbl_fep[th].get(), x, forceWithShiftForces, fr, &mdatoms,
-                                      &kernel_data, nrnb);
+            if (!fepAtomPairs_[th])
+            {
+                fepAtomPairs_[th] = std::make_unique<FepIEntryAtomPairs>();
+            }
+            nb_kernel_data_t kernelDataThread = kernel_data;
+            kernelDataThread.atomPairs        = fepAtomPairs_[th].get();
+
+            gmx_nb_free_energy_kernel(*nbl_fep[th], atomIndices, x, forceWithShiftForces, fr,
+                                      &mdatoms, &kernelDataThread, nrnb);
         }
         GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
     }
@@ -547,8 +584,11 @@ void nonbonded_verlet_t::dispatchFreeEnergyKernel(gmx::InteractionLocality   iLo
             {
                 try
                 {
-                    gmx_nb_free_energy_kernel(nbl_fep[th].get(), x, forceWithShiftForces, fr,
-                                              &mdatoms, &kernel_data, nrnb);
+                    nb_kernel_data_t kernelDataThread = kernel_data;
+                    kernelDataThread.atomPairs        = fepAtomPairs_[th].get();
+
+                    gmx_nb_free_energy_kernel(*nbl_fep[th], atomIndices, x, forceWithShiftForces,
+                                              fr, &mdatoms, &kernelDataThread, nrnb);
                 }
                 GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
             }
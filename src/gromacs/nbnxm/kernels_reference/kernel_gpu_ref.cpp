@@ -115,7 +115,7 @@ void nbnxn_kernel_gpu_ref(const NbnxnPairlistGpu*    nbl,
         }
     }
 
-    bEwald = EEL_FULL(iconst->eeltype);
+    bEwald = EEL_FULL(iconst->eeltype) && iconst->eeltype != eelFMM;
     if (bEwald)
     {
         Ftab = iconst->coulombEwaldTables->tableF.data();
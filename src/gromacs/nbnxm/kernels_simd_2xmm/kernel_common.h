@@ -44,6 +44,8 @@
 
 #include <cstdint>
 
+#include "gromacs/nbnxm/halfprecision.h"
+
 #if !GMX_SIMD_HAVE_HSIMD_UTIL_REAL
 #    error "Half-simd utility operations are required for the 2xNN kernels"
 #endif
@@ -69,6 +71,30 @@ static_assert(UNROLLI == c_nbnxnCpuIClusterSize, "UNROLLI should match the i-clu
 #    define TAB_FDV0
 #endif
 
+/* Loads UNROLLJ j-coordinate offsets stored in half precision into both halves
+ * of a SIMD register, see halfprecision.h
+ */
+static inline gmx::SimdReal gmx_simdcall
+loadDuplicateJCoordinateHalfPrecision(const uint16_t* xHalf)
+{
+#if GMX_SIMD_X86_AVX_512 && !GMX_DOUBLE
+    static_assert(UNROLLJ == 8, "With AVX-512 UNROLLJ should be 8");
+    return { _mm512_cvtph_ps(_mm256_broadcastsi128_si256(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(xHalf)))) };
+#elif (GMX_SIMD_X86_AVX_256 || GMX_SIMD_X86_AVX2_256) && !GMX_DOUBLE && defined __F16C__
+    static_assert(UNROLLJ == 4, "With 256-bit AVX UNROLLJ should be 4");
+    const __m128 half = _mm_cvtph_ps(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(xHalf)));
+    return { _mm256_insertf128_ps(_mm256_castps128_ps256(half), half, 1) };
+#else
+    alignas(GMX_SIMD_ALIGNMENT) real buffer[GMX_SIMD_REAL_WIDTH];
+    for (int j = 0; j < UNROLLJ; j++)
+    {
+        buffer[j] = Nbnxm::halfToFloat(xHalf[j]);
+    }
+    return gmx::loadDuplicateHsimd(buffer);
+#endif
+}
+
 #if defined UNROLLJ
 /* As add_ener_grp, but for two groups of UNROLLJ/2 stored in
  * a single SIMD register.
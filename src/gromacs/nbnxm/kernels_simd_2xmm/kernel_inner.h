@@ -223,9 +223,21 @@
 #endif /* CHECK_EXCLS */
 
     /* load j atom coordinates */
-    jx_S = loadDuplicateHsimd(x + ajx);
-    jy_S = loadDuplicateHsimd(x + ajy);
-    jz_S = loadDuplicateHsimd(x + ajz);
+    if (useHalfPrecisionX)
+    {
+        jx_S = SimdReal(xHalfOrigin[cj * DIM + XX])
+               + loadDuplicateJCoordinateHalfPrecision(xHalf + ajx);
+        jy_S = SimdReal(xHalfOrigin[cj * DIM + YY])
+               + loadDuplicateJCoordinateHalfPrecision(xHalf + ajy);
+        jz_S = SimdReal(xHalfOrigin[cj * DIM + ZZ])
+               + loadDuplicateJCoordinateHalfPrecision(xHalf + ajz);
+    }
+    else
+    {
+        jx_S = loadDuplicateHsimd(x + ajx);
+        jy_S = loadDuplicateHsimd(x + ajy);
+        jz_S = loadDuplicateHsimd(x + ajz);
+    }
 
     /* Calculate distance */
     dx_S0 = ix_S0 - jx_S;
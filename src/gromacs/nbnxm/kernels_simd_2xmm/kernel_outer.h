@@ -317,6 +317,11 @@
     const real* gmx_restrict shiftvec = shift_vec[0];
     const real* gmx_restrict x        = nbat->x().data();
 
+    /* With half-precision storage, j-coordinates are read from xHalf */
+    const bool                   useHalfPrecisionX = nbat->useHalfPrecisionX();
+    const uint16_t* gmx_restrict xHalf             = nbat->xHalf().data();
+    const real* gmx_restrict     xHalfOrigin       = nbat->xHalfOrigin().data();
+
 #ifdef FIX_LJ_C
 
     for (jp = 0; jp < UNROLLJ; jp++)
@@ -43,6 +43,10 @@
 
 #include "config.h"
 
+#include <cstdint>
+
+#include "gromacs/nbnxm/halfprecision.h"
+
 #ifndef GMX_SIMD_J_UNROLL_SIZE
 #    error "Need to define GMX_SIMD_J_UNROLL_SIZE before including the 4xn kernel common header file"
 #endif
@@ -69,6 +73,22 @@ static_assert(UNROLLI == c_nbnxnCpuIClusterSize, "UNROLLI should match the i-clu
 #    define TAB_FDV0
 #endif
 
+/* Loads UNROLLJ j-coordinate offsets stored in half precision, see halfprecision.h */
+static inline gmx::SimdReal gmx_simdcall loadJCoordinateHalfPrecision(const uint16_t* xHalf)
+{
+#if (GMX_SIMD_X86_AVX_256 || GMX_SIMD_X86_AVX2_256) && !GMX_DOUBLE && defined __F16C__
+    static_assert(UNROLLJ == 8, "With 256-bit AVX UNROLLJ should be 8");
+    return { _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(xHalf))) };
+#else
+    alignas(GMX_SIMD_ALIGNMENT) real buffer[GMX_SIMD_REAL_WIDTH];
+    for (int j = 0; j < UNROLLJ; j++)
+    {
+        buffer[j] = Nbnxm::halfToFloat(xHalf[j]);
+    }
+    return gmx::load<gmx::SimdReal>(buffer);
+#endif
+}
+
 
 #ifdef UNROLLJ
 /* Add energy register to possibly multiple terms in the energy array */
@@ -274,9 +274,18 @@
 #    endif /* CHECK_EXCLS */
 
     /* load j atom coordinates */
-    jx_S = load<SimdReal>(x + ajx);
-    jy_S = load<SimdReal>(x + ajy);
-    jz_S = load<SimdReal>(x + ajz);
+    if (useHalfPrecisionX)
+    {
+        jx_S = SimdReal(xHalfOrigin[cj * DIM + XX]) + loadJCoordinateHalfPrecision(xHalf + ajx);
+        jy_S = SimdReal(xHalfOrigin[cj * DIM + YY]) + loadJCoordinateHalfPrecision(xHalf + ajy);
+        jz_S = SimdReal(xHalfOrigin[cj * DIM + ZZ]) + loadJCoordinateHalfPrecision(xHalf + ajz);
+    }
+    else
+    {
+        jx_S = load<SimdReal>(x + ajx);
+        jy_S = load<SimdReal>(x + ajy);
+        jz_S = load<SimdReal>(x + ajz);
+    }
 
     /* Calculate distance */
     dx_S0 = ix_S0 - jx_S;
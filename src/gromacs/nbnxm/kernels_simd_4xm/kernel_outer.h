@@ -335,6 +335,11 @@
     const real* gmx_restrict shiftvec = shift_vec[0];
     const real* gmx_restrict x        = nbat->x().data();
 
+    /* With half-precision storage, j-coordinates are read from xHalf */
+    const bool                   useHalfPrecisionX = nbat->useHalfPrecisionX();
+    const uint16_t* gmx_restrict xHalf             = nbat->xHalf().data();
+    const real* gmx_restrict     xHalfOrigin       = nbat->xHalfOrigin().data();
+
 #ifdef FIX_LJ_C
     alignas(GMX_SIMD_ALIGNMENT) real pvdw_c6[2 * UNROLLI * UNROLLJ];
     real*                            pvdw_c12 = pvdw_c6 + UNROLLI * UNROLLJ;
@@ -49,6 +49,7 @@
 #include "gromacs/timing/wallcycle.h"
 
 #include "atomdata.h"
+#include "kernelcounters.h"
 #include "pairlistsets.h"
 #include "pairsearch.h"
 
@@ -70,6 +71,13 @@ void nbnxn_put_on_grid(nonbonded_verlet_t*            nb_verlet,
     nb_verlet->pairSearch_->putOnGrid(box, gridIndex, lowerCorner, upperCorner, updateGroupsCog,
                                       atomRange, atomDensity, atomInfo, x, numAtomsMoved, move,
                                       nb_verlet->nbat.get());
+
+    /* The non-local grids are converted in nbnxn_put_on_grid_nonlocal */
+    if (gridIndex == 0 && nb_verlet->nbat->useHalfPrecisionX())
+    {
+        nbnxn_atomdata_copy_x_to_half_precision(nb_verlet->pairSearch_->gridSet(),
+                                                gmx::AtomLocality::Local, nb_verlet->nbat.get());
+    }
 }
 
 /* Calls nbnxn_put_on_grid for all non-local domains */
@@ -91,6 +99,12 @@ void nbnxn_put_on_grid_nonlocal(nonbonded_verlet_t*              nbv,
                           { zones->cg_range[zone], zones->cg_range[zone + 1] }, -1, atomInfo, x, 0,
                           nullptr);
     }
+
+    if (nbv->nbat->useHalfPrecisionX())
+    {
+        nbnxn_atomdata_copy_x_to_half_precision(nbv->pairSearch_->gridSet(),
+                                                gmx::AtomLocality::NonLocal, nbv->nbat.get());
+    }
 }
 
 bool nonbonded_verlet_t::isDynamicPruningStepCpu(int64_t step) const
@@ -133,6 +147,11 @@ void nonbonded_verlet_t::convertCoordinates(const gmx::AtomLocality        local
     nbnxn_atomdata_copy_x_to_nbat_x(pairSearch_->gridSet(), locality, fillLocal,
                                     as_rvec_array(coordinates.data()), nbat.get());
 
+    if (nbat->useHalfPrecisionX())
+    {
+        nbnxn_atomdata_copy_x_to_half_precision(pairSearch_->gridSet(), locality, nbat.get());
+    }
+
     wallcycle_sub_stop(wcycle_, ewcsNB_X_BUF_OPS);
     wallcycle_stop(wcycle_, ewcNB_XF_BUF_OPS);
 }
@@ -235,6 +254,23 @@ void nonbonded_verlet_t::changePairlistRadii(real rlistOuter, real rlistInner)
     pairlistSets_->changePairlistRadii(rlistOuter, rlistInner);
 }
 
+bool nonbonded_verlet_t::disableDynamicPruningTuning()
+{
+    const bool wasTuning = (pairlistSets_->dynamicPruningTuner() != nullptr);
+
+    pairlistSets_->disableDynamicPruningTuning();
+
+    return wasTuning;
+}
+
+void nonbonded_verlet_t::reportKernelCounters(FILE* fplog, const t_commrec* cr) const
+{
+    if (const Nbnxm::KernelCounters* kernelCounters = pairlistSets_->kernelCounters())
+    {
+        kernelCounters->report(fplog, cr, kernelSetup_.kernelType);
+    }
+}
+
 void nonbonded_verlet_t::atomdata_init_copy_x_to_nbat_x_gpu()
 {
     Nbnxm::nbnxn_gpu_init_x_to_nbat_x(pairSearch_->gridSet(), gpu_nbv);
@@ -110,7 +110,10 @@
 #ifndef GMX_NBNXM_NBNXM_H
 #define GMX_NBNXM_NBNXM_H
 
+#include <cstdio>
+
 #include <memory>
+#include <vector>
 
 #include "gromacs/gpu_utils/devicebuffer_datatype.h"
 #include "gromacs/math/vectypes.h"
@@ -123,6 +126,7 @@
 // TODO: Remove this include
 #include "nbnxm_gpu.h"
 
+struct FepIEntryAtomPairs;
 struct gmx_device_info_t;
 struct gmx_domdec_zones_t;
 struct gmx_enerdata_t;
@@ -263,6 +267,8 @@ public:
      * \param[in] locality     Whether coordinates for local or non-local atoms should be
      * transformed. \param[in] fillLocal    If the coordinates for filler particles should be
      * zeroed. \param[in] coordinates  Coordinates in plain rvec format to be transformed.
+     *
+     * With half-precision j-coordinate storage, the half-precision offsets are also updated.
      */
     void convertCoordinates(gmx::AtomLocality locality, bool fillLocal, gmx::ArrayRef<const gmx::RVec> coordinates);
 
@@ -365,6 +371,20 @@ public:
     //! Changes the pair-list outer and inner radius
     void changePairlistRadii(real rlistOuter, real rlistInner);
 
+    /*! \brief Stops runtime tuning of the dynamic pruning interval
+     *
+     * Should be called when reproducibility is required.
+     * Returns whether tuning was active.
+     */
+    bool disableDynamicPruningTuning();
+
+    /*! \brief Reports the CPU non-bonded kernel statistics, when collected
+     *
+     * Needs to be called on all PP ranks, as the statistics are summed over ranks.
+     * Prints to \p fplog when not nullptr and writes a JSON file on the master rank.
+     */
+    void reportKernelCounters(FILE* fplog, const t_commrec* cr) const;
+
     //! Set up internal flags that indicate what type of short-range work there is.
     void setupGpuShortRangeWork(const gmx::GpuBonded* gpuBonded, const gmx::InteractionLocality iLocality)
     {
@@ -394,6 +414,8 @@ private:
     Nbnxm::KernelSetup kernelSetup_;
     //! \brief Pointer to wallcycle structure.
     gmx_wallcycle* wcycle_;
+    //! Per-thread buffers for unpacking the perturbed pairlist entries in the FEP kernel
+    std::vector<std::unique_ptr<FepIEntryAtomPairs>> fepAtomPairs_;
 
 public:
     //! GPU Nbnxm data, only used with a physical GPU (TODO: use unique_ptr)
@@ -430,6 +452,8 @@ std::unique_ptr<nonbonded_verlet_t> init_nb_verlet(const gmx::MDLogger&     mdlo
  * With domain decomposition, part of the atoms might have migrated,
  * but have not been removed yet. This count is given by \p numAtomsMoved.
  * When \p move[i] < 0 particle i has migrated and will not be put on the grid.
+ * With half-precision j-coordinate storage, the offsets of the local grid
+ * are updated here, those of the non-local grids in nbnxn_put_on_grid_nonlocal.
  *
  * \param[in,out] nb_verlet    The non-bonded object
  * \param[in]     box          Box used for periodic distance calculations
@@ -44,6 +44,7 @@
 
 #include "gromacs/domdec/domdec.h"
 #include "gromacs/domdec/domdec_struct.h"
+#include "gromacs/gmxlib/nonbonded/nb_free_energy.h"
 #include "gromacs/hardware/hw_info.h"
 #include "gromacs/mdlib/gmx_omp_nthreads.h"
 #include "gromacs/mdtypes/commrec.h"
@@ -57,8 +58,10 @@
 #include "gromacs/utility/logger.h"
 
 #include "atomdata.h"
+#include "dynamicpruningtuner.h"
 #include "gpu_types.h"
 #include "grid.h"
+#include "kernelcounters.h"
 #include "nbnxm_geometry.h"
 #include "nbnxm_simd.h"
 #include "pairlist.h"
@@ -304,9 +307,13 @@ static KernelSetup pick_nbnxn_kernel(const gmx::MDLogger&     mdlog,
 
 PairlistSets::PairlistSets(const PairlistParams& pairlistParams,
                            const bool            haveMultipleDomains,
-                           const int             minimumIlistCountForGpuBalancing) :
+                           const int             minimumIlistCountForGpuBalancing,
+                           std::unique_ptr<Nbnxm::DynamicPruningTuner> dynamicPruningTuner,
+                           std::unique_ptr<Nbnxm::KernelCounters>      kernelCounters) :
     params_(pairlistParams),
-    minimumIlistCountForGpuBalancing_(minimumIlistCountForGpuBalancing)
+    minimumIlistCountForGpuBalancing_(minimumIlistCountForGpuBalancing),
+    dynamicPruningTuner_(std::move(dynamicPruningTuner)),
+    kernelCounters_(std::move(kernelCounters))
 {
     localSet_ = std::make_unique<PairlistSet>(gmx::InteractionLocality::Local, params_);
 
@@ -316,6 +323,8 @@ PairlistSets::PairlistSets(const PairlistParams& pairlistParams,
     }
 }
 
+PairlistSets::~PairlistSets() = default;
+
 namespace Nbnxm
 {
 
@@ -440,6 +449,27 @@ std::unique_ptr<nonbonded_verlet_t> init_nb_verlet(const gmx::MDLogger&     mdlo
                         fr->nbfp, mimimumNumEnergyGroupNonbonded,
                         (useGpu || emulateGpu) ? 1 : gmx_omp_nthreads_get(emntNonbonded));
 
+    if (getenv("GMX_NBNXN_HALF_PRECISION_X") != nullptr)
+    {
+        if (nbat->setUseHalfPrecisionX(true))
+        {
+            GMX_LOG(mdlog.info)
+                    .asParagraph()
+                    .appendText(
+                            "Storing j-cluster coordinates as half-precision offsets for the "
+                            "non-bonded kernels");
+        }
+        else
+        {
+            GMX_LOG(mdlog.warning)
+                    .asParagraph()
+                    .appendText(
+                            "GMX_NBNXN_HALF_PRECISION_X is set, but half-precision coordinate "
+                            "storage is only supported with mixed-precision SIMD kernels, "
+                            "ignoring");
+        }
+    }
+
     gmx_nbnxn_gpu_t* gpu_nbv                          = nullptr;
     int              minimumIlistCountForGpuBalancing = 0;
     if (useGpu)
@@ -451,13 +481,35 @@ std::unique_ptr<nonbonded_verlet_t> init_nb_verlet(const gmx::MDLogger&     mdlo
         minimumIlistCountForGpuBalancing = getMinimumIlistCountForGpuBalancing(gpu_nbv);
     }
 
-    auto pairlistSets = std::make_unique<PairlistSets>(pairlistParams, haveMultipleDomains,
-                                                       minimumIlistCountForGpuBalancing);
+    auto pairlistSets = std::make_unique<PairlistSets>(
+            pairlistParams, haveMultipleDomains, minimumIlistCountForGpuBalancing,
+            makeDynamicPruningTuner(mdlog, ir, mtop, box, pairlistParams),
+            makeKernelCounters(mdlog, !useGpu && !emulateGpu, gmx_omp_nthreads_get(emntNonbonded)));
+
+    ColumnOrder columnOrder = ColumnOrder::Natural;
+    if (getenv("GMX_NBNXN_HILBERT_COLUMNS") != nullptr)
+    {
+        if (useGpu || emulateGpu)
+        {
+            GMX_LOG(mdlog.warning)
+                    .asParagraph()
+                    .appendText(
+                            "GMX_NBNXN_HILBERT_COLUMNS is set, but ordering grid columns along "
+                            "a Hilbert curve is only supported with CPU pair lists, ignoring");
+        }
+        else
+        {
+            columnOrder = ColumnOrder::Hilbert;
+            GMX_LOG(mdlog.info)
+                    .asParagraph()
+                    .appendText("Ordering the pair-search grid columns along a Hilbert curve");
+        }
+    }
 
     auto pairSearch = std::make_unique<PairSearch>(
             ir->ePBC, EI_TPI(ir->eI), DOMAINDECOMP(cr) ? &cr->dd->nc : nullptr,
             DOMAINDECOMP(cr) ? domdec_zones(cr->dd) : nullptr, pairlistParams.pairlistType,
-            bFEP_NonBonded, gmx_omp_nthreads_get(emntPairsearch), pinPolicy);
+            bFEP_NonBonded, columnOrder, gmx_omp_nthreads_get(emntPairsearch), pinPolicy);
 
     return std::make_unique<nonbonded_verlet_t>(std::move(pairlistSets), std::move(pairSearch),
                                                 std::move(nbat), kernelSetup, gpu_nbv, wcycle);
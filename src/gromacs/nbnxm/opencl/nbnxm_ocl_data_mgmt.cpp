@@ -279,11 +279,11 @@ static void map_interaction_types_to_gpu_kernel_flavors(const interaction_const_
     {
         *gpu_eeltype = eelOclCUT;
     }
-    else if (EEL_RF(ic->eeltype))
+    else if (EEL_RF(ic->eeltype) || ic->eeltype == eelFMM)
     {
         *gpu_eeltype = eelOclRF;
     }
-    else if ((EEL_PME(ic->eeltype) || ic->eeltype == eelEWALD))
+    else if (EEL_PME_EWALD(ic->eeltype))
     {
         *gpu_eeltype = nbnxn_gpu_pick_ewald_kernel_type(*ic);
     }
@@ -67,7 +67,10 @@
 #include "atomdata.h"
 #include "boundingboxes.h"
 #include "clusterdistancekerneltype.h"
+#include "dynamicpruningtuner.h"
 #include "gridset.h"
+#include "incrementalpairlist.h"
+#include "kernelcounters.h"
 #include "nbnxm_geometry.h"
 #include "nbnxm_simd.h"
 #include "pairlistset.h"
@@ -216,26 +219,16 @@ static inline int xIndexFromCj(int cj)
 #endif // GMX_SIMD
 
 
-void nbnxn_init_pairlist_fep(t_nblist* nl)
+NbnxnPairlistFep::NbnxnPairlistFep(PairlistType pairlistType) :
+    na_ci(IClusterSizePerListType[pairlistType]),
+    /* With GPU lists we store half j-clusters, so a pair mask fits in 32 bits */
+    na_cj(pairlistType == PairlistType::HierarchicalNxN
+                  ? c_nbnxnGpuClusterSize / c_nbnxnGpuClusterpairSplit
+                  : JClusterSizePerListType[pairlistType]),
+    numPairs(0)
 {
-    nl->type      = GMX_NBLIST_INTERACTION_FREE_ENERGY;
-    nl->igeometry = GMX_NBLIST_GEOMETRY_PARTICLE_PARTICLE;
-    /* The interaction functions are set in the free energy kernel fuction */
-    nl->ivdw     = -1;
-    nl->ivdwmod  = -1;
-    nl->ielec    = -1;
-    nl->ielecmod = -1;
-
-    nl->maxnri   = 0;
-    nl->maxnrj   = 0;
-    nl->nri      = 0;
-    nl->nrj      = 0;
-    nl->iinr     = nullptr;
-    nl->gid      = nullptr;
-    nl->shift    = nullptr;
-    nl->jindex   = nullptr;
-    nl->jjnr     = nullptr;
-    nl->excl_fep = nullptr;
+    GMX_RELEASE_ASSERT(na_ci * na_cj <= static_cast<int>(sizeof(nbnxn_fep_cj_t::pairMask) * 8),
+                       "The FEP pair masks should have a bit for each atom pair in a cluster pair");
 }
 
 static void init_buffer_flags(nbnxn_buffer_flags_t* flags, int natoms)
@@ -732,12 +725,18 @@ PairlistSet::PairlistSet(const InteractionLocality locality, const PairlistParam
                  * master thread (but all contained list memory thread local)
                  * impacts performance.
                  */
-                fepLists_[i] = std::make_unique<t_nblist>();
-                nbnxn_init_pairlist_fep(fepLists_[i].get());
+                fepLists_[i] = std::make_unique<NbnxnPairlistFep>(params_.pairlistType);
             }
             GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
         }
     }
+
+    /* The incremental list update relies on the grid being updated keeping the atom order */
+    if (isCpuType_ && locality_ == InteractionLocality::Local && !params_.haveFep
+        && getenv("GMX_NBNXN_INCREMENTAL_GRID") != nullptr)
+    {
+        incrementalPairlist_ = std::make_unique<Nbnxm::IncrementalPairlist>();
+    }
 }
 
 /* Print statistics of a pair list, used for debug output */
@@ -1358,6 +1357,22 @@ static nbnxn_sci_t* getOpenIEntry(NbnxnPairlistGpu* nbl)
     return &nbl->sci.back();
 }
 
+/* Sorts the j-clusters of the open i-entry on index
+ *
+ * With a column order other than the natural one, the j-clusters are not
+ * added in increasing order, but setExclusionsForIEntry() requires this.
+ */
+static void sortJClustersOfOpenIEntry(NbnxnPairlistCpu* nbl)
+{
+    const nbnxn_ci_t& iEntry = *getOpenIEntry(nbl);
+
+    std::sort(nbl->cj.begin() + iEntry.cj_ind_start, nbl->cj.begin() + iEntry.cj_ind_end,
+              [](const nbnxn_cj_t& cj1, const nbnxn_cj_t& cj2) { return cj1.cj < cj2.cj; });
+}
+
+/* GPU lists always use the natural column order */
+static void sortJClustersOfOpenIEntry(NbnxnPairlistGpu gmx_unused* nbl) {}
+
 /* Set all atom-pair exclusions for a simple type list i-entry
  *
  * Set all atom-pair exclusions from the topology stored in exclusions
@@ -1436,238 +1451,157 @@ static void setExclusionsForIEntry(const Nbnxm::GridSet& gridSet,
     }
 }
 
-/* Add a new i-entry to the FEP list and copy the i-properties */
-static inline void fep_list_new_nri_copy(t_nblist* nlist)
-{
-    /* Add a new i-entry */
-    nlist->nri++;
-
-    assert(nlist->nri < nlist->maxnri);
-
-    /* Duplicate the last i-entry, except for jindex, which continues */
-    nlist->iinr[nlist->nri]   = nlist->iinr[nlist->nri - 1];
-    nlist->shift[nlist->nri]  = nlist->shift[nlist->nri - 1];
-    nlist->gid[nlist->nri]    = nlist->gid[nlist->nri - 1];
-    nlist->jindex[nlist->nri] = nlist->nrj;
-}
+/* For load balancing of the free-energy lists over threads, we limit
+ * the number of atom pairs in an i-entry to max_nrj_fep times the number
+ * of atoms in an i-cluster. This leads to good load balancing in the worst
+ * case scenario of a single perturbed particle on 16 threads, while not
+ * introducing significant overhead.
+ * Note that half of the perturbed pairs will anyhow end up in very small lists,
+ * since non perturbed i-particles will see few perturbed j-particles).
+ */
+const int max_nrj_fep = 40;
 
-/* Rellocate FEP list for size nl->maxnri, TODO: replace by C++ */
-static void reallocate_nblist(t_nblist* nl)
+/* Adds a j-entry to the FEP list, starts a new i-entry when needed
+ *
+ * A new i-entry for i-cluster \p ci is started when \p *haveOpenIEntry
+ * is false or when the current i-entry is full.
+ */
+static void addFepJEntry(NbnxnPairlistFep*     nlist,
+                         bool*                 haveOpenIEntry,
+                         int                   ci,
+                         int                   shift,
+                         const nbnxn_fep_cj_t& cjEntry,
+                         int                   numPairs)
 {
-    if (gmx_debug_at)
+    if (!*haveOpenIEntry || nlist->ci.back().numPairs >= nlist->na_ci * max_nrj_fep)
     {
-        fprintf(debug,
-                "reallocating neigborlist (ielec=%d, ivdw=%d, igeometry=%d, type=%d), maxnri=%d\n",
-                nl->ielec, nl->ivdw, nl->igeometry, nl->type, nl->maxnri);
+        const int cjIndex = nlist->cj.size();
+        nlist->ci.push_back({ ci, shift, cjIndex, cjIndex, 0 });
+        *haveOpenIEntry = true;
     }
-    srenew(nl->iinr, nl->maxnri);
-    srenew(nl->gid, nl->maxnri);
-    srenew(nl->shift, nl->maxnri);
-    srenew(nl->jindex, nl->maxnri + 1);
-}
 
-/* For load balancing of the free-energy lists over threads, we set
- * the maximum nrj size of an i-entry to 40. This leads to good
- * load balancing in the worst case scenario of a single perturbed
- * particle on 16 threads, while not introducing significant overhead.
- * Note that half of the perturbed pairs will anyhow end up in very small lists,
- * since non perturbed i-particles will see few perturbed j-particles).
- */
-const int max_nrj_fep = 40;
+    nlist->cj.push_back(cjEntry);
+
+    nbnxn_fep_ci_t& ciEntry = nlist->ci.back();
+    ciEntry.cj_ind_end++;
+    ciEntry.numPairs += numPairs;
+    nlist->numPairs += numPairs;
+}
 
 /* Exclude the perturbed pairs from the Verlet list. This is only done to avoid
  * singularities for overlapping particles (0/0), since the charges and
  * LJ parameters have been zeroed in the nbnxn data structure.
- * Simultaneously make a group pair list for the perturbed pairs.
+ * Simultaneously make a cluster-pair list for the perturbed pairs.
  */
-static void make_fep_list(gmx::ArrayRef<const int> atomIndices,
-                          const nbnxn_atomdata_t*  nbat,
-                          NbnxnPairlistCpu*        nbl,
-                          gmx_bool                 bDiagRemoved,
-                          nbnxn_ci_t*              nbl_ci,
+static void make_fep_list(gmx::ArrayRef<const int>           atomIndices,
+                          const nbnxn_atomdata_t gmx_unused* nbat,
+                          NbnxnPairlistCpu*                  nbl,
+                          gmx_bool                           bDiagRemoved,
+                          nbnxn_ci_t*                        nbl_ci,
                           real gmx_unused shx,
                           real gmx_unused shy,
                           real gmx_unused shz,
                           real gmx_unused rlist_fep2,
-                          const Grid&     iGrid,
-                          const Grid&     jGrid,
-                          t_nblist*       nlist)
+                          const Grid&       iGrid,
+                          const Grid&       jGrid,
+                          NbnxnPairlistFep* nlist)
 {
-    int      ci, cj_ind_start, cj_ind_end, cja, cjr;
-    int      nri_max;
-    int      gid_i = 0, gid_j, gid;
-    int      egp_shift, egp_mask;
-    int      gid_cj = 0;
-    int      ind_i, ind_j, ai, aj;
-    int      nri;
-    gmx_bool bFEP_i, bFEP_i_all;
-
     if (nbl_ci->cj_ind_end == nbl_ci->cj_ind_start)
     {
         /* Empty list */
         return;
     }
 
-    ci = nbl_ci->ci;
+    GMX_ASSERT(nlist->na_ci == nbl->na_ci && nlist->na_cj == nbl->na_cj,
+               "The FEP list should use the cluster sizes of the normal list");
 
-    cj_ind_start = nbl_ci->cj_ind_start;
-    cj_ind_end   = nbl_ci->cj_ind_end;
-
-    /* In worst case we have alternating energy groups
-     * and create #atom-pair lists, which means we need the size
-     * of a cluster pair (na_ci*na_cj) times the number of cj's.
-     */
-    nri_max = nbl->na_ci * nbl->na_cj * (cj_ind_end - cj_ind_start);
-    if (nlist->nri + nri_max > nlist->maxnri)
-    {
-        nlist->maxnri = over_alloc_large(nlist->nri + nri_max);
-        reallocate_nblist(nlist);
-    }
+    const int ci           = nbl_ci->ci;
+    const int ciRel        = ci - iGrid.cellOffset();
+    const int cj_ind_start = nbl_ci->cj_ind_start;
+    const int cj_ind_end   = nbl_ci->cj_ind_end;
+    const int shift        = nbl_ci->shift & NBNXN_CI_SHIFT;
 
     const int numAtomsJCluster = jGrid.geometry().numAtomsJCluster;
 
-    const nbnxn_atomdata_t::Params& nbatParams = nbat->params();
-
-    const int ngid = nbatParams.nenergrp;
-
-    /* TODO: Consider adding a check in grompp and changing this to an assert */
-    const int numBitsInEnergyGroupIdsForAtomsInJCluster = sizeof(gid_cj) * 8;
-    if (ngid * numAtomsJCluster > numBitsInEnergyGroupIdsForAtomsInJCluster)
+    /* Check if all i-atoms are perturbed */
+    gmx_bool bFEP_i_all = TRUE;
+    for (int i = 0; i < nbl->na_ci; i++)
     {
-        gmx_fatal(FARGS,
-                  "The Verlet scheme with %dx%d kernels and free-energy only supports up to %zu "
-                  "energy groups",
-                  iGrid.geometry().numAtomsICluster, numAtomsJCluster,
-                  (sizeof(gid_cj) * 8) / numAtomsJCluster);
+        if (atomIndices[ci * nbl->na_ci + i] >= 0)
+        {
+            bFEP_i_all = bFEP_i_all && iGrid.atomIsPerturbed(ciRel, i);
+        }
     }
 
-    egp_shift = nbatParams.neg_2log;
-    egp_mask  = (1 << egp_shift) - 1;
-
-    /* Loop over the atoms in the i sub-cell */
-    bFEP_i_all = TRUE;
-    for (int i = 0; i < nbl->na_ci; i++)
+    bool haveOpenIEntry = false;
+    for (int cj_ind = cj_ind_start; cj_ind < cj_ind_end; cj_ind++)
     {
-        ind_i = ci * nbl->na_ci + i;
-        ai    = atomIndices[ind_i];
-        if (ai >= 0)
-        {
-            nri                    = nlist->nri;
-            nlist->jindex[nri + 1] = nlist->jindex[nri];
-            nlist->iinr[nri]       = ai;
-            /* The actual energy group pair index is set later */
-            nlist->gid[nri]   = 0;
-            nlist->shift[nri] = nbl_ci->shift & NBNXN_CI_SHIFT;
+        unsigned int fep_cj;
 
-            bFEP_i = iGrid.atomIsPerturbed(ci - iGrid.cellOffset(), i);
+        const int cja = nbl->cj[cj_ind].cj;
 
-            bFEP_i_all = bFEP_i_all && bFEP_i;
+        if (numAtomsJCluster == jGrid.geometry().numAtomsICluster)
+        {
+            fep_cj = jGrid.fepBits(cja - jGrid.cellOffset());
+        }
+        else if (2 * numAtomsJCluster == jGrid.geometry().numAtomsICluster)
+        {
+            const int cjr = cja - jGrid.cellOffset() * 2;
+            /* Extract half of the ci fep mask */
+            fep_cj = (jGrid.fepBits(cjr >> 1) >> ((cjr & 1) * numAtomsJCluster))
+                     & ((1 << numAtomsJCluster) - 1);
+        }
+        else
+        {
+            const int cjr = cja - (jGrid.cellOffset() >> 1);
+            /* Combine two ci fep masks */
+            fep_cj = jGrid.fepBits(cjr * 2)
+                     + (jGrid.fepBits(cjr * 2 + 1) << jGrid.geometry().numAtomsICluster);
+        }
 
-            if (nlist->nrj + (cj_ind_end - cj_ind_start) * nbl->na_cj > nlist->maxnrj)
-            {
-                nlist->maxnrj = over_alloc_small(nlist->nrj + (cj_ind_end - cj_ind_start) * nbl->na_cj);
-                srenew(nlist->jjnr, nlist->maxnrj);
-                srenew(nlist->excl_fep, nlist->maxnrj);
-            }
+        if (!iGrid.clusterIsPerturbed(ciRel) && fep_cj == 0)
+        {
+            continue;
+        }
 
-            if (ngid > 1)
+        /* Collect the perturbed pairs in this cluster pair */
+        unsigned int pairMask = 0;
+        int          numPairs = 0;
+        for (int i = 0; i < nbl->na_ci; i++)
+        {
+            const int ind_i = ci * nbl->na_ci + i;
+            if (atomIndices[ind_i] < 0)
             {
-                gid_i = (nbatParams.energrp[ci] >> (egp_shift * i)) & egp_mask;
+                continue;
             }
 
-            for (int cj_ind = cj_ind_start; cj_ind < cj_ind_end; cj_ind++)
-            {
-                unsigned int fep_cj;
-
-                cja = nbl->cj[cj_ind].cj;
+            const gmx_bool bFEP_i = iGrid.atomIsPerturbed(ciRel, i);
 
-                if (numAtomsJCluster == jGrid.geometry().numAtomsICluster)
-                {
-                    cjr    = cja - jGrid.cellOffset();
-                    fep_cj = jGrid.fepBits(cjr);
-                    if (ngid > 1)
-                    {
-                        gid_cj = nbatParams.energrp[cja];
-                    }
-                }
-                else if (2 * numAtomsJCluster == jGrid.geometry().numAtomsICluster)
+            for (int j = 0; j < nbl->na_cj; j++)
+            {
+                /* Is this interaction perturbed and not excluded? */
+                const int ind_j = cja * nbl->na_cj + j;
+                if (atomIndices[ind_j] >= 0 && (bFEP_i || (fep_cj & (1 << j)))
+                    && (!bDiagRemoved || ind_j >= ind_i))
                 {
-                    cjr = cja - jGrid.cellOffset() * 2;
-                    /* Extract half of the ci fep/energrp mask */
-                    fep_cj = (jGrid.fepBits(cjr >> 1) >> ((cjr & 1) * numAtomsJCluster))
-                             & ((1 << numAtomsJCluster) - 1);
-                    if (ngid > 1)
-                    {
-                        gid_cj = nbatParams.energrp[cja >> 1] >> ((cja & 1) * numAtomsJCluster * egp_shift)
-                                 & ((1 << (numAtomsJCluster * egp_shift)) - 1);
-                    }
-                }
-                else
-                {
-                    cjr = cja - (jGrid.cellOffset() >> 1);
-                    /* Combine two ci fep masks/energrp */
-                    fep_cj = jGrid.fepBits(cjr * 2)
-                             + (jGrid.fepBits(cjr * 2 + 1) << jGrid.geometry().numAtomsICluster);
-                    if (ngid > 1)
-                    {
-                        gid_cj = nbatParams.energrp[cja * 2]
-                                 + (nbatParams.energrp[cja * 2 + 1]
-                                    << (jGrid.geometry().numAtomsICluster * egp_shift));
-                    }
-                }
-
-                if (bFEP_i || fep_cj != 0)
-                {
-                    for (int j = 0; j < nbl->na_cj; j++)
-                    {
-                        /* Is this interaction perturbed and not excluded? */
-                        ind_j = cja * nbl->na_cj + j;
-                        aj    = atomIndices[ind_j];
-                        if (aj >= 0 && (bFEP_i || (fep_cj & (1 << j))) && (!bDiagRemoved || ind_j >= ind_i))
-                        {
-                            if (ngid > 1)
-                            {
-                                gid_j = (gid_cj >> (j * egp_shift)) & egp_mask;
-                                gid   = GID(gid_i, gid_j, ngid);
-
-                                if (nlist->nrj > nlist->jindex[nri] && nlist->gid[nri] != gid)
-                                {
-                                    /* Energy group pair changed: new list */
-                                    fep_list_new_nri_copy(nlist);
-                                    nri = nlist->nri;
-                                }
-                                nlist->gid[nri] = gid;
-                            }
-
-                            if (nlist->nrj - nlist->jindex[nri] >= max_nrj_fep)
-                            {
-                                fep_list_new_nri_copy(nlist);
-                                nri = nlist->nri;
-                            }
-
-                            /* Add it to the FEP list */
-                            nlist->jjnr[nlist->nrj] = aj;
-                            nlist->excl_fep[nlist->nrj] =
-                                    (nbl->cj[cj_ind].excl >> (i * nbl->na_cj + j)) & 1;
-                            nlist->nrj++;
-
-                            /* Exclude it from the normal list.
-                             * Note that the charge has been set to zero,
-                             * but we need to avoid 0/0, as perturbed atoms
-                             * can be on top of each other.
-                             */
-                            nbl->cj[cj_ind].excl &= ~(1U << (i * nbl->na_cj + j));
-                        }
-                    }
+                    pairMask |= (1U << (i * nbl->na_cj + j));
+                    numPairs++;
                 }
             }
+        }
 
-            if (nlist->nrj > nlist->jindex[nri])
-            {
-                /* Actually add this new, non-empty, list */
-                nlist->nri++;
-                nlist->jindex[nlist->nri] = nlist->nrj;
-            }
+        if (pairMask != 0)
+        {
+            /* Add the pairs to the FEP list */
+            addFepJEntry(nlist, &haveOpenIEntry, ci, shift,
+                         { cja, pairMask, nbl->cj[cj_ind].excl & pairMask }, numPairs);
+
+            /* Exclude them from the normal list.
+             * Note that the charge has been set to zero,
+             * but we need to avoid 0/0, as perturbed atoms
+             * can be on top of each other.
+             */
+            nbl->cj[cj_ind].excl &= ~pairMask;
         }
     }
 
@@ -1697,7 +1631,11 @@ static inline int a_mod_wj(int a)
     return a & (c_nbnxnGpuClusterSize / c_nbnxnGpuClusterpairSplit - 1);
 }
 
-/* As make_fep_list above, but for super/sub lists. */
+/* As make_fep_list above, but for super/sub lists.
+ *
+ * The j-clusters are stored as halves in the FEP list, which matches
+ * the split of the GPU exclusion masks.
+ */
 static void make_fep_list(gmx::ArrayRef<const int> atomIndices,
                           const nbnxn_atomdata_t*  nbat,
                           NbnxnPairlistGpu*        nbl,
@@ -1709,16 +1647,8 @@ static void make_fep_list(gmx::ArrayRef<const int> atomIndices,
                           real                     rlist_fep2,
                           const Grid&              iGrid,
                           const Grid&              jGrid,
-                          t_nblist*                nlist)
+                          NbnxnPairlistFep*        nlist)
 {
-    int                nri_max;
-    int                c_abs;
-    int                ind_i, ind_j, ai, aj;
-    int                nri;
-    gmx_bool           bFEP_i;
-    real               xi, yi, zi;
-    const nbnxn_cj4_t* cj4;
-
     const int numJClusterGroups = nbl_sci->numJClusterGroups();
     if (numJClusterGroups == 0)
     {
@@ -1726,143 +1656,131 @@ static void make_fep_list(gmx::ArrayRef<const int> atomIndices,
         return;
     }
 
+    constexpr int c_numJHalves = c_nbnxnGpuClusterpairSplit;
+    const int     na_cj_half   = nbl->na_cj / c_numJHalves;
+
+    GMX_ASSERT(nlist->na_ci == nbl->na_ci && nlist->na_cj == na_cj_half,
+               "The FEP list should use the i-cluster size and half the j-cluster size of the "
+               "normal list");
+
     const int sci = nbl_sci->sci;
 
     const int cj4_ind_start = nbl_sci->cj4_ind_start;
     const int cj4_ind_end   = nbl_sci->cj4_ind_end;
+    const int shift         = nbl_sci->shift & NBNXN_CI_SHIFT;
 
-    /* Here we process one super-cell, max #atoms na_sc, versus a list
-     * cj4 entries, each with max c_nbnxnGpuJgroupSize cj's, each
-     * of size na_cj atoms.
-     * On the GPU we don't support energy groups (yet).
-     * So for each of the na_sc i-atoms, we need max one FEP list
-     * for each max_nrj_fep j-atoms.
-     */
-    nri_max = nbl->na_sc * nbl->na_cj * (1 + (numJClusterGroups * c_nbnxnGpuJgroupSize) / max_nrj_fep);
-    if (nlist->nri + nri_max > nlist->maxnri)
-    {
-        nlist->maxnri = over_alloc_large(nlist->nri + nri_max);
-        reallocate_nblist(nlist);
-    }
-
-    /* Loop over the atoms in the i super-cluster */
+    /* Loop over the i-clusters in the i super-cluster */
     for (int c = 0; c < c_gpuNumClusterPerCell; c++)
     {
-        c_abs = sci * c_gpuNumClusterPerCell + c;
+        const int c_abs = sci * c_gpuNumClusterPerCell + c;
+        const int c_rel = c_abs - iGrid.cellOffset() * c_gpuNumClusterPerCell;
 
-        for (int i = 0; i < nbl->na_ci; i++)
+        const gmx_bool bFEP_ci = iGrid.clusterIsPerturbed(c_rel);
+
+        bool haveOpenIEntry = false;
+        for (int cj4_ind = cj4_ind_start; cj4_ind < cj4_ind_end; cj4_ind++)
         {
-            ind_i = c_abs * nbl->na_ci + i;
-            ai    = atomIndices[ind_i];
-            if (ai >= 0)
-            {
-                nri                    = nlist->nri;
-                nlist->jindex[nri + 1] = nlist->jindex[nri];
-                nlist->iinr[nri]       = ai;
-                /* With GPUs, energy groups are not supported */
-                nlist->gid[nri]   = 0;
-                nlist->shift[nri] = nbl_sci->shift & NBNXN_CI_SHIFT;
+            const nbnxn_cj4_t* cj4 = &nbl->cj4[cj4_ind];
 
-                bFEP_i = iGrid.atomIsPerturbed(c_abs - iGrid.cellOffset() * c_gpuNumClusterPerCell, i);
+            for (int gcj = 0; gcj < c_nbnxnGpuJgroupSize; gcj++)
+            {
+                if ((cj4->imei[0].imask & (1U << (gcj * c_gpuNumClusterPerCell + c))) == 0)
+                {
+                    /* Skip this ci for this cj */
+                    continue;
+                }
 
-                xi = nbat->x()[ind_i * nbat->xstride + XX] + shx;
-                yi = nbat->x()[ind_i * nbat->xstride + YY] + shy;
-                zi = nbat->x()[ind_i * nbat->xstride + ZZ] + shz;
+                const int cjr = cj4->cj[gcj] - jGrid.cellOffset() * c_gpuNumClusterPerCell;
 
-                const int nrjMax = nlist->nrj + numJClusterGroups * c_nbnxnGpuJgroupSize * nbl->na_cj;
-                if (nrjMax > nlist->maxnrj)
+                if (!bFEP_ci && !jGrid.clusterIsPerturbed(cjr))
                 {
-                    nlist->maxnrj = over_alloc_small(nrjMax);
-                    srenew(nlist->jjnr, nlist->maxnrj);
-                    srenew(nlist->excl_fep, nlist->maxnrj);
+                    continue;
                 }
 
-                for (int cj4_ind = cj4_ind_start; cj4_ind < cj4_ind_end; cj4_ind++)
+                const unsigned int excl_bit = (1U << (gcj * c_gpuNumClusterPerCell + c));
+
+                for (int jHalf = 0; jHalf < c_numJHalves; jHalf++)
                 {
-                    cj4 = &nbl->cj4[cj4_ind];
+                    nbnxn_excl_t* excl     = nullptr;
+                    unsigned int  pairMask = 0;
+                    unsigned int  exclMask = 0;
+                    int           numPairs = 0;
 
-                    for (int gcj = 0; gcj < c_nbnxnGpuJgroupSize; gcj++)
+                    for (int i = 0; i < nbl->na_ci; i++)
                     {
-                        if ((cj4->imei[0].imask & (1U << (gcj * c_gpuNumClusterPerCell + c))) == 0)
+                        const int ind_i = c_abs * nbl->na_ci + i;
+                        if (atomIndices[ind_i] < 0)
                         {
-                            /* Skip this ci for this cj */
                             continue;
                         }
 
-                        const int cjr = cj4->cj[gcj] - jGrid.cellOffset() * c_gpuNumClusterPerCell;
+                        const gmx_bool bFEP_i = iGrid.atomIsPerturbed(c_rel, i);
+
+                        const real xi = nbat->x()[ind_i * nbat->xstride + XX] + shx;
+                        const real yi = nbat->x()[ind_i * nbat->xstride + YY] + shy;
+                        const real zi = nbat->x()[ind_i * nbat->xstride + ZZ] + shz;
 
-                        if (bFEP_i || jGrid.clusterIsPerturbed(cjr))
+                        for (int j = jHalf * na_cj_half; j < (jHalf + 1) * na_cj_half; j++)
                         {
-                            for (int j = 0; j < nbl->na_cj; j++)
+                            /* Is this interaction perturbed and not excluded? */
+                            const int ind_j = cj4->cj[gcj] * nbl->na_cj + j;
+                            if (atomIndices[ind_j] >= 0 && (bFEP_i || jGrid.atomIsPerturbed(cjr, j))
+                                && (!bDiagRemoved || ind_j >= ind_i))
                             {
-                                /* Is this interaction perturbed and not excluded? */
-                                ind_j = (jGrid.cellOffset() * c_gpuNumClusterPerCell + cjr) * nbl->na_cj + j;
-                                aj = atomIndices[ind_j];
-                                if (aj >= 0 && (bFEP_i || jGrid.atomIsPerturbed(cjr, j))
-                                    && (!bDiagRemoved || ind_j >= ind_i))
+                                if (excl == nullptr)
                                 {
-                                    int          excl_pair;
-                                    unsigned int excl_bit;
-                                    real         dx, dy, dz;
-
-                                    const int jHalf =
-                                            j / (c_nbnxnGpuClusterSize / c_nbnxnGpuClusterpairSplit);
-                                    nbnxn_excl_t& excl = get_exclusion_mask(nbl, cj4_ind, jHalf);
-
-                                    excl_pair = a_mod_wj(j) * nbl->na_ci + i;
-                                    excl_bit  = (1U << (gcj * c_gpuNumClusterPerCell + c));
-
-                                    dx = nbat->x()[ind_j * nbat->xstride + XX] - xi;
-                                    dy = nbat->x()[ind_j * nbat->xstride + YY] - yi;
-                                    dz = nbat->x()[ind_j * nbat->xstride + ZZ] - zi;
-
-                                    /* The unpruned GPU list has more than 2/3
-                                     * of the atom pairs beyond rlist. Using
-                                     * this list will cause a lot of overhead
-                                     * in the CPU FEP kernels, especially
-                                     * relative to the fast GPU kernels.
-                                     * So we prune the FEP list here.
-                                     */
-                                    if (dx * dx + dy * dy + dz * dz < rlist_fep2)
-                                    {
-                                        if (nlist->nrj - nlist->jindex[nri] >= max_nrj_fep)
-                                        {
-                                            fep_list_new_nri_copy(nlist);
-                                            nri = nlist->nri;
-                                        }
+                                    excl = &get_exclusion_mask(nbl, cj4_ind, jHalf);
+                                }
+                                const int excl_pair = a_mod_wj(j) * nbl->na_ci + i;
+
+                                const real dx = nbat->x()[ind_j * nbat->xstride + XX] - xi;
+                                const real dy = nbat->x()[ind_j * nbat->xstride + YY] - yi;
+                                const real dz = nbat->x()[ind_j * nbat->xstride + ZZ] - zi;
+
+                                /* The unpruned GPU list has more than 2/3
+                                 * of the atom pairs beyond rlist. Using
+                                 * this list will cause a lot of overhead
+                                 * in the CPU FEP kernels, especially
+                                 * relative to the fast GPU kernels.
+                                 * So we prune the FEP list here.
+                                 */
+                                if (dx * dx + dy * dy + dz * dz < rlist_fep2)
+                                {
+                                    const unsigned int pairBit = (1U << (i * na_cj_half + a_mod_wj(j)));
 
-                                        /* Add it to the FEP list */
-                                        nlist->jjnr[nlist->nrj] = aj;
-                                        nlist->excl_fep[nlist->nrj] =
-                                                (excl.pair[excl_pair] & excl_bit) ? 1 : 0;
-                                        nlist->nrj++;
+                                    pairMask |= pairBit;
+                                    if (excl->pair[excl_pair] & excl_bit)
+                                    {
+                                        exclMask |= pairBit;
                                     }
-
-                                    /* Exclude it from the normal list.
-                                     * Note that the charge and LJ parameters have
-                                     * been set to zero, but we need to avoid 0/0,
-                                     * as perturbed atoms can be on top of each other.
-                                     */
-                                    excl.pair[excl_pair] &= ~excl_bit;
+                                    numPairs++;
                                 }
-                            }
 
-                            /* Note that we could mask out this pair in imask
-                             * if all i- and/or all j-particles are perturbed.
-                             * But since the perturbed pairs on the CPU will
-                             * take an order of magnitude more time, the GPU
-                             * will finish before the CPU and there is no gain.
-                             */
+                                /* Exclude it from the normal list.
+                                 * Note that the charge and LJ parameters have
+                                 * been set to zero, but we need to avoid 0/0,
+                                 * as perturbed atoms can be on top of each other.
+                                 */
+                                excl->pair[excl_pair] &= ~excl_bit;
+                            }
                         }
                     }
-                }
 
-                if (nlist->nrj > nlist->jindex[nri])
-                {
-                    /* Actually add this new, non-empty, list */
-                    nlist->nri++;
-                    nlist->jindex[nlist->nri] = nlist->nrj;
+                    if (pairMask != 0)
+                    {
+                        /* Add the pairs to the FEP list, using half j-cluster indices */
+                        addFepJEntry(nlist, &haveOpenIEntry, c_abs, shift,
+                                     { cj4->cj[gcj] * c_numJHalves + jHalf, pairMask, exclMask },
+                                     numPairs);
+                    }
                 }
+
+                /* Note that we could mask out this pair in imask
+                 * if all i- and/or all j-particles are perturbed.
+                 * But since the perturbed pairs on the CPU will
+                 * take an order of magnitude more time, the GPU
+                 * will finish before the CPU and there is no gain.
+                 */
             }
         }
     }
@@ -2230,16 +2148,12 @@ static void clear_pairlist(NbnxnPairlistGpu* nbl)
     nbl->nci_tot = 0;
 }
 
-/* Clears an atom-atom-style pair list */
-static void clear_pairlist_fep(t_nblist* nl)
+/* Clears a free-energy pair list */
+static void clear_pairlist_fep(NbnxnPairlistFep* nl)
 {
-    nl->nri = 0;
-    nl->nrj = 0;
-    if (nl->jindex == nullptr)
-    {
-        snew(nl->jindex, 1);
-    }
-    nl->jindex[0] = 0;
+    nl->ci.clear();
+    nl->cj.clear();
+    nl->numPairs = 0;
 }
 
 /* Sets a simple list i-cell bounding box, including PBC shift */
@@ -2706,8 +2620,9 @@ static void combine_nblists(gmx::ArrayRef<const NbnxnPairlistGpu> nbls, NbnxnPai
     }
 }
 
-static void balance_fep_lists(gmx::ArrayRef<std::unique_ptr<t_nblist>> fepLists,
-                              gmx::ArrayRef<PairsearchWork>            work)
+static void balance_fep_lists(gmx::ArrayRef<std::unique_ptr<NbnxnPairlistFep>> fepLists,
+                              gmx::ArrayRef<PairsearchWork>                    work,
+                              const PairlistType                               pairlistType)
 {
     const int numLists = fepLists.ssize();
 
@@ -2717,16 +2632,18 @@ static void balance_fep_lists(gmx::ArrayRef<std::unique_ptr<t_nblist>> fepLists,
         return;
     }
 
-    /* Count the total i-lists and pairs */
-    int nri_tot = 0;
-    int nrj_tot = 0;
+    /* Count the total i-entries and pairs */
+    int nci_tot   = 0;
+    int ncj_tot   = 0;
+    int npair_tot = 0;
     for (const auto& list : fepLists)
     {
-        nri_tot += list->nri;
-        nrj_tot += list->nrj;
+        nci_tot += list->ci.size();
+        ncj_tot += list->cj.size();
+        npair_tot += list->numPairs;
     }
 
-    const int nrj_target = (nrj_tot + numLists - 1) / numLists;
+    const int npair_target = (npair_tot + numLists - 1) / numLists;
 
     GMX_ASSERT(gmx_omp_nthreads_get(emntNonbonded) == numLists,
                "We should have as many work objects as FEP lists");
@@ -2736,22 +2653,17 @@ static void balance_fep_lists(gmx::ArrayRef<std::unique_ptr<t_nblist>> fepLists,
     {
         try
         {
-            t_nblist* nbl = work[th].nbl_fep.get();
+            if (!work[th].nbl_fep)
+            {
+                work[th].nbl_fep = std::make_unique<NbnxnPairlistFep>(pairlistType);
+            }
+            NbnxnPairlistFep* nbl = work[th].nbl_fep.get();
 
             /* Note that here we allocate for the total size, instead of
              * a per-thread esimate (which is hard to obtain).
              */
-            if (nri_tot > nbl->maxnri)
-            {
-                nbl->maxnri = over_alloc_large(nri_tot);
-                reallocate_nblist(nbl);
-            }
-            if (nri_tot > nbl->maxnri || nrj_tot > nbl->maxnrj)
-            {
-                nbl->maxnrj = over_alloc_small(nrj_tot);
-                srenew(nbl->jjnr, nbl->maxnrj);
-                srenew(nbl->excl_fep, nbl->maxnrj);
-            }
+            nbl->ci.reserve(nci_tot);
+            nbl->cj.reserve(ncj_tot);
 
             clear_pairlist_fep(nbl);
         }
@@ -2759,41 +2671,30 @@ static void balance_fep_lists(gmx::ArrayRef<std::unique_ptr<t_nblist>> fepLists,
     }
 
     /* Loop over the source lists and assign and copy i-entries */
-    int       th_dest = 0;
-    t_nblist* nbld    = work[th_dest].nbl_fep.get();
+    int               th_dest = 0;
+    NbnxnPairlistFep* nbld    = work[th_dest].nbl_fep.get();
     for (int th = 0; th < numLists; th++)
     {
-        const t_nblist* nbls = fepLists[th].get();
+        const NbnxnPairlistFep* nbls = fepLists[th].get();
 
-        for (int i = 0; i < nbls->nri; i++)
+        for (const nbnxn_fep_ci_t& ciEntry : nbls->ci)
         {
-            int nrj;
-
-            /* The number of pairs in this i-entry */
-            nrj = nbls->jindex[i + 1] - nbls->jindex[i];
-
             /* Decide if list th_dest is too large and we should procede
              * to the next destination list.
              */
-            if (th_dest + 1 < numLists && nbld->nrj > 0
-                && nbld->nrj + nrj - nrj_target > nrj_target - nbld->nrj)
+            if (th_dest + 1 < numLists && nbld->numPairs > 0
+                && nbld->numPairs + ciEntry.numPairs - npair_target > npair_target - nbld->numPairs)
             {
                 th_dest++;
                 nbld = work[th_dest].nbl_fep.get();
             }
 
-            nbld->iinr[nbld->nri]  = nbls->iinr[i];
-            nbld->gid[nbld->nri]   = nbls->gid[i];
-            nbld->shift[nbld->nri] = nbls->shift[i];
-
-            for (int j = nbls->jindex[i]; j < nbls->jindex[i + 1]; j++)
-            {
-                nbld->jjnr[nbld->nrj]     = nbls->jjnr[j];
-                nbld->excl_fep[nbld->nrj] = nbls->excl_fep[j];
-                nbld->nrj++;
-            }
-            nbld->nri++;
-            nbld->jindex[nbld->nri] = nbld->nrj;
+            const int cjIndex = nbld->cj.size();
+            nbld->ci.push_back({ ciEntry.ci, ciEntry.shift, cjIndex,
+                                 cjIndex + ciEntry.cj_ind_end - ciEntry.cj_ind_start, ciEntry.numPairs });
+            nbld->cj.insert(nbld->cj.end(), nbls->cj.begin() + ciEntry.cj_ind_start,
+                            nbls->cj.begin() + ciEntry.cj_ind_end);
+            nbld->numPairs += ciEntry.numPairs;
         }
     }
 
@@ -2804,13 +2705,14 @@ static void balance_fep_lists(gmx::ArrayRef<std::unique_ptr<t_nblist>> fepLists,
 
         if (debug)
         {
-            fprintf(debug, "nbl_fep[%d] nri %4d nrj %4d\n", th, fepLists[th]->nri, fepLists[th]->nrj);
+            fprintf(debug, "nbl_fep[%d] nci %4zu ncj %4zu npair %4d\n", th, fepLists[th]->ci.size(),
+                    fepLists[th]->cj.size(), fepLists[th]->numPairs);
         }
     }
 }
 
 /* Returns the next ci to be processes by our thread */
-static gmx_bool next_ci(const Grid& grid, int nth, int ci_block, int* ci_x, int* ci_y, int* ci_b, int* ci)
+static gmx_bool next_ci(const Grid& grid, int nth, int ci_block, int* ci_xy, int* ci_b, int* ci)
 {
     (*ci_b)++;
     (*ci)++;
@@ -2827,14 +2729,9 @@ static gmx_bool next_ci(const Grid& grid, int nth, int ci_block, int* ci_x, int*
         return FALSE;
     }
 
-    while (*ci >= grid.firstCellInColumn(*ci_x * grid.dimensions().numCells[YY] + *ci_y + 1))
+    while (*ci >= grid.firstCellInColumn(*ci_xy + 1))
     {
-        *ci_y += 1;
-        if (*ci_y == grid.dimensions().numCells[YY])
-        {
-            *ci_x += 1;
-            *ci_y = 0;
-        }
+        *ci_xy += 1;
     }
 
     return TRUE;
@@ -3076,7 +2973,73 @@ static void setBufferFlags(const NbnxnPairlistGpu gmx_unused& nbl,
     GMX_ASSERT(false, "This function should never be called");
 }
 
-/* Generates the part of pair-list nbl assigned to our thread */
+/* Copies the stored i-entries of i-cluster ci, which are searched for
+ * starting at *storedIndex, to the end of nbl
+ */
+static void copyStoredIEntries(const Nbnxm::IncrementalPairlist::StoredList& storedList,
+                               const int                                     ci,
+                               int*                                          storedIndex,
+                               const int                                     gridj_flag_shift,
+                               gmx_bitmask_t*                                gridj_flag,
+                               const int                                     th,
+                               NbnxnPairlistCpu*                             nbl)
+{
+    /* The stored entries are ordered on i-cluster */
+    while (*storedIndex < gmx::ssize(storedList.ci) && storedList.ci[*storedIndex].ci < ci)
+    {
+        (*storedIndex)++;
+    }
+
+    for (; *storedIndex < gmx::ssize(storedList.ci) && storedList.ci[*storedIndex].ci == ci;
+         (*storedIndex)++)
+    {
+        const nbnxn_ci_t& storedEntry = storedList.ci[*storedIndex];
+
+        nbnxn_ci_t ciEntry   = storedEntry;
+        ciEntry.cj_ind_start = nbl->cj.size();
+        nbl->cj.insert(nbl->cj.end(), storedList.cj.begin() + storedEntry.cj_ind_start,
+                       storedList.cj.begin() + storedEntry.cj_ind_end);
+        ciEntry.cj_ind_end = nbl->cj.size();
+        nbl->ci.push_back(ciEntry);
+
+        const int jlen = ciEntry.cj_ind_end - ciEntry.cj_ind_start;
+        nbl->ncjInUse += jlen;
+        /* As in closeIEntry() */
+        if (!(ciEntry.shift & NBNXN_CI_DO_COUL(0)))
+        {
+            nbl->work->ncj_noq += jlen;
+        }
+        else if ((ciEntry.shift & NBNXN_CI_HALF_LJ(0)) || !(ciEntry.shift & NBNXN_CI_DO_LJ(0)))
+        {
+            nbl->work->ncj_hlj += jlen;
+        }
+
+        if (gridj_flag != nullptr)
+        {
+            for (int cjIndex = ciEntry.cj_ind_start; cjIndex < ciEntry.cj_ind_end; cjIndex++)
+            {
+                bitmask_init_bit(&gridj_flag[nbl->cj[cjIndex].cj >> gridj_flag_shift], th);
+            }
+        }
+    }
+}
+
+static void copyStoredIEntries(const Nbnxm::IncrementalPairlist::StoredList gmx_unused& storedList,
+                               int gmx_unused            ci,
+                               int gmx_unused*           storedIndex,
+                               int gmx_unused            gridj_flag_shift,
+                               gmx_bitmask_t gmx_unused* gridj_flag,
+                               int gmx_unused            th,
+                               NbnxnPairlistGpu gmx_unused* nbl)
+{
+    GMX_ASSERT(false, "This function should never be called");
+}
+
+/* Generates the part of pair-list nbl assigned to our thread
+ *
+ * With incrementalPairlist != nullptr, the i-entries of the i-clusters
+ * that can reuse their stored entries are copied instead of searched.
+ */
 template<typename T>
 static void nbnxn_make_pairlist_part(const Nbnxm::GridSet&   gridSet,
                                      const Grid&             iGrid,
@@ -3094,7 +3057,8 @@ static void nbnxn_make_pairlist_part(const Nbnxm::GridSet&   gridSet,
                                      int                     th,
                                      int                     nth,
                                      T*                      nbl,
-                                     t_nblist*               nbl_fep)
+                                     NbnxnPairlistFep*       nbl_fep,
+                                     const Nbnxm::IncrementalPairlist* incrementalPairlist)
 {
     int            na_cj_2log;
     matrix         box;
@@ -3171,6 +3135,11 @@ static void nbnxn_make_pairlist_part(const Nbnxm::GridSet&   gridSet,
     }
 
     const bool isIntraGridList = (&iGrid == &jGrid);
+    /* With a natural, x-major, column order we can skip half of the columns
+     * of an intra-grid list based on their location, otherwise we only use
+     * the cell index check cj >= ci.
+     */
+    const bool skipColumnsBelowI = (isIntraGridList && iGrid.haveNaturalColumnOrder());
 
     /* Set the shift range */
     for (int d = 0; d < DIM; d++)
@@ -3234,10 +3203,28 @@ static void nbnxn_make_pairlist_part(const Nbnxm::GridSet&   gridSet,
      */
     ci_b = -1;
     ci   = th * ci_block - 1;
-    ci_x = 0;
-    ci_y = 0;
-    while (next_ci(iGrid, nth, ci_block, &ci_x, &ci_y, &ci_b, &ci))
+    ci_xy = 0;
+    int storedIndex = 0;
+    while (next_ci(iGrid, nth, ci_block, &ci_xy, &ci_b, &ci))
     {
+        ci_x = iGrid.columnCellX(ci_xy);
+        ci_y = iGrid.columnCellY(ci_xy);
+
+        if (incrementalPairlist != nullptr && incrementalPairlist->canReuseCluster(ci))
+        {
+            ncj_old_i = getNumSimpleJClustersInList(*nbl);
+
+            copyStoredIEntries(incrementalPairlist->storedList(th), cell0_i + ci, &storedIndex,
+                               gridj_flag_shift, gridj_flag, th, nbl);
+
+            if (bFBufferFlag && getNumSimpleJClustersInList(*nbl) > ncj_old_i)
+            {
+                bitmask_init_bit(&(work->buffer_flags.flag[(cell0_i + ci) >> gridi_flag_shift]), th);
+            }
+
+            continue;
+        }
+
         if (bSimple && flags_i[ci] == 0)
         {
             continue;
@@ -3266,8 +3253,6 @@ static void nbnxn_make_pairlist_part(const Nbnxm::GridSet&   gridSet,
             }
         }
 
-        ci_xy = ci_x * iGridDims.numCells[YY] + ci_y;
-
         /* Loop over shift vectors in three dimensions */
         for (int tz = -shp[ZZ]; tz <= shp[ZZ]; tz++)
         {
@@ -3369,7 +3354,8 @@ static void nbnxn_make_pairlist_part(const Nbnxm::GridSet&   gridSet,
 
                     addNewIEntry(nbl, cell0_i + ci, shift, flags_i[ci]);
 
-                    if ((!c_pbcShiftBackward || excludeSubDiagonal) && cxf < ci_x)
+                    if ((!c_pbcShiftBackward || excludeSubDiagonal) && skipColumnsBelowI
+                        && cxf < ci_x)
                     {
                         /* Leave the pairs with i > j.
                          * x is the major index, so skip half of it.
@@ -3397,7 +3383,7 @@ static void nbnxn_make_pairlist_part(const Nbnxm::GridSet&   gridSet,
                                                 + (cx_real + 1) * jGridDims.cellSize[XX] - bx0);
                         }
 
-                        if (isIntraGridList && cx == 0 && (!c_pbcShiftBackward || shift == CENTRAL)
+                        if (skipColumnsBelowI && cx == 0 && (!c_pbcShiftBackward || shift == CENTRAL)
                             && cyf < ci_y)
                         {
                             /* Leave the pairs with i > j.
@@ -3412,10 +3398,9 @@ static void nbnxn_make_pairlist_part(const Nbnxm::GridSet&   gridSet,
 
                         for (int cy = cyf_x; cy <= cyl; cy++)
                         {
-                            const int columnStart =
-                                    jGrid.firstCellInColumn(cx * jGridDims.numCells[YY] + cy);
-                            const int columnEnd =
-                                    jGrid.firstCellInColumn(cx * jGridDims.numCells[YY] + cy + 1);
+                            const int columnIndex = jGrid.columnIndex(cx, cy);
+                            const int columnStart = jGrid.firstCellInColumn(columnIndex);
+                            const int columnEnd   = columnStart + jGrid.numCellsInColumn(columnIndex);
 
                             const real cy_real = cy;
                             d2zxy              = d2zx;
@@ -3544,6 +3529,11 @@ static void nbnxn_make_pairlist_part(const Nbnxm::GridSet&   gridSet,
                         }
                     }
 
+                    if (!jGrid.haveNaturalColumnOrder())
+                    {
+                        sortJClustersOfOpenIEntry(nbl);
+                    }
+
                     /* Set the exclusions for this ci list */
                     setExclusionsForIEntry(gridSet, nbl, excludeSubDiagonal, na_cj_2log,
                                            *getOpenIEntry(nbl), exclusions);
@@ -3578,7 +3568,7 @@ static void nbnxn_make_pairlist_part(const Nbnxm::GridSet&   gridSet,
 
         if (haveFep)
         {
-            fprintf(debug, "nbl FEP list pairs: %d\n", nbl_fep->nrj);
+            fprintf(debug, "nbl FEP list pairs: %d\n", nbl_fep->numPairs);
         }
     }
 }
@@ -3929,7 +3919,7 @@ void PairlistSet::constructPairlists(const Nbnxm::GridSet&         gridSet,
                                      t_nrnb*                       nrnb,
                                      SearchCycleCounting*          searchCycleCounting)
 {
-    const real rlist = params_.rlistOuter;
+    real rlist = params_.rlistOuter;
 
     int      nsubpair_target;
     float    nsubpair_tot_est;
@@ -3980,6 +3970,23 @@ void PairlistSet::constructPairlists(const Nbnxm::GridSet&         gridSet,
         }
     }
 
+    /* With incremental updates, we either reuse stored entries or do
+     * a full search with an extended radius, which result we store.
+     */
+    const bool useIncrementalUpdate = (incrementalPairlist_ && params_.useDynamicPruning
+                                       && gridSet.grids().size() == 1);
+    bool       reuseStoredEntries   = false;
+    if (useIncrementalUpdate)
+    {
+        reuseStoredEntries = incrementalPairlist_->prepareSearch(gridSet, *nbat, rlist, numLists);
+        if (!reuseStoredEntries)
+        {
+            rlist = incrementalPairlist_->searchRadius(rlist);
+        }
+    }
+    const Nbnxm::IncrementalPairlist* incrementalPairlist =
+            (reuseStoredEntries ? incrementalPairlist_.get() : nullptr);
+
     const gmx_domdec_zones_t& ddZones = *gridSet.domainSetup().zones;
 
     const auto iZoneRange = getIZoneRange(gridSet.domainSetup(), locality_);
@@ -4032,7 +4039,7 @@ void PairlistSet::constructPairlists(const Nbnxm::GridSet&         gridSet,
 
                     work.cycleCounter.start();
 
-                    t_nblist* fepListPtr = (fepLists_.empty() ? nullptr : fepLists_[th].get());
+                    NbnxnPairlistFep* fepListPtr = (fepLists_.empty() ? nullptr : fepLists_[th].get());
 
                     /* Divide the i cells equally over the pairlists */
                     if (isCpuType_)
@@ -4040,14 +4047,20 @@ void PairlistSet::constructPairlists(const Nbnxm::GridSet&         gridSet,
                         nbnxn_make_pairlist_part(gridSet, iGrid, jGrid, &work, nbat, *excl, rlist,
                                                  params_.pairlistType, ci_block, nbat->bUseBufferFlags,
                                                  nsubpair_target, progBal, nsubpair_tot_est, th,
-                                                 numLists, &cpuLists_[th], fepListPtr);
+                                                 numLists, &cpuLists_[th], fepListPtr,
+                                                 incrementalPairlist);
+
+                        if (useIncrementalUpdate && !reuseStoredEntries)
+                        {
+                            incrementalPairlist_->storeList(th, cpuLists_[th]);
+                        }
                     }
                     else
                     {
                         nbnxn_make_pairlist_part(gridSet, iGrid, jGrid, &work, nbat, *excl, rlist,
                                                  params_.pairlistType, ci_block, nbat->bUseBufferFlags,
                                                  nsubpair_target, progBal, nsubpair_tot_est, th,
-                                                 numLists, &gpuLists_[th], fepListPtr);
+                                                 numLists, &gpuLists_[th], fepListPtr, nullptr);
                     }
 
                     work.cycleCounter.stop();
@@ -4133,6 +4146,11 @@ void PairlistSet::constructPairlists(const Nbnxm::GridSet&         gridSet,
         }
     }
 
+    if (useIncrementalUpdate && !reuseStoredEntries)
+    {
+        incrementalPairlist_->setReference(gridSet, *nbat, params_.rlistOuter);
+    }
+
     if (nbat->bUseBufferFlags)
     {
         reduce_buffer_flags(searchWork, numLists, &nbat->buffer_flags);
@@ -4141,7 +4159,7 @@ void PairlistSet::constructPairlists(const Nbnxm::GridSet&         gridSet,
     if (gridSet.haveFep())
     {
         /* Balance the free-energy lists over all the threads */
-        balance_fep_lists(fepLists_, searchWork);
+        balance_fep_lists(fepLists_, searchWork, params_.pairlistType);
     }
 
     if (isCpuType_)
@@ -4206,6 +4224,17 @@ void PairlistSets::construct(const InteractionLocality iLocality,
                              const int64_t             step,
                              t_nrnb*                   nrnb)
 {
+    /* The pruning setup can only change with a new outer list */
+    if (iLocality == InteractionLocality::Local && dynamicPruningTuner_)
+    {
+        const int nstlistPrune = dynamicPruningTuner_->endListLifetime();
+        if (nstlistPrune != params_.nstlistPrune)
+        {
+            params_.nstlistPrune = nstlistPrune;
+            params_.rlistInner = dynamicPruningTuner_->rlistInner(nstlistPrune, params_.rlistOuter);
+        }
+    }
+
     pairlistSet(iLocality).constructPairlists(pairSearch->gridSet(), pairSearch->work(), nbat, excl,
                                               minimumIlistCountForGpuBalancing_, nrnb,
                                               &pairSearch->cycleCounting_);
@@ -4220,6 +4249,11 @@ void PairlistSets::construct(const InteractionLocality iLocality,
                            "Outer list should be created at the same step as the inner list");
     }
 
+    if (GMX_NBNXM_KERNEL_COUNTERS && kernelCounters_)
+    {
+        kernelCounters_->setListsChanged(iLocality);
+    }
+
     /* Special performance logging stuff (env.var. GMX_NBNXN_CYCLE) */
     if (iLocality == InteractionLocality::Local)
     {
@@ -4229,10 +4263,33 @@ void PairlistSets::construct(const InteractionLocality iLocality,
         && (!pairSearch->gridSet().domainSetup().haveMultipleDomains || iLocality == InteractionLocality::NonLocal)
         && pairSearch->cycleCounting_.searchCount_ % 100 == 0)
     {
-        pairSearch->cycleCounting_.printCycles(stderr, pairSearch->work());
+        pairSearch->cycleCounting_.printCycles(stderr, pairSearch->work(),
+                                               pairSearch->gridSet().numUpdatesKeepingAtomOrder());
+    }
+}
+
+void PairlistSets::changePairlistRadii(const real rlistOuter, const real rlistInner)
+{
+    params_.rlistOuter = rlistOuter;
+    if (dynamicPruningTuner_)
+    {
+        /* The inner radius passed might be for a different pruning interval.
+         * The measured costs are no longer valid with different radii.
+         */
+        params_.rlistInner = dynamicPruningTuner_->rlistInner(params_.nstlistPrune, rlistOuter);
+        dynamicPruningTuner_->reset();
+    }
+    else
+    {
+        params_.rlistInner = rlistInner;
     }
 }
 
+void PairlistSets::disableDynamicPruningTuning()
+{
+    dynamicPruningTuner_.reset();
+}
+
 void nonbonded_verlet_t::constructPairlist(const InteractionLocality iLocality,
                                            const t_blocka*           excl,
                                            int64_t                   step,
@@ -230,7 +230,45 @@ struct NbnxnPairlistGpu
     gmx_cache_protect_t cp1;
 };
 
-//! Initializes a free-energy pair-list
-void nbnxn_init_pairlist_fep(t_nblist* nl);
+/* Free-energy pair-list i-unit */
+struct nbnxn_fep_ci_t
+{
+    int ci;           /* i-cluster                                        */
+    int shift;        /* Shift vector index, without flags                */
+    int cj_ind_start; /* Start index into cj                              */
+    int cj_ind_end;   /* End index into cj                                */
+    int numPairs;     /* The number of perturbed atom pairs in this entry */
+};
+
+/* Free-energy pair-list j-entry.
+ * The bits in pairMask and excl are indexed i-major, j-minor, as in nbnxn_cj_t.
+ * pairMask tells which atom pairs of the cluster pair are perturbed.
+ * excl has the bits set for the pairs in pairMask which are not excluded.
+ */
+struct nbnxn_fep_cj_t
+{
+    int          cj;       /* The j-cluster                    */
+    unsigned int pairMask; /* The perturbed atom-pair bits     */
+    unsigned int excl;     /* The exclusion (interaction) bits */
+};
+
+/* Cluster-pair list of the perturbed atom pairs
+ *
+ * The perturbed atom pairs are taken out of the normal cluster-pair list
+ * and stored here in cluster-pair format with atom-pair masks. The i- and
+ * j-atom indices are obtained through the grid atom indices:
+ * atomIndices[ci*na_ci + i] and atomIndices[cj*na_cj + j].
+ */
+struct NbnxnPairlistFep
+{
+    //! Constructor, sets the cluster sizes for pairlist type \p pairlistType
+    NbnxnPairlistFep(PairlistType pairlistType);
+
+    int                        na_ci;    /* The number of atoms per i-cluster        */
+    int                        na_cj;    /* The number of atoms per j-cluster        */
+    FastVector<nbnxn_fep_ci_t> ci;       /* The i-cluster list                       */
+    FastVector<nbnxn_fep_cj_t> cj;       /* The j-cluster list                       */
+    int                        numPairs; /* The total number of perturbed atom pairs */
+};
 
 #endif
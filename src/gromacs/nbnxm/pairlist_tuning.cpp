@@ -50,7 +50,9 @@
 #include <cstdlib>
 
 #include <algorithm>
+#include <memory>
 #include <string>
+#include <vector>
 
 #include "gromacs/domdec/domdec.h"
 #include "gromacs/hardware/cpuinfo.h"
@@ -69,6 +71,7 @@
 #include "gromacs/utility/strconvert.h"
 #include "gromacs/utility/stringutil.h"
 
+#include "dynamicpruningtuner.h"
 #include "nbnxm_geometry.h"
 #include "pairlistsets.h"
 
@@ -598,3 +601,67 @@ void setupDynamicPairlistPruning(const gmx::MDLogger&       mdlog,
 
     GMX_LOG(mdlog.info).asParagraph().appendText(mesg);
 }
+
+std::unique_ptr<Nbnxm::DynamicPruningTuner>
+makeDynamicPruningTuner(const gmx::MDLogger&  mdlog,
+                        const t_inputrec*     ir,
+                        const gmx_mtop_t*     mtop,
+                        const matrix          box,
+                        const PairlistParams& listParams)
+{
+    /* On the GPU the pruning runs asynchronously, so we can not easily measure its cost */
+    if (!listParams.useDynamicPruning || listParams.pairlistType == PairlistType::HierarchicalNxN
+        || getenv("GMX_NSTLIST_DYNAMICPRUNING") != nullptr
+        || getenv("GMX_NBNXN_TUNE_DYNAMICPRUNING") == nullptr)
+    {
+        return nullptr;
+    }
+
+    const VerletbufListSetup ls = { IClusterSizePerListType[listParams.pairlistType],
+                                    JClusterSizePerListType[listParams.pairlistType] };
+
+    /* With dynamic pruning on the CPU we prune after updating,
+     * so the list lifetime is nstlistPrune - 1. We start at an interval
+     * of 2, since pruning every step is (nearly) always inefficient.
+     * As nstlistPrune=nstlist-1 is not useful, we stop before that.
+     * Index 0 and 1 are not used.
+     */
+    std::vector<real> rlistInner(2, listParams.rlistOuter);
+    for (int nstlistPrune = 2; nstlistPrune < listParams.lifetime; nstlistPrune++)
+    {
+        const real rlist =
+                calcVerletBufferSize(*mtop, det(box), *ir, nstlistPrune, nstlistPrune - 1, -1, ls);
+        if (rlist >= listParams.rlistOuter)
+        {
+            break;
+        }
+        rlistInner.push_back(rlist);
+    }
+
+    /* Intervals with a buffer of zero have the same inner list,
+     * so pruning less often is always more efficient.
+     */
+    int nstlistPruneMin = 2;
+    while (nstlistPruneMin + 1 < gmx::ssize(rlistInner)
+           && rlistInner[nstlistPruneMin + 1] == rlistInner[nstlistPruneMin])
+    {
+        nstlistPruneMin++;
+    }
+
+    const int nstlistPruneMax = gmx::ssize(rlistInner) - 1;
+    if (nstlistPruneMax <= nstlistPruneMin || listParams.nstlistPrune < nstlistPruneMin
+        || listParams.nstlistPrune > nstlistPruneMax)
+    {
+        return nullptr;
+    }
+
+    GMX_LOG(mdlog.info)
+            .asParagraph()
+            .appendTextFormatted(
+                    "The dynamic pruning interval will be tuned at runtime between %d and %d "
+                    "steps",
+                    nstlistPruneMin, nstlistPruneMax);
+
+    return std::make_unique<Nbnxm::DynamicPruningTuner>(listParams, std::move(rlistInner),
+                                                        nstlistPruneMin);
+}
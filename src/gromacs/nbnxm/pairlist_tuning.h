@@ -48,6 +48,8 @@
 
 #include <stdio.h>
 
+#include <memory>
+
 #include "gromacs/math/vectypes.h"
 
 namespace gmx
@@ -56,6 +58,11 @@ class CpuInfo;
 class MDLogger;
 } // namespace gmx
 
+namespace Nbnxm
+{
+class DynamicPruningTuner;
+}
+
 struct gmx_mtop_t;
 struct interaction_const_t;
 struct PairlistParams;
@@ -98,4 +105,24 @@ void setupDynamicPairlistPruning(const gmx::MDLogger&       mdlog,
                                  const interaction_const_t* ic,
                                  PairlistParams*            listParams);
 
+/*! \brief Returns an object for tuning the dynamic pruning interval at runtime
+ *
+ * Tuning is only done when requested with the GMX_NBNXN_TUNE_DYNAMICPRUNING
+ * environment variable, with dynamic pruning of CPU pair lists and
+ * when the pruning interval was not set by the user.
+ * Returns nullptr when we do not tune.
+ *
+ * \param[in,out] mdlog            MD logger
+ * \param[in]     ir               The input parameter record
+ * \param[in]     mtop             The global topology
+ * \param[in]     box              The unit cell
+ * \param[in]     listParams       The list setup parameters
+ */
+std::unique_ptr<Nbnxm::DynamicPruningTuner>
+makeDynamicPruningTuner(const gmx::MDLogger&  mdlog,
+                        const t_inputrec*     ir,
+                        const gmx_mtop_t*     mtop,
+                        const matrix          box,
+                        const PairlistParams& listParams);
+
 #endif /* NBNXM_PAIRLIST_TUNING_H */
@@ -45,6 +45,7 @@
 
 #include "pairlistset.h"
 
+#include "incrementalpairlist.h"
 #include "pairlistwork.h"
 
 PairlistSet::~PairlistSet() = default;
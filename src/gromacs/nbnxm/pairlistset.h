@@ -68,6 +68,7 @@ struct t_nrnb;
 namespace Nbnxm
 {
 class GridSet;
+class IncrementalPairlist;
 }
 
 /*! \internal
@@ -113,7 +114,13 @@ public:
     }
 
     //! Returns the lists of free-energy pairlists, empty when nonbonded interactions are not perturbed
-    gmx::ArrayRef<const std::unique_ptr<t_nblist>> fepLists() const { return fepLists_; }
+    gmx::ArrayRef<const std::unique_ptr<NbnxnPairlistFep>> fepLists() const { return fepLists_; }
+
+    //! Returns the incremental update data, nullptr when incremental updates are not enabled
+    const Nbnxm::IncrementalPairlist* incrementalPairlist() const
+    {
+        return incrementalPairlist_.get();
+    }
 
 private:
     //! The locality of the pairlist set
@@ -130,8 +137,10 @@ private:
     bool combineLists_;
     //! Tells whether the lists is of CPU type, otherwise GPU type
     gmx_bool isCpuType_;
-    //! Lists for perturbed interactions in simple atom-atom layout
-    std::vector<std::unique_ptr<t_nblist>> fepLists_;
+    //! Lists for perturbed interactions in cluster-pair layout
+    std::vector<std::unique_ptr<NbnxnPairlistFep>> fepLists_;
+    //! Data for incremental updates of the local CPU list, only present with GMX_NBNXN_INCREMENTAL_GRID
+    std::unique_ptr<Nbnxm::IncrementalPairlist> incrementalPairlist_;
 
 public:
     /* Pair counts for flop counting */
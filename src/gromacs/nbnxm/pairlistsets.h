@@ -53,6 +53,12 @@
 
 #include "pairlistparams.h"
 
+namespace Nbnxm
+{
+class DynamicPruningTuner;
+class KernelCounters;
+}
+
 struct nbnxn_atomdata_t;
 class PairlistSet;
 enum class PairlistType;
@@ -64,9 +70,13 @@ struct t_nrnb;
 class PairlistSets
 {
 public:
-    PairlistSets(const PairlistParams& pairlistParams,
-                 bool                  haveMultipleDomains,
-                 int                   minimumIlistCountForGpuBalancing);
+    PairlistSets(const PairlistParams&                       pairlistParams,
+                 bool                                        haveMultipleDomains,
+                 int                                         minimumIlistCountForGpuBalancing,
+                 std::unique_ptr<Nbnxm::DynamicPruningTuner> dynamicPruningTuner,
+                 std::unique_ptr<Nbnxm::KernelCounters>      kernelCounters);
+
+    ~PairlistSets();
 
     //! Construct the pairlist set for the given locality
     void construct(gmx::InteractionLocality iLocality,
@@ -105,12 +115,21 @@ public:
                 && (params_.haveMultipleDomains || age % 2 == 0));
     }
 
-    //! Changes the pair-list outer and inner radius
-    void changePairlistRadii(real rlistOuter, real rlistInner)
-    {
-        params_.rlistOuter = rlistOuter;
-        params_.rlistInner = rlistInner;
-    }
+    /*! \brief Changes the pair-list outer and inner radius
+     *
+     * When tuning the dynamic pruning interval, \p rlistInner is ignored
+     * and the inner radius is set for the current pruning interval.
+     */
+    void changePairlistRadii(real rlistOuter, real rlistInner);
+
+    //! Returns the dynamic pruning interval tuner, nullptr when not tuning
+    Nbnxm::DynamicPruningTuner* dynamicPruningTuner() { return dynamicPruningTuner_.get(); }
+
+    //! Stops tuning the dynamic pruning interval and keeps the current interval
+    void disableDynamicPruningTuning();
+
+    //! Returns the CPU kernel statistics counters, nullptr when not collecting statistics
+    Nbnxm::KernelCounters* kernelCounters() const { return kernelCounters_.get(); }
 
     //! Returns the pair-list set for the given locality
     const PairlistSet& pairlistSet(gmx::InteractionLocality iLocality) const
@@ -151,6 +170,10 @@ private:
     std::unique_ptr<PairlistSet> nonlocalSet_;
     //! MD step at with the outer lists in pairlistSets_ were created
     int64_t outerListCreationStep_;
+    //! Tuner for the dynamic pruning interval, nullptr when not tuning
+    std::unique_ptr<Nbnxm::DynamicPruningTuner> dynamicPruningTuner_;
+    //! Statistics counters for the CPU kernels, nullptr when not collecting statistics
+    std::unique_ptr<Nbnxm::KernelCounters> kernelCounters_;
 };
 
 #endif
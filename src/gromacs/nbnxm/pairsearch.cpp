@@ -50,12 +50,19 @@
 #include "pairlist.h"
 
 
-void SearchCycleCounting::printCycles(FILE* fp, gmx::ArrayRef<const PairsearchWork> work) const
+void SearchCycleCounting::printCycles(FILE*                               fp,
+                                      gmx::ArrayRef<const PairsearchWork> work,
+                                      const int numGridUpdatesKeepingAtomOrder) const
 {
     fprintf(fp, "\n");
     fprintf(fp, "ns %4d grid %4.1f search %4.1f", cc_[enbsCCgrid].count(),
             cc_[enbsCCgrid].averageMCycles(), cc_[enbsCCsearch].averageMCycles());
 
+    if (numGridUpdatesKeepingAtomOrder > 0)
+    {
+        fprintf(fp, " grid-keep-order %4d", numGridUpdatesKeepingAtomOrder);
+    }
+
     if (work.size() > 1)
     {
         if (cc_[enbsCCcombine].count() > 0)
@@ -71,27 +78,14 @@ void SearchCycleCounting::printCycles(FILE* fp, gmx::ArrayRef<const PairsearchWo
     fprintf(fp, "\n");
 }
 
-/*! \brief Frees the contents of a legacy t_nblist struct */
-static void free_nblist(t_nblist* nl)
-{
-    sfree(nl->iinr);
-    sfree(nl->gid);
-    sfree(nl->shift);
-    sfree(nl->jindex);
-    sfree(nl->jjnr);
-    sfree(nl->excl_fep);
-}
-
 #ifndef DOXYGEN
 
 PairsearchWork::PairsearchWork() :
     cp0({ { 0 } }),
     buffer_flags({ 0, nullptr, 0 }),
     ndistc(0),
-    nbl_fep(new t_nblist),
     cp1({ { 0 } })
 {
-    nbnxn_init_pairlist_fep(nbl_fep.get());
 }
 
 #endif // !DOXYGEN
@@ -99,8 +93,6 @@ PairsearchWork::PairsearchWork() :
 PairsearchWork::~PairsearchWork()
 {
     sfree(buffer_flags.flag);
-
-    free_nblist(nbl_fep.get());
 }
 
 PairSearch::PairSearch(const int                 ePBC,
@@ -109,9 +101,11 @@ PairSearch::PairSearch(const int                 ePBC,
                        const gmx_domdec_zones_t* ddZones,
                        const PairlistType        pairlistType,
                        const bool                haveFep,
+                       const Nbnxm::ColumnOrder  columnOrder,
                        const int                 maxNumThreads,
                        gmx::PinningPolicy        pinningPolicy) :
-    gridSet_(ePBC, doTestParticleInsertion, numDDCells, ddZones, pairlistType, haveFep, maxNumThreads, pinningPolicy),
+    gridSet_(ePBC, doTestParticleInsertion, numDDCells, ddZones, pairlistType, haveFep, columnOrder,
+             maxNumThreads, pinningPolicy),
     work_(maxNumThreads)
 {
     cycleCounting_.recordCycles_ = (getenv("GMX_NBNXN_CYCLE") != nullptr);
@@ -125,8 +125,10 @@ struct SearchCycleCounting
     //! Stop a pair search cycle counter
     void stop(const int enbsCC) { cc_[enbsCC].stop(); }
 
-    //! Print the cycle counts to \p fp
-    void printCycles(FILE* fp, gmx::ArrayRef<const PairsearchWork> work) const;
+    //! Print the cycle counts and the number of grid updates that kept the atom order to \p fp
+    void printCycles(FILE*                               fp,
+                     gmx::ArrayRef<const PairsearchWork> work,
+                     int                                 numGridUpdatesKeepingAtomOrder) const;
 
     //! Tells whether we record cycles
     bool recordCycles_ = false;
@@ -154,7 +156,7 @@ struct PairsearchWork
     int ndistc; /* Number of distance checks for flop counting */
 
 
-    std::unique_ptr<t_nblist> nbl_fep; /* Temporary FEP list for load balancing */
+    std::unique_ptr<NbnxnPairlistFep> nbl_fep; /* Temporary FEP list for load balancing */
 
     nbnxn_cycle_t cycleCounter; /* Counter for thread-local cycles */
 
@@ -193,6 +195,7 @@ public:
      * \param[in] numDDCells      The number of domain decomposition cells per dimension, without DD nullptr should be passed
      * \param[in] zones           The domain decomposition zone setup, without DD nullptr should be passed
      * \param[in] haveFep         Tells whether non-bonded interactions are perturbed
+     * \param[in] columnOrder     The order of the columns of CPU search grids
      * \param[in] maxNumThreads   The maximum number of threads used in the search
      */
     PairSearch(int                       ePBC,
@@ -201,6 +204,7 @@ public:
                const gmx_domdec_zones_t* zones,
                PairlistType              pairlistType,
                bool                      haveFep,
+               Nbnxm::ColumnOrder        columnOrder,
                int                       maxNumthreads,
                gmx::PinningPolicy        pinningPolicy);
 
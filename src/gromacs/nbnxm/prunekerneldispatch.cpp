@@ -35,12 +35,16 @@
 
 #include "gmxpre.h"
 
+#include "config.h"
+
 #include "gromacs/mdlib/gmx_omp_nthreads.h"
 #include "gromacs/nbnxm/nbnxm.h"
 #include "gromacs/timing/wallcycle.h"
 #include "gromacs/utility/gmxassert.h"
 
 #include "clusterdistancekerneltype.h"
+#include "dynamicpruningtuner.h"
+#include "kernelcounters.h"
 #include "pairlistset.h"
 #include "pairlistsets.h"
 #include "kernels_reference/kernel_ref_prune.h"
@@ -51,7 +55,22 @@ void PairlistSets::dispatchPruneKernel(const gmx::InteractionLocality iLocality,
                                        const nbnxn_atomdata_t*        nbat,
                                        const rvec*                    shift_vec)
 {
+    if (dynamicPruningTuner_)
+    {
+        dynamicPruningTuner_->startTiming();
+    }
+
     pairlistSet(iLocality).dispatchPruneKernel(nbat, shift_vec);
+
+    if (dynamicPruningTuner_)
+    {
+        dynamicPruningTuner_->stopTiming();
+    }
+
+    if (GMX_NBNXM_KERNEL_COUNTERS && kernelCounters_)
+    {
+        kernelCounters_->accountPrune(iLocality, pairlistSet(iLocality).cpuLists());
+    }
 }
 
 void PairlistSet::dispatchPruneKernel(const nbnxn_atomdata_t* nbat, const rvec* shift_vec)
@@ -0,0 +1,245 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2020, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests for the runtime tuning of the dynamic pruning interval.
+ *
+ * \ingroup module_nbnxm
+ */
+#include "gmxpre.h"
+
+#include "gromacs/nbnxm/dynamicpruningtuner.h"
+
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/nbnxm/nbnxm.h"
+#include "gromacs/nbnxm/pairlistparams.h"
+#include "gromacs/utility/real.h"
+
+#include "testutils/testasserts.h"
+
+namespace gmx
+{
+namespace test
+{
+namespace
+{
+
+//! The number of steps between pair searches
+constexpr int c_nstlist = 10;
+
+//! The tuner repeats the search after this many lists
+constexpr int c_numListsBetweenTuning = 1000;
+
+//! The initial pruning interval
+constexpr int c_nstlistPruneInitial = 4;
+//! The minimum pruning interval to tune over
+constexpr int c_nstlistPruneMin = 2;
+//! The maximum pruning interval to tune over
+constexpr int c_nstlistPruneMax = 8;
+
+/*! \brief Synthetic cost model of the pruning and non-bonded kernels
+ *
+ * The cost of a pruning call is constant. The cost of a non-bonded
+ * kernel call increases linearly with the pruning interval, as the
+ * inner list buffer increases with the interval.
+ */
+struct CostModel
+{
+    //! Returns the cycles spent in the kernels over a list lifetime
+    gmx_cycles_t listCycles(int nstlistPrune) const
+    {
+        gmx_cycles_t cycles = 0;
+        for (int step = 0; step < c_nstlist; step++)
+        {
+            if (step % nstlistPrune == 0)
+            {
+                cycles += pruneCycles;
+            }
+            cycles += kernelCycles + kernelCyclesPerPruneStep * nstlistPrune;
+        }
+        return cycles;
+    }
+
+    //! Returns the interval in [\p nstlistPruneMin, \p nstlistPruneMax] with the lowest cost
+    int optimalInterval(int nstlistPruneMin, int nstlistPruneMax) const
+    {
+        int best = nstlistPruneMin;
+        for (int nstlistPrune = nstlistPruneMin; nstlistPrune <= nstlistPruneMax; nstlistPrune++)
+        {
+            if (listCycles(nstlistPrune) < listCycles(best))
+            {
+                best = nstlistPrune;
+            }
+        }
+        return best;
+    }
+
+    //! The cycles per pruning call
+    gmx_cycles_t pruneCycles;
+    //! The cycles per non-bonded kernel call without inner list buffer
+    gmx_cycles_t kernelCycles;
+    //! The increase in the non-bonded kernel cycles per step of the pruning interval
+    gmx_cycles_t kernelCyclesPerPruneStep;
+};
+
+/*! \brief Feeds the costs of \p costModel for \p numLists list lifetimes through \p tuner
+ *
+ * \returns the pruning interval for the next list
+ */
+int runLists(Nbnxm::DynamicPruningTuner* tuner,
+             int                         nstlistPrune,
+             int                         numLists,
+             const CostModel&            costModel)
+{
+    for (int list = 0; list < numLists; list++)
+    {
+        for (int step = 0; step < c_nstlist; step++)
+        {
+            if (step % nstlistPrune == 0)
+            {
+                tuner->addCycles(costModel.pruneCycles);
+            }
+            tuner->addCycles(costModel.kernelCycles
+                             + costModel.kernelCyclesPerPruneStep * nstlistPrune);
+            tuner->addStep();
+        }
+        nstlistPrune = tuner->endListLifetime();
+    }
+    return nstlistPrune;
+}
+
+//! Test fixture with pair list parameters for tuning the pruning interval between 2 and 8
+class DynamicPruningTunerTest : public ::testing::Test
+{
+public:
+    DynamicPruningTunerTest() :
+        params_(Nbnxm::KernelType::Cpu4x4_PlainC, false, 1.0, false),
+        rlistInner_({ 1.2, 1.2, 1.0, 1.03, 1.06, 1.09, 1.12, 1.15, 1.18 })
+    {
+        params_.useDynamicPruning = true;
+        params_.rlistOuter        = 1.2;
+        params_.lifetime          = c_nstlist - 1;
+        params_.nstlistPrune      = c_nstlistPruneInitial;
+    }
+
+    //! The pair list parameters
+    PairlistParams params_;
+    //! The inner list radii for each pruning interval
+    std::vector<real> rlistInner_;
+};
+
+TEST_F(DynamicPruningTunerTest, ConvergesToOptimalInterval)
+{
+    Nbnxm::DynamicPruningTuner tuner(params_, rlistInner_, c_nstlistPruneMin);
+
+    for (const CostModel& costModel : { CostModel{ 2000, 1000, 100 }, CostModel{ 200, 1000, 100 },
+                                        CostModel{ 20000, 1000, 100 } })
+    {
+        tuner.reset();
+        const int optimum = costModel.optimalInterval(c_nstlistPruneMin, c_nstlistPruneMax);
+
+        /* The first call ends the list before the first search, which is not measured */
+        int nstlistPrune = tuner.endListLifetime();
+        nstlistPrune     = runLists(&tuner, nstlistPrune, 100, costModel);
+        EXPECT_EQ(nstlistPrune, optimum);
+
+        /* After convergence the interval is kept */
+        EXPECT_EQ(runLists(&tuner, nstlistPrune, 100, costModel), optimum);
+    }
+}
+
+TEST_F(DynamicPruningTunerTest, RetunesWhenCostsChange)
+{
+    Nbnxm::DynamicPruningTuner tuner(params_, rlistInner_, c_nstlistPruneMin);
+
+    const CostModel cheapPruning{ 200, 1000, 100 };
+    const CostModel expensivePruning{ 20000, 1000, 100 };
+    const int cheapOptimum = cheapPruning.optimalInterval(c_nstlistPruneMin, c_nstlistPruneMax);
+    const int expensiveOptimum =
+            expensivePruning.optimalInterval(c_nstlistPruneMin, c_nstlistPruneMax);
+    ASSERT_NE(cheapOptimum, expensiveOptimum);
+
+    int nstlistPrune = runLists(&tuner, c_nstlistPruneInitial, 100, cheapPruning);
+    EXPECT_EQ(nstlistPrune, cheapOptimum);
+
+    /* The tuner only notices the change when it repeats the search */
+    nstlistPrune = runLists(&tuner, nstlistPrune, 100, expensivePruning);
+    EXPECT_EQ(nstlistPrune, cheapOptimum);
+
+    nstlistPrune = runLists(&tuner, nstlistPrune, c_numListsBetweenTuning, expensivePruning);
+    EXPECT_EQ(nstlistPrune, expensiveOptimum);
+}
+
+TEST_F(DynamicPruningTunerTest, IgnoresListsWithIncompleteLifetime)
+{
+    Nbnxm::DynamicPruningTuner tuner(params_, rlistInner_, c_nstlistPruneMin);
+
+    /* Lists that end before their full lifetime, for instance due to
+     * a change of the box, should not be used in the measurements.
+     */
+    const CostModel costModel{ 2000, 1000, 100 };
+    int             nstlistPrune = c_nstlistPruneInitial;
+    for (int list = 0; list < 100; list++)
+    {
+        tuner.addCycles(costModel.listCycles(nstlistPrune) / c_nstlist);
+        tuner.addStep();
+        nstlistPrune = tuner.endListLifetime();
+    }
+    EXPECT_EQ(nstlistPrune, c_nstlistPruneInitial);
+
+    EXPECT_EQ(runLists(&tuner, nstlistPrune, 100, costModel),
+              costModel.optimalInterval(c_nstlistPruneMin, c_nstlistPruneMax));
+}
+
+TEST_F(DynamicPruningTunerTest, ShiftsInnerRadiusWithOuterRadius)
+{
+    Nbnxm::DynamicPruningTuner tuner(params_, rlistInner_, c_nstlistPruneMin);
+
+    const FloatingPointTolerance tolerance = absoluteTolerance(1e-6);
+    for (int nstlistPrune = c_nstlistPruneMin; nstlistPrune <= c_nstlistPruneMax; nstlistPrune++)
+    {
+        EXPECT_REAL_EQ_TOL(rlistInner_[nstlistPrune],
+                           tuner.rlistInner(nstlistPrune, params_.rlistOuter), tolerance);
+        EXPECT_REAL_EQ_TOL(rlistInner_[nstlistPrune] + 0.1,
+                           tuner.rlistInner(nstlistPrune, params_.rlistOuter + 0.1), tolerance);
+    }
+}
+
+} // namespace
+} // namespace test
+} // namespace gmx
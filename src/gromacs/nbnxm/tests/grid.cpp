@@ -0,0 +1,121 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2020, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests for the search grid setup.
+ *
+ * \ingroup module_nbnxm
+ */
+#include "gmxpre.h"
+
+#include <gtest/gtest.h>
+
+#include "gromacs/math/vec.h"
+#include "gromacs/nbnxm/benchmark/bench_system.h"
+#include "gromacs/nbnxm/grid.h"
+#include "gromacs/nbnxm/gridset.h"
+#include "gromacs/nbnxm/nbnxm.h"
+#include "gromacs/nbnxm/pairsearch.h"
+
+#include "testutils/setenv.h"
+
+#include "nbnxmtestcommon.h"
+
+namespace gmx
+{
+namespace test
+{
+namespace
+{
+
+//! The list radius used in these tests
+constexpr real c_rlist = 0.6;
+
+//! Returns the dimensions of the local grid of \p nbv
+const Nbnxm::Grid::Dimensions& localGridDimensions(const nonbonded_verlet_t& nbv)
+{
+    return nbv.pairSearch_->gridSet().grids()[0].dimensions();
+}
+
+TEST(GridTest, DensePhaseCellSizeMatchesMeanDensityForHomogeneousSystem)
+{
+    const BenchmarkSystem system(1);
+
+    gmxSetenv("GMX_NBNXN_DENSE_PHASE_CELL_SIZE", "1", 1);
+    auto nbv = setupNbnxm(system, Nbnxm::KernelType::Cpu4x4_PlainC, c_rlist, c_rlist, 1);
+    gmxUnsetenv("GMX_NBNXN_DENSE_PHASE_CELL_SIZE");
+
+    putOnGridAndSearch(nbv.get(), system, system.coordinates);
+
+    const real meanDensity = system.coordinates.size() / det(system.box);
+    EXPECT_NEAR(localGridDimensions(*nbv).atomDensity, meanDensity, 0.05 * meanDensity);
+}
+
+TEST(GridTest, DensePhaseCellSizeIsSmallerForLiquidSlab)
+{
+    /* A slab of water with twice its thickness of vacuum along z */
+    BenchmarkSystem system(1);
+    const real      liquidDensity = system.coordinates.size() / det(system.box);
+    system.box[ZZ][ZZ] *= 3;
+
+    auto nbvMean = setupNbnxm(system, Nbnxm::KernelType::Cpu4x4_PlainC, c_rlist, c_rlist, 1);
+    gmxSetenv("GMX_NBNXN_DENSE_PHASE_CELL_SIZE", "1", 1);
+    auto nbvDense = setupNbnxm(system, Nbnxm::KernelType::Cpu4x4_PlainC, c_rlist, c_rlist, 1);
+    gmxUnsetenv("GMX_NBNXN_DENSE_PHASE_CELL_SIZE");
+
+    putOnGridAndSearch(nbvMean.get(), system, system.coordinates);
+    putOnGridAndSearch(nbvDense.get(), system, system.coordinates);
+
+    const Nbnxm::Grid::Dimensions& dimsMean  = localGridDimensions(*nbvMean);
+    const Nbnxm::Grid::Dimensions& dimsDense = localGridDimensions(*nbvDense);
+
+    EXPECT_NEAR(dimsMean.atomDensity, liquidDensity / 3, 0.01 * liquidDensity);
+    /* Bins that straddle the liquid-vacuum interfaces lower the estimate somewhat */
+    EXPECT_GT(dimsDense.atomDensity, 0.85 * liquidDensity);
+    EXPECT_LT(dimsDense.atomDensity, 1.05 * liquidDensity);
+    for (int d = 0; d < DIM - 1; d++)
+    {
+        EXPECT_LT(dimsDense.cellSize[d], 0.8 * dimsMean.cellSize[d]);
+    }
+
+    /* All clusters have the same size, so only the grid changes and the lists are complete */
+    const AtomPairSet pairsInRange = atomPairsInRange(system, system.coordinates, c_rlist);
+    EXPECT_EQ(atomPairsInPairlist(*nbvMean, system, system.coordinates, c_rlist), pairsInRange);
+    EXPECT_EQ(atomPairsInPairlist(*nbvDense, system, system.coordinates, c_rlist), pairsInRange);
+}
+
+} // namespace
+} // namespace test
+} // namespace gmx
@@ -0,0 +1,212 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2020, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests for the half-precision storage of the j-cluster coordinates.
+ *
+ * \ingroup module_nbnxm
+ */
+#include "gmxpre.h"
+
+#include "gromacs/nbnxm/halfprecision.h"
+
+#include "config.h"
+
+#include <cmath>
+
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/mdtypes/locality.h"
+#include "gromacs/nbnxm/atomdata.h"
+#include "gromacs/nbnxm/benchmark/bench_system.h"
+#include "gromacs/nbnxm/nbnxm.h"
+#include "gromacs/nbnxm/nbnxm_simd.h"
+
+#include "nbnxmtestcommon.h"
+
+namespace gmx
+{
+namespace test
+{
+namespace
+{
+
+//! The documented bound on the absolute error of offsets below 1 nm
+constexpr float c_offsetErrorBound = 3e-4;
+
+TEST(HalfPrecisionTest, RoundTripIsExactForAllHalfValues)
+{
+    for (int i = 0; i <= std::numeric_limits<uint16_t>::max(); i++)
+    {
+        const uint16_t half  = static_cast<uint16_t>(i);
+        const float    value = Nbnxm::halfToFloat(half);
+        const bool     isNaN = ((half & 0x7c00) == 0x7c00 && (half & 0x3ff) != 0);
+        if (isNaN)
+        {
+            ASSERT_TRUE(std::isnan(value)) << "for half " << i;
+            ASSERT_TRUE(std::isnan(Nbnxm::halfToFloat(Nbnxm::floatToHalf(value))))
+                    << "for half " << i;
+        }
+        else
+        {
+            ASSERT_EQ(Nbnxm::floatToHalf(value), half) << "for half " << i;
+        }
+    }
+}
+
+TEST(HalfPrecisionTest, ConvertsSpecialValues)
+{
+    EXPECT_EQ(Nbnxm::floatToHalf(1.0F), 0x3c00);
+    EXPECT_EQ(Nbnxm::floatToHalf(-2.0F), 0xc000);
+    EXPECT_EQ(Nbnxm::floatToHalf(-0.0F), 0x8000);
+    /* The smallest normal and subnormal values */
+    EXPECT_EQ(Nbnxm::floatToHalf(std::ldexp(1.0F, -14)), 0x0400);
+    EXPECT_EQ(Nbnxm::floatToHalf(std::ldexp(1.0F, -24)), 0x0001);
+    /* The largest finite value, values that round to it and overflow */
+    EXPECT_EQ(Nbnxm::floatToHalf(65504.0F), 0x7bff);
+    EXPECT_EQ(Nbnxm::floatToHalf(65519.0F), 0x7bff);
+    EXPECT_EQ(Nbnxm::floatToHalf(65520.0F), 0x7c00);
+    EXPECT_EQ(Nbnxm::floatToHalf(-std::numeric_limits<float>::infinity()), 0xfc00);
+}
+
+TEST(HalfPrecisionTest, RoundsToNearestEven)
+{
+    const float ulpAtOne = std::ldexp(1.0F, -10);
+    /* Ties round to the even mantissa */
+    EXPECT_EQ(Nbnxm::floatToHalf(1.0F + 0.5F * ulpAtOne), 0x3c00);
+    EXPECT_EQ(Nbnxm::floatToHalf(1.0F + 1.5F * ulpAtOne), 0x3c02);
+    /* Values just above a tie round up */
+    EXPECT_EQ(Nbnxm::floatToHalf(1.0F + 0.5F * ulpAtOne + std::ldexp(1.0F, -20)), 0x3c01);
+    /* A carry from the mantissa into the exponent */
+    EXPECT_EQ(Nbnxm::floatToHalf(2.0F - 0.5F * ulpAtOne), 0x4000);
+    /* The same for subnormals */
+    EXPECT_EQ(Nbnxm::floatToHalf(std::ldexp(1.0F, -25)), 0x0000);
+    EXPECT_EQ(Nbnxm::floatToHalf(std::ldexp(3.0F, -25)), 0x0002);
+}
+
+TEST(HalfPrecisionTest, OffsetErrorIsWithinDocumentedBound)
+{
+    /* Check offsets up to 1 nm with a spacing that is not commensurate with the half grid */
+    const int numValues   = 1000003;
+    float     maxAbsError = 0;
+    for (int i = -numValues; i <= numValues; i++)
+    {
+        const float offset = i * (1.0F / numValues);
+        const float error  = std::abs(Nbnxm::halfToFloat(Nbnxm::floatToHalf(offset)) - offset);
+        maxAbsError        = std::max(maxAbsError, error);
+    }
+    EXPECT_LE(maxAbsError, std::ldexp(1.0F, -12));
+    EXPECT_LT(maxAbsError, c_offsetErrorBound);
+}
+
+#if GMX_SIMD && !GMX_DOUBLE
+
+//! Returns the SIMD kernel types that are compiled in
+std::vector<Nbnxm::KernelType> simdKernelTypes()
+{
+    std::vector<Nbnxm::KernelType> kernelTypes;
+#    ifdef GMX_NBNXN_SIMD_4XN
+    kernelTypes.push_back(Nbnxm::KernelType::Cpu4xN_Simd_4xN);
+#    endif
+#    ifdef GMX_NBNXN_SIMD_2XNN
+    kernelTypes.push_back(Nbnxm::KernelType::Cpu4xN_Simd_2xNN);
+#    endif
+    return kernelTypes;
+}
+
+/*! \brief Checks that the half-precision offsets in \p nbv reproduce \p coordinates
+ *
+ * Returns the maximum absolute deviation over all atoms and dimensions.
+ */
+float maxHalfPrecisionDeviation(const nonbonded_verlet_t&      nbv,
+                                gmx::ArrayRef<const gmx::RVec> coordinates)
+{
+    const nbnxn_atomdata_t&  nbat         = *nbv.nbat;
+    const int                packSize     = (nbat.XFormat == nbatX4 ? c_packX4 : c_packX8);
+    gmx::ArrayRef<const int> gridIndices  = nbv.getGridIndices();
+    float                    maxDeviation = 0;
+    for (int a = 0; a < coordinates.ssize(); a++)
+    {
+        const int i       = gridIndices[a];
+        const int cluster = i / nbat.jClusterSize;
+        const int xIndex  = (packSize == c_packX4 ? atom_to_x_index<c_packX4>(i)
+                                                  : atom_to_x_index<c_packX8>(i));
+        for (int d = 0; d < DIM; d++)
+        {
+            const float x = nbat.xHalfOrigin()[cluster * DIM + d]
+                            + Nbnxm::halfToFloat(nbat.xHalf()[xIndex + d * packSize]);
+            maxDeviation = std::max(maxDeviation, std::abs(x - coordinates[a][d]));
+        }
+    }
+    return maxDeviation;
+}
+
+TEST(HalfPrecisionTest, OffsetsFollowSearchAndCoordinateUpdates)
+{
+    const BenchmarkSystem system(1);
+    const real            rlist = 0.6;
+
+    for (const Nbnxm::KernelType kernelType : simdKernelTypes())
+    {
+        auto nbv = setupNbnxm(system, kernelType, rlist, rlist, 2);
+        ASSERT_TRUE(nbv->nbat->setUseHalfPrecisionX(true));
+
+        /* Putting the atoms on the grid converts the offsets */
+        putOnGridAndSearch(nbv.get(), system, system.coordinates);
+        EXPECT_LT(maxHalfPrecisionDeviation(*nbv, system.coordinates), c_offsetErrorBound);
+
+        /* Updating the coordinates without search should also update the offsets */
+        std::vector<gmx::RVec> coordinates = system.coordinates;
+        for (int a = 0; a < gmx::ssize(coordinates); a++)
+        {
+            for (int d = 0; d < DIM; d++)
+            {
+                coordinates[a][d] += 0.01_real * ((a + d) % 7 - 3);
+            }
+        }
+        nbv->convertCoordinates(AtomLocality::Local, false, coordinates);
+        EXPECT_LT(maxHalfPrecisionDeviation(*nbv, coordinates), c_offsetErrorBound);
+    }
+}
+
+#endif
+
+} // namespace
+} // namespace test
+} // namespace gmx
@@ -0,0 +1,127 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2020, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests for the non-bonded kernel statistics counters.
+ *
+ * \ingroup module_nbnxm
+ */
+#include "gmxpre.h"
+
+#include "gromacs/nbnxm/kernelcounters.h"
+
+#include <bitset>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/mdtypes/interaction_const.h"
+#include "gromacs/mdtypes/locality.h"
+#include "gromacs/nbnxm/benchmark/bench_system.h"
+#include "gromacs/nbnxm/nbnxm.h"
+#include "gromacs/nbnxm/pairlistset.h"
+#include "gromacs/nbnxm/pairlistsets.h"
+
+#include "nbnxmtestcommon.h"
+
+namespace gmx
+{
+namespace test
+{
+namespace
+{
+
+TEST(KernelCountersTest, CountsMatchPairlistAndPairsInRange)
+{
+    const BenchmarkSystem system(1);
+    const real            rlist      = 0.6;
+    const real            cutoff     = 0.5;
+    const int             numThreads = 2;
+
+    auto nbv = setupNbnxm(system, Nbnxm::KernelType::Cpu4x4_PlainC, rlist, rlist, numThreads);
+    putOnGridAndSearch(nbv.get(), system, system.coordinates);
+
+    interaction_const_t ic;
+    ic.rcoulomb = cutoff;
+    ic.rvdw     = cutoff;
+
+    const auto pairlists =
+            nbv->pairlistSets().pairlistSet(InteractionLocality::Local).cpuLists();
+    ASSERT_EQ(pairlists.ssize(), numThreads);
+
+    /* With 4x4 clusters, only the lower 16 bits of the masks are used */
+    const int numPairsPerClusterPair = 4 * 4;
+    int64_t   numClusterPairs        = 0;
+    int64_t   numUnmaskedAtomPairs   = 0;
+    for (const NbnxnPairlistCpu& nbl : pairlists)
+    {
+        numClusterPairs += nbl.cj.size();
+        for (const nbnxn_cj_t& cj : nbl.cj)
+        {
+            numUnmaskedAtomPairs += std::bitset<numPairsPerClusterPair>(cj.excl).count();
+        }
+    }
+    ASSERT_GT(numClusterPairs, 0);
+    const int64_t numPairsInRange = atomPairsInRange(system, system.coordinates, cutoff).size();
+
+    Nbnxm::KernelCounters counters(numThreads, "");
+
+    /* The first call samples the distances, the second only counts the list */
+    for (int call = 1; call <= 2; call++)
+    {
+        counters.accountKernel(InteractionLocality::Local, pairlists, *nbv->nbat, ic,
+                               system.forceRec.shift_vec);
+
+        const Nbnxm::KernelCounterData sum = counters.sum();
+        EXPECT_EQ(sum.numKernelCalls, call * numThreads);
+        EXPECT_EQ(sum.numClusterPairs, call * numClusterPairs);
+        EXPECT_EQ(sum.numAtomPairs, call * numClusterPairs * numPairsPerClusterPair);
+        EXPECT_EQ(sum.numUnmaskedAtomPairs, call * numUnmaskedAtomPairs);
+        EXPECT_EQ(sum.numSampledAtomPairs, numUnmaskedAtomPairs);
+        EXPECT_EQ(sum.numSampledAtomPairsInRange, numPairsInRange);
+    }
+
+    /* After the lists changed they are counted again, giving the same counts */
+    counters.setListsChanged(InteractionLocality::Local);
+    counters.accountKernel(InteractionLocality::Local, pairlists, *nbv->nbat, ic,
+                           system.forceRec.shift_vec);
+    const Nbnxm::KernelCounterData sum = counters.sum();
+    EXPECT_EQ(sum.numClusterPairs, 3 * numClusterPairs);
+    EXPECT_EQ(sum.numSampledAtomPairsInRange, numPairsInRange);
+    EXPECT_EQ(sum.numPruneCalls, 0);
+}
+
+} // namespace
+} // namespace test
+} // namespace gmx
@@ -0,0 +1,259 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2020, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Implements common routines for the Nbnxm tests.
+ *
+ * \ingroup module_nbnxm
+ */
+#include "gmxpre.h"
+
+#include "nbnxmtestcommon.h"
+
+#include <cmath>
+
+#include <algorithm>
+#include <vector>
+
+#include "gromacs/gmxlib/nrnb.h"
+#include "gromacs/math/vec.h"
+#include "gromacs/mdlib/force_flags.h"
+#include "gromacs/mdlib/gmx_omp_nthreads.h"
+#include "gromacs/mdtypes/enerdata.h"
+#include "gromacs/mdtypes/interaction_const.h"
+#include "gromacs/mdtypes/mdatom.h"
+#include "gromacs/mdtypes/simulation_workload.h"
+#include "gromacs/nbnxm/atomdata.h"
+#include "gromacs/nbnxm/benchmark/bench_system.h"
+#include "gromacs/nbnxm/dynamicpruningtuner.h"
+#include "gromacs/nbnxm/gridset.h"
+#include "gromacs/nbnxm/kernelcounters.h"
+#include "gromacs/nbnxm/nbnxm.h"
+#include "gromacs/nbnxm/pairlistset.h"
+#include "gromacs/nbnxm/pairlistsets.h"
+#include "gromacs/nbnxm/pairsearch.h"
+#include "gromacs/pbcutil/ishift.h"
+#include "gromacs/pbcutil/pbc.h"
+#include "gromacs/utility/gmxassert.h"
+#include "gromacs/utility/logger.h"
+
+namespace gmx
+{
+namespace test
+{
+
+std::unique_ptr<nonbonded_verlet_t> setupNbnxm(const BenchmarkSystem&   system,
+                                               const Nbnxm::KernelType  kernelType,
+                                               const real               rlistInner,
+                                               const real               rlistOuter,
+                                               const int                numThreads,
+                                               const Nbnxm::ColumnOrder columnOrder)
+{
+    gmx_omp_nthreads_set(emntPairsearch, numThreads);
+    gmx_omp_nthreads_set(emntNonbonded, numThreads);
+
+    Nbnxm::KernelSetup kernelSetup;
+    kernelSetup.kernelType         = kernelType;
+    kernelSetup.ewaldExclusionType = Nbnxm::EwaldExclusionType::Table;
+
+    PairlistParams pairlistParams(kernelSetup.kernelType, false, rlistInner, false);
+    if (rlistOuter > rlistInner)
+    {
+        pairlistParams.useDynamicPruning = true;
+        pairlistParams.rlistOuter        = rlistOuter;
+    }
+
+    auto pairlistSets = std::make_unique<PairlistSets>(pairlistParams, false, 0, nullptr, nullptr);
+
+    auto pairSearch = std::make_unique<PairSearch>(
+            epbcXYZ, false, nullptr, nullptr, pairlistParams.pairlistType, false,
+            columnOrder, numThreads, gmx::PinningPolicy::CannotBePinned);
+
+    auto atomData = std::make_unique<nbnxn_atomdata_t>(gmx::PinningPolicy::CannotBePinned);
+
+    auto nbv = std::make_unique<nonbonded_verlet_t>(std::move(pairlistSets), std::move(pairSearch),
+                                                    std::move(atomData), kernelSetup, nullptr, nullptr);
+
+    nbnxn_atomdata_init(gmx::MDLogger(), nbv->nbat.get(), kernelSetup.kernelType, ljcrGEOM,
+                        system.numAtomTypes, system.nonbondedParameters.data(), 1, numThreads);
+
+    return nbv;
+}
+
+void putOnGridAndSearch(nonbonded_verlet_t*            nbv,
+                        const BenchmarkSystem&         system,
+                        gmx::ArrayRef<const gmx::RVec> coordinates)
+{
+    GMX_RELEASE_ASSERT(!TRICLINIC(system.box), "Only rectangular unit-cells are supported here");
+    const rvec lowerCorner = { 0, 0, 0 };
+    const rvec upperCorner = { system.box[XX][XX], system.box[YY][YY], system.box[ZZ][ZZ] };
+
+    const real atomDensity = coordinates.size() / det(system.box);
+
+    nbnxn_put_on_grid(nbv, system.box, 0, lowerCorner, upperCorner, nullptr,
+                      { 0, int(coordinates.size()) }, atomDensity, system.atomInfoAllVdw,
+                      coordinates, 0, nullptr);
+
+    t_nrnb nrnb;
+    nbv->constructPairlist(gmx::InteractionLocality::Local, &system.excls, 0, &nrnb);
+
+    t_mdatoms mdatoms;
+    // We only use (read) the atom type and charge from mdatoms
+    mdatoms.typeA   = const_cast<int*>(system.atomTypes.data());
+    mdatoms.chargeA = const_cast<real*>(system.charges.data());
+    nbv->setAtomProperties(mdatoms, system.atomInfoAllVdw);
+}
+
+AtomPairCounts atomPairCountsInPairlist(const nonbonded_verlet_t&      nbv,
+                                        const BenchmarkSystem&         system,
+                                        gmx::ArrayRef<const gmx::RVec> coordinates,
+                                        const real                     range)
+{
+    gmx::ArrayRef<const int> atomIndices = nbv.pairSearch_->gridSet().atomIndices();
+
+    AtomPairCounts pairCounts;
+    for (const NbnxnPairlistCpu& list :
+         nbv.pairlistSets().pairlistSet(gmx::InteractionLocality::Local).cpuLists())
+    {
+        const bool haveOuterList = !list.ciOuter.empty();
+        const auto& ciList       = (haveOuterList ? list.ciOuter : list.ci);
+        const auto& cjList       = (haveOuterList ? list.cjOuter : list.cj);
+        for (const nbnxn_ci_t& ciEntry : ciList)
+        {
+            const gmx::RVec shift = system.forceRec.shift_vec[ciEntry.shift & NBNXN_CI_SHIFT];
+            for (int cjIndex = ciEntry.cj_ind_start; cjIndex < ciEntry.cj_ind_end; cjIndex++)
+            {
+                const nbnxn_cj_t& cjEntry = cjList[cjIndex];
+                for (int i = 0; i < list.na_ci; i++)
+                {
+                    const int ai = atomIndices[ciEntry.ci * list.na_ci + i];
+                    for (int j = 0; j < list.na_cj; j++)
+                    {
+                        const int aj = atomIndices[cjEntry.cj * list.na_cj + j];
+                        if (ai < 0 || aj < 0 || !(cjEntry.excl & (1U << (i * list.na_cj + j))))
+                        {
+                            continue;
+                        }
+                        const gmx::RVec dx = coordinates[ai] + shift - coordinates[aj];
+                        if (norm2(dx) < range * range)
+                        {
+                            pairCounts[{ std::min(ai, aj), std::max(ai, aj) }]++;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    return pairCounts;
+}
+
+AtomPairSet atomPairsInPairlist(const nonbonded_verlet_t&      nbv,
+                                const BenchmarkSystem&         system,
+                                gmx::ArrayRef<const gmx::RVec> coordinates,
+                                const real                     range)
+{
+    AtomPairSet pairs;
+    for (const auto& pairCount : atomPairCountsInPairlist(nbv, system, coordinates, range))
+    {
+        pairs.insert(pairCount.first);
+    }
+
+    return pairs;
+}
+
+AtomPairSet atomPairsInRange(const BenchmarkSystem& system, gmx::ArrayRef<const gmx::RVec> coordinates, const real range)
+{
+    t_pbc pbc;
+    set_pbc(&pbc, epbcXYZ, system.box);
+
+    const int         numAtoms = coordinates.size();
+    std::vector<bool> isExcluded(numAtoms, false);
+    AtomPairSet       pairs;
+    for (int ai = 0; ai < numAtoms; ai++)
+    {
+        for (int k = system.excls.index[ai]; k < system.excls.index[ai + 1]; k++)
+        {
+            isExcluded[system.excls.a[k]] = true;
+        }
+        for (int aj = ai + 1; aj < numAtoms; aj++)
+        {
+            rvec dx;
+            pbc_dx(&pbc, coordinates[ai], coordinates[aj], dx);
+            if (!isExcluded[aj] && norm2(dx) < range * range)
+            {
+                pairs.insert({ ai, aj });
+            }
+        }
+        for (int k = system.excls.index[ai]; k < system.excls.index[ai + 1]; k++)
+        {
+            isExcluded[system.excls.a[k]] = false;
+        }
+    }
+
+    return pairs;
+}
+
+std::vector<gmx::RVec> computeForces(nonbonded_verlet_t*    nbv,
+                                     const BenchmarkSystem& system,
+                                     const real             cutoff)
+{
+    interaction_const_t ic;
+    ic.vdwtype          = evdwCUT;
+    ic.vdw_modifier     = eintmodPOTSHIFT;
+    ic.rvdw             = cutoff;
+    ic.eeltype          = eelRF;
+    ic.coulomb_modifier = eintmodPOTSHIFT;
+    ic.rcoulomb         = cutoff;
+    // Reaction-field with epsilon_rf=inf
+    ic.k_rf = 0.5 * std::pow(ic.rcoulomb, -3);
+    ic.c_rf = 1 / ic.rcoulomb + ic.k_rf * ic.rcoulomb * ic.rcoulomb;
+
+    gmx::StepWorkload stepWork;
+    stepWork.computeForces = true;
+
+    gmx_enerdata_t enerd(1, 0);
+    t_nrnb         nrnb;
+    nbv->dispatchNonbondedKernel(gmx::InteractionLocality::Local, ic, stepWork, enbvClearFYes,
+                                 system.forceRec, &enerd, &nrnb);
+
+    std::vector<gmx::RVec> forces(system.coordinates.size(), { 0, 0, 0 });
+    nbv->atomdata_add_nbat_f_to_f(gmx::AtomLocality::All, forces);
+
+    return forces;
+}
+
+} // namespace test
+} // namespace gmx
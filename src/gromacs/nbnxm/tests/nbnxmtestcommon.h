@@ -0,0 +1,135 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2020, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Declares common routines for the Nbnxm tests.
+ *
+ * \ingroup module_nbnxm
+ */
+#ifndef GMX_NBNXM_TESTS_NBNXMTESTCOMMON_H
+#define GMX_NBNXM_TESTS_NBNXMTESTCOMMON_H
+
+#include <map>
+#include <memory>
+#include <set>
+#include <utility>
+#include <vector>
+
+#include "gromacs/math/vectypes.h"
+#include "gromacs/nbnxm/grid.h"
+#include "gromacs/utility/arrayref.h"
+#include "gromacs/utility/real.h"
+
+struct nonbonded_verlet_t;
+
+namespace Nbnxm
+{
+enum class KernelType;
+}
+
+namespace gmx
+{
+
+struct BenchmarkSystem;
+
+namespace test
+{
+
+//! A set of atom pairs, each pair stored with the lowest index first
+using AtomPairSet = std::set<std::pair<int, int>>;
+
+//! The number of occurrences of atom pairs, each pair stored with the lowest index first
+using AtomPairCounts = std::map<std::pair<int, int>, int>;
+
+/*! \brief Sets up and returns an Nbnxm object for \p system
+ *
+ * The atoms are not put on the grid.
+ *
+ * \param[in] system      The system
+ * \param[in] kernelType  The CPU kernel type
+ * \param[in] rlistInner  The inner pair list radius
+ * \param[in] rlistOuter  The outer pair list radius, dynamic pruning is used when larger than \p rlistInner
+ * \param[in] numThreads  The number of OpenMP threads to use for search and kernels
+ * \param[in] columnOrder The order of the grid columns
+ */
+std::unique_ptr<nonbonded_verlet_t>
+setupNbnxm(const BenchmarkSystem& system,
+           Nbnxm::KernelType      kernelType,
+           real                   rlistInner,
+           real                   rlistOuter,
+           int                    numThreads,
+           Nbnxm::ColumnOrder     columnOrder = Nbnxm::ColumnOrder::Natural);
+
+//! Puts \p coordinates in the rectangular box of \p system on the grid and constructs the local pair list
+void putOnGridAndSearch(nonbonded_verlet_t*            nbv,
+                        const BenchmarkSystem&         system,
+                        gmx::ArrayRef<const gmx::RVec> coordinates);
+
+/*! \brief Returns the non-excluded atom pairs in the local CPU pair list within distance \p range
+ *
+ * With dynamic pruning the outer list is used.
+ */
+AtomPairSet atomPairsInPairlist(const nonbonded_verlet_t&      nbv,
+                                const BenchmarkSystem&         system,
+                                gmx::ArrayRef<const gmx::RVec> coordinates,
+                                real                           range);
+
+/*! \brief Returns how often each non-excluded atom pair within distance \p range
+ * occurs in the local CPU pair list
+ *
+ * With dynamic pruning the outer list is used.
+ */
+AtomPairCounts atomPairCountsInPairlist(const nonbonded_verlet_t&      nbv,
+                                        const BenchmarkSystem&         system,
+                                        gmx::ArrayRef<const gmx::RVec> coordinates,
+                                        real                           range);
+
+//! Returns all non-excluded atom pairs in \p system within distance \p range
+AtomPairSet atomPairsInRange(const BenchmarkSystem& system, gmx::ArrayRef<const gmx::RVec> coordinates, real range);
+
+/*! \brief Computes the reaction-field and LJ forces with the kernel and pair list of \p nbv
+ *
+ * The cut-off distance is \p cutoff, which should not be longer than the inner list radius.
+ *
+ * \returns the forces in the atom order of \p system
+ */
+std::vector<gmx::RVec> computeForces(nonbonded_verlet_t*    nbv,
+                                     const BenchmarkSystem& system,
+                                     real                   cutoff);
+
+} // namespace test
+} // namespace gmx
+
+#endif
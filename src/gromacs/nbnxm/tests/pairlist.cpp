@@ -0,0 +1,196 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2020, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests for the CPU pair list construction.
+ *
+ * \ingroup module_nbnxm
+ */
+#include "gmxpre.h"
+
+#include <cmath>
+
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/math/vec.h"
+#include "gromacs/nbnxm/benchmark/bench_system.h"
+#include "gromacs/nbnxm/grid.h"
+#include "gromacs/nbnxm/gridset.h"
+#include "gromacs/nbnxm/incrementalpairlist.h"
+#include "gromacs/nbnxm/nbnxm.h"
+#include "gromacs/nbnxm/pairlistset.h"
+#include "gromacs/nbnxm/pairlistsets.h"
+#include "gromacs/nbnxm/pairsearch.h"
+
+#include "testutils/setenv.h"
+#include "testutils/testasserts.h"
+
+#include "nbnxmtestcommon.h"
+
+namespace gmx
+{
+namespace test
+{
+namespace
+{
+
+//! The inner list radius used in these tests
+constexpr real c_rlistInner = 0.5;
+//! The outer list radius used in these tests
+constexpr real c_rlistOuter = 0.6;
+
+TEST(PairlistTest, ContainsAllPairsInRange)
+{
+    const BenchmarkSystem system(1);
+
+    auto nbv = setupNbnxm(system, Nbnxm::KernelType::Cpu4x4_PlainC, c_rlistInner, c_rlistOuter, 2);
+    putOnGridAndSearch(nbv.get(), system, system.coordinates);
+
+    EXPECT_EQ(atomPairsInPairlist(*nbv, system, system.coordinates, c_rlistOuter),
+              atomPairsInRange(system, system.coordinates, c_rlistOuter));
+}
+
+TEST(PairlistTest, IncrementalUpdateMatchesFullSearch)
+{
+    const BenchmarkSystem system(2);
+
+    gmxSetenv("GMX_NBNXN_INCREMENTAL_GRID", "1", 1);
+    auto nbvIncremental =
+            setupNbnxm(system, Nbnxm::KernelType::Cpu4x4_PlainC, c_rlistInner, c_rlistOuter, 2);
+    gmxUnsetenv("GMX_NBNXN_INCREMENTAL_GRID");
+    auto nbvFull = setupNbnxm(system, Nbnxm::KernelType::Cpu4x4_PlainC, c_rlistInner, c_rlistOuter, 2);
+
+    const Nbnxm::IncrementalPairlist* incrementalPairlist =
+            nbvIncremental->pairlistSets().pairlistSet(InteractionLocality::Local).incrementalPairlist();
+    ASSERT_NE(incrementalPairlist, nullptr);
+
+    putOnGridAndSearch(nbvIncremental.get(), system, system.coordinates);
+
+    /* Move the atoms along z by scaling the z-coordinates within each grid
+     * column. This keeps the order along z, so the grid can be updated
+     * keeping the atom order. Atoms in columns with x < 1 nm move further
+     * than the margin, so part of the list entries need to be rebuilt.
+     */
+    const Nbnxm::GridSet&    gridSet     = nbvIncremental->pairSearch_->gridSet();
+    const Nbnxm::Grid&       grid        = gridSet.grids()[0];
+    gmx::ArrayRef<const int> atomIndices = gridSet.atomIndices();
+    std::vector<RVec>        coordinates = system.coordinates;
+    for (int column = 0; column < grid.numColumns(); column++)
+    {
+        const real columnX = (grid.columnCellX(column) + 0.5) * grid.dimensions().cellSize[XX];
+        const real scaling = (columnX < 1.0 ? 0.95 : 0.999);
+        for (int i = 0; i < grid.numAtomsInColumn(column); i++)
+        {
+            coordinates[atomIndices[grid.firstAtomInColumn(column) + i]][ZZ] *= scaling;
+        }
+    }
+
+    putOnGridAndSearch(nbvIncremental.get(), system, coordinates);
+    putOnGridAndSearch(nbvFull.get(), system, coordinates);
+
+    EXPECT_EQ(gridSet.numUpdatesKeepingAtomOrder(), 1);
+    EXPECT_GT(incrementalPairlist->numClustersReused(), 0);
+    EXPECT_LT(incrementalPairlist->numClustersReused(), grid.numCells());
+
+    const AtomPairSet pairsInRange = atomPairsInRange(system, coordinates, c_rlistOuter);
+    EXPECT_EQ(atomPairsInPairlist(*nbvIncremental, system, coordinates, c_rlistOuter), pairsInRange);
+    EXPECT_EQ(atomPairsInPairlist(*nbvFull, system, coordinates, c_rlistOuter), pairsInRange);
+}
+
+/* With the Hilbert column order the search can not skip the grid columns
+ * below the i-column, so the half-list condition is checked per cluster pair.
+ * Check that this still gives every pair in range exactly once.
+ */
+TEST(PairlistTest, HilbertColumnOrderContainsAllPairsInRangeOnce)
+{
+    const BenchmarkSystem system(1);
+
+    auto nbv = setupNbnxm(system, Nbnxm::KernelType::Cpu4x4_PlainC, c_rlistInner, c_rlistOuter, 2,
+                          Nbnxm::ColumnOrder::Hilbert);
+    putOnGridAndSearch(nbv.get(), system, system.coordinates);
+
+    ASSERT_FALSE(nbv->pairSearch_->gridSet().grids()[0].haveNaturalColumnOrder());
+
+    const AtomPairCounts pairCounts =
+            atomPairCountsInPairlist(*nbv, system, system.coordinates, c_rlistOuter);
+    AtomPairSet pairs;
+    for (const auto& pairCount : pairCounts)
+    {
+        EXPECT_EQ(pairCount.second, 1)
+                << "for atom pair " << pairCount.first.first << " " << pairCount.first.second;
+        pairs.insert(pairCount.first);
+    }
+    EXPECT_EQ(pairs, atomPairsInRange(system, system.coordinates, c_rlistOuter));
+}
+
+TEST(PairlistTest, HilbertColumnOrderGivesSameForcesAsNaturalOrder)
+{
+    const BenchmarkSystem system(1);
+
+    auto nbvNatural = setupNbnxm(system, Nbnxm::KernelType::Cpu4x4_PlainC, c_rlistInner,
+                                 c_rlistInner, 2, Nbnxm::ColumnOrder::Natural);
+    auto nbvHilbert = setupNbnxm(system, Nbnxm::KernelType::Cpu4x4_PlainC, c_rlistInner,
+                                 c_rlistInner, 2, Nbnxm::ColumnOrder::Hilbert);
+    putOnGridAndSearch(nbvNatural.get(), system, system.coordinates);
+    putOnGridAndSearch(nbvHilbert.get(), system, system.coordinates);
+
+    const std::vector<RVec> forcesNatural = computeForces(nbvNatural.get(), system, c_rlistInner);
+    const std::vector<RVec> forcesHilbert = computeForces(nbvHilbert.get(), system, c_rlistInner);
+
+    double sumForce2 = 0;
+    for (const RVec& f : forcesNatural)
+    {
+        sumForce2 += norm2(f);
+    }
+    const real rmsForce = std::sqrt(sumForce2 / forcesNatural.size());
+    ASSERT_GT(rmsForce, 0);
+
+    // Only the summation order differs
+    const FloatingPointTolerance tolerance = absoluteTolerance(1e-5 * rmsForce);
+    for (size_t a = 0; a < forcesNatural.size(); a++)
+    {
+        for (int d = 0; d < DIM; d++)
+        {
+            EXPECT_REAL_EQ_TOL(forcesNatural[a][d], forcesHilbert[a][d], tolerance)
+                    << "for atom " << a << " dimension " << d;
+        }
+    }
+}
+
+} // namespace
+} // namespace test
+} // namespace gmx
@@ -1192,7 +1192,8 @@ static void set_table_type(int tabsel[], const interaction_const_t* ic, gmx_bool
 
     switch (eltype)
     {
-        case eelCUT: tabsel[etiCOUL] = etabCOUL; break;
+        case eelCUT:
+        case eelFMM: tabsel[etiCOUL] = etabCOUL; break;
         case eelPOISSON: tabsel[etiCOUL] = etabShift; break;
         case eelSHIFT:
             if (ic->rcoulomb > ic->rcoulomb_switch)
@@ -1205,6 +1206,7 @@ static void set_table_type(int tabsel[], const interaction_const_t* ic, gmx_bool
             }
             break;
         case eelEWALD:
+        case eelRBE:
         case eelPME:
         case eelP3M_AD: tabsel[etiCOUL] = etabEwald; break;
         case eelPMESWITCH: tabsel[etiCOUL] = etabEwaldSwitch; break;
@@ -0,0 +1,154 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2020, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Implements hardware counters for L2 and L3 cache misses.
+ */
+#include "gmxpre.h"
+
+#include "cachemisscounters.h"
+
+#include "config.h"
+
+#include <cerrno>
+#include <cstring>
+
+#ifdef HAVE_LINUX_PERF_EVENT_H
+#    include <linux/perf_event.h>
+#    include <sys/ioctl.h>
+#    include <sys/syscall.h>
+#    include <unistd.h>
+#endif
+
+namespace gmx
+{
+
+#ifdef HAVE_LINUX_PERF_EVENT_H
+
+namespace
+{
+
+//! Opens a disabled counter for last-level cache read events of type \p result
+int openLastLevelCacheCounter(uint64_t result)
+{
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.type   = PERF_TYPE_HW_CACHE;
+    attr.size   = sizeof(attr);
+    attr.config = PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (result << 16);
+    attr.disabled       = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv     = 1;
+
+    return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+}
+
+} // namespace
+
+CacheMissCounters::CacheMissCounters() : fileDescriptors_({ -1, -1 }), counts_({ 0, 0 })
+{
+    const std::array<uint64_t, 2> results = { PERF_COUNT_HW_CACHE_RESULT_ACCESS,
+                                              PERF_COUNT_HW_CACHE_RESULT_MISS };
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        fileDescriptors_[i] = openLastLevelCacheCounter(results[i]);
+        if (fileDescriptors_[i] < 0)
+        {
+            unavailableReason_ = std::string("perf_event_open failed: ") + std::strerror(errno);
+            break;
+        }
+    }
+}
+
+CacheMissCounters::~CacheMissCounters()
+{
+    for (int fd : fileDescriptors_)
+    {
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+    }
+}
+
+void CacheMissCounters::start()
+{
+    if (!isAvailable())
+    {
+        return;
+    }
+    for (int fd : fileDescriptors_)
+    {
+        ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+}
+
+void CacheMissCounters::stop()
+{
+    if (!isAvailable())
+    {
+        return;
+    }
+    for (size_t i = 0; i < fileDescriptors_.size(); i++)
+    {
+        ioctl(fileDescriptors_[i], PERF_EVENT_IOC_DISABLE, 0);
+        uint64_t count = 0;
+        if (read(fileDescriptors_[i], &count, sizeof(count)) != sizeof(count))
+        {
+            count = 0;
+        }
+        counts_[i] = static_cast<int64_t>(count);
+    }
+}
+
+#else
+
+CacheMissCounters::CacheMissCounters() :
+    fileDescriptors_({ -1, -1 }),
+    counts_({ 0, 0 }),
+    unavailableReason_("not supported on this platform")
+{
+}
+
+CacheMissCounters::~CacheMissCounters() = default;
+
+void CacheMissCounters::start() {}
+
+void CacheMissCounters::stop() {}
+
+#endif
+
+} // namespace gmx
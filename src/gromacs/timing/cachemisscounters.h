@@ -0,0 +1,100 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2020, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \libinternal \file
+ * \brief
+ * Declares hardware counters for L2 and L3 cache misses.
+ *
+ * \inlibraryapi
+ */
+#ifndef GMX_TIMING_CACHEMISSCOUNTERS_H
+#define GMX_TIMING_CACHEMISSCOUNTERS_H
+
+#include <cstdint>
+
+#include <array>
+#include <string>
+
+#include "gromacs/utility/classhelpers.h"
+
+namespace gmx
+{
+
+/*! \libinternal \brief
+ * Counts L2 and L3 cache misses with the Linux perf_event interface
+ *
+ * The counters count the events of the thread that constructs
+ * the object, but can be started and stopped by any thread. L2 misses are
+ * counted as last-level cache read accesses and L3 misses as
+ * last-level cache read misses, which matches CPUs with three cache
+ * levels. The counters are not available on other operating systems,
+ * or when the kernel, its perf_event_paranoid setting or a virtual
+ * machine does not allow access to them.
+ */
+class CacheMissCounters
+{
+public:
+    //! Opens the counters, on failure the counters are marked unavailable
+    CacheMissCounters();
+    ~CacheMissCounters();
+
+    //! Returns whether the counters can be used
+    bool isAvailable() const { return unavailableReason_.empty(); }
+    //! Returns the reason why the counters are not available, empty when they are
+    const std::string& unavailableReason() const { return unavailableReason_; }
+
+    //! Resets and starts the counters, does nothing when not available
+    void start();
+    //! Stops the counters, does nothing when not available
+    void stop();
+
+    //! Returns the number of L2 misses between the last start and stop calls
+    int64_t numL2Misses() const { return counts_[0]; }
+    //! Returns the number of L3 misses between the last start and stop calls
+    int64_t numL3Misses() const { return counts_[1]; }
+
+private:
+    //! The file descriptors of the L2 and L3 counters
+    std::array<int, 2> fileDescriptors_;
+    //! The L2 and L3 miss counts
+    std::array<int64_t, 2> counts_;
+    //! The reason the counters are not available, empty when available
+    std::string unavailableReason_;
+
+    GMX_DISALLOW_COPY_AND_ASSIGN(CacheMissCounters);
+};
+
+} // namespace gmx
+
+#endif
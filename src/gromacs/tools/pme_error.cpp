@@ -104,6 +104,7 @@ typedef struct
     real*    e_dir;          /* Direct space part of PME error with these settings */
     real*    e_rec;          /* Reciprocal space part of PME error                 */
     gmx_bool bTUNE;          /* flag for tuning */
+    gmx_bool bP3M;           /* Use the P3M optimal influence function             */
 } t_inputinfo;
 
 
@@ -768,6 +769,157 @@ static real estimate_reciprocal(t_inputinfo* info,
     return ONE_4PI_EPS0 * e_rec;
 }
 
+/* The number of aliases per dimension on each side of a k-vector used for P3M */
+static const int c_p3mAliasRange = 2;
+
+/* Return the square of the Fourier transform of the B-spline charge assignment
+ * function in one dimension for grid index n with alias m.
+ */
+static inline real p3m_assignment_ft2(int  n, /* grid coordinate in certain direction */
+                                      int  m, /* alias index in this direction */
+                                      real K, /* grid size in corresponding direction */
+                                      int  order) /* spline interpolation order */
+{
+    if (n == 0)
+    {
+        return (m == 0 ? 1.0 : 0.0);
+    }
+
+    real arg = M_PI * (n / K + m);
+
+    return std::pow(std::sin(M_PI * n / K) / arg, 2 * order);
+}
+
+/* Estimate the reciprocal space part error of P3M with the optimal influence function
+ * for analytical differentiation, see Ballenegger et al., JCTC 8, 936 (2012).
+ * This estimate only depends on the charge density, not on the coordinates.
+ */
+static real estimate_reciprocal_p3m(t_inputinfo* info, t_commrec* cr)
+{
+    const int    order = info->pme_order[0];
+    const real   beta  = info->ewald_beta[0];
+    const ivec   nk    = { info->nkx[0], info->nky[0], info->nkz[0] };
+    const double fac   = M_PI * M_PI / (beta * beta);
+
+    /* Distribute the x grid lines over the ranks */
+    int startglobal = -nk[XX] / 2;
+    int stopglobal  = nk[XX] / 2;
+    int startlocal  = startglobal;
+    int stoplocal   = stopglobal;
+    if (PAR(cr))
+    {
+        int xtot       = stopglobal * 2 + 1;
+        int x_per_core = static_cast<int>(std::ceil(static_cast<real>(xtot) / cr->nnodes));
+        startlocal     = startglobal + x_per_core * cr->nodeid;
+        stoplocal      = std::min(startlocal + x_per_core - 1, stopglobal);
+    }
+
+    if (MASTER(cr))
+    {
+        fprintf(stderr, "Calculating P3M reciprocal error ...");
+    }
+
+    double sumQ = 0;
+    for (int nx = startlocal; nx <= stoplocal; nx++)
+    {
+        for (int ny = -nk[YY] / 2; ny < nk[YY] / 2 + 1; ny++)
+        {
+            for (int nz = -nk[ZZ] / 2; nz < nk[ZZ] / 2 + 1; nz++)
+            {
+                if (0 == nx && 0 == ny && 0 == nz)
+                {
+                    continue;
+                }
+
+                /* Sums over the aliases k_m = 2 pi g_m of the k-vector, with
+                 * R(k) = -i 4 pi k/k^2 exp(-k^2/(4 beta^2)) the reference force and U(k)
+                 * the Fourier transform of the assignment function. The 2 pi factors
+                 * of k.R and k^2 cancel in the error term and are left out.
+                 */
+                double sumR2   = 0; /* sum_m |R(k_m)|^2 */
+                double sumU2   = 0; /* sum_m U^2(k_m) */
+                double sumU2k2 = 0; /* sum_m U^2(k_m) g_m^2 */
+                double sumU2kR = 0; /* sum_m U^2(k_m) k_m.R(k_m) / (4 pi) */
+                for (int mx = -c_p3mAliasRange; mx <= c_p3mAliasRange; mx++)
+                {
+                    real u2x = p3m_assignment_ft2(nx, mx, nk[XX], order);
+                    for (int my = -c_p3mAliasRange; my <= c_p3mAliasRange; my++)
+                    {
+                        real u2xy = u2x * p3m_assignment_ft2(ny, my, nk[YY], order);
+                        for (int mz = -c_p3mAliasRange; mz <= c_p3mAliasRange; mz++)
+                        {
+                            real u2 = u2xy * p3m_assignment_ft2(nz, mz, nk[ZZ], order);
+                            rvec gridp;
+                            for (int d = 0; d < DIM; d++)
+                            {
+                                gridp[d] = (nx + mx * nk[XX]) * info->recipbox[XX][d]
+                                           + (ny + my * nk[YY]) * info->recipbox[YY][d]
+                                           + (nz + mz * nk[ZZ]) * info->recipbox[ZZ][d];
+                            }
+                            double g2 = norm2(gridp);
+                            if (g2 == 0)
+                            {
+                                continue;
+                            }
+                            double expTerm = std::exp(-fac * g2);
+
+                            sumR2 += 4 * expTerm * expTerm / g2;
+                            sumU2 += u2;
+                            sumU2k2 += u2 * g2;
+                            sumU2kR += u2 * expTerm;
+                        }
+                    }
+                }
+                if (sumU2 > 0 && sumU2k2 > 0)
+                {
+                    sumQ += sumR2 - 4 * sumU2kR * sumU2kR / (sumU2 * sumU2k2);
+                }
+            }
+        }
+        if (MASTER(cr))
+        {
+            fprintf(stderr, "\rCalculating P3M reciprocal error ... %3.0f%%",
+                    100.0 * (nx - startlocal + 1) / (stoplocal - startlocal + 1));
+            fflush(stderr);
+        }
+    }
+
+    if (MASTER(cr))
+    {
+        fprintf(stderr, "\n");
+    }
+
+    if (PAR(cr))
+    {
+        gmx_sumd(1, &sumQ, cr);
+    }
+
+    /* For uncorrelated charges the RMS force error is sum(q^2) sqrt(Q/N)/V */
+    real e_rec = info->q2all * std::sqrt(std::max(sumQ, 0.0) / info->q2allnr) / info->volume;
+
+    return ONE_4PI_EPS0 * e_rec;
+}
+
+/* Estimate the reciprocal space part error for the influence function in use */
+static real estimate_reciprocal_error(t_inputinfo* info,
+                                      rvec         x[],
+                                      const real   q[],
+                                      int          nr,
+                                      FILE*        fp_out,
+                                      gmx_bool     bVerbose,
+                                      int          seed,
+                                      int*         nsamples,
+                                      t_commrec*   cr)
+{
+    if (info->bP3M)
+    {
+        *nsamples = 0;
+        return estimate_reciprocal_p3m(info, cr);
+    }
+
+    return estimate_reciprocal(info, x, q, nr, fp_out, bVerbose, seed, nsamples, cr);
+}
+
 
 /* Allocate memory for the inputinfo struct: */
 static void create_info(t_inputinfo* info)
@@ -856,6 +1008,7 @@ static void read_tpr_file(const char*  fn_sim_tpr,
     info->nkz[0]         = ir->nkz;
     info->ewald_rtol[0]  = ir->ewald_rtol;
     info->fracself       = fracself;
+    info->bP3M           = (ir->coulombtype == eelP3M_AD);
     if (user_beta > 0)
     {
         info->ewald_beta[0] = user_beta;
@@ -894,6 +1047,7 @@ static void bcast_info(t_inputinfo* info, const t_commrec* cr)
     block_bc(cr, info->natoms);
     block_bc(cr, info->fracself);
     block_bc(cr, info->bTUNE);
+    block_bc(cr, info->bP3M);
     block_bc(cr, info->q2all);
     block_bc(cr, info->q2allnr);
 }
@@ -942,6 +1096,8 @@ static void estimate_PME_error(t_inputinfo*      info,
         fprintf(fp_out, "Ewald_rtol              : %g\n", info->ewald_rtol[0]);
         fprintf(fp_out, "Ewald parameter beta    : %g\n", info->ewald_beta[0]);
         fprintf(fp_out, "Interpolation order     : %d\n", info->pme_order[0]);
+        fprintf(fp_out, "Influence function      : %s\n",
+                info->bP3M ? "P3M optimal" : "SPME B-spline moduli");
         fprintf(fp_out, "Fourier grid (nx,ny,nz) : %d x %d x %d\n", info->nkx[0], info->nky[0],
                 info->nkz[0]);
         fflush(fp_out);
@@ -957,7 +1113,8 @@ static void estimate_PME_error(t_inputinfo*      info,
     info->e_dir[0] = estimate_direct(info);
 
     /* Calculate reciprocal space error */
-    info->e_rec[0] = estimate_reciprocal(info, x, q, ncharges, fp_out, bVerbose, seed, &nsamples, cr);
+    info->e_rec[0] =
+            estimate_reciprocal_error(info, x, q, ncharges, fp_out, bVerbose, seed, &nsamples, cr);
 
     if (PAR(cr))
     {
@@ -968,7 +1125,10 @@ static void estimate_PME_error(t_inputinfo*      info,
     {
         fprintf(fp_out, "Direct space error est. : %10.3e kJ/(mol*nm)\n", info->e_dir[0]);
         fprintf(fp_out, "Reciprocal sp. err. est.: %10.3e kJ/(mol*nm)\n", info->e_rec[0]);
-        fprintf(fp_out, "Self-energy error term was estimated using %d samples\n", nsamples);
+        if (!info->bP3M)
+        {
+            fprintf(fp_out, "Self-energy error term was estimated using %d samples\n", nsamples);
+        }
         fflush(fp_out);
         fprintf(stderr, "Direct space error est. : %10.3e kJ/(mol*nm)\n", info->e_dir[0]);
         fprintf(stderr, "Reciprocal sp. err. est.: %10.3e kJ/(mol*nm)\n", info->e_rec[0]);
@@ -995,7 +1155,8 @@ static void estimate_PME_error(t_inputinfo*      info,
             info->ewald_beta[0] -= 0.1;
         }
         info->e_dir[0] = estimate_direct(info);
-        info->e_rec[0] = estimate_reciprocal(info, x, q, ncharges, fp_out, bVerbose, seed, &nsamples, cr);
+        info->e_rec[0] =
+            estimate_reciprocal_error(info, x, q, ncharges, fp_out, bVerbose, seed, &nsamples, cr);
 
         if (PAR(cr))
         {
@@ -1016,8 +1177,8 @@ static void estimate_PME_error(t_inputinfo*      info,
             derr0               = derr;
 
             info->e_dir[0] = estimate_direct(info);
-            info->e_rec[0] =
-                    estimate_reciprocal(info, x, q, ncharges, fp_out, bVerbose, seed, &nsamples, cr);
+            info->e_rec[0] = estimate_reciprocal_error(info, x, q, ncharges, fp_out, bVerbose,
+                                                       seed, &nsamples, cr);
 
             if (PAR(cr))
             {
@@ -1068,6 +1229,9 @@ int gmx_pme_error(int argc, char* argv[])
         "is computationally demanding. However, a good a approximation is to",
         "just use a fraction of the particles for this term which can be",
         "indicated by the flag [TT]-self[tt].[PAR]",
+        "When the run input file uses P3M-AD, the reciprocal space error is estimated",
+        "for the P3M optimal influence function instead. This estimate only depends",
+        "on the charge density, so [TT]-self[tt] does not apply.[PAR]",
     };
 
     real          fs        = 0.0; /* 0 indicates: not set by the user */
@@ -1190,7 +1354,7 @@ int gmx_pme_error(int argc, char* argv[])
             ir.ewald_rtol = info.ewald_rtol[0];
             write_tpx_state(opt2fn("-so", NFILE, fnm), &ir, &state, &mtop);
         }
-        please_cite(fp, "Wang2010");
+        please_cite(fp, info.bP3M ? "Ballenegger2012" : "Wang2010");
         fclose(fp);
     }
 
@@ -54,6 +54,7 @@
 #include "gromacs/selection/selectionoptionbehavior.h"
 #include "gromacs/utility/arraysize.h"
 #include "gromacs/utility/enumerationhelpers.h"
+#include "gromacs/utility/exceptions.h"
 
 namespace gmx
 {
@@ -75,6 +76,8 @@ public:
 
 private:
     int                       sizeFactor_ = 1;
+    bool                      runSuite_   = false;
+    bool                      runSearch_  = false;
     Nbnxm::KernelBenchOptions benchmarkOptions_;
 };
 
@@ -152,7 +155,51 @@ void NonbondedBenchmark::initOptions(IOptionsContainer* options, ICommandLineOpt
         "In the MD engine, any clusters where at most half of the atoms",
         "have LJ interactions will automatically use this kernel.",
         "And finally, the [TT]-energy[tt] option selects the computation",
-        "of energies, which are usually only needed infrequently."
+        "of energies, which are usually only needed infrequently.[PAR]",
+        "The [TT]-halfx[tt] option stores the j-cluster coordinates",
+        "as half-precision offsets, which reduces the memory bandwidth",
+        "required by the SIMD kernels. The deviations of the forces",
+        "with respect to the plain-C reference kernel are reported",
+        "for full and half-precision coordinates. In mdrun this storage",
+        "can be enabled with the GMX_NBNXN_HALF_PRECISION_X environment",
+        "variable.[PAR]",
+        "The [TT]-hilbert[tt] option stores the columns of the search grid",
+        "in the order of a Hilbert curve instead of x-major order. This keeps",
+        "the coordinates of spatially close clusters closer in memory, which",
+        "can reduce the number of cache misses in the kernels. The",
+        "[TT]-cachemisses[tt] option reports the L2 and L3 cache misses",
+        "per useful pair of the kernels, measured as last-level cache",
+        "read accesses and misses with the Linux perf_event hardware",
+        "counters. When the counters are not available, for instance",
+        "in virtual machines or with a restrictive perf_event_paranoid",
+        "setting, this is reported instead. In mdrun the Hilbert order can",
+        "be enabled with the GMX_NBNXN_HILBERT_COLUMNS environment",
+        "variable.[PAR]",
+        "The [TT]-suite[tt] option runs a suite of benchmarks for detecting",
+        "performance regressions in the kernels, the pair search and the",
+        "force reduction. Starting from the setup given by the other options,",
+        "the suite separately varies the system size from 3000 atoms up to",
+        "[TT]-suitesize[tt] times that in factors of 8, to go from cache",
+        "resident to memory bound, the atom density, the cut-off and the",
+        "combination rule. Each setup is run with all supported SIMD kernels",
+        "and the plain-C kernel, unless [TT]-simd[tt] selects one kernel.",
+        "The number of iterations is divided by the size factor.",
+        "The results are written in JSON format to the file given by",
+        "[TT]-json[tt]. With [TT]-baseline[tt], the results are compared",
+        "to those in a JSON file written earlier by the suite.",
+        "Setups that are slower than the baseline by more than",
+        "[TT]-tolerance[tt] are reported and give a non-zero exit code.",
+        "As the timings are in cycles, the baseline should be generated",
+        "on the same hardware.[PAR]",
+        "The [TT]-search[tt] option benchmarks the pair search instead of",
+        "the kernels. Putting the atoms on the grid, constructing the pair",
+        "list and dynamic pruning of the list are timed separately, for",
+        "thread counts of powers of 2 up to [TT]-nt[tt]. Between iterations",
+        "the coordinates are displaced randomly by up to [TT]-displacement[tt],",
+        "to mimic the motion of the atoms between search steps.",
+        "The outer pair list uses a cut-off of [TT]-cutoff[tt] plus",
+        "[TT]-buffer[tt] and is pruned to [TT]-cutoff[tt]. With [TT]-buffer[tt]",
+        "set to zero, dynamic pruning is not used."
     };
 
     settings->setHelpText(desc);
@@ -202,6 +249,42 @@ void NonbondedBenchmark::initOptions(IOptionsContainer* options, ICommandLineOpt
     options->addOption(BooleanOption("cycles")
                                .store(&benchmarkOptions_.cyclesPerPair)
                                .description("Report cycles/pair instead of pairs/cycle"));
+    options->addOption(BooleanOption("halfx")
+                               .store(&benchmarkOptions_.useHalfPrecisionX)
+                               .description("Store j-coordinates in half precision and report "
+                                            "the force accuracy"));
+    options->addOption(BooleanOption("hilbert")
+                               .store(&benchmarkOptions_.useHilbertColumnOrder)
+                               .description("Order the search grid columns along a Hilbert curve"));
+    options->addOption(BooleanOption("cachemisses")
+                               .store(&benchmarkOptions_.measureCacheMisses)
+                               .description("Report the L2 and L3 cache misses of the kernels"));
+    options->addOption(BooleanOption("suite").store(&runSuite_).description(
+            "Run the benchmark suite for sizes, densities, cut-offs and combination rules"));
+    options->addOption(IntegerOption("suitesize")
+                               .store(&benchmarkOptions_.suiteMaxSizeFactor)
+                               .description("The maximum size factor for the suite, has to "
+                                            "be a power of 8"));
+    options->addOption(StringOption("json")
+                               .store(&benchmarkOptions_.jsonFileName)
+                               .description("JSON output file for the suite results"));
+    options->addOption(StringOption("baseline")
+                               .store(&benchmarkOptions_.baselineFileName)
+                               .description("JSON file with baseline suite results to compare to"));
+    options->addOption(RealOption("tolerance")
+                               .store(&benchmarkOptions_.baselineTolerance)
+                               .description("Relative slowdown with respect to the baseline "
+                                            "that is reported as a regression"));
+    options->addOption(BooleanOption("search").store(&runSearch_).description(
+            "Benchmark the pair search for a range of thread counts"));
+    options->addOption(RealOption("buffer")
+                               .store(&benchmarkOptions_.outerListBuffer)
+                               .description("Buffer for the outer pair list with dynamic pruning "
+                                            "in the search benchmark"));
+    options->addOption(RealOption("displacement")
+                               .store(&benchmarkOptions_.searchDisplacement)
+                               .description("Maximum displacement of the coordinates between "
+                                            "search benchmark iterations"));
 }
 
 void NonbondedBenchmark::optionsFinished()
@@ -209,10 +292,29 @@ void NonbondedBenchmark::optionsFinished()
     // We compute the Ewald coefficient here to avoid a dependency of the Nbnxm on the Ewald module
     const real ewald_rtol          = 1e-5;
     benchmarkOptions_.ewaldcoeff_q = calc_ewaldcoeff_q(benchmarkOptions_.pairlistCutoff, ewald_rtol);
+
+    if (runSuite_ && !Nbnxm::isValidSuiteMaxSizeFactor(benchmarkOptions_.suiteMaxSizeFactor))
+    {
+        GMX_THROW(InvalidInputError("-suitesize has to be a power of 8"));
+    }
 }
 
 int NonbondedBenchmark::run()
 {
+    if (runSuite_)
+    {
+        const int numRegressions = Nbnxm::benchSuite(benchmarkOptions_);
+
+        return (numRegressions == 0 ? 0 : 1);
+    }
+
+    if (runSearch_)
+    {
+        Nbnxm::benchSearch(sizeFactor_, benchmarkOptions_);
+
+        return 0;
+    }
+
     Nbnxm::bench(sizeFactor_, benchmarkOptions_);
 
     return 0;
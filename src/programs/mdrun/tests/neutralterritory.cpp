@@ -0,0 +1,196 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2020, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests that the neutral-territory domain decomposition zone scheme
+ * gives the same energies as the eighth-shell scheme and communicates
+ * the expected number of halo atoms.
+ *
+ * \ingroup module_mdrun_integration_tests
+ */
+#include "gmxpre.h"
+
+#include <cstdlib>
+
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/math/units.h"
+#include "gromacs/topology/ifunc.h"
+#include "gromacs/trajectory/energyframe.h"
+#include "gromacs/utility/stringutil.h"
+#include "gromacs/utility/textreader.h"
+
+#include "testutils/cmdlinetest.h"
+#include "testutils/mpitest.h"
+#include "testutils/setenv.h"
+
+#include "energycomparison.h"
+#include "energyreader.h"
+#include "mdruncomparison.h"
+#include "moduletest.h"
+
+namespace gmx
+{
+namespace test
+{
+namespace
+{
+
+//! The number of ranks the domain decomposition below requires
+constexpr int c_numRanks = 6;
+//! The edge of the cubic box of the argon5832 system
+constexpr double c_boxSize = 6.05449;
+//! The cut-off distance, which is also the domain decomposition cut-off
+constexpr double c_cutoff = 0.9;
+
+//! Returns the average number of atoms communicated for the force halo, read from the log file
+double averageNumHaloAtoms(const std::string& logFileName)
+{
+    const std::string log = TextReader::readFileToString(logFileName);
+    const std::string key = "av. #atoms communicated per step for force:";
+    size_t            pos = log.find(key);
+    if (pos == std::string::npos)
+    {
+        ADD_FAILURE() << "The log file " << logFileName << " should contain: " << key;
+        return 0;
+    }
+    /* The line has the form "<key>  2 x <count>" */
+    pos = log.find(" x ", pos + key.size());
+    return std::strtod(log.c_str() + pos + 3, nullptr);
+}
+
+//! Test fixture for the neutral-territory zone scheme
+class NeutralTerritoryTest : public MdrunTestFixture
+{
+};
+
+TEST_F(NeutralTerritoryTest, MatchesEighthShell)
+{
+    if (getNumberOfTestMpiRanks() != c_numRanks)
+    {
+        fprintf(stdout, "The neutral-territory test requires %d ranks.\n", c_numRanks);
+        return;
+    }
+
+    runner_.useStringAsMdpFile(formatString(
+            "integrator = md\n"
+            "nsteps = 20\n"
+            "nstcalcenergy = 1\n"
+            "nstenergy = 5\n"
+            "cutoff-scheme = Verlet\n"
+            "verlet-buffer-tolerance = -1\n"
+            "nstlist = 10\n"
+            "rlist = %g\n"
+            "rvdw = %g\n"
+            "rcoulomb = %g\n",
+            c_cutoff, c_cutoff, c_cutoff));
+    runner_.useTopGroAndNdxFromDatabase("argon5832");
+    ASSERT_EQ(0, runner_.callGrompp());
+
+    const char* environmentVariable       = "GMX_DD_NEUTRAL_TERRITORY";
+    const char* environmentVariableBackup = getenv(environmentVariable);
+
+    /* With 3 domains along y, y is the tower dimension */
+    CommandLine caller;
+    caller.append("-dd");
+    caller.append("2");
+    caller.append("3");
+    caller.append("1");
+    caller.addOption("-dlb", "no");
+
+    const std::string eighthShellEdrFileName = fileManager_.getTemporaryFilePath("es.edr");
+    const std::string eighthShellLogFileName = fileManager_.getTemporaryFilePath("es.log");
+    runner_.edrFileName_                     = eighthShellEdrFileName;
+    runner_.logFileName_                     = eighthShellLogFileName;
+    gmxUnsetenv(environmentVariable);
+    ASSERT_EQ(0, runner_.callMdrun(caller));
+
+    const std::string neutralTerritoryEdrFileName = fileManager_.getTemporaryFilePath("nt.edr");
+    const std::string neutralTerritoryLogFileName = fileManager_.getTemporaryFilePath("nt.log");
+    runner_.edrFileName_                          = neutralTerritoryEdrFileName;
+    runner_.logFileName_                          = neutralTerritoryLogFileName;
+    gmxSetenv(environmentVariable, "1", true);
+    ASSERT_EQ(0, runner_.callMdrun(caller));
+
+    if (environmentVariableBackup != nullptr)
+    {
+        gmxSetenv(environmentVariable, environmentVariableBackup, true);
+    }
+    else
+    {
+        gmxUnsetenv(environmentVariable);
+    }
+
+    const std::string neutralTerritoryLog =
+            TextReader::readFileToString(neutralTerritoryLogFileName);
+    EXPECT_NE(neutralTerritoryLog.find("Using the neutral-territory zone scheme"),
+              std::string::npos)
+            << "The neutral-territory scheme should be used";
+
+    EnergyTermsToCompare energyTermsToCompare{ {
+            { interaction_function[F_EPOT].longname, relativeToleranceAsPrecisionDependentUlp(10.0, 100, 80) },
+            { interaction_function[F_EKIN].longname, relativeToleranceAsPrecisionDependentUlp(10.0, 100, 80) },
+            { interaction_function[F_PRES].longname,
+              relativeToleranceAsPrecisionDependentFloatingPoint(10.0, 0.01, 0.001) },
+    } };
+    EnergyComparison                    energyComparison(energyTermsToCompare);
+    auto                                namesOfEnergiesToMatch = energyComparison.getEnergyNames();
+    FramePairManager<EnergyFrameReader> energyManager(
+            openEnergyFileToReadTerms(eighthShellEdrFileName, namesOfEnergiesToMatch),
+            openEnergyFileToReadTerms(neutralTerritoryEdrFileName, namesOfEnergiesToMatch));
+    energyManager.compareAllFramePairs<EnergyFrame>(energyComparison);
+
+    /* The halo volumes per unit length along z. The eighth-shell scheme
+     * communicates a slab of one cut-off along x and y plus the rounded
+     * corner, the neutral-territory scheme a slab along x and two along y.
+     */
+    const double cellSizeX = c_boxSize / 2;
+    const double cellSizeY = c_boxSize / 3;
+    const double eighthShell =
+            c_cutoff * cellSizeY + cellSizeX * c_cutoff + 0.25 * M_PI * c_cutoff * c_cutoff;
+    const double neutralTerritory = c_cutoff * cellSizeY + 2 * cellSizeX * c_cutoff;
+
+    const double numHaloAtomsEighthShell      = averageNumHaloAtoms(eighthShellLogFileName);
+    const double numHaloAtomsNeutralTerritory = averageNumHaloAtoms(neutralTerritoryLogFileName);
+    ASSERT_GT(numHaloAtomsEighthShell, 0);
+    EXPECT_NEAR(numHaloAtomsNeutralTerritory / numHaloAtomsEighthShell,
+                neutralTerritory / eighthShell, 0.02 * neutralTerritory / eighthShell);
+}
+
+} // namespace
+} // namespace test
+} // namespace gmx
@@ -43,11 +43,17 @@
 
 #include "programs/mdrun/nonbonded_bench.h"
 
+#include <regex>
+#include <string>
+
+#include "gromacs/utility/exceptions.h"
 #include "gromacs/utility/stringutil.h"
 #include "gromacs/utility/textreader.h"
+#include "gromacs/utility/textwriter.h"
 
 #include "testutils/refdata.h"
 #include "testutils/testasserts.h"
+#include "testutils/testfilemanager.h"
 
 #include "moduletest.h"
 
@@ -67,6 +73,86 @@ TEST(NonbondedBenchTest, BasicEndToEndTest)
                          &gmx::NonbondedBenchmarkInfo::create, &cmdline));
 }
 
+/* This only checks that writing and reading a baseline works, the large
+ * tolerance avoids failures due to timing noise.
+ */
+TEST(NonbondedBenchTest, SuiteWithBaselineSmokeTest)
+{
+    TestFileManager   fileManager;
+    const std::string jsonFileName = fileManager.getTemporaryFilePath("suite.json");
+
+    const char* const command[] = { "nonbonded-benchmark" };
+    CommandLine       cmdline(command);
+    cmdline.addOption("-iter", 1);
+    cmdline.addOption("-suite");
+    cmdline.addOption("-suitesize", 1);
+    cmdline.addOption("-json", jsonFileName.c_str());
+    EXPECT_EQ(0, gmx::test::CommandLineTestHelper::runModuleFactory(
+                         &gmx::NonbondedBenchmarkInfo::create, &cmdline));
+
+    // Compare to the results written above, with a tolerance that avoids timing noise
+    CommandLine cmdlineWithBaseline(command);
+    cmdlineWithBaseline.addOption("-iter", 1);
+    cmdlineWithBaseline.addOption("-suite");
+    cmdlineWithBaseline.addOption("-suitesize", 1);
+    cmdlineWithBaseline.addOption("-baseline", jsonFileName.c_str());
+    cmdlineWithBaseline.addOption("-tolerance", 1000);
+    EXPECT_EQ(0, gmx::test::CommandLineTestHelper::runModuleFactory(
+                         &gmx::NonbondedBenchmarkInfo::create, &cmdlineWithBaseline));
+}
+
+TEST(NonbondedBenchTest, SuiteDetectsRegressionsWithRespectToBaseline)
+{
+    TestFileManager   fileManager;
+    const std::string jsonFileName     = fileManager.getTemporaryFilePath("suite.json");
+    const std::string baselineFileName = fileManager.getTemporaryFilePath("baseline.json");
+
+    const char* const command[] = { "nonbonded-benchmark" };
+    CommandLine       cmdline(command);
+    cmdline.addOption("-iter", 1);
+    cmdline.addOption("-suite");
+    cmdline.addOption("-suitesize", 1);
+    cmdline.addOption("-json", jsonFileName.c_str());
+    EXPECT_EQ(0, gmx::test::CommandLineTestHelper::runModuleFactory(
+                         &gmx::NonbondedBenchmarkInfo::create, &cmdline));
+
+    // A baseline that is a factor 1e6 faster, so all setups should be reported as slower
+    const std::regex  timing("(MCycles\": )[-+.eE0-9]+");
+    const std::string baseline =
+            std::regex_replace(TextReader::readFileToString(jsonFileName), timing, "$011e-6");
+    TextWriter::writeFileFromString(baselineFileName, baseline);
+
+    CommandLine cmdlineWithBaseline(command);
+    cmdlineWithBaseline.addOption("-iter", 1);
+    cmdlineWithBaseline.addOption("-suite");
+    cmdlineWithBaseline.addOption("-suitesize", 1);
+    cmdlineWithBaseline.addOption("-baseline", baselineFileName.c_str());
+    cmdlineWithBaseline.addOption("-tolerance", 0.5);
+    EXPECT_EQ(1, gmx::test::CommandLineTestHelper::runModuleFactory(
+                         &gmx::NonbondedBenchmarkInfo::create, &cmdlineWithBaseline));
+}
+
+TEST(NonbondedBenchTest, SuiteRejectsSizeFactorThatIsNotAPowerOf8)
+{
+    const char* const command[] = { "nonbonded-benchmark" };
+    CommandLine       cmdline(command);
+    cmdline.addOption("-suite");
+    cmdline.addOption("-suitesize", 2);
+    EXPECT_THROW_GMX(gmx::test::CommandLineTestHelper::runModuleFactory(
+                             &gmx::NonbondedBenchmarkInfo::create, &cmdline),
+                     InvalidInputError);
+}
+
+TEST(NonbondedBenchTest, SearchEndToEndTest)
+{
+    const char* const command[] = { "nonbonded-benchmark" };
+    CommandLine       cmdline(command);
+    cmdline.addOption("-iter", 1);
+    cmdline.addOption("-search");
+    EXPECT_EQ(0, gmx::test::CommandLineTestHelper::runModuleFactory(
+                         &gmx::NonbondedBenchmarkInfo::create, &cmdline));
+}
+
 } // namespace
 } // namespace test
 } // namespace gmx